@@ -16,7 +16,20 @@
 #include <time.h>
 #include <string>
 #include <vector>
+#include <unordered_map>
 
+/** Downloaded files keyed by URL.
+ *
+ * Files are stored by the MD5 of their contents under objects/, so the
+ * same texture served from several URLs is kept once.  The index is a
+ * binary snapshot that is mapped and read in one pass, plus a text
+ * journal of the changes since, which saveIndex() appends to.  Once the
+ * journal outgrows the index it is folded into a new snapshot.  Records
+ * also sit on a least recently used list, so limitCacheSize() only
+ * touches what it evicts.
+ *
+ * Only used from the main thread.
+ */
 class CacheManager
 {
 public:
@@ -33,6 +46,23 @@ public:
         std::string key;
     } CacheRecord;
 
+    // how the last download of a URL went this session, not saved
+    typedef struct
+    {
+        int priority;           // order it was scheduled in, 0 first
+        double queued;          // seconds waiting for a free transfer slot
+        double nameLookup;      // the rest are seconds from the request
+        double connect;
+        double tlsConnect;
+        double firstByte;
+        double total;
+        bool reused;            // went over an already open connection
+        long httpVersion;       // 10, 11, 20 or 30, 0 if unknown
+        bool good;
+        bool notModified;       // the cached copy was still current
+        unsigned int bytes;
+    } TransferInfo;
+
     bool isCacheFileType(const std::string &name) const;
     std::string getLocalName(const std::string &name) const;
 
@@ -46,13 +76,49 @@ public:
 
     void limitCacheSize();
 
+    void setTransferInfo(const std::string& url, const TransferInfo& info);
+    const TransferInfo* getTransferInfo(const std::string& url) const;
+
 private:
-    int findRecord(const std::string& url);
+    typedef struct
+    {
+        int newer;
+        int older;
+    } LRULink;
+
+    int findRecord(const std::string& url) const;
+    void insertRecord(const CacheRecord& rec);
+    void removeRecord(int index);
+    void touchRecord(int index, time_t usedDate);
+    void linkNewest(int index);
+    void unlink(int index);
+    void releaseObject(const std::string& name);
+    void clearRecords();
+
+    std::string getObjectName(const std::string& key, const std::string& url) const;
+    std::string getLegacyName(const std::string& url) const;
+
+    bool readSnapshot();
+    bool writeSnapshot();
+    void replayJournal();
+    bool migrateTextIndex();
+    void journalAdd(const CacheRecord& rec);
+    void journalTouch(const CacheRecord& rec);
+    void journalRemove(const std::string& url);
 
 private:
-    std::string indexName;
-    std::string getIndexPath();
     std::vector<CacheRecord> records;
+    std::vector<LRULink> lru;          // parallel to records
+    int newest;
+    int oldest;
+    std::unordered_map<std::string, int> urlIndex;
+    std::unordered_map<std::string, int> objectRefs;   // records per file
+    long long totalSize;
+
+    std::string journal;               // changes not yet written
+    int journalLines;                  // changes in the journal file
+
+    std::unordered_map<std::string, TransferInfo> transfers;
 };
 
 extern CacheManager CACHEMGR;
@@ -16,9 +16,12 @@
 #include "common.h"
 
 #include "cURLManager.h"
+#include "TimeKeeper.h"
 
 /* system interface headers */
 #include <string>
+#include <vector>
+#include <map>
 
 
 namespace Downloads
@@ -34,25 +37,47 @@ bool requestFinalized();
 bool authorizedServer(const std::string& hostname);
 bool parseHostname(const std::string& url, std::string& hostname);
 
+/** One texture download.  Transfers needing the network are queued in
+ *  priority order and started by startTransfers() as slots free up, at
+ *  most httpMaxTransfers at once and httpMaxHostTransfers per host.
+ */
 class CachedTexture : cURLManager
 {
 public:
-    CachedTexture(const std::string &texUrl);
+    CachedTexture(const std::string &texUrl, int priority);
+    virtual ~CachedTexture();
 
     virtual void finalization(char *data, unsigned int length, bool good);
 
     static void  setParams(bool check, long timeout);
+    static void  setTransferLimits(int maxTotal, int maxPerHost);
+    static void  startTransfers();
     static int   activeTransfer();
 private:
 
     virtual void collectData(char* ptr, int len);
 
+    void            start();
+    void            recordTransfer(unsigned int length, bool good);
+
     std::string          url;
+    std::string          host;
+    int             priority;
+    TimeKeeper          queuedTime;
+    TimeKeeper          startTime;
+    bool            queued;
+    bool            active;
     static bool          checkForCache;
     static long          httpTimeout;
     static int        textureCounter;
     static int                byteTransferred;
     bool            timeRequest;
+
+    static std::vector<CachedTexture*> queue;   // highest priority first
+    static std::map<std::string, int> hostTransfers;
+    static int          transfers;
+    static int          maxTransfers;
+    static int          maxHostTransfers;
 };
 
 #endif
@@ -228,6 +228,10 @@ public:
 
     std::vector<std::string> getMaterialNames();
 
+    // Bumped when materials are deleted or rescanned, so anything
+    // caching per-material data knows to rebuild it
+    unsigned int getGeneration() const { return generation; }
+
     typedef std::set<std::string> TextureSet;
     void makeTextureList(TextureSet& set, bool referenced) const;
     void setTextureLocal(const std::string& url, const std::string& local);
@@ -246,6 +250,7 @@ private:
     int unnamedCount;   // Auto generate names for unnamed or duplicate named materials
     int duplicateNameCount;
     int unnamedAliasCount;
+    unsigned int generation = 0;
 };
 
 
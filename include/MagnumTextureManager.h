@@ -14,16 +14,25 @@
 
 #include <string>
 #include <map>
+#include <set>
 #include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 #include <Magnum/GL/Texture.h>
 #include <Corrade/PluginManager/Manager.h>
+#include <Corrade/Containers/ArrayView.h>
+#include <Corrade/Containers/Optional.h>
 #include <Corrade/Containers/Pointer.h>
 #include <Magnum/Trade/AbstractImporter.h>
+#include <Magnum/Trade/ImageData.h>
 #include <Magnum/Trade/AbstractImageConverter.h>
 
 #include "Magnum/GL/GL.h"
 #include "Singleton.h"
+#include "TextureCache.h"
 
 struct FileTextureInit
 {
@@ -45,6 +54,32 @@ typedef  struct
     TextureData data;
 } MagnumImageInfo;
 
+// Everything a decode thread needs to know about a texture; resolved
+// on the render thread since the cache and file managers aren't thread safe
+struct TextureDecodeJob
+{
+    std::string name;
+    std::string filename;
+    std::string fullPath;
+    // Packed resource data, empty if the texture comes from disk
+    Corrade::Containers::ArrayView<const char> packedData;
+    unsigned int generation;
+};
+
+// A decoded image waiting for its GL upload. With the texture cache
+// enabled it comes with a prebuilt mip chain instead, which may be
+// mapped straight from the cache file.
+struct DecodedTexture
+{
+    TextureDecodeJob job;
+    Corrade::Containers::Optional<Magnum::Trade::ImageData2D> image;
+    Corrade::Containers::Pointer<MipmappedImage> mipmaps;
+    unsigned int width = 0, height = 0;
+    bool hasAlpha = false;
+
+    bool isValid() const { return image || mipmaps; }
+};
+
 class MagnumTextureManager;
 
 struct MagnumProcTextureInit
@@ -62,6 +97,23 @@ public:
     //int getTextureID( const char* name, bool reportFail = true );
     TextureData getTexture(const char* name, bool reportFail = true);
 
+    // Like getTexture, but textures that aren't loaded yet are decoded on
+    // a background thread. A placeholder is returned right away, and the
+    // same texture object receives the real image once it is uploaded.
+    // If decoding fails the 1x1 white placeholder is kept as a fallback.
+    TextureData requestTexture(const char* name);
+    bool isPending(const std::string& name);
+
+    // Upload textures finished by the decode threads. Must be called
+    // from the render thread, returns the number of textures uploaded.
+    int processDecodedTextures(int maxUploads = -1);
+    // Block until every requested texture is decoded and uploaded
+    void waitForDecodedTextures();
+
+    // 0 decodes on the render thread from processDecodedTextures()
+    void setDecodeThreads(unsigned int count);
+    unsigned int getDecodeThreads() const;
+
     bool isLoaded(const std::string& name);
     bool removeTexture(const std::string& name);
     bool reloadTextures();
@@ -76,6 +128,15 @@ public:
 
     void updateTextureFilters();
 
+    // Bumped whenever a texture object is deleted, anyone caching the
+    // pointers from getTexture() or requestTexture() must look them up
+    // again once this changes
+    unsigned int getTextureGeneration() const { return textureGeneration; }
+
+    // Decodes a resolved job without touching GL or the managers, as the
+    // decode threads do. Each thread needs its own importer.
+    static bool decodeTexture( Magnum::Trade::AbstractImporter *decoder, DecodedTexture &decoded );
+
 protected:
     friend class Singleton<MagnumTextureManager>;
 
@@ -88,6 +149,15 @@ private:
     TextureData addTexture( std::string name, TextureData data );
     TextureData loadTexture( FileTextureInit &init, bool reportFail = true );
 
+    bool resolveTexture( FileTextureInit &init, TextureDecodeJob &job );
+    static void setupSampler( Magnum::GL::Texture2D &texture );
+    static void uploadTexture( Magnum::GL::Texture2D &texture, const DecodedTexture &decoded );
+    void finishDecodedTexture( DecodedTexture &decoded );
+
+    void startDecodeThreads();
+    void stopDecodeThreads();
+    void decodeThreadMain( Magnum::Trade::AbstractImporter *decoder );
+
     typedef std::map<std::string, MagnumImageInfo> TextureNameMap;
     typedef std::map<int, MagnumImageInfo*> TextureIDMap;
 
@@ -97,11 +167,26 @@ private:
     TextureNameMap textureNames;
 
     bool autoLoad;
+    unsigned int textureGeneration;
 
     Magnum::PluginManager::Manager<Magnum::Trade::AbstractImporter> manager;
     Corrade::Containers::Pointer<Magnum::Trade::AbstractImporter> importer;
     Magnum::PluginManager::Manager<Magnum::Trade::AbstractImageConverter> converterManager;
     Corrade::Containers::Pointer<Magnum::Trade::AbstractImageConverter> converter;
+
+    // Background decoding. The queues are shared with the decode threads
+    // and guarded by decodeMutex, everything else is render thread only.
+    unsigned int decodeThreadCount;
+    unsigned int decodeGeneration;
+    std::set<std::string> pendingTextures;
+    std::vector<std::thread> decodeThreads;
+    std::vector<Corrade::Containers::Pointer<Magnum::Trade::AbstractImporter>> decoders;
+    std::mutex decodeMutex;
+    std::condition_variable decodeWake;
+    std::condition_variable decodeDone;
+    std::deque<TextureDecodeJob> decodeQueue;
+    std::deque<DecodedTexture> decodedQueue;
+    bool stopDecoding;
 };
 
 
@@ -29,6 +29,7 @@
 #include "MagnumBZMaterial.h"
 
 class MeshDrawInfo;
+class MeshFaceBVH;
 
 class MeshObstacle : public Obstacle
 {
@@ -57,6 +58,11 @@ public:
     Obstacle* copyWithTransform(const MeshTransform&) const;
     void copyFace(int face, MeshObstacle* mesh) const;
 
+    // group instance copies share the transform invariant
+    // data (check types and texcoords) with their source
+    bool isCopy() const;
+    const MeshObstacle* getSource() const;
+
     void setName(const std::string& name);
     const std::string&  getName() const;
 
@@ -94,6 +100,8 @@ public:
     bool containsPoint(const float point[3]) const;
     bool containsPointNoOctree(const float point[3]) const;
 
+    size_t getFaceBVHMemory() const;
+
     const char *getCheckTypes() const;
     const afvec3 *getCheckPoints() const;
     afvec3 *getVertices() const;
@@ -121,10 +129,12 @@ public:
     void printOBJ(std::ostream& out, const std::string& indent) const;
 
 private:
+    bool hitsFace(const Ray& ray) const; // any hit at 0 < t <= 1
     void makeFacePointers(const std::vector<int>& _vertices,
                           const std::vector<int>& _normals,
                           const std::vector<int>& _texcoords,
                           float**& v, float**& n, float**& t);
+    void makeInstance(const MeshObstacle* source, const MeshTransform& xform);
 
 private:
     static const char* typeName;
@@ -149,6 +159,10 @@ private:
     // ray-vs-face tests and parity counts.
 
     MeshDrawInfo* drawInfo; // hidden data stored in extra texcoords
+
+    MeshFaceBVH* faceBVH; // built by finalize() for larger meshes
+
+    const MeshObstacle* source; // copy source, or NULL
 };
 
 inline const char *MeshObstacle::getCheckTypes() const
@@ -226,6 +240,16 @@ inline bool MeshObstacle::noClusters() const
     return noclusters;
 }
 
+inline bool MeshObstacle::isCopy() const
+{
+    return (source != NULL);
+}
+
+inline const MeshObstacle* MeshObstacle::getSource() const
+{
+    return source;
+}
+
 inline MeshDrawInfo* MeshObstacle::getDrawInfo() const
 {
     return drawInfo;
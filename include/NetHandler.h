@@ -185,6 +185,16 @@ public:
         return time;
     }
 
+    // Message bytes, headers included, since the connection was accepted
+    uint64_t  getBytesIn( void ) const
+    {
+        return bytesIn;
+    }
+    uint64_t  getBytesOut( void ) const
+    {
+        return bytesOut;
+    }
+
     /// Notify that the channel is going to be close.
     /// In the meantime any pwrite call will do nothing.
     /// Cannot be undone.
@@ -254,6 +264,8 @@ private:
     bool      acceptUDP;
     // time accepted
     TimeKeeper    time;
+    uint64_t  bytesIn;
+    uint64_t  bytesOut;
 #ifdef NETWORK_STATS
     // message stats bloat
     TimeKeeper    perSecondTime[2];
@@ -0,0 +1,83 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * pixel format conversion kernels
+ */
+
+#ifndef __PIXELCONVERT_H__
+#define __PIXELCONVERT_H__
+
+#include "common.h"
+
+/* system interface headers */
+#include <stddef.h>
+
+/** This namespace provides the pixel format conversions used when
+ * importing images, widening everything to 8 bit RGBA.  Each function
+ * has SSE2, SSSE3, AVX2 or NEON versions, with a scalar version that
+ * defines the exact result.  On x86 the best set the CPU supports is
+ * picked at run time, so a default build still gets the wider ones.
+ *
+ * Source and destination buffers must not overlap.
+ */
+namespace PixelConvert
+{
+enum InstructionSet
+{
+    Scalar = 0,
+    SSE2,
+    SSSE3,
+    AVX2,
+    NEON
+};
+
+/** r=g=b=gray, a=0xff */
+void grayToRGBA(const unsigned char* src, unsigned char* dst, size_t pixels);
+
+/** r=g=b=gray, a=alpha */
+void grayAlphaToRGBA(const unsigned char* src, unsigned char* dst, size_t pixels);
+
+/** copies rgb, a=0xff */
+void rgbToRGBA(const unsigned char* src, unsigned char* dst, size_t pixels);
+
+/** keeps the most significant byte of each 16 bit sample */
+void narrow16To8(const unsigned char* src, unsigned char* dst, size_t samples, bool bigEndian);
+
+/** interleaves one plane per channel into packed pixels */
+void interleavePlanes(const unsigned char* const* planes, int channels,
+                      unsigned char* dst, size_t pixels);
+
+/** returns true if any alpha value of an RGBA image is below 0xff */
+bool hasTranslucentPixel(const unsigned char* rgba, size_t pixels);
+
+/** the instruction set the kernels use */
+InstructionSet getInstructionSet();
+
+/** switches the kernels to another instruction set, for tests and
+ * benchmarks.  returns false if the build or the CPU can't run it.
+ * not thread safe.
+ */
+bool setInstructionSet(InstructionSet set);
+
+const char* getInstructionSetName(InstructionSet set);
+}
+
+#endif // __PIXELCONVERT_H__
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
@@ -48,6 +48,10 @@ public:
     void*   pack(void*, uint16_t& code);
     const void* unpack(const void*, uint16_t code);
 
+    // the fields that follow the motion, which of them depends on status
+    void*   packExtras(void*) const;
+    const void* unpackExtras(const void*);
+
     long    order;      // packet ordering
     short   status;     // see PStatus enum
     float   pos[3];     // position of tank
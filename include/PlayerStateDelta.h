@@ -0,0 +1,134 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * Delta encoding of relayed player updates (MsgPlayerUpdateDelta).
+ *
+ * The server numbers the updates it relays from each sender to each
+ * receiver, and the receiver acknowledges the ones it got with
+ * MsgPlayerUpdateAck.  Every update is bit packed against the newest
+ * acknowledged one, or sent whole when nothing recent was acknowledged.
+ *
+ * The message body, after the timestamp and player id:
+ *   uint8 sequence, uint8 base (== sequence for a full update),
+ *   uint8 byte count, bit packed fields, PlayerState extras
+ */
+
+#ifndef __PLAYERSTATEDELTA_H__
+#define __PLAYERSTATEDELTA_H__
+
+#include "common.h"
+
+/* common interface headers */
+#include "PlayerState.h"
+
+
+class PlayerStateDelta
+{
+public:
+    enum Field
+    {
+        Order = 0,
+        Status,
+        PosX, PosY, PosZ,
+        VelX, VelY, VelZ,
+        Azimuth,
+        AngVel,
+        FieldCount
+    };
+
+    // sent updates kept per sender and receiver
+    static const int HistorySize = 16;
+
+    // motion in the fixed point units the deltas are taken in
+    struct Quantized
+    {
+        int32_t field[FieldCount];
+    };
+
+    static void quantize(const PlayerState& state, Quantized& q);
+    // sets order, status and the motion of state
+    static void dequantize(const Quantized& q, PlayerState& state);
+
+    // a full update when base is NULL
+    static void* packFields(void* buf, const Quantized& q,
+                            const Quantized* base);
+    // NULL if the fields do not fit between buf and end
+    static const void* unpackFields(const void* buf, const void* end,
+                                    const Quantized* base, Quantized& q);
+};
+
+
+/** server side, the updates of one sender relayed to one receiver */
+class PlayerDeltaEncoder
+{
+public:
+    PlayerDeltaEncoder();
+
+    void    reset();
+    void    acknowledge(uint8_t sequence);
+
+    void*   pack(void* buf, const PlayerState& state);
+
+    bool    lastWasFull() const;
+
+private:
+    PlayerStateDelta::Quantized history[PlayerStateDelta::HistorySize];
+    int     sentCount;  // since reset, up to HistorySize
+    uint8_t nextSequence;
+    bool    haveAck;
+    uint8_t ackedSequence;
+    bool    lastFull;
+};
+
+
+/** client side, the updates received from one sender */
+class PlayerDeltaDecoder
+{
+public:
+    PlayerDeltaDecoder();
+
+    void    reset();
+
+    // buf follows the timestamp and id, NULL if the base update
+    // is not known here or the message is broken
+    const void* unpack(const void* buf, const void* end,
+                       PlayerState& state);
+
+    // the newest sequence not acknowledged yet
+    bool    getPendingAck(uint8_t& sequence);
+
+private:
+    PlayerStateDelta::Quantized history[PlayerStateDelta::HistorySize];
+    bool    valid[PlayerStateDelta::HistorySize];
+    uint8_t sequences[PlayerStateDelta::HistorySize];
+    bool    haveNewest;
+    uint8_t newestSequence;
+    bool    ackPending;
+};
+
+
+inline bool PlayerDeltaEncoder::lastWasFull() const
+{
+    return lastFull;
+}
+
+
+#endif /* __PLAYERSTATEDELTA_H__ */
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
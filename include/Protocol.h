@@ -92,6 +92,8 @@ const uint16_t      MsgPause = 0x7061;          // 'pa'
 const uint16_t      MsgPlayerInfo = 0x7062;         // 'pb'
 const uint16_t      MsgPlayerUpdate = 0x7075;       // 'pu'
 const uint16_t      MsgPlayerUpdateSmall = 0x7073;      // 'ps'
+const uint16_t      MsgPlayerUpdateDelta = 0x707a;      // 'pz'
+const uint16_t      MsgPlayerUpdateAck = 0x706b;        // 'pk'
 const uint16_t      MsgQueryGame = 0x7167;          // 'qg'
 const uint16_t      MsgQueryPlayers = 0x7170;       // 'qp'
 const uint16_t      MsgReject = 0x726a;         // 'rj'
@@ -247,6 +249,9 @@ player to server messages:
             -->
   MsgNegotiateFlags -->flagCount/[flagabbv]
   MsgPause      -->true or false
+  MsgPlayerUpdateAck    player asks for, and acknowledges, delta updates
+            (only when the server sets _deltaUpdates)
+            --> count, [sender-id, sequence]*
 
 server to player messages:
   MsgSuperKill      player must disconnect from server
@@ -261,6 +266,8 @@ server to player messages:
             <== <none>
   MsgAddPlayer      notification of new tank in game
             <== id, type, team, name, motto
+  MsgPlayerUpdateDelta  player update encoded against an acknowledged one
+            <-- timestamp, id, sequence, base, bits, extras
   MsgRemovePlayer   player has exited the server
             <== id
   MsgAdminInfo      update of players' IP addresses
@@ -0,0 +1,145 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * RadarGeometry:
+ *  The static obstacle outlines drawn on the radar, built once per
+ *  map.  Polygons are bucketed into a uniform grid and, within each
+ *  cell, merged into bands of equal height so the radar can pick a
+ *  color once per band and submit only the cells within range.
+ *  Nothing here touches GL.
+ */
+
+#ifndef BZF_RADAR_GEOMETRY_H
+#define BZF_RADAR_GEOMETRY_H
+
+#include "common.h"
+
+// system headers
+#include <vector>
+
+
+class RadarGeometry
+{
+public:
+    enum Layer
+    {
+        Buildings = 0,  // boxes and pyramids, triangles
+        Meshes,         // mesh faces, triangles
+        Outlines,       // box and pyramid edges, line pairs
+        LayerCount
+    };
+
+    struct Band
+    {
+        float   z;      // bottom of the band
+        float   height;
+        bool    death;
+        int     first;  // vertex index into getVertices()
+        int     count;
+    };
+
+    RadarGeometry();
+
+    void    clear();
+
+    // xy holds vertexCount x,y pairs in world coordinates. polygons
+    // must be convex, they are split into triangle fans.
+    void    addPolygon(Layer layer, const float* xy, int vertexCount,
+                       float z, float height, bool death = false);
+    void    addOutline(const float* xy, int vertexCount,
+                       float z, float height);
+
+    // bucket the added geometry, cellSize is in world units
+    void    finish(float cellSize);
+    bool    isFinished() const;
+
+    // the non-empty cells that may hold geometry inside the square
+    // of the given half size around center
+    void    queryCells(const float center[2], float halfSize,
+                       std::vector<int>& cells) const;
+
+    int     getCellCount() const;
+    const Band* getBands(int cell, Layer layer, int& count) const;
+    const float* getVertices(Layer layer) const;
+    int     getVertexCount(Layer layer) const;
+
+private:
+    struct Item
+    {
+        float   z, height;
+        bool    death;
+        int     first, count;
+        float   mins[2], maxs[2];
+        int     cell;
+    };
+
+    struct Cell
+    {
+        float   mins[2], maxs[2];   // bounds of the geometry in the cell
+        bool    empty;
+    };
+
+    void    addItem(Layer layer, int first, int count,
+                    float z, float height, bool death);
+    void    sortLayer(Layer layer);
+
+private:
+    bool    finished;
+
+    // staged geometry, released by finish()
+    std::vector<Item>   items[LayerCount];
+    std::vector<float>  staged[LayerCount];
+
+    std::vector<float>  vertices[LayerCount];
+    std::vector<Band>   bands[LayerCount];
+    // bands of cell c are [cellBands[c], cellBands[c + 1])
+    std::vector<int>    cellBands[LayerCount];
+
+    std::vector<Cell>   cells;
+    float   origin[2];
+    float   cellSize;
+    int     columns, rows;
+    int     spill;  // cells any geometry reaches past its own
+};
+
+
+inline bool RadarGeometry::isFinished() const
+{
+    return finished;
+}
+
+inline int RadarGeometry::getCellCount() const
+{
+    return (int)cells.size();
+}
+
+inline const float* RadarGeometry::getVertices(Layer layer) const
+{
+    return vertices[layer].empty() ? NULL : &vertices[layer][0];
+}
+
+inline int RadarGeometry::getVertexCount(Layer layer) const
+{
+    return (int)(vertices[layer].size() / 2);
+}
+
+
+#endif // BZF_RADAR_GEOMETRY_H
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
@@ -0,0 +1,141 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * Lock-free ring buffer for exactly one producer thread and one
+ * consumer thread.  Slots are filled and read in place, so large
+ * elements are never copied through the queue.
+ */
+
+#ifndef __SPSCQUEUE_H__
+#define __SPSCQUEUE_H__
+
+#include "common.h"
+
+/* system interface headers */
+#include <atomic>
+#include <stddef.h>
+#include <vector>
+
+
+template <class T>
+class SPSCQueue
+{
+public:
+    /** capacity is rounded up to a power of two */
+    explicit SPSCQueue(size_t capacity);
+
+    /** producer: the free slot to fill, NULL if the queue is full */
+    T*      beginPush();
+    /** producer: hand the slot from beginPush() to the consumer */
+    void    endPush();
+
+    /** consumer: the oldest element, NULL if the queue is empty */
+    T*      front();
+    /** consumer: release the slot returned by front() */
+    void    pop();
+
+    /** only exact when called while neither side is active */
+    size_t  size() const;
+    size_t  capacity() const;
+
+private:
+    SPSCQueue(const SPSCQueue&);
+    SPSCQueue& operator=(const SPSCQueue&);
+
+private:
+    std::vector<T>  slots;
+    size_t      mask;
+
+    // each index is written by one side only, keep them on separate
+    // cache lines along with that side's copy of the other index
+    alignas(64) std::atomic<size_t> head;   // next slot to read
+    size_t      cachedTail;         // consumer's view of tail
+    alignas(64) std::atomic<size_t> tail;   // next slot to write
+    size_t      cachedHead;         // producer's view of head
+};
+
+
+template <class T>
+SPSCQueue<T>::SPSCQueue(size_t _capacity) :
+    head(0), cachedTail(0), tail(0), cachedHead(0)
+{
+    size_t size = 2;
+    while (size < _capacity)
+        size <<= 1;
+    slots.resize(size);
+    mask = size - 1;
+}
+
+template <class T>
+inline T* SPSCQueue<T>::beginPush()
+{
+    const size_t t = tail.load(std::memory_order_relaxed);
+    if (t - cachedHead > mask)
+    {
+        cachedHead = head.load(std::memory_order_acquire);
+        if (t - cachedHead > mask)
+            return NULL;
+    }
+    return &slots[t & mask];
+}
+
+template <class T>
+inline void SPSCQueue<T>::endPush()
+{
+    tail.store(tail.load(std::memory_order_relaxed) + 1,
+               std::memory_order_release);
+}
+
+template <class T>
+inline T* SPSCQueue<T>::front()
+{
+    const size_t h = head.load(std::memory_order_relaxed);
+    if (h == cachedTail)
+    {
+        cachedTail = tail.load(std::memory_order_acquire);
+        if (h == cachedTail)
+            return NULL;
+    }
+    return &slots[h & mask];
+}
+
+template <class T>
+inline void SPSCQueue<T>::pop()
+{
+    head.store(head.load(std::memory_order_relaxed) + 1,
+               std::memory_order_release);
+}
+
+template <class T>
+inline size_t SPSCQueue<T>::size() const
+{
+    return tail.load(std::memory_order_acquire) -
+           head.load(std::memory_order_acquire);
+}
+
+template <class T>
+inline size_t SPSCQueue<T>::capacity() const
+{
+    return slots.size();
+}
+
+
+#endif // __SPSCQUEUE_H__
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
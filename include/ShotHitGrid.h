@@ -0,0 +1,88 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * ShotHitGrid:
+ *  Spatial hash of where shots can be during one frame, so each
+ *  local tank only runs the exact hit test against the shots that
+ *  pass near it.  Bounds are compared in x and y only.
+ */
+
+#ifndef __SHOTHITGRID_H__
+#define __SHOTHITGRID_H__
+
+#include "common.h"
+
+/* system interface headers */
+#include <vector>
+
+
+class ShotHitGrid
+{
+public:
+    ShotHitGrid(float cellSize = 20.0f);
+
+    void    clear();
+
+    // bbox is { mins, maxs }, a NULL bbox means the shot can hit anywhere
+    void    add(int id, const float (*bbox)[3]);
+
+    // ids of the shots whose bounds overlap bbox, in the order added
+    void    query(const float (*bbox)[3], std::vector<int>& ids) const;
+
+    int     size() const;
+
+private:
+    struct Entry
+    {
+        int     id;
+        bool    bounded;
+        float   mins[2], maxs[2];
+    };
+
+    struct Link
+    {
+        int     entry;
+        int     next;
+    };
+
+    int     bucket(int col, int row) const;
+    bool    overlaps(const Entry& entry, const float (*bbox)[3]) const;
+
+private:
+    float   cellSize;
+    std::vector<Entry>  entries;
+    std::vector<int>    buckets;    // first link, -1 when empty
+    std::vector<Link>   links;
+    std::vector<int>    unhashed;   // unbounded or spread over many cells
+
+    // entries already seen by the running query
+    mutable std::vector<unsigned int>   marks;
+    mutable unsigned int    mark;
+};
+
+
+inline int ShotHitGrid::size() const
+{
+    return (int)entries.size();
+}
+
+
+#endif /* __SHOTHITGRID_H__ */
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
@@ -226,6 +226,7 @@ public:
     static const std::string  BZDB_CULLDEPTH;
     static const std::string  BZDB_CULLELEMENTS;
     static const std::string  BZDB_CULLOCCLUDERS;
+    static const std::string  BZDB_DELTAUPDATES;
     static const std::string  BZDB_DISABLEBOTS;
     static const std::string  BZDB_DRAWCELESTIAL;
     static const std::string  BZDB_DRAWCLOUDS;
@@ -0,0 +1,98 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * Fast scanning of world files.  The helpers read straight from the
+ * stream buffer, bypassing the sentry and locale machinery of the
+ * formatted extractors, which dominated the parse time of large maps.
+ * They work on any std::istream, so WorldFileObject::read() keeps its
+ * signature, but they are fastest on a MemoryStream where every
+ * character is already in the get area.
+ */
+
+#ifndef __STREAMPARSE_H__
+#define __STREAMPARSE_H__
+
+#include "common.h"
+
+/* system interface headers */
+#include <istream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+
+/** Read-only stream buffer over memory owned by someone else */
+class MemoryStreamBuf : public std::streambuf
+{
+public:
+    MemoryStreamBuf(const char* data, size_t size);
+
+protected:
+    virtual pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                             std::ios_base::openmode which);
+    virtual pos_type seekpos(pos_type pos, std::ios_base::openmode which);
+};
+
+
+/** Input stream over a whole file held in memory.  Unlike an
+    std::istringstream the data is not copied again into the stream
+    buffer, pass it with std::move() to avoid any copy. */
+class MemoryStream : public std::istream
+{
+public:
+    explicit MemoryStream(std::string data);
+
+private:
+    std::string data;
+    MemoryStreamBuf buffer;
+};
+
+
+namespace StreamParse
+{
+/** read a whole file, false if it can not be opened or read */
+bool readFile(const std::string& filename, std::string& data);
+
+/** read the next token on the current line into buffer, it is empty at
+    the end of the line; the newline and the trailing white space are
+    left in the stream */
+void readToken(std::istream& input, char* buffer, int n);
+
+/** discard the rest of the current line including the newline */
+void skipLine(std::istream& input);
+
+/** like input >> value, but locale independent; fails on values too
+    large for a float */
+bool readFloat(std::istream& input, float& value);
+bool readFloats(std::istream& input, float* values, int count);
+
+/** read the integers up to the end of the line, the newline stays */
+void readIntList(std::istream& input, std::vector<int>& list);
+
+/** parse a decimal floating point number in [str, end) like strtod()
+    in the C locale; false if there is no number or it is too large
+    for a double.  next points behind the parsed characters. */
+bool parseFloat(const char* str, const char* end, double& value,
+                const char** next);
+}
+
+
+#endif // __STREAMPARSE_H__
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
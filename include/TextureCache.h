@@ -0,0 +1,145 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * on-disk cache of decoded, mipmapped textures
+ */
+
+#ifndef __TEXTURECACHE_H__
+#define __TEXTURECACHE_H__
+
+#include "common.h"
+
+/* system interface headers */
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+
+/* common interface headers */
+#include "Singleton.h"
+
+
+#define TEXCACHE (TextureCache::instance())
+
+
+/** A decoded 8 bit RGB or RGBA image together with its complete mip
+ * chain.  The pixels are kept in the same layout as the cache files,
+ * so an image built in memory can be written out as is, and a cached
+ * one is used straight from the file mapping.
+ */
+class MipmappedImage
+{
+public:
+    /** builds the mip chain from tightly packed rows */
+    MipmappedImage(int width, int height, int channels,
+                   const unsigned char* pixels, bool hasAlpha);
+    ~MipmappedImage();
+
+    int         getChannels() const;
+    bool        hasAlpha() const;
+    int         getLevelCount() const;
+    int         getWidth(int level = 0) const;
+    int         getHeight(int level = 0) const;
+    const unsigned char* getPixels(int level = 0) const;
+
+    const void* getData() const;
+    size_t      getSize() const;
+
+    static const int maxLevels = 16;
+
+private:
+    friend class TextureCache;
+    MipmappedImage();
+    MipmappedImage(const MipmappedImage&);
+    MipmappedImage& operator=(const MipmappedImage&);
+
+    bool        validate() const;
+    void        unmap();
+
+    unsigned char*  data;
+    size_t      size;
+    bool        mapped;
+#ifdef _WIN32
+    void*       fileHandle;
+    void*       mapHandle;
+#endif
+};
+
+
+/** Decoded textures keyed by the MD5 of their source image, so a warm
+ * texture is a single mmap() instead of a PNG inflate and a mip chain
+ * build.  The index works like the one of CacheManager, and the cache
+ * is trimmed to maxTextureCacheMB with the same oldest-used-first rule.
+ *
+ * loadIndex() must run on the main thread before the cache is used, it
+ * picks up the cache directory and size limit.  After that findTexture()
+ * and addTexture() may be called from any thread.
+ */
+class TextureCache : public Singleton<TextureCache>
+{
+public:
+    typedef struct
+    {
+        std::string key;
+        int size;
+        time_t usedDate;
+    } CacheRecord;
+
+    bool        loadIndex();
+    bool        saveIndex();
+    void        limitCacheSize();
+
+    /** false until loadIndex() ran, or if the size limit is zero */
+    bool        isEnabled() const;
+
+    static std::string getKey(const void* data, size_t size);
+    static bool readFile(const std::string& path, std::vector<char>& data);
+
+    /** maps the cached image, returns NULL if there is none */
+    MipmappedImage* findTexture(const std::string& key);
+    bool        addTexture(const std::string& key, const MipmappedImage& image);
+
+protected:
+    friend class Singleton<TextureCache>;
+
+private:
+    TextureCache();
+    ~TextureCache();
+
+    std::string getFileName(const std::string& key) const;
+    int         findRecord(const std::string& key) const;
+    void        removeRecord(int index);
+    void        rebuildKeyIndex();
+
+    mutable std::mutex mutex;
+    std::string cacheDir;
+    long long   maxSize;
+    bool        dirty;
+    unsigned int tempCount;
+    std::vector<CacheRecord> records;
+    std::unordered_map<std::string, int> keyIndex;
+};
+
+
+#endif // __TEXTURECACHE_H__
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
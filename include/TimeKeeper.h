@@ -69,6 +69,8 @@ public:
 
     /** sets the time to the current time (recalculates) */
     static void           setTick(void);
+    /** sets the time to a given time, used by fixed step simulations */
+    static void           setTick(const TimeKeeper& tick);
     /** returns a timekeeper that is updated periodically via setTick */
     static const TimeKeeper&  getTick(void); // const
 
@@ -0,0 +1,146 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * TrackRing:
+ *  A fixed number of track marks, oldest first.  Marks are made in
+ *  time order and all fade at the same rate, so they expire from the
+ *  front and a full ring simply reuses the oldest slot.  The marks in
+ *  each grid cell are also chained through their slots, so drawing
+ *  can skip whole cells.  Slots never move, callers may keep their
+ *  own data per slot.
+ */
+
+#ifndef __TRACKRING_H__
+#define __TRACKRING_H__
+
+#include "common.h"
+
+/* system interface headers */
+#include <vector>
+
+
+class TrackEntry
+{
+public:
+    float pos[3];
+    float angle;
+    float scale;
+    char sides;
+    int phydrv;
+    double birthTime; // when the mark was made
+    int cell;         // -1 once the mark has been dropped
+    int cellNext;     // ring slots of the marks in the same cell
+    int cellPrev;
+};
+
+
+class TrackRing
+{
+public:
+    TrackRing(int capacity);
+
+    void    clear();
+    // also clears the ring
+    void    setCellCount(int cells);
+
+    // returns the slot the mark went to
+    int     add(const TrackEntry& te, int cell);
+    void    expire(double now, float fadeTime);
+    void    drop(TrackEntry& te);           // before it fades
+    void    move(TrackEntry& te, int cell); // after its position changed
+
+    int     getCapacity() const;
+    int     getCount() const;
+    int     getMovingCount() const;
+    // i = 0 is the oldest mark
+    TrackEntry& get(int i);
+    int     getSlotOf(int i) const;
+    TrackEntry& getSlot(int slot);
+
+    int     getCellCount() const;
+    int     getCellHead(int cell) const;
+    // bounds of the mark centers in the cell, false when it is empty
+    bool    getCellBounds(int cell, float mins[3], float maxs[3]) const;
+
+private:
+    void    link(int slot, int cell);
+    void    unlink(int slot);
+    void    pop();
+
+    struct Cell
+    {
+        int     head;
+        int     count;
+        float   mins[3];    // reset when the cell empties
+        float   maxs[3];
+    };
+
+    std::vector<TrackEntry> entries;
+    std::vector<Cell>   cells;
+    int     capacity;
+    int     first;
+    int     count;
+    int     moving;
+};
+
+
+inline int TrackRing::getCapacity() const
+{
+    return capacity;
+}
+
+inline int TrackRing::getCount() const
+{
+    return count;
+}
+
+inline int TrackRing::getMovingCount() const
+{
+    return moving;
+}
+
+inline int TrackRing::getSlotOf(int i) const
+{
+    return (first + i) % capacity;
+}
+
+inline TrackEntry& TrackRing::get(int i)
+{
+    return entries[getSlotOf(i)];
+}
+
+inline TrackEntry& TrackRing::getSlot(int slot)
+{
+    return entries[slot];
+}
+
+inline int TrackRing::getCellCount() const
+{
+    return (int)cells.size();
+}
+
+inline int TrackRing::getCellHead(int cell) const
+{
+    return cells[cell].head;
+}
+
+
+#endif /* __TRACKRING_H__ */
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
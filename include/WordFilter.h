@@ -18,6 +18,8 @@
 /* system interface headers */
 #include <string>
 #include <set>
+#include <map>
+#include <vector>
 #include <algorithm>
 #include <string.h>
 
@@ -38,6 +40,107 @@
 #define MAX_FILTER_SETS 256
 
 
+/** WordFilterAutomaton folds every filter word and its l33t-speak
+ * expansions into a single trie that is walked as a nondeterministic
+ * automaton over the input.  One pass over a message yields the set of
+ * words whose expressions could possibly match it, so the aggressive
+ * filter only has to run regexec on those few candidates.
+ *
+ * The automaton is deliberately permissive: every string matched by a
+ * word's expression is accepted for that word, but not the other way
+ * around.  Words it cannot model (custom expressions, punctuation or
+ * non-ASCII characters) are always reported as candidates.
+ */
+class WordFilterAutomaton
+{
+public:
+
+    /** characters that may stand for one letter of a filter word */
+    typedef struct letterStruct
+    {
+        /** characters that can start the letter */
+        std::string match;
+        /** characters that can repeat the letter once started */
+        std::string repeat;
+    } letter_t;
+
+    WordFilterAutomaton(void);
+
+    /** registers a word that is stored in the given filter bin.  the
+     * letters describe the expansion of each character of the word;
+     * an empty letter list registers the word as always matching.
+     * returns the id of the word.
+     */
+    unsigned int addWord(unsigned char bin, const std::string &word,
+                         const std::vector<letter_t> &letters);
+
+    /** scans the input once and stores the ids of every word that
+     * might match it, sorted in filter order
+     */
+    void scan(const std::string &input, std::vector<unsigned int> &candidates) const;
+
+    /** stores the ids of every word, sorted in filter order */
+    void everyWord(std::vector<unsigned int> &candidates) const;
+
+    /** finds the first of the sorted candidates in the bin that comes
+     * after the given word, or the first in the bin if there is no word
+     */
+    std::vector<unsigned int>::const_iterator next(const std::vector<unsigned int> &candidates,
+            unsigned char bin, const std::string *after) const;
+
+    /** filter bin of a word id */
+    unsigned char getBin(unsigned int id) const;
+    /** word of a word id */
+    const std::string &getWord(unsigned int id) const;
+
+    /** removes all words */
+    void clear(void);
+
+private:
+
+    typedef struct nodeStruct
+    {
+        std::map<char, unsigned int> children;
+        std::string repeat;
+        std::vector<unsigned int> words;
+    } node_t;
+
+    typedef struct entryStruct
+    {
+        unsigned char bin;
+        std::string word;
+    } entry_t;
+
+    /** orders word ids the same way WordFilter orders its filter sets */
+    struct entryCompare
+    {
+        const std::vector<entry_t> &entries;
+        entryCompare(const std::vector<entry_t> &_entries) : entries(_entries) {}
+        bool operator() (unsigned int id1, unsigned int id2) const
+        {
+            if (entries[id1].bin != entries[id2].bin)
+                return entries[id1].bin < entries[id2].bin;
+            return (strncasecmp(entries[id1].word.c_str(), entries[id2].word.c_str(), 1024) < 0);
+        }
+    };
+
+    /** trie nodes, the root is always the first */
+    std::vector<node_t> nodes;
+
+    /** every registered word */
+    std::vector<entry_t> entries;
+
+    /** every word id, sorted in filter order */
+    std::vector<unsigned int> ordered;
+
+    /** words that are reported for every input */
+    std::vector<unsigned int> unindexed;
+
+    /** for each input character, the word letters it may stand for */
+    std::string alternates[256];
+};
+
+
 /** WordFilter will load a list of words and phrases from a file or one at
  * a time or manually.
  *
@@ -126,6 +229,16 @@ private:
     // XXX consider making a numeric hash to avoid array overflows
     ExpCompareSet filters[MAX_FILTER_SETS];
 
+    /** every word of the filter sets compiled into one automaton that
+     * preselects the expressions worth running on an input
+     */
+    WordFilterAutomaton automaton;
+
+    /** when off, every expression is evaluated as it was before the
+     * automaton.  only useful for checking the automaton.
+     */
+    bool preselect;
+
 
     /** used by the agressive filter */
     ExpCompareSet suffixes;
@@ -199,6 +312,16 @@ protected:
      */
     std::string expressionFromString(const std::string &word) const;
 
+    /** the words worth running the expressions of on the input */
+    void findCandidates(const std::string &input, std::vector<unsigned int> &candidates) const;
+
+    /** expands a word into the per-letter character sets used by the
+     *  automaton.  returns false if the word cannot be expressed that
+     *  way, in which case the expression is always evaluated.
+     */
+    bool lettersFromString(const std::string &word,
+                           std::vector<WordFilterAutomaton::letter_t> &letters) const;
+
 
 public:
 
@@ -222,6 +345,8 @@ public:
     void outputWords(void) const;
     /** dump the filter to stdout (including expressions) */
     void outputFilter(void) const;
+    /** turns the automaton preselection of expressions on or off */
+    void setPreselect(bool enabled);
     /** retuns a count of how many words are in the filter */
     unsigned long int wordCount(void) const;
 
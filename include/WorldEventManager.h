@@ -79,6 +79,8 @@ public:
     void callEvents ( bz_eEventType eventType, bz_EventData   *eventData );
     void callEvents ( bz_EventData    *eventData );
 
+    bool hasHandlers ( bz_eEventType eventType );
+
 private:
     tvEventList eventList;
 
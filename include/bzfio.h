@@ -19,6 +19,8 @@
 
 #include "common.h"
 
+#include <string>
+
 void setDebugTimestamp (bool enable, bool doMicros, bool utc);
 void logDebugMessage(int level, const char* fmt, ...);
 
@@ -28,8 +30,50 @@ public:
     virtual ~LoggingCallback() {};
 
     virtual void log ( int level, const char* message ) = 0;
+
+    // messages at levels nobody wants are not even formatted
+    virtual bool wantsLevel ( int /* level */ )
+    {
+        return true;
+    }
+};
+
+/** How the background log writer outputs.  With it running, console
+ *  lines are formatted on the calling thread and queued, a writer
+ *  thread does the slow part.  The logging callback is still called
+ *  on the calling thread.
+ */
+struct LogSettings
+{
+    enum Format
+    {
+        TextFormat,     // the usual console lines
+        JSONFormat,     // one JSON object per line
+        BinaryFormat    // length prefixed records, see bzfio.cxx
+    };
+
+    // what to do with a line when the queue is full
+    enum Overflow
+    {
+        BlockOnFull,    // wait for the writer to make room
+        DropOnFull,     // discard it, the writer reports how many went
+        DirectOnFull    // write it from the calling thread, out of order
+    };
+
+    LogSettings();
+
+    std::string filename;   // empty for stdout
+    Format  format;
+    Overflow    overflow;
+    int     queueSize;  // lines, rounded up to a power of two
+    long    rotateSize; // bytes per file before rotating, 0 for never
+    int     rotateCount;    // rotated files kept, name.1 is the newest
 };
 
+bool startAsyncLogging(const LogSettings& settings);
+// writes out whatever is still queued, also run at exit
+void stopAsyncLogging();
+
 extern LoggingCallback  *loggingCallback;
 
 /* egcs headers on linux define NULL as (void*)0.  that's a no no in C++. */
@@ -1649,6 +1649,26 @@ public:
     bz_ApiString motto;
 };
 
+// read-only player snapshot filled into caller storage, nothing is
+// allocated. flagAbbv points at server data and is only good until the
+// plugin returns control to the server.
+typedef struct bz_PlayerStateView
+{
+    int           playerID;
+    bz_eTeamType      team;
+    bool          spawned;        // alive in the world
+    int           flagID;         // -1 when not carrying a flag
+    const char*       flagAbbv;       // NULL when not carrying a flag
+    double        lastUpdateTime;     // when the last state arrived
+    bz_PlayerUpdateState  state;
+} bz_PlayerStateView;
+
+BZF_API bool bz_getPlayerStateView ( int playerID, bz_PlayerStateView *view );
+
+// fills up to maxViews views with the players in the game, in slot
+// order, and returns how many were written
+BZF_API int bz_getPlayerStateViews ( bz_PlayerStateView *views, int maxViews );
+
 // player info
 BZF_API bool bz_getPlayerHumanity( int playerId );
 
@@ -2020,6 +2040,20 @@ BZF_API void bz_getRandomPoint ( bz_CustomZoneObject *obj, float *randomPos );
 BZF_API bool bz_getSpawnPointWithin ( bz_CustomZoneObject *obj, float randomPos[3] );
 BZF_API bool bz_isWithinWorldBoundaries ( float pos[3] );
 
+// spatial queries over the spawned players, and over the flags lying on
+// the ground or carried by a tank. matching ids are written to caller
+// storage in ascending order; the return value is the number of matches
+// and can be larger than maxIDs. flag positions are sampled once a tick.
+BZF_API int bz_getPlayersInRadius ( const float pos[3], float radius, int *playerIDs, int maxIDs );
+BZF_API int bz_getPlayersInBox ( const float mins[3], const float maxs[3], int *playerIDs, int maxIDs );
+BZF_API int bz_getPlayersInZone ( bz_CustomZoneObject *zone, int *playerIDs, int maxIDs );
+BZF_API int bz_getFlagsInRadius ( const float pos[3], float radius, int *flagIDs, int maxIDs );
+BZF_API int bz_getFlagsInZone ( bz_CustomZoneObject *zone, int *flagIDs, int maxIDs );
+
+// the closest spawned foe of playerID, -1 if there is none within
+// maxDistance. zero or less searches the whole world.
+BZF_API int bz_getNearestEnemy ( int playerID, float maxDistance = 0.0f );
+
 class bz_CustomMapObjectHandler
 {
 public:
@@ -41,6 +41,18 @@ public:
         ModifiedSince
     };
 
+    // per transfer timings, in seconds from the start of the transfer
+    struct TransferTimes
+    {
+        double nameLookup;
+        double connect;
+        double appConnect;      // TLS handshake done, 0 for plain http
+        double startTransfer;   // first byte
+        double total;
+        long   connects;        // new connections made, 0 if one was reused
+        long   httpVersion;     // 10, 11, 20 or 30, 0 if unknown
+    };
+
     void addHandle();
     void removeHandle();
 
@@ -57,11 +69,18 @@ public:
     void setInterface(const std::string &interfaceIP);
     void setUserAgent(const std::string &userAgent);
     void setDNSCachingTime(long time);
+    // keep the connection open for the next transfer to the same host,
+    // and multiplex over HTTP/2 when the server offers it
+    void setConnectionReuse(bool reuse);
+
+    // bound the connections opened by all the handles together
+    static void setConnectionLimits(long maxPerHost, long maxTotal);
 
     void addFormData(const char *key, const char *value);
 
     bool getFileTime(time_t &t);
     bool getFileSize(double &size);
+    bool getTransferTimes(TransferTimes &times);
 
     virtual void collectData(char *ptr, int len);
     virtual void finalization(char *data, unsigned int length, bool good);
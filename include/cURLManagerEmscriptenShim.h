@@ -31,6 +31,17 @@ public:
         ModifiedSince
     };
 
+    struct TransferTimes
+    {
+        double nameLookup;
+        double connect;
+        double appConnect;
+        double startTransfer;
+        double total;
+        long   connects;
+        long   httpVersion;
+    };
+
     void addHandle();
     void removeHandle();
 
@@ -47,11 +58,15 @@ public:
     void setInterface(const std::string &interfaceIP);
     void setUserAgent(const std::string &userAgent);
     void setDNSCachingTime(long time);
+    void setConnectionReuse(bool reuse);
+
+    static void setConnectionLimits(long maxPerHost, long maxTotal);
 
     void addFormData(const char *key, const char *value);
 
     bool getFileTime(time_t &t);
     bool getFileSize(double &size);
+    bool getTransferTimes(TransferTimes &times);
 
     virtual void collectData(char *ptr, int len);
     virtual void finalization(char *data, unsigned int length, bool good);
@@ -0,0 +1,130 @@
+#!/usr/bin/env python3
+#
+# World file parser benchmark.
+#
+# Generates a large map of boxes, pyramids, zones and meshes and times
+# how long bzfs needs to load it.  bzfs is run with -cacheout so it exits
+# right after the world is built, and the phase timings it prints at
+# debug level 3 are collected from its output.
+#
+# Example of use:
+#
+#   misc/bzwbench.py --bzfs build/src/bzfs/bzfs --boxes 200000 --meshes 2000
+#
+# Pass --keep to leave the generated map behind, for the map viewer or
+# for comparing two builds on the same input.
+#
+
+import argparse
+import os
+import random
+import re
+import subprocess
+import sys
+import tempfile
+import time
+
+
+def writeMap(out, args):
+    rnd = random.Random(args.seed)
+    half = args.size / 2.0
+
+    out.write('world\n  size %g\nend\n\n' % half)
+
+    for i in range(args.boxes):
+        kind = 'box' if i % 4 else 'pyramid'
+        out.write('%s\n' % kind)
+        out.write('  position %.4f %.4f %.4f\n' % (rnd.uniform(-half, half),
+                                                   rnd.uniform(-half, half),
+                                                   rnd.uniform(0.0, 40.0)))
+        out.write('  rotation %.3f\n' % rnd.uniform(0.0, 360.0))
+        out.write('  size %.3f %.3f %.3f\n' % (rnd.uniform(1.0, 10.0),
+                                               rnd.uniform(1.0, 10.0),
+                                               rnd.uniform(1.0, 10.0)))
+        out.write('end\n\n')
+
+    # square grid meshes, each with a face per grid cell
+    side = max(2, int(args.vertices ** 0.5))
+    for i in range(args.meshes):
+        cx = rnd.uniform(-half, half)
+        cy = rnd.uniform(-half, half)
+        out.write('mesh\n')
+        for y in range(side):
+            for x in range(side):
+                out.write('  vertex %.5f %.5f %.5f\n' % (cx + x, cy + y,
+                                                         rnd.uniform(0.0, 2.0)))
+        for y in range(side):
+            for x in range(side):
+                out.write('  texcoord %.5f %.5f\n' % (x / float(side),
+                                                      y / float(side)))
+        for y in range(side - 1):
+            for x in range(side - 1):
+                a = y * side + x
+                out.write('  face\n')
+                out.write('    vertices %i %i %i %i\n' % (a, a + 1, a + side + 1, a + side))
+                out.write('    texcoords %i %i %i %i\n' % (a, a + 1, a + side + 1, a + side))
+                out.write('  endface\n')
+        out.write('end\n\n')
+
+    for i in range(args.zones):
+        out.write('zone\n  position %.3f %.3f 0\n  size 10 10 5\n  flag GM\nend\n\n'
+                  % (rnd.uniform(-half, half), rnd.uniform(-half, half)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='bzfs world parser benchmark')
+    parser.add_argument('--bzfs', default='bzfs', help='bzfs executable')
+    parser.add_argument('--boxes', type=int, default=100000)
+    parser.add_argument('--meshes', type=int, default=1000)
+    parser.add_argument('--vertices', type=int, default=400,
+                        help='vertices per mesh')
+    parser.add_argument('--zones', type=int, default=100)
+    parser.add_argument('--size', type=float, default=4000.0,
+                        help='world size')
+    parser.add_argument('--runs', type=int, default=3)
+    parser.add_argument('--port', type=int, default=5199)
+    parser.add_argument('--seed', type=int, default=1)
+    parser.add_argument('--keep', action='store_true',
+                        help='keep the generated map')
+    args = parser.parse_args()
+
+    mapFile = tempfile.NamedTemporaryFile('w', suffix='.bzw', delete=False)
+    cacheFile = mapFile.name + '.cache'
+    start = time.time()
+    writeMap(mapFile, args)
+    mapFile.close()
+    size = os.path.getsize(mapFile.name)
+    print('generated %s: %.1f MB in %.1f s' % (mapFile.name, size / 1e6,
+                                              time.time() - start))
+
+    phase = re.compile(r'^(.*): ([0-9.]+) seconds$')
+    try:
+        for run in range(args.runs):
+            command = [args.bzfs, '-d', '-d', '-d', '-p', str(args.port),
+                       '-cacheout', cacheFile, '-world', mapFile.name]
+            start = time.time()
+            result = subprocess.run(command, stdout=subprocess.PIPE,
+                                    stderr=subprocess.STDOUT,
+                                    universal_newlines=True)
+            elapsed = time.time() - start
+            if result.returncode != 0:
+                sys.stdout.write(result.stdout)
+                print('bzfs failed with exit code %i' % result.returncode)
+                return 1
+
+            print('run %i: %.3f s total' % (run + 1, elapsed))
+            for line in result.stdout.splitlines():
+                match = phase.match(line.strip())
+                if match:
+                    print('  %-28s %8.3f s' % (match.group(1), float(match.group(2))))
+    finally:
+        if not args.keep:
+            os.unlink(mapFile.name)
+        if os.path.exists(cacheFile):
+            os.unlink(cacheFile)
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
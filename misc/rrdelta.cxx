@@ -0,0 +1,440 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+
+//  RRDELTA
+//
+//  This program replays the player updates of a record file
+//  through the MsgPlayerUpdateDelta encoding, over a simulated
+//  lossy link, and reports the bandwidth each player would save.
+//
+
+// system headers
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <deque>
+#include <vector>
+
+// common headers
+#include "common.h"
+#include "Pack.h"
+#include "PlayerState.h"
+#include "PlayerStateDelta.h"
+#include "Protocol.h"
+#include "version.h"
+
+// bzfs headers
+#include "RecordReplay.h"
+
+
+// Function Prototypes
+// -------------------
+
+static void printHelp(const char* execName);
+static bool loadHeader(ReplayHeader *h, FILE *f);
+static RRpacket *loadPacket(FILE *f);
+static const void *nboUnpackRRtime(const void *buf, RRtime& value);
+
+
+int debugLevel = 0;
+
+// bytes of a MsgPlayerUpdateAck besides the acks
+static const int ackMessageBytes = 4 + 1;
+
+
+struct Ack
+{
+    RRtime arrival;
+    int receiver;
+    int sender;
+    uint8_t sequence;
+};
+
+struct Receiver
+{
+    bool present;
+    RRtime joined;
+    double seconds;
+    double fullBytes;
+    double deltaBytes;
+    double ackBytes;
+    int updates;
+    int fullUpdates;
+    int lostUpdates;
+    int undecodable;
+    RRtime nextAckTime;
+    std::vector<PlayerDeltaEncoder> encoders; // by sender, server side
+    std::vector<PlayerDeltaDecoder> decoders; // by sender, client side
+};
+
+
+/****************************************************************************/
+
+int main(int argc, char** argv)
+{
+    const char* execName = argv[0];
+    double lossRate = 0.0;
+    double latency = 0.1;
+    double ackRate = 30.0;
+    unsigned int seed = 1;
+
+    while (argc > 1)
+    {
+        if (strcmp("-h", argv[1]) == 0)
+        {
+            printHelp(execName);
+            exit(0);
+        }
+        else if ((argc > 2) && (strcmp("-l", argv[1]) == 0))
+            lossRate = atof(argv[2]) / 100.0;
+        else if ((argc > 2) && (strcmp("-d", argv[1]) == 0))
+            latency = atof(argv[2]) / 1000.0;
+        else if ((argc > 2) && (strcmp("-a", argv[1]) == 0))
+            ackRate = atof(argv[2]);
+        else if ((argc > 2) && (strcmp("-s", argv[1]) == 0))
+            seed = (unsigned int)atoi(argv[2]);
+        else
+            break;
+        argc -= 2;
+        argv += 2;
+    }
+
+    if ((argc < 2) || (ackRate <= 0.0))
+    {
+        printHelp(execName);
+        exit(1);
+    }
+    srand(seed);
+
+    FILE *file = fopen(argv[1], "rb");
+    if (file == NULL)
+    {
+        perror("fopen");
+        exit(1);
+    }
+    ReplayHeader header;
+    if (!loadHeader(&header, file))
+    {
+        printf("Couldn't load file header\n");
+        fclose(file);
+        exit(1);
+    }
+
+    printf("\nRRDELTA-%s\n", getAppVersion());
+    printf("loss: %.1f%%  latency: %.0f ms  acks: %.0f/sec\n\n",
+           lossRate * 100.0, latency * 1000.0, ackRate);
+
+    std::vector<Receiver> receivers(256);
+    for (size_t i = 0; i < receivers.size(); i++)
+    {
+        Receiver& r = receivers[i];
+        r.present = false;
+        r.joined = 0;
+        r.seconds = r.fullBytes = r.deltaBytes = r.ackBytes = 0.0;
+        r.updates = r.fullUpdates = r.lostUpdates = r.undecodable = 0;
+        r.nextAckTime = 0;
+    }
+
+    const RRtime ackInterval = (RRtime)(1000000.0 / ackRate);
+    const RRtime ackDelay = (RRtime)(latency * 1000000.0);
+    std::deque<Ack> acksInFlight;
+    std::vector<Ack> acksPending;
+    int mismatches = 0;
+    RRtime now = 0;
+
+    RRpacket *p;
+    while ((p = loadPacket(file)) != NULL)
+    {
+        now = p->timestamp;
+        const bool real = (p->mode == RealPacket);
+
+        if (((p->code == MsgAddPlayer) || (p->code == MsgRemovePlayer)) &&
+                (p->len >= 1) && (real || (p->mode == StatePacket)))
+        {
+            uint8_t id;
+            nboUnpackUByte(p->data, id);
+            Receiver& r = receivers[id];
+            if (r.present)
+                r.seconds += (double)(now - r.joined) / 1000000.0;
+            r.present = (p->code == MsgAddPlayer);
+            r.joined = now;
+            r.encoders.clear();
+            r.decoders.clear();
+            // the slot is someone else now
+            for (size_t i = 0; i < receivers.size(); i++)
+            {
+                if (id < receivers[i].encoders.size())
+                {
+                    receivers[i].encoders[id].reset();
+                    receivers[i].decoders[id].reset();
+                }
+            }
+        }
+
+        // the clients send their acks once per frame
+        for (size_t i = 0; i < receivers.size(); i++)
+        {
+            Receiver& r = receivers[i];
+            if (!r.present || (r.nextAckTime > now))
+                continue;
+            r.nextAckTime = now + ackInterval;
+            int count = 0;
+            for (size_t s = 0; s < r.decoders.size(); s++)
+            {
+                Ack ack;
+                if (!r.decoders[s].getPendingAck(ack.sequence))
+                    continue;
+                ack.arrival = now + ackDelay;
+                ack.receiver = (int)i;
+                ack.sender = (int)s;
+                acksPending.push_back(ack);
+                count++;
+            }
+            if (count == 0)
+                continue;
+            r.ackBytes += ackMessageBytes + 2 * count;
+            const bool lost = (rand() < lossRate * RAND_MAX);
+            if (!lost)
+                acksInFlight.insert(acksInFlight.end(), acksPending.begin(), acksPending.end());
+            acksPending.clear();
+        }
+        while (!acksInFlight.empty() && (acksInFlight.front().arrival <= now))
+        {
+            const Ack& ack = acksInFlight.front();
+            Receiver& r = receivers[ack.receiver];
+            if (ack.sender < (int)r.encoders.size())
+                r.encoders[ack.sender].acknowledge(ack.sequence);
+            acksInFlight.pop_front();
+        }
+
+        if (real && ((p->code == MsgPlayerUpdate) ||
+                     (p->code == MsgPlayerUpdateSmall)))
+        {
+            float timestamp;
+            uint8_t sender;
+            PlayerState state;
+            const void *buf = p->data;
+            buf = nboUnpackFloat(buf, timestamp);
+            buf = nboUnpackUByte(buf, sender);
+            state.unpack(buf, p->code);
+
+            PlayerStateDelta::Quantized sent;
+            PlayerStateDelta::quantize(state, sent);
+
+            for (size_t i = 0; i < receivers.size(); i++)
+            {
+                Receiver& r = receivers[i];
+                if (!r.present || (i == sender))
+                    continue;
+                if (sender >= r.encoders.size())
+                {
+                    r.encoders.resize(sender + 1);
+                    r.decoders.resize(sender + 1);
+                }
+
+                char delta[MaxPacketLen];
+                char *end = (char*)r.encoders[sender].pack(delta, state);
+                r.updates++;
+                r.fullBytes += 4 + p->len;
+                r.deltaBytes += 4 + 4 + 1 + (end - delta);
+                if (r.encoders[sender].lastWasFull())
+                    r.fullUpdates++;
+
+                if (rand() < lossRate * RAND_MAX)
+                {
+                    r.lostUpdates++;
+                    continue;
+                }
+                PlayerState received;
+                if (r.decoders[sender].unpack(delta, end, received) == NULL)
+                {
+                    r.undecodable++;
+                    continue;
+                }
+                PlayerStateDelta::Quantized got;
+                PlayerStateDelta::quantize(received, got);
+                if (memcmp(&got, &sent, sizeof(got)) != 0)
+                    mismatches++;
+            }
+        }
+
+        delete[] p->data;
+        delete p;
+    }
+    fclose(file);
+    delete[] header.world;
+    delete[] header.flags;
+
+    printf("player  seconds  updates  full  lost  undecodable"
+           "  bytes/sec  delta  acks  saved/sec\n");
+    double totalSeconds = 0.0, totalFull = 0.0, totalDelta = 0.0, totalAcks = 0.0;
+    for (size_t i = 0; i < receivers.size(); i++)
+    {
+        Receiver& r = receivers[i];
+        if (r.present)
+            r.seconds += (double)(now - r.joined) / 1000000.0;
+        if ((r.updates == 0) || (r.seconds <= 0.0))
+            continue;
+        const double full = r.fullBytes / r.seconds;
+        const double delta = r.deltaBytes / r.seconds;
+        const double acks = r.ackBytes / r.seconds;
+        printf("%6i  %7.0f  %7i  %4i  %4i  %11i  %9.0f  %5.0f  %4.0f  %9.0f\n",
+               (int)i, r.seconds, r.updates, r.fullUpdates, r.lostUpdates,
+               r.undecodable, full, delta, acks, full - delta - acks);
+        totalSeconds += r.seconds;
+        totalFull += r.fullBytes;
+        totalDelta += r.deltaBytes;
+        totalAcks += r.ackBytes;
+    }
+
+    if (totalSeconds > 0.0)
+    {
+        const double saved = totalFull - totalDelta - totalAcks;
+        printf("\naverage per player: %.0f bytes/sec saved of %.0f (%.1f%%),"
+               " %.0f of them downstream\n",
+               saved / totalSeconds, totalFull / totalSeconds,
+               totalFull > 0.0 ? 100.0 * saved / totalFull : 0.0,
+               (totalFull - totalDelta) / totalSeconds);
+    }
+    else
+        printf("no player updates found\n");
+    if (mismatches)
+        printf("WARNING: %i updates decoded differently\n", mismatches);
+
+    return 0;
+}
+
+/****************************************************************************/
+
+static void printHelp(const char* execName)
+{
+    printf("usage:\t%s [options] <filename>\n\n", execName);
+    printf("  -h	  : print help\n");
+    printf("  -l <percent>  : packet loss, both ways (default 0)\n");
+    printf("  -d <ms>       : delay before acks reach the server (default 100)\n");
+    printf("  -a <rate>     : acks sent per second (default 30)\n");
+    printf("  -s <seed>     : random seed for the losses\n");
+    printf("\n");
+    return;
+}
+
+/****************************************************************************/
+
+static bool loadHeader(ReplayHeader *h, FILE *f)
+{
+    char buffer[ReplayHeaderSize];
+    const void *buf;
+
+    if (fread(buffer, ReplayHeaderSize, 1, f) <= 0)
+        return false;
+
+    buf = nboUnpackUInt(buffer, h->magic);
+    buf = nboUnpackUInt(buf, h->version);
+    buf = nboUnpackUInt(buf, h->offset);
+    buf = nboUnpackRRtime(buf, h->filetime);
+    buf = nboUnpackUInt(buf, h->player);
+    buf = nboUnpackUInt(buf, h->flagsSize);
+    buf = nboUnpackUInt(buf, h->worldSize);
+    buf = nboUnpackString(buf, h->callSign, sizeof(h->callSign));
+    buf = nboUnpackString(buf, h->motto, sizeof(h->motto));
+    buf = nboUnpackString(buf, h->ServerVersion, sizeof(h->ServerVersion));
+    buf = nboUnpackString(buf, h->appVersion, sizeof(h->appVersion));
+    buf = nboUnpackString(buf, h->realHash, sizeof(h->realHash));
+
+    // load the flags, if there are any
+    if (h->flagsSize > 0)
+    {
+        h->flags = new char [h->flagsSize];
+        if (fread(h->flags, h->flagsSize, 1, f) == 0)
+            return false;
+    }
+    else
+        h->flags = NULL;
+
+    // load the world database
+    h->world = new char [h->worldSize];
+    if (fread(h->world, h->worldSize, 1, f) == 0)
+        return false;
+
+    return true;
+}
+
+/****************************************************************************/
+
+static RRpacket* loadPacket(FILE *f)
+{
+    RRpacket *p;
+    char bufStart[RRpacketHdrSize];
+    const void *buf;
+
+    if (f == NULL)
+        return NULL;
+
+    p = new RRpacket;
+
+    if (fread(bufStart, RRpacketHdrSize, 1, f) <= 0)
+    {
+        delete p;
+        return NULL;
+    }
+    buf = nboUnpackUShort(bufStart, p->mode);
+    buf = nboUnpackUShort(buf, p->code);
+    buf = nboUnpackUInt(buf, p->len);
+    buf = nboUnpackUInt(buf, p->nextFilePos);
+    buf = nboUnpackUInt(buf, p->prevFilePos);
+    buf = nboUnpackRRtime(buf, p->timestamp);
+
+    if (p->len > (MaxPacketLen - ((int)sizeof(u16) * 2)))
+    {
+        fprintf(stderr, "loadPacket: ERROR, packtlen = %i\n", p->len);
+        delete p;
+        return NULL;
+    }
+
+    if (p->len == 0)
+        p->data = NULL;
+    else
+    {
+        char *d = new char [p->len];
+        if (fread(d, p->len, 1, f) <= 0)
+        {
+            delete[] d;
+            delete p;
+            return NULL;
+        }
+        p->data = d;
+    }
+
+    return p;
+}
+
+/****************************************************************************/
+
+static const void* nboUnpackRRtime(const void *buf, RRtime& value)
+{
+    u32 msb, lsb;
+    buf = nboUnpackUInt(buf, msb);
+    buf = nboUnpackUInt(buf, lsb);
+    value = ((RRtime)msb << 32) + (RRtime)lsb;
+    return buf;
+}
+
+/****************************************************************************/
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
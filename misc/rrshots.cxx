@@ -0,0 +1,562 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+
+//  RRSHOTS
+//
+//  This program replays the shots and tank motion of a record file
+//  frame by frame, and times the client's shot hit tests for every
+//  tank: once against every live shot, and once through the
+//  ShotHitGrid.  Shots fly straight, the world's obstacles are not
+//  loaded, so ricochets and teleports are not followed.
+//
+
+// system headers
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+// common headers
+#include "common.h"
+#include "Pack.h"
+#include "PlayerState.h"
+#include "Protocol.h"
+#include "ShotHitGrid.h"
+#include "ShotUpdate.h"
+#include "TimeKeeper.h"
+#include "version.h"
+
+// bzfs headers
+#include "RecordReplay.h"
+
+
+// Function Prototypes
+// -------------------
+
+static void printHelp(const char* execName);
+static bool loadHeader(ReplayHeader *h, FILE *f);
+static RRpacket *loadPacket(FILE *f);
+static const void *nboUnpackRRtime(const void *buf, RRtime& value);
+
+
+int debugLevel = 0;
+
+// the default tank and shot dimensions
+static const float tankRadius = 0.72f * 6.0f;
+static const float tankHeight = 2.05f;
+static const float shotRadius = 0.5f;
+
+
+struct Tank
+{
+    bool present;
+    bool alive;
+    RRtime updated;
+    float pos[3];
+    float vel[3];
+    // this frame
+    float origin[3];
+    float bbox[2][3];
+};
+
+struct Shot
+{
+    int player;
+    int id;
+    RRtime fired;
+    float pos[3];
+    float vel[3];
+    float lifetime;
+    // the whole flight, like a shot path segment's
+    float pathBBox[2][3];
+    // this frame
+    float bbox[2][3];
+};
+
+struct Totals
+{
+    double seconds;
+    long tests;
+    long hits;
+};
+
+
+static bool overlaps(const float (*a)[3], const float (*b)[3])
+{
+    for (int i = 0; i < 3; i++)
+    {
+        if ((a[1][i] < b[0][i]) || (a[0][i] > b[1][i]))
+            return false;
+    }
+    return true;
+}
+
+
+// what SegmentedShotStrategy::checkHit() does for one straight segment
+static bool checkHit(const Tank& tank, const Shot& shot, float prev, float dt)
+{
+    if (!overlaps(shot.pathBBox, tank.bbox))
+        return false;
+
+    float o[3], d[3];
+    for (int i = 0; i < 3; i++)
+    {
+        o[i] = (shot.pos[i] + shot.vel[i] * prev) - tank.origin[i];
+        d[i] = shot.vel[i] - tank.vel[i];
+    }
+    o[2] -= 0.5f * tankHeight;
+
+    // closest approach during the frame
+    const float dd = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+    float t = 0.0f;
+    if (dd > 0.0f)
+        t = -(o[0] * d[0] + o[1] * d[1] + o[2] * d[2]) / dd;
+    if (t < 0.0f)
+        t = 0.0f;
+    else if (t > dt)
+        t = dt;
+    float r2 = 0.0f;
+    for (int i = 0; i < 3; i++)
+        r2 += (o[i] + t * d[i]) * (o[i] + t * d[i]);
+    return r2 < tankRadius * tankRadius;
+}
+
+
+/****************************************************************************/
+
+int main(int argc, char** argv)
+{
+    const char* execName = argv[0];
+    double frameRate = 60.0;
+    int repeat = 1;
+
+    while (argc > 1)
+    {
+        if (strcmp("-h", argv[1]) == 0)
+        {
+            printHelp(execName);
+            exit(0);
+        }
+        else if ((argc > 2) && (strcmp("-f", argv[1]) == 0))
+            frameRate = atof(argv[2]);
+        else if ((argc > 2) && (strcmp("-r", argv[1]) == 0))
+            repeat = atoi(argv[2]);
+        else
+            break;
+        argc -= 2;
+        argv += 2;
+    }
+
+    if ((argc < 2) || (frameRate <= 0.0) || (repeat < 1))
+    {
+        printHelp(execName);
+        exit(1);
+    }
+
+    FILE *file = fopen(argv[1], "rb");
+    if (file == NULL)
+    {
+        perror("fopen");
+        exit(1);
+    }
+    ReplayHeader header;
+    if (!loadHeader(&header, file))
+    {
+        printf("Couldn't load file header\n");
+        fclose(file);
+        exit(1);
+    }
+
+    printf("\nRRSHOTS-%s\n", getAppVersion());
+    printf("frames: %.0f/sec  repeat: %i\n\n", frameRate, repeat);
+
+    std::vector<Tank> tanks(256);
+    for (size_t i = 0; i < tanks.size(); i++)
+    {
+        tanks[i].present = tanks[i].alive = false;
+        tanks[i].updated = 0;
+    }
+    std::vector<Shot> shots;
+
+    ShotHitGrid grid;
+    std::vector<int> ids;
+    Totals brute = { 0.0, 0, 0 };
+    Totals hashed = { 0.0, 0, 0 };
+    long frames = 0, shotFrames = 0, mismatches = 0;
+    int maxShots = 0;
+
+    const RRtime frameTime = (RRtime)(1000000.0 / frameRate);
+    const float dt = (float)(1.0 / frameRate);
+    RRtime nextFrame = 0;
+
+    RRpacket *p;
+    while ((p = loadPacket(file)) != NULL)
+    {
+        const RRtime now = p->timestamp;
+        if (nextFrame == 0)
+            nextFrame = now;
+
+        // run the frames up to this packet
+        while (nextFrame <= now)
+        {
+            const RRtime frame = nextFrame;
+            nextFrame += frameTime;
+            frames++;
+
+            // retire shots that ran out, place the rest
+            for (size_t s = 0; s < shots.size(); )
+            {
+                Shot& shot = shots[s];
+                const float age = (float)(frame - shot.fired) / 1000000.0f;
+                if (age > shot.lifetime)
+                {
+                    shot = shots.back();
+                    shots.pop_back();
+                    continue;
+                }
+                const float prev = (age > dt) ? age - dt : 0.0f;
+                for (int i = 0; i < 3; i++)
+                {
+                    const float a = shot.pos[i] + shot.vel[i] * prev;
+                    const float b = shot.pos[i] + shot.vel[i] * age;
+                    shot.bbox[0][i] = (a < b) ? a : b;
+                    shot.bbox[1][i] = (a < b) ? b : a;
+                }
+                s++;
+            }
+            if (shots.empty())
+                continue;
+            shotFrames++;
+            if ((int)shots.size() > maxShots)
+                maxShots = shots.size();
+
+            // every tank is the local tank of its own client
+            for (size_t t = 0; t < tanks.size(); t++)
+            {
+                Tank& tank = tanks[t];
+                if (!tank.present || !tank.alive)
+                    continue;
+                const float since = (float)(frame - tank.updated) / 1000000.0f;
+                for (int i = 0; i < 3; i++)
+                {
+                    tank.origin[i] = tank.pos[i] + tank.vel[i] * since;
+                    const float a = tank.origin[i];
+                    const float b = a + tank.vel[i] * dt;
+                    tank.bbox[0][i] = (a < b) ? a : b;
+                    tank.bbox[1][i] = (a < b) ? b : a;
+                }
+                tank.bbox[0][0] -= tankRadius;
+                tank.bbox[1][0] += tankRadius;
+                tank.bbox[0][1] -= tankRadius;
+                tank.bbox[1][1] += tankRadius;
+                tank.bbox[1][2] += tankHeight;
+            }
+
+            for (int pass = 0; pass < repeat; pass++)
+            {
+                // every tank against every shot
+                long hits = 0;
+                TimeKeeper start = TimeKeeper::getCurrent();
+                for (size_t t = 0; t < tanks.size(); t++)
+                {
+                    const Tank& tank = tanks[t];
+                    if (!tank.present || !tank.alive)
+                        continue;
+                    for (size_t s = 0; s < shots.size(); s++)
+                    {
+                        const Shot& shot = shots[s];
+                        if (shot.player == (int)t)
+                            continue;
+                        const float age = (float)(frame - shot.fired) / 1000000.0f;
+                        const float prev = (age > dt) ? age - dt : 0.0f;
+                        brute.tests++;
+                        if (checkHit(tank, shot, prev, age - prev))
+                            hits++;
+                    }
+                }
+                brute.seconds += TimeKeeper::getCurrent() - start;
+                brute.hits += hits;
+
+                // the grid, built every frame like the client does
+                long gridHits = 0;
+                start = TimeKeeper::getCurrent();
+                grid.clear();
+                for (size_t s = 0; s < shots.size(); s++)
+                    grid.add((int)s, shots[s].bbox);
+                for (size_t t = 0; t < tanks.size(); t++)
+                {
+                    const Tank& tank = tanks[t];
+                    if (!tank.present || !tank.alive)
+                        continue;
+                    const float pad = tankRadius + shotRadius;
+                    float bbox[2][3];
+                    for (int i = 0; i < 3; i++)
+                    {
+                        bbox[0][i] = tank.bbox[0][i] - pad;
+                        bbox[1][i] = tank.bbox[1][i] + pad;
+                    }
+                    grid.query(bbox, ids);
+                    for (size_t n = 0; n < ids.size(); n++)
+                    {
+                        const Shot& shot = shots[ids[n]];
+                        if (shot.player == (int)t)
+                            continue;
+                        const float age = (float)(frame - shot.fired) / 1000000.0f;
+                        const float prev = (age > dt) ? age - dt : 0.0f;
+                        hashed.tests++;
+                        if (checkHit(tank, shot, prev, age - prev))
+                            gridHits++;
+                    }
+                }
+                hashed.seconds += TimeKeeper::getCurrent() - start;
+                hashed.hits += gridHits;
+                if (gridHits != hits)
+                    mismatches++;
+            }
+        }
+
+        const bool real = (p->mode == RealPacket);
+        const bool state = real || (p->mode == StatePacket);
+
+        if (((p->code == MsgAddPlayer) || (p->code == MsgRemovePlayer)) &&
+                (p->len >= 1) && state)
+        {
+            uint8_t id;
+            nboUnpackUByte(p->data, id);
+            tanks[id].present = (p->code == MsgAddPlayer);
+            tanks[id].alive = false;
+        }
+        else if ((p->code == MsgAlive) && (p->len >= 1) && state)
+        {
+            uint8_t id;
+            nboUnpackUByte(p->data, id);
+            tanks[id].alive = true;
+        }
+        else if ((p->code == MsgKilled) && (p->len >= 1) && state)
+        {
+            uint8_t id;
+            nboUnpackUByte(p->data, id);
+            tanks[id].alive = false;
+        }
+        else if (real && ((p->code == MsgPlayerUpdate) ||
+                          (p->code == MsgPlayerUpdateSmall)))
+        {
+            float timestamp;
+            uint8_t id;
+            PlayerState playerState;
+            const void *buf = p->data;
+            buf = nboUnpackFloat(buf, timestamp);
+            buf = nboUnpackUByte(buf, id);
+            playerState.unpack(buf, p->code);
+            Tank& tank = tanks[id];
+            tank.present = true;
+            tank.alive = (playerState.status & PlayerState::Alive) != 0;
+            tank.updated = now;
+            memcpy(tank.pos, playerState.pos, sizeof(tank.pos));
+            memcpy(tank.vel, playerState.velocity, sizeof(tank.vel));
+        }
+        else if (real && (p->code == MsgShotBegin))
+        {
+            // FiringInfo, skipping the flag so the flag table isn't needed
+            float timeSent;
+            ShotUpdate update;
+            const void *buf = p->data;
+            buf = nboUnpackFloat(buf, timeSent);
+            buf = update.unpack(buf);
+            buf = (const char*)buf + 2;
+
+            Shot shot;
+            nboUnpackFloat(buf, shot.lifetime);
+            shot.player = update.player;
+            shot.id = update.id;
+            shot.fired = now;
+            for (int i = 0; i < 3; i++)
+            {
+                shot.pos[i] = update.pos[i];
+                shot.vel[i] = update.vel[i];
+                const float a = shot.pos[i];
+                const float b = a + shot.vel[i] * shot.lifetime;
+                shot.pathBBox[0][i] = (a < b) ? a : b;
+                shot.pathBBox[1][i] = (a < b) ? b : a;
+            }
+            shots.push_back(shot);
+        }
+        else if (real && (p->code == MsgShotEnd) && (p->len >= 3))
+        {
+            uint8_t player;
+            int16_t id;
+            const void *buf = p->data;
+            buf = nboUnpackUByte(buf, player);
+            buf = nboUnpackShort(buf, id);
+            for (size_t s = 0; s < shots.size(); s++)
+            {
+                if ((shots[s].player == player) && (shots[s].id == id))
+                {
+                    shots[s] = shots.back();
+                    shots.pop_back();
+                    break;
+                }
+            }
+        }
+
+        delete[] p->data;
+        delete p;
+    }
+    fclose(file);
+    delete[] header.world;
+    delete[] header.flags;
+
+    if (brute.tests == 0)
+    {
+        printf("no shots found near any tank\n");
+        return 0;
+    }
+
+    printf("frames: %li, %li with shots, at most %i shots\n\n",
+           frames, shotFrames, maxShots);
+    printf("          tests/frame   usec/frame   hits\n");
+    printf("every shot  %9.1f   %10.2f   %4li\n",
+           (double)brute.tests / (shotFrames * repeat),
+           1.0e6 * brute.seconds / (shotFrames * repeat), brute.hits / repeat);
+    printf("grid        %9.1f   %10.2f   %4li\n",
+           (double)hashed.tests / (shotFrames * repeat),
+           1.0e6 * hashed.seconds / (shotFrames * repeat), hashed.hits / repeat);
+    if (mismatches)
+        printf("WARNING: %li frames found different hits\n", mismatches);
+
+    return 0;
+}
+
+/****************************************************************************/
+
+static void printHelp(const char* execName)
+{
+    printf("usage:\t%s [options] <filename>\n\n", execName);
+    printf("  -h	  : print help\n");
+    printf("  -f <rate>     : frames per second (default 60)\n");
+    printf("  -r <count>    : time each frame this many times (default 1)\n");
+    printf("\n");
+    return;
+}
+
+/****************************************************************************/
+
+static bool loadHeader(ReplayHeader *h, FILE *f)
+{
+    char buffer[ReplayHeaderSize];
+    const void *buf;
+
+    if (fread(buffer, ReplayHeaderSize, 1, f) <= 0)
+        return false;
+
+    buf = nboUnpackUInt(buffer, h->magic);
+    buf = nboUnpackUInt(buf, h->version);
+    buf = nboUnpackUInt(buf, h->offset);
+    buf = nboUnpackRRtime(buf, h->filetime);
+    buf = nboUnpackUInt(buf, h->player);
+    buf = nboUnpackUInt(buf, h->flagsSize);
+    buf = nboUnpackUInt(buf, h->worldSize);
+    buf = nboUnpackString(buf, h->callSign, sizeof(h->callSign));
+    buf = nboUnpackString(buf, h->motto, sizeof(h->motto));
+    buf = nboUnpackString(buf, h->ServerVersion, sizeof(h->ServerVersion));
+    buf = nboUnpackString(buf, h->appVersion, sizeof(h->appVersion));
+    buf = nboUnpackString(buf, h->realHash, sizeof(h->realHash));
+
+    // load the flags, if there are any
+    if (h->flagsSize > 0)
+    {
+        h->flags = new char [h->flagsSize];
+        if (fread(h->flags, h->flagsSize, 1, f) == 0)
+            return false;
+    }
+    else
+        h->flags = NULL;
+
+    // load the world database
+    h->world = new char [h->worldSize];
+    if (fread(h->world, h->worldSize, 1, f) == 0)
+        return false;
+
+    return true;
+}
+
+/****************************************************************************/
+
+static RRpacket* loadPacket(FILE *f)
+{
+    RRpacket *p;
+    char bufStart[RRpacketHdrSize];
+    const void *buf;
+
+    if (f == NULL)
+        return NULL;
+
+    p = new RRpacket;
+
+    if (fread(bufStart, RRpacketHdrSize, 1, f) <= 0)
+    {
+        delete p;
+        return NULL;
+    }
+    buf = nboUnpackUShort(bufStart, p->mode);
+    buf = nboUnpackUShort(buf, p->code);
+    buf = nboUnpackUInt(buf, p->len);
+    buf = nboUnpackUInt(buf, p->nextFilePos);
+    buf = nboUnpackUInt(buf, p->prevFilePos);
+    buf = nboUnpackRRtime(buf, p->timestamp);
+
+    if (p->len > (MaxPacketLen - ((int)sizeof(u16) * 2)))
+    {
+        fprintf(stderr, "loadPacket: ERROR, packtlen = %i\n", p->len);
+        delete p;
+        return NULL;
+    }
+
+    if (p->len == 0)
+        p->data = NULL;
+    else
+    {
+        char *d = new char [p->len];
+        if (fread(d, p->len, 1, f) <= 0)
+        {
+            delete[] d;
+            delete p;
+            return NULL;
+        }
+        p->data = d;
+    }
+
+    return p;
+}
+
+/****************************************************************************/
+
+static const void* nboUnpackRRtime(const void *buf, RRtime& value)
+{
+    u32 msb, lsb;
+    buf = nboUnpackUInt(buf, msb);
+    buf = nboUnpackUInt(buf, lsb);
+    value = ((RRtime)msb << 32) + (RRtime)lsb;
+    return buf;
+}
+
+/****************************************************************************/
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
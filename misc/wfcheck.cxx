@@ -0,0 +1,362 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+
+//  WFCHECK
+//
+//  This program runs the aggressive WordFilter over chat lines twice:
+//  once with the word automaton preselecting the expressions, and once
+//  evaluating every expression the way the filter did before it.  The
+//  filtered lines must come out the same, which is checked, and both
+//  runs are timed.  The first run still goes through the candidate
+//  lookup, so it is a little slower than the old filter was.  Lines are
+//  read from a file, or made up from the filter words with l33t-speak,
+//  repeated letters and punctuation mixed into ordinary chat.
+//
+
+// system headers
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// common headers
+#include "common.h"
+#include "TimeKeeper.h"
+#include "WordFilter.h"
+
+
+// Function Prototypes
+// -------------------
+
+static void printHelp(const char* execName);
+static bool readWords(const char* fileName, std::vector<std::string>& words);
+static bool readLines(const char* fileName, std::vector<std::string>& lines);
+static void makeLines(const std::vector<std::string>& words, int count,
+                      std::vector<std::string>& dirty,
+                      std::vector<std::string>& clean);
+
+
+struct Totals
+{
+    double seconds;
+    long filtered;
+};
+
+
+static const char* chatWords[] =
+{
+    "the", "quick", "brown", "fox", "jumps", "over", "lazy", "dog", "nice",
+    "shot", "gg", "lol", "capture", "flag", "base", "team", "red", "green",
+    "blue", "purple", "laser", "genocide", "ricochet", "tank", "hello",
+    "who", "has", "my", "flag?", "b4se", "@home", ":)", "!!!", "brb", "ph00"
+};
+static const int chatWordCount = (int)(sizeof(chatWords) / sizeof(chatWords[0]));
+
+
+static int randomInt(int range)
+{
+    return (int)(bzfrand() * range);
+}
+
+
+/****************************************************************************/
+
+// filters every line with the same random sequence, so that the
+// replacement characters line up between runs
+static void filterLines(const WordFilter& filter,
+                        const std::vector<std::string>& lines,
+                        std::vector<std::string>& results, Totals& totals)
+{
+    results.resize(lines.size());
+    totals.seconds = 0.0;
+    totals.filtered = 0;
+    for (size_t i = 0; i < lines.size(); i++)
+    {
+        std::string line = lines[i];
+        bzfsrand((unsigned int)i);
+        const TimeKeeper start = TimeKeeper::getCurrent();
+        if (filter.filter(line))
+            totals.filtered++;
+        totals.seconds += TimeKeeper::getCurrent() - start;
+        results[i] = line;
+    }
+}
+
+
+static long compareRun(const char* name, WordFilter& filter,
+                       const std::vector<std::string>& lines)
+{
+    if (lines.empty())
+        return 0;
+
+    std::vector<std::string> expected, actual;
+    Totals every, preselected;
+
+    filter.setPreselect(false);
+    filterLines(filter, lines, expected, every);
+    filter.setPreselect(true);
+    filterLines(filter, lines, actual, preselected);
+
+    long mismatches = 0;
+    for (size_t i = 0; i < lines.size(); i++)
+    {
+        if (expected[i] == actual[i])
+            continue;
+        if (mismatches < 10)
+        {
+            printf("MISMATCH: %s\n", lines[i].c_str());
+            printf("  every expression: %s\n", expected[i].c_str());
+            printf("  preselected:      %s\n", actual[i].c_str());
+        }
+        mismatches++;
+    }
+
+    printf("%-6s %6li lines, %6li filtered   %9.1f usec/line   %9.1f usec/line   %6.2fx\n",
+           name, (long)lines.size(), preselected.filtered,
+           1.0e6 * every.seconds / lines.size(),
+           1.0e6 * preselected.seconds / lines.size(),
+           (preselected.seconds > 0.0) ? every.seconds / preselected.seconds : 0.0);
+
+    return mismatches;
+}
+
+
+int main(int argc, char** argv)
+{
+    const char* execName = argv[0];
+    const char* lineFile = NULL;
+    int count = 2000;
+    unsigned int seed = 1;
+
+    while (argc > 1)
+    {
+        if (strcmp("-h", argv[1]) == 0)
+        {
+            printHelp(execName);
+            return 0;
+        }
+        else if ((argc > 2) && (strcmp("-l", argv[1]) == 0))
+            lineFile = argv[2];
+        else if ((argc > 2) && (strcmp("-n", argv[1]) == 0))
+            count = atoi(argv[2]);
+        else if ((argc > 2) && (strcmp("-s", argv[1]) == 0))
+            seed = (unsigned int)atoi(argv[2]);
+        else
+            break;
+        argc -= 2;
+        argv += 2;
+    }
+
+    if ((argc < 2) || (count < 1))
+    {
+        printHelp(execName);
+        return 1;
+    }
+
+    WordFilter filter;
+    if (filter.loadFromFile(argv[1]) == 0)
+    {
+        printf("no words loaded from %s\n", argv[1]);
+        return 1;
+    }
+
+    std::vector<std::string> dirty, clean;
+    if (lineFile != NULL)
+    {
+        if (!readLines(lineFile, dirty))
+        {
+            printf("could not read %s\n", lineFile);
+            return 1;
+        }
+    }
+    else
+    {
+        std::vector<std::string> words;
+        if (!readWords(argv[1], words))
+        {
+            printf("could not read %s\n", argv[1]);
+            return 1;
+        }
+        bzfsrand(seed);
+        makeLines(words, count, dirty, clean);
+    }
+
+    printf("%li words\n\n", (long)filter.wordCount());
+    printf("                                     every expression     preselected\n");
+    long mismatches = compareRun(lineFile ? "lines" : "dirty", filter, dirty);
+    mismatches += compareRun("clean", filter, clean);
+
+    if (mismatches)
+    {
+        printf("\nFAILED: %li lines were filtered differently\n", mismatches);
+        return 1;
+    }
+    return 0;
+}
+
+/****************************************************************************/
+
+static void printHelp(const char* execName)
+{
+    printf("usage:\t%s [options] <filterfile>\n\n", execName);
+    printf("  -h	  : print help\n");
+    printf("  -l <file>     : filter the lines of this file\n");
+    printf("  -n <count>    : lines to make up of each kind (default 2000)\n");
+    printf("  -s <seed>     : random seed for the made up lines (default 1)\n");
+    printf("\n");
+    return;
+}
+
+/****************************************************************************/
+
+static bool readLines(const char* fileName, std::vector<std::string>& lines)
+{
+    FILE* file = fopen(fileName, "r");
+    if (file == NULL)
+        return false;
+
+    char buffer[1024];
+    while (fgets(buffer, sizeof(buffer), file) != NULL)
+    {
+        std::string line = buffer;
+        while (!line.empty() &&
+                ((line[line.size() - 1] == '\n') || (line[line.size() - 1] == '\r')))
+            line.resize(line.size() - 1);
+        if (!line.empty())
+            lines.push_back(line);
+    }
+    fclose(file);
+    return true;
+}
+
+
+// the words of a filter file, as WordFilter::loadFromFile() reads them
+static bool readWords(const char* fileName, std::vector<std::string>& words)
+{
+    std::vector<std::string> lines;
+    if (!readLines(fileName, lines))
+        return false;
+
+    for (size_t i = 0; i < lines.size(); i++)
+    {
+        std::string word = lines[i];
+        const std::string::size_type comment = word.find('#');
+        if (comment != std::string::npos)
+            word.resize(comment);
+        while (!word.empty() && isspace((unsigned char)word[word.size() - 1]))
+            word.resize(word.size() - 1);
+        if (!word.empty())
+            words.push_back(word);
+    }
+    return !words.empty();
+}
+
+
+// the spellings the aggressive filter is meant to catch
+static std::string disguise(const std::string& word)
+{
+    static const char* prefixes[] = { "bz", "u", "you" };
+    static const char* suffixes[] = { "s", "es", "er", "ing", "ness", "ly", "z" };
+
+    std::string result;
+    if (randomInt(6) == 0)
+        result += prefixes[randomInt(3)];
+
+    for (size_t i = 0; i < word.size(); i++)
+    {
+        char c = word[i];
+        switch (randomInt(8))
+        {
+        case 0:
+            switch (tolower(c))
+            {
+            case 'a':
+                c = '@';
+                break;
+            case 'e':
+                c = '3';
+                break;
+            case 'i':
+            case 'l':
+                c = '1';
+                break;
+            case 'o':
+                c = '0';
+                break;
+            case 's':
+                c = (randomInt(2) == 0) ? 'z' : '$';
+                break;
+            case 't':
+                c = '7';
+                break;
+            }
+            break;
+        case 1:
+            c = toupper(c);
+            break;
+        case 2:
+            // repeated letters
+            result += c;
+            break;
+        case 3:
+            result += c;
+            c = ".-_ "[randomInt(4)];
+            break;
+        }
+        result += c;
+    }
+
+    if (randomInt(4) == 0)
+        result += suffixes[randomInt(7)];
+    return result;
+}
+
+
+static void makeLines(const std::vector<std::string>& words, int count,
+                      std::vector<std::string>& dirty,
+                      std::vector<std::string>& clean)
+{
+    for (int i = 0; i < count; i++)
+    {
+        std::string line;
+        const int length = 3 + randomInt(15);
+        for (int w = 0; w < length; w++)
+        {
+            if (!line.empty())
+                line += ' ';
+            line += chatWords[randomInt(chatWordCount)];
+        }
+        clean.push_back(line);
+
+        // hide a few filter words in a copy
+        const int hidden = 1 + randomInt(3);
+        for (int h = 0; h < hidden; h++)
+        {
+            std::string::size_type at = line.find(' ', randomInt((int)line.size()));
+            if (at == std::string::npos)
+                at = line.size();
+            line.insert(at, " " + disguise(words[randomInt((int)words.size())]));
+        }
+        dirty.push_back(line);
+    }
+}
+
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
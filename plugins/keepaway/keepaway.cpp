@@ -2,6 +2,7 @@
 
 #include "bzfsAPI.h"
 #include <map>
+#include <vector>
 #include <cmath>
 
 class KeepAwayMapHandler : public bz_CustomMapObjectHandler
@@ -431,32 +432,34 @@ double ConvertToNum(std::string inmessage, double minNum, double maxNum)
     return 0;
 }
 
+// kept between calls so walking the players every tick doesn't allocate
+std::vector<bz_PlayerStateView> playerViews;
+
+int getPlayerViews()
+{
+    playerViews.resize(bz_getPlayerCount());
+    if (playerViews.empty())
+        return 0;
+    return bz_getPlayerStateViews(&playerViews[0], (int)playerViews.size());
+}
+
 void killTeams(bz_eTeamType safeteam, std::string keepawaycallsign)
 {
-    bz_APIIntList *playerList = bz_newIntList();
-    bz_getPlayerIndexList ( playerList );
+    int count = getPlayerViews();
 
-    for ( unsigned int i = 0; i < playerList->size(); i++ )
+    for (int i = 0; i < count; i++)
     {
+        const bz_PlayerStateView &player = playerViews[i];
 
-        bz_BasePlayerRecord *player = bz_getPlayerByIndex(playerList->operator[](i));
-
-        if (player)
+        if (player.team != safeteam)
         {
-
-            if (player->team != safeteam)
-            {
-                bz_killPlayer(player->playerID, true, BZ_SERVER);
-                if (keepaway.soundEnabled)
-                    bz_sendPlayCustomLocalSound(player->playerID,"flag_lost");
-            }
-            else if (keepaway.soundEnabled)
-                bz_sendPlayCustomLocalSound(player->playerID,"flag_won");
+            bz_killPlayer(player.playerID, true, BZ_SERVER);
+            if (keepaway.soundEnabled)
+                bz_sendPlayCustomLocalSound(player.playerID,"flag_lost");
         }
-
-        bz_freePlayerRecord(player);
+        else if (keepaway.soundEnabled)
+            bz_sendPlayCustomLocalSound(player.playerID,"flag_won");
     }
-    bz_deleteIntList(playerList);
 
     bz_sendTextMessagef (BZ_SERVER, BZ_ALLUSERS, "%s (%s) Kept the Flag Away!", getTeamColor(safeteam),
                          keepawaycallsign.c_str());
@@ -469,32 +472,22 @@ void killTeams(bz_eTeamType safeteam, std::string keepawaycallsign)
 
 void killPlayers(int safeid, std::string keepawaycallsign)
 {
-    bz_APIIntList *playerList = bz_newIntList();
-    bz_getPlayerIndexList ( playerList );
+    int count = getPlayerViews();
 
-    for ( unsigned int i = 0; i < playerList->size(); i++ )
+    for (int i = 0; i < count; i++)
     {
+        const bz_PlayerStateView &player = playerViews[i];
 
-        bz_BasePlayerRecord *player = bz_getPlayerByIndex(playerList->operator[](i));
-
-        if (player)
+        if (player.playerID != safeid)
         {
-
-            if (player->playerID != safeid)
-            {
-                bz_killPlayer(player->playerID, true, keepaway.id);
-                if (keepaway.soundEnabled)
-                    bz_sendPlayCustomLocalSound(player->playerID,"flag_lost");
-            }
-            else if (keepaway.soundEnabled)
-                bz_sendPlayCustomLocalSound(player->playerID,"flag_won");
+            bz_killPlayer(player.playerID, true, keepaway.id);
+            if (keepaway.soundEnabled)
+                bz_sendPlayCustomLocalSound(player.playerID,"flag_lost");
         }
-
-        bz_freePlayerRecord(player);
+        else if (keepaway.soundEnabled)
+            bz_sendPlayCustomLocalSound(player.playerID,"flag_won");
     }
 
-    bz_deleteIntList(playerList);
-
     bz_sendTextMessagef (BZ_SERVER, BZ_ALLUSERS, "%s Kept the Flag Away!", keepawaycallsign.c_str());
 
     if (keepaway.flagResetEnabled)
@@ -558,32 +551,23 @@ std::string getFlag()
         std::string flagCandidate = keepaway.flagsList[keepaway.flagToKeepIndex];
         bool flagNotHeld = true;
 
-        bz_APIIntList *playerList = bz_newIntList();
-        bz_getPlayerIndexList ( playerList );
+        int count = getPlayerViews();
 
-        for ( unsigned int i = 0; i < playerList->size(); i++ )
+        for (int i = 0; i < count; i++)
         {
-            bz_BasePlayerRecord *player = bz_getPlayerByIndex(playerList->operator[](i));
-
-            if (player)
+            const char* playerFlag = playerViews[i].flagAbbv;
+            if (playerFlag)
             {
-                const char* playerFlag = bz_getPlayerFlag(player->playerID);
-                if (playerFlag)
+                if (playerFlag == flagCandidate && keepaway.forcedFlags) // take it, if forced flags
                 {
-                    if (playerFlag == flagCandidate && keepaway.forcedFlags) // take it, if forced flags
-                    {
-                        bz_removePlayerFlag (player->playerID);
-                        bz_sendTextMessage (BZ_SERVER, player->playerID, "Sorry, server needs your flag for Keep Away :/");
-                    }
-                    if (playerFlag == flagCandidate && !keepaway.forcedFlags) // look for next free flag in list
-                        flagNotHeld = false;
+                    bz_removePlayerFlag (playerViews[i].playerID);
+                    bz_sendTextMessage (BZ_SERVER, playerViews[i].playerID, "Sorry, server needs your flag for Keep Away :/");
                 }
+                if (playerFlag == flagCandidate && !keepaway.forcedFlags) // look for next free flag in list
+                    flagNotHeld = false;
             }
-            bz_freePlayerRecord(player);
         }
 
-        bz_deleteIntList(playerList);
-
         if (flagNotHeld)
             return flagCandidate;
     }
@@ -629,24 +613,17 @@ void initiatekeepaway(bz_eTeamType plyrteam, bz_ApiString plyrcallsign, int plyr
 
     if (keepaway.soundEnabled)
     {
-        bz_APIIntList *playerList = bz_newIntList();
-        bz_getPlayerIndexList ( playerList );
+        int count = getPlayerViews();
 
-        for ( unsigned int i = 0; i < playerList->size(); i++ )
+        for (int i = 0; i < count; i++)
         {
-            bz_BasePlayerRecord *player = bz_getPlayerByIndex(playerList->operator[](i));
-
-            if (player)
-            {
-                if ((player->team != keepaway.team || player->team == eRogueTeam) && player->playerID != keepaway.id)
-                    bz_sendPlayCustomLocalSound(player->playerID,"flag_alert");
-                else
-                    bz_sendPlayCustomLocalSound(player->playerID,"teamgrab");
-            }
+            const bz_PlayerStateView &player = playerViews[i];
 
-            bz_freePlayerRecord(player);
+            if ((player.team != keepaway.team || player.team == eRogueTeam) && player.playerID != keepaway.id)
+                bz_sendPlayCustomLocalSound(player.playerID,"flag_alert");
+            else
+                bz_sendPlayCustomLocalSound(player.playerID,"teamgrab");
         }
-        bz_deleteIntList(playerList);
     }
 
     return;
@@ -654,19 +631,10 @@ void initiatekeepaway(bz_eTeamType plyrteam, bz_ApiString plyrcallsign, int plyr
 
 void playAlert()
 {
-    bz_APIIntList *playerList = bz_newIntList();
-    bz_getPlayerIndexList ( playerList );
+    int count = getPlayerViews();
 
-    for ( unsigned int i = 0; i < playerList->size(); i++ )
-    {
-        bz_BasePlayerRecord *player = bz_getPlayerByIndex(playerList->operator[](i));
-
-        if (player)
-            bz_sendPlayCustomLocalSound(player->playerID,"hunt_select");
-
-        bz_freePlayerRecord(player);
-    }
-    bz_deleteIntList(playerList);
+    for (int i = 0; i < count; i++)
+        bz_sendPlayCustomLocalSound(playerViews[i].playerID,"hunt_select");
 
     return;
 }
@@ -689,17 +657,17 @@ void KeepAwayPlayerPaused( bz_EventData *eventData )
 
     bz_PlayerPausedEventData_V1 *PauseData = (bz_PlayerPausedEventData_V1*)eventData;
 
-    bz_BasePlayerRecord *player = bz_getPlayerByIndex(PauseData->playerID);
+    bz_PlayerStateView player;
 
-    if (player)
+    if (bz_getPlayerStateView(PauseData->playerID, &player))
     {
-        const char* flagHeld = bz_getPlayerFlag(player->playerID);
+        const char* flagHeld = player.flagAbbv;
 
         if (flagHeld)
         {
             if (flagHeld == keepaway.flagToKeep)
             {
-                bz_removePlayerFlag (player->playerID);
+                bz_removePlayerFlag (player.playerID);
                 bz_sendTextMessage (BZ_SERVER, PauseData->playerID, "Flag removed - cannot pause while holding flag.");
                 keepaway.id = -1;
                 keepaway.team = eNoTeam;
@@ -707,7 +675,6 @@ void KeepAwayPlayerPaused( bz_EventData *eventData )
             }
         }
     }
-    bz_freePlayerRecord(player);
 
     return;
 }
@@ -807,50 +774,34 @@ void KeepAwayPlayerDied ( bz_EventData *eventData )
 
 inline void checkKeepAwayHolder()
 {
-    bz_APIIntList *playerList = bz_newIntList();
-    bz_getPlayerIndexList ( playerList );
+    int count = getPlayerViews();
 
-    for ( unsigned int i = 0; i < playerList->size(); i++ )
+    for (int i = 0; i < count; i++)
     {
+        // initiatekeepaway() refills the views, take a copy
+        const bz_PlayerStateView player = playerViews[i];
+        const char* flagHeld = player.flagAbbv;
 
-        bz_BasePlayerRecord *player = bz_getPlayerByIndex(playerList->operator[](i));
-
-        if (player)
+        if (flagHeld)
         {
-            const char* flagHeld = bz_getPlayerFlag(player->playerID);
-            if (flagHeld)
+            if (flagHeld == keepaway.flagToKeep && keepaway.id == -1) // gotta a new one; initiate
             {
-                if (flagHeld == keepaway.flagToKeep && keepaway.id == -1) // gotta a new one; initiate
-                {
-                    initiatekeepaway(player->team, player->callsign, player->playerID);
-                    bz_freePlayerRecord(player);
-                    bz_deleteIntList(playerList);
-                    return;
-                }
-                if (flagHeld == keepaway.flagToKeep && keepaway.id == player->playerID) // someone still has it; leave
-                {
-                    bz_freePlayerRecord(player);
-                    bz_deleteIntList(playerList);
-                    return;
-                }
-                if (flagHeld == keepaway.flagToKeep && keepaway.id != player->playerID) // must have stolen it
-                {
-                    initiatekeepaway(player->team, player->callsign, player->playerID);
-                    bz_freePlayerRecord(player);
-                    bz_deleteIntList(playerList);
-                    return;
-                }
+                initiatekeepaway(player.team, bz_getPlayerCallsign(player.playerID), player.playerID);
+                return;
+            }
+            if (flagHeld == keepaway.flagToKeep && keepaway.id == player.playerID) // someone still has it; leave
+                return;
+            if (flagHeld == keepaway.flagToKeep && keepaway.id != player.playerID) // must have stolen it
+            {
+                initiatekeepaway(player.team, bz_getPlayerCallsign(player.playerID), player.playerID);
+                return;
             }
         }
-
-        bz_freePlayerRecord(player);
     }
 
     keepaway.id = -1;  // no one has flag
     keepaway.team = eNoTeam;
 
-    bz_deleteIntList(playerList);
-
     return;
 }
 
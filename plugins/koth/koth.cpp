@@ -2,6 +2,7 @@
 
 #include "bzfsAPI.h"
 #include <map>
+#include <vector>
 #include <cmath>
 
 class KOTHMapHandler : public bz_CustomMapObjectHandler
@@ -277,32 +278,35 @@ double ConvertToNum(std::string inmessage, double minNum, double maxNum)
     return 0;
 }
 
+// kept between calls so walking the players every update doesn't allocate
+std::vector<bz_PlayerStateView> playerViews;
+std::vector<int> playersOnHill;
+
+int getPlayerViews()
+{
+    playerViews.resize(bz_getPlayerCount());
+    if (playerViews.empty())
+        return 0;
+    return bz_getPlayerStateViews(&playerViews[0], (int)playerViews.size());
+}
+
 void killTeams(bz_eTeamType safeteam, std::string kothcallsign)
 {
-    bz_APIIntList *playerList = bz_newIntList();
-    bz_getPlayerIndexList ( playerList );
+    int count = getPlayerViews();
 
-    for ( unsigned int i = 0; i < playerList->size(); i++ )
+    for (int i = 0; i < count; i++)
     {
+        const bz_PlayerStateView &player = playerViews[i];
 
-        bz_BasePlayerRecord *player = bz_getPlayerByIndex(playerList->operator[](i));
-
-        if (player)
+        if (player.team != safeteam)
         {
-
-            if (player->team != safeteam)
-            {
-                bz_killPlayer(player->playerID, true, BZ_SERVER);
-                if (koth.soundEnabled)
-                    bz_sendPlayCustomLocalSound(player->playerID,"flag_lost");
-            }
-            else if (koth.soundEnabled)
-                bz_sendPlayCustomLocalSound(player->playerID,"flag_won");
+            bz_killPlayer(player.playerID, true, BZ_SERVER);
+            if (koth.soundEnabled)
+                bz_sendPlayCustomLocalSound(player.playerID,"flag_lost");
         }
-
-        bz_freePlayerRecord(player);
+        else if (koth.soundEnabled)
+            bz_sendPlayCustomLocalSound(player.playerID,"flag_won");
     }
-    bz_deleteIntList(playerList);
 
     bz_sendTextMessagef (BZ_SERVER, BZ_ALLUSERS, "%s (%s) IS KING OF THE HILL!", getTeamColor(safeteam),
                          kothcallsign.c_str());
@@ -312,32 +316,22 @@ void killTeams(bz_eTeamType safeteam, std::string kothcallsign)
 
 void killPlayers(int safeid, std::string kothcallsign)
 {
-    bz_APIIntList *playerList = bz_newIntList();
-    bz_getPlayerIndexList ( playerList );
+    int count = getPlayerViews();
 
-    for ( unsigned int i = 0; i < playerList->size(); i++ )
+    for (int i = 0; i < count; i++)
     {
+        const bz_PlayerStateView &player = playerViews[i];
 
-        bz_BasePlayerRecord *player = bz_getPlayerByIndex(playerList->operator[](i));
-
-        if (player)
+        if (player.playerID != safeid)
         {
-
-            if (player->playerID != safeid)
-            {
-                bz_killPlayer(player->playerID, true, koth.id);
-                if (koth.soundEnabled)
-                    bz_sendPlayCustomLocalSound(player->playerID,"flag_lost");
-            }
-            else if (koth.soundEnabled)
-                bz_sendPlayCustomLocalSound(player->playerID,"flag_won");
+            bz_killPlayer(player.playerID, true, koth.id);
+            if (koth.soundEnabled)
+                bz_sendPlayCustomLocalSound(player.playerID,"flag_lost");
         }
-
-        bz_freePlayerRecord(player);
+        else if (koth.soundEnabled)
+            bz_sendPlayCustomLocalSound(player.playerID,"flag_won");
     }
 
-    bz_deleteIntList(playerList);
-
     bz_sendTextMessagef (BZ_SERVER, BZ_ALLUSERS, "%s IS KING OF THE HILL!", kothcallsign.c_str());
 
     return;
@@ -414,24 +408,15 @@ void initiatekoth(bz_eTeamType plyrteam, bz_ApiString plyrcallsign, int plyrID)
 
     if (koth.soundEnabled)
     {
-        bz_APIIntList *playerList = bz_newIntList();
-        bz_getPlayerIndexList ( playerList );
+        int count = getPlayerViews();
 
-        for ( unsigned int i = 0; i < playerList->size(); i++ )
+        for (int i = 0; i < count; i++)
         {
-            bz_BasePlayerRecord *player = bz_getPlayerByIndex(playerList->operator[](i));
-
-            if (player)
-            {
-                if (player->team != koth.team)
-                    bz_sendPlayCustomLocalSound(player->playerID,"flag_alert");
-                else
-                    bz_sendPlayCustomLocalSound(player->playerID,"teamgrab");
-            }
-
-            bz_freePlayerRecord(player);
+            if (playerViews[i].team != koth.team)
+                bz_sendPlayCustomLocalSound(playerViews[i].playerID,"flag_alert");
+            else
+                bz_sendPlayCustomLocalSound(playerViews[i].playerID,"teamgrab");
         }
-        bz_deleteIntList(playerList);
     }
 
     return;
@@ -442,28 +427,21 @@ bool teamClear(bz_eTeamType teamToCheck)
     if (teamToCheck == eRogueTeam || teamToCheck == eNoTeam || !koth.teamPlay)
         return true;
 
-    bz_APIIntList *playerList = bz_newIntList();
-    bz_getPlayerIndexList ( playerList );
+    playersOnHill.resize(bz_getPlayerCount());
+    if (playersOnHill.empty())
+        return true;
 
-    bool isOut = true;
+    int count = bz_getPlayersInZone(&kothzone, &playersOnHill[0], (int)playersOnHill.size());
+    if (count > (int)playersOnHill.size())
+        count = (int)playersOnHill.size();
 
-    for ( unsigned int i = 0; i < playerList->size(); i++ )
+    for (int i = 0; i < count; i++)
     {
-
-        bz_BasePlayerRecord *player = bz_getPlayerByIndex(playerList->operator[](i));
-
-        if (player)
-        {
-            if (player->team == teamToCheck && kothzone.pointInZone(player->lastKnownState.pos) && player->spawned)
-                isOut = false;
-        }
-
-        bz_freePlayerRecord(player);
+        if (bz_getPlayerTeam(playersOnHill[i]) == teamToCheck)
+            return false;
     }
 
-    bz_deleteIntList(playerList);
-
-    return isOut;
+    return true;
 }
 
 void KOTHPlayerPaused ( bz_EventData *eventData )
@@ -472,17 +450,16 @@ void KOTHPlayerPaused ( bz_EventData *eventData )
         return;
 
     bz_PlayerPausedEventData_V1 *PauseData = (bz_PlayerPausedEventData_V1*)eventData;
-    bz_BasePlayerRecord *player = bz_getPlayerByIndex(PauseData->playerID);
+    bz_PlayerStateView player;
 
-    if (player)
+    if (bz_getPlayerStateView(PauseData->playerID, &player))
     {
-        if (kothzone.pointInZone(player->lastKnownState.pos))
+        if (kothzone.pointInZone(player.state.pos))
         {
             bz_killPlayer (PauseData->playerID, true, BZ_SERVER);
             bz_sendTextMessage (BZ_SERVER, PauseData->playerID, "Cannot pause while on the Hill.");
         }
     }
-    bz_freePlayerRecord(player);
 
     return;
 }
@@ -571,14 +548,14 @@ inline void KOTHEventHandler( bz_EventData *eventData )
 
     if (kothzone.pointInZone(pos)) // player is on Hill
     {
-        bz_BasePlayerRecord *player = bz_getPlayerByIndex(playerID);
+        bz_PlayerStateView player;
 
-        if (player)
+        if (bz_getPlayerStateView(playerID, &player))
         {
-            if (player->playerID != koth.playerJustWon && player->spawned)
+            if (player.playerID != koth.playerJustWon && player.spawned)
             {
-                if ((koth.id == -1 && player->team != koth.team) || (koth.id == -1 && teamClear(koth.team)))
-                    initiatekoth(player->team, player->callsign, player->playerID);
+                if ((koth.id == -1 && player.team != koth.team) || (koth.id == -1 && teamClear(koth.team)))
+                    initiatekoth(player.team, bz_getPlayerCallsign(player.playerID), player.playerID);
 
                 double timeStanding = bz_getCurrentTime() - koth.startTime;
 
@@ -604,8 +581,6 @@ inline void KOTHEventHandler( bz_EventData *eventData )
                     sendWarnings(getTeamColor(koth.team), koth.callsign, koth.startTime);
             }
         }
-
-        bz_freePlayerRecord(player);
     }
     else // player is off Hill
     {
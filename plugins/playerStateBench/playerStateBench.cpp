@@ -0,0 +1,201 @@
+// playerStateBench.cpp : Defines the entry point for the DLL application.
+//
+// Times reading every player's position through the allocating player
+// records against the player state views, and finding each player's
+// neighbours by scanning the views against the spatial queries.
+
+#include "bzfsAPI.h"
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+
+class PlayerStateBench : public bz_Plugin, bz_CustomSlashCommandHandler
+{
+public:
+    virtual const char* Name()
+    {
+        return "Player State Bench";
+    }
+
+    virtual void Init ( const char* /* config */ )
+    {
+        bz_registerCustomSlashCommand ( "playerbench", this );
+    }
+
+    virtual void Cleanup ( void )
+    {
+        bz_removeCustomSlashCommand ( "playerbench" );
+    }
+
+    virtual bool SlashCommand ( int playerID, bz_ApiString /*command*/, bz_ApiString /*message*/,
+                                bz_APIStringList* params );
+
+private:
+    double readRecords ( int passes, float &checksum );
+    double readViews ( int passes, float &checksum );
+    double scanNeighbours ( int passes, int &checksum );
+    double queryNeighbours ( int passes, int &checksum );
+
+    std::vector<bz_PlayerStateView> views;
+    std::vector<int> neighbours;
+};
+
+BZ_PLUGIN(PlayerStateBench)
+
+typedef std::chrono::steady_clock BenchClock;
+
+static double elapsedMicroseconds ( BenchClock::time_point start )
+{
+    return std::chrono::duration<double, std::micro>(BenchClock::now() - start).count();
+}
+
+// the old way, one heap record per player per pass
+double PlayerStateBench::readRecords ( int passes, float &checksum )
+{
+    BenchClock::time_point start = BenchClock::now();
+
+    for (int pass = 0; pass < passes; pass++)
+    {
+        bz_APIIntList *playerList = bz_newIntList();
+        bz_getPlayerIndexList ( playerList );
+
+        for ( unsigned int i = 0; i < playerList->size(); i++ )
+        {
+            bz_BasePlayerRecord *player = bz_getPlayerByIndex(playerList->get(i));
+            if (player)
+                checksum += player->lastKnownState.pos[0] + player->lastKnownState.pos[1];
+            bz_freePlayerRecord(player);
+        }
+
+        bz_deleteIntList(playerList);
+    }
+
+    return elapsedMicroseconds(start) / passes;
+}
+
+double PlayerStateBench::readViews ( int passes, float &checksum )
+{
+    BenchClock::time_point start = BenchClock::now();
+
+    for (int pass = 0; pass < passes; pass++)
+    {
+        views.resize(bz_getPlayerCount());
+        if (views.empty())
+            continue;
+
+        int count = bz_getPlayerStateViews(&views[0], (int)views.size());
+        for (int i = 0; i < count; i++)
+            checksum += views[i].state.pos[0] + views[i].state.pos[1];
+    }
+
+    return elapsedMicroseconds(start) / passes;
+}
+
+// how close counts as a neighbour
+static const float neighbourRadius = 50.0f;
+
+static bool inNeighbourRadius ( const float a[3], const float b[3] )
+{
+    float dx = a[0] - b[0], dy = a[1] - b[1], dz = a[2] - b[2];
+    return dx * dx + dy * dy + dz * dz <= neighbourRadius * neighbourRadius;
+}
+
+// every spawned player against every other, the way zone plugins did it
+double PlayerStateBench::scanNeighbours ( int passes, int &checksum )
+{
+    BenchClock::time_point start = BenchClock::now();
+
+    for (int pass = 0; pass < passes; pass++)
+    {
+        views.resize(bz_getPlayerCount());
+        if (views.empty())
+            continue;
+
+        int count = bz_getPlayerStateViews(&views[0], (int)views.size());
+        for (int i = 0; i < count; i++)
+        {
+            if (!views[i].spawned)
+                continue;
+            for (int j = 0; j < count; j++)
+            {
+                if (views[j].spawned && inNeighbourRadius(views[i].state.pos, views[j].state.pos))
+                    checksum++;
+            }
+        }
+    }
+
+    return elapsedMicroseconds(start) / passes;
+}
+
+double PlayerStateBench::queryNeighbours ( int passes, int &checksum )
+{
+    BenchClock::time_point start = BenchClock::now();
+
+    for (int pass = 0; pass < passes; pass++)
+    {
+        views.resize(bz_getPlayerCount());
+        if (views.empty())
+            continue;
+        neighbours.resize(views.size());
+
+        int count = bz_getPlayerStateViews(&views[0], (int)views.size());
+        for (int i = 0; i < count; i++)
+        {
+            if (views[i].spawned)
+                checksum += bz_getPlayersInRadius(views[i].state.pos, neighbourRadius,
+                                                  &neighbours[0], (int)neighbours.size());
+        }
+    }
+
+    return elapsedMicroseconds(start) / passes;
+}
+
+bool PlayerStateBench::SlashCommand ( int playerID, bz_ApiString /*command*/, bz_ApiString /*message*/,
+                                      bz_APIStringList* params )
+{
+    if (!bz_getAdmin(playerID))
+    {
+        bz_sendTextMessage(BZ_SERVER,playerID,"You do not have permission to run /playerbench");
+        return true;
+    }
+
+    int passes = 1000;
+    if (params && params->size() > 0)
+        passes = atoi(params->get(0).c_str());
+    if (passes < 1 || passes > 1000000)
+    {
+        bz_sendTextMessage(BZ_SERVER,playerID,"Usage: /playerbench [passes], passes from 1 to 1000000");
+        return true;
+    }
+
+    // the sums only keep the reads from being optimized away, both
+    // paths see the same positions so they should match
+    float recordSum = 0.0f, viewSum = 0.0f;
+    double recordTime = readRecords(passes, recordSum);
+    double viewTime = readViews(passes, viewSum);
+    int scanCount = 0, queryCount = 0;
+    double scanTime = scanNeighbours(passes, scanCount);
+    double queryTime = queryNeighbours(passes, queryCount);
+
+    bz_sendTextMessagef(BZ_SERVER, playerID, "%d players, %d passes", bz_getPlayerCount(), passes);
+    bz_sendTextMessagef(BZ_SERVER, playerID, "  player records: %.2f us per pass", recordTime);
+    bz_sendTextMessagef(BZ_SERVER, playerID, "  player views:   %.2f us per pass", viewTime);
+    if (viewTime > 0.0)
+        bz_sendTextMessagef(BZ_SERVER, playerID, "  views are %.1fx faster%s", recordTime / viewTime,
+                            recordSum == viewSum ? "" : " (positions differ)");
+    bz_sendTextMessagef(BZ_SERVER, playerID, "  neighbour scan:  %.2f us per pass", scanTime);
+    bz_sendTextMessagef(BZ_SERVER, playerID, "  neighbour query: %.2f us per pass", queryTime);
+    if (queryTime > 0.0)
+        bz_sendTextMessagef(BZ_SERVER, playerID, "  queries are %.1fx faster%s", scanTime / queryTime,
+                            scanCount == queryCount ? "" : " (neighbours differ)");
+
+    return true;
+}
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
@@ -12,6 +12,8 @@
 
 #include "bzfsAPI.h"
 #include <map>
+#include <vector>
+#include <algorithm>
 #include <cmath>
 
 class WWZEventHandler : public bz_Plugin, bz_CustomMapObjectHandler
@@ -215,60 +217,64 @@ inline bool OKToFire(int zoneNum, int plyrNum)
     return false;
 }
 
+// reused every tick, the ids of the players inside the zone being checked
+std::vector<int> zonePlayers;
+
 void WWZEventHandler::Event (bz_EventData *eventData)
 {
     if (eventData->eventType != bz_eTickEvent)
         return;
 
-    bz_APIIntList *playerList = bz_newIntList();
-    bz_getPlayerIndexList (playerList);
-
-    for (unsigned int h = 0; h < playerList->size(); h++)
+    for (unsigned int i = 0; i < zoneList.size(); i++)
     {
-        bz_BasePlayerRecord *player = bz_getPlayerByIndex(playerList->operator[](h));
+        zonePlayers.resize(bz_getPlayerCount());
+        int count = 0;
+        if (!zonePlayers.empty())
+            count = std::min(bz_getPlayersInZone(&zoneList[i], &zonePlayers[0], (int)zonePlayers.size()),
+                             (int)zonePlayers.size());
+
+        // forget the players who left, the ids come back sorted
+        for (unsigned int j = zoneList[i].wwzPlyrList.size(); j-- > 0; )
+        {
+            int plyrID = zoneList[i].wwzPlyrList[j].wwzplyrID;
+            if (!std::binary_search(zonePlayers.begin(), zonePlayers.begin() + count, plyrID))
+                notHere(i, plyrID);
+        }
 
-        if (player)
+        for (int h = 0; h < count; h++)
         {
-            for (unsigned int i = 0; i < zoneList.size(); i++)
+            int playerID = zonePlayers[h];
+
+            if (wasHere(i, playerID) && OKToFire(i, playerID) && !zoneList[i].zoneWeaponFired)
+            {
+                float vector[3];
+                bz_vectorFromRotations(zoneList[i].zoneWeaponTilt, zoneList[i].zoneWeaponDirection, vector);
+                bz_fireServerShot(zoneList[i].zoneWeapon.c_str(), zoneList[i].zoneWeaponPosition, vector);
+                zoneList[i].zoneWeaponFired = true;
+                zoneList[i].zoneWeaponLastFired = bz_getCurrentTime();
+            }
+            else
+            {
+                if ((bz_getCurrentTime() - zoneList[i].zoneWeaponLastFired) > zoneList[i].zoneWeaponMinFireTime
+                        && zoneList[i].zoneWeaponRepeat)
+                    zoneList[i].zoneWeaponFired = false;
+            }
+
+            if (!zoneList[i].zoneWeaponSentMessage && zoneList[i].zoneWeaponFired)
             {
-                if (zoneList[i].pointInZone(player->lastKnownState.pos) && player->spawned)
-                {
-                    if (wasHere(i, player->playerID) && OKToFire(i, player->playerID) && !zoneList[i].zoneWeaponFired)
-                    {
-                        float vector[3];
-                        bz_vectorFromRotations(zoneList[i].zoneWeaponTilt, zoneList[i].zoneWeaponDirection, vector);
-                        bz_fireServerShot(zoneList[i].zoneWeapon.c_str(), zoneList[i].zoneWeaponPosition, vector);
-                        zoneList[i].zoneWeaponFired = true;
-                        zoneList[i].zoneWeaponLastFired = bz_getCurrentTime();
-                    }
-                    else
-                    {
-                        if ((bz_getCurrentTime() - zoneList[i].zoneWeaponLastFired) > zoneList[i].zoneWeaponMinFireTime
-                                && zoneList[i].zoneWeaponRepeat)
-                            zoneList[i].zoneWeaponFired = false;
-                    }
-
-                    if (!zoneList[i].zoneWeaponSentMessage && zoneList[i].zoneWeaponFired)
-                    {
-                        if (!zoneList[i].playermessage.empty())
-                            bz_sendTextMessage(BZ_SERVER, player->playerID, zoneList[i].playermessage.c_str());
-                        if (!zoneList[i].servermessage.empty())
-                            bz_sendTextMessage(BZ_SERVER, BZ_ALLUSERS, zoneList[i].servermessage.c_str());
-                        if (zoneList[i].zoneWeaponInfoMessage)
-                            bz_sendTextMessagef(BZ_SERVER, BZ_ALLUSERS, "%s triggered by %s.", zoneList[i].zoneWeapon.c_str(),
-                                                player->callsign.c_str());
-
-                        zoneList[i].zoneWeaponSentMessage = true;
-                    }
-                }
-                else
-                    notHere(i, player->playerID);
+                if (!zoneList[i].playermessage.empty())
+                    bz_sendTextMessage(BZ_SERVER, playerID, zoneList[i].playermessage.c_str());
+                if (!zoneList[i].servermessage.empty())
+                    bz_sendTextMessage(BZ_SERVER, BZ_ALLUSERS, zoneList[i].servermessage.c_str());
+                if (zoneList[i].zoneWeaponInfoMessage)
+                    bz_sendTextMessagef(BZ_SERVER, BZ_ALLUSERS, "%s triggered by %s.", zoneList[i].zoneWeapon.c_str(),
+                                        bz_getPlayerCallsign(playerID));
+
+                zoneList[i].zoneWeaponSentMessage = true;
             }
-            bz_freePlayerRecord(player);
         }
     }
 
-    bz_deleteIntList(playerList);
     return;
 }
 
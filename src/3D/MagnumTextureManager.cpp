@@ -20,6 +20,7 @@
 #include <Magnum/PixelFormat.h>
 #include <Magnum/GL/TextureFormat.h>
 #include <Magnum/ImageView.h>
+#include <Magnum/PixelStorage.h>
 
 
 // BZFlag common header
@@ -32,6 +33,7 @@
 #include <vector>
 #include <string>
 #include <cctype>
+#include <cstring>
 #include <algorithm>
 
 // common implementation headers
@@ -43,6 +45,8 @@
 #include "OSFile.h"
 #include "CacheManager.h"
 #include "FileManager.h"
+#include "PixelConvert.h"
+#include "TextureCache.h"
 
 /*const int NO_VARIANT = (-1); */
 
@@ -62,6 +66,10 @@ MagnumTextureManager::MagnumTextureManager()
     lastImageID = -1;
     lastBoundID = -1;
 
+    decodeGeneration = 0;
+    textureGeneration = 0;
+    stopDecoding = false;
+
     autoLoad = true;
 
     int i, numTextures;
@@ -80,10 +88,17 @@ MagnumTextureManager::MagnumTextureManager()
 
     importer = manager.loadAndInstantiate("AnyImageImporter");
     converter = converterManager.loadAndInstantiate("AnyImageConverter");
+
+    // Leave a core for the render thread
+    unsigned int cores = std::thread::hardware_concurrency();
+    decodeThreadCount = cores > 1 ? std::min(cores - 1, 4u) : 0;
+    startDecodeThreads();
 }
 
 MagnumTextureManager::~MagnumTextureManager()
 {
+    stopDecodeThreads();
+
     // we are done remove all textures
     for (TextureNameMap::iterator it = textureNames.begin(); it != textureNames.end(); ++it)
     {
@@ -149,9 +164,11 @@ bool MagnumTextureManager::removeTexture(const std::string& name)
     MagnumImageInfo& info = it->second;
     delete info.data.texture;
     info.data.texture = NULL;
+    ++textureGeneration;
 
     // clear the maps
     textureNames.erase(name);
+    pendingTextures.erase(name);
 
     logDebugMessage(2,"MagnumTextureManager::removed: %s\n", name.c_str());
 
@@ -180,6 +197,14 @@ void MagnumTextureManager::clear()
     }
     textureNames.clear();
     autoLoad = true;
+    ++textureGeneration;
+
+    // drop anything still being decoded
+    pendingTextures.clear();
+    ++decodeGeneration;
+    std::lock_guard<std::mutex> lock(decodeMutex);
+    decodeQueue.clear();
+    decodedQueue.clear();
 }
 
 void MagnumTextureManager::disableAutomaticLoading() {
@@ -211,10 +236,21 @@ bool MagnumTextureManager::reloadTextureImage(const std::string& name)
         return false;
     }
 
+    // a synchronous reload supersedes a pending decode
+    if (isPending(name)) {
+        pendingTextures.erase(name);
+        *oldTex = std::move(*newTex.texture);
+        delete newTex.texture;
+        newTex.texture = oldTex;
+        info.data = newTex;
+        return true;
+    }
+
     //  name and id fields are not changed
     info.data = newTex;
 
     delete oldTex;
+    ++textureGeneration;
 
     return true;
 }
@@ -236,6 +272,7 @@ TextureData MagnumTextureManager::addTexture( std::string name, TextureData data
     {
         logDebugMessage(3,"Texture %s already exists, overwriting\n", name.c_str());
         delete it->second.data.texture;
+        ++textureGeneration;
     }
     MagnumImageInfo info;
     info.name = name;
@@ -250,14 +287,29 @@ TextureData MagnumTextureManager::addTexture( std::string name, TextureData data
 
 TextureData MagnumTextureManager::loadTexture(FileTextureInit &init, bool reportFail)
 {
-    
+    DecodedTexture decoded;
+    if (!resolveTexture(init, decoded.job))
+        return {NULL, 0, 0, false};
+
+    if (!decodeTexture(importer.get(), decoded)) {
+        logDebugMessage(2,"Image not found or unloadable: %s\n", decoded.job.filename.c_str());
+        return {NULL, 0, 0, false};
+    }
+
+    GL::Texture2D *texture = new GL::Texture2D{};
+    uploadTexture(*texture, decoded);
+    return {texture, decoded.width, decoded.height, decoded.hasAlpha};
+}
+
+bool MagnumTextureManager::resolveTexture(FileTextureInit &init, TextureDecodeJob &job)
+{
     std::string filename = init.name;
     if (filename == "") {
-        return {NULL, 0, 0};
+        return false;
     }
     if (CACHEMGR.isCacheFileType(init.name)) {
         // This prevents us from trying to load unavailable cached textures every frame
-        if (!autoLoad) return {NULL, 0, 0, false};
+        if (!autoLoad) return false;
         filename = CACHEMGR.getLocalName(filename);
     }
 
@@ -278,117 +330,387 @@ TextureData MagnumTextureManager::loadTexture(FileTextureInit &init, bool report
 
     //std::cout << "load Texture " << filename << std::endl;
 
-    FileTextureInit texInfo;
-    texInfo.name = filename;
+    job.name = init.name;
+    job.filename = filename;
+    job.generation = decodeGeneration;
+    job.packedData = nullptr;
 
     // Check if we have this in our packed resources
     Utility::Resource rs{"bzflag-texture-data"};
 
-    std::string fullfilepath = FileManager::instance().getFullFilePath(filename);
-
     // Try to load from packed resources if we can
-    if (rs.hasFile(filename)) {
-        if (!importer || !importer->openData(rs.getRaw(filename))) {
-            logDebugMessage(2,"Image not found or unloadable: %s\n", filename.c_str());
-            return {NULL, 0, 0, false};
-        }
-    } else {
-        if (!importer || !importer->openFile(fullfilepath)) {
-            logDebugMessage(2,"Image not found or unloadable: %s\n", filename.c_str());
-            return {NULL, 0, 0, false};
+    if (rs.hasFile(filename))
+        job.packedData = rs.getRaw(filename);
+    else
+        job.fullPath = FileManager::instance().getFullFilePath(filename);
+
+    return true;
+}
+
+// Runs on the decode threads, so it must not touch any of the managers
+// (the texture cache locks for itself)
+bool MagnumTextureManager::decodeTexture(Trade::AbstractImporter *decoder, DecodedTexture &decoded)
+{
+    const TextureDecodeJob &job = decoded.job;
+
+    std::vector<char> fileData;
+    Containers::ArrayView<const char> source = job.packedData;
+    if (source.empty()) {
+        if (!TextureCache::readFile(job.fullPath, fileData))
+            return false;
+        source = {fileData.data(), fileData.size()};
+    }
+
+    // A warm cache entry skips the decode and the mip chain build
+    std::string cacheKey;
+    if (TEXCACHE.isEnabled()) {
+        cacheKey = TextureCache::getKey(source.data(), source.size());
+        MipmappedImage *cached = TEXCACHE.findTexture(cacheKey);
+        if (cached) {
+            decoded.mipmaps.reset(cached);
+            decoded.width = (unsigned int)cached->getWidth();
+            decoded.height = (unsigned int)cached->getHeight();
+            decoded.hasAlpha = cached->hasAlpha();
+            return true;
         }
     }
-    
-    Containers::Optional<Trade::ImageData2D> image = importer->image2D(0);
+
+    if (!decoder || !decoder->openData(source))
+        return false;
+
+    Containers::Optional<Trade::ImageData2D> image = decoder->image2D(0);
+    decoder->close();
     if (!image)
-    {
-        logDebugMessage(2,"Image not found or unloadable: %s\n", filename.c_str());
-        return {NULL, 0, 0, false};
-    }
+        return false;
+
     bool hasAlpha = true;
     if (image->format() == PixelFormat::RGB8Unorm)
         hasAlpha = false;
     if (image->format() != PixelFormat::RGBA8Unorm && image->format() != PixelFormat::RGB8Unorm) {
+        // Rows of the source may be padded for alignment, the RGBA rows never are
         auto data = image->data();
-        switch (image->format()) {
-            case Magnum::PixelFormat::RGB16Unorm:
-            {
-                Containers::Array<char> rgbaData{data.size()*4/(3*2)};
-                int j = 0;
-                for (int i = 0; i < data.size(); i += 3*2) {
-                    rgbaData[j++] = data[i];
-                    rgbaData[j++] = data[i+2];
-                    rgbaData[j++] = data[i+4];
-                    rgbaData[j++] = 0xFF;
-                }
-                image = Trade::ImageData2D{PixelFormat::RGBA8Unorm, image->size(), std::move(rgbaData)};
-                break;
-            }
-            case Magnum::PixelFormat::RG8Unorm:
-            {
-                Containers::Array<char> rgbaData{data.size()*2};
-                int j = 0;
-                for (int i = 0; i < data.size(); i += 2) {
-                    rgbaData[j++] = data[i];
-                    rgbaData[j++] = data[i];
-                    rgbaData[j++] = data[i];
-                    rgbaData[j++] = data[i+1];
-                }
-                image = Trade::ImageData2D{PixelFormat::RGBA8Unorm, image->size(), std::move(rgbaData)};
-                break;
-            }
-            case Magnum::PixelFormat::R8Unorm:
-            {
-                Containers::Array<char> rgbaData{data.size()*4};
-                int j = 0;
-                for (int i = 0; i < data.size(); i += 1) {
-                    rgbaData[j++] = data[i];
-                    rgbaData[j++] = data[i];
-                    rgbaData[j++] = data[i];
-                    rgbaData[j++] = 0xFF;
+        const std::size_t width = std::size_t(image->size().x());
+        const std::size_t height = std::size_t(image->size().y());
+        const std::size_t srcStride = height ? data.size()/height : 0;
+        Containers::Array<char> rgbaData{width*height*4};
+        Containers::Array<char> rgbRow;
+        bool converted = true;
+        for (std::size_t y = 0; y < height && converted; ++y) {
+            const unsigned char *src = reinterpret_cast<const unsigned char*>(data.data()) + y*srcStride;
+            unsigned char *dst = reinterpret_cast<unsigned char*>(rgbaData.data()) + y*width*4;
+            switch (image->format()) {
+                case Magnum::PixelFormat::RGB16Unorm:
+                {
+                    // Magnum keeps 16 bit channels in native byte order
+                    if (rgbRow.isEmpty())
+                        rgbRow = Containers::Array<char>{width*3};
+                    unsigned char *rgb = reinterpret_cast<unsigned char*>(rgbRow.data());
+#ifdef WORDS_BIGENDIAN
+                    PixelConvert::narrow16To8(src, rgb, width*3, true);
+#else
+                    PixelConvert::narrow16To8(src, rgb, width*3, false);
+#endif
+                    PixelConvert::rgbToRGBA(rgb, dst, width);
+                    break;
                 }
-                image = Trade::ImageData2D{PixelFormat::RGBA8Unorm, image->size(), std::move(rgbaData)};
-                break;
+                case Magnum::PixelFormat::RG8Unorm:
+                    PixelConvert::grayAlphaToRGBA(src, dst, width);
+                    break;
+                case Magnum::PixelFormat::R8Unorm:
+                    PixelConvert::grayToRGBA(src, dst, width);
+                    break;
+                default:
+                    Warning{} << "Unsupported pixel format " << image->format() << "in image" << job.filename.c_str();
+                    converted = false;
+                    break;
             }
-            default:
-                Warning{} << "Unsupported pixel format " << image->format() << "in image" << filename.c_str();
-                break;
         }
+        if (converted)
+            image = Trade::ImageData2D{PixelFormat::RGBA8Unorm, image->size(), std::move(rgbaData)};
     }
 
     // Check if any alpha values are actually < 1.0
     // This helps us disable blending for non-transparent textures
-    if (hasAlpha) {
-        hasAlpha = false;
+    if (hasAlpha && image->format() == PixelFormat::RGBA8Unorm) {
         auto data = image->data();
-        for (int i = 0; i < data.size(); i+= 4) {
-            if (data[i+3] != (char)0xFF) {
-                hasAlpha = true;
-                break;
-            }
+        hasAlpha = PixelConvert::hasTranslucentPixel(
+            reinterpret_cast<const unsigned char*>(data.data()), data.size()/4);
+    }
+
+    decoded.width = (unsigned int)image->size().x();
+    decoded.height = (unsigned int)image->size().y();
+    decoded.hasAlpha = hasAlpha;
+
+    // Build the mip chain here rather than on the GPU so it can be cached
+    const int channels = image->format() == PixelFormat::RGBA8Unorm ? 4 :
+                         image->format() == PixelFormat::RGB8Unorm ? 3 : 0;
+    if (!cacheKey.empty() && channels) {
+        const std::size_t rowSize = std::size_t(decoded.width)*channels;
+        const std::size_t stride = decoded.height ? image->data().size()/decoded.height : 0;
+        const unsigned char *pixels = reinterpret_cast<const unsigned char*>(image->data().data());
+        Containers::Array<char> packed;
+        if (stride != rowSize) {
+            packed = Containers::Array<char>{rowSize*decoded.height};
+            for (std::size_t y = 0; y < decoded.height; ++y)
+                std::memcpy(packed.data() + y*rowSize, pixels + y*stride, rowSize);
+            pixels = reinterpret_cast<const unsigned char*>(packed.data());
         }
+        decoded.mipmaps.reset(new MipmappedImage(decoded.width, decoded.height,
+            channels, pixels, hasAlpha));
+        TEXCACHE.addTexture(cacheKey, *decoded.mipmaps);
+        return true;
     }
 
-    GL::Texture2D *texture = new GL::Texture2D{};
-    texture->setWrapping(GL::SamplerWrapping::Repeat)
+    decoded.image = std::move(image);
+    return true;
+}
+
+void MagnumTextureManager::setupSampler(GL::Texture2D &texture)
+{
+    texture.setWrapping(GL::SamplerWrapping::Repeat)
 #if defined(MAGNUM_TARGET_GLES2)
         // If targeting GLES2 assume less capable system
         .setMagnificationFilter(GL::SamplerFilter::Nearest)
         .setMinificationFilter(GL::SamplerFilter::Nearest, GL::SamplerMipmap::Nearest)
-        .setMaxAnisotropy(1.0f)
+        .setMaxAnisotropy(1.0f);
 #else
         .setMagnificationFilter(GL::SamplerFilter::Linear)
         .setMinificationFilter(GL::SamplerFilter::Linear, GL::SamplerMipmap::Linear)
-        .setMaxAnisotropy(GL::Sampler::maxMaxAnisotropy())
+        .setMaxAnisotropy(GL::Sampler::maxMaxAnisotropy());
 #endif
-        .setStorage(4, GL::textureFormat(image->format()), image->size())
-        .setSubImage(0, {}, *image)
-        .generateMipmap();
-    return {
-        texture,
-        (unsigned int)image->size()[0],
-        (unsigned int)image->size()[1],
-        hasAlpha};
+}
+
+void MagnumTextureManager::uploadTexture(GL::Texture2D &texture, const DecodedTexture &decoded)
+{
+    setupSampler(texture);
+
+    if (!decoded.mipmaps) {
+        const Trade::ImageData2D &image = *decoded.image;
+        texture.setStorage(4, GL::textureFormat(image.format()), image.size())
+            .setSubImage(0, {}, image)
+            .generateMipmap();
+        return;
+    }
+
+    // Cached levels are tightly packed, RGB rows included
+    const MipmappedImage &mipmaps = *decoded.mipmaps;
+    const int channels = mipmaps.getChannels();
+    const PixelFormat format = channels == 4 ? PixelFormat::RGBA8Unorm : PixelFormat::RGB8Unorm;
+    texture.setStorage(mipmaps.getLevelCount(), GL::textureFormat(format),
+        {mipmaps.getWidth(), mipmaps.getHeight()});
+    for (int level = 0; level < mipmaps.getLevelCount(); ++level) {
+        const Vector2i size{mipmaps.getWidth(level), mipmaps.getHeight(level)};
+        const Containers::ArrayView<const char> pixels{
+            reinterpret_cast<const char*>(mipmaps.getPixels(level)),
+            std::size_t(size.product())*channels};
+        texture.setSubImage(level, {}, ImageView2D{PixelStorage{}.setAlignment(1), format, size, pixels});
+    }
+}
+
+
+/* --- Background decoding --- */
+
+TextureData MagnumTextureManager::requestTexture(const char* name)
+{
+    if (!name)
+    {
+        logDebugMessage(2,"Could not request texture; no provided name\n");
+        return {NULL, 0, 0, false};
+    }
+
+    // loaded or already pending, either way we have something to return
+    TextureNameMap::iterator it = textureNames.find(name);
+    if (it != textureNames.end())
+        return it->second.data;
+
+    OSFile osFilename(name); // convert to native format
+    FileTextureInit texInfo;
+    texInfo.name = osFilename.getOSName();
+
+    TextureDecodeJob job;
+    if (!resolveTexture(texInfo, job))
+        return {NULL, 0, 0, false};
+    job.name = name;
+
+    // A 1x1 white texture stands in until the real one is uploaded
+    const char white[] = {(char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF};
+    ImageView2D placeholder{PixelFormat::RGBA8Unorm, {1, 1}, white};
+    GL::Texture2D *texture = new GL::Texture2D{};
+    texture->setWrapping(GL::SamplerWrapping::Repeat)
+        .setMagnificationFilter(GL::SamplerFilter::Nearest)
+        .setMinificationFilter(GL::SamplerFilter::Nearest)
+        .setStorage(1, GL::textureFormat(placeholder.format()), placeholder.size())
+        .setSubImage(0, {}, placeholder);
+
+    pendingTextures.insert(name);
+    {
+        std::lock_guard<std::mutex> lock(decodeMutex);
+        decodeQueue.push_back(job);
+    }
+    decodeWake.notify_one();
+
+    logDebugMessage(4,"Requested texture %s\n", name);
+
+    return addTexture(name, {texture, 1, 1, false});
+}
+
+bool MagnumTextureManager::isPending(const std::string& name)
+{
+    return pendingTextures.find(name) != pendingTextures.end();
+}
+
+int MagnumTextureManager::processDecodedTextures(int maxUploads)
+{
+    int uploaded = 0;
+    while (maxUploads < 0 || uploaded < maxUploads)
+    {
+        DecodedTexture decoded;
+        {
+            std::unique_lock<std::mutex> lock(decodeMutex);
+            if (!decodedQueue.empty()) {
+                decoded = std::move(decodedQueue.front());
+                decodedQueue.pop_front();
+            } else if (decoders.empty() && !decodeQueue.empty()) {
+                // no decode threads, so do the work here
+                decoded.job = decodeQueue.front();
+                decodeQueue.pop_front();
+                lock.unlock();
+                decodeTexture(importer.get(), decoded);
+            } else {
+                break;
+            }
+        }
+        finishDecodedTexture(decoded);
+        ++uploaded;
+    }
+
+    // Record what the last batch of loads added to the texture cache
+    if (uploaded > 0 && pendingTextures.empty())
+        TEXCACHE.saveIndex();
+
+    return uploaded;
+}
+
+void MagnumTextureManager::waitForDecodedTextures()
+{
+    while (!pendingTextures.empty())
+    {
+        if (processDecodedTextures() > 0)
+            continue;
+        // without decode threads everything was just done above
+        if (decoders.empty())
+            break;
+        std::unique_lock<std::mutex> lock(decodeMutex);
+        decodeDone.wait(lock, [this] { return !decodedQueue.empty(); });
+    }
+}
+
+void MagnumTextureManager::finishDecodedTexture(DecodedTexture &decoded)
+{
+    const std::string &name = decoded.job.name;
+
+    // Removed, reloaded or cleared while it was being decoded
+    if (decoded.job.generation != decodeGeneration || !isPending(name))
+        return;
+    pendingTextures.erase(name);
+
+    TextureNameMap::iterator it = textureNames.find(name);
+    if (it == textureNames.end())
+        return;
+
+    // The decode threads only know PNG, let the render thread importer
+    // have a go at anything they couldn't handle
+    if (!decoded.isValid() && !decoders.empty())
+        decodeTexture(importer.get(), decoded);
+
+    if (!decoded.isValid()) {
+        logDebugMessage(2,"Image not found or unloadable: %s\n", decoded.job.filename.c_str());
+        // Keep the 1x1 white placeholder as the fallback, so pointers
+        // handed out stay valid and the texture isn't requested again
+        // every frame; reloadTextureImage() can still bring it back
+        return;
+    }
+
+    // Swap the image into the placeholder object, so anyone holding
+    // on to the pointer gets the real texture too
+    GL::Texture2D texture;
+    uploadTexture(texture, decoded);
+    MagnumImageInfo &info = it->second;
+    *info.data.texture = std::move(texture);
+    info.data.width = decoded.width;
+    info.data.height = decoded.height;
+    info.data.hasAlpha = decoded.hasAlpha;
+
+    logDebugMessage(4,"Uploaded decoded texture %s\n", name.c_str());
+}
+
+void MagnumTextureManager::setDecodeThreads(unsigned int count)
+{
+    stopDecodeThreads();
+    decodeThreadCount = count;
+    startDecodeThreads();
+}
+
+unsigned int MagnumTextureManager::getDecodeThreads() const
+{
+    return decodeThreadCount;
+}
+
+void MagnumTextureManager::startDecodeThreads()
+{
+#ifndef CORRADE_TARGET_EMSCRIPTEN
+    stopDecoding = false;
+    for (unsigned int i = 0; i < decodeThreadCount; ++i) {
+        // AnyImageImporter loads plugins through the shared manager when
+        // opening a file, which isn't thread safe. Give each thread its own
+        // PngImporter, anything else falls back to the render thread.
+        Containers::Pointer<Trade::AbstractImporter> decoder = manager.loadAndInstantiate("PngImporter");
+        if (!decoder)
+            break;
+        decoders.push_back(std::move(decoder));
+        decodeThreads.emplace_back(&MagnumTextureManager::decodeThreadMain, this, decoders.back().get());
+    }
+    if (decoders.size() != decodeThreadCount)
+        logDebugMessage(1,"Only started %d of %d texture decode threads\n",
+            (int)decoders.size(), decodeThreadCount);
+#endif
+}
+
+void MagnumTextureManager::stopDecodeThreads()
+{
+    {
+        std::lock_guard<std::mutex> lock(decodeMutex);
+        stopDecoding = true;
+    }
+    decodeWake.notify_all();
+    for (auto &t: decodeThreads)
+        t.join();
+    decodeThreads.clear();
+    decoders.clear();
+}
+
+void MagnumTextureManager::decodeThreadMain(Trade::AbstractImporter *decoder)
+{
+    while (true)
+    {
+        DecodedTexture decoded;
+        {
+            std::unique_lock<std::mutex> lock(decodeMutex);
+            decodeWake.wait(lock, [this] { return stopDecoding || !decodeQueue.empty(); });
+            if (stopDecoding)
+                return;
+            decoded.job = decodeQueue.front();
+            decodeQueue.pop_front();
+        }
+
+        decodeTexture(decoder, decoded);
+
+        {
+            std::lock_guard<std::mutex> lock(decodeMutex);
+            decodedQueue.push_back(std::move(decoded));
+        }
+        decodeDone.notify_all();
+    }
 }
 
 
@@ -28,10 +28,15 @@
 #include "ErrorHandler.h"
 #include "OpenGLTexture.h"
 #include "OSFile.h"
+#include "FileManager.h"
+#include "CacheManager.h"
+#include "PixelConvert.h"
+#include "TextureCache.h"
 
 /*const int NO_VARIANT = (-1); */
 
 static int noiseProc(ProcTextureInit &init);
+static bool readImageSource(const std::string& name, std::vector<char>& data);
 
 ProcTextureInit procLoader[1];
 
@@ -341,6 +346,38 @@ int TextureManager::addTexture( const char* name, OpenGLTexture *texture )
 
 OpenGLTexture* TextureManager::loadTexture(FileTextureInit &init, bool reportFail)
 {
+    // look for a decoded copy in the texture cache first
+    std::string cacheKey;
+    std::vector<char> source;
+    if (TEXCACHE.isEnabled() && readImageSource(init.name, source))
+    {
+        cacheKey = TextureCache::getKey(source.data(), source.size());
+        MipmappedImage* cached = TEXCACHE.findTexture(cacheKey);
+        if (cached != NULL)
+        {
+            // OpenGLTexture builds its own mipmaps, only the base level is used
+            const int cachedWidth = cached->getWidth();
+            const int cachedHeight = cached->getHeight();
+            OpenGLTexture* texture;
+            if (cached->getChannels() == 4)
+            {
+                texture = new OpenGLTexture(cachedWidth, cachedHeight,
+                                            cached->getPixels(), init.filter, true);
+            }
+            else
+            {
+                unsigned char* rgba = new unsigned char[cachedWidth * cachedHeight * 4];
+                PixelConvert::rgbToRGBA(cached->getPixels(), rgba,
+                                        (size_t)cachedWidth * cachedHeight);
+                texture = new OpenGLTexture(cachedWidth, cachedHeight,
+                                            rgba, init.filter, true);
+                delete[] rgba;
+            }
+            delete cached;
+            return texture;
+        }
+    }
+
     int width, height;
     unsigned char* image = MediaFile::readImage(init.name, &width, &height);
 
@@ -358,6 +395,15 @@ OpenGLTexture* TextureManager::loadTexture(FileTextureInit &init, bool reportFai
     OpenGLTexture *texture =
         new OpenGLTexture(width, height, image, init.filter, true);
 
+    if (!cacheKey.empty())
+    {
+        const size_t pixels = (size_t)width * height;
+        MipmappedImage mipmaps(width, height, 4, image,
+                               PixelConvert::hasTranslucentPixel(image, pixels));
+        // the index is written once the downloads are done and at exit
+        TEXCACHE.addTexture(cacheKey, mipmaps);
+    }
+
     delete[] image;
 
     return texture;
@@ -403,6 +449,32 @@ OpenGLTexture::Filter TextureManager::getTextureFilter(int texId)
 }
 
 
+// Reads the file MediaFile::readImage() would open for this texture
+static bool readImageSource(const std::string& name, std::vector<char>& data)
+{
+    std::string filename = name;
+    if (CACHEMGR.isCacheFileType(filename))
+        filename = CACHEMGR.getLocalName(filename);
+
+    std::vector<std::string> candidates;
+    const std::string ext = TextUtils::tolower(filename.substr(filename.size() > 4 ? filename.size() - 4 : 0));
+    if ((ext == ".png") || (ext == ".rgb"))
+        candidates.push_back(filename);
+    else
+    {
+        candidates.push_back(filename + ".png");
+        candidates.push_back(filename + ".rgb");
+    }
+
+    for (unsigned int i = 0; i < candidates.size(); i++)
+    {
+        if (TextureCache::readFile(FILEMGR.getFullFilePath(candidates[i]), data))
+            return true;
+    }
+    return false;
+}
+
+
 /* --- Procs --- */
 
 int noiseProc(ProcTextureInit &init)
@@ -0,0 +1,930 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+// interface header
+#include "EffectParticles.h"
+
+// system headers
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#define deg2Rad 0.017453292519943295769236907684886f
+
+
+//****************** ParticlePool *******************************
+
+ParticlePool::ParticlePool(size_t _capacity) :
+    count(0), allocated(0),
+    capacity(_capacity > 0 ? _capacity : 1),
+    growth(0.0f), dropped(0)
+{
+}
+
+void ParticlePool::clear()
+{
+    count = 0;
+}
+
+void ParticlePool::grow()
+{
+    allocated = allocated ? allocated * 2 : 64;
+    if (allocated > capacity)
+        allocated = capacity;
+    for (int f = 0; f < FieldCount; f++)
+        fields[f].resize(allocated, 0.0f);
+    alive.resize(allocated);
+}
+
+int ParticlePool::add(float startTime, float lifetime, float radius,
+                      const float* pos, const float* rot,
+                      const float* vel, const float* rgb)
+{
+    if (count >= allocated)
+    {
+        if (allocated >= capacity)
+        {
+            dropped++;
+            return -1;
+        }
+        grow();
+    }
+
+    const size_t i = count++;
+    fields[StartTime][i] = startTime;
+    fields[Lifetime][i] = lifetime;
+    fields[Age][i] = 0.0f;
+    fields[LifeParam][i] = 0.0f;
+    fields[PosX][i] = fields[CurX][i] = pos ? pos[0] : 0.0f;
+    fields[PosY][i] = fields[CurY][i] = pos ? pos[1] : 0.0f;
+    fields[PosZ][i] = fields[CurZ][i] = pos ? pos[2] : 0.0f;
+    fields[VelX][i] = vel ? vel[0] : 0.0f;
+    fields[VelY][i] = vel ? vel[1] : 0.0f;
+    fields[VelZ][i] = vel ? vel[2] : 0.0f;
+    fields[RotY][i] = rot ? rot[1] : 0.0f;
+    fields[RotZ][i] = rot ? rot[2] : 0.0f;
+    fields[Red][i] = rgb ? rgb[0] : 0.0f;
+    fields[Green][i] = rgb ? rgb[1] : 0.0f;
+    fields[Blue][i] = rgb ? rgb[2] : 0.0f;
+    fields[Radius0][i] = fields[Radius][i] = radius;
+    fields[Extra0][i] = fields[Extra1][i] = fields[Extra2][i] = 0.0f;
+    fields[Extra3][i] = fields[Extra4][i] = 0.0f;
+    return (int)i;
+}
+
+size_t ParticlePool::update(float time)
+{
+    const size_t n = count;
+    if (n == 0)
+        return 0;
+
+    // straight loops over separate arrays, the compiler vectorizes these
+    const float* start = get(StartTime);
+    const float* life = get(Lifetime);
+    float* age = get(Age);
+    float* param = get(LifeParam);
+    for (size_t i = 0; i < n; i++)
+    {
+        age[i] = time - start[i];
+        param[i] = age[i] / life[i];
+    }
+
+    const float* px = get(PosX);
+    const float* py = get(PosY);
+    const float* pz = get(PosZ);
+    const float* vx = get(VelX);
+    const float* vy = get(VelY);
+    const float* vz = get(VelZ);
+    float* cx = get(CurX);
+    float* cy = get(CurY);
+    float* cz = get(CurZ);
+    for (size_t i = 0; i < n; i++)
+    {
+        cx[i] = px[i] + vx[i] * age[i];
+        cy[i] = py[i] + vy[i] * age[i];
+        cz[i] = pz[i] + vz[i] * age[i];
+    }
+
+    const float* r0 = get(Radius0);
+    float* r = get(Radius);
+    const float g = growth;
+    for (size_t i = 0; i < n; i++)
+        r[i] = r0[i] + g * age[i];
+
+    size_t firstDead = 0;
+    while ((firstDead < n) && (age[firstDead] < life[firstDead]))
+        firstDead++;
+    if (firstDead < n)
+        compact(firstDead);
+
+    return count;
+}
+
+void ParticlePool::compact(size_t firstDead)
+{
+    const size_t n = count;
+    const float* age = get(Age);
+    const float* life = get(Lifetime);
+
+    size_t living = firstDead;
+    for (size_t i = firstDead; i < n; i++)
+    {
+        alive[i] = age[i] < life[i];
+        if (alive[i])
+            living++;
+    }
+
+    // one type shares one lifetime and particles are added in time
+    // order, so usually the dead are simply the oldest ones up front
+    size_t deadRun = 0;
+    while ((deadRun < n) && (age[deadRun] >= life[deadRun]))
+        deadRun++;
+
+    if (n - deadRun == living)
+    {
+        for (int f = 0; f < FieldCount; f++)
+        {
+            float* v = &fields[f][0];
+            memmove(v, v + deadRun, living * sizeof(float));
+        }
+    }
+    else
+    {
+        for (int f = 0; f < FieldCount; f++)
+        {
+            float* v = &fields[f][0];
+            size_t w = firstDead;
+            for (size_t i = firstDead; i < n; i++)
+            {
+                if (alive[i])
+                    v[w++] = v[i];
+            }
+        }
+    }
+    count = living;
+}
+
+
+//****************** EffectBatch *******************************
+
+EffectBatch::EffectBatch()
+{
+    loadIdentity();
+    setColor(1, 1, 1, 1);
+}
+
+void EffectBatch::clear()
+{
+    instances.clear();
+    runs.clear();
+}
+
+void EffectBatch::loadIdentity()
+{
+    matrix[0] = 1; matrix[3] = 0; matrix[6] = 0;
+    matrix[1] = 0; matrix[4] = 1; matrix[7] = 0;
+    matrix[2] = 0; matrix[5] = 0; matrix[8] = 1;
+    origin[0] = origin[1] = origin[2] = 0;
+}
+
+void EffectBatch::translate(float x, float y, float z)
+{
+    origin[0] += matrix[0] * x + matrix[3] * y + matrix[6] * z;
+    origin[1] += matrix[1] * x + matrix[4] * y + matrix[7] * z;
+    origin[2] += matrix[2] * x + matrix[5] * y + matrix[8] * z;
+}
+
+void EffectBatch::multRotation(const float m[9])
+{
+    float result[9];
+    for (int c = 0; c < 3; c++)
+    {
+        for (int r = 0; r < 3; r++)
+        {
+            result[c * 3 + r] = matrix[r] * m[c * 3] +
+                                matrix[3 + r] * m[c * 3 + 1] +
+                                matrix[6 + r] * m[c * 3 + 2];
+        }
+    }
+    memcpy(matrix, result, sizeof(matrix));
+}
+
+void EffectBatch::rotateX(float degrees)
+{
+    const float c = cosf(degrees * deg2Rad);
+    const float s = sinf(degrees * deg2Rad);
+    const float m[9] = { 1, 0, 0,  0, c, s,  0, -s, c };
+    multRotation(m);
+}
+
+void EffectBatch::rotateY(float degrees)
+{
+    const float c = cosf(degrees * deg2Rad);
+    const float s = sinf(degrees * deg2Rad);
+    const float m[9] = { c, 0, -s,  0, 1, 0,  s, 0, c };
+    multRotation(m);
+}
+
+void EffectBatch::rotateZ(float degrees)
+{
+    const float c = cosf(degrees * deg2Rad);
+    const float s = sinf(degrees * deg2Rad);
+    const float m[9] = { c, s, 0,  -s, c, 0,  0, 0, 1 };
+    multRotation(m);
+}
+
+void EffectBatch::setColor(float r, float g, float b, float a)
+{
+    color[0] = r;
+    color[1] = g;
+    color[2] = b;
+    color[3] = a;
+}
+
+// sin and cos of each segment's start angle, most rings use 32
+static const float* ringTable(int segments)
+{
+    static std::vector<float> tables[65];
+    if ((segments < 1) || (segments > 64))
+        return NULL;
+    std::vector<float>& table = tables[segments];
+    if (table.empty())
+    {
+        table.resize((segments + 1) * 2);
+        for (int i = 0; i < segments; i++)
+        {
+            const float angle = 360.0f / segments * i;
+            table[i * 2] = sinf(angle * deg2Rad);
+            table[i * 2 + 1] = cosf(angle * deg2Rad);
+        }
+        // the last segment closes back at angle 0
+        table[segments * 2] = 0.0f;
+        table[segments * 2 + 1] = 1.0f;
+    }
+    return &table[0];
+}
+
+EffectInstance& EffectBatch::addInstance(Shape shape, int segments)
+{
+    if (runs.empty() || (runs.back().shape != shape) ||
+            (runs.back().segments != segments))
+    {
+        Run run;
+        run.shape = shape;
+        run.segments = segments;
+        run.first = instances.size();
+        run.count = 0;
+        runs.push_back(run);
+    }
+    runs.back().count++;
+
+    instances.resize(instances.size() + 1);
+    EffectInstance& instance = instances.back();
+    memcpy(instance.color, color, sizeof(color));
+    return instance;
+}
+
+// the unit ring stands along x: (top * height, cos * r, sin * r), with
+// r going from the bottom to the top radius and the last coordinate
+// kept from going below the lowest z.  an upright ring swaps x and z.
+void EffectBatch::addRing(float rad, float z, float topsideOffset,
+                          float bottomUV, float topUV, float lowestZ,
+                          int segments, bool upright)
+{
+    if (!ringTable(segments))
+        return;
+
+    EffectInstance& instance = addInstance(Ring, segments);
+    float* t = instance.transform;
+    const int first = upright ? 6 : 0;
+    const int third = upright ? 0 : 6;
+    for (int r = 0; r < 3; r++)
+    {
+        t[r] = matrix[first + r];
+        t[4 + r] = matrix[3 + r];
+        t[8 + r] = matrix[third + r];
+        t[12 + r] = origin[r];
+    }
+    t[3] = t[7] = t[11] = 0.0f;
+    t[15] = 1.0f;
+
+    instance.shape[0] = rad;
+    instance.shape[1] = rad + topsideOffset;
+    instance.shape[2] = z;
+    instance.shape[3] = lowestZ;
+    instance.uv[0] = bottomUV;
+    instance.uv[1] = topUV;
+    instance.uv[2] = instance.uv[3] = 0.0f;
+}
+
+void EffectBatch::addRingXY(float rad, float z, float topsideOffset,
+                            float bottomUV, float topUV, int segments)
+{
+    addRing(rad, z, topsideOffset, bottomUV, topUV, -FLT_MAX, segments, true);
+}
+
+void EffectBatch::addRingYZ(float rad, float z, float topsideOffset,
+                            float bottomUV, float ZOffset,
+                            float topUV, int segments)
+{
+    addRing(rad, z, topsideOffset, bottomUV, topUV, -ZOffset, segments, false);
+}
+
+void EffectBatch::addQuad(const float v[3][5])
+{
+    EffectInstance& instance = addInstance(Quad, 0);
+    float* t = instance.transform;
+
+    float sides[2][3];
+    for (int i = 0; i < 3; i++)
+    {
+        sides[0][i] = v[1][i] - v[0][i];
+        sides[1][i] = v[2][i] - v[0][i];
+    }
+    for (int r = 0; r < 3; r++)
+    {
+        t[r] = matrix[r] * sides[0][0] + matrix[3 + r] * sides[0][1] + matrix[6 + r] * sides[0][2];
+        t[4 + r] = matrix[r] * sides[1][0] + matrix[3 + r] * sides[1][1] + matrix[6 + r] * sides[1][2];
+        t[8 + r] = matrix[6 + r];
+        t[12 + r] = origin[r] + matrix[r] * v[0][0] + matrix[3 + r] * v[0][1] + matrix[6 + r] * v[0][2];
+    }
+    t[3] = t[7] = t[11] = 0.0f;
+    t[15] = 1.0f;
+
+    instance.shape[0] = v[1][3] - v[0][3];
+    instance.shape[1] = v[1][4] - v[0][4];
+    instance.shape[2] = v[2][3] - v[0][3];
+    instance.shape[3] = v[2][4] - v[0][4];
+    instance.uv[0] = v[0][3];
+    instance.uv[1] = v[0][4];
+    instance.uv[2] = instance.uv[3] = 0.0f;
+}
+
+static void addShapeVertex(std::vector<float>& vertices,
+                           float a, float b, float c, float d)
+{
+    vertices.push_back(a);
+    vertices.push_back(b);
+    vertices.push_back(c);
+    vertices.push_back(d);
+}
+
+void EffectBatch::getShapeVertices(Shape shape, int segments,
+                                   std::vector<float>& vertices)
+{
+    vertices.clear();
+
+    if (shape == Quad)
+    {
+        addShapeVertex(vertices, 0, 0, 0, 0);
+        addShapeVertex(vertices, 1, 0, 0, 0);
+        addShapeVertex(vertices, 0, 1, 0, 0);
+        addShapeVertex(vertices, 0, 1, 0, 0);
+        addShapeVertex(vertices, 1, 0, 0, 0);
+        addShapeVertex(vertices, 1, 1, 0, 0);
+        return;
+    }
+
+    const float* table = ringTable(segments);
+    if (!table)
+        return;
+
+    for (int i = 0; i < segments; i++)
+    {
+        const float* t0 = &table[i * 2];
+        const float* t1 = &table[(i + 1) * 2];
+
+        // the "inside", bottom to top
+        addShapeVertex(vertices, t0[0], t0[1], 0, 0);
+        addShapeVertex(vertices, t1[0], t1[1], 0, 1);
+        addShapeVertex(vertices, t0[0], t0[1], 1, 0);
+        addShapeVertex(vertices, t0[0], t0[1], 1, 0);
+        addShapeVertex(vertices, t1[0], t1[1], 0, 1);
+        addShapeVertex(vertices, t1[0], t1[1], 1, 1);
+
+        // the "outside", top to bottom
+        addShapeVertex(vertices, t0[0], t0[1], 1, 0);
+        addShapeVertex(vertices, t1[0], t1[1], 1, 1);
+        addShapeVertex(vertices, t0[0], t0[1], 0, 0);
+        addShapeVertex(vertices, t0[0], t0[1], 0, 0);
+        addShapeVertex(vertices, t1[0], t1[1], 1, 1);
+        addShapeVertex(vertices, t1[0], t1[1], 0, 1);
+    }
+}
+
+
+//****************** ParticleEmitter *******************************
+
+class BlossomSpawnEmitter : public ParticleEmitter
+{
+public:
+    BlossomSpawnEmitter() : ParticleEmitter("blend_flash", 2.0f, 1.75f, 5.0f) {};
+    virtual void build(EffectBatch& batch, const EffectView& view);
+};
+
+class ConeSpawnEmitter : public ParticleEmitter
+{
+public:
+    ConeSpawnEmitter() : ParticleEmitter("blend_flash", 2.0f, 1.75f, 5.0f) {};
+    virtual void build(EffectBatch& batch, const EffectView& view);
+};
+
+class RingSpawnEmitter : public ParticleEmitter
+{
+public:
+    RingSpawnEmitter() : ParticleEmitter("blend_flash", 2.0f, 4.0f, 0.0f) {};
+    virtual void build(EffectBatch& batch, const EffectView& view);
+};
+
+class SmokeShotEmitter : public ParticleEmitter
+{
+public:
+    SmokeShotEmitter() : ParticleEmitter("blend_flash", 1.5f, 0.125f, 6.0f) {};
+    virtual void build(EffectBatch& batch, const EffectView& view);
+};
+
+class FlashShotEmitter : public ParticleEmitter
+{
+public:
+    // we use the jump jet texture upside-down to get a decent muzzle flare effect
+    FlashShotEmitter() : ParticleEmitter("jumpjets", 0.75f, 0.5f, 0.0f) {};
+    virtual void build(EffectBatch& batch, const EffectView& view);
+};
+
+class ConeGMPuffEmitter : public ParticleEmitter
+{
+public:
+    ConeGMPuffEmitter() : ParticleEmitter("blend_flash", 6.5f, 0.125f, 0.5f) {};
+    virtual void build(EffectBatch& batch, const EffectView& view);
+protected:
+    ConeGMPuffEmitter(const char* textureName, float lifetime)
+        : ParticleEmitter(textureName, lifetime, 0.125f, 0.5f) {};
+};
+
+class SmokeGMPuffEmitter : public ConeGMPuffEmitter
+{
+public:
+    SmokeGMPuffEmitter() : ConeGMPuffEmitter("puffs", 3.5f) {};
+    virtual void build(EffectBatch& batch, const EffectView& view);
+protected:
+    virtual void initParticle(int index);
+};
+
+class LandEmitter : public ParticleEmitter
+{
+public:
+    LandEmitter() : ParticleEmitter("dusty_flare", 1.0f, 2.5f, 3.5f) {};
+    virtual void build(EffectBatch& batch, const EffectView& view);
+};
+
+class RicoEmitter : public ParticleEmitter
+{
+public:
+    RicoEmitter() : ParticleEmitter("blend_flash", 0.5f, 0.25f, 6.5f) {};
+    virtual void build(EffectBatch& batch, const EffectView& view);
+};
+
+class ShotTeleportEmitter : public ParticleEmitter
+{
+public:
+    ShotTeleportEmitter() : ParticleEmitter("dusty_flare", 4.0f, 0.25f, 0.0f) {};
+    virtual void build(EffectBatch& batch, const EffectView& view);
+};
+
+
+ParticleEmitter* ParticleEmitter::create(Type type)
+{
+    switch (type)
+    {
+    case SpawnBlossom:
+        return new BlossomSpawnEmitter;
+    case SpawnCone:
+        return new ConeSpawnEmitter;
+    case SpawnRings:
+        return new RingSpawnEmitter;
+    case ShotSmoke:
+        return new SmokeShotEmitter;
+    case ShotFlash:
+        return new FlashShotEmitter;
+    case GMPuffCone:
+        return new ConeGMPuffEmitter;
+    case GMPuffSmoke:
+        return new SmokeGMPuffEmitter;
+    case LandDirt:
+        return new LandEmitter;
+    case RicoRing:
+        return new RicoEmitter;
+    case ShotTeleport:
+        return new ShotTeleportEmitter;
+    default:
+        return NULL;
+    }
+}
+
+ParticleEmitter::ParticleEmitter(const char* _textureName, float _lifetime,
+                                 float _radius, float growth)
+    : lifetime(_lifetime), radius(_radius), textureName(_textureName)
+{
+    pool.setGrowth(growth);
+}
+
+void ParticleEmitter::emit(float time, const float* pos, const float* rot,
+                           const float* vel, const float* rgb)
+{
+    const int index = pool.add(time, lifetime, radius, pos, rot, vel, rgb);
+    if (index >= 0)
+        initParticle(index);
+}
+
+size_t ParticleEmitter::update(float time)
+{
+    return pool.update(time);
+}
+
+void ParticleEmitter::clear()
+{
+    pool.clear();
+}
+
+//******************BlossomSpawnEmitter****************
+void BlossomSpawnEmitter::build(EffectBatch& batch, const EffectView&)
+{
+    const size_t n = pool.size();
+    const float* x = pool.get(ParticlePool::PosX);
+    const float* y = pool.get(ParticlePool::PosY);
+    const float* z = pool.get(ParticlePool::PosZ);
+    const float* age = pool.get(ParticlePool::Age);
+    const float* ageParam = pool.get(ParticlePool::LifeParam);
+    const float* rad = pool.get(ParticlePool::Radius);
+    const float* red = pool.get(ParticlePool::Red);
+    const float* green = pool.get(ParticlePool::Green);
+    const float* blue = pool.get(ParticlePool::Blue);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        batch.loadIdentity();
+        batch.translate(x[i],y[i],z[i]+0.1f);
+        batch.setColor(red[i],green[i],blue[i],1.0f-ageParam[i]);
+
+        batch.addRingXY(rad[i]*0.1f,2.5f+(age[i]*2));
+        batch.addRingXY(rad[i]*0.5f,1.5f + (ageParam[i]/1.0f * 2),0.5f,0.5f);
+        batch.addRingXY(rad[i],2);
+    }
+}
+
+//******************ConeSpawnEmitter****************
+void ConeSpawnEmitter::build(EffectBatch& batch, const EffectView&)
+{
+    const size_t n = pool.size();
+    const float* x = pool.get(ParticlePool::PosX);
+    const float* y = pool.get(ParticlePool::PosY);
+    const float* z = pool.get(ParticlePool::PosZ);
+    const float* ageParam = pool.get(ParticlePool::LifeParam);
+    const float* rad = pool.get(ParticlePool::Radius);
+    const float* red = pool.get(ParticlePool::Red);
+    const float* green = pool.get(ParticlePool::Green);
+    const float* blue = pool.get(ParticlePool::Blue);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        batch.loadIdentity();
+        batch.translate(x[i],y[i],z[i]+0.1f);
+        batch.setColor(red[i],green[i],blue[i],1.0f-ageParam[i]);
+
+        batch.addRingXY(rad[i]*0.5f,1.25f);
+
+        batch.translate(0,0,2);
+        batch.addRingXY(rad[i]*0.6f,1.5f);
+
+        batch.translate(0,0,2);
+        batch.addRingXY(rad[i]*0.75f,1.75f);
+
+        batch.translate(0,0,2);
+        batch.addRingXY(rad[i]*0.85f,1.89f);
+
+        batch.translate(0,0,2);
+        batch.addRingXY(rad[i],2.0f);
+    }
+}
+
+//******************RingSpawnEmitter****************
+void RingSpawnEmitter::build(EffectBatch& batch, const EffectView&)
+{
+    const float maxZ = 10.0f;
+
+    float ringRange = lifetime / 4.0f;  // first 3/4ths of the life are rings, last is fade
+    ringRange = (ringRange * 3) / 4.0f; // of the ring section there are 4 ring segments
+
+    const float bigRange = ringRange * 3;
+
+    const size_t n = pool.size();
+    const float* x = pool.get(ParticlePool::PosX);
+    const float* y = pool.get(ParticlePool::PosY);
+    const float* z = pool.get(ParticlePool::PosZ);
+    const float* age = pool.get(ParticlePool::Age);
+    const float* rad = pool.get(ParticlePool::Radius);
+    const float* red = pool.get(ParticlePool::Red);
+    const float* green = pool.get(ParticlePool::Green);
+    const float* blue = pool.get(ParticlePool::Blue);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        float coreAlpha = 1;
+        if (age[i] >= bigRange)
+            coreAlpha = 1.0f - ((age[i] - bigRange) / (lifetime - bigRange));
+
+        for (int ring = 0; ring < 4; ++ring)
+        {
+            float posZ;
+            float alpha;
+
+            if (age[i] <= (ringRange * (ring-1)))  // this ring in?
+                continue;
+
+            if (age[i] < ringRange * ring)   // the ring is still coming in
+            {
+                posZ = maxZ - ((age[i] - ringRange * (ring-1)) / ringRange) * (maxZ - ring * 2.5f);
+                alpha = (age[i] - ringRange) / (ringRange * ring);
+            }
+            else
+            {
+                posZ = ring * 2.5f;
+                alpha = coreAlpha;
+            }
+
+            batch.loadIdentity();
+            batch.translate(x[i],y[i],z[i]+posZ);
+            batch.setColor(red[i],green[i],blue[i],alpha);
+            batch.addRingXY(rad[i], 2.5f * ring);
+        }
+    }
+}
+
+//******************SmokeShotEmitter****************
+void SmokeShotEmitter::build(EffectBatch& batch, const EffectView&)
+{
+    const size_t n = pool.size();
+    const float* x = pool.get(ParticlePool::CurX);
+    const float* y = pool.get(ParticlePool::CurY);
+    const float* z = pool.get(ParticlePool::CurZ);
+    const float* rot = pool.get(ParticlePool::RotZ);
+    const float* age = pool.get(ParticlePool::Age);
+    const float* ageParam = pool.get(ParticlePool::LifeParam);
+    const float* rad = pool.get(ParticlePool::Radius);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        batch.loadIdentity();
+        batch.translate(x[i],y[i],z[i]);
+        batch.rotateZ(180+rot[i]/deg2Rad);
+
+        //TODO: _muzzleFront and _muzzleHeight (4.42 and 1.57) should be
+        // the same as the tank model's muzzle (4.94 and 1.53).
+        // FlashShot is also affected by this todo.
+        batch.translate(-0.52f, 0.0f, -0.04f);
+
+        float alpha = 0.5f-ageParam[i];
+        if (alpha < 0.001f)
+            alpha = 0.001f;
+        batch.setColor(1,1,1,alpha);
+
+        batch.addRingYZ(rad[i],0.5f /*+ (age * 0.125f)*/,1.0f+age[i]*5,0.65f,z[i]);
+    }
+}
+
+//******************FlashShotEmitter****************
+void FlashShotEmitter::build(EffectBatch& batch, const EffectView& view)
+{
+    if (!view.hasViewer)
+    {
+        //just left the game
+        return;
+    }
+
+    const size_t n = pool.size();
+    const float* x = pool.get(ParticlePool::CurX);
+    const float* y = pool.get(ParticlePool::CurY);
+    const float* z = pool.get(ParticlePool::CurZ);
+    const float* rot = pool.get(ParticlePool::RotZ);
+    const float* ageParam = pool.get(ParticlePool::LifeParam);
+    const float* rad = pool.get(ParticlePool::Radius);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        float length;
+        if (ageParam[i] < 0.5f)
+            length = 6 * ageParam[i];
+        else
+            length = 6 * (1 - ageParam[i]);
+
+        batch.loadIdentity();
+        batch.translate(x[i],y[i],z[i]);
+        batch.rotateZ(270+rot[i]/deg2Rad);
+        batch.translate(0.0f, 0.52f, -0.04f);
+
+        //barrel roll to camera
+        float camerapos[3] =
+        {
+            view.viewerPos[0] - x[i],
+            view.viewerPos[1] - y[i],
+            view.viewerPos[2] - z[i]
+        };
+        camerapos[1] = camerapos[1] * cos(-rot[i])
+                       + camerapos[0] * sin(-rot[i]);
+        batch.rotateY(270 - atan(camerapos[1] / camerapos[2]) / deg2Rad +
+                      (camerapos[2] >= 0 ? 180 : 0)); //for a single-sided face
+
+        float alpha = 0.8f-ageParam[i];
+        if (alpha < 0.001f)
+            alpha = 0.001f;
+        batch.setColor(1,1,1,alpha);
+
+        const float quad[3][5] =
+        {
+            { 0, 0,      rad[i],  0, 1 },
+            { 0, length, rad[i],  0, 0 },
+            { 0, 0,      -rad[i], 1, 1 }
+        };
+        batch.addQuad(quad);
+    }
+}
+
+//******************ConeGMPuffEmitter****************
+void ConeGMPuffEmitter::build(EffectBatch& batch, const EffectView&)
+{
+    const size_t n = pool.size();
+    const float* x = pool.get(ParticlePool::CurX);
+    const float* y = pool.get(ParticlePool::CurY);
+    const float* z = pool.get(ParticlePool::CurZ);
+    const float* rotY = pool.get(ParticlePool::RotY);
+    const float* rotZ = pool.get(ParticlePool::RotZ);
+    const float* age = pool.get(ParticlePool::Age);
+    const float* ageParam = pool.get(ParticlePool::LifeParam);
+    const float* rad = pool.get(ParticlePool::Radius);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        batch.loadIdentity();
+        batch.translate(x[i],y[i],z[i]);
+        batch.rotateZ(180+rotZ[i]/deg2Rad);
+        batch.rotateY(rotY[i]/deg2Rad);
+
+        float alpha = 0.5f-ageParam[i];
+        if (alpha < 0.000001f)
+            alpha = 0.000001f;
+        batch.setColor(1,1,1,alpha);
+
+        batch.addRingYZ(rad[i],-0.25f -(age[i] * 0.125f),0.5f+age[i]*0.75f,0.50f,z[i]);
+    }
+}
+
+//******************SmokeGMPuffEmitter****************
+void SmokeGMPuffEmitter::initParticle(int index)
+{
+    float randMod = 0.5f;
+
+    pool.get(ParticlePool::Extra0)[index] = ((float)bzfrand() * (randMod*2)) - randMod;
+    pool.get(ParticlePool::Extra1)[index] = ((float)bzfrand() * (randMod*2)) - randMod;
+    pool.get(ParticlePool::Extra2)[index] = ((float)bzfrand() * (randMod*2)) - randMod;
+
+    // which quarter of the texture to use
+    pool.get(ParticlePool::Extra3)[index] = (bzfrand() < 0.5) ? 0.0f : 0.5f;
+    pool.get(ParticlePool::Extra4)[index] = (bzfrand() < 0.5) ? 0.0f : 0.5f;
+}
+
+void SmokeGMPuffEmitter::build(EffectBatch& batch, const EffectView& view)
+{
+    const size_t n = pool.size();
+    const float* x = pool.get(ParticlePool::CurX);
+    const float* y = pool.get(ParticlePool::CurY);
+    const float* z = pool.get(ParticlePool::CurZ);
+    const float* jitterX = pool.get(ParticlePool::Extra0);
+    const float* jitterY = pool.get(ParticlePool::Extra1);
+    const float* jitterZ = pool.get(ParticlePool::Extra2);
+    const float* u = pool.get(ParticlePool::Extra3);
+    const float* v = pool.get(ParticlePool::Extra4);
+    const float* age = pool.get(ParticlePool::Age);
+    const float* ageParam = pool.get(ParticlePool::LifeParam);
+    const float du = 0.5f;
+    const float dv = 0.5f;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        float vertDrift = 1.5f * age[i];
+
+        batch.loadIdentity();
+        batch.translate(x[i]+jitterX[i],y[i]+jitterY[i],z[i]+jitterZ[i]+vertDrift);
+        batch.multRotation(view.billboard);
+        batch.rotateZ(age[i]*180);
+
+        float alpha = 0.5f-ageParam[i];
+        if (alpha < 0.000001f)
+            alpha = 0.000001f;
+        batch.setColor(1,1,1,alpha);
+
+        float size = 0.5f + (age[i] * 1.25f);
+
+        const float quad[3][5] =
+        {
+            { -size, -size, 0, u[i],    v[i] },
+            { +size, -size, 0, u[i]+du, v[i] },
+            { -size, +size, 0, u[i],    v[i]+dv }
+        };
+        batch.addQuad(quad);
+    }
+}
+
+//******************LandEmitter****************
+void LandEmitter::build(EffectBatch& batch, const EffectView&)
+{
+    const size_t n = pool.size();
+    const float* x = pool.get(ParticlePool::PosX);
+    const float* y = pool.get(ParticlePool::PosY);
+    const float* z = pool.get(ParticlePool::PosZ);
+    const float* age = pool.get(ParticlePool::Age);
+    const float* ageParam = pool.get(ParticlePool::LifeParam);
+    const float* rad = pool.get(ParticlePool::Radius);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        batch.loadIdentity();
+        batch.translate(x[i],y[i],z[i]);
+        batch.setColor(1,1,1,1.0f-ageParam[i]);
+
+        batch.addRingXY(rad[i],0.5f + age[i],0.05f*rad[i],0.0f,0.9f);
+    }
+}
+
+//******************RicoEmitter****************
+void RicoEmitter::build(EffectBatch& batch, const EffectView&)
+{
+    const size_t n = pool.size();
+    const float* x = pool.get(ParticlePool::CurX);
+    const float* y = pool.get(ParticlePool::CurY);
+    const float* z = pool.get(ParticlePool::CurZ);
+    const float* rotY = pool.get(ParticlePool::RotY);
+    const float* rotZ = pool.get(ParticlePool::RotZ);
+    const float* ageParam = pool.get(ParticlePool::LifeParam);
+    const float* rad = pool.get(ParticlePool::Radius);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        batch.loadIdentity();
+        batch.translate(x[i],y[i],z[i]);
+        batch.rotateZ((rotZ[i]/deg2Rad)+180);
+        batch.rotateY(rotY[i]/deg2Rad);
+
+        float alpha = 0.5f-ageParam[i];
+        if (alpha < 0.000001f)
+            alpha = 0.000001f;
+        batch.setColor(1,1,1,alpha);
+
+        batch.addRingYZ(rad[i],-0.5f,0.5f,0.50f,z[i]);
+    }
+}
+
+//******************ShotTeleportEmitter****************
+void ShotTeleportEmitter::build(EffectBatch& batch, const EffectView&)
+{
+    const size_t n = pool.size();
+    const float* x = pool.get(ParticlePool::CurX);
+    const float* y = pool.get(ParticlePool::CurY);
+    const float* z = pool.get(ParticlePool::CurZ);
+    const float* rotY = pool.get(ParticlePool::RotY);
+    const float* rotZ = pool.get(ParticlePool::RotZ);
+    const float* age = pool.get(ParticlePool::Age);
+    const float* rad = pool.get(ParticlePool::Radius);
+
+    batch.setColor(1,1,1,1);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        batch.loadIdentity();
+        batch.translate(x[i],y[i],z[i]);
+        batch.rotateZ(rotZ[i]/deg2Rad);
+        batch.rotateY(rotY[i]/deg2Rad);
+        batch.rotateX(age[i]*90);
+
+        float mod = age[i]-(int)age[i];
+        mod -= 0.5f;
+
+        batch.addRingYZ(rad[i],0.5f + mod*0.5f,0.125f,0.00f,z[i],0.8f,6);
+    }
+}
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
@@ -0,0 +1,320 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+* EffectParticles:
+*   Pooled storage, simulation and instance building for the short
+*   lived effects.  Nothing in here touches GL, so effect storms can
+*   be simulated and built without a window.
+*/
+
+#ifndef BZF_EFFECT_PARTICLES_H
+#define BZF_EFFECT_PARTICLES_H
+
+#include "common.h"
+
+/* system headers */
+#include <vector>
+
+
+/** ParticlePool keeps the live particles of one effect type as
+    parallel arrays, one per Field.  The arrays only ever grow (up to
+    the capacity), so once a pool has warmed up adding and expiring
+    particles allocates nothing.  Particles stay in the order they
+    were added.
+*/
+class ParticlePool
+{
+public:
+    enum Field
+    {
+        StartTime,
+        Lifetime,
+        Age,            // set by update()
+        LifeParam,      // age / lifetime, set by update()
+        PosX, PosY, PosZ,       // where it was spawned
+        CurX, CurY, CurZ,       // spawn position moved along the velocity, set by update()
+        VelX, VelY, VelZ,
+        RotY, RotZ,     // radians
+        Red, Green, Blue,
+        Radius0,        // radius when spawned
+        Radius,         // Radius0 grown by the growth rate, set by update()
+        Extra0, Extra1, Extra2, Extra3, Extra4, // whatever else a type needs
+        FieldCount
+    };
+
+    ParticlePool(size_t capacity = 4096);
+
+    // returns the index of the new particle, or -1 if the pool is full.
+    // any of pos, rot, vel and rgb may be NULL for zeroes.
+    int     add(float startTime, float lifetime, float radius,
+                const float* pos, const float* rot,
+                const float* vel, const float* rgb);
+
+    // age every particle to time, move it and grow its radius, then
+    // drop the expired ones.  returns the number still alive.
+    size_t  update(float time);
+
+    void    clear();
+
+    void    setGrowth(float radiusPerSecond);
+
+    size_t  size() const;
+    size_t  getCapacity() const;
+    // particles refused because the pool was full
+    unsigned int getDropped() const;
+
+    float*  get(Field field);
+    const float* get(Field field) const;
+
+private:
+    void    grow();
+    void    compact(size_t firstDead);
+
+private:
+    std::vector<float> fields[FieldCount];
+    std::vector<unsigned char> alive;
+    size_t  count;
+    size_t  allocated;
+    size_t  capacity;
+    float   growth;
+    unsigned int dropped;
+};
+
+
+/** EffectInstance is one ring or quad of an effect, laid out the way
+    the instanced shader reads it so a batch uploads in one copy.
+*/
+struct EffectInstance
+{
+    float transform[16];    // column-major, from the shape to the world
+    float color[4];
+    float shape[4];         // rings: bottom and top radius, height, lowest z
+                            // quads: s and t along the first side, then the second
+    float uv[4];            // rings: t at the bottom and the top
+                            // quads: s and t at the first corner
+};
+
+
+/** EffectBatch collects the rings and quads of many effects as
+    instances of a few unit shapes, to be drawn with one instanced
+    call per run.  The transform calls work like their GL matrix stack
+    namesakes, so effects build their geometry the same way they used
+    to draw it.
+*/
+class EffectBatch
+{
+public:
+    enum Shape
+    {
+        Ring,
+        Quad
+    };
+
+    // consecutive instances of the same shape
+    struct Run
+    {
+        Shape   shape;
+        int     segments;   // rings only
+        size_t  first;
+        size_t  count;
+    };
+
+    EffectBatch();
+
+    void    clear();
+
+    void    loadIdentity();
+    void    translate(float x, float y, float z);
+    void    rotateX(float degrees);
+    void    rotateY(float degrees);
+    void    rotateZ(float degrees);
+    // post-multiply by a column-major 3x3 rotation
+    void    multRotation(const float m[9]);
+
+    void    setColor(float r, float g, float b, float a);
+
+    // the ring shapes of the old effects
+    void    addRingXY(float rad, float z, float topsideOffset = 0,
+                      float bottomUV = 0, float topUV = 1.0f,
+                      int segments = 32);
+    void    addRingYZ(float rad, float z, float topsideOffset = 0,
+                      float bottomUV = 0, float ZOffset = 0,
+                      float topUV = 1.0f, int segments = 32);
+
+    // a parallelogram as x y z s t of three corners: the first one
+    // and its two neighbours.  its triangles are 0 1 2 and 2 1 3,
+    // like a four vertex strip with the fourth corner left out.
+    void    addQuad(const float v[3][5]);
+
+    size_t  getInstanceCount() const;
+    const EffectInstance* getInstances() const;
+    const std::vector<Run>& getRuns() const;
+
+    // the triangles of a unit shape, four floats per vertex.  rings
+    // use sin, cos, 0 or 1 for the bottom or top edge, and s.  quads
+    // use the distance along the first and the second side.
+    static void getShapeVertices(Shape shape, int segments,
+                                 std::vector<float>& vertices);
+
+private:
+    EffectInstance& addInstance(Shape shape, int segments);
+    void    addRing(float rad, float z, float topsideOffset,
+                    float bottomUV, float topUV, float lowestZ,
+                    int segments, bool upright);
+
+private:
+    float   matrix[9];      // column-major rotation
+    float   origin[3];
+    float   color[4];
+    std::vector<EffectInstance> instances;
+    std::vector<Run> runs;
+};
+
+
+// the part of the view that emitters need to build their geometry
+struct EffectView
+{
+    float billboard[9];     // column-major rotation facing the camera
+    bool hasViewer;
+    float viewerPos[3];     // the local tank
+};
+
+
+/** ParticleEmitter is one effect type.  Its live effects are kept in
+    a ParticlePool, and build() adds all of them to a batch in a
+    single loop so they are drawn together.
+*/
+class ParticleEmitter
+{
+public:
+    enum Type
+    {
+        SpawnBlossom,
+        SpawnCone,
+        SpawnRings,
+        ShotSmoke,
+        ShotFlash,
+        GMPuffCone,
+        GMPuffSmoke,
+        LandDirt,
+        RicoRing,
+        ShotTeleport,
+        TypeCount
+    };
+
+    static ParticleEmitter* create(Type type);
+
+    virtual ~ParticleEmitter() {};
+
+    // any of rot, vel and rgb may be NULL
+    void    emit(float time, const float* pos, const float* rot,
+                 const float* vel, const float* rgb);
+    size_t  update(float time);
+    void    clear();
+
+    virtual void build(EffectBatch& batch, const EffectView& view) = 0;
+
+    size_t  size() const;
+    float   getLifetime() const;
+    const char* getTextureName() const;
+    unsigned int getDropped() const;
+
+protected:
+    ParticleEmitter(const char* textureName, float lifetime,
+                    float radius, float growth);
+
+    // fill in any Extra fields of a new particle
+    virtual void initParticle(int UNUSED(index)) {};
+
+    ParticlePool pool;
+    float   lifetime;
+    float   radius;
+    const char* textureName;
+};
+
+
+inline size_t ParticlePool::size() const
+{
+    return count;
+}
+
+inline size_t ParticlePool::getCapacity() const
+{
+    return capacity;
+}
+
+inline unsigned int ParticlePool::getDropped() const
+{
+    return dropped;
+}
+
+inline void ParticlePool::setGrowth(float radiusPerSecond)
+{
+    growth = radiusPerSecond;
+}
+
+inline float* ParticlePool::get(Field field)
+{
+    return fields[field].empty() ? NULL : &fields[field][0];
+}
+
+inline const float* ParticlePool::get(Field field) const
+{
+    return fields[field].empty() ? NULL : &fields[field][0];
+}
+
+inline size_t EffectBatch::getInstanceCount() const
+{
+    return instances.size();
+}
+
+inline const EffectInstance* EffectBatch::getInstances() const
+{
+    return instances.empty() ? NULL : &instances[0];
+}
+
+inline const std::vector<EffectBatch::Run>& EffectBatch::getRuns() const
+{
+    return runs;
+}
+
+inline size_t ParticleEmitter::size() const
+{
+    return pool.size();
+}
+
+inline float ParticleEmitter::getLifetime() const
+{
+    return lifetime;
+}
+
+inline const char* ParticleEmitter::getTextureName() const
+{
+    return textureName;
+}
+
+inline unsigned int ParticleEmitter::getDropped() const
+{
+    return pool.getDropped();
+}
+
+
+#endif // BZF_EFFECT_PARTICLES_H
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
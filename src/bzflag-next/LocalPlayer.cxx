@@ -25,6 +25,7 @@
 /* local implementation headers */
 #include "World.h"
 #include "sound.h"
+#include "MagnumEffectsRenderer.h"
 
 /* system implementation headers */
 #include <algorithm>
@@ -792,7 +793,7 @@ void            LocalPlayer::doUpdateMotion(float dt)
     if (justLanded)
     {
         setLandingSpeed(oldVelocity[2]);
-        //EFFECTS.addLandEffect(getColor(),newPos,getAngle());
+        MagnumEffectsRenderer::instance().addLandEffect(getColor(),newPos,getAngle());
     }
     if (gettingSound)
     {
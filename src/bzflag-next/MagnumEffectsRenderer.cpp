@@ -0,0 +1,366 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+// interface header
+#include "MagnumEffectsRenderer.h"
+
+// system headers
+#include <map>
+#include <string.h>
+#include <vector>
+
+// Magnum headers
+#include <Corrade/Containers/ArrayView.h>
+#include <Magnum/GL/Buffer.h>
+#include <Magnum/GL/Context.h>
+#include <Magnum/GL/Mesh.h>
+#include <Magnum/GL/Renderer.h>
+#include <Magnum/GL/Texture.h>
+#include <Magnum/Math/Matrix4.h>
+#include <Magnum/SceneGraph/Camera.h>
+
+// common impl headers
+#include "StateDatabase.h"
+#include "TimeKeeper.h"
+#include "MagnumTextureManager.h"
+#include "EffectInstanceShader.h"
+
+// local impl headers
+#include "LocalPlayer.h"
+
+using namespace Magnum;
+
+
+// one unit shape and the instance buffer bound to it
+struct ShapeMesh
+{
+    GL::Buffer vertices;
+    GL::Mesh mesh;
+};
+
+struct MagnumEffectsRenderer::GLResources
+{
+    GLResources() :
+        ringShader(EffectInstanceShader::Shape::Ring),
+        quadShader(EffectInstanceShader::Shape::Quad),
+        textureGeneration(0)
+    {
+        for (int i = 0; i < ParticleEmitter::TypeCount; i++)
+            textures[i] = NULL;
+    }
+
+    ShapeMesh& getMesh(EffectBatch::Shape shape, int segments);
+
+    EffectInstanceShader ringShader;
+    EffectInstanceShader quadShader;
+    GL::Buffer instances;
+    std::map<int, ShapeMesh> meshes;    // rings by segments, the quad at 0
+
+    GL::Texture2D* textures[ParticleEmitter::TypeCount];
+    unsigned int textureGeneration;
+};
+
+ShapeMesh& MagnumEffectsRenderer::GLResources::getMesh(EffectBatch::Shape shape, int segments)
+{
+    const int key = (shape == EffectBatch::Quad) ? 0 : segments;
+    std::map<int, ShapeMesh>::iterator it = meshes.find(key);
+    if (it != meshes.end())
+        return it->second;
+
+    ShapeMesh& shapeMesh = meshes[key];
+
+    std::vector<float> vertices;
+    EffectBatch::getShapeVertices(shape, segments, vertices);
+    shapeMesh.vertices.setData(Containers::arrayView(vertices.data(), vertices.size()));
+
+    shapeMesh.mesh.setPrimitive(GL::MeshPrimitive::Triangles)
+    .setCount((Int)(vertices.size() / 4))
+    .addVertexBuffer(shapeMesh.vertices, 0, EffectInstanceShader::Vertex{})
+    .addVertexBufferInstanced(instances, 1, 0,
+                              EffectInstanceShader::Transformation{},
+                              EffectInstanceShader::Color{},
+                              EffectInstanceShader::ShapeParameters{},
+                              EffectInstanceShader::TextureParameters{});
+    return shapeMesh;
+}
+
+
+MagnumEffectsRenderer::MagnumEffectsRenderer()
+{
+    for (int i = 0; i < ParticleEmitter::TypeCount; i++)
+        emitters[i] = ParticleEmitter::create((ParticleEmitter::Type)i);
+}
+
+MagnumEffectsRenderer::~MagnumEffectsRenderer()
+{
+    // the context may already be gone at exit, leak rather than crash
+    if (resources && !GL::Context::hasCurrent())
+        resources.release();
+
+    for (int i = 0; i < ParticleEmitter::TypeCount; i++)
+        delete emitters[i];
+}
+
+void MagnumEffectsRenderer::init(void)
+{
+    for (int i = 0; i < ParticleEmitter::TypeCount; i++)
+        emitters[i]->clear();
+}
+
+void MagnumEffectsRenderer::update(void)
+{
+    float time = (float)TimeKeeper::getCurrent().getSeconds();
+
+    for (int i = 0; i < ParticleEmitter::TypeCount; i++)
+        emitters[i]->update(time);
+}
+
+void MagnumEffectsRenderer::freeContext(void)
+{
+    resources = nullptr;
+}
+
+static void getEffectView(SceneGraph::Camera3D& camera, EffectView& view)
+{
+    // the billboard is the inverse of the camera rotation
+    const Matrix3x3 billboard = camera.cameraMatrix().rotation().transposed();
+    memcpy(view.billboard, billboard.data(), sizeof(view.billboard));
+
+    const LocalPlayer* myTank = LocalPlayer::getMyTank();
+    view.hasViewer = (myTank != NULL);
+    if (myTank)
+    {
+        const float* pos = myTank->getPosition();
+        view.viewerPos[0] = pos[0];
+        view.viewerPos[1] = pos[1];
+        view.viewerPos[2] = pos[2];
+    }
+}
+
+void MagnumEffectsRenderer::draw(SceneGraph::Camera3D& camera)
+{
+    size_t live = 0;
+    for (int i = 0; i < ParticleEmitter::TypeCount; i++)
+        live += emitters[i]->size();
+    if (live == 0)
+        return;
+
+    if (!resources)
+        resources = Containers::pointer<GLResources>();
+
+    // look the textures up again when the manager has dropped some
+    MagnumTextureManager &tm = MagnumTextureManager::instance();
+    if (resources->textureGeneration != tm.getTextureGeneration())
+    {
+        for (int i = 0; i < ParticleEmitter::TypeCount; i++)
+            resources->textures[i] = NULL;
+        resources->textureGeneration = tm.getTextureGeneration();
+    }
+
+    EffectView view;
+    getEffectView(camera, view);
+
+    const Matrix4 transformationProjection = camera.projectionMatrix()*camera.cameraMatrix();
+
+    GL::Renderer::enable(GL::Renderer::Feature::DepthTest);
+    GL::Renderer::enable(GL::Renderer::Feature::FaceCulling);
+    GL::Renderer::enable(GL::Renderer::Feature::Blending);
+    GL::Renderer::setBlendFunction(GL::Renderer::BlendFunction::SourceAlpha,
+                                   GL::Renderer::BlendFunction::OneMinusSourceAlpha);
+    GL::Renderer::setDepthMask(false);
+
+    for (int i = 0; i < ParticleEmitter::TypeCount; i++)
+    {
+        if (emitters[i]->size() == 0)
+            continue;
+
+        batch.clear();
+        emitters[i]->build(batch, view);
+        if (batch.getInstanceCount() == 0)
+            continue;
+
+        if (!resources->textures[i])
+            resources->textures[i] = tm.requestTexture(emitters[i]->getTextureName()).texture;
+        if (!resources->textures[i])
+            continue;
+
+        const std::vector<EffectBatch::Run>& runs = batch.getRuns();
+        for (size_t r = 0; r < runs.size(); r++)
+        {
+            const EffectBatch::Run& run = runs[r];
+            resources->instances.setData(Containers::arrayView(batch.getInstances() + run.first, run.count),
+                                         GL::BufferUsage::StreamDraw);
+
+            ShapeMesh& shapeMesh = resources->getMesh(run.shape, run.segments);
+            shapeMesh.mesh.setInstanceCount((Int)run.count);
+
+            EffectInstanceShader& shader = (run.shape == EffectBatch::Ring) ?
+                                           resources->ringShader : resources->quadShader;
+            shader.setTransformationProjectionMatrix(transformationProjection)
+            .bindTexture(*resources->textures[i])
+            .draw(shapeMesh.mesh);
+        }
+    }
+
+    GL::Renderer::setDepthMask(true);
+    GL::Renderer::disable(GL::Renderer::Feature::Blending);
+}
+
+void MagnumEffectsRenderer::emit(ParticleEmitter::Type type, const float* pos,
+                                 const float* rot, const float* vel,
+                                 const float* rgb)
+{
+    emitters[type]->emit((float)TimeKeeper::getCurrent().getSeconds(), pos, rot, vel, rgb);
+}
+
+void MagnumEffectsRenderer::addSpawnEffect ( const float* rgb, const float* pos )
+{
+    if (!BZDB.isTrue("useFancyEffects"))
+        return;
+
+    int flashType = static_cast<int>(BZDB.eval("spawnEffect"));
+
+    switch (flashType)
+    {
+    case 1:
+        emit(ParticleEmitter::SpawnBlossom, pos, NULL, NULL, rgb);
+        break;
+
+    case 2:
+        emit(ParticleEmitter::SpawnCone, pos, NULL, NULL, rgb);
+        break;
+
+    case 3:
+        emit(ParticleEmitter::SpawnRings, pos, NULL, NULL, rgb);
+        break;
+    }
+}
+
+void MagnumEffectsRenderer::addShotEffect ( const float* rgb, const float* pos, float rot, const float *vel, int _type)
+{
+    if (!BZDB.isTrue("useFancyEffects"))
+        return;
+
+    int flashType = _type;
+    if (flashType < 0)
+        flashType = static_cast<int>(BZDB.eval("shotEffect"));
+
+    float rots[3] = {0};
+    rots[2] = rot;
+
+    if (!BZDB.isTrue("useVelOnShotEffects"))
+        vel = NULL;
+
+    switch (flashType)
+    {
+    case 1:
+        emit(ParticleEmitter::ShotSmoke, pos, rots, vel, rgb);
+        break;
+    case 2:
+        emit(ParticleEmitter::ShotFlash, pos, rots, vel, rgb);
+        break;
+    case 3:
+        // composite effect
+        emit(ParticleEmitter::ShotSmoke, pos, rots, vel, rgb);
+        emit(ParticleEmitter::ShotFlash, pos, rots, vel, rgb);
+        break;
+    }
+}
+
+void MagnumEffectsRenderer::addGMPuffEffect ( const float* pos, float rot[2], const float* vel)
+{
+    if (!BZDB.isTrue("useFancyEffects"))
+        return;
+
+    int flashType = static_cast<int>(BZDB.eval("gmPuffEffect"));
+
+    float rots[3] = {0};
+    rots[2] = rot[0];
+    rots[1] = rot[1];
+
+    if (!BZDB.isTrue("useVelOnShotEffects"))
+        vel = NULL;
+
+    switch (flashType)
+    {
+    case 1:
+        // handled outside this manager in the "old" code
+        break;
+
+    case 2:
+        emit(ParticleEmitter::GMPuffCone, pos, rots, vel, NULL);
+        break;
+
+    case 3:
+        emit(ParticleEmitter::GMPuffSmoke, pos, rots, vel, NULL);
+        break;
+    }
+}
+
+void MagnumEffectsRenderer::addLandEffect ( const float* rgb, const float* pos, float rot )
+{
+    if (!BZDB.isTrue("useFancyEffects"))
+        return;
+
+    int effectType = static_cast<int>(BZDB.eval("landEffect"));
+
+    float rots[3] = {0};
+    rots[2] = rot;
+
+    if (effectType == 1)
+        emit(ParticleEmitter::LandDirt, pos, rots, NULL, rgb);
+}
+
+void MagnumEffectsRenderer::addRicoEffect ( const float* pos, float rot[2], const float* vel)
+{
+    if (!BZDB.isTrue("useFancyEffects"))
+        return;
+
+    int flashType = static_cast<int>(BZDB.eval("ricoEffect"));
+
+    float rots[3] = {0};
+    rots[2] = rot[0];
+    rots[1] = rot[1];
+
+    if (!BZDB.isTrue("useVelOnShotEffects"))
+        vel = NULL;
+
+    if (flashType == 1)
+        emit(ParticleEmitter::RicoRing, pos, rots, vel, NULL);
+}
+
+void MagnumEffectsRenderer::addShotTeleportEffect ( const float* pos, float rot[2], const float* vel)
+{
+    if (!BZDB.isTrue("useFancyEffects"))
+        return;
+
+    int flashType = static_cast<int>(BZDB.eval("tpEffect"));
+
+    float rots[3] = {0};
+    rots[2] = rot[0];
+    rots[1] = rot[1];
+
+    if (!BZDB.isTrue("useVelOnShotEffects"))
+        vel = NULL;
+
+    if (flashType == 1)
+        emit(ParticleEmitter::ShotTeleport, pos, rots, vel, NULL);
+}
+
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
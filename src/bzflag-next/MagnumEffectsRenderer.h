@@ -0,0 +1,91 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+* MagnumEffectsRenderer:
+*   The short lived effects (spawn flashes, shot flashes, landings, ...)
+*   for the Magnum client.  Each effect type is a ParticleEmitter, and
+*   its effects are drawn as instances of a unit ring or quad with one
+*   instanced draw per type.
+*/
+
+#ifndef BZF_MAGNUM_EFFECTS_RENDERER_H
+#define BZF_MAGNUM_EFFECTS_RENDERER_H
+
+#include "common.h"
+
+#include <Corrade/Containers/Pointer.h>
+#include <Magnum/SceneGraph/SceneGraph.h>
+
+#include "Singleton.h"
+#include "EffectParticles.h"
+
+class MagnumEffectsRenderer : public Singleton<MagnumEffectsRenderer>
+{
+public:
+    // called to drop all the current effects
+    void init(void);
+
+    // called to update the various effects
+    void update(void);
+
+    // called to draw all the current effects over the scene
+    void draw(Magnum::SceneGraph::Camera3D& camera);
+
+    // called before the GL context goes away
+    void freeContext(void);
+
+    // spawn flashes
+    void addSpawnEffect ( const float* rgb, const float* pos );
+
+    // shot flashes
+    void addShotEffect ( const float* rgb, const float* pos, float rot, const float* vel = NULL, int _type = -1 );
+
+    // gm puffs
+    void addGMPuffEffect ( const float* pos, float rot[2], const float* vel = NULL );
+
+    // landing effects
+    void addLandEffect ( const float* rgb, const float* pos, float rot );
+
+    // rico effect
+    void addRicoEffect ( const float* pos, float rot[2], const float* vel = NULL );
+
+    // shot teleport effect
+    void addShotTeleportEffect ( const float* pos, float rot[2], const float* vel = NULL );
+
+protected:
+    friend class Singleton<MagnumEffectsRenderer>;
+
+private:
+    MagnumEffectsRenderer();
+    ~MagnumEffectsRenderer();
+
+    void emit(ParticleEmitter::Type type, const float* pos, const float* rot,
+              const float* vel, const float* rgb);
+
+    // shaders, meshes and textures, made on the first draw
+    struct GLResources;
+
+    ParticleEmitter* emitters[ParticleEmitter::TypeCount];
+    EffectBatch batch;
+    Corrade::Containers::Pointer<GLResources> resources;
+};
+
+#endif // BZF_MAGNUM_EFFECTS_RENDERER_H
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
@@ -27,6 +27,7 @@
 #include "TrackMarks.h"
 #include "sound.h"
 #include "Roaming.h"
+#include "MagnumEffectsRenderer.h"
 
 #include "TankObjectBuilder.h"
 #include "SceneObjectManager.h"
@@ -1186,7 +1187,8 @@ void Player::addShots(SceneDatabase* scene, bool colorblind) const
 }
 
 
-const void* Player::unpack(const void* buf, uint16_t code)
+const void* Player::unpack(const void* buf, uint16_t code,
+                          const TimeKeeper* arrivalTime)
 {
     float timestamp;
     PlayerId ident;
@@ -1195,13 +1197,38 @@ const void* Player::unpack(const void* buf, uint16_t code)
     buf = nboUnpackUByte(buf, ident);
     buf = state.unpack(buf, code);
 
-    setDeadReckoning(timestamp);
-    setRelativeMotion();
+    stateUpdated(timestamp, arrivalTime);
 
     return buf;
 }
 
 
+void Player::setState(const PlayerState& newState, float timestamp,
+                      const TimeKeeper* arrivalTime)
+{
+    state = newState;
+    stateUpdated(timestamp, arrivalTime);
+}
+
+
+void Player::stateUpdated(float timestamp, const TimeKeeper* arrivalTime)
+{
+    setDeadReckoning(timestamp);
+
+    // extrapolate from when the update came in rather than from when
+    // the game got around to it.  the arrival is wall clock time and the
+    // fixed step tick trails that by up to a step, so only the age of
+    // the update is carried over to the tick
+    if (arrivalTime != NULL)
+    {
+        const double age = TimeKeeper::getCurrent() - *arrivalTime;
+        if (age > 0.0)
+            inputTime += -age;
+    }
+    setRelativeMotion();
+}
+
+
 bool Player::validTeamTarget(const Player *possibleTarget) const
 {
     TeamColor myTeam = getTeam();
@@ -1455,7 +1482,7 @@ void Player::doDeadReckoning()
             setLandingSpeed(oldZSpeed);
 
             // make it "land"
-            //EFFECTS.addLandEffect(getColor(),state.pos,state.azimuth);
+            MagnumEffectsRenderer::instance().addLandEffect(getColor(),state.pos,state.azimuth);
 
             // setup the sound
             if (BZDB.isTrue("remoteSounds"))
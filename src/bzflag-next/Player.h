@@ -189,7 +189,10 @@ public:
     void      addHitToStats(FlagType* flag);
 
     void*     pack(void*, uint16_t& code);
-    const void*   unpack(const void*, uint16_t code);
+    const void*   unpack(const void*, uint16_t code,
+                         const TimeKeeper* arrivalTime = NULL);
+    void      setState(const PlayerState&, float timestamp,
+                       const TimeKeeper* arrivalTime = NULL);
 
     void      setDeadReckoning();
     void      setDeadReckoning(float timestamp);
@@ -248,6 +251,7 @@ private:
     void updateJumpJets(float dt);
     void updateTrackMarks();
     bool hitObstacleResizing();
+    void stateUpdated(float timestamp, const TimeKeeper* arrivalTime);
 
 private:
     // data not communicated with other players
@@ -24,6 +24,7 @@
 #include <ctype.h>
 #include <time.h>
 #include <vector>
+#include <system_error>
 #if !defined(_WIN32)
 #include <unistd.h>
 #include <errno.h>
@@ -84,6 +85,29 @@ TimeKeeper packetStartTime;
 static const unsigned long serverPacket = 1;
 static const unsigned long endPacket = 0;
 
+// messages the receive thread can hold before it stops reading
+static const size_t inboundQueueSize = 512;
+
+static void recordServerPacket(uint16_t code, uint16_t len, const void* msg)
+{
+    if (!packetStream)
+        return;
+    char headerBuffer[4];
+    void* buf = headerBuffer;
+    buf = nboPackUShort(buf, len);
+    buf = nboPackUShort(buf, code);
+    long dt = (long)((TimeKeeper::getCurrent() - packetStartTime) * 10000.0f);
+    size_t items_written = fwrite(&serverPacket, sizeof(serverPacket), 1, packetStream);
+    if (items_written == 1)
+        items_written = fwrite(&dt, sizeof(dt), 1, packetStream);
+    if (items_written == 1)
+        items_written = fwrite(headerBuffer, 4, 1, packetStream);
+    if (items_written == 1)
+        items_written = fwrite(msg, len, 1, packetStream);
+    if (items_written != 1)
+        printError("Error writing on packetStream");
+}
+
 ServerLink*     ServerLink::server = NULL;
 
 ServerLink::ServerLink(const Address& serverAddress, int port) :
@@ -93,7 +117,12 @@ ServerLink::ServerLink(const Address& serverAddress, int port) :
     udpBufferPtr(),
     ubuf(),
     tcpBufferPos(0),
-    tcpBufferConsumed(0)
+    tcpBufferConsumed(0),
+    tcpOutPending(0),
+    inbound(inboundQueueSize),
+    stopReceiving(false),
+    udpReceiveFd(-1),
+    receiving(false)
 {
     int i;
 
@@ -356,13 +385,19 @@ ServerLink::ServerLink(const Address& serverAddress, int port) :
         packetStream = fopen(getenv("BZFLAGSAVE"), "w");
         packetStartTime = TimeKeeper::getCurrent();
     }
+
+    startReceiveThread();
     return;
 
 }
 
 ServerLink::~ServerLink()
 {
+    // a joinable thread must not outlive its std::thread
+    stopReceiveThread();
     if (state != Okay) return;
+    // last chance for MsgExit and friends
+    flush();
     shutdown(fd, 2);
     close(fd);
 
@@ -409,6 +444,17 @@ void            ServerLink::setServer(ServerLink* _server)
     server = _server;
 }
 
+ServerLink::SendStats::SendStats() :
+    messages(0),
+    tcpWrites(0),
+    tcpBytes(0),
+    partialWrites(0),
+    udpDatagrams(0),
+    udpBytes(0),
+    pendingBytes(0)
+{
+}
+
 void            ServerLink::send(uint16_t code, uint16_t len,
                                  const void* msg)
 {
@@ -416,11 +462,12 @@ void            ServerLink::send(uint16_t code, uint16_t len,
     if (state != Okay) return;
 //  if (code != MsgPlayerUpdateSmall && code != MsgPlayerUpdate)
 //    logDebugMessage(1,"send %s len %d\n",MsgStrings::strMsgCode(code),len);
-    char msgbuf[MaxPacketLen];
-    void* buf = msgbuf;
+    if (!msg)
+        len = 0;
+    char header[4];
+    void* buf = header;
     buf = nboPackUShort(buf, len);
     buf = nboPackUShort(buf, code);
-    if (msg && len != 0) buf = nboPackString(buf, msg, len);
 
     if ((urecvfd>=0) && ulinkup )
     {
@@ -430,6 +477,7 @@ void            ServerLink::send(uint16_t code, uint16_t len,
         case MsgShotEnd:
         case MsgPlayerUpdate:
         case MsgPlayerUpdateSmall:
+        case MsgPlayerUpdateAck:
         case MsgGMUpdate:
         case MsgUDPLinkRequest:
         case MsgUDPLinkEstablished:
@@ -441,33 +489,100 @@ void            ServerLink::send(uint16_t code, uint16_t len,
     if (code == MsgUDPLinkRequest)
         needForSpeed=true;
 
+    // bzfs handles only the first message of a datagram, so udp messages
+    // are queued one by one and still get a datagram each
+    std::vector<char>& queue = needForSpeed ? udpOutBuffer : tcpOutBuffer;
+    queue.insert(queue.end(), header, header + 4);
+    if (len)
+        queue.insert(queue.end(), (const char*)msg, (const char*)msg + len);
     if (needForSpeed)
+        udpOutLengths.push_back(len + 4);
+    sendStats.messages++;
+
+    // don't let a burst pile up for a whole frame
+    if (tcpOutBuffer.size() >= tcpOutPending + sizeof(tbuf))
+        flush();
+}
+
+void            ServerLink::flush()
+{
+    if (state != Okay)
+    {
+        tcpOutBuffer.clear();
+        tcpOutPending = 0;
+        udpOutBuffer.clear();
+        udpOutLengths.clear();
+        return;
+    }
+
+    size_t offset = 0;
+    for (size_t i = 0; i < udpOutLengths.size(); i++)
     {
 #ifdef TESTLINK
         if ((random()%TESTQUALTIY) != 0)
 #endif
-            sendto(urecvfd, (const char *)msgbuf, (char*)buf - msgbuf, 0, &usendaddr, sizeof(usendaddr));
+            sendto(urecvfd, &udpOutBuffer[offset], udpOutLengths[i], 0, &usendaddr, sizeof(usendaddr));
         // we don't care about errors yet
-        return;
+        offset += udpOutLengths[i];
+        sendStats.udpDatagrams++;
+        sendStats.udpBytes += udpOutLengths[i];
+#if defined(NETWORK_STATS)
+        bytesSent += udpOutLengths[i];
+        packetsSent++;
+#endif
     }
+    udpOutBuffer.clear();
+    udpOutLengths.clear();
 
-    int r = ::send(fd, (const char*)msgbuf, len + 4, 0);
-    (void)r; // silence g++
-#if defined(_WIN32)
-    if (r == SOCKET_ERROR)
+    // the socket is non blocking, keep whatever it did not take
+    size_t sent = 0;
+    while (sent < tcpOutBuffer.size())
     {
-        const int e = WSAGetLastError();
+        const int r = ::send(fd, &tcpOutBuffer[sent], int(tcpOutBuffer.size() - sent), 0);
+        if (r > 0)
+        {
+            sent += r;
+            sendStats.tcpWrites++;
+            sendStats.tcpBytes += r;
+#if defined(NETWORK_STATS)
+            bytesSent += r;
+            packetsSent++;
+#endif
+            continue;
+        }
+
+        const int e = getErrno();
+        if (r < 0 && e == EINTR)
+            continue;
+        if (r < 0 && (e == EWOULDBLOCK || e == EAGAIN))
+        {
+            sendStats.partialWrites++;
+            break;
+        }
+
+#if defined(_WIN32)
         if (e == WSAENETRESET || e == WSAECONNABORTED ||
                 e == WSAECONNRESET || e == WSAETIMEDOUT)
             state = Hungup;
-        r = 0;
-    }
 #endif
+        logDebugMessage(2, "ServerLink: send failed, dropping %d bytes\n",
+                        int(tcpOutBuffer.size() - sent));
+        sent = tcpOutBuffer.size();
+    }
 
-#if defined(NETWORK_STATS)
-    bytesSent += r;
-    packetsSent++;
-#endif
+    if (sent == tcpOutBuffer.size())
+        tcpOutBuffer.clear();
+    else if (sent)
+        tcpOutBuffer.erase(tcpOutBuffer.begin(), tcpOutBuffer.begin() + sent);
+    tcpOutPending = tcpOutBuffer.size();
+}
+
+void            ServerLink::flushFrame()
+{
+    flush();
+    sendStats.pendingBytes = (unsigned int)tcpOutBuffer.size();
+    frameStats = sendStats;
+    sendStats = SendStats();
 }
 
 #ifdef WIN32
@@ -582,6 +697,13 @@ int         ServerLink::read(uint16_t& code, uint16_t& len,
 
     if (state != Okay) return -1;
 
+    // whoever waits for an answer wants the question sent first
+    if (blockTime != 0)
+        flush();
+
+    if (receiving)
+        return readQueued(code, len, msg, blockTime);
+
     if ((urecvfd >= 0) /* && ulinkup */)
     {
 
@@ -618,6 +740,7 @@ int         ServerLink::read(uint16_t& code, uint16_t& len,
             memcpy((char *)msg, udpBufferPtr, len);
             udpBufferPtr += len;
             udpLength    -= len;
+            arrivalTime = TimeKeeper::getCurrent();
             return 1;
         }
         if (UDEBUGMSG) printError("Fallback to normal TCP receive");
@@ -652,20 +775,236 @@ int         ServerLink::read(uint16_t& code, uint16_t& len,
     if (len > MaxPacketLen - 4)
         return -1;
 
+    arrivalTime = TimeKeeper::getCurrent();
+
     // FIXME -- packet recording
-    if (packetStream)
+    recordServerPacket(code, len, msg);
+    return 1;
+}
+
+
+void ServerLink::startReceiveThread()
+{
+    try
     {
-        long dt = (long)((TimeKeeper::getCurrent() - packetStartTime) * 10000.0f);
-        size_t items_written = fwrite(&serverPacket, sizeof(serverPacket), 1, packetStream);
-        if (items_written == 1)
-            items_written = fwrite(&dt, sizeof(dt), 1, packetStream);
-        if (items_written == 1)
-            items_written = fwrite(headerBuffer, 4, 1, packetStream);
-        if (items_written == 1)
-            items_written = fwrite(msg, len, 1, packetStream);
-        if (items_written != 1)
-            printError("Error writing on packetStream");
+        receiveThread = std::thread(&ServerLink::receiveLoop, this);
+        receiving = true;
+    }
+    catch (const std::system_error&)
+    {
+        // read() polls the sockets itself
+        logDebugMessage(1,"Network: no receive thread, polling the server link\n");
+    }
+}
+
+
+void ServerLink::stopReceiveThread()
+{
+    if (!receiving)
+        return;
+    stopReceiving = true;
+    receiveThread.join();
+    receiving = false;
+}
+
+
+bool ServerLink::queueMessage(uint16_t code, uint16_t len, const char* data,
+                              std::chrono::steady_clock::time_point arrival)
+{
+    // a full queue means the game is not keeping up, stop reading and
+    // let the socket buffers take the backlog like they used to
+    ReceivedMessage* slot;
+    while ((slot = inbound.beginPush()) == NULL)
+    {
+        if (stopReceiving)
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    slot->arrival = arrival;
+    slot->error = false;
+    slot->code = code;
+    slot->len = len;
+    if (len)
+        memcpy(slot->data, data, len);
+    inbound.endPush();
+    return true;
+}
+
+
+void ServerLink::queueError()
+{
+    ReceivedMessage* slot;
+    while ((slot = inbound.beginPush()) == NULL)
+    {
+        if (stopReceiving)
+            return;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    slot->arrival = std::chrono::steady_clock::now();
+    slot->error = true;
+    slot->code = MsgNull;
+    slot->len = 0;
+    inbound.endPush();
+}
+
+
+// Runs on the receive thread.  The nbo functions share their error
+// checking state between threads, so the headers are decoded by hand.
+void ServerLink::receiveLoop()
+{
+    char tcpBuffer[MaxPacketLen * 4];
+    int tcpBytes = 0;
+    char udpBuffer[MaxPacketLen];
+
+    while (!stopReceiving)
+    {
+        const int ufd = udpReceiveFd;
+        fd_set read_set;
+        FD_ZERO(&read_set);
+        FD_SET((unsigned int)fd, &read_set);
+        int maxFd = fd;
+        if (ufd >= 0)
+        {
+            FD_SET((unsigned int)ufd, &read_set);
+            if (ufd > maxFd)
+                maxFd = ufd;
+        }
+
+        // wake up now and then to notice the udp socket and shutdown
+        struct timeval timeout;
+        timeout.tv_sec = 0;
+        timeout.tv_usec = 100000;
+        const int nfound = select(maxFd + 1, &read_set, NULL, NULL, &timeout);
+        if (nfound < 0)
+        {
+            if (getErrno() == EINTR)
+                continue;
+            queueError();
+            return;
+        }
+        if (nfound == 0)
+            continue;
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+        // udp datagrams may carry several messages each
+        if ((ufd >= 0) && FD_ISSET(ufd, &read_set))
+        {
+            while (true)
+            {
+                struct sockaddr from;
+                AddrLen fromLen = sizeof(from);
+                const int n = recvfrom(ufd, udpBuffer, sizeof(udpBuffer), 0,
+                                       &from, (socklen_t*) &fromLen);
+                if (n <= 0)
+                    break;
+                int offset = 0;
+                while (n - offset >= 4)
+                {
+                    uint16_t len, code;
+                    memcpy(&len, &udpBuffer[offset], 2);
+                    memcpy(&code, &udpBuffer[offset + 2], 2);
+                    len = ntohs(len);
+                    code = ntohs(code);
+                    if (len > n - offset - 4)
+                        break;
+                    UDEBUG("<** UDP Packet Code %x Len %x\n",code, len);
+                    if (!queueMessage(code, len, &udpBuffer[offset + 4], now))
+                        return;
+                    offset += len + 4;
+                }
+            }
+        }
+
+        if (!FD_ISSET(fd, &read_set))
+            continue;
+
+        const int rlen = recv(fd, &tcpBuffer[tcpBytes], sizeof(tcpBuffer) - tcpBytes, 0);
+        if (rlen < 0)
+        {
+            const int e = getErrno();
+            if ((e == EAGAIN) || (e == EWOULDBLOCK) || (e == EINTR))
+                continue;
+            queueError();
+            return;
+        }
+        if (rlen == 0)
+        {
+            // the server closed the connection
+            queueError();
+            return;
+        }
+#if defined(NETWORK_STATS)
+        bytesReceived += rlen;
+        packetsReceived++;
+#endif
+        tcpBytes += rlen;
+
+        // hand over every complete message
+        int consumed = 0;
+        while (tcpBytes - consumed >= 4)
+        {
+            uint16_t len, code;
+            memcpy(&len, &tcpBuffer[consumed], 2);
+            memcpy(&code, &tcpBuffer[consumed + 2], 2);
+            len = ntohs(len);
+            code = ntohs(code);
+            if (len + 4 > MaxPacketLen)
+            {
+                queueError();
+                return;
+            }
+            if (tcpBytes - consumed < len + 4)
+                break;
+            if (!queueMessage(code, len, &tcpBuffer[consumed + 4], now))
+                return;
+            consumed += len + 4;
+        }
+        tcpBytes -= consumed;
+        if (consumed && tcpBytes)
+            memmove(tcpBuffer, &tcpBuffer[consumed], tcpBytes);
+    }
+}
+
+
+int ServerLink::readQueued(uint16_t& code, uint16_t& len, void* msg,
+                           int blockTime)
+{
+    ReceivedMessage* message = inbound.front();
+    if ((message == NULL) && (blockTime != 0))
+    {
+        // the receive thread always queues something before it quits
+        const TimeKeeper start = TimeKeeper::getCurrent();
+        while ((message = inbound.front()) == NULL)
+        {
+            if ((blockTime > 0) &&
+                    ((TimeKeeper::getCurrent() - start) * 1000.0 >= blockTime))
+                return 0;
+            TimeKeeper::sleep(0.001);
+        }
     }
+    if (message == NULL)
+        return 0;
+
+    // the error stays queued, the link is not coming back
+    if (message->error)
+        return -1;
+
+    code = message->code;
+    len = message->len;
+    if (len)
+        memcpy(msg, message->data, len);
+
+    // TimeKeeper is not thread safe, so the receive thread stamps with
+    // the steady clock and the age is taken off the current time here
+    const double age = std::chrono::duration<double>(
+                           std::chrono::steady_clock::now() - message->arrival).count();
+    arrivalTime = TimeKeeper::getCurrent();
+    arrivalTime += -age;
+
+    inbound.pop();
+
+    // FIXME -- packet recording
+    recordServerPacket(code, len, msg);
     return 1;
 }
 
@@ -910,6 +1249,9 @@ void            ServerLink::sendUDPlinkRequest()
     if (BzfNetwork::setNonBlocking(urecvfd) < 0)
         printError("Error: Unable to set NonBlocking for UDP receive socket");
 
+    // the receive thread picks it up on its next wakeup
+    udpReceiveFd = urecvfd;
+
     send(MsgUDPLinkRequest, sizeof(msg), msg);
 }
 
@@ -19,13 +19,19 @@
 
 #include "common.h"
 
+#include <atomic>
+#include <chrono>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "global.h"
 #include "Address.h"
 #include "Protocol.h"
 #include "ShotPath.h"
 #include "Flag.h"
+#include "SPSCQueue.h"
+#include "TimeKeeper.h"
 
 class ServerLink
 {
@@ -50,6 +56,20 @@ public:
         HasMessageLink = 8
     };
 
+    /** what went out during one frame, see flushFrame() */
+    struct SendStats
+    {
+        SendStats();
+
+        unsigned int messages;
+        unsigned int tcpWrites;
+        unsigned int tcpBytes;
+        unsigned int partialWrites;
+        unsigned int udpDatagrams;
+        unsigned int udpBytes;
+        unsigned int pendingBytes;  // left over for the next frame
+    };
+
     ServerLink(const Address& serverAddress,
                int port = ServerPort);
     ~ServerLink();
@@ -63,10 +83,17 @@ public:
     const PlayerId& getId() const;
     const char*     getVersion() const;
 
+    // messages are queued, they go out with the next flush
     void        send(uint16_t code, uint16_t len, const void* msg);
+    void        flush();
+    // flush and start collecting statistics for the next frame
+    void        flushFrame();
+    const SendStats&    getFrameStats() const;
     // if millisecondsToBlock < 0 then block forever
     int         read(uint16_t& code, uint16_t& len, void* msg,
                      int millisecondsToBlock = 0);
+    // when the message last returned by read() came off the network
+    const TimeKeeper&   getArrivalTime() const;
     int         fillTcpReadBuffer(int blockTime);
     bool        tcpPacketIn(char headerBuffer[4], void *msg);
 
@@ -98,6 +125,26 @@ public:
     void        enableOutboundUDP();
     void        confirmIncomingUDP();
 
+private:
+    // a message framed by the receive thread
+    struct ReceivedMessage
+    {
+        std::chrono::steady_clock::time_point arrival;
+        bool        error;  // the link is dead, nothing follows
+        uint16_t    code;
+        uint16_t    len;
+        char        data[MaxPacketLen];
+    };
+
+    void        startReceiveThread();
+    void        stopReceiveThread();
+    void        receiveLoop();
+    bool        queueMessage(uint16_t code, uint16_t len, const char* data,
+                             std::chrono::steady_clock::time_point arrival);
+    void        queueError();
+    int         readQueued(uint16_t& code, uint16_t& len, void* msg,
+                           int blockTime);
+
 private:
     State       state;
     int         fd;
@@ -121,6 +168,24 @@ private:
     int         tcpBufferPos;
     int         tcpBufferConsumed;
     char        tbuf[MaxPacketLen * 4];
+
+    // outbound queue; tcp messages are written as one stream, udp
+    // messages keep their own datagram each
+    std::vector<char>   tcpOutBuffer;
+    size_t      tcpOutPending;  // left over by the last flush
+    std::vector<char>   udpOutBuffer;
+    std::vector<uint16_t>   udpOutLengths;
+    SendStats       sendStats;
+    SendStats       frameStats;
+
+    // inbound messages, read from the sockets by receiveThread as soon
+    // as they arrive and handed over to read() through the queue
+    SPSCQueue<ReceivedMessage>  inbound;
+    std::thread     receiveThread;
+    std::atomic<bool>   stopReceiving;
+    std::atomic<int>    udpReceiveFd;   // urecvfd once it is set up
+    bool        receiving;
+    TimeKeeper      arrivalTime;
 };
 
 #define SEND 1
@@ -150,6 +215,16 @@ inline const char*  ServerLink::getVersion() const
     return version;
 }
 
+inline const ServerLink::SendStats& ServerLink::getFrameStats() const
+{
+    return frameStats;
+}
+
+inline const TimeKeeper& ServerLink::getArrivalTime() const
+{
+    return arrivalTime;
+}
+
 #endif // BZF_SERVER_LINK_H
 
 // Local Variables: ***
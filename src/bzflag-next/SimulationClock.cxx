@@ -0,0 +1,193 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/* interface header */
+#include "SimulationClock.h"
+
+/* system implementation headers */
+#include <math.h>
+#include <utility>
+
+
+// catching up on more steps than this in one frame only makes the
+// next frame later, the rest of the time is dropped instead
+static const int maxStepsPerFrame = 8;
+
+// a tank moving further than this in one step was teleported or
+// respawned, it is not interpolated
+static const float maxLerpDistance = 10.0f;
+
+
+//
+// SimulationClock
+//
+
+SimulationClock::SimulationClock() :
+    step(1.0f / 60.0f), alpha(0.0f), started(false),
+    stepCount(0), droppedSteps(0)
+{
+    // do nothing
+}
+
+void SimulationClock::setRate(float stepsPerSecond)
+{
+    if (stepsPerSecond < 10.0f)
+        stepsPerSecond = 10.0f;
+    else if (stepsPerSecond > 1000.0f)
+        stepsPerSecond = 1000.0f;
+    step = 1.0f / stepsPerSecond;
+}
+
+float SimulationClock::getStep() const
+{
+    return step;
+}
+
+void SimulationClock::reset()
+{
+    alpha = 0.0f;
+    started = false;
+    stepCount = 0;
+    droppedSteps = 0;
+}
+
+int SimulationClock::advance(const TimeKeeper& now)
+{
+    if (!started)
+    {
+        simTime = now;
+        started = true;
+    }
+
+    int steps = (int)floor((now - simTime) / step);
+    if (steps < 0)
+        steps = 0;
+    else if (steps > maxStepsPerFrame)
+    {
+        droppedSteps += steps - maxStepsPerFrame;
+        simTime = now;
+        simTime += -(double)step * maxStepsPerFrame;
+        steps = maxStepsPerFrame;
+    }
+
+    // where the frame will be once the steps are done
+    alpha = (float)((now - simTime) / step) - (float)steps;
+    if (alpha < 0.0f)
+        alpha = 0.0f;
+    else if (alpha > 1.0f)
+        alpha = 1.0f;
+
+    return steps;
+}
+
+void SimulationClock::beginStep()
+{
+    simTime += (double)step;
+    TimeKeeper::setTick(simTime);
+    stepCount++;
+}
+
+float SimulationClock::getAlpha() const
+{
+    return alpha;
+}
+
+unsigned int SimulationClock::getStepCount() const
+{
+    return stepCount;
+}
+
+unsigned int SimulationClock::getDroppedSteps() const
+{
+    return droppedSteps;
+}
+
+
+//
+// TankSnapshots
+//
+
+void TankSnapshots::beginStep(int maxPlayers)
+{
+    std::swap(previous, current);
+    current.resize(maxPlayers);
+    previous.resize(maxPlayers);
+    for (int i = 0; i < maxPlayers; i++)
+        current[i].valid = false;
+}
+
+void TankSnapshots::setTank(int id, const float* pos, float angle)
+{
+    if ((id < 0) || (id >= (int)current.size()))
+        return;
+    TankState& state = current[id];
+    state.valid = true;
+    state.pos[0] = pos[0];
+    state.pos[1] = pos[1];
+    state.pos[2] = pos[2];
+    state.angle = angle;
+}
+
+void TankSnapshots::clear()
+{
+    previous.clear();
+    current.clear();
+}
+
+bool TankSnapshots::getTank(int id, float alpha,
+                            float pos[3], float& angle) const
+{
+    if ((id < 0) || (id >= (int)current.size()) || !current[id].valid)
+        return false;
+
+    const TankState& next = current[id];
+    const TankState& last = previous[id];
+
+    float dist2 = 0.0f;
+    if (last.valid)
+    {
+        for (int a = 0; a < 3; a++)
+        {
+            const float d = next.pos[a] - last.pos[a];
+            dist2 += d * d;
+        }
+    }
+    if (!last.valid || (dist2 > (maxLerpDistance * maxLerpDistance)))
+    {
+        pos[0] = next.pos[0];
+        pos[1] = next.pos[1];
+        pos[2] = next.pos[2];
+        angle = next.angle;
+        return true;
+    }
+
+    for (int a = 0; a < 3; a++)
+        pos[a] = last.pos[a] + (next.pos[a] - last.pos[a]) * alpha;
+
+    // turn the short way around
+    float turn = next.angle - last.angle;
+    if (turn > (float)M_PI)
+        turn -= 2.0f * (float)M_PI;
+    else if (turn < -(float)M_PI)
+        turn += 2.0f * (float)M_PI;
+    angle = last.angle + turn * alpha;
+
+    return true;
+}
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
@@ -0,0 +1,98 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef __SIMULATIONCLOCK_H__
+#define __SIMULATIONCLOCK_H__
+
+/* system interface headers */
+#include <vector>
+
+/* common interface headers */
+#include "TimeKeeper.h"
+
+
+/**
+ * SimulationClock
+ *  splits wall clock time into fixed simulation steps.  Each step
+ *  moves the TimeKeeper tick forward by exactly one step, so the
+ *  game code that reads the tick sees the simulation time.
+ */
+class SimulationClock
+{
+public:
+    SimulationClock();
+
+    void        setRate(float stepsPerSecond);
+    float       getStep() const;
+
+    // start over from the next advance(), when leaving a game
+    void        reset();
+
+    // number of steps needed to catch up with now
+    int         advance(const TimeKeeper& now);
+    // set the tick for the next step
+    void        beginStep();
+
+    // how far the frame is between the last two steps, 0 to 1
+    float       getAlpha() const;
+    unsigned int    getStepCount() const;
+    unsigned int    getDroppedSteps() const;
+
+private:
+    TimeKeeper      simTime;
+    float       step;
+    float       alpha;
+    bool        started;
+    unsigned int    stepCount;
+    unsigned int    droppedSteps;
+};
+
+
+/**
+ * TankSnapshots
+ *  the tank states of the last two simulation steps, the renderer
+ *  interpolates between them with SimulationClock::getAlpha()
+ */
+class TankSnapshots
+{
+public:
+    // the current states become the previous ones
+    void        beginStep(int maxPlayers);
+    void        setTank(int id, const float* pos, float angle);
+    void        clear();
+
+    // false if the tank was not in the last step
+    bool        getTank(int id, float alpha,
+                        float pos[3], float& angle) const;
+
+private:
+    struct TankState
+    {
+        bool    valid;
+        float   pos[3];
+        float   angle;
+    };
+
+    std::vector<TankState>  previous;
+    std::vector<TankState>  current;
+};
+
+
+#endif /* __SIMULATIONCLOCK_H__ */
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
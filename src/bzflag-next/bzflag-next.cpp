@@ -118,6 +118,10 @@
 #include "SceneObjectBrowser.h"
 
 #include "MagnumSceneRenderer.h"
+#include "MagnumEffectsRenderer.h"
+
+#include "ZoneProfiler.h"
+#include "ProfilerPanel.h"
 
 #include "MagnumSceneManager.h"
 
@@ -177,6 +181,8 @@
 #include "TextureMatrix.h"
 #include "DynamicColor.h"
 #include "Teleporter.h"
+#include "SimulationClock.h"
+#include "PlayerStateDelta.h"
 
 // defaults for bzdb
 #include "defaultBZDB.h"
@@ -278,12 +284,14 @@ class BZFlagNew: public Platform::Sdl2Application {
         bool showPipelineTexBrowser = false;
         bool showAdjustSun = false;
         bool showRendererSettings = false;
+        bool showZoneProfiler = false;
         
         Vector3 positionOnSphere(const Vector2i& position) const;
 
         friend class WorldDownLoader;
         void startPlaying();
         void playingLoop();
+        void simulationStep(float dt);
 
         void onConsoleText(const char* txt);
 
@@ -327,6 +335,8 @@ class BZFlagNew: public Platform::Sdl2Application {
 
         const void *handleMsgSetVars(const void *msg);
         void handlePlayerMessage(uint16_t, uint16_t, const void*);
+        void sendDeltaAcks(bool always);
+        void resetDeltaDecoder(PlayerId id);
 
         void markOld(std::string &fileName);
 
@@ -409,11 +419,18 @@ class BZFlagNew: public Platform::Sdl2Application {
         PhyDrvBrowser phyDrvBrowser;
         DrawableGroupBrowser dgrpBrowser;
         SceneObjectBrowser soBrowser;
+        ProfilerPanel profilerPanel;
 
         MagnumSceneRenderer sceneRenderer;
 
         std::map<int, Object3D*> remoteTanks;
 
+        SimulationClock simClock;
+        TankSnapshots tankSnapshots;
+
+        // MsgPlayerUpdateDelta baselines, by sender
+        std::vector<PlayerDeltaDecoder> deltaDecoders;
+
         bool isQuit = false;
 };
 
@@ -588,6 +605,7 @@ void BZFlagNew::showMenuDebug() {
     }
     ImGui::Separator();
     if (ImGui::MenuItem("Pipeline Texture Browser", NULL, &showPipelineTexBrowser)) {}
+    if (ImGui::MenuItem("Zone Profiler", NULL, &showZoneProfiler)) {}
 }
 
 void BZFlagNew::drawWindows() {
@@ -599,6 +617,14 @@ void BZFlagNew::drawWindows() {
         ImGui::Begin("Profiler", &showProfiler);
         ImGui::Text("Application average %.3f ms/frame (%.1f FPS)",
             1000.0/Double(ImGui::GetIO().Framerate), Double(ImGui::GetIO().Framerate));
+        if (_serverLink) {
+            const ServerLink::SendStats& stats = _serverLink->getFrameStats();
+            ImGui::Text("Sent %u messages: %u TCP writes (%u bytes), %u UDP datagrams (%u bytes)",
+                stats.messages, stats.tcpWrites, stats.tcpBytes, stats.udpDatagrams, stats.udpBytes);
+            ImGui::Text("Partial writes %u, %u bytes pending", stats.partialWrites, stats.pendingBytes);
+        }
+        ImGui::Text("Simulation %.0f Hz, %u steps, %u dropped",
+            Double(1.0f / simClock.getStep()), simClock.getStepCount(), simClock.getDroppedSteps());
         ImGui::End();
     }
 
@@ -699,6 +725,10 @@ void BZFlagNew::drawWindows() {
     if (showRendererSettings) {
         sceneRenderer.drawSettings("Renderer Settings", &showRendererSettings);
     }
+
+    if (showZoneProfiler) {
+        profilerPanel.draw("Zone Profiler", &showZoneProfiler);
+    }
 }
 
 void BZFlagNew::onConsoleText(const char* msg) {
@@ -728,18 +758,22 @@ void BZFlagNew::onConsoleText(const char* msg) {
 }
 
 void BZFlagNew::drawEvent() {
+    PROFILE_ZONE("drawEvent");
     //_profiler.beginFrame();
     GL::defaultFramebuffer.clear(GL::FramebufferClear::Color | GL::FramebufferClear::Depth);
 
-    _imgui.newFrame();
-    /* Enable text input, if needed */
-    if(ImGui::GetIO().WantTextInput && !isTextInputActive())
-        startTextInput();
-    else if(!ImGui::GetIO().WantTextInput && isTextInputActive())
-        stopTextInput();
-
-    showMainMenuBar();
-    drawWindows();
+    {
+        PROFILE_ZONE("ImGui windows");
+        _imgui.newFrame();
+        /* Enable text input, if needed */
+        if(ImGui::GetIO().WantTextInput && !isTextInputActive())
+            startTextInput();
+        else if(!ImGui::GetIO().WantTextInput && isTextInputActive())
+            stopTextInput();
+
+        showMainMenuBar();
+        drawWindows();
+    }
 
     /* Update application cursor */
     _imgui.updateApplicationCursor(*this);
@@ -751,15 +785,28 @@ void BZFlagNew::drawEvent() {
     GL::Renderer::disable(GL::Renderer::Feature::ScissorTest);
     GL::Renderer::disable(GL::Renderer::Feature::Blending);
 
+    // Upload a few textures finished by the decode threads
+    {
+        PROFILE_ZONE("processDecodedTextures");
+        MagnumTextureManager::instance().processDecodedTextures(4);
+    }
+
     // Update tank positions and rotations
     for (auto o: remoteTanks) {
         auto rp = remotePlayers[o.first];
         if (!rp) continue;
 
+        // draw between the last two simulation steps
+        float pos[3];
+        float angle;
+        if (!tankSnapshots.getTank(o.first, simClock.getAlpha(), pos, angle))
+        {
+            memcpy(pos, rp->getPosition(), sizeof(pos));
+            angle = rp->getAngle();
+        }
+
         auto tank = o.second;
         tank->resetTransformation();
-        const float* pos = rp->getPosition();
-        const float angle = rp->getAngle();
         tank->rotateZ(Math::Rad<float>(angle));
         tank->translate({pos[0], pos[1], pos[2]});
     }
@@ -782,6 +829,12 @@ void BZFlagNew::drawEvent() {
     //sceneRenderer.renderClouds(_camera);
     sceneRenderer.renderScene(_camera);
     //sceneRenderer.renderSceneToHDR(_camera);
+
+    {
+        PROFILE_ZONE("effects");
+        MagnumEffectsRenderer::instance().update();
+        MagnumEffectsRenderer::instance().draw(*_camera);
+    }
     
     //sceneRenderer.renderClouds();
 
@@ -792,11 +845,15 @@ void BZFlagNew::drawEvent() {
     GL::Renderer::disable(GL::Renderer::Feature::FaceCulling);
     GL::Renderer::disable(GL::Renderer::Feature::DepthTest);
 
-    _imgui.drawFrame();
-
-    
+    {
+        PROFILE_ZONE("ImGui draw");
+        _imgui.drawFrame();
+    }
 
-    swapBuffers();
+    {
+        PROFILE_ZONE("swapBuffers");
+        swapBuffers();
+    }
     //_profiler.endFrame();
     //_profiler.printStatistics(10);
 }
@@ -1553,6 +1610,7 @@ void BZFlagNew::textInputEvent(TextInputEvent& e) {
 
 void BZFlagNew::exitEvent(ExitEvent& e) {
     isQuit = true;
+    MagnumEffectsRenderer::instance().freeContext();
 }
 
 void BZFlagNew::tryConnect(const std::string& callsign, const std::string& password, const std::string& server, const std::string& port)
@@ -1633,6 +1691,9 @@ int BZFlagNew::main() {
 
     Team::updateShotColors();
 
+    TEXCACHE.loadIndex();
+    TEXCACHE.limitCacheSize();
+
     // TM test
     MagnumTextureManager &tm = MagnumTextureManager::instance();
     //tm.getTexture("boxwall");
@@ -1649,6 +1710,7 @@ int BZFlagNew::main() {
     killAres();
     AresHandler::globalShutdown();
     tm.clear();
+    TEXCACHE.saveIndex();
     TankObjectBuilder::instance().cleanup();
     exit(0);
     return 0;
@@ -2064,12 +2126,13 @@ void BZFlagNew::handleFlagTransferred(Player *fromTank, Player *toTank, int flag
     addMessage(toTank, message);
 }
 
-void BZFlagNew::handlePlayerMessage(uint16_t code, uint16_t, const void* msg)
+void BZFlagNew::handlePlayerMessage(uint16_t code, uint16_t len, const void* msg)
 {
     switch (code)
     {
     case MsgPlayerUpdate:
     case MsgPlayerUpdateSmall:
+    case MsgPlayerUpdateDelta:
     {
         float timestamp; // could be used to enhance deadreckoning, but isn't for now
         PlayerId id;
@@ -2079,10 +2142,26 @@ void BZFlagNew::handlePlayerMessage(uint16_t code, uint16_t, const void* msg)
         buf = nboUnpackUByte(buf, id);
         Player* tank = lookupPlayer(id);
         if (!tank || tank == myTank) break;
-        nboUnpackInt(buf, order); // peek! don't update the msg pointer
-        if (order <= tank->getOrder()) break;
+        const TimeKeeper* arrivalTime =
+            _serverLink ? &_serverLink->getArrivalTime() : NULL;
         short oldStatus = tank->getStatus();
-        tank->unpack(msg, code);
+        if (code == MsgPlayerUpdateDelta)
+        {
+            // decode late updates too, the server may build on them
+            if ((size_t)id >= deltaDecoders.size())
+                deltaDecoders.resize(id + 1);
+            PlayerState state;
+            if (!deltaDecoders[id].unpack(buf, (const char*)msg + len, state))
+                break;
+            if (state.order <= tank->getOrder()) break;
+            tank->setState(state, timestamp, arrivalTime);
+        }
+        else
+        {
+            nboUnpackInt(buf, order); // peek! don't update the msg pointer
+            if (order <= tank->getOrder()) break;
+            tank->unpack(msg, code, arrivalTime);
+        }
         short newStatus = tank->getStatus();
         if ((oldStatus & short(PlayerState::Paused)) !=
                 (newStatus & short(PlayerState::Paused)))
@@ -2215,20 +2294,24 @@ void BZFlagNew::playingLoop()
     //while (!CommandsStandard::isQuit())
     while (!isQuit)
     {
+        ZONEPROFILER.newFrame();
+        PROFILE_ZONE("playingLoop");
 
         BZDBCache::update();
 
         // set this step game time
         GameTime::setStepTime();
 
-        // get delta time
-        TimeKeeper prevTime = TimeKeeper::getTick();
-        TimeKeeper::setTick();
-        const float dt = float(TimeKeeper::getTick() - prevTime);
+        // work out how many fixed simulation steps this frame needs
+        simClock.setRate(BZDB.eval("simulationRate"));
+        const int simSteps = simClock.advance(TimeKeeper::getCurrent());
 
         // see if the world collision grid needs to be updated
         if (world)
+        {
+            PROFILE_ZONE("checkCollisionManager");
             world->checkCollisionManager();
+        }
 
         // try to join a game if requested.  do this *before* handling
         // events so we do a redraw after the request is posted and
@@ -2324,102 +2407,13 @@ void BZFlagNew::playingLoop()
             leaveGame();
         }
 
-        // TODO: Update sky every few seconds
-        if (world)
-            world->updateWind(dt);
-
-        // Move roaming camera
-
-        // update test video format timer
-
-        // update the countdowns
-        //updatePauseCountdown(dt);
-        //updateDestructCountdown(dt);
-
-        // update other tank's shots
-        for (int i = 0; i < curMaxPlayers; i++)
-        {
-            if (remotePlayers[i])
-                remotePlayers[i]->updateShots(dt);
-        }
-
-        const World *_world = World::getWorld();
-        if (_world)
-            _world->getWorldWeapons()->updateShots(dt);
-        // update track marks  (before any tanks are moved)
-        //TrackMarks::update(dt);
-
-        // do dead reckoning on remote players
-        for (int i = 0; i < curMaxPlayers; i++)
-        {
-            if (remotePlayers[i])
-            {
-                const bool wasNotResponding = remotePlayers[i]->isNotResponding();
-                remotePlayers[i]->doDeadReckoning();
-                const bool isNotResponding = remotePlayers[i]->isNotResponding();
-                if (!wasNotResponding && isNotResponding)
-                    addMessage(remotePlayers[i], "not responding");
-                else if (wasNotResponding && !isNotResponding)
-                    addMessage(remotePlayers[i], "okay");
-            }
-        }
-
-        // do motion
-        if (myTank)
-        {
-            if (myTank->isAlive() && !myTank->isPaused())
-            {
-                doMotion();
-                /*if (scoreboard->getHuntState()==ScoreboardRenderer::HUNT_ENABLED)
-                {
-                    setHuntTarget(); //spot hunt target
-                }*/
-                if (myTank->getTeam() != ObserverTeam &&
-                        ((fireButton && myTank->getFlag() == ::Flags::MachineGun) ||
-                         (myTank->getFlag() == ::Flags::TriggerHappy)))
-                    myTank->fireShot();
-
-                //setLookAtMarker();
-
-                // see if we have a target, if so lock on to the bastage
-                const Player* targetdPlayer = myTank->getTarget();
-                if (targetdPlayer && targetdPlayer->isAlive() && targetdPlayer->getFlag() != ::Flags::Stealth)
-                {
-                    /*hud->AddLockOnMarker(Float3ToVec3(myTank->getTarget()->getPosition()),
-                                         myTank->getTarget()->getCallSign(),
-                                         !isKillable(myTank->getTarget()));*/
-                }
-                else // if we should not have a target, force that target to be cleared
-                    myTank->setTarget(NULL);
-
-            }
-            else
-            {
-                //int mx, my;
-                //mainWindow->getMousePosition(mx, my);
-            }
-            myTank->update();
-        }
-
-        checkEnvironment();
-
-        // adjust properties based on flags (dimensions, cloaking, etc...)
-        if (myTank)
-            myTank->updateTank(dt, true);
-        for (int i = 0; i < curMaxPlayers; i++)
+        // run the simulation in fixed steps, however long the frame was
+        for (int i = 0; i < simSteps; i++)
         {
-            if (remotePlayers[i])
-                remotePlayers[i]->updateTank(dt, false);
+            simClock.beginStep();
+            simulationStep(simClock.getStep());
         }
 
-        updateFlags(dt);
-        // updateExplosions(dt): Update billboard scene nodes for explosions
-                // update mesh animations
-        if (world)
-            world->updateAnimations(dt);
-
-
-
         // update the dynamic colors
         DYNCOLORMGR.update();
         // update the texture matrices
@@ -2457,7 +2451,10 @@ void BZFlagNew::playingLoop()
             }
         }
 
-        mainLoopIteration();
+        {
+            PROFILE_ZONE("mainLoopIteration");
+            mainLoopIteration();
+        }
 
         // updateSound()
 
@@ -2486,7 +2483,10 @@ void BZFlagNew::playingLoop()
             _serverLink->sendPlayerUpdate(myTank);
         }
 
-        cURLManager::perform();
+        {
+            PROFILE_ZONE("cURLManager::perform");
+            cURLManager::perform();
+        }
 
         // check if we are waiting for initial texture downloading
                 // check if we are waiting for initial texture downloading
@@ -2507,10 +2507,126 @@ void BZFlagNew::playingLoop()
 
         // handle incoming packets
         doMessages();
+
+        // everything queued during this frame goes out in one go
+        if (_serverLink)
+        {
+            PROFILE_ZONE("flushFrame");
+            sendDeltaAcks(false);
+            _serverLink->flushFrame();
+        }
+    }
+}
+
+void BZFlagNew::simulationStep(float dt)
+{
+    PROFILE_ZONE("simulationStep");
+    // TODO: Update sky every few seconds
+    if (world)
+        world->updateWind(dt);
+
+    // Move roaming camera
+
+    // update test video format timer
+
+    // update the countdowns
+    //updatePauseCountdown(dt);
+    //updateDestructCountdown(dt);
+
+    // update other tank's shots
+    for (int i = 0; i < curMaxPlayers; i++)
+    {
+        if (remotePlayers[i])
+            remotePlayers[i]->updateShots(dt);
+    }
+
+    const World *_world = World::getWorld();
+    if (_world)
+        _world->getWorldWeapons()->updateShots(dt);
+    // update track marks  (before any tanks are moved)
+    //TrackMarks::update(dt);
+
+    // do dead reckoning on remote players
+    for (int i = 0; i < curMaxPlayers; i++)
+    {
+        if (remotePlayers[i])
+        {
+            const bool wasNotResponding = remotePlayers[i]->isNotResponding();
+            remotePlayers[i]->doDeadReckoning();
+            const bool isNotResponding = remotePlayers[i]->isNotResponding();
+            if (!wasNotResponding && isNotResponding)
+                addMessage(remotePlayers[i], "not responding");
+            else if (wasNotResponding && !isNotResponding)
+                addMessage(remotePlayers[i], "okay");
+        }
+    }
+
+    // do motion
+    if (myTank)
+    {
+        if (myTank->isAlive() && !myTank->isPaused())
+        {
+            doMotion();
+            /*if (scoreboard->getHuntState()==ScoreboardRenderer::HUNT_ENABLED)
+            {
+                setHuntTarget(); //spot hunt target
+            }*/
+            if (myTank->getTeam() != ObserverTeam &&
+                    ((fireButton && myTank->getFlag() == ::Flags::MachineGun) ||
+                     (myTank->getFlag() == ::Flags::TriggerHappy)))
+                myTank->fireShot();
+
+            //setLookAtMarker();
+
+            // see if we have a target, if so lock on to the bastage
+            const Player* targetdPlayer = myTank->getTarget();
+            if (targetdPlayer && targetdPlayer->isAlive() && targetdPlayer->getFlag() != ::Flags::Stealth)
+            {
+                /*hud->AddLockOnMarker(Float3ToVec3(myTank->getTarget()->getPosition()),
+                                     myTank->getTarget()->getCallSign(),
+                                     !isKillable(myTank->getTarget()));*/
+            }
+            else // if we should not have a target, force that target to be cleared
+                myTank->setTarget(NULL);
+
+        }
+        else
+        {
+            //int mx, my;
+            //mainWindow->getMousePosition(mx, my);
+        }
+        myTank->update();
+    }
+
+    checkEnvironment();
+
+    // adjust properties based on flags (dimensions, cloaking, etc...)
+    if (myTank)
+        myTank->updateTank(dt, true);
+    for (int i = 0; i < curMaxPlayers; i++)
+    {
+        if (remotePlayers[i])
+            remotePlayers[i]->updateTank(dt, false);
+    }
+
+    updateFlags(dt);
+    // updateExplosions(dt): Update billboard scene nodes for explosions
+    // update mesh animations
+    if (world)
+        world->updateAnimations(dt);
+
+    // publish the tank states for the renderer
+    tankSnapshots.beginStep(curMaxPlayers);
+    for (int i = 0; i < curMaxPlayers; i++)
+    {
+        if (remotePlayers[i])
+            tankSnapshots.setTank(i, remotePlayers[i]->getPosition(),
+                                  remotePlayers[i]->getAngle());
     }
 }
 
 void BZFlagNew::doMessages() {
+    PROFILE_ZONE("doMessages");
     char msg[MaxPacketLen];
     uint16_t code, len;
     int e = 0;
@@ -2803,9 +2919,14 @@ void BZFlagNew::handleServerMessage(bool human, uint16_t code, uint16_t len, con
         {
             // it's me!  should be the end of updates
             enteringServer(msg);
+
+            // ask for delta encoded updates if the server offers them
+            if (BZDB.isTrue(StateDatabase::BZDB_DELTAUPDATES))
+                sendDeltaAcks(true);
         }
         else
         {
+            resetDeltaDecoder(id);
             addPlayer(id, msg, entered);
             checkScores = true;
 
@@ -2820,6 +2941,7 @@ void BZFlagNew::handleServerMessage(bool human, uint16_t code, uint16_t len, con
     {
         PlayerId id;
         msg = nboUnpackUByte(msg, id);
+        resetDeltaDecoder(id);
         if (removePlayer (id))
             checkScores = true;
         break;
@@ -2886,22 +3008,19 @@ void BZFlagNew::handleServerMessage(bool human, uint16_t code, uint16_t len, con
             }
 
             tank->setDeathEffect(NULL);
-            /*if (SceneRenderer::instance().useQuality() >= 2)
+            if (((tank != myTank)
+                    && ((ROAM.getMode() != Roaming::roamViewFP)
+                        || (tank != ROAM.getTargetTank())))
+                    || BZDB.isTrue("enableLocalSpawnEffect"))
             {
-                if (((tank != myTank)
-                        && ((ROAM.getMode() != Roaming::roamViewFP)
-                            || (tank != ROAM.getTargetTank())))
-                        || BZDB.isTrue("enableLocalSpawnEffect"))
+                if (myTank->getFlag() == ::Flags::Colorblindness)
                 {
-                    if (myTank->getFlag() == Flags::Colorblindness)
-                    {
-                        static float cbColor[4] = {1,1,1,1};
-                        EFFECTS.addSpawnEffect(cbColor, pos);
-                    }
-                    else
-                        EFFECTS.addSpawnEffect(tank->getColor(), pos);
+                    static float cbColor[4] = {1,1,1,1};
+                    MagnumEffectsRenderer::instance().addSpawnEffect(cbColor, pos);
                 }
-            }*/
+                else
+                    MagnumEffectsRenderer::instance().addSpawnEffect(tank->getColor(), pos);
+            }
             tank->setStatus(PlayerState::Alive);
             tank->move(pos, forward);
             tank->setVelocity(zero);
@@ -3414,24 +3533,21 @@ void BZFlagNew::handleServerMessage(bool human, uint16_t code, uint16_t len, con
             {
                 shooter->addShot(firingInfo);
 
-                /*if (SceneRenderer::instance().useQuality() >= 2)
+                float shotPos[3];
+                shooter->getMuzzle(shotPos);
+
+                // if you are driving with a tank in observer mode
+                // and do not want local shot effects,
+                // disable shot effects for that specific tank
+                if ((ROAM.getMode() != Roaming::roamViewFP)
+                        || (!ROAM.getTargetTank())
+                        || (shooterid != ROAM.getTargetTank()->getId())
+                        || BZDB.isTrue("enableLocalShotEffect"))
                 {
-                    float shotPos[3];
-                    shooter->getMuzzle(shotPos);
-
-                    // if you are driving with a tank in observer mode
-                    // and do not want local shot effects,
-                    // disable shot effects for that specific tank
-                    if ((ROAM.getMode() != Roaming::roamViewFP)
-                            || (!ROAM.getTargetTank())
-                            || (shooterid != ROAM.getTargetTank()->getId())
-                            || BZDB.isTrue("enableLocalShotEffect"))
-                    {
-                        EFFECTS.addShotEffect(shooter->getColor(), shotPos,
-                                              shooter->getAngle(),
-                                              shooter->getVelocity());
-                    }
-                }*/
+                    MagnumEffectsRenderer::instance().addShotEffect(shooter->getColor(), shotPos,
+                            shooter->getAngle(),
+                            shooter->getVelocity());
+                }
             }
             else
                 break;
@@ -3950,16 +4066,48 @@ void BZFlagNew::handleServerMessage(bool human, uint16_t code, uint16_t len, con
     // inter-player relayed message
     case MsgPlayerUpdate:
     case MsgPlayerUpdateSmall:
+    case MsgPlayerUpdateDelta:
     case MsgGMUpdate:
     case MsgLagPing:
-        handlePlayerMessage(code, 0, msg);
+        handlePlayerMessage(code, len, msg);
         break;
     }
 
     //if (checkScores) updateHighScores();
 }
 
+void BZFlagNew::sendDeltaAcks(bool always)
+{
+    if (!_serverLink)
+        return;
+
+    // one message per frame acknowledges the newest update of each sender
+    char msg[MaxPacketLen];
+    void* buf = msg + 1;
+    uint8_t count = 0;
+    for (size_t id = 0; id < deltaDecoders.size(); id++)
+    {
+        uint8_t sequence;
+        if (!deltaDecoders[id].getPendingAck(sequence))
+            continue;
+        buf = nboPackUByte(buf, (uint8_t)id);
+        buf = nboPackUByte(buf, sequence);
+        count++;
+    }
+    if ((count == 0) && !always)
+        return;
+    nboPackUByte(msg, count);
+    _serverLink->send(MsgPlayerUpdateAck, (uint16_t)((char*)buf - msg), msg);
+}
+
+void BZFlagNew::resetDeltaDecoder(PlayerId id)
+{
+    if ((size_t)id < deltaDecoders.size())
+        deltaDecoders[id].reset();
+}
+
 void BZFlagNew::updateFlags(float dt) {
+    PROFILE_ZONE("updateFlags");
     /*for (int i = 0; i < numFlags; i++)
     {
         ::Flag& flag = world->getFlag(i);
@@ -3996,6 +4144,7 @@ bool BZFlagNew::processWorldChunk(const void *buf, uint16_t len, int bytesLeft)
 }
 
 void BZFlagNew::checkEnvironment() {
+    PROFILE_ZONE("checkEnvironment");
     if (!myTank) return;
 
     if (myTank->getTeam() == ObserverTeam )
@@ -4078,6 +4227,7 @@ bool BZFlagNew::isKillable(const Player* target) {
 }
 
 void BZFlagNew::doMotion() {
+    PROFILE_ZONE("doMotion");
         // Implement based on playing.cxx
 }
 
@@ -4257,6 +4407,10 @@ void BZFlagNew::leaveGame() {
     curMaxPlayers = 0;
     //numFlags = 0;
     remotePlayers = NULL;
+    simClock.reset();
+    tankSnapshots.clear();
+    deltaDecoders.clear();
+    MagnumEffectsRenderer::instance().init();
 
     ServerLink::setServer(NULL);
     delete _serverLink;
@@ -23,6 +23,7 @@
 DefaultDBItem defaultDBItems[] =
 {
     { "fpsLimit",         "30",           true,   StateDatabase::ReadWrite,   NULL },
+    { "simulationRate",       "60",           true,   StateDatabase::ReadWrite,   NULL },
     { "saveEnergy",       "0",            true,   StateDatabase::ReadWrite,   NULL },
     { "saveSettings",     "1",            true,   StateDatabase::ReadWrite,   NULL },
     { "udpnet",           "1",            true,   StateDatabase::ReadWrite,   NULL },
@@ -100,6 +101,7 @@ DefaultDBItem defaultDBItems[] =
     { "showVelocities",       "0",            true,   StateDatabase::ReadWrite,   NULL },
     { "jumpTyping",       "1",            true,   StateDatabase::ReadWrite,   NULL },
     { "maxCacheMB",       "512",           true,   StateDatabase::ReadWrite,   NULL },
+    { "maxTextureCacheMB",    "256",           true,   StateDatabase::ReadWrite,   NULL },
     { "doDownloads",      "1",            true,   StateDatabase::ReadWrite,   NULL },
     { "updateDownloads",      "0",            true,   StateDatabase::ReadWrite,   NULL },
     { "roamSmoothTime",       "0.5",          true,   StateDatabase::ReadWrite,   NULL },
@@ -209,6 +211,8 @@ DefaultDBItem defaultDBItems[] =
 
     // URL timeouts
     { "httpTimeout",      "15",           true,   StateDatabase::ReadWrite,   NULL },
+    { "httpMaxTransfers", "8",            true,   StateDatabase::ReadWrite,   NULL },
+    { "httpMaxHostTransfers", "4",        true,   StateDatabase::ReadWrite,   NULL },
 
     // hud drawing
     { "hudGUIBorderOpacityFactor","0.75",         true,   StateDatabase::ReadWrite,   NULL },
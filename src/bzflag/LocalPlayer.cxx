@@ -1620,54 +1620,64 @@ bool            LocalPlayer::checkHit(const Player* source,
     {
         // get shot
         const ShotPath* shot = source->getShot(i);
-        if (!shot || shot->isExpired()) continue;
-
-        // my own shock wave cannot kill me
-        if (source == this && ((shot->getFlag() == Flags::ShockWave) || (shot->getFlag() == Flags::Thief))) continue;
-
-        // if no team kills, shots of my team cannot kill me. Thief can still take
-        // a teammate's flag.
-        if (getTeam() != RogueTeam && !World::getWorld()->allowTeamKills() &&
-                shot->getFlag() != Flags::Thief && shot->getTeam() == getTeam() &&
-                source != this) continue;
-
-        // short circuit test if shot can't possibly hit.
-        // only superbullet or shockwave can kill zoned dude
-        const FlagType* shotFlag = shot->getFlag();
-        if (isPhantomZoned() &&
-                (shotFlag != Flags::ShockWave) &&
-                (shotFlag != Flags::SuperBullet) &&
-                (shotFlag != Flags::PhantomZone))
-            continue;
-
-        // laser can't hit a cloaked tank
-        if ((getFlag() == Flags::Cloaking) && (shotFlag == Flags::Laser))
-            continue;
-
-        // zoned shots only kill zoned tanks
-        if ((shotFlag == Flags::PhantomZone) && !isPhantomZoned())
-            continue;
-
-        // test myself against shot
-        float position[3];
-        const float t = shot->checkHit(this, position);
-        if (t >= minTime) continue;
-
-        // test if shot hit a part of my tank that's through a teleporter.
-        // hit is no good if hit point is behind crossing plane.
-        if (isCrossingWall() && position[0] * crossingPlane[0] +
-                position[1] * crossingPlane[1] +
-                position[2] * crossingPlane[2] + crossingPlane[3] < 0.0)
-            continue;
-
-        // okay, shot hit
-        goodHit = true;
-        hit = shot;
-        minTime = t;
+        if (!shot) continue;
+        if (checkShotHit(source, shot, hit, minTime))
+            goodHit = true;
     }
     return goodHit;
 }
 
+// NOTE -- the caller checks that the source isn't paused
+bool            LocalPlayer::checkShotHit(const Player* source,
+        const ShotPath* shot,
+        const ShotPath*& hit, float& minTime) const
+{
+    if (shot->isExpired()) return false;
+
+    // my own shock wave cannot kill me
+    if (source == this && ((shot->getFlag() == Flags::ShockWave) || (shot->getFlag() == Flags::Thief))) return false;
+
+    // if no team kills, shots of my team cannot kill me. Thief can still take
+    // a teammate's flag.
+    if (getTeam() != RogueTeam && !World::getWorld()->allowTeamKills() &&
+            shot->getFlag() != Flags::Thief && shot->getTeam() == getTeam() &&
+            source != this) return false;
+
+    // short circuit test if shot can't possibly hit.
+    // only superbullet or shockwave can kill zoned dude
+    const FlagType* shotFlag = shot->getFlag();
+    if (isPhantomZoned() &&
+            (shotFlag != Flags::ShockWave) &&
+            (shotFlag != Flags::SuperBullet) &&
+            (shotFlag != Flags::PhantomZone))
+        return false;
+
+    // laser can't hit a cloaked tank
+    if ((getFlag() == Flags::Cloaking) && (shotFlag == Flags::Laser))
+        return false;
+
+    // zoned shots only kill zoned tanks
+    if ((shotFlag == Flags::PhantomZone) && !isPhantomZoned())
+        return false;
+
+    // test myself against shot
+    float position[3];
+    const float t = shot->checkHit(this, position);
+    if (t >= minTime) return false;
+
+    // test if shot hit a part of my tank that's through a teleporter.
+    // hit is no good if hit point is behind crossing plane.
+    if (isCrossingWall() && position[0] * crossingPlane[0] +
+            position[1] * crossingPlane[1] +
+            position[2] * crossingPlane[2] + crossingPlane[3] < 0.0)
+        return false;
+
+    // okay, shot hit
+    hit = shot;
+    minTime = t;
+    return true;
+}
+
 void            LocalPlayer::setFlag(FlagType* flag)
 {
     Player::setFlag(flag);
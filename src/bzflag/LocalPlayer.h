@@ -95,6 +95,8 @@ public:
     void      restart(const float* pos, float azimuth);
     bool      checkHit(const Player* source, const ShotPath*& hit,
                        float& minTime) const;
+    bool      checkShotHit(const Player* source, const ShotPath* shot,
+                           const ShotPath*& hit, float& minTime) const;
     void      setFlag(FlagType*);
     void      changeScore(short deltaWins, short deltaLosses, short deltaTeamKills);
 
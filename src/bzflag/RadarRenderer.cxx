@@ -54,7 +54,8 @@ RadarRenderer::RadarRenderer(const SceneRenderer&, World* _world)
       jammed(false),
       useTankModels(false),
       useTankDimensions(false),
-      triangleCount()
+      triangleCount(),
+      radarGeometryStyle(0)
 {
 
     setControlColor();
@@ -63,6 +64,8 @@ RadarRenderer::RadarRenderer(const SceneRenderer&, World* _world)
 void RadarRenderer::setWorld(World* _world)
 {
     world = _world;
+    // built again on the next frame from the new obstacles
+    radarGeometry.clear();
 }
 
 
@@ -852,7 +855,7 @@ void RadarRenderer::renderObstacles(bool fastRadar, float _range)
 
     // draw the boxes, pyramids, and meshes
     if (!fastRadar)
-        renderBoxPyrMesh();
+        renderBoxPyrMesh(_range);
     else
         renderBoxPyrMeshFast(_range);
 
@@ -918,7 +921,7 @@ void RadarRenderer::renderBoxPyrMeshFast(float _range)
     // safety: no texture, no service
     if (gradientTexId < 0)
     {
-        renderBoxPyrMesh();
+        renderBoxPyrMesh(_range);
         return;
     }
 
@@ -985,84 +988,48 @@ void RadarRenderer::renderBoxPyrMeshFast(float _range)
 }
 
 
-void RadarRenderer::renderBoxPyrMesh()
+void RadarRenderer::buildRadarGeometry(bool enhanced)
 {
-    int i;
+    radarGeometry.clear();
 
-    const bool enhanced = (BZDBCache::radarStyle > 0);
+    int i;
+    float xy[8];
 
-    if (!smooth)
+    // box and pyramid footprints
+    const ObstacleList* lists[2] = { &OBSTACLEMGR.getBoxes(), &OBSTACLEMGR.getPyrs() };
+    for (int l = 0; l < 2; l++)
     {
-        // smoothing has blending disabled
-        if (enhanced)
-        {
-            glEnable(GL_BLEND); // always blend the polygons if we're enhanced
-        }
-    }
-    else
-    {
-        // smoothing has blending enabled
-        if (!enhanced)
+        const ObstacleList& list = *lists[l];
+        const int count = list.size();
+        for (i = 0; i < count; i++)
         {
-            glDisable(GL_BLEND); // don't blend the polygons if we're not enhanced
+            const Obstacle& obs = *list[i];
+            if ((l == 0) && ((const BoxBuilding&)obs).isInvisible())
+                continue;
+            const float z = obs.getPosition()[2];
+            const float bh = obs.getHeight();
+            const float c = cosf(obs.getRotation());
+            const float s = sinf(obs.getRotation());
+            const float wx = c * obs.getWidth(), wy = s * obs.getWidth();
+            const float hx = -s * obs.getBreadth(), hy = c * obs.getBreadth();
+            const float* pos = obs.getPosition();
+            xy[0] = pos[0] - wx - hx;
+            xy[1] = pos[1] - wy - hy;
+            xy[2] = pos[0] + wx - hx;
+            xy[3] = pos[1] + wy - hy;
+            xy[4] = pos[0] + wx + hx;
+            xy[5] = pos[1] + wy + hy;
+            xy[6] = pos[0] - wx + hx;
+            xy[7] = pos[1] - wy + hy;
+            radarGeometry.addPolygon(RadarGeometry::Buildings, xy, 4, z, bh);
+            radarGeometry.addOutline(xy, 4, z, bh);
         }
     }
 
-    // draw box buildings.
-    const ObstacleList& boxes = OBSTACLEMGR.getBoxes();
-    int count = boxes.size();
-    for (i = 0; i < count; i++)
-    {
-        const BoxBuilding& box = *((const BoxBuilding*) boxes[i]);
-        if (box.isInvisible())
-            continue;
-        const float z = box.getPosition()[2];
-        const float bh = box.getHeight();
-        const float cs = colorScale(z, bh);
-        glColor4f(0.25f * cs, 0.5f * cs, 0.5f * cs, transScale(z, bh));
-        const float c = cosf(box.getRotation());
-        const float s = sinf(box.getRotation());
-        const float wx = c * box.getWidth(), wy = s * box.getWidth();
-        const float hx = -s * box.getBreadth(), hy = c * box.getBreadth();
-        const float* pos = box.getPosition();
-        glBegin(GL_TRIANGLE_STRIP);
-        glVertex2f(pos[0] - wx - hx, pos[1] - wy - hy);
-        glVertex2f(pos[0] + wx - hx, pos[1] + wy - hy);
-        glVertex2f(pos[0] - wx + hx, pos[1] - wy + hy);
-        glVertex2f(pos[0] + wx + hx, pos[1] + wy + hy);
-        glEnd();
-    }
-
-    // draw pyramid buildings
-    const ObstacleList& pyramids = OBSTACLEMGR.getPyrs();
-    count = pyramids.size();
-    for (i = 0; i < count; i++)
-    {
-        const PyramidBuilding& pyr = *((const PyramidBuilding*) pyramids[i]);
-        const float z = pyr.getPosition()[2];
-        const float bh = pyr.getHeight();
-        const float cs = colorScale(z, bh);
-        glColor4f(0.25f * cs, 0.5f * cs, 0.5f * cs, transScale(z, bh));
-        const float c = cosf(pyr.getRotation());
-        const float s = sinf(pyr.getRotation());
-        const float wx = c * pyr.getWidth(), wy = s * pyr.getWidth();
-        const float hx = -s * pyr.getBreadth(), hy = c * pyr.getBreadth();
-        const float* pos = pyr.getPosition();
-        glBegin(GL_TRIANGLE_STRIP);
-        glVertex2f(pos[0] - wx - hx, pos[1] - wy - hy);
-        glVertex2f(pos[0] + wx - hx, pos[1] + wy - hy);
-        glVertex2f(pos[0] - wx + hx, pos[1] - wy + hy);
-        glVertex2f(pos[0] + wx + hx, pos[1] + wy + hy);
-        glEnd();
-    }
-
-    // draw mesh obstacles
-    if (smooth)
-        glEnable(GL_POLYGON_SMOOTH);
-    if (!enhanced)
-        glDisable(GL_CULL_FACE);
+    // mesh faces
+    std::vector<float> faceXY;
     const ObstacleList& meshes = OBSTACLEMGR.getMeshes();
-    count = meshes.size();
+    const int count = meshes.size();
     for (i = 0; i < count; i++)
     {
         const MeshObstacle* mesh = (const MeshObstacle*) meshes[i];
@@ -1088,24 +1055,109 @@ void RadarRenderer::renderBoxPyrMesh()
                 bh = mesh->getSize()[2];
             }
 
-            const float cs = colorScale(z, bh);
             // draw death faces with a soupcon of red
             const PhysicsDriver* phydrv = PHYDRVMGR.getDriver(face->getPhysicsDriver());
-            if ((phydrv != NULL) && phydrv->getIsDeath())
-                glColor4f(0.75f * cs, 0.25f * cs, 0.25f * cs, transScale(z, bh));
-            else
-                glColor4f(0.25f * cs, 0.5f * cs, 0.5f * cs, transScale(z, bh));
-            // draw the face as a triangle fan
-            int vertexCount = face->getVertexCount();
-            glBegin(GL_TRIANGLE_FAN);
+            const bool death = (phydrv != NULL) && phydrv->getIsDeath();
+
+            const int vertexCount = face->getVertexCount();
+            faceXY.resize(vertexCount * 2);
             for (int v = 0; v < vertexCount; v++)
             {
                 const float* pos = face->getVertex(v);
-                glVertex2f(pos[0], pos[1]);
+                faceXY[v * 2 + 0] = pos[0];
+                faceXY[v * 2 + 1] = pos[1];
+            }
+            if (vertexCount > 0)
+            {
+                radarGeometry.addPolygon(RadarGeometry::Meshes, &faceXY[0],
+                                         vertexCount, z, bh, death);
             }
-            glEnd();
         }
     }
+
+    radarGeometry.finish(64.0f);
+    logDebugMessage(3, "Radar geometry: %d cells, %d/%d/%d vertices\n",
+                    radarGeometry.getCellCount(),
+                    radarGeometry.getVertexCount(RadarGeometry::Buildings),
+                    radarGeometry.getVertexCount(RadarGeometry::Meshes),
+                    radarGeometry.getVertexCount(RadarGeometry::Outlines));
+}
+
+
+void RadarRenderer::drawRadarBands(RadarGeometry::Layer layer, GLenum mode)
+{
+    const float* vertices = radarGeometry.getVertices(layer);
+    if (vertices == NULL)
+        return;
+    glVertexPointer(2, GL_FLOAT, 0, vertices);
+
+    const size_t cellCount = radarCells.size();
+    for (size_t c = 0; c < cellCount; c++)
+    {
+        int bandCount;
+        const RadarGeometry::Band* bands =
+            radarGeometry.getBands(radarCells[c], layer, bandCount);
+        for (int b = 0; b < bandCount; b++)
+        {
+            const RadarGeometry::Band& band = bands[b];
+            const float cs = colorScale(band.z, band.height);
+            if (band.death)
+                glColor4f(0.75f * cs, 0.25f * cs, 0.25f * cs, transScale(band.z, band.height));
+            else
+                glColor4f(0.25f * cs, 0.5f * cs, 0.5f * cs, transScale(band.z, band.height));
+            glDrawArrays(mode, band.first, band.count);
+        }
+    }
+}
+
+
+void RadarRenderer::renderBoxPyrMesh(float _range)
+{
+    const bool enhanced = (BZDBCache::radarStyle > 0);
+
+    // the geometry only depends on the world and these settings
+    const int style = (enhanced ? 1 : 0) | (BZDBCache::useMeshForRadar ? 2 : 0);
+    if (!radarGeometry.isFinished() || (radarGeometryStyle != style))
+    {
+        buildRadarGeometry(enhanced);
+        radarGeometryStyle = style;
+    }
+
+    // the radar is rotated, so cover the square's corners as well
+    const LocalPlayer* myTank = LocalPlayer::getMyTank();
+    radarGeometry.queryCells(myTank->getPosition(), _range * (float)M_SQRT2,
+                             radarCells);
+
+    if (!smooth)
+    {
+        // smoothing has blending disabled
+        if (enhanced)
+        {
+            glEnable(GL_BLEND); // always blend the polygons if we're enhanced
+        }
+    }
+    else
+    {
+        // smoothing has blending enabled
+        if (!enhanced)
+        {
+            glDisable(GL_BLEND); // don't blend the polygons if we're not enhanced
+        }
+    }
+
+    // only the vertex array is used
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+
+    // draw box and pyramid buildings
+    drawRadarBands(RadarGeometry::Buildings, GL_TRIANGLES);
+
+    // draw mesh obstacles
+    if (smooth)
+        glEnable(GL_POLYGON_SMOOTH);
+    if (!enhanced)
+        glDisable(GL_CULL_FACE);
+    drawRadarBands(RadarGeometry::Meshes, GL_TRIANGLES);
     if (!enhanced)
         glEnable(GL_CULL_FACE);
     if (smooth)
@@ -1119,51 +1171,12 @@ void RadarRenderer::renderBoxPyrMesh()
     if (smooth)
     {
         glEnable(GL_BLEND); // NOTE: revert from the enhanced setting
-        count = boxes.size();
-        for (i = 0; i < count; i++)
-        {
-            const BoxBuilding& box = *((const BoxBuilding*) boxes[i]);
-            if (box.isInvisible())
-                continue;
-            const float z = box.getPosition()[2];
-            const float bh = box.getHeight();
-            const float cs = colorScale(z, bh);
-            glColor4f(0.25f * cs, 0.5f * cs, 0.5f * cs, transScale(z, bh));
-            const float c = cosf(box.getRotation());
-            const float s = sinf(box.getRotation());
-            const float wx = c * box.getWidth(), wy = s * box.getWidth();
-            const float hx = -s * box.getBreadth(), hy = c * box.getBreadth();
-            const float* pos = box.getPosition();
-            glBegin(GL_LINE_LOOP);
-            glVertex2f(pos[0] - wx - hx, pos[1] - wy - hy);
-            glVertex2f(pos[0] + wx - hx, pos[1] + wy - hy);
-            glVertex2f(pos[0] + wx + hx, pos[1] + wy + hy);
-            glVertex2f(pos[0] - wx + hx, pos[1] - wy + hy);
-            glEnd();
-        }
-
-        count = pyramids.size();
-        for (i = 0; i < count; i++)
-        {
-            const PyramidBuilding& pyr = *((const PyramidBuilding*) pyramids[i]);
-            const float z = pyr.getPosition()[2];
-            const float bh = pyr.getHeight();
-            const float cs = colorScale(z, bh);
-            glColor4f(0.25f * cs, 0.5f * cs, 0.5f * cs, transScale(z, bh));
-            const float c = cosf(pyr.getRotation());
-            const float s = sinf(pyr.getRotation());
-            const float wx = c * pyr.getWidth(), wy = s * pyr.getWidth();
-            const float hx = -s * pyr.getBreadth(), hy = c * pyr.getBreadth();
-            const float* pos = pyr.getPosition();
-            glBegin(GL_LINE_LOOP);
-            glVertex2f(pos[0] - wx - hx, pos[1] - wy - hy);
-            glVertex2f(pos[0] + wx - hx, pos[1] + wy - hy);
-            glVertex2f(pos[0] + wx + hx, pos[1] + wy + hy);
-            glVertex2f(pos[0] - wx + hx, pos[1] - wy + hy);
-            glEnd();
-        }
+        drawRadarBands(RadarGeometry::Outlines, GL_LINES);
     }
 
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+
     return;
 }
 
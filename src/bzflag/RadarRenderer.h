@@ -19,9 +19,17 @@
 #define BZF_RADAR_RENDERER_H
 
 #include "common.h"
+
+// system headers
+#include <vector>
+
+// common headers
 #include "bzfgl.h"
 #include "Obstacle.h"
 
+// local headers
+#include "RadarGeometry.h"
+
 
 class SceneRenderer;
 class World;
@@ -51,7 +59,7 @@ public:
 
     void        renderObstacles(bool fastRadar, float range);
     void        renderWalls();
-    void        renderBoxPyrMesh();
+    void        renderBoxPyrMesh(float range);
     void        renderBoxPyrMeshFast(float range);
     void        renderBasesAndTeles();
 
@@ -71,6 +79,9 @@ private:
     void        drawFlag(const float pos[3]);
     void        drawFlagOnTank(const float pos[3]);
 
+    void        buildRadarGeometry(bool enhanced);
+    void        drawRadarBands(RadarGeometry::Layer layer, GLenum mode);
+
     static float    colorScale(const float z, const float h);
     static float    transScale(const float z, const float h);
 
@@ -89,6 +100,11 @@ private:
     bool        useTankDimensions;
     int         triangleCount;
     static const float  colorFactor;
+
+    // the boxes, pyramids and meshes, rebuilt for each world
+    RadarGeometry   radarGeometry;
+    int         radarGeometryStyle;
+    std::vector<int> radarCells;
 };
 
 //
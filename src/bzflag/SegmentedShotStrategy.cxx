@@ -31,7 +31,7 @@
 #include "playing.h"
 
 SegmentedShotStrategy::SegmentedShotStrategy(ShotPath* _path, bool useSuperTexture, bool faint) :
-    ShotStrategy(_path), bbox()
+    ShotStrategy(_path), bbox(), haveHitBounds(false)
 {
     // initialize times
     prevTime = getPath().getStartTime();
@@ -87,6 +87,9 @@ void  SegmentedShotStrategy::update(float dt)
     prevTime = currentTime;
     currentTime += dt;
 
+    // only compute as much of the path as the shot has covered
+    extendSegments(currentTime);
+
     // see if we've moved to another segment
     const int numSegments = segments.size();
     if (segment < numSegments && segments[segment].end <= currentTime)
@@ -172,6 +175,57 @@ void  SegmentedShotStrategy::update(float dt)
         setPosition(p);
         setVelocity(segments[segment].ray.getDirection());
     }
+
+    updateHitBounds();
+}
+
+void  SegmentedShotStrategy::updateHitBounds()
+{
+    // everywhere checkHit() can put the shot during (prevTime,currentTime].
+    // it extends a segment's ray back to prevTime, so this does too.
+    haveHitBounds = true;
+    bool empty = true;
+    const int numSegments = segments.size();
+    for (int i = lastSegment; i <= segment && i < numSegments; i++)
+    {
+        const ShotPathSegment& s = segments[i];
+        if ((s.end - prevTime) < 0.0)
+            continue;
+        float endTime = float(currentTime - s.start);
+        if (endTime > float(s.end - s.start))
+            endTime = float(s.end - s.start);
+        float ends[2][3];
+        s.ray.getPoint(float(prevTime - s.start), ends[0]);
+        s.ray.getPoint(endTime, ends[1]);
+        for (int e = 0; e < 2; e++)
+        {
+            for (int a = 0; a < 3; a++)
+            {
+                if (empty || (ends[e][a] < hitBBox[0][a])) hitBBox[0][a] = ends[e][a];
+                if (empty || (ends[e][a] > hitBBox[1][a])) hitBBox[1][a] = ends[e][a];
+            }
+            empty = false;
+        }
+    }
+
+    // nothing to hit this frame, keep the box away from everything
+    if (empty)
+    {
+        hitBBox[0][0] = hitBBox[0][1] = hitBBox[0][2] = Infinity;
+        hitBBox[1][0] = hitBBox[1][1] = hitBBox[1][2] = -Infinity;
+    }
+}
+
+bool  SegmentedShotStrategy::getHitBounds(float (*bounds)[3]) const
+{
+    if (!haveHitBounds)
+        return false;
+    for (int a = 0; a < 3; a++)
+    {
+        bounds[0][a] = hitBBox[0][a];
+        bounds[1][a] = hitBBox[1][a];
+    }
+    return true;
 }
 
 void  SegmentedShotStrategy::setCurrentTime(const
@@ -396,205 +450,231 @@ void  SegmentedShotStrategy::radarRender() const
 
 }
 
-void  SegmentedShotStrategy::makeSegments(ObstacleEffect e)
+void  SegmentedShotStrategy::startSegments(ObstacleEffect e)
 {
-    // compute segments of shot until total length of segments exceeds the
-    // lifetime of the shot.
+    // the path is computed from the shot as fired, so extending it
+    // later gives the same segments as computing it all at once.
     const ShotPath &shotPath = getPath();
     const float    *v = shotPath.getVelocity();
-    TimeKeeper      startTime = shotPath.getStartTime();
-    float timeLeft = shotPath.getLifetime();
-    float    minTime = BZDB.eval(StateDatabase::BZDB_MUZZLEFRONT)
-                       / hypotf(v[0], hypotf(v[1], v[2]));
+    segmentStart = shotPath.getStartTime();
+    pathTimeLeft = shotPath.getLifetime();
+    pathMinTime = BZDB.eval(StateDatabase::BZDB_MUZZLEFRONT)
+                  / hypotf(v[0], hypotf(v[1], v[2]));
 
     // if all shots ricochet and obstacle effect is stop, then make it ricochet
     if (e == Stop && World::getWorld()->allShotsRicochet())
         e = Reflect;
+    pathEffect = e;
 
     // prepare first segment
-    float o[3], d[3];
-    d[0] = v[0];
-    d[1] = v[1];
-    d[2] = v[2];      // use v[2] to have jumping affect shot velocity
-    o[0] = shotPath.getPosition()[0];
-    o[1] = shotPath.getPosition()[1];
-    o[2] = shotPath.getPosition()[2];
+    pathDir[0] = v[0];
+    pathDir[1] = v[1];
+    pathDir[2] = v[2];      // use v[2] to have jumping affect shot velocity
+    pathOrigin[0] = shotPath.getPosition()[0];
+    pathOrigin[1] = shotPath.getPosition()[1];
+    pathOrigin[2] = shotPath.getPosition()[2];
+    pathReason = ShotPathSegment::Initial;
 
     segments.clear();
-    ShotPathSegment::Reason reason = ShotPathSegment::Initial;
-    int i;
+    lastTime = segmentStart;
+    bbox[0][0] = bbox[1][0] = 0.0f;
+    bbox[0][1] = bbox[1][1] = 0.0f;
+    bbox[0][2] = bbox[1][2] = 0.0f;
+
+    // the rest is added as the shot gets there
+    addSegment();
+}
+
+bool  SegmentedShotStrategy::addSegment()
+{
+    // stop when the segments add up to the lifetime of the shot
     const int maxSegment = 100;
+    const int i = segments.size();
+    if ((i >= maxSegment) || (pathTimeLeft <= Epsilon))
+        return false;
+
+    const ShotPath &shotPath = getPath();
+    const ObstacleEffect e = pathEffect;
+    float* o = pathOrigin;
+    float* d = pathDir;
     float worldSize = BZDBCache::worldSize / 2.0f - 0.01f;
-    for (i = 0; (i < maxSegment) && (timeLeft > Epsilon); i++)
-    {
-        // construct ray and find the first building, teleporter, or outer wall
-        float o2[3];
-        o2[0] = o[0] - minTime * d[0];
-        o2[1] = o[1] - minTime * d[1];
-        o2[2] = o[2] - minTime * d[2];
-
-        // Sometime shot start outside world
-        if (o2[0] <= -worldSize)
-            o2[0] = -worldSize;
-        if (o2[0] >= worldSize)
-            o2[0] = worldSize;
-        if (o2[1] <= -worldSize)
-            o2[1] = -worldSize;
-        if (o2[1] >= worldSize)
-            o2[1] = worldSize;
-
-        Ray r(o2, d);
-        Ray rs(o, d);
-        float t = timeLeft + minTime;
-        int face;
-        bool hitGround = getGround(r, Epsilon, t);
-        const Obstacle* building = ((e == Through) ? NULL : getFirstBuilding(r, Epsilon, t));
-        const Teleporter* teleporter = getFirstTeleporter(r, Epsilon, t, face);
-        t -= minTime;
-        minTime = 0.0f;
-        bool ignoreHit = false;
-
-        // if hit outer wall with ricochet and hit is above top of wall
-        // then ignore hit.
-        if (!teleporter && building && (e == Reflect) &&
-                (building->getType() == WallObstacle::getClassName()) &&
-                ((o[2] + t * d[2]) > building->getHeight()))
-            ignoreHit = true;
-
-        // construct next shot segment and add it to list
-        TimeKeeper endTime(startTime);
-        if (t < 0.0f)
-            endTime += Epsilon;
-        else
-            endTime += t;
-        ShotPathSegment segm(startTime, endTime, rs, reason);
-        segments.push_back(segm);
-        startTime = endTime;
-
-        // used up this much time in segment
-        if (t < 0.0f)
-            timeLeft -= Epsilon;
-        else
-            timeLeft -= t;
 
-        // check in reverse order to see what we hit first
-        reason = ShotPathSegment::Through;
-        if (ignoreHit)
+    // construct ray and find the first building, teleporter, or outer wall
+    float o2[3];
+    o2[0] = o[0] - pathMinTime * d[0];
+    o2[1] = o[1] - pathMinTime * d[1];
+    o2[2] = o[2] - pathMinTime * d[2];
+
+    // Sometime shot start outside world
+    if (o2[0] <= -worldSize)
+        o2[0] = -worldSize;
+    if (o2[0] >= worldSize)
+        o2[0] = worldSize;
+    if (o2[1] <= -worldSize)
+        o2[1] = -worldSize;
+    if (o2[1] >= worldSize)
+        o2[1] = worldSize;
+
+    Ray r(o2, d);
+    Ray rs(o, d);
+    float t = pathTimeLeft + pathMinTime;
+    int face;
+    bool hitGround = getGround(r, Epsilon, t);
+    const Obstacle* building = ((e == Through) ? NULL : getFirstBuilding(r, Epsilon, t));
+    const Teleporter* teleporter = getFirstTeleporter(r, Epsilon, t, face);
+    t -= pathMinTime;
+    pathMinTime = 0.0f;
+    bool ignoreHit = false;
+
+    // if hit outer wall with ricochet and hit is above top of wall
+    // then ignore hit.
+    if (!teleporter && building && (e == Reflect) &&
+            (building->getType() == WallObstacle::getClassName()) &&
+            ((o[2] + t * d[2]) > building->getHeight()))
+        ignoreHit = true;
+
+    // construct next shot segment and add it to list
+    TimeKeeper endTime(segmentStart);
+    if (t < 0.0f)
+        endTime += Epsilon;
+    else
+        endTime += t;
+    ShotPathSegment segm(segmentStart, endTime, rs, pathReason);
+    segments.push_back(segm);
+    segmentStart = endTime;
+
+    // used up this much time in segment
+    if (t < 0.0f)
+        pathTimeLeft -= Epsilon;
+    else
+        pathTimeLeft -= t;
+
+    // check in reverse order to see what we hit first
+    pathReason = ShotPathSegment::Through;
+    if (ignoreHit)
+    {
+        // uh...ignore this.  usually used if you shoot over the boundary wall.
+        // just move the point of origin and build the next segment
+        o[0] += t * d[0];
+        o[1] += t * d[1];
+        o[2] += t * d[2];
+        pathReason = ShotPathSegment::Boundary;
+    }
+    else if (teleporter)
+    {
+        // entered teleporter -- teleport it
+        unsigned int seed = shotPath.getShotId() + i;
+        int source = World::getWorld()->getTeleporter(teleporter, face);
+        int target = World::getWorld()->getTeleportTarget(source, seed);
+
+        int outFace;
+        const Teleporter* outTeleporter =
+            World::getWorld()->getTeleporter(target, outFace);
+        o[0] += t * d[0];
+        o[1] += t * d[1];
+        o[2] += t * d[2];
+        teleporter->getPointWRT(*outTeleporter, face, outFace,
+                                o, d, 0.0f, o, d, NULL);
+        pathReason = ShotPathSegment::Teleport;
+    }
+    else if (building)
+    {
+        // hit building -- can bounce off or stop, buildings ignored for Through
+        bool handled = false;
+        if (e == Stop)
         {
-            // uh...ignore this.  usually used if you shoot over the boundary wall.
-            // just move the point of origin and build the next segment
-            o[0] += t * d[0];
-            o[1] += t * d[1];
-            o[2] += t * d[2];
-            reason = ShotPathSegment::Boundary;
+            if (!building->canRicochet())
+            {
+                pathTimeLeft = 0.0f;
+                handled = true;
+            }
         }
-        else if (teleporter)
+        if ((e == Stop && !handled) || e == Reflect)
         {
-            // entered teleporter -- teleport it
-            unsigned int seed = shotPath.getShotId() + i;
-            int source = World::getWorld()->getTeleporter(teleporter, face);
-            int target = World::getWorld()->getTeleportTarget(source, seed);
-
-            int outFace;
-            const Teleporter* outTeleporter =
-                World::getWorld()->getTeleporter(target, outFace);
+            // move origin to point of reflection
             o[0] += t * d[0];
             o[1] += t * d[1];
             o[2] += t * d[2];
-            teleporter->getPointWRT(*outTeleporter, face, outFace,
-                                    o, d, 0.0f, o, d, NULL);
-            reason = ShotPathSegment::Teleport;
-        }
-        else if (building)
-        {
-            // hit building -- can bounce off or stop, buildings ignored for Through
-            bool handled = false;
-            if (e == Stop)
-            {
-                if (!building->canRicochet())
-                {
-                    timeLeft = 0.0f;
-                    handled = true;
-                }
-            }
-            if ((e == Stop && !handled) || e == Reflect)
-            {
-                // move origin to point of reflection
-                o[0] += t * d[0];
-                o[1] += t * d[1];
-                o[2] += t * d[2];
-
-                // reflect direction about normal to building
-                float normal[3];
-                building->get3DNormal(o, normal);
-                reflect(d, normal);
-                reason = ShotPathSegment::Ricochet;
-            }
 
-            if (e == Through)
-                assert(0);
+            // reflect direction about normal to building
+            float normal[3];
+            building->get3DNormal(o, normal);
+            reflect(d, normal);
+            pathReason = ShotPathSegment::Ricochet;
         }
-        else if (hitGround)     // we hit the ground
+
+        if (e == Through)
+            assert(0);
+    }
+    else if (hitGround)     // we hit the ground
+    {
+
+        switch (e)
+        {
+        case Stop:
+        case Through:
         {
+            pathTimeLeft = 0.0f;
+            break;
+        }
 
-            switch (e)
-            {
-            case Stop:
-            case Through:
-            {
-                timeLeft = 0.0f;
-                break;
-            }
+        case Reflect:
+        {
+            // move origin to point of reflection
+            o[0] += t * d[0];
+            o[1] += t * d[1];
+            o[2] += t * d[2];
 
-            case Reflect:
-            {
-                // move origin to point of reflection
-                o[0] += t * d[0];
-                o[1] += t * d[1];
-                o[2] += t * d[2];
-
-                // reflect direction about normal to ground
-                float normal[3];
-                normal[0] = 0.0f;
-                normal[1] = 0.0f;
-                normal[2] = 1.0f;
-                reflect(d, normal);
-                reason = ShotPathSegment::Ricochet;
-                break;
-            }
-            }
+            // reflect direction about normal to ground
+            float normal[3];
+            normal[0] = 0.0f;
+            normal[1] = 0.0f;
+            normal[2] = 1.0f;
+            reflect(d, normal);
+            pathReason = ShotPathSegment::Ricochet;
+            break;
+        }
         }
     }
-    lastTime = startTime;
 
-    // make bounding box for entire path
-    const int numSegments = segments.size();
-    if (numSegments > 0)
+    lastTime = segmentStart;
+
+    // grow the bounding box for the entire path
+    const ShotPathSegment& last = segments.back();
+    if (i == 0)
     {
-        const ShotPathSegment& firstSeg = segments[0];
-        bbox[0][0] = firstSeg.bbox[0][0];
-        bbox[0][1] = firstSeg.bbox[0][1];
-        bbox[0][2] = firstSeg.bbox[0][2];
-        bbox[1][0] = firstSeg.bbox[1][0];
-        bbox[1][1] = firstSeg.bbox[1][1];
-        bbox[1][2] = firstSeg.bbox[1][2];
-        for (i = 1; i < numSegments; i++)
-        {
-            const ShotPathSegment& segm = segments[i];
-            if (bbox[0][0] > segm.bbox[0][0]) bbox[0][0] = segm.bbox[0][0];
-            if (bbox[1][0] < segm.bbox[1][0]) bbox[1][0] = segm.bbox[1][0];
-            if (bbox[0][1] > segm.bbox[0][1]) bbox[0][1] = segm.bbox[0][1];
-            if (bbox[1][1] < segm.bbox[1][1]) bbox[1][1] = segm.bbox[1][1];
-            if (bbox[0][2] > segm.bbox[0][2]) bbox[0][2] = segm.bbox[0][2];
-            if (bbox[1][2] < segm.bbox[1][2]) bbox[1][2] = segm.bbox[1][2];
-        }
+        bbox[0][0] = last.bbox[0][0];
+        bbox[0][1] = last.bbox[0][1];
+        bbox[0][2] = last.bbox[0][2];
+        bbox[1][0] = last.bbox[1][0];
+        bbox[1][1] = last.bbox[1][1];
+        bbox[1][2] = last.bbox[1][2];
     }
     else
     {
-        bbox[0][0] = bbox[1][0] = 0.0f;
-        bbox[0][1] = bbox[1][1] = 0.0f;
-        bbox[0][2] = bbox[1][2] = 0.0f;
+        if (bbox[0][0] > last.bbox[0][0]) bbox[0][0] = last.bbox[0][0];
+        if (bbox[1][0] < last.bbox[1][0]) bbox[1][0] = last.bbox[1][0];
+        if (bbox[0][1] > last.bbox[0][1]) bbox[0][1] = last.bbox[0][1];
+        if (bbox[1][1] < last.bbox[1][1]) bbox[1][1] = last.bbox[1][1];
+        if (bbox[0][2] > last.bbox[0][2]) bbox[0][2] = last.bbox[0][2];
+        if (bbox[1][2] < last.bbox[1][2]) bbox[1][2] = last.bbox[1][2];
     }
+    return true;
+}
+
+void  SegmentedShotStrategy::extendSegments(const TimeKeeper& until)
+{
+    while ((segments.empty() || (segments.back().end <= until)) && addSegment())
+        ;
+}
+
+void  SegmentedShotStrategy::makeSegments(ObstacleEffect e)
+{
+    // compute segments of shot until total length of segments exceeds the
+    // lifetime of the shot.
+    startSegments(e);
+    while (addSegment())
+        ;
 }
 
 const std::vector<ShotPathSegment>& SegmentedShotStrategy::getSegments() const
@@ -610,7 +690,7 @@ NormalShotStrategy::NormalShotStrategy(ShotPath* _path) :
     SegmentedShotStrategy(_path, false)
 {
     // make segments
-    makeSegments(Stop);
+    startSegments(Stop);
 }
 
 NormalShotStrategy::~NormalShotStrategy()
@@ -636,7 +716,7 @@ RapidFireStrategy::RapidFireStrategy(ShotPath* _path) :
                   / BZDB.eval(StateDatabase::BZDB_RFIREADRATE));
 
     // make segments
-    makeSegments(Stop);
+    startSegments(Stop);
 }
 
 RapidFireStrategy::~RapidFireStrategy()
@@ -760,7 +840,7 @@ MachineGunStrategy::MachineGunStrategy(ShotPath* _path) :
                   / BZDB.eval(StateDatabase::BZDB_MGUNADRATE));
 
     // make segments
-    makeSegments(Stop);
+    startSegments(Stop);
 }
 
 MachineGunStrategy::~MachineGunStrategy()
@@ -776,7 +856,7 @@ RicochetStrategy::RicochetStrategy(ShotPath* _path) :
     SegmentedShotStrategy(_path, false)
 {
     // make segments that bounce
-    makeSegments(Reflect);
+    startSegments(Reflect);
 }
 
 RicochetStrategy::~RicochetStrategy()
@@ -792,7 +872,7 @@ SuperBulletStrategy::SuperBulletStrategy(ShotPath* _path) :
     SegmentedShotStrategy(_path, true)
 {
     // make segments that go through buildings
-    makeSegments(Through);
+    startSegments(Through);
 }
 
 SuperBulletStrategy::~SuperBulletStrategy()
@@ -805,7 +885,7 @@ PhantomBulletStrategy::PhantomBulletStrategy(ShotPath* _path) :
     SegmentedShotStrategy(_path, false, true)
 {
     // make segments that go through buildings
-    makeSegments(Through);
+    startSegments(Through);
 }
 
 PhantomBulletStrategy::~PhantomBulletStrategy()
@@ -38,6 +38,7 @@ public:
 
     void        update(float dt);
     float       checkHit(const BaseLocalPlayer*, float[3]) const;
+    bool        getHitBounds(float (*bbox)[3]) const;
     void        addShot(SceneDatabase*, bool colorblind);
     void        radarRender() const;
     TeamColor   team;
@@ -49,7 +50,10 @@ protected:
         Through = 1,
         Reflect = 2
     };
+    // the whole path now, for shots that draw or use all of it
     void        makeSegments(ObstacleEffect = Stop);
+    // the first segment now, the rest as update() reaches it
+    void        startSegments(ObstacleEffect = Stop);
     const std::vector<ShotPathSegment>& getSegments() const;
 
     void        setCurrentTime(const TimeKeeper&);
@@ -60,6 +64,11 @@ protected:
 
     void        setCurrentSegment(int segment);
 
+private:
+    bool        addSegment();
+    void        extendSegments(const TimeKeeper& until);
+    void        updateHitBounds();
+
 private:
     TimeKeeper      prevTime;
     TimeKeeper      currentTime;
@@ -68,6 +77,19 @@ private:
     std::vector<ShotPathSegment>    segments;
     BoltSceneNode*  boltSceneNode;
     float       bbox[2][3];
+
+    // where the next segment starts
+    ObstacleEffect  pathEffect;
+    TimeKeeper      segmentStart;
+    float       pathOrigin[3];
+    float       pathDir[3];
+    float       pathTimeLeft;
+    float       pathMinTime;
+    ShotPathSegment::Reason pathReason;
+
+    // the shot's path during the last update()
+    bool        haveHitBounds;
+    float       hitBBox[2][3];
 };
 
 class NormalShotStrategy : public SegmentedShotStrategy
@@ -102,6 +102,11 @@ float           ShotPath::checkHit(const BaseLocalPlayer* player,
     return strategy->checkHit(player, position);
 }
 
+bool            ShotPath::getHitBounds(float (*bbox)[3]) const
+{
+    return strategy->getHitBounds(bbox);
+}
+
 bool            ShotPath::isStoppedByHit() const
 {
     return strategy->isStoppedByHit();
@@ -58,6 +58,7 @@ public:
     const float*    getVelocity() const;
 
     float       checkHit(const BaseLocalPlayer*, float position[3]) const;
+    bool        getHitBounds(float (*bbox)[3]) const;
     void        setExpiring();
     void        setExpired();
     bool        isStoppedByHit() const;
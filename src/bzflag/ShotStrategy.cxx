@@ -36,6 +36,11 @@ bool ShotStrategy::isStoppedByHit() const
     return true;
 }
 
+bool ShotStrategy::getHitBounds(float (*)[3]) const
+{
+    return false;
+}
+
 void ShotStrategy::sendUpdate(const FiringInfo&) const
 {
     // do nothing by default -- normal shots don't need updates
@@ -42,6 +42,9 @@ public:
 
     virtual void    update(float dt) = 0;
     virtual float   checkHit(const BaseLocalPlayer*, float pos[3]) const = 0;
+    // false if the shot could be anywhere, otherwise the box
+    // checkHit() can find it in since the last update()
+    virtual bool    getHitBounds(float (*bbox)[3]) const;
     virtual bool    isStoppedByHit() const;
     virtual void    addShot(SceneDatabase*, bool colorblind) = 0;
     virtual void    expire();
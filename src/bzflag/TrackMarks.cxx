@@ -14,6 +14,9 @@
 // Interface header
 #include "TrackMarks.h"
 
+// System headers
+#include <vector>
+
 // Common interface headers
 #include "StateDatabase.h"
 #include "BZDBCache.h"
@@ -25,6 +28,9 @@
 #include "SceneDatabase.h"
 #include "SceneRenderer.h"
 #include "SceneNode.h"
+#include "Extents.h"
+#include "Intersect.h"
+#include "TrackRing.h"
 
 
 using namespace TrackMarks;
@@ -47,103 +53,29 @@ enum TrackSides
 
 
 //
-// Helper Classes  (TrackEntry, TrackList, TrackRenderNode, TrackSceneNode)
+// Helper Classes  (TrackNodeRing, TrackRenderNode, TrackSceneNode)
 //
 
-class TrackEntry
-{
-public:
-    ~TrackEntry();
-    TrackEntry* getNext();
-
-protected:
-    TrackEntry* next;
-    TrackEntry* prev;
-public:
-    float pos[3];
-    float angle;
-    float scale;
-    char sides;
-    int phydrv;
-    float lifeTime;
-    class TrackSceneNode* sceneNode;
-
-    friend class TrackList;
-};
-
-inline TrackEntry* TrackEntry::getNext()
-{
-    return next;
-}
-
+class TrackSceneNode;
 
-class TrackList
+// A TrackRing with the scene nodes of its slots, they are only used
+// without the zbuffer.  slots never move, so each slot keeps its node
+// for good.
+class TrackNodeRing : public TrackRing
 {
 public:
-    TrackList()
-    {
-        start = end = NULL;
-    }
-    ~TrackList()
-    {
-        clear();
-    }
-
-    void clear();
+    TrackNodeRing(int capacity);
+    ~TrackNodeRing();
 
-    TrackEntry* getStart()
+    TrackSceneNode*& getSceneNode(int slot)
     {
-        return start;
-    }
-    TrackEntry* getEnd()
-    {
-        return end;
+        return sceneNodes[slot];
     }
 
-    void addNode(TrackEntry&);
-    TrackEntry* removeNode(TrackEntry*); // return the next entry
-
 private:
-    TrackEntry* start;
-    TrackEntry* end;
+    std::vector<TrackSceneNode*> sceneNodes;
 };
 
-inline void TrackList::addNode(TrackEntry& te)
-{
-    TrackEntry* copy = new TrackEntry;
-    *copy = te;
-    copy->next = NULL;
-    if (end == NULL)
-    {
-        copy->prev = NULL;
-        start = end = copy;
-    }
-    else
-    {
-        copy->prev = end;
-        end->next = copy;
-        end = copy;
-    }
-    return;
-}
-
-inline TrackEntry* TrackList::removeNode(TrackEntry* te)
-{
-    TrackEntry* const next = te->next;
-    TrackEntry* const prev = te->prev;
-    if (next != NULL)
-        next->prev = prev;
-    else
-        end = prev;
-    if (prev != NULL)
-        prev->next = next;
-    else
-        start = next;
-    delete te; // delete it (and its sceneNode, in ~TrackEntry())
-    return next;
-}
-
-
 
 class TrackRenderNode : public RenderNode
 {
@@ -186,14 +118,20 @@ private:
 // Local Variables
 //
 
-static TrackList SmokeList;
-static TrackList PuddleList;
-static TrackList TreadsGroundList;
-static TrackList TreadsObstacleList;
+static TrackNodeRing SmokeRing(1024);
+static TrackNodeRing PuddleRing(4096);
+static TrackNodeRing TreadsGroundRing(8192);
+static TrackNodeRing TreadsObstacleRing(4096);
+static double TrackClock = 0.0;
 static float TrackFadeTime = 5.0f;
 static float UserFadeScale = 1.0f;
 static AirCullStyle AirCull = FullAirCull;
 
+// the cells that marks are filed under, covering the world
+static const float GridCellSize = 64.0f;
+static float GridWorldSize = 0.0f;
+static int GridSide = 0;
+
 // FIXME - get these from AnimatedTreads
 static const float TreadOutside = 1.4f;
 static const float TreadInside = 0.875f;
@@ -213,6 +151,10 @@ static const float TextureHeightOffset = 0.05f;
 static const float TextureHeightOffset = 0.0f;
 #endif // FANCY_TREADMARKS
 
+// x y z, s t, r g b a
+static const int FloatsPerVertex = 9;
+static std::vector<float> markVertices;
+
 
 //
 // Function Prototypes
@@ -221,9 +163,14 @@ static const float TextureHeightOffset = 0.0f;
 static void setup();
 static void drawPuddle(const TrackEntry& te);
 static void drawTreads(const TrackEntry& te);
+static void addPuddleQuads(const TrackEntry& te, float ratio);
+static void addTreadsQuads(const TrackEntry& te, float ratio);
+static void renderRing(TrackRing& ring, TrackType type);
 static bool onBuilding(const float pos[3]);
-static void updateList(TrackList& list, float dt);
-static void addEntryToList(TrackList& list,
+static void updateGrid();
+static int getCell(const float pos[3]);
+static void updateRing(TrackRing& ring, float dt);
+static void addEntryToRing(TrackNodeRing& ring,
                            TrackEntry& te, TrackType type);
 
 
@@ -251,10 +198,10 @@ void TrackMarks::kill()
 
 void TrackMarks::clear()
 {
-    SmokeList.clear();
-    PuddleList.clear();
-    TreadsGroundList.clear();
-    TreadsObstacleList.clear();
+    SmokeRing.clear();
+    PuddleRing.clear();
+    TreadsGroundRing.clear();
+    TreadsObstacleRing.clear();
     return;
 }
 
@@ -297,13 +244,50 @@ AirCullStyle TrackMarks::getAirCulling()
 }
 
 
-static void addEntryToList(TrackList& list,
+static void updateGrid()
+{
+    float worldSize = BZDB.eval(StateDatabase::BZDB_WORLDSIZE);
+    if (worldSize < GridCellSize)
+        worldSize = GridCellSize;
+    if ((worldSize == GridWorldSize) && (GridSide > 0))
+        return;
+
+    // a new world, the old marks are meaningless
+    GridWorldSize = worldSize;
+    GridSide = (int)ceilf(worldSize / GridCellSize);
+    SmokeRing.setCellCount(GridSide * GridSide);
+    PuddleRing.setCellCount(GridSide * GridSide);
+    TreadsGroundRing.setCellCount(GridSide * GridSide);
+    TreadsObstacleRing.setCellCount(GridSide * GridSide);
+    return;
+}
+
+
+static int getCell(const float pos[3])
+{
+    // marks past the edge are filed in the border cells, whose
+    // extents grow to cover them
+    const float half = 0.5f * GridWorldSize;
+    int col = (int)((pos[0] + half) / GridCellSize);
+    int row = (int)((pos[1] + half) / GridCellSize);
+    if (col < 0)
+        col = 0;
+    else if (col >= GridSide)
+        col = GridSide - 1;
+    if (row < 0)
+        row = 0;
+    else if (row >= GridSide)
+        row = GridSide - 1;
+    return (row * GridSide) + col;
+}
+
+
+static void addEntryToRing(TrackNodeRing& ring,
                            TrackEntry& te, TrackType type)
 {
-    // push the entry
-    list.addNode(te);
+    const int slot = ring.add(te, getCell(te.pos));
 
-    // make a sceneNode for the BSP rendering, if not on the ground
+    // the BSP rendering needs a sceneNode if not on the ground
     if (!BZDBCache::zbuffer && (te.pos[2] != TextureHeightOffset))
     {
         const OpenGLGState* gstate = NULL;
@@ -315,8 +299,9 @@ static void addEntryToList(TrackList& list,
             gstate = &smokeGState;
         else
             return;
-        TrackEntry* copy = list.getEnd();
-        copy->sceneNode = new TrackSceneNode(copy, type, gstate);
+        TrackSceneNode*& node = ring.getSceneNode(slot);
+        if (node == NULL)
+            node = new TrackSceneNode(&ring.getSlot(slot), type, gstate);
     }
     return;
 }
@@ -327,8 +312,10 @@ bool TrackMarks::addMark(const float pos[3], float scale, float angle,
 {
     TrackEntry te;
     TrackType type;
-    te.lifeTime = 0.0f;
-    te.sceneNode = NULL;
+    te.birthTime = TrackClock;
+    te.sides = BothTreads;
+
+    updateGrid();
 
     // determine the track mark type
     if ((pos[2] <= 0.1f) && BZDB.get(StateDatabase::BZDB_MIRROR) != "none")
@@ -379,7 +366,7 @@ bool TrackMarks::addMark(const float pos[3], float scale, float angle,
     if (type == PuddleTrack)
     {
         // Puddle track marks
-        addEntryToList(PuddleList, te, type);
+        addEntryToRing(PuddleRing, te, type);
     }
     else
     {
@@ -388,13 +375,13 @@ bool TrackMarks::addMark(const float pos[3], float scale, float angle,
         {
             // no culling required
             te.sides = BothTreads;
-            addEntryToList(TreadsGroundList, te, type);
+            addEntryToRing(TreadsGroundRing, te, type);
         }
         else if ((AirCull & InitAirCull) == 0)
         {
             // do not cull the air marks
             te.sides = BothTreads;
-            addEntryToList(TreadsObstacleList, te, type);
+            addEntryToRing(TreadsObstacleRing, te, type);
         }
         else
         {
@@ -416,7 +403,7 @@ bool TrackMarks::addMark(const float pos[3], float scale, float angle,
                 te.sides |= RightTread;
             // add if required
             if (te.sides != 0)
-                addEntryToList(TreadsObstacleList, te, type);
+                addEntryToRing(TreadsObstacleRing, te, type);
             else
                 return false;
         }
@@ -450,22 +437,21 @@ static bool onBuilding(const float pos[3])
 }
 
 
-static void updateList(TrackList& list, float dt)
+static void updateRing(TrackRing& ring, float dt)
 {
-    TrackEntry* ptr = list.getStart();
-    while (ptr != NULL)
-    {
-        TrackEntry& te = *ptr;
+    // drop the faded marks, they are all at the front
+    ring.expire(TrackClock, TrackFadeTime);
 
-        // increase the lifeTime
-        te.lifeTime += dt;
+    // only marks on physics drivers change after they are made
+    if (ring.getMovingCount() == 0)
+        return;
 
-        // see if this mark has expired
-        if (te.lifeTime > TrackFadeTime)
-        {
-            ptr = list.removeNode(ptr);
+    const int count = ring.getCount();
+    for (int i = 0; i < count; i++)
+    {
+        TrackEntry& te = ring.get(i);
+        if ((te.cell < 0) || (te.phydrv < 0))
             continue;
-        }
 
         // update for the Physics Driver
         const PhysicsDriver* phydrv = PHYDRVMGR.getDriver(te.phydrv);
@@ -490,6 +476,8 @@ static void updateList(TrackList& list, float dt)
                 te.angle += (float)(da * (180.0 / M_PI));
             }
 
+            ring.move(te, getCell(te.pos));
+
             if ((AirCull & PhyDrvAirCull) != 0)
             {
                 // no need to cull ground marks
@@ -519,14 +507,9 @@ static void updateList(TrackList& list, float dt)
                 }
                 // cull this node
                 if (te.sides == 0)
-                {
-                    ptr = list.removeNode(ptr);
-                    continue;
-                }
+                    ring.drop(te);
             }
         }
-
-        ptr = ptr->getNext();
     }
 
     return;
@@ -544,10 +527,13 @@ void TrackMarks::update(float dt)
         return;
     }
 
-    updateList(SmokeList, dt);
-    updateList(PuddleList, dt);
-    updateList(TreadsGroundList, dt);
-    updateList(TreadsObstacleList, dt);
+    TrackClock += dt;
+    updateGrid();
+
+    updateRing(SmokeRing, dt);
+    updateRing(PuddleRing, dt);
+    updateRing(TreadsGroundRing, dt);
+    updateRing(TreadsObstacleRing, dt);
 
     return;
 }
@@ -605,8 +591,6 @@ void TrackMarks::notifyStyleChange()
 
 void TrackMarks::renderGroundTracks()
 {
-    TrackEntry* ptr;
-
     // disable the zbuffer for drawing on the ground
     if (BZDBCache::zbuffer)
     {
@@ -616,13 +600,11 @@ void TrackMarks::renderGroundTracks()
 
     // draw ground treads
     treadsGState.setState();
-    for (ptr = TreadsGroundList.getStart(); ptr != NULL; ptr = ptr->getNext())
-        drawTreads(*ptr);
+    renderRing(TreadsGroundRing, TreadsTrack);
 
     // draw puddles
     puddleGState.setState();
-    for (ptr = PuddleList.getStart(); ptr != NULL; ptr = ptr->getNext())
-        drawPuddle(*ptr);
+    renderRing(PuddleRing, PuddleTrack);
 
     // re-enable the zbuffer
     if (BZDBCache::zbuffer)
@@ -642,8 +624,6 @@ void TrackMarks::renderObstacleTracks()
         return; // this is not for the BSP rendering
     }
 
-    TrackEntry* ptr;
-
     // disable the zbuffer writing (these are the last things drawn)
     // this helps to avoid the zbuffer fighting/flickering effect
     glDepthMask(GL_FALSE);
@@ -655,8 +635,7 @@ void TrackMarks::renderObstacleTracks()
     glPolygonOffset(-1.0f, -1.0f);
 #endif // FANCY_TREADMARKS
     treadsGState.setState();
-    for (ptr = TreadsObstacleList.getStart(); ptr != NULL; ptr = ptr->getNext())
-        drawTreads(*ptr);
+    renderRing(TreadsObstacleRing, TreadsTrack);
 #ifdef FANCY_TREADMARKS
     glDepthFunc(GL_LESS);
     glDisable(GL_POLYGON_OFFSET_FILL);
@@ -664,8 +643,7 @@ void TrackMarks::renderObstacleTracks()
 
     // draw smoke
     smokeGState.setState();
-    for (ptr = SmokeList.getStart(); ptr != NULL; ptr = ptr->getNext())
-        drawTreads(*ptr);
+    renderRing(SmokeRing, SmokeTrack);
 
     // re-enable the zbuffer writing
     glDepthMask(GL_TRUE);
@@ -674,9 +652,136 @@ void TrackMarks::renderObstacleTracks()
 }
 
 
+static void renderRing(TrackRing& ring, TrackType type)
+{
+    if (ring.getCount() == 0)
+        return;
+
+    // build the quads of the visible cells into one array
+    const ViewFrustum& frustum = RENDERER.getViewFrustum();
+    markVertices.clear();
+    const int cellCount = ring.getCellCount();
+    for (int cell = 0; cell < cellCount; cell++)
+    {
+        float mins[3], maxs[3];
+        if (!ring.getCellBounds(cell, mins, maxs))
+            continue;
+        // widened by the largest mark, a puddle at the end of its life
+        Extents exts(mins, maxs);
+        exts.addMargin(TreadMiddle * 2.0f + 2.0f);
+        if (testAxisBoxInFrustum(exts, &frustum) == Outside)
+            continue;
+
+        for (int slot = ring.getCellHead(cell); slot >= 0;)
+        {
+            const TrackEntry& te = ring.getSlot(slot);
+            const float ratio = (float)(TrackClock - te.birthTime) / TrackFadeTime;
+            if (type == PuddleTrack)
+                addPuddleQuads(te, ratio);
+            else
+                addTreadsQuads(te, ratio);
+            slot = te.cellNext;
+        }
+    }
+
+    if (markVertices.empty())
+        return;
+
+    // and draw them in one go, the colors carry the fading
+    const GLsizei stride = FloatsPerVertex * sizeof(float);
+    const float* v = &markVertices[0];
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glVertexPointer(3, GL_FLOAT, stride, v);
+    glTexCoordPointer(2, GL_FLOAT, stride, v + 3);
+    glColorPointer(4, GL_FLOAT, stride, v + 5);
+
+    glDrawArrays(GL_QUADS, 0, (GLsizei)(markVertices.size() / FloatsPerVertex));
+
+    glDisableClientState(GL_COLOR_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    return;
+}
+
+
+// append a quad in the mark's space: rotated by its angle about its
+// position, then offset along y, then scaled.  corners go
+// counter-clockwise from (x0, y0), like glRectf()
+static void addQuad(const TrackEntry& te, float offset,
+                    float scaleX, float scaleY,
+                    float x0, float y0, float x1, float y1,
+                    float s0, float t0, float s1, float t1,
+                    float gray, float alpha)
+{
+    const float radians = (float)(te.angle * (M_PI / 180.0));
+    const float c = cosf(radians);
+    const float s = sinf(radians);
+    const float xs[4] = { x0, x1, x1, x0 };
+    const float ys[4] = { y0, y0, y1, y1 };
+    const float ss[4] = { s0, s1, s1, s0 };
+    const float ts[4] = { t0, t0, t1, t1 };
+
+    const size_t base = markVertices.size();
+    markVertices.resize(base + (4 * FloatsPerVertex));
+    float* out = &markVertices[base];
+    for (int i = 0; i < 4; i++)
+    {
+        const float x = xs[i] * scaleX;
+        const float y = (ys[i] * scaleY) + offset;
+        out[0] = te.pos[0] + (c * x) - (s * y);
+        out[1] = te.pos[1] + (s * x) + (c * y);
+        out[2] = te.pos[2];
+        out[3] = ss[i];
+        out[4] = ts[i];
+        out[5] = out[6] = out[7] = gray;
+        out[8] = alpha;
+        out += FloatsPerVertex;
+    }
+    return;
+}
+
+
+static void addPuddleQuads(const TrackEntry& te, float ratio)
+{
+    const float scale = 2.0f * ratio;
+    const float offset = te.scale * TreadMiddle;
+
+    addQuad(te, +offset, scale, scale, -1.0f, -1.0f, +1.0f, +1.0f,
+            0.0f, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f - ratio);
+
+    // Narrow tanks only need 1 puddle
+    if (offset > 0.01f)
+    {
+        addQuad(te, -offset, scale, scale, -1.0f, -1.0f, +1.0f, +1.0f,
+                0.0f, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f - ratio);
+    }
+    return;
+}
+
+
+static void addTreadsQuads(const TrackEntry& te, float ratio)
+{
+    const float halfWidth = 0.5f * TreadMarkWidth;
+
+    if ((te.sides & LeftTread) != 0)
+    {
+        addQuad(te, 0.0f, 1.0f, te.scale,
+                -halfWidth, +TreadInside, +halfWidth, +TreadOutside,
+                0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f - ratio);
+    }
+    if ((te.sides & RightTread) != 0)
+    {
+        addQuad(te, 0.0f, 1.0f, te.scale,
+                -halfWidth, -TreadOutside, +halfWidth, -TreadInside,
+                0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f - ratio);
+    }
+    return;
+}
+
+
 static void drawPuddle(const TrackEntry& te)
 {
-    const float ratio = (te.lifeTime / TrackFadeTime);
+    const float ratio = (float)(TrackClock - te.birthTime) / TrackFadeTime;
     const float scale = 2.0f * ratio;
     const float offset = te.scale * TreadMiddle;
 
@@ -735,7 +840,7 @@ static void drawPuddle(const TrackEntry& te)
 
 static void drawTreads(const TrackEntry& te)
 {
-    const float ratio = (te.lifeTime / TrackFadeTime);
+    const float ratio = (float)(TrackClock - te.birthTime) / TrackFadeTime;
 
     glColor4f(0.0f, 0.0f, 0.0f, 1.0f - ratio);
 
@@ -764,26 +869,21 @@ void TrackMarks::addSceneNodes(SceneDatabase* scene)
     if (BZDBCache::zbuffer)
         return;
 
-    // tread track marks on obstacles
-    TrackEntry* ptr;
-    for (ptr = TreadsObstacleList.getStart(); ptr != NULL; ptr = ptr->getNext())
-    {
-        const TrackEntry& te = *ptr;
-        if (te.sceneNode != NULL)
-        {
-            te.sceneNode->update();
-            scene->addDynamicNode(te.sceneNode);
-        }
-    }
-
-    // smoke track marks in the air
-    for (ptr = SmokeList.getStart(); ptr != NULL; ptr = ptr->getNext())
+    // tread track marks on obstacles, and smoke track marks in the air
+    TrackNodeRing* rings[2] = { &TreadsObstacleRing, &SmokeRing };
+    for (int r = 0; r < 2; r++)
     {
-        const TrackEntry& te = *ptr;
-        if (te.sceneNode != NULL)
+        TrackNodeRing& ring = *rings[r];
+        const int count = ring.getCount();
+        for (int i = 0; i < count; i++)
         {
-            te.sceneNode->update();
-            scene->addDynamicNode(te.sceneNode);
+            const int slot = ring.getSlotOf(i);
+            TrackSceneNode* node = ring.getSceneNode(slot);
+            if ((node != NULL) && (ring.getSlot(slot).cell >= 0))
+            {
+                node->update();
+                scene->addDynamicNode(node);
+            }
         }
     }
 
@@ -793,30 +893,20 @@ void TrackMarks::addSceneNodes(SceneDatabase* scene)
 
 /****************************************************************************/
 //
-// TrackEntry
+// TrackNodeRing
 //
 
-TrackEntry::~TrackEntry()
+TrackNodeRing::TrackNodeRing(int _capacity) :
+    TrackRing(_capacity), sceneNodes(getCapacity(), NULL)
 {
-    delete sceneNode;
     return;
 }
 
 
-//
-// TrackList
-//
-
-void TrackList::clear()
+TrackNodeRing::~TrackNodeRing()
 {
-    TrackEntry* te = start;
-    while (te != NULL)
-    {
-        TrackEntry* next = te->next;
-        delete te;
-        te = next;
-    }
-    start = end = NULL;
+    for (size_t i = 0; i < sceneNodes.size(); i++)
+        delete sceneNodes[i];
     return;
 }
 
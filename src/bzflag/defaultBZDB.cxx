@@ -100,6 +100,7 @@ DefaultDBItem defaultDBItems[] =
     { "showVelocities",       "0",            true,   StateDatabase::ReadWrite,   NULL },
     { "jumpTyping",       "1",            true,   StateDatabase::ReadWrite,   NULL },
     { "maxCacheMB",       "512",           true,   StateDatabase::ReadWrite,   NULL },
+    { "maxTextureCacheMB",    "256",           true,   StateDatabase::ReadWrite,   NULL },
     { "doDownloads",      "1",            true,   StateDatabase::ReadWrite,   NULL },
     { "updateDownloads",      "0",            true,   StateDatabase::ReadWrite,   NULL },
     { "roamSmoothTime",       "0.5",          true,   StateDatabase::ReadWrite,   NULL },
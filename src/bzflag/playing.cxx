@@ -82,6 +82,7 @@
 #include "Roster.h"
 #include "SceneBuilder.h"
 #include "ScoreboardRenderer.h"
+#include "ShotHitGrid.h"
 #include "sound.h"
 #include "ShotStats.h"
 #include "TrackMarks.h"
@@ -3910,6 +3911,75 @@ static bool     gotBlowedUp(BaseLocalPlayer* tank,
     return (reason == GotShot && flag == Flags::Shield && shotId != -1);
 }
 
+// the shots that can hit a local tank, rebuilt before checking for hits
+struct ShotHitSource
+{
+    const Player*   source;
+    const ShotPath* shot;
+};
+static ShotHitGrid      shotHitGrid;
+static std::vector<ShotHitSource>   shotHitSources;
+static std::vector<int> shotHitIds;
+
+static void     addShotHitSources(const Player* source)
+{
+    // if firing tank is paused then it doesn't count
+    if (!source || source->isPaused()) return;
+
+    const int maxShots = source->getMaxShots();
+    for (int i = 0; i < maxShots; i++)
+    {
+        const ShotPath* shot = source->getShot(i);
+        if (!shot || shot->isExpired()) continue;
+
+        const ShotHitSource entry = { source, shot };
+        const int id = shotHitSources.size();
+        shotHitSources.push_back(entry);
+
+        float bbox[2][3];
+        shotHitGrid.add(id, shot->getHitBounds(bbox) ? bbox : NULL);
+    }
+}
+
+static void     updateShotHitGrid()
+{
+    shotHitGrid.clear();
+    shotHitSources.clear();
+
+    // same order as the tanks used to be checked in
+    addShotHitSources(myTank);
+    for (int i = 0; i < curMaxPlayers; i++)
+        addShotHitSources(remotePlayers[i]);
+    addShotHitSources(World::getWorld()->getWorldWeapons());
+}
+
+// NOTE -- minTime should be initialized to Infinity by the caller
+static void     checkShotHits(const LocalPlayer* tank,
+                              const ShotPath*& hit, float& minTime)
+{
+    // only shots that pass near the tank need the exact test.  the
+    // padding covers the tank's sphere and the narrow tank's box.
+    const float (*motion)[3] = tank->getLastMotionBBox();
+    const float pad = tank->getRadius() + BZDB.eval(StateDatabase::BZDB_SHOTRADIUS);
+    float bbox[2][3];
+    for (int a = 0; a < 3; a++)
+    {
+        bbox[0][a] = motion[0][a] - pad;
+        bbox[1][a] = motion[1][a] + pad;
+    }
+    shotHitGrid.query(bbox, shotHitIds);
+
+    const int count = shotHitIds.size();
+    for (int i = 0; i < count; i++)
+    {
+        const ShotHitSource& entry = shotHitSources[shotHitIds[i]];
+        // a robot's own shots also come back as a remote player's
+        if ((entry.source != tank) && (entry.source->getId() == tank->getId()))
+            continue;
+        tank->checkShotHit(entry.source, entry.shot, hit, minTime);
+    }
+}
+
 static void     checkEnvironment()
 {
     if (!myTank) return;
@@ -4021,14 +4091,9 @@ static void     checkEnvironment()
     const ShotPath* hit = NULL;
     float minTime = Infinity;
 
-    myTank->checkHit(myTank, hit, minTime);
+    updateShotHitGrid();
+    checkShotHits(myTank, hit, minTime);
     int i;
-    for (i = 0; i < curMaxPlayers; i++)
-        if (remotePlayers[i])
-            myTank->checkHit(remotePlayers[i], hit, minTime);
-
-    // Check Server Shots
-    myTank->checkHit( World::getWorld()->getWorldWeapons(), hit, minTime);
 
     // used later
     float waterLevel = World::getWorld()->getWaterLevel();
@@ -4675,16 +4740,8 @@ static void     checkEnvironment(RobotPlayer* tank)
     // see if i've been shot
     const ShotPath* hit = NULL;
     float minTime = Infinity;
-    tank->checkHit(myTank, hit, minTime);
+    checkShotHits(tank, hit, minTime);
     int i;
-    for (i = 0; i < curMaxPlayers; i++)
-    {
-        if (remotePlayers[i] && remotePlayers[i]->getId() != tank->getId())
-            tank->checkHit(remotePlayers[i], hit, minTime);
-    }
-
-    // Check Server Shots
-    tank->checkHit( World::getWorld()->getWorldWeapons(), hit, minTime);
 
     float waterLevel = World::getWorld()->getWaterLevel();
 
@@ -4777,6 +4834,8 @@ static void     checkEnvironment(RobotPlayer* tank)
 
 static void     checkEnvironmentForRobots()
 {
+    // checkEnvironment() skips building the grid when my tank is dead
+    updateShotHitGrid();
     for (int i = 0; i < numRobots; i++)
         if (robots[i])
             checkEnvironment(robots[i]);
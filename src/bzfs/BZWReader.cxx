@@ -14,9 +14,7 @@
 #include "BZWReader.h"
 
 // implementation-specific system headers
-#include <fstream>
-#include <sstream>
-#include <ctype.h>
+#include <utility>
 
 // implementation-specific bzflag headers
 #include "BZDBCache.h"
@@ -47,12 +45,20 @@
 
 // common headers
 #include "ObstacleMgr.h"
+#include "DynamicColor.h"
+#include "TextureMatrix.h"
+#include "MagnumBZMaterial.h"
+#include "PhysicsDriver.h"
+#include "MeshTransform.h"
 #include "BaseBuilding.h"
 #include "TextUtils.h"
+#include "StreamParse.h"
 #include "StateDatabase.h"
+#include "TimeKeeper.h"
 
 // bzfs specific headers
 #include "bzfs.h"
+#include "WorldCache.h"
 
 
 BZWReader::BZWReader(std::string filename) : cURLManager(), location(filename),
@@ -70,10 +76,15 @@ BZWReader::BZWReader(std::string filename) : cURLManager(), location(filename),
     {
         setURL(location);
         performWait();
-        input = new std::istringstream(httpData);
+        input = new MemoryStream(std::move(httpData));
     }
     else
-        input = new std::ifstream(filename.c_str(), std::ios::in);
+    {
+        // read the whole file at once, the parser then scans it in place
+        std::string data;
+        StreamParse::readFile(filename, data);
+        input = new MemoryStream(std::move(data));
+    }
 
     // .BZW is the official worldfile extension, warn for others
     if ((filename.length() < 4) ||
@@ -107,27 +118,7 @@ void BZWReader::finalization(char *data, unsigned int length, bool good)
 
 void BZWReader::readToken(char *buffer, int n)
 {
-    int c = -1;
-
-    // skip whitespace
-    while (input->good() && (c = input->get()) != -1 && isspace(c) && c != '\n')
-        ;
-
-    // read up to whitespace or n - 1 characters into buffer
-    int i = 0;
-    if (c != -1 && c != '\n')
-    {
-        buffer[i++] = c;
-        while (input->good() && i < n - 1 && (c = input->get()) != -1 && !isspace(c))
-            buffer[i++] = (char)c;
-    }
-
-    // terminate string
-    buffer[i] = 0;
-
-    // put back last character we didn't use
-    if (c != -1 && isspace(c))
-        input->putback(c);
+    StreamParse::readToken(*input, buffer, n);
 }
 
 
@@ -449,9 +440,7 @@ bool BZWReader::readWorldStream(std::vector<WorldFileObject*>& wlist,
         }
 
         // discard remainder of line
-        while (input->good() && input->peek() != '\n')
-            input->get(buffer, sizeof(buffer));
-        input->getline(buffer, sizeof(buffer));
+        StreamParse::skipLine(*input);
         ++line;
     }
 
@@ -485,6 +474,7 @@ WorldInfo* BZWReader::defineWorldFromFile()
     }
 
     // read file
+    TimeKeeper startTime = TimeKeeper::getCurrent();
     std::vector<WorldFileObject*> list;
     GroupDefinition* worldDef = const_cast<GroupDefinition*>(OBSTACLEMGR.getWorld());
     if (!readWorldStream(list, worldDef))
@@ -494,12 +484,73 @@ WorldInfo* BZWReader::defineWorldFromFile()
         delete myWorld;
         return NULL;
     }
+    TimeKeeper endTime = TimeKeeper::getCurrent();
+    logDebugMessage(3,"World parsing: %.3f seconds\n", endTime - startTime);
 
+    // a cached database already has them
     if (!BZDB.isTrue("noWalls"))
         makeWalls();
 
+    return assembleWorld(myWorld, list);
+}
+
+
+// leave the managers empty for a text parse after a failed cache load
+static void clearWorldManagers()
+{
+    OBSTACLEMGR.clear();
+    TRANSFORMMGR.clear();
+    PHYDRVMGR.clear();
+    MAGNUMMATERIALMGR.clear(false);
+    TEXMATRIXMGR.clear();
+    DYNCOLORMGR.clear();
+}
+
+
+WorldInfo* BZWReader::defineWorldFromCache(const WorldCache& cache)
+{
+    WorldInfo *myWorld = new WorldInfo;
+    if (!myWorld->unpackDatabase(cache.getDatabase(), cache.getDatabaseSize()))
+    {
+        errorHandler->warning(std::string("world cache failed to unpack"), 0);
+        delete myWorld;
+        clearWorldManagers();
+        return NULL;
+    }
+
+    // the world, zone and weapon sections are not in the client database
+    TimeKeeper startTime = TimeKeeper::getCurrent();
+    std::vector<WorldFileObject*> list;
+    const std::string& sections = cache.getServerSections();
+    if (!sections.empty())
+    {
+        delete input;
+        input = new MemoryStream(sections);
+        GroupDefinition* worldDef = const_cast<GroupDefinition*>(OBSTACLEMGR.getWorld());
+        if (!readWorldStream(list, worldDef))
+        {
+            emptyWorldFileObjectList(list);
+            errorHandler->warning(std::string("world cache sections failed to load"), 0);
+            delete myWorld;
+            clearWorldManagers();
+            return NULL;
+        }
+    }
+    TimeKeeper endTime = TimeKeeper::getCurrent();
+    logDebugMessage(3,"World server sections: %.3f seconds\n", endTime - startTime);
+
+    return assembleWorld(myWorld, list);
+}
+
+
+WorldInfo* BZWReader::assembleWorld(WorldInfo* myWorld,
+                                    std::vector<WorldFileObject*>& list)
+{
     // generate group instances
+    TimeKeeper startTime = TimeKeeper::getCurrent();
     OBSTACLEMGR.makeWorld();
+    TimeKeeper endTime = TimeKeeper::getCurrent();
+    logDebugMessage(3,"Group instancing: %.3f seconds\n", endTime - startTime);
 
     // make local bases
     unsigned int i;
@@ -521,12 +572,15 @@ WorldInfo* BZWReader::defineWorldFromFile()
 
     // clean up
     emptyWorldFileObjectList(list);
+
+    startTime = TimeKeeper::getCurrent();
     myWorld->finishWorld();
+    endTime = TimeKeeper::getCurrent();
+    logDebugMessage(3,"Collision octree: %.3f seconds\n", endTime - startTime);
 
     return myWorld;
 }
 
-
 // Local Variables: ***
 // mode: C++ ***
 // tab-width: 4 ***
@@ -29,6 +29,7 @@
 
 class WorldFileObject;
 class WorldInfo;
+class WorldCache;
 
 class BZWReader : cURLManager
 {
@@ -38,6 +39,8 @@ public:
 
     // external interface
     WorldInfo *defineWorldFromFile();
+    // obstacles from a precompiled world, only the server sections are parsed
+    WorldInfo *defineWorldFromCache(const WorldCache& cache);
 
 private:
     // functions for internal use
@@ -45,6 +48,8 @@ private:
     bool readWorldStream(std::vector<WorldFileObject*>& wlist,
                          class GroupDefinition* groupDef);
     void finalization(char *data, unsigned int length, bool good);
+    WorldInfo *assembleWorld(WorldInfo *myWorld,
+                             std::vector<WorldFileObject*>& list);
 
     // stream to open
     std::string location;
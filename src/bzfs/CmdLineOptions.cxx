@@ -87,8 +87,14 @@ const char *usageString =
     "[-lagdrop <num>] "
     "[-lagwarn <time/ms>] "
     "[-loadplugin <pluginname,commandline>] "
+    "[-logasync] "
+    "[-logfile <filename>] "
+    "[-logformat {text|json|binary}] "
+    "[-logoverflow {block|drop|direct}] "
+    "[-logrotate <Kbytes>[,<count>]] "
     "[-masterBanURL <URL>] "
     "[-maxidle <time/s>] "
+    "[-metrics] "
     "[-mp {<count>|[<count>][,<count>][,<count>][,<count>][,<count>][,<count>]}] "
     "[-mps <score>] "
     "[-ms <shots>] "
@@ -150,6 +156,7 @@ const char *usageString =
     "[-vars <filename>] "
     "[-version] "
     "[-world <filename>] "
+    "[-worldcache <filename>] "
     "[-worldsize <world size>] "
     "[-ws <number of wall sides>] ";
 
@@ -194,9 +201,20 @@ const char *extraUsageString =
     "\t-lagdrop: drop player after this many lag warnings\n"
     "\t-lagwarn: lag warning threshhold time [ms]\n"
     "\t-loadplugin: load the specified plugin with the specified commandline\n"
+    "\t-logasync: write console output from a background thread, implied by\n"
+    "\t\tthe other -log options\n"
+    "\t-logfile: write console output to <filename> instead\n"
+    "\t-logformat: write plain text (default), one JSON object or one binary\n"
+    "\t\trecord per message\n"
+    "\t-logoverflow: when output falls behind, wait for it (default), drop\n"
+    "\t\tmessages, or write them directly\n"
+    "\t-logrotate: start a new log file every <Kbytes>, keeping <count> old\n"
+    "\t\tones (default=5)\n"
     "\t\tstring\n"
     "\t-masterBanURL: URL to atempt to get the master ban list from <URL>\n"
     "\t-maxidle: idle kick threshhold [s]\n"
+    "\t-metrics: serve server loop timings for Prometheus at /metrics/ on\n"
+    "\t\tthe game port (needs plugin support)\n"
     "\t-mp: maximum players total or per team\n"
     "\t-mps: set player score limit on each game\n"
     "\t-ms: maximum simultaneous shots per player\n"
@@ -263,6 +281,7 @@ const char *extraUsageString =
     "\t-vars: file to read for worlds configuration variables\n"
     "\t-version: print version and exit\n"
     "\t-world: world file to load\n"
+    "\t-worldcache: precompiled copy of the world file, rebuilt when it changes\n"
     "\t-worldsize: numeric value for the size of the world (default=400)\n"
     "\t-ws: numeric value for the number off outer walls (default=4)\n"
     "\n"
@@ -869,11 +888,74 @@ void parse(int argc, char **argv, CmdLineOptions &options, bool fromWorldFile)
             if (pDef.plugin.size())
                 options.pluginList.push_back(pDef);
         }
+        else if (strcmp(argv[i], "-logasync") == 0)
+        {
+            checkFromWorldFile(argv[i], fromWorldFile);
+            options.asyncLog = true;
+        }
+        else if (strcmp(argv[i], "-logfile") == 0)
+        {
+            checkFromWorldFile(argv[i], fromWorldFile);
+            checkArgc(1, i, argc, argv[i]);
+            options.asyncLog = true;
+            options.logSettings.filename = argv[i];
+        }
+        else if (strcmp(argv[i], "-logformat") == 0)
+        {
+            checkFromWorldFile(argv[i], fromWorldFile);
+            checkArgc(1, i, argc, argv[i]);
+            options.asyncLog = true;
+            if (strcasecmp(argv[i], "text") == 0)
+                options.logSettings.format = LogSettings::TextFormat;
+            else if (strcasecmp(argv[i], "json") == 0)
+                options.logSettings.format = LogSettings::JSONFormat;
+            else if (strcasecmp(argv[i], "binary") == 0)
+                options.logSettings.format = LogSettings::BinaryFormat;
+            else
+            {
+                std::cerr << "unknown log format " << argv[i] << '\n';
+                usage("bzfs");
+            }
+        }
+        else if (strcmp(argv[i], "-logoverflow") == 0)
+        {
+            checkFromWorldFile(argv[i], fromWorldFile);
+            checkArgc(1, i, argc, argv[i]);
+            options.asyncLog = true;
+            if (strcasecmp(argv[i], "block") == 0)
+                options.logSettings.overflow = LogSettings::BlockOnFull;
+            else if (strcasecmp(argv[i], "drop") == 0)
+                options.logSettings.overflow = LogSettings::DropOnFull;
+            else if (strcasecmp(argv[i], "direct") == 0)
+                options.logSettings.overflow = LogSettings::DirectOnFull;
+            else
+            {
+                std::cerr << "unknown log overflow mode " << argv[i] << '\n';
+                usage("bzfs");
+            }
+        }
+        else if (strcmp(argv[i], "-logrotate") == 0)
+        {
+            checkFromWorldFile(argv[i], fromWorldFile);
+            checkArgc(1, i, argc, argv[i]);
+            options.asyncLog = true;
+            std::vector<std::string> a = TextUtils::tokenize(argv[i],std::string(","), 2);
+            options.logSettings.rotateSize = atol(a[0].c_str()) * 1024;
+            if (a.size() >= 2)
+                options.logSettings.rotateCount = atoi(a[1].c_str());
+            if (options.logSettings.rotateSize < 0)
+                options.logSettings.rotateSize = 0;
+        }
         else if (strcmp(argv[i], "-maxidle") == 0)
         {
             checkArgc(1, i, argc, argv[i]);
             options.idlekickthresh = (float) atoi(argv[i]);
         }
+        else if (strcmp(argv[i], "-metrics") == 0)
+        {
+            checkFromWorldFile(argv[i], fromWorldFile);
+            options.metrics = true;
+        }
         else if (strcmp(argv[i], "-mp") == 0)
         {
             // set maximum number of players
@@ -1477,6 +1559,12 @@ void parse(int argc, char **argv, CmdLineOptions &options, bool fromWorldFile)
             if (options.useTeleporters)
                 std::cerr << "-t is meaningless when using a custom world, ignoring" << std::endl;
         }
+        else if (strcmp(argv[i], "-worldcache") == 0)
+        {
+            checkFromWorldFile(argv[i], fromWorldFile);
+            checkArgc(1, i, argc, argv[i]);
+            options.worldCache = argv[i];
+        }
         else if (strcmp(argv[i], "-worldsize") == 0)
         {
             checkArgc(1, i, argc, argv[i]);
@@ -29,6 +29,7 @@
 
 /* bzfs-specific headers */
 #include "AccessControlList.h"
+#include "bzfio.h"
 
 // avoid dependencies
 class EntryZones;
@@ -78,11 +79,12 @@ struct CmdLineOptions
           oneGameOnly(false), timeManualStart(false), randomHeights(false),
           useTeleporters(false), teamKillerDies(true), printScore(false),
           publicizeServer(false), replayServer(false), startRecording(false),
-          timestampLog(false), timestampMicros(false), timestampUTC(false), countdownPaused(false),
+          timestampLog(false), timestampMicros(false), timestampUTC(false), countdownPaused(false), asyncLog(false),
+          metrics(false),
           filterFilename(""), filterCallsigns(false), filterChat(false), filterSimple(false),
           banTime(300), voteTime(60), vetoTime(2), votesRequired(2),
           votePercentage(50.1f), voteRepeatTime(300),
-          autoTeam(false), citySize(5), cacheURL(""), cacheOut(""), tkAnnounce(false), wallSides(4)
+          autoTeam(false), citySize(5), cacheURL(""), cacheOut(""), worldCache(""), tkAnnounce(false), wallSides(4)
     {
         int i;
         for (FlagTypeMap::iterator it = FlagType::getFlagMap().begin();
@@ -174,6 +176,13 @@ struct CmdLineOptions
     bool          timestampUTC;
     bool          countdownPaused;
 
+    // background log writer
+    bool          asyncLog;
+    LogSettings       logSettings;
+
+    // serve ServerStats over HTTP
+    bool          metrics;
+
     uint16_t      maxTeam[NumTeams];
     FlagNumberMap     flagCount;
     FlagNumberMap     flagLimit; // # shots allowed / flag
@@ -211,6 +220,7 @@ struct CmdLineOptions
 
     std::string       cacheURL;
     std::string       cacheOut;
+    std::string       worldCache;
 
     bool          tkAnnounce;
     int           wallSides;
@@ -20,9 +20,9 @@
 
 /* common implementation headers */
 #include "PhysicsDriver.h"
+#include "StreamParse.h"
 
 /* system headers */
-#include <sstream>
 #include <iostream>
 
 
@@ -41,30 +41,13 @@ CustomMeshFace::CustomMeshFace(const MagnumBZMaterial& _material, int physics,
 }
 
 
-static void getIntList (std::istream& input, std::vector<int>& list)
-{
-    std::string args;
-    int value;
-
-    list.clear();
-    std::getline(input, args);
-    std::istringstream parms(args);
-    input.putback('\n');
-
-    while (parms >> value)
-        list.push_back(value);
-
-    return;
-}
-
-
 bool CustomMeshFace::read(const char *cmd, std::istream& input)
 {
     bool materror;
 
     if (strcasecmp(cmd, "vertices") == 0)
     {
-        getIntList (input, vertices);
+        StreamParse::readIntList(input, vertices);
         if (vertices.size() < 3)
         {
             std::cout << "mesh faces need at least 3 vertices" << std::endl;
@@ -73,7 +56,7 @@ bool CustomMeshFace::read(const char *cmd, std::istream& input)
     }
     else if (strcasecmp(cmd, "normals") == 0)
     {
-        getIntList (input, normals);
+        StreamParse::readIntList(input, normals);
         if (normals.size() < 3)
         {
             std::cout << "mesh faces need at least 3 normals" << std::endl;
@@ -82,7 +65,7 @@ bool CustomMeshFace::read(const char *cmd, std::istream& input)
     }
     else if (strcasecmp(cmd, "texcoords") == 0)
     {
-        getIntList (input, texcoords);
+        StreamParse::readIntList(input, texcoords);
         if (texcoords.size() < 3)
         {
             std::cout << "mesh faces need at least 3 texcoords" << std::endl;
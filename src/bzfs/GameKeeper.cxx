@@ -21,6 +21,7 @@
 #include "GameTime.h"
 
 GameKeeper::Player* GameKeeper::Player::playerList[PlayerSlot] = {0}; // this is suspect...
+PositionGrid GameKeeper::Player::positionGrid;
 bool GameKeeper::Player::allNeedHostbanChecked = false;
 
 void* PackPlayerInfo(void *buf, int playerIndex, uint8_t properties )
@@ -49,6 +50,7 @@ GameKeeper::Player::Player(int _playerIndex,
     lastState.order  = 0;
     score.playerID = _playerIndex;
     lastHeldFlagID = -1;
+    deltaUpdates = false;
 }
 
 GameKeeper::Player::Player(int _playerIndex,
@@ -72,6 +74,7 @@ GameKeeper::Player::Player(int _playerIndex,
 
     netHandler->setPlayer(&player, _playerIndex);
     lastHeldFlagID = -1;
+    deltaUpdates = false;
 }
 
 GameKeeper::Player::Player(int _playerIndex, bz_ServerSidePlayerHandler* handler)
@@ -91,6 +94,7 @@ GameKeeper::Player::Player(int _playerIndex, bz_ServerSidePlayerHandler* handler
     lastState.order  = 0;
     score.playerID = _playerIndex;
     lastHeldFlagID = -1;
+    deltaUpdates = false;
 }
 
 GameKeeper::Player::~Player()
@@ -98,6 +102,7 @@ GameKeeper::Player::~Player()
     flagHistory.clear();
     delete netHandler;
     playerList[playerIndex] = 0;
+    positionGrid.remove(playerIndex);
 }
 
 int GameKeeper::Player::count()
@@ -386,6 +391,7 @@ void GameKeeper::Player::setPlayerState(float pos[3], float azimuth)
     memset(lastState.velocity, 0, sizeof(float) * 3);
     lastState.angVel = 0.0f;
     stateTimeStamp   = 0.0f;
+    positionGrid.set(playerIndex, pos[0], pos[1]);
 
     // player is alive.
     player.setAlive();
@@ -498,6 +504,41 @@ bool GameKeeper::Player::updateShot(int id, int salt)
     return true;
 }
 
+void GameKeeper::Player::enableDeltaUpdates()
+{
+    if (deltaUpdates)
+        return;
+    deltaUpdates = true;
+    logDebugMessage(3,"Player %s [%d] receives delta updates\n",
+                    player.getCallSign(), playerIndex);
+}
+
+bool GameKeeper::Player::wantsDeltaUpdates() const
+{
+    return deltaUpdates;
+}
+
+void GameKeeper::Player::ackDeltaUpdate(int sender, uint8_t sequence)
+{
+    if ((sender < 0) || (sender >= (int)deltaEncoders.size()))
+        return;
+    deltaEncoders[sender].acknowledge(sequence);
+}
+
+void* GameKeeper::Player::packDeltaUpdate(void* buf, int sender,
+        const PlayerState& state)
+{
+    if (sender >= (int)deltaEncoders.size())
+        deltaEncoders.resize(sender + 1);
+    return deltaEncoders[sender].pack(buf, state);
+}
+
+void GameKeeper::Player::resetDeltaUpdates(int sender)
+{
+    if ((sender >= 0) && (sender < (int)deltaEncoders.size()))
+        deltaEncoders[sender].reset();
+}
+
 void GameKeeper::Player::setPlayerState(PlayerState state, float timestamp)
 {
     lagInfo.updateLag(timestamp, state.order - lastState.order > 1);
@@ -505,6 +546,7 @@ void GameKeeper::Player::setPlayerState(PlayerState state, float timestamp)
     lastState      = state;
     stateTimeStamp = timestamp;
     serverTimeStamp = (float)TimeKeeper::getCurrent().getSeconds();
+    positionGrid.set(playerIndex, state.pos[0], state.pos[1]);
 }
 
 void GameKeeper::Player::getPlayerState(float pos[3], float &azimuth)
@@ -23,6 +23,7 @@
 // common interface headers
 #include "PlayerInfo.h"
 #include "PlayerState.h"
+#include "PlayerStateDelta.h"
 #include "TimeKeeper.h"
 
 // implementation-specific bzfs-specific headers
@@ -38,6 +39,7 @@
 #include "bzfsAPI.h"
 #include "FlagInfo.h"
 #include "ShotUpdate.h"
+#include "PositionGrid.h"
 
 class ShotInfo
 {
@@ -84,6 +86,8 @@ public:
                                         int targetPlayer = -1);
         static int     getPlayerIDByName(const std::string &name);
         static void    reloadAccessDatabase();
+        // players by their last known position
+        static const PositionGrid& getPositionGrid();
 
         bool       loadEnterData(uint16_t& rejectCode,
                                  char* rejectMsg);
@@ -125,6 +129,13 @@ public:
         bool       removeShot(int id, int salt);
         bool       updateShot(int id, int salt);
 
+        // To handle delta encoded updates from other players
+        void       enableDeltaUpdates();
+        bool       wantsDeltaUpdates() const;
+        void       ackDeltaUpdate(int sender, uint8_t sequence);
+        void*      packDeltaUpdate(void* buf, int sender,
+                                   const PlayerState& state);
+        void       resetDeltaUpdates(int sender);
 
         enum LSAState
         {
@@ -179,6 +190,7 @@ public:
 
     private:
         static Player*    playerList[PlayerSlot];
+        static PositionGrid   positionGrid;
         int           playerIndex;
         bool          closed;
         tcpCallback       clientCallback;
@@ -192,6 +204,9 @@ public:
 
         int        idFlag;
 
+        bool       deltaUpdates;
+        std::vector<PlayerDeltaEncoder> deltaEncoders; // by sender
+
     };
 
     class Flag
@@ -216,6 +231,11 @@ inline GameKeeper::Player* GameKeeper::Player::getPlayerByIndex(int
     return playerList[_playerIndex];
 }
 
+inline const PositionGrid& GameKeeper::Player::getPositionGrid()
+{
+    return positionGrid;
+}
+
 void* PackPlayerInfo(void* buf, int playerIndex, uint8_t properties );
 
 // For hostban checking, to avoid check and check again
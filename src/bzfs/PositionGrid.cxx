@@ -0,0 +1,172 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/* interface header */
+#include "PositionGrid.h"
+
+/* system headers */
+#include <math.h>
+
+
+// power of two, the hash wraps the whole plane into this many buckets
+static const int bucketCount = 256;
+
+// past this many cells a query just looks at every id
+static const int maxQueryCells = 256;
+
+// keeps broken positions out of the int math
+static const float maxCoordinate = 1.0e6f;
+
+
+PositionGrid::PositionGrid(float _cellSize) :
+    cellSize(_cellSize > 1.0f ? _cellSize : 1.0f)
+{
+    buckets.assign(bucketCount, -1);
+}
+
+
+void PositionGrid::clear()
+{
+    for (size_t i = 0; i < entries.size(); i++)
+        entries[i].active = false;
+    buckets.assign(bucketCount, -1);
+}
+
+
+int PositionGrid::bucket(int col, int row) const
+{
+    const unsigned int hash = ((unsigned int)col * 73856093u) ^
+                              ((unsigned int)row * 19349663u);
+    return (int)(hash & (bucketCount - 1));
+}
+
+
+void PositionGrid::unlink(int id)
+{
+    Entry& entry = entries[id];
+    if (entry.prev >= 0)
+        entries[entry.prev].next = entry.next;
+    else
+        buckets[entry.bucket] = entry.next;
+    if (entry.next >= 0)
+        entries[entry.next].prev = entry.prev;
+    entry.active = false;
+}
+
+
+void PositionGrid::set(int id, float x, float y)
+{
+    if (id < 0)
+        return;
+    if (id >= (int)entries.size())
+    {
+        Entry unused;
+        unused.active = false;
+        unused.col = unused.row = 0;
+        unused.bucket = 0;
+        unused.prev = unused.next = -1;
+        entries.resize(id + 1, unused);
+    }
+
+    if (!(fabsf(x) < maxCoordinate) || !(fabsf(y) < maxCoordinate))
+    {
+        remove(id);
+        return;
+    }
+    const int col = (int)floorf(x / cellSize);
+    const int row = (int)floorf(y / cellSize);
+
+    Entry& entry = entries[id];
+    if (entry.active)
+    {
+        // most updates stay in the same cell
+        if ((entry.col == col) && (entry.row == row))
+            return;
+        unlink(id);
+    }
+
+    entry.active = true;
+    entry.col = col;
+    entry.row = row;
+    entry.bucket = bucket(col, row);
+    entry.prev = -1;
+    entry.next = buckets[entry.bucket];
+    if (entry.next >= 0)
+        entries[entry.next].prev = id;
+    buckets[entry.bucket] = id;
+}
+
+
+void PositionGrid::remove(int id)
+{
+    if ((id < 0) || (id >= (int)entries.size()) || !entries[id].active)
+        return;
+    unlink(id);
+}
+
+
+bool PositionGrid::isExhaustive(const float mins[2], const float maxs[2]) const
+{
+    const float span = cellSize * maxQueryCells;
+    if (!((maxs[0] - mins[0]) < span) || !((maxs[1] - mins[1]) < span) ||
+            !(fabsf(mins[0]) < maxCoordinate) || !(fabsf(mins[1]) < maxCoordinate))
+        return true;
+
+    const int cols = (int)floorf(maxs[0] / cellSize) - (int)floorf(mins[0] / cellSize) + 1;
+    const int rows = (int)floorf(maxs[1] / cellSize) - (int)floorf(mins[1] / cellSize) + 1;
+    return cols * rows > maxQueryCells;
+}
+
+
+void PositionGrid::query(const float mins[2], const float maxs[2],
+                         std::vector<int>& ids) const
+{
+    ids.clear();
+    if (!(mins[0] <= maxs[0]) || !(mins[1] <= maxs[1]))
+        return;
+
+    if (isExhaustive(mins, maxs))
+    {
+        for (size_t i = 0; i < entries.size(); i++)
+        {
+            if (entries[i].active)
+                ids.push_back((int)i);
+        }
+        return;
+    }
+
+    const int col0 = (int)floorf(mins[0] / cellSize);
+    const int col1 = (int)floorf(maxs[0] / cellSize);
+    const int row0 = (int)floorf(mins[1] / cellSize);
+    const int row1 = (int)floorf(maxs[1] / cellSize);
+    for (int row = row0; row <= row1; row++)
+    {
+        for (int col = col0; col <= col1; col++)
+        {
+            // other cells share the bucket, only take this one's ids
+            for (int id = buckets[bucket(col, row)]; id >= 0; id = entries[id].next)
+            {
+                if ((entries[id].col == col) && (entries[id].row == row))
+                    ids.push_back(id);
+            }
+        }
+    }
+}
+
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
@@ -0,0 +1,80 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef __POSITIONGRID_H__
+#define __POSITIONGRID_H__
+
+// bzflag global header
+#include "global.h"
+
+// system headers
+#include <vector>
+
+/** PositionGrid hashes small integer ids (player or flag indices) by
+    their x,y position so the ids near a point can be found without
+    walking all of them.  Moving an id is O(1), nothing is allocated
+    once the grid has grown to its capacity.
+*/
+class PositionGrid
+{
+public:
+    PositionGrid(float cellSize = 32.0f);
+
+    void    clear();
+
+    // insert or move an id, ids grow the grid as needed
+    void    set(int id, float x, float y);
+    void    remove(int id);
+
+    // ids whose cell touches the box { mins, maxs }, in no particular
+    // order.  this is coarse, callers test the exact positions.
+    void    query(const float mins[2], const float maxs[2],
+                  std::vector<int>& ids) const;
+    // true when query() would hand back every id for this box
+    bool    isExhaustive(const float mins[2], const float maxs[2]) const;
+
+    float   getCellSize() const;
+
+private:
+    struct Entry
+    {
+        bool    active;
+        int     col, row;
+        int     bucket;
+        int     prev, next;
+    };
+
+    int     bucket(int col, int row) const;
+    void    unlink(int id);
+
+private:
+    float   cellSize;
+    std::vector<Entry>  entries;    // indexed by id
+    std::vector<int>    buckets;    // first id in the bucket, -1 when empty
+};
+
+
+inline float PositionGrid::getCellSize() const
+{
+    return cellSize;
+}
+
+
+#endif /* __POSITIONGRID_H__ */
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
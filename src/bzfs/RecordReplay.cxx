@@ -2621,6 +2621,8 @@ static const char *msgString(u16 code)
         STRING_CASE (MsgPlayerInfo);
         STRING_CASE (MsgPlayerUpdate);
         STRING_CASE (MsgPlayerUpdateSmall);
+        STRING_CASE (MsgPlayerUpdateDelta);
+        STRING_CASE (MsgPlayerUpdateAck);
         STRING_CASE (MsgQueryGame);
         STRING_CASE (MsgQueryPlayers);
         STRING_CASE (MsgReject);
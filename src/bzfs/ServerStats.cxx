@@ -0,0 +1,434 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/* interface header */
+#include "ServerStats.h"
+
+/* system headers */
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+/* common implementation headers */
+#include "MsgStrings.h"
+#include "NetHandler.h"
+#include "TextUtils.h"
+
+/* local implementation headers */
+#include "bzfs.h"
+#include "GameKeeper.h"
+
+#ifdef BZ_PLUGINS
+#include "bzfsAPI.h"
+#include "bzfsHTTPAPI.h"
+#endif
+
+
+ServerStats serverStats;
+
+// where the report stops listing message codes
+static const size_t reportMessages = 8;
+
+
+LatencyHistogram::LatencyHistogram()
+{
+    clear();
+}
+
+
+void LatencyHistogram::clear()
+{
+    count = 0;
+    sumNs = 0;
+    maxNs = 0;
+    for (int i = 0; i < Buckets; i++)
+        buckets[i] = 0;
+}
+
+
+void LatencyHistogram::add(uint64_t nanoseconds)
+{
+    int i = 0;
+    while (i < Buckets - 1 && nanoseconds > (uint64_t(1000) << i))
+        i++;
+    buckets[i]++;
+    count++;
+    sumNs += nanoseconds;
+    if (nanoseconds > maxNs)
+        maxNs = nanoseconds;
+}
+
+
+uint64_t LatencyHistogram::getCount() const
+{
+    return count;
+}
+
+
+double LatencyHistogram::getSum() const
+{
+    return sumNs * 1.0e-9;
+}
+
+
+double LatencyHistogram::getMax() const
+{
+    return maxNs * 1.0e-9;
+}
+
+
+double LatencyHistogram::getMean() const
+{
+    if (count == 0)
+        return 0.0;
+    return getSum() / count;
+}
+
+
+double LatencyHistogram::getPercentile(double fraction) const
+{
+    if (count == 0)
+        return 0.0;
+    uint64_t target = (uint64_t)(fraction * count + 0.999999);
+    if (target < 1)
+        target = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < Buckets - 1; i++)
+    {
+        seen += buckets[i];
+        if (seen >= target)
+            return std::min(getBucketBound(i), getMax());
+    }
+    return getMax();
+}
+
+
+uint64_t LatencyHistogram::getBucket(int i) const
+{
+    return buckets[i];
+}
+
+
+double LatencyHistogram::getBucketBound(int i)
+{
+    if (i >= Buckets - 1)
+        return std::numeric_limits<double>::infinity();
+    return (double)(uint64_t(1) << i) * 1.0e-6;
+}
+
+
+ServerStats::ServerStats() : tickStart(0), lapStart(0)
+{
+    for (int i = 0; i < PhaseCount; i++)
+    {
+        phaseNs[i] = 0;
+        phaseRan[i] = false;
+    }
+    resetTime = now();
+}
+
+
+uint64_t ServerStats::now()
+{
+    static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now() - epoch).count();
+}
+
+
+void ServerStats::beginTick()
+{
+    tickStart = lapStart = now();
+    for (int i = 0; i < PhaseCount; i++)
+    {
+        phaseNs[i] = 0;
+        phaseRan[i] = false;
+    }
+}
+
+
+void ServerStats::lap(Phase phase)
+{
+    const uint64_t t = now();
+    phaseNs[phase] += t - lapStart;
+    phaseRan[phase] = true;
+    lapStart = t;
+}
+
+
+void ServerStats::endTick()
+{
+    // a quiet server spends most of every pass waiting in select()
+    tickTimes.add(now() - tickStart - phaseNs[SelectPhase]);
+    for (int i = 0; i < PhaseCount; i++)
+    {
+        if (phaseRan[i])
+            phaseTimes[i].add(phaseNs[i]);
+    }
+}
+
+
+void ServerStats::addMessage(uint16_t code, uint64_t nanoseconds)
+{
+    messageTimes[code].add(nanoseconds);
+}
+
+
+void ServerStats::reset()
+{
+    tickTimes.clear();
+    for (int i = 0; i < PhaseCount; i++)
+        phaseTimes[i].clear();
+    messageTimes.clear();
+    resetTime = now();
+}
+
+
+const char* ServerStats::getPhaseName(Phase phase)
+{
+    static const char* names[PhaseCount] =
+    {
+        "prepare", "select", "gamestate", "players", "udp", "tcp", "flush", "peers",
+        "worldweapons", "shots", "plugins", "spawns", "curl"
+    };
+    return names[phase];
+}
+
+
+const LatencyHistogram& ServerStats::getTickHistogram() const
+{
+    return tickTimes;
+}
+
+
+const LatencyHistogram& ServerStats::getPhaseHistogram(Phase phase) const
+{
+    return phaseTimes[phase];
+}
+
+
+const std::map<uint16_t, LatencyHistogram>& ServerStats::getMessageHistograms() const
+{
+    return messageTimes;
+}
+
+
+static bool moreTotalTime(const std::pair<uint16_t, const LatencyHistogram*>& a,
+                          const std::pair<uint16_t, const LatencyHistogram*>& b)
+{
+    return a.second->getSum() > b.second->getSum();
+}
+
+
+void ServerStats::getReport(std::vector<std::string>& lines) const
+{
+    const double elapsed = (now() - resetTime) * 1.0e-9;
+    const double ms = 1.0e3;
+    const double us = 1.0e6;
+
+    lines.push_back(TextUtils::format("%llu ticks in %.0fs, busy: mean %.3fms  p99 %.3fms  max %.3fms",
+                                      (unsigned long long)tickTimes.getCount(), elapsed,
+                                      tickTimes.getMean() * ms, tickTimes.getPercentile(0.99) * ms,
+                                      tickTimes.getMax() * ms));
+
+    double total = 0.0;
+    for (int i = 0; i < PhaseCount; i++)
+        total += phaseTimes[i].getSum();
+    for (int i = 0; i < PhaseCount; i++)
+    {
+        const LatencyHistogram& h = phaseTimes[i];
+        if (h.getCount() == 0)
+            continue;
+        lines.push_back(TextUtils::format("  %-12s %5.1f%%  mean %.3fms  p99 %.3fms  max %.3fms",
+                                          getPhaseName((Phase)i),
+                                          total > 0.0 ? h.getSum() * 100.0 / total : 0.0,
+                                          h.getMean() * ms, h.getPercentile(0.99) * ms, h.getMax() * ms));
+    }
+
+    std::vector<std::pair<uint16_t, const LatencyHistogram*> > messages;
+    std::map<uint16_t, LatencyHistogram>::const_iterator itr;
+    for (itr = messageTimes.begin(); itr != messageTimes.end(); ++itr)
+        messages.push_back(std::make_pair(itr->first, &itr->second));
+    std::sort(messages.begin(), messages.end(), moreTotalTime);
+    if (messages.size() > reportMessages)
+        messages.resize(reportMessages);
+
+    if (!messages.empty())
+        lines.push_back("messages by total time:");
+    for (size_t i = 0; i < messages.size(); i++)
+    {
+        const LatencyHistogram& h = *messages[i].second;
+        lines.push_back(TextUtils::format("  %-20s %8llu  total %.1fms  mean %.1fus  p99 %.1fus",
+                                          MsgStrings::strMsgCode(messages[i].first),
+                                          (unsigned long long)h.getCount(), h.getSum() * ms,
+                                          h.getMean() * us, h.getPercentile(0.99) * us));
+    }
+
+    bool header = false;
+    for (int i = 0; i < curMaxPlayers; i++)
+    {
+        GameKeeper::Player *p = GameKeeper::Player::getPlayerByIndex(i);
+        if (!p || !p->netHandler)
+            continue;
+        if (!header)
+        {
+            lines.push_back("player traffic (KB in/out):");
+            header = true;
+        }
+        lines.push_back(TextUtils::format("  %3d %-20s %10.1f %10.1f", i, p->player.getCallSign(),
+                                          p->netHandler->getBytesIn() / 1024.0,
+                                          p->netHandler->getBytesOut() / 1024.0));
+    }
+}
+
+
+static std::string promLabel(const std::string &value)
+{
+    std::string escaped;
+    for (size_t i = 0; i < value.size(); i++)
+    {
+        const char c = value[i];
+        if (c == '\\' || c == '"')
+        {
+            escaped += '\\';
+            escaped += c;
+        }
+        else if (c == '\n')
+            escaped += "\\n";
+        else
+            escaped += c;
+    }
+    return escaped;
+}
+
+
+static void promHistogram(std::string &out, const char *name, const std::string &labels,
+                          const LatencyHistogram &h)
+{
+    const std::string sep = labels.empty() ? "" : ",";
+    uint64_t seen = 0;
+    for (int i = 0; i < LatencyHistogram::Buckets; i++)
+    {
+        seen += h.getBucket(i);
+        const std::string le = (i == LatencyHistogram::Buckets - 1)
+                               ? std::string("+Inf")
+                               : TextUtils::format("%.9g", LatencyHistogram::getBucketBound(i));
+        out += TextUtils::format("%s_bucket{%s%sle=\"%s\"} %llu\n", name, labels.c_str(), sep.c_str(),
+                                 le.c_str(), (unsigned long long)seen);
+    }
+    const std::string braces = labels.empty() ? "" : "{" + labels + "}";
+    out += TextUtils::format("%s_sum%s %.9f\n", name, braces.c_str(), h.getSum());
+    out += TextUtils::format("%s_count%s %llu\n", name, braces.c_str(), (unsigned long long)h.getCount());
+}
+
+
+std::string ServerStats::getPrometheusText() const
+{
+    std::string out;
+
+    out += "# HELP bzfs_tick_seconds Time spent in one pass of the server loop, not counting select().\n";
+    out += "# TYPE bzfs_tick_seconds histogram\n";
+    promHistogram(out, "bzfs_tick_seconds", "", tickTimes);
+
+    out += "# HELP bzfs_phase_seconds Time spent in each part of the server loop per pass.\n";
+    out += "# TYPE bzfs_phase_seconds histogram\n";
+    for (int i = 0; i < PhaseCount; i++)
+    {
+        promHistogram(out, "bzfs_phase_seconds",
+                      TextUtils::format("phase=\"%s\"", getPhaseName((Phase)i)), phaseTimes[i]);
+    }
+
+    out += "# HELP bzfs_message_seconds Time spent handling client messages by type.\n";
+    out += "# TYPE bzfs_message_seconds histogram\n";
+    std::map<uint16_t, LatencyHistogram>::const_iterator itr;
+    for (itr = messageTimes.begin(); itr != messageTimes.end(); ++itr)
+    {
+        promHistogram(out, "bzfs_message_seconds",
+                      TextUtils::format("code=\"%s\"", promLabel(MsgStrings::strMsgCode(itr->first)).c_str()),
+                      itr->second);
+    }
+
+    out += "# HELP bzfs_player_bytes_total Message bytes exchanged with each connected player.\n";
+    out += "# TYPE bzfs_player_bytes_total counter\n";
+    for (int i = 0; i < curMaxPlayers; i++)
+    {
+        GameKeeper::Player *p = GameKeeper::Player::getPlayerByIndex(i);
+        if (!p || !p->netHandler)
+            continue;
+        const std::string callsign = promLabel(p->player.getCallSign());
+        out += TextUtils::format("bzfs_player_bytes_total{slot=\"%d\",callsign=\"%s\",direction=\"in\"} %llu\n",
+                                 i, callsign.c_str(), (unsigned long long)p->netHandler->getBytesIn());
+        out += TextUtils::format("bzfs_player_bytes_total{slot=\"%d\",callsign=\"%s\",direction=\"out\"} %llu\n",
+                                 i, callsign.c_str(), (unsigned long long)p->netHandler->getBytesOut());
+    }
+
+    return out;
+}
+
+
+#ifdef BZ_PLUGINS
+
+// The HTTP server only keeps vdirs that belong to a plugin, so the
+// endpoint is a built in one that never gets loaded or unloaded.
+class MetricsVDir : public bzhttp_VDir, public bz_Plugin
+{
+public:
+    MetricsVDir() : bzhttp_VDir(), bz_Plugin() {}
+
+    const char* Name()
+    {
+        return "Server Metrics";
+    }
+    void Init(const char* /*config*/) {}
+
+    virtual const char* VDirName()
+    {
+        return "metrics";
+    }
+    virtual const char* VDirDescription()
+    {
+        return "Server loop and message timings in Prometheus format";
+    }
+
+    virtual bzhttp_ePageGenStatus GeneratePage(const bzhttp_Request &, bzhttp_Response &response)
+    {
+        response.ReturnCode = e200OK;
+        response.DocumentType = eOther;
+        response.MimeType = "text/plain; version=0.0.4";
+        response.AddBodyData(serverStats.getPrometheusText().c_str());
+        return ePageDone;
+    }
+};
+
+void registerMetricsVDir()
+{
+    static MetricsVDir *metrics = NULL;
+    if (!metrics)
+        metrics = new MetricsVDir();
+    bzhttp_RegisterVDir(metrics, metrics);
+}
+
+#else
+
+void registerMetricsVDir()
+{
+}
+
+#endif
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
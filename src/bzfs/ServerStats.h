@@ -0,0 +1,155 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef __SERVERSTATS_H__
+#define __SERVERSTATS_H__
+
+// bzflag global header
+#include "global.h"
+
+// system headers
+#include <string>
+#include <vector>
+#include <map>
+#include <stdint.h>
+
+/** Latency histogram with power of two buckets from 1us to ~1s.
+    Adding a sample is a handful of compares, nothing is allocated.
+*/
+class LatencyHistogram
+{
+public:
+    enum { Buckets = 22 };      // 2^0 .. 2^20 us, then +Inf
+
+    LatencyHistogram();
+
+    void    clear();
+    void    add(uint64_t nanoseconds);
+
+    uint64_t    getCount() const;
+    double  getSum() const;     // seconds
+    double  getMax() const;     // seconds
+    double  getMean() const;    // seconds
+    // upper bound of the bucket holding the given fraction of samples
+    double  getPercentile(double fraction) const;
+
+    uint64_t    getBucket(int i) const;
+    static double   getBucketBound(int i);  // seconds, +Inf for the last
+
+private:
+    uint64_t    count;
+    uint64_t    sumNs;
+    uint64_t    maxNs;
+    uint64_t    buckets[Buckets];
+};
+
+
+/** Where bzfs spends its time.  The main loop calls beginTick(), then
+    lap() after each phase, then endTick(); each phase's time for the
+    tick goes into its histogram, and the tick's time less the select()
+    wait into the tick histogram.  Message handling is timed per code
+    with a MessageTimer.  Player byte counts come from the NetHandlers.
+*/
+class ServerStats
+{
+public:
+    enum Phase
+    {
+        PreparePhase = 0,   // collision grid, timers, fd sets
+        SelectPhase,
+        GameStatePhase,     // replay, countdowns, voting, list server
+        PlayerPhase,        // doStuffOnPlayer
+        UDPPhase,
+        TCPPhase,
+        FlushPhase,
+        PeerPhase,          // non-player connections
+        WorldWeaponPhase,
+        ShotPhase,
+        PluginPhase,        // chat, tick event, API tick
+        SpawnPhase,
+        CURLPhase,
+        PhaseCount
+    };
+
+    class MessageTimer
+    {
+    public:
+        MessageTimer(uint16_t code);
+        ~MessageTimer();
+    private:
+        uint16_t    code;
+        uint64_t    start;
+    };
+
+    ServerStats();
+
+    void    beginTick();
+    void    lap(Phase phase);
+    void    endTick();
+
+    void    reset();
+
+    static const char*  getPhaseName(Phase phase);
+
+    const LatencyHistogram& getTickHistogram() const;
+    const LatencyHistogram& getPhaseHistogram(Phase phase) const;
+    const std::map<uint16_t, LatencyHistogram>& getMessageHistograms() const;
+
+    // short lines for the /serverstats command
+    void    getReport(std::vector<std::string>& lines) const;
+    // Prometheus text exposition format
+    std::string getPrometheusText() const;
+
+    static uint64_t now();
+
+private:
+    void    addMessage(uint16_t code, uint64_t nanoseconds);
+
+    uint64_t    tickStart;
+    uint64_t    lapStart;
+    uint64_t    phaseNs[PhaseCount];
+    bool    phaseRan[PhaseCount];
+
+    LatencyHistogram    tickTimes;
+    LatencyHistogram    phaseTimes[PhaseCount];
+    std::map<uint16_t, LatencyHistogram> messageTimes;
+    uint64_t    resetTime;
+
+    friend class MessageTimer;
+};
+
+extern ServerStats serverStats;
+
+// serve getPrometheusText() as the "metrics" HTTP vdir
+void registerMetricsVDir();
+
+
+inline ServerStats::MessageTimer::MessageTimer(uint16_t _code)
+    : code(_code), start(ServerStats::now())
+{
+}
+
+inline ServerStats::MessageTimer::~MessageTimer()
+{
+    serverStats.addMessage(code, ServerStats::now() - start);
+}
+
+
+#endif /* __SERVERSTATS_H__ */
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
@@ -0,0 +1,314 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/* interface header */
+#include "WorldCache.h"
+
+/* system implementation headers */
+#include <stdio.h>
+#include <string.h>
+#include <sstream>
+#include <vector>
+
+/* common implementation headers */
+#include "global.h"
+#include "md5.h"
+#include "Pack.h"
+#include "StateDatabase.h"
+#include "TextUtils.h"
+#include "TimeKeeper.h"
+
+/* local implementation headers */
+#include "CustomWorld.h"
+
+
+// bump this when the layout below or the packed database changes
+static const uint16_t cacheVersion = 1;
+static const char cacheMagic[4] = { 'B', 'Z', 'W', 'C' };
+static const int maxIncludeDepth = 16;
+
+// BZDB variables the world file parser uses for its defaults
+static const std::string* const parserVariables[] =
+{
+    &StateDatabase::BZDB_WORLDSIZE,
+    &StateDatabase::BZDB_FLAGHEIGHT,
+    &StateDatabase::BZDB_BOXBASE,
+    &StateDatabase::BZDB_BOXHEIGHT,
+    &StateDatabase::BZDB_PYRBASE,
+    &StateDatabase::BZDB_PYRHEIGHT,
+    &StateDatabase::BZDB_BASESIZE,
+    &StateDatabase::BZDB_TELEWIDTH,
+    &StateDatabase::BZDB_TELEBREADTH,
+    &StateDatabase::BZDB_TELEHEIGHT
+};
+
+
+WorldCache::WorldCache(const std::string& _cacheFile,
+                       const std::string& _worldFile) :
+    cacheFile(_cacheFile), worldFile(_worldFile), usable(false),
+    database(NULL), databaseSize(0)
+{
+    // plugin map objects run their handlers while the file is parsed
+    if (!customObjectMap.empty())
+    {
+        logDebugMessage(1,"World cache: not used, custom map objects are registered\n");
+        return;
+    }
+
+    TimeKeeper startTime = TimeKeeper::getCurrent();
+
+    std::string data;
+    if (!readWorldFile(worldFile, data, 0))
+    {
+        logDebugMessage(1,"World cache: not used, can not read %s or its includes\n",
+                        worldFile.c_str());
+        return;
+    }
+
+    MD5 md5;
+    md5.update((const unsigned char*)data.data(), data.size());
+    std::string defaults = TextUtils::format("mapVersion %i\n", mapVersion);
+    const int count = sizeof(parserVariables) / sizeof(parserVariables[0]);
+    for (int i = 0; i < count; i++)
+        defaults += *parserVariables[i] + " " + BZDB.get(*parserVariables[i]) + "\n";
+    // the walls are packed into the cached database
+    defaults += "noWalls " + BZDB.get("noWalls") + "\n";
+    md5.update((const unsigned char*)defaults.data(), defaults.size());
+    md5.finalize();
+    sourceHash = md5.hexdigest();
+    usable = true;
+
+    TimeKeeper endTime = TimeKeeper::getCurrent();
+    logDebugMessage(3,"World cache: hashing: %.3f seconds\n", endTime - startTime);
+}
+
+
+WorldCache::~WorldCache()
+{
+    delete[] database;
+}
+
+
+bool WorldCache::isUsable() const
+{
+    return usable;
+}
+
+
+// reads the world file with the text of its includes in place of the
+// include lines, which is enough to hash and to find the server sections
+bool WorldCache::readWorldFile(const std::string& fileName, std::string& data,
+                               int depth) const
+{
+    // the parser does not check for recursion, don't loop here either
+    if (depth > maxIncludeDepth)
+        return false;
+
+    FILE* file = fopen(fileName.c_str(), "rb");
+    if (file == NULL)
+        return false;
+
+    std::string text;
+    char buffer[65536];
+    size_t bytes;
+    while ((bytes = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        text.append(buffer, bytes);
+    const bool good = (ferror(file) == 0);
+    fclose(file);
+    if (!good)
+        return false;
+
+    std::istringstream input(text);
+    std::string line;
+    while (std::getline(input, line))
+    {
+        std::istringstream tokens(line);
+        std::string token, incName;
+        tokens >> token;
+        if (strcasecmp(token.c_str(), "include") != 0)
+        {
+            data += line;
+            data += "\n";
+            continue;
+        }
+
+        // remote includes can change without us noticing
+        tokens >> incName;
+        if (incName.find("://") != std::string::npos ||
+                incName.compare(0, 6, "file:/") == 0)
+            return false;
+        data += "# include " + incName + "\n";
+        if (!readWorldFile(incName, data, depth + 1))
+            return false;
+    }
+    return true;
+}
+
+
+bool WorldCache::extractServerSections(const std::string& data)
+{
+    // copy the sections the client database does not carry, using the
+    // same first-token-of-a-line rule as BZWReader::readWorldStream()
+    sections = "";
+    bool copying = false;
+    std::istringstream input(data);
+    std::string line;
+    while (std::getline(input, line))
+    {
+        std::istringstream tokens(line);
+        std::string token;
+        tokens >> token;
+
+        if (!copying)
+        {
+            if ((strcasecmp(token.c_str(), "world") == 0) ||
+                    (strcasecmp(token.c_str(), "zone") == 0) ||
+                    (strcasecmp(token.c_str(), "weapon") == 0))
+                copying = true;
+        }
+
+        if (copying)
+        {
+            sections += line;
+            sections += "\n";
+            if (strcasecmp(token.c_str(), "end") == 0)
+                copying = false;
+        }
+    }
+    return !copying;
+}
+
+
+bool WorldCache::load()
+{
+    if (!usable)
+        return false;
+
+    TimeKeeper startTime = TimeKeeper::getCurrent();
+
+    FILE* file = fopen(cacheFile.c_str(), "rb");
+    if (file == NULL)
+    {
+        logDebugMessage(1,"World cache: %s does not exist yet\n", cacheFile.c_str());
+        return false;
+    }
+    std::vector<char> data;
+    char buffer[65536];
+    size_t bytes;
+    while ((bytes = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        data.insert(data.end(), buffer, buffer + bytes);
+    fclose(file);
+
+    if ((data.size() < sizeof(cacheMagic) + 2 * sizeof(uint16_t)) ||
+            (memcmp(&data[0], cacheMagic, sizeof(cacheMagic)) != 0))
+    {
+        logDebugMessage(1,"World cache: %s is not a world cache\n", cacheFile.c_str());
+        return false;
+    }
+
+    nboUseErrorChecking(true);
+    nboSetBufferLength(data.size() - sizeof(cacheMagic));
+    nboClearBufferError();
+
+    const void* buf = &data[sizeof(cacheMagic)];
+    uint16_t version, cachedMapVersion;
+    std::string hash;
+    uint32_t size;
+    buf = nboUnpackUShort(buf, version);
+    buf = nboUnpackUShort(buf, cachedMapVersion);
+    buf = nboUnpackStdString(buf, hash);
+    if ((version != cacheVersion) || (cachedMapVersion != mapVersion) ||
+            (hash != sourceHash))
+    {
+        nboUseErrorChecking(false);
+        logDebugMessage(1,"World cache: %s is stale\n", cacheFile.c_str());
+        return false;
+    }
+    buf = nboUnpackStdString(buf, digest);
+    buf = nboUnpackStdString(buf, sections);
+    buf = nboUnpackUInt(buf, size);
+
+    const char* end = &data[0] + data.size();
+    const bool overrun = nboGetBufferError() || ((const char*)buf + size != end);
+    nboUseErrorChecking(false);
+    if (overrun || (size == 0))
+    {
+        logDebugMessage(1,"World cache: %s is truncated\n", cacheFile.c_str());
+        return false;
+    }
+
+    delete[] database;
+    database = new char[size];
+    databaseSize = size;
+    memcpy(database, buf, size);
+
+    TimeKeeper endTime = TimeKeeper::getCurrent();
+    logDebugMessage(3,"World cache: reading: %.3f seconds\n", endTime - startTime);
+    return true;
+}
+
+
+bool WorldCache::save(const char* worldDatabase, unsigned int size,
+                      const std::string& hexDigest)
+{
+    if (!usable)
+        return false;
+
+    std::string data;
+    if (!readWorldFile(worldFile, data, 0) || !extractServerSections(data))
+        return false;
+    digest = hexDigest;
+
+    const unsigned int headerSize = sizeof(cacheMagic) + 2 * sizeof(uint16_t) +
+                                    nboStdStringPackSize(sourceHash) +
+                                    nboStdStringPackSize(digest) +
+                                    nboStdStringPackSize(sections) + sizeof(uint32_t);
+    std::vector<char> header(headerSize);
+    memcpy(&header[0], cacheMagic, sizeof(cacheMagic));
+    void* buf = &header[sizeof(cacheMagic)];
+    buf = nboPackUShort(buf, cacheVersion);
+    buf = nboPackUShort(buf, (uint16_t)mapVersion);
+    buf = nboPackStdString(buf, sourceHash);
+    buf = nboPackStdString(buf, digest);
+    buf = nboPackStdString(buf, sections);
+    buf = nboPackUInt(buf, size);
+
+    // write to a temporary file so a crash never leaves a broken cache
+    const std::string tmpName = cacheFile + ".tmp";
+    FILE* file = fopen(tmpName.c_str(), "wb");
+    if (file == NULL)
+        return false;
+    const bool good = (fwrite(&header[0], 1, headerSize, file) == headerSize) &&
+                      (fwrite(worldDatabase, 1, size, file) == size);
+    if ((fclose(file) != 0) || !good)
+    {
+        remove(tmpName.c_str());
+        return false;
+    }
+    remove(cacheFile.c_str());
+    if (rename(tmpName.c_str(), cacheFile.c_str()) != 0)
+    {
+        remove(tmpName.c_str());
+        return false;
+    }
+
+    logDebugMessage(1,"World cache: saved %s\n", cacheFile.c_str());
+    return true;
+}
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
@@ -0,0 +1,92 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef __WORLDCACHE_H__
+#define __WORLDCACHE_H__
+
+#include "common.h"
+
+/* system interface headers */
+#include <string>
+
+
+/** Precompiled form of a world file.  It holds the packed and compressed
+    world database exactly as it is sent to the clients, its MD5 digest,
+    and the text of the few sections the server keeps for itself (world,
+    zone and weapon) which are not part of the client database.  The
+    cache is keyed by a hash of the world file, the files it includes,
+    and the BZDB settings the parser and the walls depend on, so an
+    edited map is parsed again and the cache is rewritten.
+*/
+class WorldCache
+{
+public:
+    /** hashes the world file, do this before the world is parsed since
+        the world section changes some of the hashed BZDB variables */
+    WorldCache(const std::string& cacheFile, const std::string& worldFile);
+    ~WorldCache();
+
+    /** false for remote world files or includes, and custom map objects */
+    bool isUsable() const;
+
+    /** read the cache file, true if it matches the world file */
+    bool load();
+    /** write the cache for the world database that was just packed */
+    bool save(const char* worldDatabase, unsigned int size,
+              const std::string& hexDigest);
+
+    const char* getDatabase() const
+    {
+        return database;
+    }
+    unsigned int getDatabaseSize() const
+    {
+        return databaseSize;
+    }
+    const std::string& getHexDigest() const
+    {
+        return digest;
+    }
+    const std::string& getServerSections() const
+    {
+        return sections;
+    }
+
+private:
+    bool readWorldFile(const std::string& fileName, std::string& data,
+                       int depth) const;
+    bool extractServerSections(const std::string& data);
+
+    std::string cacheFile;
+    std::string worldFile;
+    std::string sourceHash;
+    bool usable;
+
+    char* database;
+    unsigned int databaseSize;
+    std::string digest;
+    std::string sections;
+
+    // no copying
+    WorldCache(const WorldCache&);
+    WorldCache& operator=(const WorldCache&);
+};
+
+#endif
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
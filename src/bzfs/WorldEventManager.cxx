@@ -104,6 +104,21 @@ void WorldEventManager::callEvents (  bz_EventData  *eventData )
     callEvents(eventData->eventType,eventData);
 }
 
+bool WorldEventManager::hasHandlers ( bz_eEventType eventType )
+{
+    for (size_t i = 0; i < eventList.size(); i++)
+    {
+        if (eventList[i]->HasEvent(eventType))
+            return true;
+    }
+    for (size_t i = 0; i < pendingAdds.size(); i++)
+    {
+        if (pendingAdds[i]->HasEvent(eventType))
+            return true;
+    }
+    return false;
+}
+
 void WorldEventManager::processPending()
 {
     for (size_t i = 0; i < pendingAdds.size(); i++)
@@ -561,6 +561,97 @@ int WorldInfo::packDatabase()
     return 1;
 }
 
+bool WorldInfo::unpackDatabase(const void* worldDatabase, unsigned int size)
+{
+    // check the network framing that defineWorld() put around the database
+    const void* buf = worldDatabase;
+    uint16_t len, code, dbMapVersion;
+    uint32_t fullSize, gzSize;
+    nboUseErrorChecking(true);
+    nboSetBufferLength(size);
+    nboClearBufferError();
+    buf = nboUnpackUShort(buf, len);
+    buf = nboUnpackUShort(buf, code);
+    buf = nboUnpackUShort(buf, dbMapVersion);
+    buf = nboUnpackUInt(buf, fullSize);
+    buf = nboUnpackUInt(buf, gzSize);
+    nboUseErrorChecking(false);
+    if (nboGetBufferError() || (code != WorldCodeHeader) ||
+            (dbMapVersion != mapVersion) || (gzSize > nboGetBufferLength()))
+    {
+        logDebugMessage(1,"WorldInfo::unpackDatabase() bad header\n");
+        return false;
+    }
+
+    TimeKeeper startTime = TimeKeeper::getCurrent();
+    uLongf destLen = fullSize;
+    char* fullDB = new char[fullSize];
+    if (uncompress((Bytef*)fullDB, &destLen, (const Bytef*)buf, gzSize) != Z_OK ||
+            (destLen != fullSize))
+    {
+        delete[] fullDB;
+        logDebugMessage(1,"WorldInfo::unpackDatabase() could not decompress\n");
+        return false;
+    }
+    TimeKeeper endTime = TimeKeeper::getCurrent();
+    logDebugMessage(3,"Decompression: %.3f seconds\n", endTime - startTime);
+
+    delete[] database;
+    database = new char[gzSize];
+    memcpy(database, buf, gzSize);
+    databaseSize = gzSize;
+    uncompressedSize = fullSize;
+
+    // same order as packDatabase()
+    const void* dbPtr = fullDB;
+    nboUseErrorChecking(true);
+    nboSetBufferLength(fullSize);
+    nboClearBufferError();
+
+    DYNCOLORMGR.clear();
+    dbPtr = DYNCOLORMGR.unpack(dbPtr);
+
+    TEXMATRIXMGR.clear();
+    dbPtr = TEXMATRIXMGR.unpack(dbPtr);
+
+    MAGNUMMATERIALMGR.clear(false);
+    dbPtr = MAGNUMMATERIALMGR.unpack(dbPtr);
+
+    PHYDRVMGR.clear();
+    dbPtr = PHYDRVMGR.unpack(dbPtr);
+
+    TRANSFORMMGR.clear();
+    dbPtr = TRANSFORMMGR.unpack(dbPtr);
+
+    OBSTACLEMGR.clear();
+    dbPtr = OBSTACLEMGR.unpack(dbPtr);
+
+    dbPtr = links.unpack(dbPtr);
+
+    dbPtr = nboUnpackFloat(dbPtr, waterLevel);
+    waterMatRef = NULL;
+    if (waterLevel >= 0.0f)
+    {
+        int32_t matindex;
+        dbPtr = nboUnpackInt(dbPtr, matindex);
+        waterMatRef = MAGNUMMATERIALMGR.getMaterial(matindex);
+    }
+
+    nboUseErrorChecking(false);
+    const bool overrun = nboGetBufferError();
+    delete[] fullDB;
+    if (overrun)
+    {
+        logDebugMessage(1,"WorldInfo::unpackDatabase() overrun\n");
+        return false;
+    }
+
+    endTime = TimeKeeper::getCurrent();
+    logDebugMessage(3,"Unpacking: %.3f seconds\n", endTime - startTime);
+
+    return true;
+}
+
 void *WorldInfo::getDatabase() const
 {
     return database;
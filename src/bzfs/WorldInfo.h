@@ -110,6 +110,12 @@ public:
 
     void finishWorld();
     int packDatabase();
+    /** restore the managers, obstacles, links and water level from a
+     *  world database made by packDatabase() and keep it as this world's
+     *  database. the weapons and entry zones it holds are skipped, they
+     *  have to be added again since the server needs more of them.
+     */
+    bool unpackDatabase(const void* worldDatabase, unsigned int size);
 
     bool isFinisihed()
     {
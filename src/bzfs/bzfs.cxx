@@ -42,6 +42,7 @@
 #include "WorldInfo.h"
 #include "WorldWeapons.h"
 #include "BZWReader.h"
+#include "WorldCache.h"
 #include "PackVars.h"
 #include "SpawnPosition.h"
 #include "DropGeometry.h"
@@ -50,6 +51,7 @@
 #include "Filter.h"
 #include "WorldEventManager.h"
 #include "WorldGenerators.h"
+#include "ServerStats.h"
 
 
 // common implementation headers
@@ -180,6 +182,11 @@ public:
 
         worldEventManager.callEvents(bz_eLoggingEvent,&data);
     }
+
+    bool wantsLevel ( int /* level */ )
+    {
+        return worldEventManager.hasHandlers(bz_eLoggingEvent);
+    }
 };
 
 APILoggingCallback apiLoggingCallback;
@@ -1028,11 +1035,16 @@ static void serverStop()
 }
 
 
-static void relayPlayerPacket(int index, uint16_t len, const void *rawbuf, uint16_t code)
+static void relayPlayerPacket(int index, uint16_t len, const void *rawbuf, uint16_t code,
+                              const PlayerState& state, float timestamp)
 {
     if (Record::enabled())
         Record::addPacket(code, len, (const char*)rawbuf + 4);
 
+    // delta updates are quantized, stay away from them if asked to
+    const bool allowDelta = BZDB.isTrue(StateDatabase::BZDB_DELTAUPDATES) &&
+                            !BZDB.isTrue(StateDatabase::BZDB_NOSMALLPACKETS);
+
     // relay packet to all players except origin
     for (int i = 0; i < curMaxPlayers; i++)
     {
@@ -1041,7 +1053,18 @@ static void relayPlayerPacket(int index, uint16_t len, const void *rawbuf, uint1
             continue;
         PlayerInfo& pi = playerData->player;
 
-        if (i != index && pi.isPlaying())
+        if (i == index || !pi.isPlaying())
+            continue;
+
+        if (allowDelta && playerData->wantsDeltaUpdates())
+        {
+            void *buf, *bufStart = getDirectMessageBuffer();
+            buf = nboPackFloat(bufStart, timestamp);
+            buf = nboPackUByte(buf, index);
+            buf = playerData->packDeltaUpdate(buf, index, state);
+            directMessage(i, MsgPlayerUpdateDelta, (char*)buf - (char*)bufStart, bufStart);
+        }
+        else
             pwrite(*playerData, rawbuf, len + 4);
     }
 }
@@ -1089,6 +1112,45 @@ void makeWalls ( void )
 }
 
 
+static bool packWorld()
+{
+    // package up world
+    world->packDatabase();
+
+    // now get world packaged for network transmission
+    worldDatabaseSize = 4 + WorldCodeHeaderSize +
+                        world->getDatabaseSize() + 4 + WorldCodeEndSize;
+
+    worldDatabase = new char[worldDatabaseSize];
+    // this should NOT happen but it does sometimes
+    if (!worldDatabase)
+        return false;
+    memset(worldDatabase, 0, worldDatabaseSize);
+
+    void *buf = worldDatabase;
+    buf = nboPackUShort(buf, WorldCodeHeaderSize);
+    buf = nboPackUShort(buf, WorldCodeHeader);
+    buf = nboPackUShort(buf, mapVersion);
+    buf = nboPackUInt(buf, world->getUncompressedSize());
+    buf = nboPackUInt(buf, world->getDatabaseSize());
+    buf = nboPackString(buf, world->getDatabase(), world->getDatabaseSize());
+    buf = nboPackUShort(buf, WorldCodeEndSize);
+    buf = nboPackUShort(buf, WorldCodeEnd);
+
+    TimeKeeper startTime = TimeKeeper::getCurrent();
+    MD5 md5;
+    md5.update((unsigned char *)worldDatabase, worldDatabaseSize);
+    md5.finalize();
+    hexDigest = (clOptions->worldFile == "") ? 't' : 'p';
+    hexDigest += md5.hexdigest();
+    TimeKeeper endTime = TimeKeeper::getCurrent();
+    logDebugMessage(3,"MD5 generation: %.3f seconds\n", endTime - startTime);
+    logDebugMessage(3,"MD5 = %s\n", hexDigest.c_str()+1);
+
+    return true;
+}
+
+
 bool defineWorld ( void )
 {
     // clean up old database
@@ -1122,11 +1184,34 @@ bool defineWorld ( void )
     }
 
     // make world and add buildings
+    TimeKeeper worldStartTime = TimeKeeper::getCurrent();
+    WorldCache* cache = NULL;
+    bool fromCache = false;
+    world = NULL;
     if (worldData.worldFile.size())
     {
-        BZWReader* reader = new BZWReader(std::string(worldData.worldFile.c_str()));
-        world = reader->defineWorldFromFile();
-        delete reader;
+        const std::string worldFile = worldData.worldFile.c_str();
+        if (clOptions->worldCache != "")
+        {
+            // hash before parsing, the world section changes BZDB
+            cache = new WorldCache(clOptions->worldCache, worldFile);
+            if (cache->load())
+            {
+                BZWReader* reader = new BZWReader(worldFile);
+                world = reader->defineWorldFromCache(*cache);
+                delete reader;
+                fromCache = (world != NULL);
+                if (!fromCache)
+                    logDebugMessage(1,"World cache: falling back to %s\n", worldFile.c_str());
+            }
+        }
+
+        if (!world)
+        {
+            BZWReader* reader = new BZWReader(worldFile);
+            world = reader->defineWorldFromFile();
+            delete reader;
+        }
 
         if (clOptions->gameType == ClassicCTF)
         {
@@ -1137,6 +1222,7 @@ bool defineWorld ( void )
                     std::cerr << "base was not defined for "
                               << Team::getName((TeamColor)i)
                               << std::endl;
+                    delete cache;
                     return false;
                 }
             }
@@ -1165,42 +1251,40 @@ bool defineWorld ( void )
     }
 
     if (world == NULL)
+    {
+        delete cache;
         return false;
+    }
 
     maxWorldHeight = world->getMaxWorldHeight();
 
-    // package up world
-    world->packDatabase();
-
-    // now get world packaged for network transmission
-    worldDatabaseSize = 4 + WorldCodeHeaderSize +
-                        world->getDatabaseSize() + 4 + WorldCodeEndSize;
-
-    worldDatabase = new char[worldDatabaseSize];
-    // this should NOT happen but it does sometimes
-    if (!worldDatabase)
+    if (fromCache)
+    {
+        // already packed, compressed and hashed when the cache was made
+        worldDatabaseSize = cache->getDatabaseSize();
+        worldDatabase = new char[worldDatabaseSize];
+        memcpy(worldDatabase, cache->getDatabase(), worldDatabaseSize);
+        hexDigest = cache->getHexDigest();
+    }
+    else if (!packWorld())
+    {
+        delete cache;
         return false;
-    memset(worldDatabase, 0, worldDatabaseSize);
-
-    void *buf = worldDatabase;
-    buf = nboPackUShort(buf, WorldCodeHeaderSize);
-    buf = nboPackUShort(buf, WorldCodeHeader);
-    buf = nboPackUShort(buf, mapVersion);
-    buf = nboPackUInt(buf, world->getUncompressedSize());
-    buf = nboPackUInt(buf, world->getDatabaseSize());
-    buf = nboPackString(buf, world->getDatabase(), world->getDatabaseSize());
-    buf = nboPackUShort(buf, WorldCodeEndSize);
-    buf = nboPackUShort(buf, WorldCodeEnd);
+    }
+    else if (cache && cache->isUsable())
+    {
+        if (!cache->save(worldDatabase, worldDatabaseSize, hexDigest))
+        {
+            logDebugMessage(1,"World cache: could not save %s\n",
+                            clOptions->worldCache.c_str());
+        }
+    }
+    delete cache;
 
-    TimeKeeper startTime = TimeKeeper::getCurrent();
-    MD5 md5;
-    md5.update((unsigned char *)worldDatabase, worldDatabaseSize);
-    md5.finalize();
-    hexDigest = (clOptions->worldFile == "") ? 't' : 'p';
-    hexDigest += md5.hexdigest();
-    TimeKeeper endTime = TimeKeeper::getCurrent();
-    logDebugMessage(3,"MD5 generation: %.3f seconds\n", endTime - startTime);
-    logDebugMessage(3,"MD5 = %s\n", hexDigest.c_str()+1);
+    TimeKeeper worldEndTime = TimeKeeper::getCurrent();
+    logDebugMessage(1,"World %s: %.3f seconds\n",
+                    fromCache ? "loaded from cache" : "loaded",
+                    worldEndTime - worldStartTime);
 
     // water levels probably require flags on buildings
     const float waterLevel = world->getWaterLevel();
@@ -2923,6 +3007,14 @@ void removePlayer(int playerIndex, const char *reason, bool notify)
     // player is outta here.  if player never joined a team then
     // don't count as a player.
 
+    // whoever gets the slot next starts over with full updates
+    for (int i = 0; i < curMaxPlayers; i++)
+    {
+        GameKeeper::Player *p = GameKeeper::Player::getPlayerByIndex(i);
+        if (p != NULL)
+            p->resetDeltaUpdates(playerIndex);
+    }
+
     if (wasPlaying)
     {
         // make them wait from the time they left, but only if they
@@ -4619,6 +4711,9 @@ static void handleCommand(int t, void *rawbuf, bool udp)
     buf = nboUnpackUShort(buf, code);
     char buffer[MessageLen];
 
+    // counts for the message's code however the handling returns
+    ServerStats::MessageTimer messageTimer(code);
+
     if (udp)
     {
         switch (code)
@@ -4627,6 +4722,7 @@ static void handleCommand(int t, void *rawbuf, bool udp)
         case MsgShotEnd:
         case MsgPlayerUpdate:
         case MsgPlayerUpdateSmall:
+        case MsgPlayerUpdateAck:
         case MsgGMUpdate:
         case MsgUDPLinkRequest:
         case MsgUDPLinkEstablished:
@@ -5498,7 +5594,28 @@ static void handleCommand(int t, void *rawbuf, bool udp)
 
         searchFlag(*playerData);
 
-        relayPlayerPacket(t, len, rawbuf, code);
+        relayPlayerPacket(t, len, rawbuf, code, state, timestamp);
+        break;
+    }
+
+    // player wants delta updates, and says which ones it got
+    case MsgPlayerUpdateAck:
+    {
+        if (!BZDB.isTrue(StateDatabase::BZDB_DELTAUPDATES))
+            break;
+        playerData->enableDeltaUpdates();
+
+        uint8_t count;
+        buf = nboUnpackUByte(buf, count);
+        if (len < 1 + 2 * count)
+            break;
+        for (int i = 0; i < count; i++)
+        {
+            uint8_t sender, sequence;
+            buf = nboUnpackUByte(buf, sender);
+            buf = nboUnpackUByte(buf, sequence);
+            playerData->ackDeltaUpdate(sender, sequence);
+        }
         break;
     }
 
@@ -6589,6 +6706,11 @@ int main(int argc, char **argv)
         BZDB.addCallback(std::string(globalDBItems[gi].name), onGlobalChanged, (void*) NULL);
     }
 
+    // the shared default is off so clients never ask older servers for
+    // delta updates, this server offers them unless told otherwise
+    BZDB.set(StateDatabase::BZDB_DELTAUPDATES, "1");
+    BZDB.setDefault(StateDatabase::BZDB_DELTAUPDATES, "1");
+
     // add the global callback for worldEventManager
     BZDB.addGlobalCallback(bzdbGlobalCallback, NULL);
 
@@ -6603,6 +6725,8 @@ int main(int argc, char **argv)
     // parse arguments  (finalized later)
     parse(argc, argv, *clOptions);
     setDebugTimestamp (clOptions->timestampLog, clOptions->timestampMicros, clOptions->timestampUTC);
+    if (clOptions->asyncLog && !startAsyncLogging(clOptions->logSettings))
+        std::cerr << "could not open log file " << clOptions->logSettings.filename << ", logging to the console" << std::endl;
 
     // no more defaults
     BZDB.setSaveDefault(false);
@@ -6627,6 +6751,8 @@ int main(int argc, char **argv)
 #ifdef BZ_PLUGINS
     // see if we are going to load any plugins
     initPlugins();
+    if (clOptions->metrics)
+        registerMetricsVDir();
     // check for python by default
     //    loadPlugin(std::string("python"),std::string(""));
     for (unsigned int plugin = 0; plugin < clOptions->pluginList.size(); plugin++)
@@ -6901,6 +7027,7 @@ int main(int argc, char **argv)
     int i;
     while (!done)
     {
+        serverStats.beginTick();
 
         // see if the octree needs to be reloaded
         world->checkCollisionManager();
@@ -7021,6 +7148,8 @@ int main(int argc, char **argv)
             dontWait = false;
         }
 
+        serverStats.lap(ServerStats::PreparePhase);
+
         /**************
          *  SELECT()  *
          **************/
@@ -7032,6 +7161,7 @@ int main(int argc, char **argv)
         timeout.tv_sec = long(floorf(waitTime));
         timeout.tv_usec = long(1.0e+6f * (waitTime - floorf(waitTime)));
         nfound = select(maxFileDescriptor+1, (fd_set*)&read_set, (fd_set*)&write_set, 0, &timeout);
+        serverStats.lap(ServerStats::SelectPhase);
         //if (nfound)
         //  logDebugMessage(1,"nfound,read,write %i,%08lx,%08lx\n", nfound, read_set, write_set);
 
@@ -7238,6 +7368,7 @@ int main(int argc, char **argv)
             }
         }
 
+        serverStats.lap(ServerStats::GameStatePhase);
         requestAuthentication = false;
         for (int p = 0; p < curMaxPlayers; ++p)
         {
@@ -7246,6 +7377,7 @@ int main(int argc, char **argv)
                 continue;
             doStuffOnPlayer(*playerData);
         }
+        serverStats.lap(ServerStats::PlayerPhase);
         if (requestAuthentication)
         {
             // Request the listserver authentication
@@ -7648,6 +7780,8 @@ int main(int argc, char **argv)
                 listServerLink->queueMessage(ListServerLink::ADD);
             }
 
+        serverStats.lap(ServerStats::GameStatePhase);
+
         // check messages
         if (nfound > 0)
         {
@@ -7699,6 +7833,7 @@ int main(int argc, char **argv)
                     }
                 }
             }
+            serverStats.lap(ServerStats::UDPPhase);
 
             // process eventual resolver requests
             NetHandler::checkDNS(&read_set, &write_set);
@@ -7720,6 +7855,7 @@ int main(int argc, char **argv)
                 }
                 playerData->handleTcpPacket(&read_set);
             }
+            serverStats.lap(ServerStats::TCPPhase);
         }
         else if (nfound < 0)
         {
@@ -7733,6 +7869,7 @@ int main(int argc, char **argv)
         {
             if (NetHandler::anyUDPPending())
                 NetHandler::flushAllUDP();
+            serverStats.lap(ServerStats::FlushPhase);
         }
 
 
@@ -7803,13 +7940,16 @@ int main(int argc, char **argv)
             peer.netHandler = NULL;
             netConnectedPeers.erase(netConnectedPeers.find(toKill[j]));
         }
+        serverStats.lap(ServerStats::PeerPhase);
 
 
         // Fire world weapons
         world->getWorldWeapons().fire();
+        serverStats.lap(ServerStats::WorldWeaponPhase);
 
         // update all the shots we have tracked
         ShotManager.Update();
+        serverStats.lap(ServerStats::ShotPhase);
 
         // send out any pending chat messages
         std::list<PendingChatMessages>::iterator itr = pendingChatMessages.begin();
@@ -7825,6 +7965,7 @@ int main(int argc, char **argv)
         worldEventManager.callEvents(bz_eTickEvent,&tickData);
 
         ApiTick();
+        serverStats.lap(ServerStats::PluginPhase);
 
         // Spawn waiting players
         doSpawns();
@@ -7838,9 +7979,13 @@ int main(int argc, char **argv)
             if ((clOptions->worldFile == "") && !Replay::enabled())
                 defineWorld();
         }
+        serverStats.lap(ServerStats::SpawnPhase);
 
         // cURLperform should be called in any case as we could incur in timeout
         dontWait = dontWait || cURLManager::perform();
+        serverStats.lap(ServerStats::CURLPhase);
+
+        serverStats.endTick();
     }
 
     bzUPnP.stop();
@@ -7879,6 +8024,8 @@ int main(int argc, char **argv)
     WSACleanup();
 #endif /* defined(_WIN32) */
 
+    stopAsyncLogging();
+
     // done
     return exitCode;
 }
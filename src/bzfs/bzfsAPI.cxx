@@ -35,6 +35,9 @@
 #include "version.h"
 #include "DropGeometry.h"
 
+// system headers
+#include <algorithm>
+
 TimeKeeper synct = TimeKeeper::getCurrent();
 std::list<PendingChatMessages> pendingChatMessages;
 
@@ -1158,6 +1161,53 @@ BZF_API  bool bz_freePlayerRecord( bz_BasePlayerRecord *playerRecord )
 
     return true;
 }
+
+static void fillPlayerStateView ( bz_PlayerStateView *view, int playerID, GameKeeper::Player *player )
+{
+    view->playerID = playerID;
+    view->team = convertTeam(player->player.getTeam());
+    view->spawned = player->player.isAlive();
+    view->lastUpdateTime = player->player.getLastMsgTime().getSeconds();
+    playerStateToAPIState(view->state, player->lastState);
+
+    view->flagID = player->player.getFlag();
+    view->flagAbbv = NULL;
+    FlagInfo* flagInfo = FlagInfo::get(view->flagID);
+    if (flagInfo && flagInfo->flag.type)
+        view->flagAbbv = flagInfo->flag.type->flagAbbv.c_str();
+    else
+        view->flagID = -1;
+}
+
+BZF_API bool bz_getPlayerStateView ( int playerID, bz_PlayerStateView *view )
+{
+    if (!view)
+        return false;
+
+    GameKeeper::Player *player = GameKeeper::Player::getPlayerByIndex(playerID);
+    if (!player)
+        return false;
+
+    fillPlayerStateView(view, playerID, player);
+    return true;
+}
+
+BZF_API int bz_getPlayerStateViews ( bz_PlayerStateView *views, int maxViews )
+{
+    if (!views)
+        return 0;
+
+    int count = 0;
+    for (int i = 0; i < curMaxPlayers && count < maxViews; i++)
+    {
+        GameKeeper::Player *player = GameKeeper::Player::getPlayerByIndex(i);
+        if (player == NULL)
+            continue;
+
+        fillPlayerStateView(&views[count++], i, player);
+    }
+    return count;
+}
 //-------------------------------------------------------------------------
 
 BZF_API bool bz_getAdmin ( int playerID )
@@ -3361,6 +3411,240 @@ BZF_API bool bz_isWithinWorldBoundaries ( float pos[3] )
     return true;
 }
 
+//-------------------------------------------------------------------------
+
+// candidates from the position grids, kept to avoid allocating per query
+static std::vector<int> gridCandidates;
+
+// flags by where they were at the first flag query of the tick
+static PositionGrid flagGrid;
+static std::vector<float> flagGridPositions;
+static bool flagGridStale = true;
+
+static void updateFlagGrid ( void )
+{
+    if (!flagGridStale)
+        return;
+    flagGridStale = false;
+
+    flagGrid.clear();
+    flagGridPositions.resize(numFlags * 3);
+    for (int i = 0; i < numFlags; i++)
+    {
+        FlagInfo *flag = FlagInfo::get(i);
+        if (!flag)
+            continue;
+
+        const float *pos = NULL;
+        if (flag->flag.status == FlagOnGround)
+            pos = flag->flag.position;
+        else if (flag->flag.status == FlagOnTank)
+        {
+            GameKeeper::Player *carrier = GameKeeper::Player::getPlayerByIndex(flag->player);
+            if (carrier)
+                pos = carrier->lastState.pos;
+        }
+        if (!pos)
+            continue;
+
+        memcpy(&flagGridPositions[i * 3], pos, sizeof(float) * 3);
+        flagGrid.set(i, pos[0], pos[1]);
+    }
+}
+
+static const float *getFlagGridPosition ( int flagID )
+{
+    return &flagGridPositions[flagID * 3];
+}
+
+static const float *getSpawnedPlayerPosition ( int playerID )
+{
+    GameKeeper::Player *player = GameKeeper::Player::getPlayerByIndex(playerID);
+    if (!player || !player->player.isAlive())
+        return NULL;
+    return player->lastState.pos;
+}
+
+// copy the sorted candidates that pass, returns how many passed
+template <class Test>
+static int filterGridCandidates ( int *ids, int maxIDs, Test test )
+{
+    std::sort(gridCandidates.begin(), gridCandidates.end());
+
+    int count = 0;
+    for (size_t i = 0; i < gridCandidates.size(); i++)
+    {
+        if (!test(gridCandidates[i]))
+            continue;
+        if (ids && count < maxIDs)
+            ids[count] = gridCandidates[i];
+        count++;
+    }
+    return count;
+}
+
+static bool pointInRadius ( const float *point, const float pos[3], float radius )
+{
+    const float dx = point[0] - pos[0];
+    const float dy = point[1] - pos[1];
+    const float dz = point[2] - pos[2];
+    return dx * dx + dy * dy + dz * dz <= radius * radius;
+}
+
+// the square around the zone that holds every point pointInZone() accepts
+static void getZoneBounds ( bz_CustomZoneObject *zone, float mins[2], float maxs[2] )
+{
+    float reach = zone->radius;
+    if (zone->box)
+        reach = sqrtf(zone->hw * zone->hw + zone->hh * zone->hh);
+
+    mins[0] = zone->cX - reach;
+    mins[1] = zone->cY - reach;
+    maxs[0] = zone->cX + reach;
+    maxs[1] = zone->cY + reach;
+}
+
+BZF_API int bz_getPlayersInRadius ( const float pos[3], float radius, int *playerIDs, int maxIDs )
+{
+    if (!pos || radius < 0.0f)
+        return 0;
+
+    const float mins[2] = { pos[0] - radius, pos[1] - radius };
+    const float maxs[2] = { pos[0] + radius, pos[1] + radius };
+    GameKeeper::Player::getPositionGrid().query(mins, maxs, gridCandidates);
+
+    return filterGridCandidates(playerIDs, maxIDs, [pos, radius](int id)
+    {
+        const float *point = getSpawnedPlayerPosition(id);
+        return point && pointInRadius(point, pos, radius);
+    });
+}
+
+BZF_API int bz_getPlayersInBox ( const float mins[3], const float maxs[3], int *playerIDs, int maxIDs )
+{
+    if (!mins || !maxs)
+        return 0;
+
+    GameKeeper::Player::getPositionGrid().query(mins, maxs, gridCandidates);
+
+    return filterGridCandidates(playerIDs, maxIDs, [mins, maxs](int id)
+    {
+        const float *point = getSpawnedPlayerPosition(id);
+        if (!point)
+            return false;
+        for (int a = 0; a < 3; a++)
+        {
+            if (point[a] < mins[a] || point[a] > maxs[a])
+                return false;
+        }
+        return true;
+    });
+}
+
+BZF_API int bz_getPlayersInZone ( bz_CustomZoneObject *zone, int *playerIDs, int maxIDs )
+{
+    if (!zone)
+        return 0;
+
+    float mins[2], maxs[2];
+    getZoneBounds(zone, mins, maxs);
+    GameKeeper::Player::getPositionGrid().query(mins, maxs, gridCandidates);
+
+    return filterGridCandidates(playerIDs, maxIDs, [zone](int id)
+    {
+        const float *point = getSpawnedPlayerPosition(id);
+        float pos[3];
+        if (!point)
+            return false;
+        memcpy(pos, point, sizeof(pos));
+        return zone->pointInZone(pos);
+    });
+}
+
+BZF_API int bz_getFlagsInRadius ( const float pos[3], float radius, int *flagIDs, int maxIDs )
+{
+    if (!pos || radius < 0.0f)
+        return 0;
+
+    updateFlagGrid();
+
+    const float mins[2] = { pos[0] - radius, pos[1] - radius };
+    const float maxs[2] = { pos[0] + radius, pos[1] + radius };
+    flagGrid.query(mins, maxs, gridCandidates);
+
+    return filterGridCandidates(flagIDs, maxIDs, [pos, radius](int id)
+    {
+        return pointInRadius(getFlagGridPosition(id), pos, radius);
+    });
+}
+
+BZF_API int bz_getFlagsInZone ( bz_CustomZoneObject *zone, int *flagIDs, int maxIDs )
+{
+    if (!zone)
+        return 0;
+
+    updateFlagGrid();
+
+    float mins[2], maxs[2];
+    getZoneBounds(zone, mins, maxs);
+    flagGrid.query(mins, maxs, gridCandidates);
+
+    return filterGridCandidates(flagIDs, maxIDs, [zone](int id)
+    {
+        float pos[3];
+        memcpy(pos, getFlagGridPosition(id), sizeof(pos));
+        return zone->pointInZone(pos);
+    });
+}
+
+BZF_API int bz_getNearestEnemy ( int playerID, float maxDistance )
+{
+    GameKeeper::Player *player = GameKeeper::Player::getPlayerByIndex(playerID);
+    if (!player)
+        return -1;
+
+    const PositionGrid &grid = GameKeeper::Player::getPositionGrid();
+    const float *pos = player->lastState.pos;
+    const TeamColor team = player->player.getTeam();
+
+    // widen the search until it holds a foe no further away than the
+    // search reaches, nothing outside the box can then be closer
+    for (float reach = grid.getCellSize(); ; reach *= 2.0f)
+    {
+        const bool last = maxDistance > 0.0f && reach >= maxDistance;
+        if (last)
+            reach = maxDistance;
+
+        const float mins[2] = { pos[0] - reach, pos[1] - reach };
+        const float maxs[2] = { pos[0] + reach, pos[1] + reach };
+        grid.query(mins, maxs, gridCandidates);
+
+        int nearest = -1;
+        float nearestDist2 = reach * reach;
+        for (size_t i = 0; i < gridCandidates.size(); i++)
+        {
+            const int id = gridCandidates[i];
+            GameKeeper::Player *other = GameKeeper::Player::getPlayerByIndex(id);
+            if (id == playerID || !other || !other->player.isAlive() ||
+                    !areFoes(team, other->player.getTeam()))
+                continue;
+
+            const float *otherPos = other->lastState.pos;
+            const float dist2 = (otherPos[0] - pos[0]) * (otherPos[0] - pos[0]) +
+                                (otherPos[1] - pos[1]) * (otherPos[1] - pos[1]) +
+                                (otherPos[2] - pos[2]) * (otherPos[2] - pos[2]);
+            if (dist2 < nearestDist2 || (dist2 == nearestDist2 && (nearest < 0 || id < nearest)))
+            {
+                nearest = id;
+                nearestDist2 = dist2;
+            }
+        }
+
+        if (nearest >= 0 || last || grid.isExhaustive(mins, maxs))
+            return nearest;
+    }
+}
+
 BZF_API bool bz_registerCustomMapObject ( const char* object, bz_CustomMapObjectHandler *handler )
 {
     if (!object || !handler)
@@ -3894,6 +4178,7 @@ static URLFetchHandler urlFetchHandler;
 void ApiTick ( void )
 {
     urlFetchHandler.Tick();
+    flagGridStale = true;
 }
 
 
@@ -50,6 +50,7 @@
 #include "FlagHistory.h"
 #include "Permissions.h"
 #include "RecordReplay.h"
+#include "ServerStats.h"
 #include "bzfs.h"
 #include "PackVars.h"   // uses directMessage() from bzfs.h
 
@@ -207,6 +208,15 @@ public:
                              GameKeeper::Player *playerData);
 };
 
+class ServerStatsCommand : ServerCommand
+{
+public:
+    ServerStatsCommand();
+
+    virtual bool operator() (const char    *commandLine,
+                             GameKeeper::Player *playerData);
+};
+
 class IdleStatCommand : ServerCommand
 {
 public:
@@ -531,6 +541,7 @@ static JitterDropCommand  jitterDropCommand;
 static PacketLossWarnCommand  packetLossWarnCommand;
 static PacketLossDropCommand  packetLossDropCommand;
 static LagStatCommand     lagStatCommand;
+static ServerStatsCommand serverStatsCommand;
 static IdleStatCommand    idleStatCommand;
 static IdleTimeCommand    idleTimeCommand;
 static HandicapCommand    handicapCommand;
@@ -606,6 +617,8 @@ PacketLossDropCommand::PacketLossDropCommand()   : ServerCommand("/packetlossdro
             "<count> - display or set the number of packetloss warnings before a player is kicked") {}
 LagStatCommand::LagStatCommand()     : ServerCommand("/lagstats",
             "- list network delays, jitter and number of lost resp. out of order packets by player") {}
+ServerStatsCommand::ServerStatsCommand() : ServerCommand("/serverstats",
+            "[reset] - show server loop, message handling and player traffic statistics") {}
 IdleStatCommand::IdleStatCommand()       : ServerCommand("/idlestats",
             "- display the idle time in seconds for each player") {}
 IdleTimeCommand::IdleTimeCommand()       : ServerCommand("/idletime",
@@ -1987,6 +2000,37 @@ bool LagStatCommand::operator() (const char  *,
 }
 
 
+bool ServerStatsCommand::operator() (const char  *message,
+                                     GameKeeper::Player *playerData)
+{
+    int t = playerData->getIndex();
+    if (!playerData->accessInfo.hasPerm(PlayerAccessInfo::info))
+    {
+        sendMessage(ServerPlayer, t, "You do not have permission to run the serverstats command");
+        return true;
+    }
+
+    std::vector<std::string> argv = TextUtils::tokenize(message, " \t", 2);
+    if (argv.size() == 2)
+    {
+        if (TextUtils::compare_nocase(argv[1], "reset") == 0)
+        {
+            serverStats.reset();
+            sendMessage(ServerPlayer, t, "Server statistics reset");
+        }
+        else
+            sendMessage(ServerPlayer, t, "Syntax: /serverstats [reset]");
+        return true;
+    }
+
+    std::vector<std::string> lines;
+    serverStats.getReport(lines);
+    for (size_t i = 0; i < lines.size(); i++)
+        sendMessage(ServerPlayer, t, lines[i].c_str());
+    return true;
+}
+
+
 bool IdleStatCommand::operator() (const char     *,
                                   GameKeeper::Player *playerData)
 {
@@ -0,0 +1,654 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/* interface header */
+#include "LoadClient.h"
+
+/* system implementation headers */
+#ifdef HAVE_CMATH
+#  include <cmath>
+#else
+#  include <math.h>
+#endif
+#include <stdio.h>
+#include <string.h>
+#include <iostream>
+
+/* common implementation headers */
+#include "Pack.h"
+#include "Protocol.h"
+#include "ShotUpdate.h"
+#include "StateDatabase.h"
+#include "TextUtils.h"
+
+/* local implementation headers */
+#include "ServerLink.h"
+
+
+//
+// LoadOptions
+//
+
+LoadOptions::LoadOptions()
+    : serverName("localhost"), serverPort(ServerPort), callsignPrefix("bzload"),
+      team(AutomaticTeam), updateRate(20.0), shotRate(0.2), chatRate(0.02),
+      grabRate(0.05)
+{
+}
+
+
+//
+// LoadWorld
+//
+
+LoadWorld::LoadWorld()
+    : startTime(TimeKeeper::getCurrent())
+{
+    for (int i = 0; i < 256; i++)
+        ours[i] = false;
+}
+
+
+float LoadWorld::getTimestamp() const
+{
+    return float(TimeKeeper::getCurrent() - startTime);
+}
+
+
+//
+// LoadClient
+//
+
+LoadClient::LoadClient(const LoadOptions& _options, LoadWorld& _world,
+                       LoadStats& _stats, int index)
+    : options(_options), world(_world), stats(_stats), link(NULL),
+      id(NoPlayer), team(RogueTeam), alive(false), flagIndex(-1), targetFlag(-1),
+      shotSalt(0), lastMove(0.0), aliveSent(0.0), nextUpdate(0.0),
+      nextShot(0.0), nextChat(0.0), nextGrab(0.0), flagDropTime(0.0)
+{
+    callsign = TextUtils::format("%s%03d", options.callsignPrefix.c_str(), index);
+    waypoint[0] = waypoint[1] = 0.0f;
+}
+
+
+LoadClient::~LoadClient()
+{
+    leave();
+}
+
+
+bool LoadClient::join()
+{
+    stats.joinAttempts++;
+    const TimeKeeper start = TimeKeeper::getCurrent();
+
+    link = new ServerLink(Address(options.serverName), options.serverPort);
+    if (link->getState() != ServerLink::Okay)
+    {
+        std::cerr << callsign << ": error connecting to server" << std::endl;
+        stats.joinFailures++;
+        delete link;
+        link = NULL;
+        return false;
+    }
+
+    link->sendEnter(TankPlayer, options.team, callsign.c_str(), "bzload", "");
+
+    std::string reason;
+    uint16_t code, rejcode;
+    if (link->getState() != ServerLink::Okay ||
+            !link->readEnter(reason, code, rejcode))
+    {
+        std::cerr << callsign << ": rejected. " << reason << std::endl;
+        stats.joinFailures++;
+        delete link;
+        link = NULL;
+        return false;
+    }
+
+    const double now = TimeKeeper::getCurrent().getSeconds();
+    stats.joinLatency.add((now - start.getSeconds()) * 1000.0);
+
+    id = link->getId();
+    world.ours[id] = true;
+
+    lastMove = now;
+    nextChat = nextEvent(now, options.chatRate);
+    nextGrab = nextEvent(now, options.grabRate);
+    sendAlive();
+    return true;
+}
+
+
+void LoadClient::leave()
+{
+    if (!link)
+        return;
+
+    if (link->getState() == ServerLink::Okay)
+        link->send(MsgExit, 0, NULL);
+    delete link;
+    link = NULL;
+
+    if (id != NoPlayer)
+        world.ours[id] = false;
+    id = NoPlayer;
+    alive = false;
+}
+
+
+bool LoadClient::isConnected() const
+{
+    return link != NULL;
+}
+
+
+int LoadClient::getSocket() const
+{
+    return link ? link->getSocket() : -1;
+}
+
+
+void LoadClient::readMessages()
+{
+    uint16_t code, len;
+    char msg[MaxPacketLen];
+
+    while (link)
+    {
+        const int result = link->read(code, len, msg, 0);
+        if (result == 0)
+            break;
+        if (result < 0)
+        {
+            std::cerr << callsign << ": lost connection to server" << std::endl;
+            stats.disconnects++;
+            leave();
+            break;
+        }
+        stats.messagesReceived++;
+        handleMessage(code, len, msg);
+    }
+}
+
+
+void LoadClient::handleMessage(uint16_t code, uint16_t len, const void* msg)
+{
+    PlayerId player;
+
+    switch (code)
+    {
+    case MsgSetVar:
+    {
+        // same as bzadmin, the variables are needed to move and shoot
+        // the way the server expects
+        uint16_t numVars;
+        uint8_t nameLen, valueLen;
+        char name[MaxPacketLen];
+        char value[MaxPacketLen];
+
+        msg = nboUnpackUShort(msg, numVars);
+        for (int i = 0; i < numVars; i++)
+        {
+            msg = nboUnpackUByte(msg, nameLen);
+            msg = nboUnpackString(msg, name, nameLen);
+            name[nameLen] = '\0';
+
+            msg = nboUnpackUByte(msg, valueLen);
+            msg = nboUnpackString(msg, value, valueLen);
+            value[valueLen] = '\0';
+
+            BZDB.set(name, value);
+            BZDB.setPersistent(name, false);
+            BZDB.setPermission(name, StateDatabase::Locked);
+        }
+        break;
+    }
+
+    case MsgAddPlayer:
+    {
+        uint16_t type, playerTeam;
+        msg = nboUnpackUByte(msg, player);
+        msg = nboUnpackUShort(msg, type);
+        msg = nboUnpackUShort(msg, playerTeam);
+        if (player == id)
+            team = TeamColor(playerTeam);
+        break;
+    }
+
+    case MsgAlive:
+    {
+        msg = nboUnpackUByte(msg, player);
+        if (player != id)
+            break;
+        msg = nboUnpackVector(msg, state.pos);
+        msg = nboUnpackFloat(msg, state.azimuth);
+        state.status = PlayerState::Alive;
+        state.velocity[0] = state.velocity[1] = state.velocity[2] = 0.0f;
+        state.angVel = 0.0f;
+
+        const double now = TimeKeeper::getCurrent().getSeconds();
+        stats.spawnLatency.add((now - aliveSent) * 1000.0);
+        alive = true;
+        lastMove = now;
+        nextUpdate = now;
+        nextShot = nextEvent(now, options.shotRate);
+        pickWaypoint();
+        break;
+    }
+
+    case MsgKilled:
+    {
+        PlayerId killer;
+        msg = nboUnpackUByte(msg, player);
+        msg = nboUnpackUByte(msg, killer);
+        if (player != id)
+            break;
+        alive = false;
+        state.status = PlayerState::DeadStatus;
+        sendAlive();
+        break;
+    }
+
+    case MsgRemovePlayer:
+    {
+        msg = nboUnpackUByte(msg, player);
+        if (player != id)
+            break;
+        std::cerr << callsign << ": removed by the server" << std::endl;
+        stats.disconnects++;
+        leave();
+        break;
+    }
+
+    case MsgSuperKill:
+        std::cerr << callsign << ": disconnected by the server" << std::endl;
+        stats.disconnects++;
+        leave();
+        break;
+
+    case MsgLagPing:
+        link->send(MsgLagPing, 2, msg);
+        break;
+
+    case MsgPlayerUpdate:
+    case MsgPlayerUpdateSmall:
+    {
+        // timestamps of other bzload players share our clock
+        float timestamp;
+        msg = nboUnpackFloat(msg, timestamp);
+        msg = nboUnpackUByte(msg, player);
+        if (player != id && world.ours[player])
+            stats.updateLatency.add((world.getTimestamp() - timestamp) * 1000.0);
+        break;
+    }
+
+    case MsgFlagUpdate:
+    {
+        uint16_t count, index;
+        uint32_t offset = 2;
+        msg = nboUnpackUShort(msg, count);
+        for (int i = 0; i < count && offset + 2 + FlagPLen <= len; i++)
+        {
+            msg = nboUnpackUShort(msg, index);
+            if (index >= world.flags.size())
+                world.flags.resize(index + 1);
+            msg = world.flags[index].unpack(msg);
+            offset += 2 + FlagPLen;
+        }
+        break;
+    }
+
+    case MsgGrabFlag:
+    case MsgDropFlag:
+    {
+        uint16_t index;
+        msg = nboUnpackUByte(msg, player);
+        msg = nboUnpackUShort(msg, index);
+        if (index >= world.flags.size())
+            world.flags.resize(index + 1);
+        msg = world.flags[index].unpack(msg);
+        if (player != id)
+            break;
+
+        if (code == MsgGrabFlag)
+        {
+            stats.grabsGranted++;
+            flagIndex = index;
+            // carry it around for a while, then let somebody else have it
+            flagDropTime = TimeKeeper::getCurrent().getSeconds() + 5.0 + 10.0 * bzfrand();
+        }
+        else
+            flagIndex = -1;
+        break;
+    }
+
+    case MsgMessage:
+    {
+        PlayerId dst;
+        uint8_t type;
+        msg = nboUnpackUByte(msg, player);
+        msg = nboUnpackUByte(msg, dst);
+        msg = nboUnpackUByte(msg, type);
+        if (player == ServerPlayer && dst == id)
+        {
+            char text[MessageLen];
+            const int textLen = len - 3 < MessageLen ? len - 3 : MessageLen - 1;
+            if (textLen <= 0)
+                break;
+            memcpy(text, msg, textLen);
+            text[textLen] = '\0';
+            handleServerMessage(text);
+        }
+        break;
+    }
+    }
+}
+
+
+void LoadClient::handleServerMessage(const char* text)
+{
+    // lines of /lagstats look like "callsign    :  12 +- 3ms", admins
+    // get the player index in front
+    if (text[0] == '[')
+    {
+        text = strchr(text, ']');
+        if (!text)
+            return;
+        text++;
+        while (*text == ' ')
+            text++;
+    }
+    if (strncmp(text, options.callsignPrefix.c_str(), options.callsignPrefix.size()) != 0)
+        return;
+
+    const char* colon = strchr(text, ':');
+    int lag;
+    if (colon && sscanf(colon + 1, "%d", &lag) == 1)
+        stats.serverLag.add(double(lag));
+}
+
+
+void LoadClient::update(double now)
+{
+    if (!link)
+        return;
+
+    if (!alive)
+    {
+        // the server may hold back the spawn, ask again now and then
+        if (now - aliveSent > 5.0)
+            sendAlive();
+    }
+    else
+    {
+        move(float(now - lastMove));
+
+        if (options.updateRate > 0.0 && now >= nextUpdate)
+        {
+            sendUpdate();
+            nextUpdate += 1.0 / options.updateRate;
+            if (nextUpdate < now)
+                nextUpdate = now + 1.0 / options.updateRate;
+        }
+
+        if (now >= nextShot)
+        {
+            sendShot();
+            // one shot at a time, reusing the same slot
+            const double reload = getVar(StateDatabase::BZDB_RELOADTIME, 3.5f) * 1.05;
+            nextShot = nextEvent(now, options.shotRate);
+            if (nextShot < now + reload)
+                nextShot = now + reload;
+        }
+
+        tryGrabFlag(now);
+    }
+    lastMove = now;
+
+    if (link && now >= nextChat)
+    {
+        sendChat();
+        nextChat = nextEvent(now, options.chatRate);
+    }
+}
+
+
+void LoadClient::requestLagStats()
+{
+    if (link)
+        sendMessage(AllPlayers, "/lagstats");
+}
+
+
+void LoadClient::sendAlive()
+{
+    aliveSent = TimeKeeper::getCurrent().getSeconds();
+    link->send(MsgAlive, 0, NULL);
+}
+
+
+void LoadClient::sendUpdate()
+{
+    char msg[MaxPacketLen];
+    void* buf = msg;
+    uint16_t code;
+    buf = nboPackFloat(buf, world.getTimestamp());
+    buf = nboPackUByte(buf, id);
+    buf = state.pack(buf, code);
+    link->send(code, uint16_t((char*)buf - msg), msg);
+    stats.updatesSent++;
+}
+
+
+void LoadClient::sendShot()
+{
+    const float muzzleFront = getVar(StateDatabase::BZDB_MUZZLEFRONT, 4.42f);
+    const float muzzleHeight = getVar(StateDatabase::BZDB_MUZZLEHEIGHT, 1.57f);
+    const float shotSpeed = getVar(StateDatabase::BZDB_SHOTSPEED, 100.0f);
+    const float dir[2] = { cosf(state.azimuth), sinf(state.azimuth) };
+
+    // the server compares the muzzle with the last reported position
+    sendUpdate();
+
+    FiringInfo info;
+    info.timeSent = world.getTimestamp();
+    info.shot.player = id;
+    info.shot.id = uint16_t((shotSalt++ & 0xff) << 8);
+    info.shot.pos[0] = state.pos[0] + muzzleFront * dir[0];
+    info.shot.pos[1] = state.pos[1] + muzzleFront * dir[1];
+    info.shot.pos[2] = state.pos[2] + muzzleHeight;
+    info.shot.vel[0] = state.velocity[0] + shotSpeed * dir[0];
+    info.shot.vel[1] = state.velocity[1] + shotSpeed * dir[1];
+    info.shot.vel[2] = 0.0f;
+    info.shot.dt = 0.0f;
+    info.shot.team = team;
+    info.flagType = Flags::Null;
+    if (flagIndex >= 0 && flagIndex < int(world.flags.size()) && world.flags[flagIndex].type)
+        info.flagType = world.flags[flagIndex].type;
+    info.lifetime = getVar(StateDatabase::BZDB_RELOADTIME, 3.5f);
+
+    char msg[FiringInfoPLen];
+    info.pack(msg);
+    link->send(MsgShotBegin, sizeof(msg), msg);
+    stats.shotsSent++;
+}
+
+
+void LoadClient::sendChat()
+{
+    static const char* lines[] =
+    {
+        "gg", "nice shot", "anyone want to cap?", "lag check", "brb", "ouch"
+    };
+    const int line = int(bzfrand() * (sizeof(lines) / sizeof(lines[0])));
+    sendMessage(AllPlayers, lines[line]);
+    stats.chatsSent++;
+}
+
+
+void LoadClient::sendMessage(PlayerId target, const std::string& text)
+{
+    char buffer[MessageLen];
+    char msg[1 + MessageLen];
+    strncpy(buffer, text.c_str(), MessageLen - 1);
+    buffer[MessageLen - 1] = '\0';
+    nboPackUByte(msg, target);
+    nboPackString(msg + 1, buffer, MessageLen);
+    link->send(MsgMessage, sizeof(msg), msg);
+}
+
+
+void LoadClient::tryGrabFlag(double now)
+{
+    if (flagIndex >= 0)
+    {
+        if (now >= flagDropTime)
+        {
+            char msg[12];
+            nboPackVector(msg, state.pos);
+            link->send(MsgDropFlag, sizeof(msg), msg);
+            stats.dropsSent++;
+            // sticky flags stay, try again later
+            flagDropTime = now + 10.0;
+        }
+        return;
+    }
+
+    if (targetFlag >= 0)
+    {
+        const Flag& flag = world.flags[targetFlag];
+        if (flag.status != FlagOnGround)
+        {
+            targetFlag = -1;
+            pickWaypoint();
+            return;
+        }
+        const float reach = getVar(StateDatabase::BZDB_TANKRADIUS, 4.32f)
+                            + getVar(StateDatabase::BZDB_FLAGRADIUS, 2.5f);
+        const float dx = flag.position[0] - state.pos[0];
+        const float dy = flag.position[1] - state.pos[1];
+        if (dx * dx + dy * dy <= reach * reach)
+        {
+            char msg[2];
+            nboPackUShort(msg, uint16_t(targetFlag));
+            link->send(MsgGrabFlag, sizeof(msg), msg);
+            stats.grabsSent++;
+            targetFlag = -1;
+            nextGrab = nextEvent(now, options.grabRate);
+            pickWaypoint();
+        }
+        return;
+    }
+
+    if (now < nextGrab)
+        return;
+
+    // head for the closest flag lying around
+    float best = 0.0f;
+    for (size_t i = 0; i < world.flags.size(); i++)
+    {
+        const Flag& flag = world.flags[i];
+        if (flag.status != FlagOnGround)
+            continue;
+        const float dx = flag.position[0] - state.pos[0];
+        const float dy = flag.position[1] - state.pos[1];
+        const float dist = dx * dx + dy * dy;
+        if (targetFlag < 0 || dist < best)
+        {
+            targetFlag = int(i);
+            best = dist;
+        }
+    }
+    if (targetFlag >= 0)
+    {
+        waypoint[0] = world.flags[targetFlag].position[0];
+        waypoint[1] = world.flags[targetFlag].position[1];
+    }
+    else
+        nextGrab = nextEvent(now, options.grabRate);
+}
+
+
+void LoadClient::pickWaypoint()
+{
+    const float range = 0.4f * getVar(StateDatabase::BZDB_WORLDSIZE, 800.0f);
+    waypoint[0] = range * float(2.0 * bzfrand() - 1.0);
+    waypoint[1] = range * float(2.0 * bzfrand() - 1.0);
+}
+
+
+void LoadClient::move(float dt)
+{
+    if (dt <= 0.0f)
+        return;
+    if (dt > 0.1f)
+        dt = 0.1f;
+
+    const float dx = waypoint[0] - state.pos[0];
+    const float dy = waypoint[1] - state.pos[1];
+    if (targetFlag < 0 && dx * dx + dy * dy < 25.0f)
+        pickWaypoint();
+
+    // turn towards the waypoint, then drive a bit below top speed so
+    // the server speed checks never trigger
+    const float maxAngVel = getVar(StateDatabase::BZDB_TANKANGVEL, float(M_PI / 4.0));
+    float turn = atan2f(dy, dx) - state.azimuth;
+    while (turn > float(M_PI))
+        turn -= float(2.0 * M_PI);
+    while (turn < -float(M_PI))
+        turn += float(2.0 * M_PI);
+    if (turn > maxAngVel * dt)
+        state.angVel = maxAngVel;
+    else if (turn < -maxAngVel * dt)
+        state.angVel = -maxAngVel;
+    else
+        state.angVel = turn / dt;
+    state.azimuth += state.angVel * dt;
+    if (state.azimuth > float(M_PI))
+        state.azimuth -= float(2.0 * M_PI);
+    else if (state.azimuth < -float(M_PI))
+        state.azimuth += float(2.0 * M_PI);
+
+    const float speed = 0.8f * getVar(StateDatabase::BZDB_TANKSPEED, 25.0f)
+                        * (fabsf(turn) < float(M_PI / 2.0) ? 1.0f : 0.25f);
+    state.velocity[0] = speed * cosf(state.azimuth);
+    state.velocity[1] = speed * sinf(state.azimuth);
+    state.velocity[2] = 0.0f;
+    state.pos[0] += state.velocity[0] * dt;
+    state.pos[1] += state.velocity[1] * dt;
+}
+
+
+double LoadClient::nextEvent(double now, double rate)
+{
+    // exponential gaps, so the players do not fall into lock step
+    if (rate <= 0.0)
+        return 1.0e30;
+    return now - log(1.0 - bzfrand()) / rate;
+}
+
+
+float LoadClient::getVar(const std::string& name, float fallback)
+{
+    if (!BZDB.isSet(name))
+        return fallback;
+    return BZDB.eval(name);
+}
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
@@ -0,0 +1,151 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef LOADCLIENT_H
+#define LOADCLIENT_H
+
+#include "common.h"
+
+/* system interface headers */
+#include <string>
+#include <vector>
+
+/* common interface headers */
+#include "global.h"
+#include "Flag.h"
+#include "PlayerState.h"
+#include "TimeKeeper.h"
+
+/* local interface headers */
+#include "LoadStats.h"
+
+class ServerLink;
+
+
+/** Command line settings shared by all synthetic players */
+struct LoadOptions
+{
+    LoadOptions();
+
+    std::string serverName;
+    int         serverPort;
+    std::string callsignPrefix;
+    TeamColor   team;
+
+    /** rates are per player and per second */
+    double      updateRate;
+    double      shotRate;
+    double      chatRate;
+    double      grabRate;
+};
+
+
+/** What the players learn about the game, shared so a flag or a
+    relayed update is understood the same way by all of them.
+*/
+struct LoadWorld
+{
+    LoadWorld();
+
+    /** seconds since start, used as the update timestamp so the relay
+        latency can be measured by any other bzload player */
+    float       getTimestamp() const;
+
+    TimeKeeper  startTime;
+    bool        ours[256];
+    std::vector<Flag> flags;
+};
+
+
+/** One synthetic player.  It joins like bzadmin does, spawns, then
+    wanders around the map sending player updates, shots, flag grabs
+    and chat at the configured rates.  There is no world geometry, the
+    tank just drives on the ground plane between random waypoints.
+*/
+class LoadClient
+{
+public:
+    LoadClient(const LoadOptions& options, LoadWorld& world,
+               LoadStats& stats, int index);
+    ~LoadClient();
+
+    /** connect and send MsgEnter, blocks until the server answered */
+    bool        join();
+    void        leave();
+
+    bool        isConnected() const;
+    int         getSocket() const;
+    const std::string& getCallsign() const
+    {
+        return callsign;
+    }
+
+    /** handle everything the server sent so far */
+    void        readMessages();
+    /** move the tank and send whatever is due */
+    void        update(double now);
+    /** ask the server for its lag statistics, the replies are parsed
+        for all bzload players */
+    void        requestLagStats();
+
+private:
+    LoadClient(const LoadClient&);
+    LoadClient& operator=(const LoadClient&);
+
+    void        handleMessage(uint16_t code, uint16_t len, const void* msg);
+    void        handleServerMessage(const char* text);
+    void        sendAlive();
+    void        sendUpdate();
+    void        sendShot();
+    void        sendChat();
+    void        sendMessage(PlayerId target, const std::string& text);
+    void        tryGrabFlag(double now);
+    void        pickWaypoint();
+    void        move(float dt);
+
+    static double nextEvent(double now, double rate);
+    static float getVar(const std::string& name, float fallback);
+
+    const LoadOptions& options;
+    LoadWorld&  world;
+    LoadStats&  stats;
+
+    std::string callsign;
+    ServerLink* link;
+    PlayerId    id;
+    TeamColor   team;
+
+    PlayerState state;
+    bool        alive;
+    float       waypoint[2];
+    int         flagIndex;
+    int         targetFlag;
+    int         shotSalt;
+
+    double      lastMove;
+    double      aliveSent;
+    double      nextUpdate;
+    double      nextShot;
+    double      nextChat;
+    double      nextGrab;
+    double      flagDropTime;
+};
+
+#endif // LOADCLIENT_H
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
@@ -0,0 +1,155 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/* interface header */
+#include "LoadStats.h"
+
+/* system implementation headers */
+#include <stdio.h>
+
+/* common implementation headers */
+#include "TextUtils.h"
+
+
+//
+// LatencyHistogram
+//
+
+LatencyHistogram::LatencyHistogram()
+    : bins(maxMs * binsPerMs, 0), overflow(0), count(0),
+      sum(0.0), min(0.0), max(0.0)
+{
+}
+
+
+void LatencyHistogram::add(double ms)
+{
+    if (ms < 0.0)
+        ms = 0.0;
+
+    if (count == 0 || ms < min)
+        min = ms;
+    if (count == 0 || ms > max)
+        max = ms;
+    count++;
+    sum += ms;
+
+    const size_t bin = size_t(ms * binsPerMs);
+    if (bin < bins.size())
+        bins[bin]++;
+    else
+        overflow++;
+}
+
+
+double LatencyHistogram::getMin() const
+{
+    return min;
+}
+
+
+double LatencyHistogram::getMax() const
+{
+    return max;
+}
+
+
+double LatencyHistogram::getMean() const
+{
+    if (count == 0)
+        return 0.0;
+    return sum / double(count);
+}
+
+
+double LatencyHistogram::getPercentile(double fraction) const
+{
+    if (count == 0)
+        return 0.0;
+
+    uint64_t wanted = uint64_t(fraction * double(count) + 0.5);
+    if (wanted < 1)
+        wanted = 1;
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < bins.size(); i++)
+    {
+        seen += bins[i];
+        if (seen >= wanted)
+        {
+            const double edge = double(i + 1) / binsPerMs;
+            return edge < max ? edge : max;
+        }
+    }
+    return max;
+}
+
+
+void LatencyHistogram::print(std::ostream& out, const std::string& name) const
+{
+    if (count == 0)
+    {
+        out << TextUtils::format("  %-16s no samples", name.c_str()) << std::endl;
+        return;
+    }
+    out << TextUtils::format("  %-16s n=%-9llu min %7.1f  avg %7.1f  p50 %7.1f  "
+                             "p95 %7.1f  p99 %7.1f  max %7.1f ms",
+                             name.c_str(), (unsigned long long)count,
+                             getMin(), getMean(), getPercentile(0.50),
+                             getPercentile(0.95), getPercentile(0.99), getMax())
+        << std::endl;
+}
+
+
+//
+// LoadStats
+//
+
+LoadStats::LoadStats()
+    : joinAttempts(0), joinFailures(0), disconnects(0),
+      updatesSent(0), shotsSent(0), grabsSent(0), grabsGranted(0),
+      dropsSent(0), chatsSent(0), messagesReceived(0)
+{
+}
+
+
+void LoadStats::print(std::ostream& out, double elapsed) const
+{
+    if (elapsed <= 0.0)
+        elapsed = 1.0;
+
+    out << TextUtils::format("bzload: %.1f s, %u joins, %u failed, %u disconnected",
+                             elapsed, joinAttempts, joinFailures, disconnects)
+        << std::endl;
+    out << TextUtils::format("  sent %.0f updates/s, %.1f shots/s, %.1f grabs/s "
+                             "(%llu granted), %.1f chats/s",
+                             double(updatesSent) / elapsed, double(shotsSent) / elapsed,
+                             double(grabsSent) / elapsed, (unsigned long long)grabsGranted,
+                             double(chatsSent) / elapsed)
+        << std::endl;
+    out << TextUtils::format("  received %.0f messages/s",
+                             double(messagesReceived) / elapsed)
+        << std::endl;
+
+    joinLatency.print(out, "join");
+    spawnLatency.print(out, "spawn");
+    updateLatency.print(out, "update relay");
+    serverLag.print(out, "server lag");
+}
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
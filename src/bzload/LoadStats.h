@@ -0,0 +1,100 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef LOADSTATS_H
+#define LOADSTATS_H
+
+#include "common.h"
+
+/* system interface headers */
+#include <stdint.h>
+#include <ostream>
+#include <string>
+#include <vector>
+
+
+/** Fixed resolution latency histogram.  Samples are in milliseconds and
+    are binned in 0.1 ms steps up to two seconds, anything slower only
+    counts towards the overflow bin and the maximum.  Adding a sample is
+    constant time, so it can be fed from every relayed update.
+*/
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    void        add(double ms);
+
+    uint64_t    getCount() const
+    {
+        return count;
+    }
+    double      getMin() const;
+    double      getMax() const;
+    double      getMean() const;
+    /** upper edge of the bin holding the given fraction of samples */
+    double      getPercentile(double fraction) const;
+
+    void        print(std::ostream& out, const std::string& name) const;
+
+private:
+    static const int binsPerMs = 10;
+    static const int maxMs = 2000;
+
+    std::vector<uint32_t> bins;
+    uint64_t    overflow;
+    uint64_t    count;
+    double      sum;
+    double      min;
+    double      max;
+};
+
+
+/** Everything bzload measures while the synthetic players are connected */
+class LoadStats
+{
+public:
+    LoadStats();
+
+    /** connect until MsgAccept */
+    LatencyHistogram joinLatency;
+    /** MsgAlive sent until the server announced the spawn */
+    LatencyHistogram spawnLatency;
+    /** MsgPlayerUpdate sent until another bzload player got the relay */
+    LatencyHistogram updateLatency;
+    /** lag the server measured with its own pings, from /lagstats */
+    LatencyHistogram serverLag;
+
+    unsigned int joinAttempts;
+    unsigned int joinFailures;
+    unsigned int disconnects;
+
+    uint64_t    updatesSent;
+    uint64_t    shotsSent;
+    uint64_t    grabsSent;
+    uint64_t    grabsGranted;
+    uint64_t    dropsSent;
+    uint64_t    chatsSent;
+    uint64_t    messagesReceived;
+
+    void        print(std::ostream& out, double elapsed) const;
+};
+
+#endif // LOADSTATS_H
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
@@ -0,0 +1,279 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#include "common.h"
+
+/* system headers */
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#if !defined(_WIN32)
+#include <sys/time.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+/* common headers */
+#include "Flag.h"
+#include "TimeKeeper.h"
+#include "bzsignal.h"
+#include "network.h"
+
+/* local headers */
+#include "LoadClient.h"
+#include "LoadStats.h"
+#include "OptionParser.h"
+
+
+// causes persistent rebuilding to obtain build versioning
+#include "version.h"
+
+int debugLevel = 0;
+
+/** @file
+    This is the main file for bzload, a headless client that connects a
+    crowd of synthetic players to a server and reports how it copes.
+*/
+
+
+static volatile bool done = false;
+
+static void     stopLoad(int)
+{
+    done = true;
+}
+
+
+int main(int argc, char** argv)
+{
+
+#ifdef _WIN32
+    // startup winsock
+    {
+        static const int major = 2, minor = 2;
+        WSADATA wsaData;
+        if (WSAStartup(MAKEWORD(major, minor), &wsaData))
+        {
+            std::cerr << "Could not initialise WinSock.";
+            return 1;
+        }
+        if (LOBYTE(wsaData.wVersion) != major || HIBYTE(wsaData.wVersion) != minor)
+        {
+            std::cerr << "Invalid WinSock version (got " << (int) LOBYTE(wsaData.wVersion) <<
+                      '.' << (int) HIBYTE(wsaData.wVersion) << ", expected" << major << '.' << minor << ')';
+            WSACleanup();
+            return 1;
+        }
+    }
+#endif
+
+    // command line options
+    LoadOptions options;
+    int numPlayers = 50;
+    double joinRate = 10.0;
+    double duration = 60.0;
+    double lagStatsInterval = 5.0;
+    double reportInterval = 10.0;
+    double maxJoinMs = 0.0;
+    double maxLagMs = 0.0;
+    int seed = 0;
+
+    OptionParser op(std::string("bzload ") + getAppVersion(), "HOST[:PORT]");
+    op.registerVariable("players", numPlayers, "[-players <count>]",
+                        "number of synthetic players to connect");
+    op.registerVariable("joinrate", joinRate, "[-joinrate <joins/s>]",
+                        "how fast the players join");
+    op.registerVariable("duration", duration, "[-duration <seconds>]",
+                        "how long to play once everybody joined");
+    op.registerVariable("prefix", options.callsignPrefix, "[-prefix <callsign>]",
+                        "callsign prefix, a number is appended");
+    op.registerVariable("updaterate", options.updateRate, "[-updaterate <updates/s>]",
+                        "player updates per player and second");
+    op.registerVariable("shotrate", options.shotRate, "[-shotrate <shots/s>]",
+                        "shots per player and second, limited by the reload time");
+    op.registerVariable("chatrate", options.chatRate, "[-chatrate <messages/s>]",
+                        "chat messages per player and second");
+    op.registerVariable("grabrate", options.grabRate, "[-grabrate <grabs/s>]",
+                        "how often a player goes for a flag");
+    op.registerVariable("lagstats", lagStatsInterval, "[-lagstats <seconds>]",
+                        "how often to query the lag measured by the server, 0 to disable");
+    op.registerVariable("report", reportInterval, "[-report <seconds>]",
+                        "interval of the progress reports, 0 to disable");
+    op.registerVariable("maxjoin", maxJoinMs, "[-maxjoin <ms>]",
+                        "fail if the 95th percentile join latency is above this");
+    op.registerVariable("maxlag", maxLagMs, "[-maxlag <ms>]",
+                        "fail if the 95th percentile update relay latency is above this");
+    op.registerVariable("seed", seed, "[-seed <number>]",
+                        "random seed, for repeatable runs");
+    if (!op.parse(argc, argv))
+        return 1;
+
+    if (op.getParameters().size() != 1 || numPlayers <= 0 || joinRate <= 0.0)
+    {
+        op.printUsage(std::cerr, argv[0]);
+        return 1;
+    }
+    if (numPlayers >= FD_SETSIZE - 16)
+    {
+        std::cerr << "Too many players, at most " << FD_SETSIZE - 17 << " are supported." << std::endl;
+        return 1;
+    }
+
+    // host[:port]
+    options.serverName = op.getParameters()[0];
+    const std::string::size_type cPos = options.serverName.find(':');
+    if (cPos != std::string::npos)
+    {
+        long int serverPort = strtol(options.serverName.substr(cPos + 1).c_str(), (char **)NULL, 10);
+        if (serverPort > 0 && serverPort < 65536)
+            options.serverPort = (int) serverPort;
+        options.serverName = options.serverName.substr(0, cPos);
+    }
+
+    srand(seed);
+    Flags::init();
+
+    bzSignal(SIGINT, SIG_PF(stopLoad));
+    bzSignal(SIGTERM, SIG_PF(stopLoad));
+
+    std::cerr << "Connecting " << numPlayers << " players to " <<
+              options.serverName << ":" << options.serverPort << std::endl;
+
+    LoadWorld world;
+    LoadStats stats;
+    std::vector<LoadClient*> clients;
+
+    const double start = TimeKeeper::getCurrent().getSeconds();
+    double nextJoin = start;
+    double endTime = 0.0;
+    double nextLagStats = start + lagStatsInterval;
+    double nextReport = start + reportInterval;
+
+    while (!done)
+    {
+        double now = TimeKeeper::getCurrent().getSeconds();
+
+        // joining blocks until the server answered, so a slow server
+        // also slows down the join rate
+        if (int(clients.size()) < numPlayers && now >= nextJoin)
+        {
+            LoadClient* client = new LoadClient(options, world, stats, int(clients.size()));
+            client->join();
+            clients.push_back(client);
+            nextJoin += 1.0 / joinRate;
+            if (int(clients.size()) == numPlayers)
+                endTime = now + duration;
+            continue;
+        }
+        if (endTime > 0.0 && now >= endTime)
+            break;
+
+        // wait for the server, but not past the next update
+        fd_set read_set;
+        FD_ZERO(&read_set);
+        int fdMax = -1;
+        int connected = 0;
+        for (size_t i = 0; i < clients.size(); i++)
+        {
+            const int fd = clients[i]->getSocket();
+            if (fd < 0)
+                continue;
+            FD_SET((unsigned int)fd, &read_set);
+            if (fd > fdMax)
+                fdMax = fd;
+            connected++;
+        }
+        if (connected == 0 && int(clients.size()) == numPlayers)
+        {
+            std::cerr << "No players left." << std::endl;
+            break;
+        }
+
+        struct timeval timeout;
+        timeout.tv_sec = 0;
+        timeout.tv_usec = 2000;
+        const int nfound = fdMax >= 0 ? select(fdMax + 1, &read_set, NULL, NULL, &timeout) : 0;
+        if (fdMax < 0)
+            TimeKeeper::sleep(0.002);
+
+        for (size_t i = 0; nfound > 0 && i < clients.size(); i++)
+        {
+            const int fd = clients[i]->getSocket();
+            if (fd >= 0 && FD_ISSET(fd, &read_set))
+                clients[i]->readMessages();
+        }
+
+        now = TimeKeeper::getCurrent().getSeconds();
+        for (size_t i = 0; i < clients.size(); i++)
+            clients[i]->update(now);
+
+        if (lagStatsInterval > 0.0 && now >= nextLagStats)
+        {
+            for (size_t i = 0; i < clients.size(); i++)
+            {
+                if (clients[i]->isConnected())
+                {
+                    clients[i]->requestLagStats();
+                    break;
+                }
+            }
+            nextLagStats = now + lagStatsInterval;
+        }
+
+        if (reportInterval > 0.0 && now >= nextReport)
+        {
+            std::cerr << "bzload: " << connected << " connected, update relay p95 " <<
+                      stats.updateLatency.getPercentile(0.95) << " ms, server lag p95 " <<
+                      stats.serverLag.getPercentile(0.95) << " ms" << std::endl;
+            nextReport = now + reportInterval;
+        }
+    }
+
+    const double elapsed = TimeKeeper::getCurrent().getSeconds() - start;
+    for (size_t i = 0; i < clients.size(); i++)
+        delete clients[i];
+    clients.clear();
+
+    stats.print(std::cout, elapsed);
+
+    // non zero exit status so a regression run notices
+    int result = 0;
+    if (stats.joinFailures > 0 || stats.disconnects > 0)
+        result = 2;
+    if (maxJoinMs > 0.0 && stats.joinLatency.getPercentile(0.95) > maxJoinMs)
+    {
+        std::cout << "join latency above " << maxJoinMs << " ms" << std::endl;
+        result = 2;
+    }
+    if (maxLagMs > 0.0 && stats.updateLatency.getPercentile(0.95) > maxLagMs)
+    {
+        std::cout << "update relay latency above " << maxLagMs << " ms" << std::endl;
+        result = 2;
+    }
+
+#ifdef _WIN32
+    WSACleanup();
+#endif
+
+    return result;
+}
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
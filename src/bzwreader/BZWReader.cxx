@@ -14,9 +14,7 @@
 #include "BZWReader.h"
 
 // implementation-specific system headers
-#include <fstream>
-#include <sstream>
-#include <ctype.h>
+#include <utility>
 
 // implementation-specific bzflag headers
 #include "BZDBCache.h"
@@ -49,6 +47,7 @@
 #include "ObstacleMgr.h"
 #include "BaseBuilding.h"
 #include "TextUtils.h"
+#include "StreamParse.h"
 #include "StateDatabase.h"
 
 
@@ -71,11 +70,16 @@ BZWReader::BZWReader(std::string filename) :
     {
         setURL(location);
         performWait();
-        input = new std::istringstream(httpData);
+        input = new MemoryStream(std::move(httpData));
     }
     else
 #endif
-        input = new std::ifstream(filename.c_str(), std::ios::in);
+    {
+        // read the whole file at once, the parser then scans it in place
+        std::string data;
+        StreamParse::readFile(filename, data);
+        input = new MemoryStream(std::move(data));
+    }
 
     // .BZW is the official worldfile extension, warn for others
     if ((filename.length() < 4) ||
@@ -105,7 +109,7 @@ BZWReader::BZWReader(std::string filename, const std::string& filedata) :
                                   "world file extension is not .bzw, trying to load anyway"), 0);
     }
 
-    input = new std::istringstream(filedata);
+    input = new MemoryStream(filedata);
 
     if (input->peek() == EOF)
         errorHandler->fatalError(std::string("could not find bzflag world file"), 0);
@@ -129,27 +133,7 @@ void BZWReader::finalization(char *data, unsigned int length, bool good)
 
 void BZWReader::readToken(char *buffer, int n)
 {
-    int c = -1;
-
-    // skip whitespace
-    while (input->good() && (c = input->get()) != -1 && isspace(c) && c != '\n')
-        ;
-
-    // read up to whitespace or n - 1 characters into buffer
-    int i = 0;
-    if (c != -1 && c != '\n')
-    {
-        buffer[i++] = c;
-        while (input->good() && i < n - 1 && (c = input->get()) != -1 && !isspace(c))
-            buffer[i++] = (char)c;
-    }
-
-    // terminate string
-    buffer[i] = 0;
-
-    // put back last character we didn't use
-    if (c != -1 && isspace(c))
-        input->putback(c);
+    StreamParse::readToken(*input, buffer, n);
 }
 
 
@@ -472,9 +456,7 @@ bool BZWReader::readWorldStream(std::vector<WorldFileObject*>& wlist,
         }
 
         // discard remainder of line
-        while (input->good() && input->peek() != '\n')
-            input->get(buffer, sizeof(buffer));
-        input->getline(buffer, sizeof(buffer));
+        StreamParse::skipLine(*input);
         ++line;
     }
 
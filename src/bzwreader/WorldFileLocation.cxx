@@ -19,6 +19,7 @@
 #include "WorldFileObject.h"
 #include "WorldFileLocation.h"
 #include "MeshTransform.h"
+#include "StreamParse.h"
 
 WorldFileLocation::WorldFileLocation()
 {
@@ -36,18 +37,18 @@ bool WorldFileLocation::read(const char *cmd, std::istream& input)
     if ((strcasecmp(cmd, "pos") == 0) ||
             (strcasecmp(cmd, "position") == 0))
     {
-        if (!(input >> pos[0] >> pos[1] >> pos[2]))
+        if (!StreamParse::readFloats(input, pos, 3))
             return false;
     }
     else if (strcasecmp(cmd, "size") == 0)
     {
-        if (!(input >> size[0] >> size[1] >> size[2]))
+        if (!StreamParse::readFloats(input, size, 3))
             return false;
     }
     else if ((strcasecmp(cmd, "rot") == 0) ||
              (strcasecmp(cmd, "rotation") == 0))
     {
-        if (!(input >> rotation))
+        if (!StreamParse::readFloat(input, rotation))
             return false;
         // convert to radians
         rotation = (float)(rotation * (M_PI / 180.0));
@@ -238,6 +238,7 @@ void DefaultCompleter::setDefaults()
     registerWord("/sendhelp ");
     registerWord("/serverdebug");
     registerWord("/serverquery");
+    registerWord("/serverstats");
     registerWord("/set");
     registerWord("/setgroup ");
     registerWord("/showgroup ");
@@ -0,0 +1,650 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+// interface header
+#include "PixelConvert.h"
+
+// system headers
+#include <atomic>
+#include <string.h>
+
+/* On x86 every version is built, each function with its own target
+ * attribute, and the CPU is asked which ones it can run.  NEON is part
+ * of every ARM target that defines it, so it is picked at compile time.
+ */
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#  define PIXELCONVERT_X86 1
+#  include <immintrin.h>
+#  if defined(_MSC_VER) && !defined(__clang__)
+#    include <intrin.h>
+#    define PIXELCONVERT_TARGET(isa)
+#  else
+#    define PIXELCONVERT_TARGET(isa) __attribute__((target(isa)))
+#  endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#  include <arm_neon.h>
+#  define PIXELCONVERT_NEON 1
+#endif
+
+
+/* The scalar loops double as the tail handling of the vector versions,
+ * and define what the vector versions have to produce.
+ */
+
+static void grayToRGBAScalar(const unsigned char* src, unsigned char* dst, size_t pixels)
+{
+    for (; pixels > 0; --pixels)
+    {
+        dst[0] = dst[1] = dst[2] = src[0];
+        dst[3] = 0xff;
+        src += 1;
+        dst += 4;
+    }
+}
+
+static void grayAlphaToRGBAScalar(const unsigned char* src, unsigned char* dst, size_t pixels)
+{
+    for (; pixels > 0; --pixels)
+    {
+        dst[0] = dst[1] = dst[2] = src[0];
+        dst[3] = src[1];
+        src += 2;
+        dst += 4;
+    }
+}
+
+static void rgbToRGBAScalar(const unsigned char* src, unsigned char* dst, size_t pixels)
+{
+    for (; pixels > 0; --pixels)
+    {
+        dst[0] = src[0];
+        dst[1] = src[1];
+        dst[2] = src[2];
+        dst[3] = 0xff;
+        src += 3;
+        dst += 4;
+    }
+}
+
+static void narrow16To8Scalar(const unsigned char* src, unsigned char* dst, size_t samples, bool bigEndian)
+{
+    const int msb = bigEndian ? 0 : 1;
+    for (size_t i = 0; i < samples; i++)
+        dst[i] = src[2 * i + msb];
+}
+
+static void interleavePlanesScalar(const unsigned char* const* planes, int channels,
+                                   unsigned char* dst, size_t first, size_t pixels)
+{
+    for (size_t i = first; i < pixels; i++)
+        for (int z = 0; z < channels; z++)
+            *dst++ = planes[z][i];
+}
+
+static void interleavePlanesScalar(const unsigned char* const* planes, int channels,
+                                   unsigned char* dst, size_t pixels)
+{
+    if (channels == 1)
+        memcpy(dst, planes[0], pixels);
+    else
+        interleavePlanesScalar(planes, channels, dst, 0, pixels);
+}
+
+static bool hasTranslucentPixelScalar(const unsigned char* rgba, size_t pixels)
+{
+    for (size_t i = 0; i < pixels; i++)
+    {
+        if (rgba[4 * i + 3] != 0xff)
+            return true;
+    }
+    return false;
+}
+
+
+
+#if defined(PIXELCONVERT_X86)
+
+/* SSE2 */
+
+PIXELCONVERT_TARGET("sse2")
+static void grayToRGBASSE2(const unsigned char* src, unsigned char* dst, size_t pixels)
+{
+    size_t i = 0;
+    const __m128i alpha = _mm_set1_epi8((char)0xff);
+    for (; i + 16 <= pixels; i += 16)
+    {
+        const __m128i g = _mm_loadu_si128((const __m128i*)(src + i));
+        const __m128i gg0 = _mm_unpacklo_epi8(g, g);
+        const __m128i gg1 = _mm_unpackhi_epi8(g, g);
+        const __m128i ga0 = _mm_unpacklo_epi8(g, alpha);
+        const __m128i ga1 = _mm_unpackhi_epi8(g, alpha);
+        __m128i* out = (__m128i*)(dst + 4 * i);
+        _mm_storeu_si128(out + 0, _mm_unpacklo_epi16(gg0, ga0));
+        _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(gg0, ga0));
+        _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(gg1, ga1));
+        _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(gg1, ga1));
+    }
+    grayToRGBAScalar(src + i, dst + 4 * i, pixels - i);
+}
+
+PIXELCONVERT_TARGET("sse2")
+static void grayAlphaToRGBASSE2(const unsigned char* src, unsigned char* dst, size_t pixels)
+{
+    size_t i = 0;
+    const __m128i lowBytes = _mm_set1_epi16(0x00ff);
+    for (; i + 8 <= pixels; i += 8)
+    {
+        // 16 bit lanes hold (gray, alpha), build (gray, gray) next to them
+        const __m128i ga = _mm_loadu_si128((const __m128i*)(src + 2 * i));
+        const __m128i g = _mm_and_si128(ga, lowBytes);
+        const __m128i gg = _mm_or_si128(g, _mm_slli_epi16(g, 8));
+        __m128i* out = (__m128i*)(dst + 4 * i);
+        _mm_storeu_si128(out + 0, _mm_unpacklo_epi16(gg, ga));
+        _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(gg, ga));
+    }
+    grayAlphaToRGBAScalar(src + 2 * i, dst + 4 * i, pixels - i);
+}
+
+PIXELCONVERT_TARGET("sse2")
+static void rgbToRGBASSE2(const unsigned char* src, unsigned char* dst, size_t pixels)
+{
+    size_t i = 0;
+    // no byte shuffle, so shift pixel n left by n bytes and keep its lane
+    const __m128i lane0 = _mm_setr_epi32(0x00ffffff, 0, 0, 0);
+    const __m128i lane1 = _mm_setr_epi32(0, 0x00ffffff, 0, 0);
+    const __m128i lane2 = _mm_setr_epi32(0, 0, 0x00ffffff, 0);
+    const __m128i lane3 = _mm_setr_epi32(0, 0, 0, 0x00ffffff);
+    const __m128i alpha = _mm_set1_epi32((int)0xff000000);
+    // 16 byte loads for 12 bytes of pixels, so stay clear of the end
+    for (; i + 6 <= pixels; i += 4)
+    {
+        const __m128i rgb = _mm_loadu_si128((const __m128i*)(src + 3 * i));
+        __m128i rgba = _mm_or_si128(_mm_and_si128(rgb, lane0), alpha);
+        rgba = _mm_or_si128(rgba, _mm_and_si128(_mm_slli_si128(rgb, 1), lane1));
+        rgba = _mm_or_si128(rgba, _mm_and_si128(_mm_slli_si128(rgb, 2), lane2));
+        rgba = _mm_or_si128(rgba, _mm_and_si128(_mm_slli_si128(rgb, 3), lane3));
+        _mm_storeu_si128((__m128i*)(dst + 4 * i), rgba);
+    }
+    rgbToRGBAScalar(src + 3 * i, dst + 4 * i, pixels - i);
+}
+
+PIXELCONVERT_TARGET("sse2")
+static void narrow16To8SSE2(const unsigned char* src, unsigned char* dst, size_t samples, bool bigEndian)
+{
+    size_t i = 0;
+    const __m128i lowBytes = _mm_set1_epi16(0x00ff);
+    for (; i + 16 <= samples; i += 16)
+    {
+        __m128i s0 = _mm_loadu_si128((const __m128i*)(src + 2 * i));
+        __m128i s1 = _mm_loadu_si128((const __m128i*)(src + 2 * i + 16));
+        // move the most significant byte to the bottom of each 16 bit lane
+        if (bigEndian)
+        {
+            s0 = _mm_and_si128(s0, lowBytes);
+            s1 = _mm_and_si128(s1, lowBytes);
+        }
+        else
+        {
+            s0 = _mm_srli_epi16(s0, 8);
+            s1 = _mm_srli_epi16(s1, 8);
+        }
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(s0, s1));
+    }
+    narrow16To8Scalar(src + 2 * i, dst + i, samples - i, bigEndian);
+}
+
+PIXELCONVERT_TARGET("sse2")
+static void interleavePlanesSSE2(const unsigned char* const* planes, int channels,
+                                 unsigned char* dst, size_t pixels)
+{
+    size_t i = 0;
+    if (channels == 1)
+    {
+        memcpy(dst, planes[0], pixels);
+        return;
+    }
+    if (channels == 2)
+    {
+        for (; i + 16 <= pixels; i += 16)
+        {
+            const __m128i p0 = _mm_loadu_si128((const __m128i*)(planes[0] + i));
+            const __m128i p1 = _mm_loadu_si128((const __m128i*)(planes[1] + i));
+            __m128i* out = (__m128i*)(dst + 2 * i);
+            _mm_storeu_si128(out + 0, _mm_unpacklo_epi8(p0, p1));
+            _mm_storeu_si128(out + 1, _mm_unpackhi_epi8(p0, p1));
+        }
+    }
+    else if (channels == 4)
+    {
+        for (; i + 16 <= pixels; i += 16)
+        {
+            const __m128i p0 = _mm_loadu_si128((const __m128i*)(planes[0] + i));
+            const __m128i p1 = _mm_loadu_si128((const __m128i*)(planes[1] + i));
+            const __m128i p2 = _mm_loadu_si128((const __m128i*)(planes[2] + i));
+            const __m128i p3 = _mm_loadu_si128((const __m128i*)(planes[3] + i));
+            const __m128i rg0 = _mm_unpacklo_epi8(p0, p1);
+            const __m128i rg1 = _mm_unpackhi_epi8(p0, p1);
+            const __m128i ba0 = _mm_unpacklo_epi8(p2, p3);
+            const __m128i ba1 = _mm_unpackhi_epi8(p2, p3);
+            __m128i* out = (__m128i*)(dst + 4 * i);
+            _mm_storeu_si128(out + 0, _mm_unpacklo_epi16(rg0, ba0));
+            _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(rg0, ba0));
+            _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(rg1, ba1));
+            _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(rg1, ba1));
+        }
+    }
+    interleavePlanesScalar(planes, channels, dst + channels * i, i, pixels);
+}
+
+PIXELCONVERT_TARGET("sse2")
+static bool hasTranslucentPixelSSE2(const unsigned char* rgba, size_t pixels)
+{
+    size_t i = 0;
+    const __m128i opaque = _mm_set1_epi32((int)0xff000000);
+    for (; i + 4 <= pixels; i += 4)
+    {
+        const __m128i p = _mm_loadu_si128((const __m128i*)(rgba + 4 * i));
+        const __m128i a = _mm_and_si128(p, opaque);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(a, opaque)) != 0xffff)
+            return true;
+    }
+    return hasTranslucentPixelScalar(rgba + 4 * i, pixels - i);
+}
+
+
+/* SSSE3 */
+
+PIXELCONVERT_TARGET("ssse3")
+static void rgbToRGBASSSE3(const unsigned char* src, unsigned char* dst, size_t pixels)
+{
+    size_t i = 0;
+    // 16 byte loads for 12 bytes of pixels, so stay clear of the end
+    const __m128i spread = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m128i alpha = _mm_set1_epi32((int)0xff000000);
+    for (; i + 6 <= pixels; i += 4)
+    {
+        __m128i rgb = _mm_loadu_si128((const __m128i*)(src + 3 * i));
+        rgb = _mm_shuffle_epi8(rgb, spread);
+        _mm_storeu_si128((__m128i*)(dst + 4 * i), _mm_or_si128(rgb, alpha));
+    }
+    rgbToRGBAScalar(src + 3 * i, dst + 4 * i, pixels - i);
+}
+
+
+/* AVX2 */
+
+PIXELCONVERT_TARGET("avx2")
+static void grayToRGBAAVX2(const unsigned char* src, unsigned char* dst, size_t pixels)
+{
+    size_t i = 0;
+    const __m256i alpha = _mm256_set1_epi32((int)0xff000000);
+    for (; i + 8 <= pixels; i += 8)
+    {
+        // one gray value per 32 bit lane, then replicate it into rgb
+        __m256i g = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(src + i)));
+        g = _mm256_or_si256(g, _mm256_slli_epi32(g, 8));
+        g = _mm256_or_si256(g, _mm256_slli_epi32(g, 8));
+        _mm256_storeu_si256((__m256i*)(dst + 4 * i), _mm256_or_si256(g, alpha));
+    }
+    grayToRGBAScalar(src + i, dst + 4 * i, pixels - i);
+}
+
+PIXELCONVERT_TARGET("avx2")
+static void rgbToRGBAAVX2(const unsigned char* src, unsigned char* dst, size_t pixels)
+{
+    size_t i = 0;
+    // 32 byte loads for 24 bytes of pixels, so stay clear of the end
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 0, 3, 4, 5, 0);
+    const __m256i spread = _mm256_setr_epi8(
+                               0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+                               0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m256i alpha = _mm256_set1_epi32((int)0xff000000);
+    for (; i + 11 <= pixels; i += 8)
+    {
+        __m256i rgb = _mm256_loadu_si256((const __m256i*)(src + 3 * i));
+        rgb = _mm256_permutevar8x32_epi32(rgb, lanes);
+        rgb = _mm256_shuffle_epi8(rgb, spread);
+        _mm256_storeu_si256((__m256i*)(dst + 4 * i), _mm256_or_si256(rgb, alpha));
+    }
+    rgbToRGBAScalar(src + 3 * i, dst + 4 * i, pixels - i);
+}
+
+PIXELCONVERT_TARGET("avx2")
+static bool hasTranslucentPixelAVX2(const unsigned char* rgba, size_t pixels)
+{
+    size_t i = 0;
+    const __m256i opaque = _mm256_set1_epi32((int)0xff000000);
+    for (; i + 8 <= pixels; i += 8)
+    {
+        const __m256i p = _mm256_loadu_si256((const __m256i*)(rgba + 4 * i));
+        const __m256i a = _mm256_and_si256(p, opaque);
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(a, opaque)) != -1)
+            return true;
+    }
+    return hasTranslucentPixelScalar(rgba + 4 * i, pixels - i);
+}
+
+#endif // PIXELCONVERT_X86
+
+
+#if defined(PIXELCONVERT_NEON)
+
+static void grayToRGBANEON(const unsigned char* src, unsigned char* dst, size_t pixels)
+{
+    size_t i = 0;
+    for (; i + 16 <= pixels; i += 16)
+    {
+        uint8x16x4_t rgba;
+        rgba.val[0] = rgba.val[1] = rgba.val[2] = vld1q_u8(src + i);
+        rgba.val[3] = vdupq_n_u8(0xff);
+        vst4q_u8(dst + 4 * i, rgba);
+    }
+    grayToRGBAScalar(src + i, dst + 4 * i, pixels - i);
+}
+
+static void grayAlphaToRGBANEON(const unsigned char* src, unsigned char* dst, size_t pixels)
+{
+    size_t i = 0;
+    for (; i + 16 <= pixels; i += 16)
+    {
+        const uint8x16x2_t ga = vld2q_u8(src + 2 * i);
+        uint8x16x4_t rgba;
+        rgba.val[0] = rgba.val[1] = rgba.val[2] = ga.val[0];
+        rgba.val[3] = ga.val[1];
+        vst4q_u8(dst + 4 * i, rgba);
+    }
+    grayAlphaToRGBAScalar(src + 2 * i, dst + 4 * i, pixels - i);
+}
+
+static void rgbToRGBANEON(const unsigned char* src, unsigned char* dst, size_t pixels)
+{
+    size_t i = 0;
+    for (; i + 16 <= pixels; i += 16)
+    {
+        const uint8x16x3_t rgb = vld3q_u8(src + 3 * i);
+        uint8x16x4_t rgba;
+        rgba.val[0] = rgb.val[0];
+        rgba.val[1] = rgb.val[1];
+        rgba.val[2] = rgb.val[2];
+        rgba.val[3] = vdupq_n_u8(0xff);
+        vst4q_u8(dst + 4 * i, rgba);
+    }
+    rgbToRGBAScalar(src + 3 * i, dst + 4 * i, pixels - i);
+}
+
+static void narrow16To8NEON(const unsigned char* src, unsigned char* dst, size_t samples, bool bigEndian)
+{
+    size_t i = 0;
+    const int msb = bigEndian ? 0 : 1;
+    for (; i + 16 <= samples; i += 16)
+        vst1q_u8(dst + i, vld2q_u8(src + 2 * i).val[msb]);
+    narrow16To8Scalar(src + 2 * i, dst + i, samples - i, bigEndian);
+}
+
+static void interleavePlanesNEON(const unsigned char* const* planes, int channels,
+                                 unsigned char* dst, size_t pixels)
+{
+    size_t i = 0;
+    if (channels == 1)
+    {
+        memcpy(dst, planes[0], pixels);
+        return;
+    }
+    if (channels == 2)
+    {
+        for (; i + 16 <= pixels; i += 16)
+        {
+            uint8x16x2_t p;
+            p.val[0] = vld1q_u8(planes[0] + i);
+            p.val[1] = vld1q_u8(planes[1] + i);
+            vst2q_u8(dst + 2 * i, p);
+        }
+    }
+    else if (channels == 3)
+    {
+        for (; i + 16 <= pixels; i += 16)
+        {
+            uint8x16x3_t p;
+            p.val[0] = vld1q_u8(planes[0] + i);
+            p.val[1] = vld1q_u8(planes[1] + i);
+            p.val[2] = vld1q_u8(planes[2] + i);
+            vst3q_u8(dst + 3 * i, p);
+        }
+    }
+    else if (channels == 4)
+    {
+        for (; i + 16 <= pixels; i += 16)
+        {
+            uint8x16x4_t p;
+            p.val[0] = vld1q_u8(planes[0] + i);
+            p.val[1] = vld1q_u8(planes[1] + i);
+            p.val[2] = vld1q_u8(planes[2] + i);
+            p.val[3] = vld1q_u8(planes[3] + i);
+            vst4q_u8(dst + 4 * i, p);
+        }
+    }
+    interleavePlanesScalar(planes, channels, dst + channels * i, i, pixels);
+}
+
+static bool hasTranslucentPixelNEON(const unsigned char* rgba, size_t pixels)
+{
+    size_t i = 0;
+    for (; i + 16 <= pixels; i += 16)
+    {
+        const uint8x16x4_t p = vld4q_u8(rgba + 4 * i);
+        // any alpha below 0xff leaves a zero lane after the compare
+        const uint8x16_t opaque = vceqq_u8(p.val[3], vdupq_n_u8(0xff));
+        const uint64x2_t halves = vreinterpretq_u64_u8(opaque);
+        if ((vgetq_lane_u64(halves, 0) & vgetq_lane_u64(halves, 1)) != ~(uint64_t)0)
+            return true;
+    }
+    return hasTranslucentPixelScalar(rgba + 4 * i, pixels - i);
+}
+
+#endif // PIXELCONVERT_NEON
+
+
+/* Dispatch */
+
+struct Kernels
+{
+    PixelConvert::InstructionSet set;
+    void (*grayToRGBA)(const unsigned char*, unsigned char*, size_t);
+    void (*grayAlphaToRGBA)(const unsigned char*, unsigned char*, size_t);
+    void (*rgbToRGBA)(const unsigned char*, unsigned char*, size_t);
+    void (*narrow16To8)(const unsigned char*, unsigned char*, size_t, bool);
+    void (*interleavePlanes)(const unsigned char* const*, int, unsigned char*, size_t);
+    bool (*hasTranslucentPixel)(const unsigned char*, size_t);
+};
+
+static const Kernels kernelTable[] =
+{
+    {
+        PixelConvert::Scalar, grayToRGBAScalar, grayAlphaToRGBAScalar, rgbToRGBAScalar,
+        narrow16To8Scalar, interleavePlanesScalar, hasTranslucentPixelScalar
+    },
+#if defined(PIXELCONVERT_X86)
+    {
+        PixelConvert::SSE2, grayToRGBASSE2, grayAlphaToRGBASSE2, rgbToRGBASSE2,
+        narrow16To8SSE2, interleavePlanesSSE2, hasTranslucentPixelSSE2
+    },
+    {
+        PixelConvert::SSSE3, grayToRGBASSE2, grayAlphaToRGBASSE2, rgbToRGBASSSE3,
+        narrow16To8SSE2, interleavePlanesSSE2, hasTranslucentPixelSSE2
+    },
+    {
+        PixelConvert::AVX2, grayToRGBAAVX2, grayAlphaToRGBASSE2, rgbToRGBAAVX2,
+        narrow16To8SSE2, interleavePlanesSSE2, hasTranslucentPixelAVX2
+    },
+#endif
+#if defined(PIXELCONVERT_NEON)
+    {
+        PixelConvert::NEON, grayToRGBANEON, grayAlphaToRGBANEON, rgbToRGBANEON,
+        narrow16To8NEON, interleavePlanesNEON, hasTranslucentPixelNEON
+    },
+#endif
+};
+static const int kernelCount = (int)(sizeof(kernelTable) / sizeof(kernelTable[0]));
+
+static bool cpuSupports(PixelConvert::InstructionSet set)
+{
+    switch (set)
+    {
+    case PixelConvert::Scalar:
+        return true;
+#if defined(PIXELCONVERT_X86) && defined(_MSC_VER) && !defined(__clang__)
+    case PixelConvert::SSE2:
+    case PixelConvert::SSSE3:
+    case PixelConvert::AVX2:
+    {
+        int info[4];
+        __cpuid(info, 0);
+        const int maxLeaf = info[0];
+        __cpuid(info, 1);
+        if (set == PixelConvert::SSE2)
+            return (info[3] & (1 << 26)) != 0;
+        if (set == PixelConvert::SSSE3)
+            return (info[2] & (1 << 9)) != 0;
+        // AVX2 also needs the OS to save the ymm registers
+        const int osxsaveAVX = (1 << 27) | (1 << 28);
+        if ((maxLeaf < 7) || ((info[2] & osxsaveAVX) != osxsaveAVX))
+            return false;
+        if ((_xgetbv(0) & 6) != 6)
+            return false;
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+    }
+#elif defined(PIXELCONVERT_X86)
+    case PixelConvert::SSE2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("sse2");
+    case PixelConvert::SSSE3:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("ssse3");
+    case PixelConvert::AVX2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+#endif
+#if defined(PIXELCONVERT_NEON)
+    case PixelConvert::NEON:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+static const Kernels* findKernels(PixelConvert::InstructionSet set)
+{
+    for (int i = 0; i < kernelCount; i++)
+    {
+        if (kernelTable[i].set == set)
+            return &kernelTable[i];
+    }
+    return NULL;
+}
+
+// the table is ordered from worst to best
+static const Kernels* bestKernels()
+{
+    for (int i = kernelCount - 1; i > 0; i--)
+    {
+        if (cpuSupports(kernelTable[i].set))
+            return &kernelTable[i];
+    }
+    return &kernelTable[0];
+}
+
+// set only by setInstructionSet(), the decode threads read it at once
+static std::atomic<const Kernels*> activeKernels(NULL);
+
+static inline const Kernels& kernels()
+{
+    const Kernels* k = activeKernels.load(std::memory_order_acquire);
+    if (k != NULL)
+        return *k;
+
+    // a function static is initialized once, whichever thread gets here
+    static const Kernels* const best = bestKernels();
+    return *best;
+}
+
+
+void PixelConvert::grayToRGBA(const unsigned char* src, unsigned char* dst, size_t pixels)
+{
+    kernels().grayToRGBA(src, dst, pixels);
+}
+
+void PixelConvert::grayAlphaToRGBA(const unsigned char* src, unsigned char* dst, size_t pixels)
+{
+    kernels().grayAlphaToRGBA(src, dst, pixels);
+}
+
+void PixelConvert::rgbToRGBA(const unsigned char* src, unsigned char* dst, size_t pixels)
+{
+    kernels().rgbToRGBA(src, dst, pixels);
+}
+
+void PixelConvert::narrow16To8(const unsigned char* src, unsigned char* dst, size_t samples, bool bigEndian)
+{
+    kernels().narrow16To8(src, dst, samples, bigEndian);
+}
+
+void PixelConvert::interleavePlanes(const unsigned char* const* planes, int channels,
+                                    unsigned char* dst, size_t pixels)
+{
+    kernels().interleavePlanes(planes, channels, dst, pixels);
+}
+
+bool PixelConvert::hasTranslucentPixel(const unsigned char* rgba, size_t pixels)
+{
+    return kernels().hasTranslucentPixel(rgba, pixels);
+}
+
+PixelConvert::InstructionSet PixelConvert::getInstructionSet()
+{
+    return kernels().set;
+}
+
+bool PixelConvert::setInstructionSet(InstructionSet set)
+{
+    const Kernels* k = findKernels(set);
+    if ((k == NULL) || !cpuSupports(set))
+        return false;
+    activeKernels.store(k, std::memory_order_release);
+    return true;
+}
+
+const char* PixelConvert::getInstructionSetName(InstructionSet set)
+{
+    switch (set)
+    {
+    case SSE2:
+        return "SSE2";
+    case SSSE3:
+        return "SSSE3";
+    case AVX2:
+        return "AVX2";
+    case NEON:
+        return "NEON";
+    default:
+        return "scalar";
+    }
+}
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
@@ -115,6 +115,14 @@ void*   PlayerState::pack(void* buf, uint16_t& code)
         buf = nboPackShort(buf, angVelShort);
     }
 
+    buf = packExtras(buf);
+
+    return buf;
+}
+
+
+void*   PlayerState::packExtras(void* buf) const
+{
     if ((status & JumpJets) != 0)
     {
         float tmp = clampedValue(jumpJetsScale, 1.0f);
@@ -182,7 +190,15 @@ const void* PlayerState::unpack(const void* buf, uint16_t code)
         angVel = ((float)angVelShort * smallMaxAngVel) / smallScale;
     }
 
-    if ((inStatus & JumpJets) != 0)
+    buf = unpackExtras(buf);
+
+    return buf;
+}
+
+
+const void* PlayerState::unpackExtras(const void* buf)
+{
+    if ((status & JumpJets) != 0)
     {
         int16_t jumpJetsShort;
         buf = nboUnpackShort(buf, jumpJetsShort);
@@ -191,7 +207,7 @@ const void* PlayerState::unpack(const void* buf, uint16_t code)
     else
         jumpJetsScale = 0.0f;
 
-    if ((inStatus & OnDriver) != 0)
+    if ((status & OnDriver) != 0)
     {
         int32_t inPhyDrv;
         buf = nboUnpackInt(buf, inPhyDrv);
@@ -200,7 +216,7 @@ const void* PlayerState::unpack(const void* buf, uint16_t code)
     else
         phydrv = -1;
 
-    if ((inStatus & UserInputs) != 0)
+    if ((status & UserInputs) != 0)
     {
         int16_t userSpeedShort, userAngVelShort;
         buf = nboUnpackShort(buf, userSpeedShort);
@@ -214,7 +230,7 @@ const void* PlayerState::unpack(const void* buf, uint16_t code)
         userAngVel = 0.0f;
     }
 
-    if ((inStatus & PlaySound) != 0)
+    if ((status & PlaySound) != 0)
         buf = nboUnpackUByte(buf, sounds);
     else
         sounds = NoSounds;
@@ -0,0 +1,411 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+// interface header
+#include "PlayerStateDelta.h"
+
+// system headers
+#include <math.h>
+#include <string.h>
+
+// common headers
+#include "Pack.h"
+
+
+// 1 cm, 1 cm/sec and 0.001 radians/sec resolution, finer than
+// MsgPlayerUpdateSmall and without its range limits
+static const float posScale    = 100.0f;
+static const float velScale    = 100.0f;
+static const float angVelScale = 1000.0f;
+
+// the azimuth wraps around in 16 bits
+static const float aziScale    = 32768.0f / (float)M_PI;
+
+// bits used by a changed field, picked by a 2 bit size class
+static const int classBits[4] = { 4, 8, 16, 32 };
+
+// mask + FieldCount * (class + 32 bits)
+static const int maxFieldBytes = (PlayerStateDelta::FieldCount * 34 + 10 + 7) / 8;
+
+
+static int32_t toFixed(float value, float scale)
+{
+    double fixed = (double)value * scale;
+    if (!(fixed > -2.0e9)) // also catches NaN
+        fixed = -2.0e9;
+    else if (fixed > 2.0e9)
+        fixed = 2.0e9;
+    return (int32_t)lrint(fixed);
+}
+
+
+static uint32_t fieldDelta(int field, int32_t value, int32_t base)
+{
+    int32_t delta;
+    if (field == PlayerStateDelta::Azimuth)
+        delta = (int16_t)(uint16_t)((uint32_t)value - (uint32_t)base);
+    else
+        delta = (int32_t)((uint32_t)value - (uint32_t)base);
+    // zigzag, small deltas of either sign get small codes
+    return ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+}
+
+
+static int32_t applyDelta(int field, int32_t base, uint32_t code)
+{
+    const int32_t delta = (int32_t)(code >> 1) ^ -(int32_t)(code & 1);
+    const uint32_t value = (uint32_t)base + (uint32_t)delta;
+    if (field == PlayerStateDelta::Azimuth)
+        return (int16_t)(uint16_t)value;
+    return (int32_t)value;
+}
+
+
+namespace
+{
+class BitWriter
+{
+public:
+    BitWriter(uint8_t* _data) : data(_data), bits(0) {}
+
+    void put(uint32_t value, int count)
+    {
+        for (int i = count - 1; i >= 0; i--)
+        {
+            if ((bits & 7) == 0)
+                data[bits >> 3] = 0;
+            if ((value >> i) & 1)
+                data[bits >> 3] |= (uint8_t)(0x80 >> (bits & 7));
+            bits++;
+        }
+    }
+
+    int getBytes() const
+    {
+        return (bits + 7) >> 3;
+    }
+
+private:
+    uint8_t* data;
+    int bits;
+};
+
+class BitReader
+{
+public:
+    BitReader(const uint8_t* _data, int bytes)
+        : data(_data), bits(0), maxBits(bytes * 8) {}
+
+    bool get(uint32_t& value, int count)
+    {
+        if (bits + count > maxBits)
+            return false;
+        value = 0;
+        for (int i = 0; i < count; i++)
+        {
+            value = (value << 1) | ((data[bits >> 3] >> (7 - (bits & 7))) & 1);
+            bits++;
+        }
+        return true;
+    }
+
+private:
+    const uint8_t* data;
+    int bits;
+    int maxBits;
+};
+}
+
+
+//
+// PlayerStateDelta
+//
+
+void PlayerStateDelta::quantize(const PlayerState& state, Quantized& q)
+{
+    q.field[Order] = (int32_t)state.order;
+    q.field[Status] = (int16_t)state.status;
+    for (int i = 0; i < 3; i++)
+    {
+        q.field[PosX + i] = toFixed(state.pos[i], posScale);
+        q.field[VelX + i] = toFixed(state.velocity[i], velScale);
+    }
+
+    // put the angle between -M_PI and +M_PI
+    float angle = fmodf(state.azimuth, (float)M_PI * 2.0f);
+    if (angle >= M_PI)
+        angle -= (float)(M_PI * 2.0);
+    else if (angle < -M_PI)
+        angle += (float)(M_PI * 2.0);
+    q.field[Azimuth] = (int16_t)(uint16_t)(uint32_t)toFixed(angle, aziScale);
+
+    q.field[AngVel] = toFixed(state.angVel, angVelScale);
+}
+
+
+void PlayerStateDelta::dequantize(const Quantized& q, PlayerState& state)
+{
+    state.order = q.field[Order];
+    state.status = (short)q.field[Status];
+    for (int i = 0; i < 3; i++)
+    {
+        state.pos[i] = (float)q.field[PosX + i] / posScale;
+        state.velocity[i] = (float)q.field[VelX + i] / velScale;
+    }
+    state.azimuth = (float)q.field[Azimuth] / aziScale;
+    state.angVel = (float)q.field[AngVel] / angVelScale;
+}
+
+
+void* PlayerStateDelta::packFields(void* buf, const Quantized& q,
+                                   const Quantized* base)
+{
+    static const Quantized zero = { { 0 } };
+    if (base == NULL)
+        base = &zero;
+
+    uint8_t bytes[maxFieldBytes];
+    BitWriter bits(bytes);
+
+    uint32_t mask = 0;
+    for (int f = 0; f < FieldCount; f++)
+    {
+        if (q.field[f] != base->field[f])
+            mask |= (1 << f);
+    }
+    bits.put(mask, FieldCount);
+
+    for (int f = 0; f < FieldCount; f++)
+    {
+        if ((mask & (1 << f)) == 0)
+            continue;
+        const uint32_t code = fieldDelta(f, q.field[f], base->field[f]);
+        int sizeClass = 0;
+        while ((sizeClass < 3) && (code >> classBits[sizeClass]) != 0)
+            sizeClass++;
+        bits.put(sizeClass, 2);
+        bits.put(code, classBits[sizeClass]);
+    }
+
+    buf = nboPackUByte(buf, (uint8_t)bits.getBytes());
+    buf = nboPackString(buf, bytes, bits.getBytes());
+    return buf;
+}
+
+
+const void* PlayerStateDelta::unpackFields(const void* buf, const void* end,
+        const Quantized* base, Quantized& q)
+{
+    static const Quantized zero = { { 0 } };
+    if (base == NULL)
+        base = &zero;
+
+    const uint8_t* data = (const uint8_t*)buf;
+    if (data + 1 > (const uint8_t*)end)
+        return NULL;
+    const int count = data[0];
+    data++;
+    if ((count > maxFieldBytes) || (data + count > (const uint8_t*)end))
+        return NULL;
+
+    BitReader bits(data, count);
+    uint32_t mask;
+    if (!bits.get(mask, FieldCount))
+        return NULL;
+
+    for (int f = 0; f < FieldCount; f++)
+    {
+        if ((mask & (1 << f)) == 0)
+        {
+            q.field[f] = base->field[f];
+            continue;
+        }
+        uint32_t sizeClass, code;
+        if (!bits.get(sizeClass, 2) || !bits.get(code, classBits[sizeClass]))
+            return NULL;
+        q.field[f] = applyDelta(f, base->field[f], code);
+    }
+
+    return data + count;
+}
+
+
+//
+// PlayerDeltaEncoder
+//
+
+PlayerDeltaEncoder::PlayerDeltaEncoder()
+{
+    reset();
+}
+
+
+void PlayerDeltaEncoder::reset()
+{
+    sentCount = 0;
+    nextSequence = 0;
+    haveAck = false;
+    ackedSequence = 0;
+    lastFull = false;
+}
+
+
+void PlayerDeltaEncoder::acknowledge(uint8_t sequence)
+{
+    // only updates that are still in the history are of any use
+    const int age = (uint8_t)(nextSequence - 1 - sequence);
+    if (age >= sentCount)
+        return;
+
+    // acks may arrive out of order, keep the newest
+    if (haveAck)
+    {
+        const int ackedAge = (uint8_t)(nextSequence - 1 - ackedSequence);
+        if ((ackedAge < sentCount) && (ackedAge <= age))
+            return;
+    }
+    haveAck = true;
+    ackedSequence = sequence;
+}
+
+
+void* PlayerDeltaEncoder::pack(void* buf, const PlayerState& state)
+{
+    const int HistorySize = PlayerStateDelta::HistorySize;
+    const uint8_t sequence = nextSequence++;
+
+    // encode against the newest acknowledged update still in the history
+    const PlayerStateDelta::Quantized* base = NULL;
+    uint8_t baseSequence = sequence;
+    if (haveAck)
+    {
+        const int ackedAge = (uint8_t)(sequence - ackedSequence);
+        if ((ackedAge > 0) && (ackedAge < HistorySize) && (ackedAge <= sentCount))
+        {
+            base = &history[ackedSequence % HistorySize];
+            baseSequence = ackedSequence;
+        }
+        else
+            haveAck = false;
+    }
+    lastFull = (base == NULL);
+
+    // the base is at least one slot behind, never the one written here
+    PlayerStateDelta::Quantized& q = history[sequence % HistorySize];
+    PlayerStateDelta::quantize(state, q);
+    if (sentCount < HistorySize)
+        sentCount++;
+
+    buf = nboPackUByte(buf, sequence);
+    buf = nboPackUByte(buf, baseSequence);
+    buf = PlayerStateDelta::packFields(buf, q, base);
+    buf = state.packExtras(buf);
+    return buf;
+}
+
+
+//
+// PlayerDeltaDecoder
+//
+
+PlayerDeltaDecoder::PlayerDeltaDecoder()
+{
+    reset();
+}
+
+
+void PlayerDeltaDecoder::reset()
+{
+    for (int i = 0; i < PlayerStateDelta::HistorySize; i++)
+        valid[i] = false;
+    haveNewest = false;
+    newestSequence = 0;
+    ackPending = false;
+}
+
+
+const void* PlayerDeltaDecoder::unpack(const void* buf, const void* end,
+                                       PlayerState& state)
+{
+    const int HistorySize = PlayerStateDelta::HistorySize;
+    const uint8_t* data = (const uint8_t*)buf;
+    if (data + 2 > (const uint8_t*)end)
+        return NULL;
+    const uint8_t sequence = data[0];
+    const uint8_t baseSequence = data[1];
+    buf = data + 2;
+
+    const PlayerStateDelta::Quantized* base = NULL;
+    if (baseSequence != sequence)
+    {
+        const int slot = baseSequence % HistorySize;
+        if (!valid[slot] || (sequences[slot] != baseSequence))
+            return NULL;
+        base = &history[slot];
+    }
+
+    PlayerStateDelta::Quantized q;
+    buf = PlayerStateDelta::unpackFields(buf, end, base, q);
+    if (buf == NULL)
+        return NULL;
+
+    // the extras that follow depend on the new status
+    const short status = (short)q.field[PlayerStateDelta::Status];
+    int extrasLen = 0;
+    if ((status & PlayerState::JumpJets) != 0)
+        extrasLen += 2;
+    if ((status & PlayerState::OnDriver) != 0)
+        extrasLen += 4;
+    if ((status & PlayerState::UserInputs) != 0)
+        extrasLen += 4;
+    if ((status & PlayerState::PlaySound) != 0)
+        extrasLen += 1;
+    if ((const uint8_t*)buf + extrasLen > (const uint8_t*)end)
+        return NULL;
+
+    PlayerStateDelta::dequantize(q, state);
+    buf = state.unpackExtras(buf);
+
+    const int slot = sequence % HistorySize;
+    history[slot] = q;
+    sequences[slot] = sequence;
+    valid[slot] = true;
+
+    // acknowledging the newest one is enough, updates that arrive late
+    // are still decoded but the server never needs them as a base
+    if (!haveNewest || ((uint8_t)(sequence - newestSequence) < 128))
+    {
+        haveNewest = true;
+        newestSequence = sequence;
+        ackPending = true;
+    }
+
+    return buf;
+}
+
+
+bool PlayerDeltaDecoder::getPendingAck(uint8_t& sequence)
+{
+    if (!ackPending)
+        return false;
+    ackPending = false;
+    sequence = newestSequence;
+    return true;
+}
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
@@ -0,0 +1,308 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+// interface header
+#include "RadarGeometry.h"
+
+// system headers
+#include <math.h>
+#include <algorithm>
+
+
+// keeps the cell table small on huge maps
+static const int maxCellsPerSide = 64;
+
+
+RadarGeometry::RadarGeometry()
+{
+    clear();
+}
+
+
+void RadarGeometry::clear()
+{
+    finished = false;
+    for (int l = 0; l < LayerCount; l++)
+    {
+        items[l].clear();
+        staged[l].clear();
+        vertices[l].clear();
+        bands[l].clear();
+        cellBands[l].clear();
+    }
+    cells.clear();
+    origin[0] = origin[1] = 0.0f;
+    cellSize = 1.0f;
+    columns = rows = 0;
+    spill = 0;
+}
+
+
+void RadarGeometry::addItem(Layer layer, int first, int count,
+                            float z, float height, bool death)
+{
+    Item item;
+    item.z = z;
+    item.height = height;
+    item.death = death;
+    item.first = first;
+    item.count = count;
+    item.cell = 0;
+
+    const float* xy = &staged[layer][first * 2];
+    item.mins[0] = item.maxs[0] = xy[0];
+    item.mins[1] = item.maxs[1] = xy[1];
+    for (int v = 1; v < count; v++)
+    {
+        for (int a = 0; a < 2; a++)
+        {
+            item.mins[a] = std::min(item.mins[a], xy[v * 2 + a]);
+            item.maxs[a] = std::max(item.maxs[a], xy[v * 2 + a]);
+        }
+    }
+
+    items[layer].push_back(item);
+}
+
+
+void RadarGeometry::addPolygon(Layer layer, const float* xy, int vertexCount,
+                               float z, float height, bool death)
+{
+    if (finished || (layer == Outlines) || (vertexCount < 3))
+        return;
+
+    std::vector<float>& out = staged[layer];
+    const int first = (int)(out.size() / 2);
+    for (int v = 1; v < vertexCount - 1; v++)
+    {
+        out.push_back(xy[0]);
+        out.push_back(xy[1]);
+        out.push_back(xy[v * 2 + 0]);
+        out.push_back(xy[v * 2 + 1]);
+        out.push_back(xy[v * 2 + 2]);
+        out.push_back(xy[v * 2 + 3]);
+    }
+    addItem(layer, first, (vertexCount - 2) * 3, z, height, death);
+}
+
+
+void RadarGeometry::addOutline(const float* xy, int vertexCount,
+                               float z, float height)
+{
+    if (finished || (vertexCount < 2))
+        return;
+
+    std::vector<float>& out = staged[Outlines];
+    const int first = (int)(out.size() / 2);
+    for (int v = 0; v < vertexCount; v++)
+    {
+        const int next = (v + 1) % vertexCount;
+        out.push_back(xy[v * 2 + 0]);
+        out.push_back(xy[v * 2 + 1]);
+        out.push_back(xy[next * 2 + 0]);
+        out.push_back(xy[next * 2 + 1]);
+    }
+    addItem(Outlines, first, vertexCount * 2, z, height, false);
+}
+
+
+void RadarGeometry::finish(float _cellSize)
+{
+    if (finished)
+        return;
+    finished = true;
+
+    // the grid covers everything that was added
+    float mins[2] = { 0.0f, 0.0f };
+    float maxs[2] = { 0.0f, 0.0f };
+    bool haveBounds = false;
+    for (int l = 0; l < LayerCount; l++)
+    {
+        for (size_t i = 0; i < items[l].size(); i++)
+        {
+            const Item& item = items[l][i];
+            for (int a = 0; a < 2; a++)
+            {
+                mins[a] = haveBounds ? std::min(mins[a], item.mins[a]) : item.mins[a];
+                maxs[a] = haveBounds ? std::max(maxs[a], item.maxs[a]) : item.maxs[a];
+            }
+            haveBounds = true;
+        }
+    }
+
+    const float width = std::max(maxs[0] - mins[0], maxs[1] - mins[1]);
+    cellSize = std::max(_cellSize, 1.0f);
+    if (width > cellSize * maxCellsPerSide)
+        cellSize = width / maxCellsPerSide;
+    columns = std::max(1, std::min(maxCellsPerSide,
+                                   (int)ceilf((maxs[0] - mins[0]) / cellSize)));
+    rows = std::max(1, std::min(maxCellsPerSide,
+                                (int)ceilf((maxs[1] - mins[1]) / cellSize)));
+    origin[0] = mins[0];
+    origin[1] = mins[1];
+
+    Cell emptyCell;
+    emptyCell.mins[0] = emptyCell.mins[1] = 0.0f;
+    emptyCell.maxs[0] = emptyCell.maxs[1] = 0.0f;
+    emptyCell.empty = true;
+    cells.assign(columns * rows, emptyCell);
+
+    // each polygon goes to the cell holding its center, the cell
+    // bounds grow to cover whatever hangs over into the neighbours
+    float overhang = 0.0f;
+    for (int l = 0; l < LayerCount; l++)
+    {
+        for (size_t i = 0; i < items[l].size(); i++)
+        {
+            Item& item = items[l][i];
+            int col = (int)((0.5f * (item.mins[0] + item.maxs[0]) - origin[0]) / cellSize);
+            int row = (int)((0.5f * (item.mins[1] + item.maxs[1]) - origin[1]) / cellSize);
+            col = std::max(0, std::min(columns - 1, col));
+            row = std::max(0, std::min(rows - 1, row));
+            item.cell = row * columns + col;
+
+            Cell& cell = cells[item.cell];
+            for (int a = 0; a < 2; a++)
+            {
+                cell.mins[a] = cell.empty ? item.mins[a] : std::min(cell.mins[a], item.mins[a]);
+                cell.maxs[a] = cell.empty ? item.maxs[a] : std::max(cell.maxs[a], item.maxs[a]);
+            }
+            cell.empty = false;
+
+            const float cellMin[2] = { origin[0] + col * cellSize,
+                                       origin[1] + row * cellSize
+                                     };
+            for (int a = 0; a < 2; a++)
+            {
+                overhang = std::max(overhang, cellMin[a] - item.mins[a]);
+                overhang = std::max(overhang, item.maxs[a] - (cellMin[a] + cellSize));
+            }
+        }
+    }
+    spill = (int)ceilf(overhang / cellSize);
+
+    for (int l = 0; l < LayerCount; l++)
+        sortLayer((Layer)l);
+}
+
+
+void RadarGeometry::sortLayer(Layer layer)
+{
+    std::vector<Item>& list = items[layer];
+    std::sort(list.begin(), list.end(), [](const Item& a, const Item& b)
+    {
+        if (a.cell != b.cell)
+            return a.cell < b.cell;
+        if (a.z != b.z)
+            return a.z < b.z;
+        if (a.height != b.height)
+            return a.height < b.height;
+        return a.death < b.death;
+    });
+
+    // copy the vertices in cell and band order, neighbouring polygons
+    // with the same band become one draw
+    const std::vector<float>& in = staged[layer];
+    std::vector<float>& out = vertices[layer];
+    out.reserve(in.size());
+    cellBands[layer].assign(cells.size() + 1, 0);
+    int lastCell = -1;
+    for (size_t i = 0; i < list.size(); i++)
+    {
+        const Item& item = list[i];
+        const bool sameCell = (item.cell == lastCell);
+        if (!sameCell)
+        {
+            for (int c = lastCell + 1; c <= item.cell; c++)
+                cellBands[layer][c] = (int)bands[layer].size();
+            lastCell = item.cell;
+        }
+
+        Band* band = sameCell ? &bands[layer].back() : NULL;
+        if ((band == NULL) || (band->z != item.z) ||
+                (band->height != item.height) || (band->death != item.death))
+        {
+            Band newBand;
+            newBand.z = item.z;
+            newBand.height = item.height;
+            newBand.death = item.death;
+            newBand.first = (int)(out.size() / 2);
+            newBand.count = 0;
+            bands[layer].push_back(newBand);
+            band = &bands[layer].back();
+        }
+        out.insert(out.end(), in.begin() + item.first * 2,
+                   in.begin() + (item.first + item.count) * 2);
+        band->count += item.count;
+    }
+    for (int c = lastCell + 1; c <= (int)cells.size(); c++)
+        cellBands[layer][c] = (int)bands[layer].size();
+
+    // the staging copies are not needed any more
+    std::vector<Item>().swap(list);
+    std::vector<float>().swap(staged[layer]);
+}
+
+
+void RadarGeometry::queryCells(const float center[2], float halfSize,
+                               std::vector<int>& result) const
+{
+    result.clear();
+    if (!finished)
+        return;
+
+    const float mins[2] = { center[0] - halfSize, center[1] - halfSize };
+    const float maxs[2] = { center[0] + halfSize, center[1] + halfSize };
+
+    // the cells the square covers, widened by the overhang
+    const int col0 = std::max(0, (int)floorf((mins[0] - origin[0]) / cellSize) - spill);
+    const int col1 = std::min(columns - 1, (int)floorf((maxs[0] - origin[0]) / cellSize) + spill);
+    const int row0 = std::max(0, (int)floorf((mins[1] - origin[1]) / cellSize) - spill);
+    const int row1 = std::min(rows - 1, (int)floorf((maxs[1] - origin[1]) / cellSize) + spill);
+
+    for (int row = row0; row <= row1; row++)
+    {
+        for (int col = col0; col <= col1; col++)
+        {
+            const int index = row * columns + col;
+            const Cell& cell = cells[index];
+            if (cell.empty ||
+                    (cell.mins[0] > maxs[0]) || (cell.maxs[0] < mins[0]) ||
+                    (cell.mins[1] > maxs[1]) || (cell.maxs[1] < mins[1]))
+                continue;
+            result.push_back(index);
+        }
+    }
+}
+
+
+const RadarGeometry::Band* RadarGeometry::getBands(int cell, Layer layer,
+        int& count) const
+{
+    const std::vector<int>& offsets = cellBands[layer];
+    if ((cell < 0) || (cell + 1 >= (int)offsets.size()))
+    {
+        count = 0;
+        return NULL;
+    }
+    count = offsets[cell + 1] - offsets[cell];
+    return (count > 0) ? &bands[layer][offsets[cell]] : NULL;
+}
+
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
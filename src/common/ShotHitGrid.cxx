@@ -0,0 +1,196 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/* interface header */
+#include "ShotHitGrid.h"
+
+/* system implementation headers */
+#include <math.h>
+#include <algorithm>
+
+
+// power of two, the hash wraps the whole plane into this many cells
+static const int bucketCount = 1024;
+
+// shots covering more cells than this are tested by every query
+static const int maxCellsPerShot = 16;
+
+
+ShotHitGrid::ShotHitGrid(float _cellSize) :
+    cellSize(_cellSize > 1.0f ? _cellSize : 1.0f), mark(0)
+{
+    buckets.assign(bucketCount, -1);
+}
+
+
+void ShotHitGrid::clear()
+{
+    if (!links.empty())
+        buckets.assign(bucketCount, -1);
+    entries.clear();
+    links.clear();
+    unhashed.clear();
+}
+
+
+int ShotHitGrid::bucket(int col, int row) const
+{
+    const unsigned int hash = ((unsigned int)col * 73856093u) ^
+                              ((unsigned int)row * 19349663u);
+    return (int)(hash & (bucketCount - 1));
+}
+
+
+bool ShotHitGrid::overlaps(const Entry& entry, const float (*bbox)[3]) const
+{
+    if (!entry.bounded)
+        return true;
+    return (entry.mins[0] <= bbox[1][0]) && (entry.maxs[0] >= bbox[0][0]) &&
+           (entry.mins[1] <= bbox[1][1]) && (entry.maxs[1] >= bbox[0][1]);
+}
+
+
+void ShotHitGrid::add(int id, const float (*bbox)[3])
+{
+    // an empty box can't overlap anything
+    if ((bbox != NULL) && ((bbox[0][0] > bbox[1][0]) || (bbox[0][1] > bbox[1][1])))
+        return;
+
+    const int index = (int)entries.size();
+    Entry entry;
+    entry.id = id;
+    entry.bounded = (bbox != NULL);
+    entry.mins[0] = entry.mins[1] = entry.maxs[0] = entry.maxs[1] = 0.0f;
+    if (bbox != NULL)
+    {
+        entry.mins[0] = bbox[0][0];
+        entry.mins[1] = bbox[0][1];
+        entry.maxs[0] = bbox[1][0];
+        entry.maxs[1] = bbox[1][1];
+    }
+    entries.push_back(entry);
+
+    if (bbox == NULL)
+    {
+        unhashed.push_back(index);
+        return;
+    }
+
+    // also keeps huge and broken coordinates out of the int math
+    const float span = cellSize * maxCellsPerShot;
+    if (!((entry.maxs[0] - entry.mins[0]) < span) ||
+            !((entry.maxs[1] - entry.mins[1]) < span) ||
+            !(fabsf(entry.mins[0]) < 1.0e6f) || !(fabsf(entry.mins[1]) < 1.0e6f))
+    {
+        unhashed.push_back(index);
+        return;
+    }
+    const int col0 = (int)floorf(entry.mins[0] / cellSize);
+    const int col1 = (int)floorf(entry.maxs[0] / cellSize);
+    const int row0 = (int)floorf(entry.mins[1] / cellSize);
+    const int row1 = (int)floorf(entry.maxs[1] / cellSize);
+    if ((col1 - col0 + 1) * (row1 - row0 + 1) > maxCellsPerShot)
+    {
+        unhashed.push_back(index);
+        return;
+    }
+
+    for (int row = row0; row <= row1; row++)
+    {
+        for (int col = col0; col <= col1; col++)
+        {
+            const int b = bucket(col, row);
+            Link link;
+            link.entry = index;
+            link.next = buckets[b];
+            buckets[b] = (int)links.size();
+            links.push_back(link);
+        }
+    }
+}
+
+
+void ShotHitGrid::query(const float (*bbox)[3], std::vector<int>& ids) const
+{
+    ids.clear();
+    if (entries.empty())
+        return;
+
+    // a new mark value per query, so the marks never need clearing
+    if (marks.size() < entries.size())
+        marks.resize(entries.size(), mark);
+    if (++mark == 0)
+    {
+        std::fill(marks.begin(), marks.end(), 0);
+        mark = 1;
+    }
+
+    // collect entry indices first, they become ids at the end
+    for (size_t i = 0; i < unhashed.size(); i++)
+    {
+        const int index = unhashed[i];
+        marks[index] = mark;
+        if (overlaps(entries[index], bbox))
+            ids.push_back(index);
+    }
+
+    const float span = cellSize * 32.0f;
+    const bool huge = !((bbox[1][0] - bbox[0][0]) < span) ||
+                      !((bbox[1][1] - bbox[0][1]) < span) ||
+                      !(fabsf(bbox[0][0]) < 1.0e6f) || !(fabsf(bbox[0][1]) < 1.0e6f);
+    if (huge)
+    {
+        // a huge or broken query box is cheaper as a straight scan
+        for (size_t i = 0; i < entries.size(); i++)
+        {
+            if ((marks[i] != mark) && overlaps(entries[i], bbox))
+                ids.push_back((int)i);
+        }
+    }
+    else
+    {
+        const int col0 = (int)floorf(bbox[0][0] / cellSize);
+        const int col1 = (int)floorf(bbox[1][0] / cellSize);
+        const int row0 = (int)floorf(bbox[0][1] / cellSize);
+        const int row1 = (int)floorf(bbox[1][1] / cellSize);
+        for (int row = row0; row <= row1; row++)
+        {
+            for (int col = col0; col <= col1; col++)
+            {
+                for (int l = buckets[bucket(col, row)]; l >= 0; l = links[l].next)
+                {
+                    const int index = links[l].entry;
+                    if (marks[index] == mark)
+                        continue;
+                    marks[index] = mark;
+                    if (overlaps(entries[index], bbox))
+                        ids.push_back(index);
+                }
+            }
+        }
+    }
+
+    // keep the order shots were added in, ties between hits go to
+    // the same shot as when every shot is tested
+    std::sort(ids.begin(), ids.end());
+    for (size_t i = 0; i < ids.size(); i++)
+        ids[i] = entries[ids[i]].id;
+}
+
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
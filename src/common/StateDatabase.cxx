@@ -94,6 +94,7 @@ const std::string StateDatabase::BZDB_COUNTDOWNRESDELAY    = std::string("_count
 const std::string StateDatabase::BZDB_CULLDEPTH        = std::string("_cullDepth");
 const std::string StateDatabase::BZDB_CULLELEMENTS     = std::string("_cullElements");
 const std::string StateDatabase::BZDB_CULLOCCLUDERS    = std::string("_cullOccluders");
+const std::string StateDatabase::BZDB_DELTAUPDATES     = std::string("_deltaUpdates");
 const std::string StateDatabase::BZDB_DISABLEBOTS      = std::string("_disableBots");
 const std::string StateDatabase::BZDB_DRAWCELESTIAL    = std::string("_drawCelestial");
 const std::string StateDatabase::BZDB_DRAWCLOUDS       = std::string("_drawClouds");
@@ -0,0 +1,427 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/* interface header */
+#include "StreamParse.h"
+
+/* system implementation headers */
+#include <stdio.h>
+#include <stdint.h>
+#include <cmath>
+#include <locale>
+#include <sstream>
+#include <utility>
+
+
+//
+// MemoryStreamBuf
+//
+
+MemoryStreamBuf::MemoryStreamBuf(const char* data, size_t size)
+{
+    char* start = const_cast<char*>(data);
+    setg(start, start, start + size);
+}
+
+
+MemoryStreamBuf::pos_type MemoryStreamBuf::seekoff(off_type off,
+        std::ios_base::seekdir dir,
+        std::ios_base::openmode which)
+{
+    if (!(which & std::ios_base::in))
+        return pos_type(off_type(-1));
+
+    off_type pos;
+    if (dir == std::ios_base::beg)
+        pos = off;
+    else if (dir == std::ios_base::cur)
+        pos = (gptr() - eback()) + off;
+    else
+        pos = (egptr() - eback()) + off;
+
+    if ((pos < 0) || (pos > egptr() - eback()))
+        return pos_type(off_type(-1));
+    setg(eback(), eback() + pos, egptr());
+    return pos_type(pos);
+}
+
+
+MemoryStreamBuf::pos_type MemoryStreamBuf::seekpos(pos_type pos,
+        std::ios_base::openmode which)
+{
+    return seekoff(off_type(pos), std::ios_base::beg, which);
+}
+
+
+//
+// MemoryStream
+//
+
+MemoryStream::MemoryStream(std::string _data)
+    : std::istream(NULL), data(std::move(_data)), buffer(data.data(), data.size())
+{
+    rdbuf(&buffer);
+}
+
+
+//
+// StreamParse
+//
+
+static inline bool isSpace(int c)
+{
+    return (c == ' ') || (c == '\t') || (c == '\n') || (c == '\r') ||
+           (c == '\f') || (c == '\v');
+}
+
+
+static inline bool isDigit(int c)
+{
+    return (c >= '0') && (c <= '9');
+}
+
+
+bool StreamParse::readFile(const std::string& filename, std::string& data)
+{
+    FILE* file = fopen(filename.c_str(), "rb");
+    if (file == NULL)
+        return false;
+
+    data.clear();
+    if (fseek(file, 0, SEEK_END) == 0)
+    {
+        const long size = ftell(file);
+        if (size > 0)
+            data.reserve(size);
+        fseek(file, 0, SEEK_SET);
+    }
+
+    char buffer[65536];
+    size_t bytes;
+    while ((bytes = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        data.append(buffer, bytes);
+    const bool good = (ferror(file) == 0);
+    fclose(file);
+    return good;
+}
+
+
+void StreamParse::readToken(std::istream& input, char* buffer, int n)
+{
+    std::streambuf* sb = input.rdbuf();
+    const int eof = std::char_traits<char>::eof();
+    int i = 0;
+
+    if (sb != NULL && input.good())
+    {
+        // skip white space, but not the end of the line
+        int c = sb->sgetc();
+        while (c != eof && c != '\n' && isSpace(c))
+            c = sb->snextc();
+
+        // read up to white space or n - 1 characters into buffer
+        while (c != eof && !isSpace(c) && i < n - 1)
+        {
+            buffer[i++] = (char)c;
+            c = sb->snextc();
+        }
+        if (c == eof)
+            input.setstate(std::ios_base::eofbit);
+    }
+
+    // terminate string
+    buffer[i] = 0;
+}
+
+
+void StreamParse::skipLine(std::istream& input)
+{
+    std::streambuf* sb = input.rdbuf();
+    if (sb == NULL || !input.good())
+        return;
+
+    const int eof = std::char_traits<char>::eof();
+    int c;
+    while ((c = sb->sbumpc()) != eof)
+    {
+        if (c == '\n')
+            return;
+    }
+    input.setstate(std::ios_base::eofbit);
+}
+
+
+bool StreamParse::readFloat(std::istream& input, float& value)
+{
+    std::streambuf* sb = input.rdbuf();
+    if (sb == NULL || !input.good())
+    {
+        input.setstate(std::ios_base::failbit);
+        return false;
+    }
+
+    const int eof = std::char_traits<char>::eof();
+    int c = sb->sgetc();
+    while (c != eof && isSpace(c))
+        c = sb->snextc();
+
+    // collect what can be part of a number
+    char buffer[128];
+    int len = 0;
+    bool digits = false;
+    if (c == '+' || c == '-')
+    {
+        buffer[len++] = (char)c;
+        c = sb->snextc();
+    }
+    while (isDigit(c) && len < 127)
+    {
+        buffer[len++] = (char)c;
+        digits = true;
+        c = sb->snextc();
+    }
+    if (c == '.' && len < 127)
+    {
+        buffer[len++] = (char)c;
+        c = sb->snextc();
+        while (isDigit(c) && len < 127)
+        {
+            buffer[len++] = (char)c;
+            digits = true;
+            c = sb->snextc();
+        }
+    }
+    if (digits && (c == 'e' || c == 'E') && len < 125)
+    {
+        buffer[len++] = (char)c;
+        c = sb->snextc();
+        if (c == '+' || c == '-')
+        {
+            buffer[len++] = (char)c;
+            c = sb->snextc();
+        }
+        while (isDigit(c) && len < 127)
+        {
+            buffer[len++] = (char)c;
+            c = sb->snextc();
+        }
+    }
+    if (c == eof)
+        input.setstate(std::ios_base::eofbit);
+
+    double result;
+    const char* next;
+    if (!digits || len >= 127 ||
+            !parseFloat(buffer, buffer + len, result, &next) ||
+            (next != buffer + len))
+    {
+        input.setstate(std::ios_base::failbit);
+        return false;
+    }
+    // too large for a float fails like input >> value does, values too
+    // small for it become zero or denormal
+    const float narrowed = (float)result;
+    if (std::isinf(narrowed))
+    {
+        input.setstate(std::ios_base::failbit);
+        return false;
+    }
+    value = narrowed;
+    return true;
+}
+
+
+bool StreamParse::readFloats(std::istream& input, float* values, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (!readFloat(input, values[i]))
+            return false;
+    }
+    return true;
+}
+
+
+void StreamParse::readIntList(std::istream& input, std::vector<int>& list)
+{
+    list.clear();
+
+    std::streambuf* sb = input.rdbuf();
+    if (sb == NULL || !input.good())
+        return;
+
+    const int eof = std::char_traits<char>::eof();
+    int c = sb->sgetc();
+    bool parsing = true;
+    while (c != eof && c != '\n')
+    {
+        if (isSpace(c))
+        {
+            c = sb->snextc();
+            continue;
+        }
+
+        // anything that is not a number ends the list, the rest of the
+        // line is ignored like the old std::istringstream parsing did
+        bool negative = false;
+        if (parsing && (c == '+' || c == '-'))
+        {
+            negative = (c == '-');
+            c = sb->snextc();
+        }
+        if (!parsing || !isDigit(c))
+        {
+            parsing = false;
+            c = sb->snextc();
+            continue;
+        }
+        long value = 0;
+        while (isDigit(c))
+        {
+            if (value < 0x7fffffff)
+                value = value * 10 + (c - '0');
+            c = sb->snextc();
+        }
+        list.push_back(int(negative ? -value : value));
+    }
+    if (c == eof)
+        input.setstate(std::ios_base::eofbit);
+}
+
+
+bool StreamParse::parseFloat(const char* str, const char* end, double& value,
+                             const char** next)
+{
+    // exactly representable powers of ten
+    static const double powersOfTen[] =
+    {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+        1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+        1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    const char* p = str;
+    bool negative = false;
+    if (p < end && (*p == '+' || *p == '-'))
+    {
+        negative = (*p == '-');
+        p++;
+    }
+
+    uint64_t mantissa = 0;
+    int significant = 0;
+    int exponent = 0;
+    bool digits = false;
+    bool truncated = false;
+
+    for (; p < end && isDigit(*p); p++)
+    {
+        digits = true;
+        if (significant < 19)
+        {
+            mantissa = mantissa * 10 + (*p - '0');
+            if (mantissa != 0)
+                significant++;
+        }
+        else
+        {
+            exponent++;
+            truncated = truncated || (*p != '0');
+        }
+    }
+    if (p < end && *p == '.')
+    {
+        for (p++; p < end && isDigit(*p); p++)
+        {
+            digits = true;
+            if (significant < 19)
+            {
+                mantissa = mantissa * 10 + (*p - '0');
+                if (mantissa != 0)
+                    significant++;
+                exponent--;
+            }
+            else
+                truncated = truncated || (*p != '0');
+        }
+    }
+    if (!digits)
+    {
+        if (next)
+            *next = str;
+        return false;
+    }
+
+    // only take the exponent if there are digits after the 'e'
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        const char* q = p + 1;
+        bool negativeExp = false;
+        if (q < end && (*q == '+' || *q == '-'))
+        {
+            negativeExp = (*q == '-');
+            q++;
+        }
+        if (q < end && isDigit(*q))
+        {
+            int exp = 0;
+            for (; q < end && isDigit(*q); q++)
+            {
+                if (exp < 100000)
+                    exp = exp * 10 + (*q - '0');
+            }
+            exponent += negativeExp ? -exp : exp;
+            p = q;
+        }
+    }
+    if (next)
+        *next = p;
+
+    if (mantissa == 0)
+    {
+        value = negative ? -0.0 : 0.0;
+        return true;
+    }
+
+    // the fast path is exact: both the mantissa and the power of ten
+    // are exact doubles, so the single division or multiplication
+    // rounds correctly
+    if (!truncated && (mantissa <= (uint64_t(1) << 53)) &&
+            (exponent >= -22) && (exponent <= 22))
+    {
+        double result = double(mantissa);
+        if (exponent < 0)
+            result /= powersOfTen[-exponent];
+        else
+            result *= powersOfTen[exponent];
+        value = negative ? -result : result;
+        return true;
+    }
+
+    // rare, long or huge numbers go through the library
+    std::istringstream slow(std::string(str, p - str));
+    slow.imbue(std::locale::classic());
+    double result = 0.0;
+    slow >> result;
+    if (slow.fail())
+        return false; // out of the range of a double
+    value = result;
+    return true;
+}
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
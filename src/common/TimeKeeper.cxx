@@ -154,6 +154,11 @@ void            TimeKeeper::setTick(void)
     tickTime = getCurrent();
 }
 
+void            TimeKeeper::setTick(const TimeKeeper& tick)
+{
+    tickTime = tick;
+}
+
 const TimeKeeper& TimeKeeper::getSunExplodeTime(void)
 {
     sunExplodeTime.seconds = 10000.0 * 365 * 24 * 60 * 60;
@@ -0,0 +1,179 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/* interface header */
+#include "TrackRing.h"
+
+
+TrackRing::TrackRing(int _capacity)
+{
+    capacity = (_capacity > 0) ? _capacity : 1;
+    first = count = moving = 0;
+    entries.resize(capacity);
+    for (int i = 0; i < capacity; i++)
+        entries[i].cell = -1;
+    return;
+}
+
+
+void TrackRing::clear()
+{
+    while (count > 0)
+        pop();
+    first = 0;
+    return;
+}
+
+
+void TrackRing::setCellCount(int cellCount)
+{
+    clear();
+    cells.resize(cellCount);
+    for (int c = 0; c < cellCount; c++)
+    {
+        cells[c].head = -1;
+        cells[c].count = 0;
+    }
+    return;
+}
+
+
+int TrackRing::add(const TrackEntry& te, int cell)
+{
+    if (count == capacity)
+        pop(); // the oldest mark is nearly faded anyway
+
+    const int slot = (first + count) % capacity;
+    TrackEntry& copy = entries[slot];
+    copy = te;
+    copy.cell = -1;
+    count++;
+
+    link(slot, cell);
+    if (copy.phydrv >= 0)
+        moving++;
+    return slot;
+}
+
+
+void TrackRing::pop()
+{
+    TrackEntry& te = entries[first];
+    if (te.cell >= 0)
+        drop(te);
+    first = (first + 1) % capacity;
+    count--;
+    return;
+}
+
+
+void TrackRing::expire(double now, float fadeTime)
+{
+    while ((count > 0) && ((now - entries[first].birthTime) > fadeTime))
+        pop();
+    return;
+}
+
+
+void TrackRing::drop(TrackEntry& te)
+{
+    if (te.cell < 0)
+        return;
+    if (te.phydrv >= 0)
+        moving--;
+    unlink((int)(&te - &entries[0]));
+    return;
+}
+
+
+void TrackRing::move(TrackEntry& te, int cell)
+{
+    if (te.cell < 0)
+        return;
+    const int slot = (int)(&te - &entries[0]);
+    unlink(slot);
+    link(slot, cell);
+    return;
+}
+
+
+void TrackRing::link(int slot, int cell)
+{
+    TrackEntry& te = entries[slot];
+    Cell& c = cells[cell];
+
+    te.cell = cell;
+    te.cellPrev = -1;
+    te.cellNext = c.head;
+    if (c.head >= 0)
+        entries[c.head].cellPrev = slot;
+    c.head = slot;
+
+    if (c.count == 0)
+    {
+        for (int i = 0; i < 3; i++)
+            c.mins[i] = c.maxs[i] = te.pos[i];
+    }
+    else
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            if (te.pos[i] < c.mins[i])
+                c.mins[i] = te.pos[i];
+            if (te.pos[i] > c.maxs[i])
+                c.maxs[i] = te.pos[i];
+        }
+    }
+    c.count++;
+    return;
+}
+
+
+void TrackRing::unlink(int slot)
+{
+    TrackEntry& te = entries[slot];
+    Cell& c = cells[te.cell];
+
+    if (te.cellPrev >= 0)
+        entries[te.cellPrev].cellNext = te.cellNext;
+    else
+        c.head = te.cellNext;
+    if (te.cellNext >= 0)
+        entries[te.cellNext].cellPrev = te.cellPrev;
+
+    c.count--;
+    te.cell = -1;
+    return;
+}
+
+
+bool TrackRing::getCellBounds(int cell, float mins[3], float maxs[3]) const
+{
+    const Cell& c = cells[cell];
+    if (c.count == 0)
+        return false;
+    for (int i = 0; i < 3; i++)
+    {
+        mins[i] = c.mins[i];
+        maxs[i] = c.maxs[i];
+    }
+    return true;
+}
+
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
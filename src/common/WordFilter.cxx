@@ -16,6 +16,7 @@
 // system headers
 #include <ctype.h>
 #include <string>
+#include <vector>
 
 // implementation-specific headers
 #ifdef DEBUG
@@ -23,6 +24,170 @@
 #endif
 
 
+/* WordFilterAutomaton */
+
+WordFilterAutomaton::WordFilterAutomaton(void)
+{
+    clear();
+}
+
+
+unsigned int WordFilterAutomaton::addWord(unsigned char bin, const std::string &word,
+        const std::vector<letter_t> &letters)
+{
+    entry_t entry;
+    entry.bin = bin;
+    entry.word = word;
+    const unsigned int id = (unsigned int)entries.size();
+    entries.push_back(entry);
+    ordered.insert(std::upper_bound(ordered.begin(), ordered.end(), id, entryCompare(entries)), id);
+
+    if (letters.empty())
+    {
+        unindexed.push_back(id);
+        return id;
+    }
+
+    /* walk down the trie, keyed by the letters of the word */
+    unsigned int node = 0;
+    for (unsigned int i = 0; i < letters.size(); i++)
+    {
+        const char key = tolower(word[i]);
+        std::map<char, unsigned int>::const_iterator child = nodes[node].children.find(key);
+        if (child != nodes[node].children.end())
+        {
+            node = child->second;
+            continue;
+        }
+
+        node_t newNode;
+        newNode.repeat = letters[i].repeat;
+        nodes.push_back(newNode);
+        const unsigned int newIndex = (unsigned int)nodes.size() - 1;
+        nodes[node].children[key] = newIndex;
+        node = newIndex;
+
+        /* remember which input characters may lead to this letter */
+        for (unsigned int m = 0; m < letters[i].match.size(); m++)
+        {
+            std::string &alternate = alternates[(unsigned char)letters[i].match[m]];
+            if (alternate.find(key) == std::string::npos)
+                alternate += key;
+        }
+    }
+    nodes[node].words.push_back(id);
+
+    return id;
+}
+
+
+void WordFilterAutomaton::scan(const std::string &input, std::vector<unsigned int> &candidates) const
+{
+    candidates = unindexed;
+
+    std::vector<unsigned int> active;
+    std::vector<unsigned int> next;
+
+    for (std::string::const_iterator position = input.begin(); position != input.end(); ++position)
+    {
+        const unsigned char c = (unsigned char)tolower(*position);
+        const bool letter = (c >= 'a') && (c <= 'z');
+        const std::string &alternate = alternates[c];
+
+        next.clear();
+
+        /* a new match may begin on every character */
+        active.push_back(0);
+
+        for (std::vector<unsigned int>::const_iterator a = active.begin(); a != active.end(); ++a)
+        {
+            const node_t &node = nodes[*a];
+
+            /* letters repeat and anything non-alphabetic may be skipped */
+            if ((*a != 0) && (!letter || node.repeat.find(c) != std::string::npos))
+                next.push_back(*a);
+
+            for (unsigned int k = 0; k < alternate.size(); k++)
+            {
+                std::map<char, unsigned int>::const_iterator child = node.children.find(alternate[k]);
+                if (child == node.children.end())
+                    continue;
+                next.push_back(child->second);
+                const std::vector<unsigned int> &words = nodes[child->second].words;
+                candidates.insert(candidates.end(), words.begin(), words.end());
+            }
+        }
+
+        std::sort(next.begin(), next.end());
+        next.erase(std::unique(next.begin(), next.end()), next.end());
+        active.swap(next);
+    }
+
+    std::sort(candidates.begin(), candidates.end(), entryCompare(entries));
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+}
+
+
+void WordFilterAutomaton::everyWord(std::vector<unsigned int> &candidates) const
+{
+    candidates = ordered;
+}
+
+
+std::vector<unsigned int>::const_iterator WordFilterAutomaton::next(
+    const std::vector<unsigned int> &candidates, unsigned char bin,
+    const std::string *after) const
+{
+    /* candidates are sorted by bin, then word, so binary search */
+    std::vector<unsigned int>::const_iterator c = candidates.begin();
+    size_t count = candidates.size();
+    while (count > 0)
+    {
+        const size_t half = count / 2;
+        const entry_t &entry = entries[*(c + half)];
+        bool before = entry.bin < bin;
+        if ((entry.bin == bin) && (after != NULL))
+            before = strncasecmp(entry.word.c_str(), after->c_str(), 1024) <= 0;
+        if (before)
+        {
+            c += half + 1;
+            count -= half + 1;
+        }
+        else
+            count = half;
+    }
+    if ((c != candidates.end()) && (entries[*c].bin != bin))
+        return candidates.end();
+    return c;
+}
+
+
+unsigned char WordFilterAutomaton::getBin(unsigned int id) const
+{
+    return entries[id].bin;
+}
+
+
+const std::string &WordFilterAutomaton::getWord(unsigned int id) const
+{
+    return entries[id].word;
+}
+
+
+void WordFilterAutomaton::clear(void)
+{
+    nodes.clear();
+    nodes.push_back(node_t());
+    entries.clear();
+    ordered.clear();
+    unindexed.clear();
+    for (int i = 0; i < 256; i++)
+        alternates[i].clear();
+}
+
+
+/* WordFilter */
+
 /* private */
 
 /* protected */
@@ -156,17 +321,37 @@ bool WordFilter::aggressiveFilter(char *input) const
     // now we have a record of all potential word boundary positions
 
 
+    /* a single pass of the automaton tells which filter words could match
+     * at all, so only their expressions need to be evaluated.  it is
+     * rerun whenever the input is modified below.
+     */
+    std::vector<unsigned int> candidates;
+    findCandidates(sInput, candidates);
+
     /* iterate over the filter words for each unique initial word character */
     int regCode;
+    filter_t findWord;
     for (unsigned int j = 0; j < wordIndices.size(); j++)
     {
 
-        /* look at all of the filters that start with the letter wordIndices[j]
+        /* look at all of the candidate filters that start with the letter
+         * wordIndices[j], in the same order as they are stored
          */
         const unsigned int firstchar = (unsigned char)wordIndices[j];
-        for (ExpCompareSet::const_iterator i = filters[firstchar].begin();
-                i != filters[firstchar].end(); ++i)
+        bool firstWord = true;
+        while (true)
         {
+            /* find the next candidate following the last word we checked */
+            std::vector<unsigned int>::const_iterator c =
+                automaton.next(candidates, firstchar, firstWord ? NULL : &findWord.word);
+            if (c == candidates.end())
+                break;
+
+            firstWord = false;
+            findWord.word = automaton.getWord(*c);
+            ExpCompareSet::const_iterator i = filters[firstchar].find(findWord);
+            if (i == filters[firstchar].end())
+                continue;
 
             /* the big kahuna burger processing goes on here */
             bool matched = true;
@@ -303,6 +488,7 @@ bool WordFilter::aggressiveFilter(char *input) const
                     std::string filler;
                     filler.assign(matchLength, 'W');
                     sInput.replace(startOffset, matchLength, filler);
+                    findCandidates(sInput, candidates);
 
                 }
                 else if ( regCode == REG_NOMATCH )
@@ -350,6 +536,15 @@ bool WordFilter::aggressiveFilter(char *input) const
 } // end aggressiveFilter
 
 
+void WordFilter::findCandidates(const std::string &input, std::vector<unsigned int> &candidates) const
+{
+    if (preselect)
+        automaton.scan(input, candidates);
+    else
+        automaton.everyWord(candidates);
+}
+
+
 // provides a pointer to a fresh compiled expression for some given expression
 #if !defined(HAVE_REGEX_H)
 regex_t *WordFilter::getCompiledExpression(const std::string &) const
@@ -579,6 +774,43 @@ std::string WordFilter::expressionFromString(const std::string &word) const
 }
 
 
+bool WordFilter::lettersFromString(const std::string &word,
+                                   std::vector<WordFilterAutomaton::letter_t> &letters) const
+{
+    letters.clear();
+
+    for (unsigned int i = 0; i < word.length(); i++)
+    {
+        const char c = tolower(word[i]);
+
+        /* only plain letters, digits and spaces expand to character classes
+         * that are known to be taken literally by the expression
+         */
+        if (!(c >= 'a' && c <= 'z') && !(c >= '0' && c <= '9') && (c != ' '))
+        {
+            letters.clear();
+            return false;
+        }
+
+        WordFilterAutomaton::letter_t letter;
+        if (c == 'f')
+        {
+            /* mirrors the multi-letter expansion of expressionFromString */
+            letter.match = "fp";
+            letter.repeat = "fph";
+        }
+        else
+        {
+            letter.match = l33tspeakSetFromCharacter(c);
+            letter.repeat = letter.match;
+        }
+        letters.push_back(letter);
+    }
+
+    return !letters.empty();
+}
+
+
 /* public: */
 
 WordFilter::WordFilter()
@@ -591,6 +823,8 @@ WordFilter::WordFilter()
     /* filter characters randomly used to replace filtered text */
     filterChars = "!@#$%^&*";
 
+    preselect = true;
+
     /* SUFFIXES */
 
 #if 1
@@ -674,6 +908,8 @@ WordFilter::WordFilter()
 WordFilter::WordFilter(const WordFilter& _filter)
     : alphabet(_filter.alphabet),
       filterChars(_filter.filterChars),
+      automaton(_filter.automaton),
+      preselect(_filter.preselect),
       suffixes(_filter.suffixes),
       prefixes(_filter.prefixes)
 {
@@ -765,6 +1001,13 @@ bool WordFilter::addToFilter(const std::string &word, const std::string &express
         }
         else
             filters[firstchar].insert(newFilter);
+
+        /* words with hand-written expressions cannot be modelled */
+        std::vector<WordFilterAutomaton::letter_t> letters;
+        if (expression == expressionFromString(word))
+            lettersFromString(word, letters);
+        automaton.addWord(firstchar, word, letters);
+
         return true;
     }
 } // end addToFilter
@@ -919,6 +1162,10 @@ void WordFilter::outputWords(void) const
     }
 
 }
+void WordFilter::setPreselect(bool enabled)
+{
+    preselect = enabled;
+}
 unsigned long int WordFilter::wordCount(void) const
 {
     int count=0;
@@ -936,6 +1183,7 @@ void WordFilter::clear(void)
 {
     for (int i = 0; i < MAX_FILTER_SETS; i++)
         filters[i].clear();
+    automaton.clear();
 
     suffixes.clear();
     prefixes.clear();
@@ -17,7 +17,16 @@
 #include <stdarg.h>
 /* system implementation headers */
 #include <time.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
 #ifdef HAVE_UNISTD_H
 #  include <unistd.h>
 #endif
@@ -75,17 +84,506 @@ static char *timestamp(char *buf, bool micros, bool utc)
 }
 
 
+//
+// background writer
+//
+
+// lines up to this long are stored in the queue itself
+static const int recordTextSize = 512;
+
+// magic at the start of every binary log file.  each record follows as
+// a big endian int32 level, int64 microseconds since the epoch, uint32
+// length and the text without its trailing newline.
+static const char binaryMagic[4] = { 'B', 'Z', 'L', '1' };
+
+LogSettings::LogSettings() : format(TextFormat), overflow(BlockOnFull),
+    queueSize(4096), rotateSize(0), rotateCount(5)
+{
+}
+
+class AsyncLogWriter
+{
+public:
+    AsyncLogWriter() : running(false), queueMask(0), enqueuePos(0),
+        dequeuePos(0), dropped(0), writerIdle(false), out(NULL),
+        fileSize(0) {}
+
+    bool    start(const LogSettings& settings);
+    void    stop();
+    bool    isRunning() const;
+
+    // false when the line has to be written directly instead
+    bool    push(int level, const char* text, int length);
+    // write from the calling thread, bypassing the queue
+    void    write(int level, const char* text, int length);
+
+private:
+    struct Record
+    {
+        std::atomic<size_t> sequence;
+        int     level;
+        int64_t micros;
+        int     length;
+        char*   longText;   // for lines that don't fit in text
+        char    text[recordTextSize];
+    };
+
+    bool    tryPush(int level, int64_t micros, const char* text, int length);
+    bool    pop();
+    void    run();
+
+    // these need sinkMutex
+    bool    openSink();
+    void    closeSink();
+    void    writeRecord(int level, int64_t micros, const char* text, int length);
+    void    rotate();
+
+private:
+    std::atomic<bool>   running;
+    LogSettings settings;
+
+    // bounded multi producer queue, each slot's sequence tells whose
+    // turn it is so producers only contend on enqueuePos
+    std::unique_ptr<Record[]>   records;
+    size_t  queueMask;
+    std::atomic<size_t> enqueuePos;
+    size_t  dequeuePos;     // writer thread only
+
+    std::atomic<unsigned int>   dropped;
+    std::atomic<bool>   writerIdle;
+    std::mutex  wakeMutex;
+    std::condition_variable wake;
+    std::thread writer;
+
+    std::mutex  sinkMutex;
+    FILE*   out;
+    long    fileSize;
+};
+
+static AsyncLogWriter asyncLog;
+
+
+inline bool AsyncLogWriter::isRunning() const
+{
+    return running;
+}
+
+
+static int64_t wallClockMicros()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static struct tm splitTime(int64_t micros, bool utc)
+{
+    time_t seconds = (time_t)(micros / 1000000);
+    struct tm parts;
+#ifdef _WIN32
+    if (utc)
+        gmtime_s(&parts, &seconds);
+    else
+        localtime_s(&parts, &seconds);
+#else
+    if (utc)
+        gmtime_r(&seconds, &parts);
+    else
+        localtime_r(&seconds, &parts);
+#endif
+    return parts;
+}
+
+// like timestamp(), but for when the line was logged instead of now
+static char *recordTimestamp(char *buf, int64_t micros, bool withMicros, bool utc)
+{
+    const struct tm parts = splitTime(micros, utc);
+    if (withMicros)
+        snprintf (buf, tsBufferSize, "%04d-%02d-%02d %02d:%02d:%02d.%06ld: ",
+                  parts.tm_year + 1900, parts.tm_mon + 1, parts.tm_mday,
+                  parts.tm_hour, parts.tm_min, parts.tm_sec, (long)(micros % 1000000));
+    else
+        snprintf (buf, tsBufferSize, "%04d-%02d-%02d %02d:%02d:%02d: ",
+                  parts.tm_year + 1900, parts.tm_mon + 1, parts.tm_mday,
+                  parts.tm_hour, parts.tm_min, parts.tm_sec);
+    return buf;
+}
+
+static void packBigEndian(unsigned char* buf, uint64_t value, int bytes)
+{
+    for (int i = bytes - 1; i >= 0; i--)
+    {
+        buf[i] = (unsigned char)(value & 0xff);
+        value >>= 8;
+    }
+}
+
+
+bool AsyncLogWriter::start(const LogSettings& _settings)
+{
+    if (running)
+        return false;
+    settings = _settings;
+
+    {
+        std::lock_guard<std::mutex> lock(sinkMutex);
+        if (!openSink())
+            return false;
+    }
+
+    size_t size = 16;
+    while ((int)size < settings.queueSize && size < (1u << 20))
+        size *= 2;
+    records.reset(new Record[size]);
+    for (size_t i = 0; i < size; i++)
+    {
+        records[i].sequence.store(i, std::memory_order_relaxed);
+        records[i].longText = NULL;
+    }
+    queueMask = size - 1;
+    enqueuePos.store(0, std::memory_order_relaxed);
+    dequeuePos = 0;
+    dropped = 0;
+
+    running = true;
+    writer = std::thread(&AsyncLogWriter::run, this);
+    return true;
+}
+
+
+void AsyncLogWriter::stop()
+{
+    if (!running.exchange(false))
+        return;
+
+    wake.notify_one();
+    writer.join();
+
+    // anything pushed while the writer was finishing
+    while (pop())
+        ;
+
+    std::lock_guard<std::mutex> lock(sinkMutex);
+    closeSink();
+}
+
+
+bool AsyncLogWriter::tryPush(int level, int64_t micros, const char* text, int length)
+{
+    Record* record;
+    size_t pos = enqueuePos.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        record = &records[pos & queueMask];
+        const size_t sequence = record->sequence.load(std::memory_order_acquire);
+        const intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+        if (diff == 0)
+        {
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+            return false;
+        else
+            pos = enqueuePos.load(std::memory_order_relaxed);
+    }
+
+    record->level = level;
+    record->micros = micros;
+    record->length = length;
+    if (length < recordTextSize)
+    {
+        memcpy(record->text, text, length);
+        record->longText = NULL;
+    }
+    else
+    {
+        record->longText = new char[length];
+        memcpy(record->longText, text, length);
+    }
+    record->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+
+bool AsyncLogWriter::push(int level, const char* text, int length)
+{
+    if (!running)
+        return false;
+
+    const int64_t micros = wallClockMicros();
+    while (!tryPush(level, micros, text, length))
+    {
+        if (settings.overflow == LogSettings::DropOnFull)
+        {
+            dropped++;
+            return true;
+        }
+        if ((settings.overflow == LogSettings::DirectOnFull) || !running)
+            return false;
+
+        // BlockOnFull
+        wake.notify_one();
+        std::this_thread::yield();
+    }
+
+    if (writerIdle)
+        wake.notify_one();
+    return true;
+}
+
+
+bool AsyncLogWriter::pop()
+{
+    Record& record = records[dequeuePos & queueMask];
+    if (record.sequence.load(std::memory_order_acquire) != dequeuePos + 1)
+        return false;
+
+    const char* text = record.longText ? record.longText : record.text;
+    {
+        std::lock_guard<std::mutex> lock(sinkMutex);
+        writeRecord(record.level, record.micros, text, record.length);
+    }
+    delete[] record.longText;
+    record.longText = NULL;
+
+    record.sequence.store(dequeuePos + queueMask + 1, std::memory_order_release);
+    dequeuePos++;
+    return true;
+}
+
+
+void AsyncLogWriter::run()
+{
+    for (;;)
+    {
+        bool wrote = false;
+        while (pop())
+            wrote = true;
+
+        const unsigned int lost = dropped.exchange(0);
+        if (lost > 0)
+        {
+            char note[128];
+            const int length = snprintf(note, sizeof(note),
+                                        "log queue full, %u lines dropped\n", lost);
+            std::lock_guard<std::mutex> lock(sinkMutex);
+            writeRecord(0, wallClockMicros(), note, length);
+            wrote = true;
+        }
+
+        if (wrote)
+        {
+            std::lock_guard<std::mutex> lock(sinkMutex);
+            if (out)
+                fflush(out);
+            continue;
+        }
+        if (!running)
+            break;
+
+        // the timeout covers a wakeup sent just before we started waiting
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        writerIdle = true;
+        wake.wait_for(lock, std::chrono::milliseconds(50));
+        writerIdle = false;
+    }
+}
+
+
+void AsyncLogWriter::write(int level, const char* text, int length)
+{
+    std::lock_guard<std::mutex> lock(sinkMutex);
+    writeRecord(level, wallClockMicros(), text, length);
+    if (out)
+        fflush(out);
+}
+
+
+bool AsyncLogWriter::openSink()
+{
+    fileSize = 0;
+    if (settings.filename.empty())
+        out = stdout;
+    else
+    {
+        out = fopen(settings.filename.c_str(), "ab");
+        if (!out)
+            return false;
+        fseek(out, 0, SEEK_END);
+        fileSize = ftell(out);
+        if (fileSize < 0)
+            fileSize = 0;
+    }
+
+    if ((settings.format == LogSettings::BinaryFormat) && (fileSize == 0))
+    {
+        fwrite(binaryMagic, 1, sizeof(binaryMagic), out);
+        fileSize += sizeof(binaryMagic);
+    }
+    return true;
+}
+
+
+void AsyncLogWriter::closeSink()
+{
+    if (out && (out != stdout))
+        fclose(out);
+    else if (out)
+        fflush(out);
+    out = NULL;
+}
+
+
+void AsyncLogWriter::rotate()
+{
+    closeSink();
+
+    const std::string& name = settings.filename;
+    if (settings.rotateCount <= 0)
+        remove(name.c_str());
+    else
+    {
+        char from[16], to[16];
+        snprintf(to, sizeof(to), ".%d", settings.rotateCount);
+        remove((name + to).c_str());
+        for (int i = settings.rotateCount - 1; i >= 1; i--)
+        {
+            snprintf(from, sizeof(from), ".%d", i);
+            snprintf(to, sizeof(to), ".%d", i + 1);
+            rename((name + from).c_str(), (name + to).c_str());
+        }
+        rename(name.c_str(), (name + ".1").c_str());
+    }
+
+    openSink();
+}
+
+
+void AsyncLogWriter::writeRecord(int level, int64_t micros, const char* text, int length)
+{
+    if (!out)
+        return;
+
+    if (settings.format != LogSettings::TextFormat)
+    {
+        // one record per line, the newline is implied
+        if ((length > 0) && (text[length - 1] == '\n'))
+            length--;
+    }
+
+    long written = 0;
+    if (settings.format == LogSettings::TextFormat)
+    {
+        if (doTimestamp)
+        {
+            char tsbuf[tsBufferSize];
+            recordTimestamp(tsbuf, micros, doMicros, doUTC);
+            written += (long)fwrite(tsbuf, 1, strlen(tsbuf), out);
+        }
+        written += (long)fwrite(text, 1, length, out);
+    }
+    else if (settings.format == LogSettings::JSONFormat)
+    {
+        char head[128];
+        const struct tm parts = splitTime(micros, true);
+        written += fprintf(out, "{\"time\":\"%04d-%02d-%02dT%02d:%02d:%02d.%06ldZ\","
+                           "\"level\":%d,\"message\":\"",
+                           parts.tm_year + 1900, parts.tm_mon + 1, parts.tm_mday,
+                           parts.tm_hour, parts.tm_min, parts.tm_sec,
+                           (long)(micros % 1000000), level);
+
+        // escape only what JSON requires
+        int runStart = 0;
+        for (int i = 0; i < length; i++)
+        {
+            const unsigned char c = (unsigned char)text[i];
+            if ((c >= 0x20) && (c != '"') && (c != '\\'))
+                continue;
+            written += (long)fwrite(text + runStart, 1, i - runStart, out);
+            runStart = i + 1;
+            if (c == '"' || c == '\\')
+                snprintf(head, sizeof(head), "\\%c", c);
+            else if (c == '\n')
+                snprintf(head, sizeof(head), "\\n");
+            else if (c == '\t')
+                snprintf(head, sizeof(head), "\\t");
+            else
+                snprintf(head, sizeof(head), "\\u%04x", c);
+            written += (long)fwrite(head, 1, strlen(head), out);
+        }
+        written += (long)fwrite(text + runStart, 1, length - runStart, out);
+        written += (long)fwrite("\"}\n", 1, 3, out);
+    }
+    else
+    {
+        unsigned char head[16];
+        packBigEndian(head, (uint32_t)level, 4);
+        packBigEndian(head + 4, (uint64_t)micros, 8);
+        packBigEndian(head + 12, (uint32_t)length, 4);
+        written += (long)fwrite(head, 1, sizeof(head), out);
+        written += (long)fwrite(text, 1, length, out);
+    }
+
+    fileSize += written;
+    if ((settings.rotateSize > 0) && !settings.filename.empty() &&
+            (fileSize >= settings.rotateSize))
+        rotate();
+}
+
+
+static void stopAsyncLoggingAtExit()
+{
+    stopAsyncLogging();
+}
+
+bool startAsyncLogging(const LogSettings& settings)
+{
+    static bool atExitSet = false;
+    if (!asyncLog.start(settings))
+        return false;
+    if (!atExitSet)
+    {
+        atexit(stopAsyncLoggingAtExit);
+        atExitSet = true;
+    }
+    return true;
+}
+
+void stopAsyncLogging()
+{
+    asyncLog.stop();
+}
+
+
 void logDebugMessage(int level, const char* fmt, ...)
 {
-    char buffer[8192] = { 0 };
-    char tsbuf[tsBufferSize] = { 0 };
+    // don't format what nobody will read
+    const bool toConsole = (debugLevel >= level || level == 0);
+    const bool toCallback = (loggingCallback && loggingCallback->wantsLevel(level));
+    if (!toConsole && !toCallback)
+        return;
+
+    char buffer[8192];
     va_list args;
     va_start(args, fmt);
-    vsnprintf(buffer, sizeof(buffer), fmt, args);
+    int length = vsnprintf(buffer, sizeof(buffer), fmt, args);
     va_end(args);
+    if (length < 0)
+    {
+        buffer[0] = '\0';
+        length = 0;
+    }
+    else if (length >= (int)sizeof(buffer))
+        length = (int)sizeof(buffer) - 1;
 
-    if (debugLevel >= level || level == 0)
+    if (toConsole && asyncLog.isRunning())
+    {
+        if (!asyncLog.push(level, buffer, length))
+            asyncLog.write(level, buffer, length);
+    }
+    else if (toConsole)
     {
+        char tsbuf[tsBufferSize] = { 0 };
 #if defined(_MSC_VER)
         if (doTimestamp)
             W32_DEBUG_TRACE(timestamp (tsbuf, false, doUTC));
@@ -97,7 +595,7 @@ void logDebugMessage(int level, const char* fmt, ...)
 #endif
     }
 
-    if (loggingCallback)
+    if (toCallback)
         loggingCallback->log(level,buffer);
 }
 
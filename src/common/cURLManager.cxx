@@ -456,11 +456,97 @@ void cURLManager::setDNSCachingTime(long time)
                         result, errorBuffer);
 }
 
+void cURLManager::setConnectionReuse(bool reuse)
+{
+    CURLcode result;
+
+    result = curl_easy_setopt(easyHandle, CURLOPT_FORBID_REUSE, (long)(reuse ? 0 : 1));
+    if (result != CURLE_OK)
+        logDebugMessage(1,"CURLOPT_FORBID_REUSE error %d : %s\n", result, errorBuffer);
+    if (!reuse)
+        return;
+
+    // wait for a connection that can multiplex rather than opening another
+    result = curl_easy_setopt(easyHandle, CURLOPT_PIPEWAIT, (long)1);
+    if (result != CURLE_OK)
+        logDebugMessage(1,"CURLOPT_PIPEWAIT error %d : %s\n", result, errorBuffer);
+    result = curl_easy_setopt(easyHandle, CURLOPT_HTTP_VERSION,
+                              (long)CURL_HTTP_VERSION_2TLS);
+    if (result != CURLE_OK)
+        logDebugMessage(1,"CURLOPT_HTTP_VERSION error %d : %s\n", result, errorBuffer);
+}
+
+void cURLManager::setConnectionLimits(long maxPerHost, long maxTotal)
+{
+    if (!inited)
+        setup();
+
+    CURLMcode result;
+
+    result = curl_multi_setopt(multiHandle, CURLMOPT_PIPELINING, (long)CURLPIPE_MULTIPLEX);
+    if (result != CURLM_OK)
+        logDebugMessage(1,"CURLMOPT_PIPELINING error %d\n", result);
+    result = curl_multi_setopt(multiHandle, CURLMOPT_MAX_HOST_CONNECTIONS, maxPerHost);
+    if (result != CURLM_OK)
+        logDebugMessage(1,"CURLMOPT_MAX_HOST_CONNECTIONS error %d\n", result);
+    result = curl_multi_setopt(multiHandle, CURLMOPT_MAX_TOTAL_CONNECTIONS, maxTotal);
+    if (result != CURLM_OK)
+        logDebugMessage(1,"CURLMOPT_MAX_TOTAL_CONNECTIONS error %d\n", result);
+}
+
+bool cURLManager::getTransferTimes(TransferTimes &times)
+{
+    CURLcode result;
+    result = curl_easy_getinfo(easyHandle, CURLINFO_NAMELOOKUP_TIME, &times.nameLookup);
+    if (result == CURLE_OK)
+        result = curl_easy_getinfo(easyHandle, CURLINFO_CONNECT_TIME, &times.connect);
+    if (result == CURLE_OK)
+        result = curl_easy_getinfo(easyHandle, CURLINFO_APPCONNECT_TIME, &times.appConnect);
+    if (result == CURLE_OK)
+        result = curl_easy_getinfo(easyHandle, CURLINFO_STARTTRANSFER_TIME, &times.startTransfer);
+    if (result == CURLE_OK)
+        result = curl_easy_getinfo(easyHandle, CURLINFO_TOTAL_TIME, &times.total);
+    if (result == CURLE_OK)
+        result = curl_easy_getinfo(easyHandle, CURLINFO_NUM_CONNECTS, &times.connects);
+    if (result)
+    {
+        logDebugMessage(1,"CURLINFO timing error %d : %s\n", result, errorBuffer);
+        return false;
+    }
+
+    long version = 0;
+    times.httpVersion = 0;
+    if (curl_easy_getinfo(easyHandle, CURLINFO_HTTP_VERSION, &version) == CURLE_OK)
+    {
+        switch (version)
+        {
+        case CURL_HTTP_VERSION_1_0:
+            times.httpVersion = 10;
+            break;
+        case CURL_HTTP_VERSION_1_1:
+            times.httpVersion = 11;
+            break;
+        case CURL_HTTP_VERSION_2_0:
+            times.httpVersion = 20;
+            break;
+        case CURL_HTTP_VERSION_3:
+            times.httpVersion = 30;
+            break;
+        default:
+            break;
+        }
+    }
+    return true;
+}
+
 //**************************ResourceGetter*************************
 
 ResourceGetter::ResourceGetter() : cURLManager()
 {
     doingStuff = false;
+    // the resources are fetched one after another on this handle,
+    // mostly from the same host
+    setConnectionReuse(true);
 }
 
 ResourceGetter::~ResourceGetter()
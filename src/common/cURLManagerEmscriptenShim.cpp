@@ -172,6 +172,12 @@ bool cURLManager::getFileSize(double &size)
     return false;
 }
 
+bool cURLManager::getTransferTimes(TransferTimes &times)
+{
+    // The fetch API does not report these
+    return false;
+}
+
 void cURLManager::setTimeCondition(timeCondition condition, time_t &t)
 {
 }
@@ -196,6 +202,16 @@ void cURLManager::setDNSCachingTime(long time)
     // Unused
 }
 
+void cURLManager::setConnectionReuse(bool reuse)
+{
+    // The browser pools connections itself
+}
+
+void cURLManager::setConnectionLimits(long maxPerHost, long maxTotal)
+{
+    // The browser pools connections itself
+}
+
 //**************************ResourceGetter*************************
 
 ResourceGetter::ResourceGetter() : cURLManager()
@@ -35,6 +35,7 @@ const struct GlobalDBItem globalDBItems[] =
     { "_cullDist",        "fog",              false, StateDatabase::Locked},
     { "_cullElements",        "16",               false, StateDatabase::Locked},
     { "_cullOccluders",       "0",                false, StateDatabase::Locked},
+    { "_deltaUpdates",        "0",                false, StateDatabase::Locked},
     { "_disableBots",     "0",                false, StateDatabase::Locked},
     { "_disableSpeedChecks",  "0",                false, StateDatabase::Locked},
     { "_disableHeightChecks", "0",                false, StateDatabase::Locked},
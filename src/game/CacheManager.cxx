@@ -26,8 +26,12 @@
 #include <time.h>
 #include <sys/types.h>
 #include <sys/stat.h>
-#ifndef _WIN32
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <fcntl.h>
 #  include <unistd.h>
+#  include <sys/mman.h>
 #endif
 
 // common headers
@@ -39,19 +43,53 @@
 #include "DirectoryNames.h"
 
 
+// The snapshot is only ever read back by the machine that wrote it,
+// so it is stored in native byte order.  Entries run from the least
+// to the most recently used, their URLs follow in one block.
+typedef struct
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t count;
+    uint32_t stringSize;
+} IndexHeader;
+
+typedef struct
+{
+    int64_t date;
+    int64_t usedDate;
+    uint32_t size;
+    uint32_t urlOffset;
+    uint32_t urlLength;
+    char key[32];
+    uint32_t reserved;
+} IndexEntry;
+
+static const char indexMagic[4] = { 'B', 'Z', 'C', 'I' };
+static const uint32_t indexVersion = 1;
+static const char* const snapshotName = "CacheIndex.bin";
+static const char* const journalName = "CacheJournal.txt";
+static const char* const legacyIndexName = "CacheIndex.txt";
+static const char* const objectDirName = "objects/";
+
+// the journal is folded into a new snapshot past this many changes
+// more than there are records
+static const int journalSlack = 256;
+
+
 // function prototypes
 static bool fileExists(const std::string& name);
 static void removeDirs(const std::string& path);
 static void removeNewlines(char* c);
 static std::string partialEncoding(const std::string& string);
-static bool compareUsedDate(const CacheManager::CacheRecord& a,
-                            const CacheManager::CacheRecord& b);
+static bool isKey(const std::string& key);
 
 
 CacheManager CACHEMGR;
 
 
-CacheManager::CacheManager() : indexName("CacheIndex.txt")
+CacheManager::CacheManager() : newest(-1), oldest(-1), totalSize(0),
+    journalLines(0)
 {
 }
 
@@ -61,12 +99,6 @@ CacheManager::~CacheManager()
 }
 
 
-std::string CacheManager::getIndexPath()
-{
-    return getCacheDirName() + indexName;
-}
-
-
 bool CacheManager::isCacheFileType(const std::string &name) const
 {
     if (strncasecmp(name.c_str(), "http://", 7) == 0)
@@ -80,6 +112,16 @@ bool CacheManager::isCacheFileType(const std::string &name) const
 
 
 std::string CacheManager::getLocalName(const std::string &name) const
+{
+    const int pos = findRecord(name);
+    if (pos >= 0)
+        return records[pos].name;
+    // not cached, point at where older versions would have put it
+    return getLegacyName(name);
+}
+
+
+std::string CacheManager::getLegacyName(const std::string &name) const
 {
     std::string local = "";
     if (strncasecmp(name.c_str(), "http://", 7) == 0)
@@ -104,17 +146,55 @@ std::string CacheManager::getLocalName(const std::string &name) const
 }
 
 
+std::string CacheManager::getObjectName(const std::string& key,
+                                        const std::string& url) const
+{
+    // keep the extension, texture loading goes by it
+    std::string ext;
+    std::string path = url.substr(0, url.find_first_of("?#"));
+    const std::string::size_type slash = path.find_last_of('/');
+    const std::string::size_type dot = path.find_last_of('.');
+    if ((dot != std::string::npos) && ((slash == std::string::npos) || (dot > slash)) &&
+            (path.size() - dot <= 5))
+    {
+        ext = TextUtils::tolower(path.substr(dot));
+        for (unsigned int i = 1; i < ext.size(); i++)
+        {
+            if (!TextUtils::isAlphanumeric(ext[i]))
+            {
+                ext = "";
+                break;
+            }
+        }
+    }
+
+    std::string local = getCacheDirName() + objectDirName;
+    local += key.substr(0, 2) + "/" + key + ext;
+#ifdef _WIN32
+    std::replace(local.begin(), local.end(), '/', '\\');
+#endif
+    return local;
+}
+
+
 bool CacheManager::findURL(const std::string& url, CacheRecord& record)
 {
-    int pos = findRecord(url);
-    if (pos >= 0)
+    const int pos = findRecord(url);
+    if (pos < 0)
+        return false;
+
+    // the index is trusted when it is loaded, files that went missing
+    // since are noticed here
+    if (!fileExists(records[pos].name))
     {
-        CacheRecord* rec = &records[pos];
-        rec->usedDate = time(NULL); // update the timestamp
-        record = *rec;
-        return true;
+        journalRemove(url);
+        removeRecord(pos);
+        return false;
     }
-    return false;
+
+    touchRecord(pos, time(NULL));
+    record = records[pos];
+    return true;
 }
 
 
@@ -122,58 +202,371 @@ bool CacheManager::addFile(CacheRecord& record, const void* data)
 {
     if (((data == NULL) && (record.size != 0)) || (record.url.size() <= 0))
         return false;
-
-    record.name = getLocalName(record.url);
-    std::cout << "caching " << record.url << " to " << record.name << std::endl;
-    std::ostream* out = FILEMGR.createDataOutStream(record.name, true /* binary*/);
-    if (out == NULL)
+    if (record.url.find_first_of("\r\n") != std::string::npos)
         return false;
 
-    bool replacement = false;
-    CacheRecord* rec = &record;
+    MD5 md5;
+    md5.update((const unsigned char *)data, record.size);
+    md5.finalize();
+    record.key = md5.hexdigest();
+    record.name = getObjectName(record.key, record.url);
+    record.usedDate = time(NULL); // update the timestamp
+
+    // the same contents may already be here under another URL
+    if ((objectRefs.find(record.name) == objectRefs.end()) || !fileExists(record.name))
+    {
+        std::cout << "caching " << record.url << " to " << record.name << std::endl;
+        const std::string tmpName = record.name + ".tmp";
+        std::ostream* out = FILEMGR.createDataOutStream(tmpName, true /* binary*/);
+        if (out == NULL)
+            return false;
+        out->write((const char *)data, record.size);
+        const bool written = out->good();
+        delete out;
+#ifdef _WIN32
+        remove(record.name.c_str());
+#endif
+        if (!written || (rename(tmpName.c_str(), record.name.c_str()) != 0))
+        {
+            remove(tmpName.c_str());
+            return false;
+        }
+    }
+
+    insertRecord(record);
+    journalAdd(record);
+    return true;
+}
+
+
+int CacheManager::findRecord(const std::string& url) const
+{
+    std::unordered_map<std::string, int>::const_iterator it = urlIndex.find(url);
+    if (it == urlIndex.end())
+        return -1;
+    return it->second;
+}
 
-    int pos = findRecord(record.url);
+
+void CacheManager::insertRecord(const CacheRecord& rec)
+{
+    // take the new file before letting go of the old one, they may match
+    objectRefs[rec.name]++;
+
+    const int pos = findRecord(rec.url);
     if (pos >= 0)
+        removeRecord(pos);
+
+    const int index = (int)records.size();
+    records.push_back(rec);
+    LRULink link = { -1, -1 };
+    lru.push_back(link);
+    linkNewest(index);
+    urlIndex[rec.url] = index;
+    totalSize += rec.size;
+}
+
+
+void CacheManager::removeRecord(int index)
+{
+    unlink(index);
+    urlIndex.erase(records[index].url);
+    totalSize -= records[index].size;
+    releaseObject(records[index].name);
+
+    // fill the hole with the last record
+    const int last = (int)records.size() - 1;
+    if (index != last)
     {
-        records[pos] = record;
-        rec = &records[pos];
-        replacement = true;
+        records[index] = records[last];
+        lru[index] = lru[last];
+        if (lru[index].newer >= 0)
+            lru[lru[index].newer].older = index;
+        else
+            newest = index;
+        if (lru[index].older >= 0)
+            lru[lru[index].older].newer = index;
+        else
+            oldest = index;
+        urlIndex[records[index].url] = index;
     }
+    records.pop_back();
+    lru.pop_back();
+}
 
-    out->write((const char *)data, rec->size);
 
-    rec->usedDate = time(NULL); // update the timestamp
+void CacheManager::touchRecord(int index, time_t usedDate)
+{
+    records[index].usedDate = usedDate;
+    if (newest != index)
+    {
+        unlink(index);
+        linkNewest(index);
+    }
+    journalTouch(records[index]);
+}
 
-    MD5 md5;
-    md5.update((const unsigned char *)data, rec->size);
-    md5.finalize();
-    rec->key = md5.hexdigest();
 
-    if (!replacement)
-        records.push_back(*rec);
+void CacheManager::linkNewest(int index)
+{
+    lru[index].newer = -1;
+    lru[index].older = newest;
+    if (newest >= 0)
+        lru[newest].newer = index;
+    else
+        oldest = index;
+    newest = index;
+}
 
-    delete out;
+
+void CacheManager::unlink(int index)
+{
+    LRULink& link = lru[index];
+    if (link.newer >= 0)
+        lru[link.newer].older = link.older;
+    else
+        newest = link.older;
+    if (link.older >= 0)
+        lru[link.older].newer = link.newer;
+    else
+        oldest = link.newer;
+    link.newer = link.older = -1;
+}
+
+
+void CacheManager::releaseObject(const std::string& name)
+{
+    std::unordered_map<std::string, int>::iterator it = objectRefs.find(name);
+    if (it == objectRefs.end())
+        return;
+    if (--it->second > 0)
+        return;
+    objectRefs.erase(it);
+    remove(name.c_str());
+    removeDirs(name);
+}
+
+
+void CacheManager::clearRecords()
+{
+    records.clear();
+    lru.clear();
+    newest = oldest = -1;
+    urlIndex.clear();
+    objectRefs.clear();
+    totalSize = 0;
+}
+
+
+void CacheManager::journalAdd(const CacheRecord& rec)
+{
+    journal += TextUtils::format("+ %u %llu %llu %s %s\n", rec.size,
+                                 (long long unsigned)rec.date,
+                                 (long long unsigned)rec.usedDate,
+                                 rec.key.c_str(), rec.url.c_str());
+}
+
+
+void CacheManager::journalTouch(const CacheRecord& rec)
+{
+    journal += TextUtils::format("= %llu %s\n", (long long unsigned)rec.usedDate,
+                                 rec.url.c_str());
+}
+
+
+void CacheManager::journalRemove(const std::string& url)
+{
+    journal += "- " + url + "\n";
+}
+
+
+bool CacheManager::loadIndex()
+{
+    // don't lose what happened since the last save
+    if (!journal.empty())
+        saveIndex();
+
+    clearRecords();
+    journal.clear();
+    journalLines = 0;
+
+    const bool haveSnapshot = readSnapshot();
+    const bool haveJournal = fileExists(getCacheDirName() + journalName);
+    if (haveJournal)
+        replayJournal();
+
+    if (!haveSnapshot && !haveJournal)
+    {
+        if (!migrateTextIndex())
+            return false;
+        // start the new index right away so the text one can go
+        if (writeSnapshot())
+        {
+            const std::string legacyPath = getCacheDirName() + legacyIndexName;
+            remove(legacyPath.c_str());
+        }
+    }
     return true;
 }
 
 
-int CacheManager::findRecord(const std::string& url)
+bool CacheManager::readSnapshot()
 {
-    for (unsigned int i = 0; i < records.size(); i++)
+    const std::string path = getCacheDirName() + snapshotName;
+    const char* data = NULL;
+    size_t size = 0;
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    HANDLE mapping = NULL;
+    LARGE_INTEGER length;
+    if (GetFileSizeEx(file, &length) && (length.QuadPart > 0))
+    {
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping != NULL)
+        {
+            data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            size = (size_t)length.QuadPart;
+        }
+    }
+#else
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat buf;
+    if ((fstat(fd, &buf) == 0) && (buf.st_size > 0))
     {
-        CacheRecord* rec = &(records[i]);
-        if (url == rec->url)
-            return i;
+        void* view = mmap(NULL, buf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (view != MAP_FAILED)
+        {
+            data = (const char*)view;
+            size = buf.st_size;
+        }
     }
-    return -1;
+    close(fd);
+#endif
+
+    bool valid = false;
+    if ((data != NULL) && (size >= sizeof(IndexHeader)))
+    {
+        IndexHeader header;
+        memcpy(&header, data, sizeof(header));
+        const size_t entryBytes = (size_t)header.count * sizeof(IndexEntry);
+        valid = (memcmp(header.magic, indexMagic, sizeof(header.magic)) == 0) &&
+                (header.version == indexVersion) &&
+                (size == sizeof(IndexHeader) + entryBytes + header.stringSize);
+        const char* strings = data + sizeof(IndexHeader) + entryBytes;
+
+        records.reserve(header.count);
+        lru.reserve(header.count);
+        for (uint32_t i = 0; valid && (i < header.count); i++)
+        {
+            IndexEntry entry;
+            memcpy(&entry, data + sizeof(IndexHeader) + i * sizeof(IndexEntry), sizeof(entry));
+            if ((entry.urlOffset > header.stringSize) ||
+                    (entry.urlLength > header.stringSize - entry.urlOffset))
+            {
+                valid = false;
+                break;
+            }
+
+            CacheRecord rec;
+            rec.url.assign(strings + entry.urlOffset, entry.urlLength);
+            rec.key.assign(entry.key, sizeof(entry.key));
+            rec.size = (int)entry.size;
+            rec.date = (time_t)entry.date;
+            rec.usedDate = (time_t)entry.usedDate;
+            if (!isKey(rec.key))
+                continue;
+            rec.name = getObjectName(rec.key, rec.url);
+            insertRecord(rec);
+        }
+    }
+
+#ifdef _WIN32
+    if (data != NULL)
+        UnmapViewOfFile(data);
+    if (mapping != NULL)
+        CloseHandle(mapping);
+    CloseHandle(file);
+#else
+    if (data != NULL)
+        munmap((void*)data, size);
+#endif
+
+    if (!valid)
+    {
+        logDebugMessage(1,"CacheManager: ignoring bad index %s\n", path.c_str());
+        clearRecords();
+    }
+    return valid;
 }
 
 
-bool CacheManager::loadIndex()
+void CacheManager::replayJournal()
 {
-    records.clear();
+    FILE* file = fopen((getCacheDirName() + journalName).c_str(), "r");
+    if (file == NULL)
+        return;
+
+    char buffer[4096];
+    while (fgets(buffer, sizeof(buffer), file) != NULL)
+    {
+        removeNewlines(buffer);
+        journalLines++;
+        const std::string line = buffer;
+        if (line.size() < 3)
+            continue;
 
-    FILE* file = fopen(getIndexPath().c_str(), "r");
+        if (line[0] == '+')
+        {
+            std::vector<std::string> tokens = TextUtils::tokenize(line.substr(2), " ", 5);
+            if ((tokens.size() != 5) || !isKey(tokens[3]))
+            {
+                logDebugMessage(1,"CacheManager (bad journal line): %s\n", buffer);
+                continue;
+            }
+            CacheRecord rec;
+            rec.size = strtoul(tokens[0].c_str(), NULL, 10);
+            rec.date = strtoul(tokens[1].c_str(), NULL, 10);
+            rec.usedDate = strtoul(tokens[2].c_str(), NULL, 10);
+            rec.key = tokens[3];
+            rec.url = tokens[4];
+            rec.name = getObjectName(rec.key, rec.url);
+            insertRecord(rec);
+        }
+        else if (line[0] == '=')
+        {
+            const std::string::size_type space = line.find(' ', 2);
+            if (space == std::string::npos)
+                continue;
+            const int pos = findRecord(line.substr(space + 1));
+            if (pos < 0)
+                continue;
+            records[pos].usedDate = strtoul(line.c_str() + 2, NULL, 10);
+            unlink(pos);
+            linkNewest(pos);
+        }
+        else if (line[0] == '-')
+        {
+            const int pos = findRecord(line.substr(2));
+            if (pos >= 0)
+                removeRecord(pos);
+        }
+    }
+
+    fclose(file);
+}
+
+
+bool CacheManager::migrateTextIndex()
+{
+    // CacheIndex.txt kept files at paths made from their URLs, move them
+    // over to their MD5 names
+    FILE* file = fopen((getCacheDirName() + legacyIndexName).c_str(), "r");
     if (file == NULL)
         return false;
 
@@ -186,7 +579,7 @@ bool CacheManager::loadIndex()
 
         CacheRecord rec;
         rec.url = buffer;
-        rec.name = getLocalName(rec.url);
+        const std::string legacyName = getLegacyName(rec.url);
 
         if (fgets(buffer, 1024, file) == NULL)
             break;
@@ -194,7 +587,7 @@ bool CacheManager::loadIndex()
             removeNewlines(buffer);
         std::string line = buffer;
         std::vector<std::string> tokens = TextUtils::tokenize(line, " ");
-        if (tokens.size() != 4)
+        if ((tokens.size() != 4) || !isKey(tokens[3]))
         {
             logDebugMessage(1,"loadCacheIndex (bad line): %s\n", buffer);
             continue;
@@ -203,41 +596,118 @@ bool CacheManager::loadIndex()
         rec.date = strtoul(tokens[1].c_str(), NULL, 10);
         rec.usedDate = strtoul(tokens[2].c_str(), NULL, 10);
         rec.key = tokens[3];
+        rec.name = getObjectName(rec.key, rec.url);
+        if (!fileExists(legacyName))
+            continue;
+
         if (fileExists(rec.name))
-            records.push_back(rec);
+            remove(legacyName.c_str());
+        else
+        {
+            // createDataOutStream() makes the directories
+            std::ostream* out = FILEMGR.createDataOutStream(rec.name, true);
+            delete out;
+#ifdef _WIN32
+            remove(rec.name.c_str());
+#endif
+            if (rename(legacyName.c_str(), rec.name.c_str()) != 0)
+            {
+                remove(rec.name.c_str());
+                continue;
+            }
+        }
+        removeDirs(legacyName);
+        insertRecord(rec);
     }
 
     fclose(file);
+
+    // the text index was sorted newest first
+    std::vector<int> order;
+    for (int i = oldest; i >= 0; i = lru[i].newer)
+        order.push_back(i);
+    std::stable_sort(order.begin(), order.end(), [this](int a, int b)
+    {
+        return records[a].usedDate < records[b].usedDate;
+    });
+    newest = oldest = -1;
+    for (unsigned int i = 0; i < order.size(); i++)
+        linkNewest(order[i]);
+
     return true;
 }
 
 
 bool CacheManager::saveIndex()
 {
-    std::sort(records.begin(), records.end(), compareUsedDate);
+    // with no snapshot yet, or a journal longer than the index, start over
+    const int pending = (int)std::count(journal.begin(), journal.end(), '\n');
+    if ((journalLines + pending > (int)records.size() + journalSlack) ||
+            !fileExists(getCacheDirName() + snapshotName))
+        return writeSnapshot();
 
-    std::string indexPath = getIndexPath();
-    std::string tmpIndexName = indexPath + ".tmp";
+    if (journal.empty())
+        return true;
 
-    FILE* file = fopen(tmpIndexName.c_str(), "w");
+    const std::string journalPath = getCacheDirName() + journalName;
+    FILE* file = fopen(journalPath.c_str(), "a");
     if (file == NULL)
         return false;
+    const bool written = (fwrite(journal.data(), journal.size(), 1, file) == 1);
+    if ((fclose(file) != 0) || !written)
+        return false;
+
+    journalLines += pending;
+    journal.clear();
+    return true;
+}
 
-    const time_t nowTime = time(NULL);
-    fprintf(file, "#\n");
-    fprintf(file, "# BZFlag Cache Index - %s", ctime(&nowTime));
-    fprintf(file, "# <filesize>  <filetime>  <lastused>  <md5check>\n");
-    fprintf(file, "#\n\n");
 
-    for (unsigned int i = 0; i < records.size(); i++)
+bool CacheManager::writeSnapshot()
+{
+    IndexHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, indexMagic, sizeof(header.magic));
+    header.version = indexVersion;
+    header.count = (uint32_t)records.size();
+
+    std::vector<IndexEntry> entries;
+    std::string strings;
+    entries.reserve(records.size());
+    for (int i = oldest; i >= 0; i = lru[i].newer)
     {
         const CacheRecord& rec = records[i];
-        fprintf(file, "%s\n%u %llu %llu ", rec.url.c_str(), rec.size, (long long unsigned)rec.date,
-                (long long unsigned)rec.usedDate);
-        fprintf(file, "%s\n\n", rec.key.c_str());
+        IndexEntry entry;
+        memset(&entry, 0, sizeof(entry));
+        entry.date = rec.date;
+        entry.usedDate = rec.usedDate;
+        entry.size = rec.size;
+        entry.urlOffset = (uint32_t)strings.size();
+        entry.urlLength = (uint32_t)rec.url.size();
+        memcpy(entry.key, rec.key.data(), sizeof(entry.key));
+        entries.push_back(entry);
+        strings += rec.url;
     }
+    header.stringSize = (uint32_t)strings.size();
 
-    fclose(file);
+    const std::string indexPath = getCacheDirName() + snapshotName;
+    const std::string tmpIndexName = indexPath + ".tmp";
+
+    // createDataOutStream() makes the cache directory on first use
+    std::ostream* out = FILEMGR.createDataOutStream(tmpIndexName, true);
+    if (out == NULL)
+        return false;
+    out->write((const char*)&header, sizeof(header));
+    if (!entries.empty())
+        out->write((const char*)entries.data(), entries.size() * sizeof(IndexEntry));
+    out->write(strings.data(), strings.size());
+    const bool written = out->good();
+    delete out;
+    if (!written)
+    {
+        remove(tmpIndexName.c_str());
+        return false;
+    }
 
 #ifdef _WIN32
     // Windows sucks yet again. You can't rename a file to a file that
@@ -245,30 +715,29 @@ bool CacheManager::saveIndex()
     // atomic transactions.
     remove(indexPath.c_str());
 #endif
+    if (rename(tmpIndexName.c_str(), indexPath.c_str()) != 0)
+        return false;
 
-    return (rename(tmpIndexName.c_str(), indexPath.c_str()) == 0);
+    // replaying a stale journal over the new snapshot changes nothing,
+    // so stopping between the rename and this is harmless
+    const std::string journalPath = getCacheDirName() + journalName;
+    remove(journalPath.c_str());
+    journal.clear();
+    journalLines = 0;
+    return true;
 }
 
 
 void CacheManager::limitCacheSize()
 {
-    int maxSize = BZDB.evalInt("maxCacheMB") * 1024 * 1024;
+    long long maxSize = (long long)BZDB.evalInt("maxCacheMB") * 1024 * 1024;
     if (maxSize < 0)
         maxSize = 0;
 
-    int currentSize = 0;
-    for (unsigned int i = 0; i < records.size(); i++)
-        currentSize += records[i].size;
-
-    std::sort(records.begin(), records.end(), compareUsedDate);
-
-    while ((currentSize > maxSize) && (records.size() > 0))
+    while ((totalSize > maxSize) && (oldest >= 0))
     {
-        CacheManager::CacheRecord& rec = records.back();
-        currentSize -= rec.size;
-        remove(rec.name.c_str());
-        removeDirs(rec.name);
-        records.pop_back();
+        journalRemove(records[oldest].url);
+        removeRecord(oldest);
     }
 
     return;
@@ -281,6 +750,22 @@ const std::vector<CacheManager::CacheRecord>& CacheManager::getCacheList() const
 }
 
 
+void CacheManager::setTransferInfo(const std::string& url,
+                                   const TransferInfo& info)
+{
+    transfers[url] = info;
+}
+
+
+const CacheManager::TransferInfo* CacheManager::getTransferInfo(const std::string& url) const
+{
+    std::unordered_map<std::string, TransferInfo>::const_iterator it = transfers.find(url);
+    if (it == transfers.end())
+        return NULL;
+    return &it->second;
+}
+
+
 static bool fileExists (const std::string& name)
 {
     struct stat buf;
@@ -355,11 +840,17 @@ static std::string partialEncoding(const std::string& string)
 }
 
 
-static bool compareUsedDate(const CacheManager::CacheRecord& a,
-                            const CacheManager::CacheRecord& b)
+static bool isKey(const std::string& key)
 {
-    // oldest last
-    return (a.usedDate > b.usedDate);
+    // an MD5 in hex, it names the file
+    if (key.size() != 32)
+        return false;
+    for (unsigned int i = 0; i < key.size(); i++)
+    {
+        if (!isxdigit((unsigned char)key[i]))
+            return false;
+    }
+    return true;
 }
 
 
@@ -19,12 +19,22 @@
 /* common implementation headers */
 #include "AccessList.h"
 #include "CacheManager.h"
+#include "TextureCache.h"
 #include "MagnumBZMaterial.h"
 #include "AnsiCodes.h"
 #include "cURLManager.h"
+#include "ObstacleMgr.h"
+#include "MeshObstacle.h"
+#include "MeshFace.h"
+#include "BoxBuilding.h"
+#include "PyramidBuilding.h"
 
 #include "BZDBCache.h"
 
+/* system implementation headers */
+#include <algorithm>
+#include <math.h>
+
 
 // local variables for file tracker
 static int totalTex = 0;
@@ -66,17 +76,30 @@ static bool       textureDownloading = false;
 // Function Prototypes
 static void printAuthNotice();
 static bool checkAuthorizations(MagnumBZMaterialManager::TextureSet& set);
+static void sortByArea(const MagnumBZMaterialManager::TextureSet& set,
+                       std::vector<std::string>& urls);
 
 
 bool CachedTexture::checkForCache   = false;
 long CachedTexture::httpTimeout     = 0;
 int CachedTexture::textureCounter = 0;
 int CachedTexture::byteTransferred = 0;
+std::vector<CachedTexture*> CachedTexture::queue;
+std::map<std::string, int> CachedTexture::hostTransfers;
+int CachedTexture::transfers = 0;
+int CachedTexture::maxTransfers = 8;
+int CachedTexture::maxHostTransfers = 4;
 
-CachedTexture::CachedTexture(const std::string &texUrl) : cURLManager()
+CachedTexture::CachedTexture(const std::string &texUrl, int _priority) : cURLManager()
 {
     CacheManager::CacheRecord oldrec;
 
+    priority = _priority;
+    queued   = false;
+    active   = false;
+    if (!parseHostname(texUrl, host))
+        host = "";
+
 // On emscripten, we are usually hosting from https://
 // Due to cross-site restrictions, this means we need to
 // fetch from https://
@@ -109,21 +132,110 @@ CachedTexture::CachedTexture(const std::string &texUrl) : cURLManager()
         if (httpTimeout > 0.0)
             setTimeout(httpTimeout);
         setRequestFileTime(true);
+        setConnectionReuse(true);
         timeRequest = cached;
-        std::string msg = ColorStrings[GreyColor];
-        msg     += "downloading: " + url;
-        //addMessage(NULL, msg);
-        Magnum::Warning{} << msg.c_str();
         if (cached)
         {
             // use the cached file -- just in case
             MAGNUMMATERIALMGR.setTextureLocal(url, oldrec.name);
             setTimeCondition(ModifiedSince, oldrec.date);
         }
-        addHandle();
+
+        // wait in line behind anything more important
+        std::vector<CachedTexture*>::iterator it = queue.begin();
+        while ((it != queue.end()) && ((*it)->priority <= priority))
+            ++it;
+        queue.insert(it, this);
+        queued     = true;
+        queuedTime = TimeKeeper::getCurrent();
+    }
+}
+
+CachedTexture::~CachedTexture()
+{
+    if (queued)
+        queue.erase(std::find(queue.begin(), queue.end(), this));
+    if (active)
+    {
+        transfers--;
+        hostTransfers[host]--;
+    }
+}
+
+void CachedTexture::start()
+{
+    queued    = false;
+    active    = true;
+    transfers++;
+    hostTransfers[host]++;
+    startTime = TimeKeeper::getCurrent();
+
+    std::string msg = ColorStrings[GreyColor];
+    msg     += "downloading: " + url;
+    //addMessage(NULL, msg);
+    Magnum::Warning{} << msg.c_str();
+    addHandle();
+}
+
+void CachedTexture::startTransfers()
+{
+    std::vector<CachedTexture*>::iterator it = queue.begin();
+    while ((it != queue.end()) && (transfers < maxTransfers))
+    {
+        CachedTexture* tex = *it;
+        if (hostTransfers[tex->host] >= maxHostTransfers)
+        {
+            // this host is busy, let the next one have a go
+            ++it;
+            continue;
+        }
+        it = queue.erase(it);
+        tex->start();
     }
 }
 
+void CachedTexture::setTransferLimits(int maxTotal, int maxPerHost)
+{
+    maxTransfers     = std::max(maxTotal, 1);
+    maxHostTransfers = std::max(maxPerHost, 1);
+    // requests to one host can share a connection, so the connection
+    // limits only need to match the transfer limits
+    setConnectionLimits(maxHostTransfers, maxTransfers);
+}
+
+void CachedTexture::recordTransfer(unsigned int length, bool good)
+{
+    CacheManager::TransferInfo info;
+    info.priority    = priority;
+    info.queued      = startTime - queuedTime;
+    info.good        = good;
+    info.notModified = good && timeRequest && (length == 0);
+    info.bytes       = length;
+
+    TransferTimes times;
+    if (getTransferTimes(times))
+    {
+        info.nameLookup  = times.nameLookup;
+        info.connect     = times.connect;
+        info.tlsConnect  = times.appConnect;
+        info.firstByte   = times.startTransfer;
+        info.total       = times.total;
+        info.reused      = (times.connects == 0);
+        info.httpVersion = times.httpVersion;
+    }
+    else
+    {
+        info.nameLookup  = 0.0;
+        info.connect     = 0.0;
+        info.tlsConnect  = 0.0;
+        info.firstByte   = 0.0;
+        info.total       = TimeKeeper::getCurrent() - startTime;
+        info.reused      = false;
+        info.httpVersion = 0;
+    }
+    CACHEMGR.setTransferInfo(url, info);
+}
+
 void CachedTexture::setParams(bool check, long timeout)
 {
     checkForCache   = check;
@@ -136,6 +248,14 @@ void CachedTexture::finalization(char *data, unsigned int length, bool good)
 {
     time_t filetime;
 
+    if (active)
+    {
+        active = false;
+        transfers--;
+        hostTransfers[host]--;
+    }
+    recordTransfer(length, good);
+
     textureCounter--;
     if (good)
     {
@@ -165,6 +285,9 @@ void CachedTexture::finalization(char *data, unsigned int length, bool good)
         else
             MAGNUMMATERIALMGR.setTextureLocal(url, "");
     }
+
+    // hand the slot to the next texture in line
+    startTransfers();
 }
 
 int CachedTexture::activeTransfer()
@@ -213,6 +336,14 @@ void Downloads::startDownloads(bool doDownloads, bool updateDownloads,
         timeout = BZDB.eval("httpTimeout");
     CachedTexture::setParams(updateDownloads, (long)timeout);
 
+    int maxTransfers = 8;
+    if (BZDB.isSet("httpMaxTransfers"))
+        maxTransfers = BZDB.evalInt("httpMaxTransfers");
+    int maxHostTransfers = 4;
+    if (BZDB.isSet("httpMaxHostTransfers"))
+        maxHostTransfers = BZDB.evalInt("httpMaxHostTransfers");
+    CachedTexture::setTransferLimits(maxTransfers, maxHostTransfers);
+
     // check hosts' access permissions
     bool authNotice = checkAuthorizations(set);
 
@@ -227,18 +358,24 @@ void Downloads::startDownloads(bool doDownloads, bool updateDownloads,
     }
 
     if (doDownloads)
-        for (set_it = set.begin(); set_it != set.end(); ++set_it)
+    {
+        // fetch the textures covering the most of the world first
+        std::vector<std::string> urls;
+        sortByArea(set, urls);
+        for (unsigned int i = 0; i < urls.size(); i++)
         {
-            const std::string& texUrl = set_it->c_str();
+            const std::string& texUrl = urls[i];
             if (CACHEMGR.isCacheFileType(texUrl))
             {
                 if (!referencing) {
                     MAGNUMMATERIALMGR.setTextureLocal(texUrl, "");
                 }
-                cachedTexVector.push_back(new CachedTexture(texUrl));
+                cachedTexVector.push_back(new CachedTexture(texUrl, (int)i));
                 Magnum::Warning{} << "added ct" << texUrl.c_str();
             }
         }
+        CachedTexture::startTransfers();
+    }
     else
         for (set_it = set.begin(); set_it != set.end(); ++set_it)
         {
@@ -279,6 +416,8 @@ void Downloads::finalizeDownloads()
     cachedTexVector.clear();
 
     CACHEMGR.saveIndex();
+    TEXCACHE.limitCacheSize();
+    TEXCACHE.saveIndex();
 }
 
 bool Downloads::requestFinalized()
@@ -350,6 +489,112 @@ bool parseHostname(const std::string& url, std::string& hostname)
 }
 
 
+typedef std::map<std::string, float> TextureAreas;
+
+static void addMaterialArea(TextureAreas& areas, const MagnumBZMaterial* mat,
+                            float area)
+{
+    if (!mat)
+        return;
+    for (int i = 0; i < mat->getTextureCount(); i++)
+        areas[mat->getTexture(i)] += area;
+}
+
+
+static float faceArea(const MeshFace* face)
+{
+    // half the length of the summed edge cross products (Newell)
+    float n[3] = { 0.0f, 0.0f, 0.0f };
+    const int count = face->getVertexCount();
+    for (int i = 0; i < count; i++)
+    {
+        const float* a = face->getVertex(i);
+        const float* b = face->getVertex((i + 1) % count);
+        n[0] += (a[1] * b[2]) - (a[2] * b[1]);
+        n[1] += (a[2] * b[0]) - (a[0] * b[2]);
+        n[2] += (a[0] * b[1]) - (a[1] * b[0]);
+    }
+    return 0.5f * sqrtf((n[0] * n[0]) + (n[1] * n[1]) + (n[2] * n[2]));
+}
+
+
+static void getTextureAreas(TextureAreas& areas)
+{
+    const float worldSize = BZDB.eval(StateDatabase::BZDB_WORLDSIZE);
+    addMaterialArea(areas, MAGNUMMATERIALMGR.findMaterial("GroundMaterial"),
+                    worldSize * worldSize);
+
+    // box and pyramid sizes are half extents, except for the height
+    const MagnumBZMaterial* boxWall = MAGNUMMATERIALMGR.findMaterial("boxWallMaterial");
+    const MagnumBZMaterial* boxTop = MAGNUMMATERIALMGR.findMaterial("boxTopMaterial");
+    const ObstacleList& boxes = OBSTACLEMGR.getBoxes();
+    for (unsigned int i = 0; i < boxes.size(); i++)
+    {
+        const Obstacle* box = boxes[i];
+        const float w = box->getWidth();
+        const float b = box->getBreadth();
+        const float h = box->getHeight();
+        addMaterialArea(areas, boxTop, 4.0f * w * b);
+        addMaterialArea(areas, boxWall, 4.0f * (w + b) * h);
+    }
+
+    const MagnumBZMaterial* pyrWall = MAGNUMMATERIALMGR.findMaterial("pyrWallMaterial");
+    const ObstacleList& pyrs = OBSTACLEMGR.getPyrs();
+    for (unsigned int i = 0; i < pyrs.size(); i++)
+    {
+        const Obstacle* pyr = pyrs[i];
+        const float w = pyr->getWidth();
+        const float b = pyr->getBreadth();
+        const float h = pyr->getHeight();
+        addMaterialArea(areas, pyrWall, 2.0f * ((w * sqrtf((b * b) + (h * h))) +
+                                               (b * sqrtf((w * w) + (h * h)))));
+    }
+
+    const ObstacleList& meshes = OBSTACLEMGR.getMeshes();
+    for (unsigned int i = 0; i < meshes.size(); i++)
+    {
+        const MeshObstacle* mesh = (const MeshObstacle*) meshes[i];
+        for (int f = 0; f < mesh->getFaceCount(); f++)
+        {
+            const MeshFace* face = mesh->getFace(f);
+            addMaterialArea(areas, face->getMaterial(), faceArea(face));
+        }
+    }
+}
+
+
+static bool largerArea(const std::pair<float, std::string>& a,
+                       const std::pair<float, std::string>& b)
+{
+    return a.first > b.first;
+}
+
+
+// How much of the screen a texture will cover is not known before it is
+// drawn, so rank by the world surface it is put on instead.  Textures on
+// nothing that can be measured (sky, effects) keep their order at the end.
+static void sortByArea(const MagnumBZMaterialManager::TextureSet& set,
+                       std::vector<std::string>& urls)
+{
+    TextureAreas areas;
+    getTextureAreas(areas);
+
+    std::vector<std::pair<float, std::string> > ranked;
+    MagnumBZMaterialManager::TextureSet::const_iterator set_it;
+    for (set_it = set.begin(); set_it != set.end(); ++set_it)
+    {
+        TextureAreas::const_iterator area_it = areas.find(*set_it);
+        const float area = (area_it != areas.end()) ? area_it->second : 0.0f;
+        ranked.push_back(std::make_pair(area, *set_it));
+    }
+    std::stable_sort(ranked.begin(), ranked.end(), largerArea);
+
+    urls.clear();
+    for (unsigned int i = 0; i < ranked.size(); i++)
+        urls.push_back(ranked[i].second);
+}
+
+
 static bool checkAuthorizations(MagnumBZMaterialManager::TextureSet& set)
 {
     // avoid the DNS lookup
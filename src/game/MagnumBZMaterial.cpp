@@ -121,6 +121,7 @@ void MagnumBZMaterialManager::clear(bool loadDefaults)
         delete materials[i];
     materials.clear();
     unnamedCount = unnamedAliasCount = duplicateNameCount = 0;
+    ++generation;
     if (loadDefaults)
         loadDefaultMaterials();
     return;
@@ -128,12 +129,15 @@ void MagnumBZMaterialManager::clear(bool loadDefaults)
 
 void MagnumBZMaterialManager::forceLoadTextures()
 {
+    // Queue everything first so the textures decode in parallel
+    MagnumTextureManager &tm = MagnumTextureManager::instance();
     for (auto m: materials) {
         if (m->getTextureCount() != 0) {
             for (int i = 0; i < m->getTextureCount(); ++i)
-                MagnumTextureManager::instance().getTexture(m->getTexture(i).c_str());
+                tm.requestTexture(m->getTexture(i).c_str());
         }
     }
+    tm.waitForDecodedTextures();
 }
 
 MagnumBZMaterial* MagnumBZMaterialManager::addLegacyIndexedMaterial(const MagnumBZMaterial* material)
@@ -544,6 +548,7 @@ void MagnumBZMaterialManager::rescanTextures() {
             }
         }
     }
+    ++generation;
 }
 
 
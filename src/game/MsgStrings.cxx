@@ -91,6 +91,8 @@ static MsgStringList handleMsgPause(PacketInfo *pi);
 static MsgStringList handleMsgPlayerInfo(PacketInfo *pi);
 static MsgStringList handleMsgPlayerUpdate(PacketInfo *pi);
 static MsgStringList handleMsgPlayerUpdateSmall(PacketInfo *pi);
+static MsgStringList handleMsgPlayerUpdateDelta(PacketInfo *pi);
+static MsgStringList handleMsgPlayerUpdateAck(PacketInfo *pi);
 static MsgStringList handleMsgQueryGame(PacketInfo *pi);
 static MsgStringList handleMsgQueryPlayers(PacketInfo *pi);
 static MsgStringList handleMsgReject(PacketInfo *pi);
@@ -150,6 +152,8 @@ static PacketListEntry PacketList[] =
     PACKET_LIST_ENTRY (MsgPlayerInfo),
     PACKET_LIST_ENTRY (MsgPlayerUpdate),
     PACKET_LIST_ENTRY (MsgPlayerUpdateSmall),
+    PACKET_LIST_ENTRY (MsgPlayerUpdateDelta),
+    PACKET_LIST_ENTRY (MsgPlayerUpdateAck),
     PACKET_LIST_ENTRY (MsgQueryGame),
     PACKET_LIST_ENTRY (MsgQueryPlayers),
     PACKET_LIST_ENTRY (MsgReject),
@@ -839,6 +843,34 @@ static MsgStringList handleMsgPlayerUpdateSmall (PacketInfo *pi)
 }
 
 
+static MsgStringList handleMsgPlayerUpdateDelta (PacketInfo *pi)
+{
+    // not recorded, and only decodable against the earlier updates
+    MsgStringList list = listMsgBasics (pi);
+    const void *d = pi->data;
+    float timestamp;
+    u8 index, sequence, base;
+    d = nboUnpackFloat (d, timestamp);
+    d = nboUnpackUByte (d, index);
+    d = nboUnpackUByte (d, sequence);
+    d = nboUnpackUByte (d, base);
+
+    listPush (list, 1, "player: %s", strPlayer(index).c_str());
+    listPush (list, 2, "sequence: %i  base: %i%s", sequence, base,
+              (sequence == base) ? " (full)" : "");
+
+    return list;
+}
+
+
+static MsgStringList handleMsgPlayerUpdateAck (PacketInfo *pi)
+{
+    // not recorded
+    MsgStringList list = listMsgBasics (pi);
+    return list;
+}
+
+
 static MsgStringList handleMsgQueryGame (PacketInfo *pi)
 {
     // not recorded
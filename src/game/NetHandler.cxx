@@ -235,6 +235,7 @@ than %s:%d\n",
                         ntohs(netPlayer[id]->uaddr.sin_port), n,
                         inet_ntoa(uaddr->sin_addr), ntohs(uaddr->sin_port),
                         udpSocket);
+        netPlayer[id]->bytesIn += len + 4;
 #ifdef NETWORK_STATS
         netPlayer[id]->countMessage(code, len, 0);
 #endif
@@ -280,7 +281,7 @@ NetHandler::NetHandler(PlayerInfo* _info, const struct sockaddr_in &clientAddr,
       tcplen(0), closed(false),
       outmsgOffset(0), outmsgSize(0), outmsgCapacity(0), outmsg(0),
       udpOutputLen(0), udpin(false), udpout(false), toBeKicked(false),
-      time(_info->now)
+      time(_info->now), bytesIn(0), bytesOut(0)
 {
     // update player state
 #ifdef NETWORK_STATS
@@ -313,7 +314,7 @@ NetHandler::NetHandler(const struct sockaddr_in &_clientAddr, int _fd)
       tcplen(0), closed(false),
       outmsgOffset(0), outmsgSize(0), outmsgCapacity(0), outmsg(0),
       udpOutputLen(0), udpin(false), udpout(false), toBeKicked(false),
-      time(TimeKeeper::getCurrent())
+      time(TimeKeeper::getCurrent()), bytesIn(0), bytesOut(0)
 {
     // store address information for player
     AddrLen addr_len = sizeof(_clientAddr);
@@ -518,6 +519,7 @@ int NetHandler::pwrite(const void *b, int l)
     buf = nboUnpackUShort(buf, code);
 //  if (code != MsgPlayerUpdateSmall && code != MsgPlayerUpdate && code != MsgGameTime)
 //    logDebugMessage(1,"send %s len %d\n",MsgStrings::strMsgCode(code),len);
+    bytesOut += l;
 #ifdef NETWORK_STATS
     countMessage(code, len, 1);
 #endif
@@ -534,6 +536,7 @@ int NetHandler::pwrite(const void *b, int l)
         case MsgShotEnd:
         case MsgPlayerUpdate:
         case MsgPlayerUpdateSmall:
+        case MsgPlayerUpdateDelta:
         case MsgGMUpdate:
         case MsgLagPing:
         case MsgGameTime:
@@ -594,6 +597,7 @@ RxStatus NetHandler::tcpReceive()
 
     // clear out message
     tcplen = 0;
+    bytesIn += 4 + len;
 #ifdef NETWORK_STATS
     countMessage(code, len, 0);
 #endif
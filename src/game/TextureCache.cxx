@@ -0,0 +1,673 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+// interface header
+#include "TextureCache.h"
+
+// system headers
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#  include <windows.h>
+#  include <direct.h>
+#else
+#  include <fcntl.h>
+#  include <unistd.h>
+#  include <sys/mman.h>
+#endif
+
+// common headers
+#include "md5.h"
+#include "bzfio.h"
+#include "TextUtils.h"
+#include "StateDatabase.h"
+#include "DirectoryNames.h"
+
+
+// Cache files are only ever read back by the machine that wrote them,
+// so everything is stored in native byte order
+typedef struct
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t channels;
+    uint32_t alpha;
+    uint32_t levels;
+    uint32_t reserved;
+    struct
+    {
+        uint32_t width;
+        uint32_t height;
+        uint64_t offset;
+    } level[MipmappedImage::maxLevels];
+} ImageHeader;
+
+static const char imageMagic[4] = { 'B', 'Z', 'T', 'C' };
+static const uint32_t imageVersion = 1;
+static const char* const indexName = "TextureIndex.txt";
+
+
+// function prototypes
+static void downsample(const unsigned char* src, int srcWidth, int srcHeight,
+                       unsigned char* dst, int dstWidth, int dstHeight,
+                       int channels);
+static bool makeDirs(const std::string& path);
+static bool fileExists(const std::string& name);
+static bool compareUsedDate(const TextureCache::CacheRecord& a,
+                            const TextureCache::CacheRecord& b);
+
+
+/* --- MipmappedImage --- */
+
+MipmappedImage::MipmappedImage() : data(NULL), size(0), mapped(false)
+{
+#ifdef _WIN32
+    fileHandle = INVALID_HANDLE_VALUE;
+    mapHandle = NULL;
+#endif
+}
+
+
+MipmappedImage::MipmappedImage(int width, int height, int channels,
+                               const unsigned char* pixels, bool alpha) :
+    data(NULL), size(0), mapped(false)
+{
+#ifdef _WIN32
+    fileHandle = INVALID_HANDLE_VALUE;
+    mapHandle = NULL;
+#endif
+
+    // lay out the levels, each one starting on a 16 byte boundary
+    ImageHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, imageMagic, sizeof(header.magic));
+    header.version = imageVersion;
+    header.width = width;
+    header.height = height;
+    header.channels = channels;
+    header.alpha = alpha ? 1 : 0;
+
+    size_t offset = (sizeof(ImageHeader) + 15) & ~(size_t)15;
+    int w = width;
+    int h = height;
+    while (header.levels < (uint32_t)maxLevels)
+    {
+        header.level[header.levels].width = w;
+        header.level[header.levels].height = h;
+        header.level[header.levels].offset = offset;
+        header.levels++;
+        offset += ((size_t)w * h * channels + 15) & ~(size_t)15;
+        if ((w == 1) && (h == 1))
+            break;
+        w = (w > 1) ? (w / 2) : 1;
+        h = (h > 1) ? (h / 2) : 1;
+    }
+
+    size = offset;
+    data = new unsigned char[size];
+    memcpy(data, &header, sizeof(header));
+    memset(data + sizeof(header), 0, header.level[0].offset - sizeof(header));
+
+    // each level is filtered down from the one above it
+    memcpy(data + header.level[0].offset, pixels, (size_t)width * height * channels);
+    for (uint32_t i = 1; i < header.levels; i++)
+    {
+        downsample(data + header.level[i - 1].offset,
+                   header.level[i - 1].width, header.level[i - 1].height,
+                   data + header.level[i].offset,
+                   header.level[i].width, header.level[i].height, channels);
+    }
+}
+
+
+MipmappedImage::~MipmappedImage()
+{
+    if (mapped)
+        unmap();
+    else
+        delete[] data;
+}
+
+
+int MipmappedImage::getChannels() const
+{
+    return ((const ImageHeader*)data)->channels;
+}
+
+
+bool MipmappedImage::hasAlpha() const
+{
+    return ((const ImageHeader*)data)->alpha != 0;
+}
+
+
+int MipmappedImage::getLevelCount() const
+{
+    return ((const ImageHeader*)data)->levels;
+}
+
+
+int MipmappedImage::getWidth(int level) const
+{
+    return ((const ImageHeader*)data)->level[level].width;
+}
+
+
+int MipmappedImage::getHeight(int level) const
+{
+    return ((const ImageHeader*)data)->level[level].height;
+}
+
+
+const unsigned char* MipmappedImage::getPixels(int level) const
+{
+    return data + ((const ImageHeader*)data)->level[level].offset;
+}
+
+
+const void* MipmappedImage::getData() const
+{
+    return data;
+}
+
+
+size_t MipmappedImage::getSize() const
+{
+    return size;
+}
+
+
+bool MipmappedImage::validate() const
+{
+    if ((data == NULL) || (size < sizeof(ImageHeader)))
+        return false;
+
+    const ImageHeader* header = (const ImageHeader*)data;
+    if ((memcmp(header->magic, imageMagic, sizeof(imageMagic)) != 0) ||
+            (header->version != imageVersion))
+        return false;
+    if (((header->channels != 3) && (header->channels != 4)) ||
+            (header->levels < 1) || (header->levels > (uint32_t)maxLevels))
+        return false;
+    if ((header->level[0].width != header->width) ||
+            (header->level[0].height != header->height))
+        return false;
+
+    for (uint32_t i = 0; i < header->levels; i++)
+    {
+        const uint64_t bytes = (uint64_t)header->level[i].width *
+                               header->level[i].height * header->channels;
+        if ((header->level[i].offset < sizeof(ImageHeader)) ||
+                (header->level[i].offset > size) ||
+                (bytes > size - header->level[i].offset))
+            return false;
+    }
+    return true;
+}
+
+
+void MipmappedImage::unmap()
+{
+#ifdef _WIN32
+    if (data != NULL)
+        UnmapViewOfFile(data);
+    if (mapHandle != NULL)
+        CloseHandle((HANDLE)mapHandle);
+    if (fileHandle != INVALID_HANDLE_VALUE)
+        CloseHandle((HANDLE)fileHandle);
+    mapHandle = NULL;
+    fileHandle = INVALID_HANDLE_VALUE;
+#else
+    if (data != NULL)
+        munmap(data, size);
+#endif
+    data = NULL;
+    size = 0;
+    mapped = false;
+}
+
+
+/* --- TextureCache --- */
+
+TextureCache::TextureCache() : maxSize(0), dirty(false), tempCount(0)
+{
+}
+
+
+TextureCache::~TextureCache()
+{
+}
+
+
+bool TextureCache::isEnabled() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return !cacheDir.empty() && (maxSize > 0);
+}
+
+
+std::string TextureCache::getFileName(const std::string& key) const
+{
+    return cacheDir + key + ".bztc";
+}
+
+
+std::string TextureCache::getKey(const void* data, size_t size)
+{
+    MD5 md5;
+    const unsigned char* bytes = (const unsigned char*)data;
+    while (size > 0)
+    {
+        const uint32_t chunk = (uint32_t)std::min(size, (size_t)0x40000000);
+        md5.update(bytes, chunk);
+        bytes += chunk;
+        size -= chunk;
+    }
+    md5.finalize();
+    return md5.hexdigest();
+}
+
+
+bool TextureCache::readFile(const std::string& path, std::vector<char>& data)
+{
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == NULL)
+        return false;
+
+    bool success = false;
+    if (fseek(file, 0, SEEK_END) == 0)
+    {
+        const long length = ftell(file);
+        if ((length >= 0) && (fseek(file, 0, SEEK_SET) == 0))
+        {
+            data.resize(length);
+            success = (length == 0) ||
+                      (fread(data.data(), length, 1, file) == 1);
+        }
+    }
+
+    fclose(file);
+    return success;
+}
+
+
+MipmappedImage* TextureCache::findTexture(const std::string& key)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (cacheDir.empty() || (maxSize <= 0))
+        return NULL;
+    const int pos = findRecord(key);
+    if (pos < 0)
+        return NULL;
+
+    const std::string filename = getFileName(key);
+    MipmappedImage* image = new MipmappedImage;
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ,
+                              FILE_SHARE_READ | FILE_SHARE_DELETE, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file != INVALID_HANDLE_VALUE)
+    {
+        image->fileHandle = file;
+        LARGE_INTEGER length;
+        if (GetFileSizeEx(file, &length) && (length.QuadPart > 0))
+        {
+            HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+            if (mapping != NULL)
+            {
+                image->mapHandle = mapping;
+                void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                if (view != NULL)
+                {
+                    image->data = (unsigned char*)view;
+                    image->size = (size_t)length.QuadPart;
+                }
+            }
+        }
+    }
+#else
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if (fd >= 0)
+    {
+        struct stat buf;
+        if ((fstat(fd, &buf) == 0) && (buf.st_size > 0))
+        {
+            void* view = mmap(NULL, buf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (view != MAP_FAILED)
+            {
+                image->data = (unsigned char*)view;
+                image->size = buf.st_size;
+            }
+        }
+        close(fd);
+    }
+#endif
+    image->mapped = true;
+
+    if (!image->validate())
+    {
+        logDebugMessage(1,"TextureCache: dropping bad entry %s\n", key.c_str());
+        delete image;
+        remove(filename.c_str());
+        removeRecord(pos);
+        dirty = true;
+        return NULL;
+    }
+
+    records[pos].usedDate = time(NULL); // update the timestamp
+    dirty = true;
+    return image;
+}
+
+
+bool TextureCache::addTexture(const std::string& key, const MipmappedImage& image)
+{
+    std::string filename, tmpName;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (cacheDir.empty() || ((long long)image.getSize() > maxSize))
+            return false;
+        filename = getFileName(key);
+        // the same image may be decoded on two threads at once
+        tmpName = filename + ".tmp" + TextUtils::format("%u", tempCount++);
+    }
+
+    FILE* file = fopen(tmpName.c_str(), "wb");
+    if (file == NULL)
+        return false;
+    const bool written = (fwrite(image.getData(), image.getSize(), 1, file) == 1);
+    if ((fclose(file) != 0) || !written)
+    {
+        remove(tmpName.c_str());
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+#ifdef _WIN32
+    // no atomic replace on Windows
+    remove(filename.c_str());
+#endif
+    if (rename(tmpName.c_str(), filename.c_str()) != 0)
+    {
+        remove(tmpName.c_str());
+        return false;
+    }
+
+    CacheRecord rec;
+    rec.key = key;
+    rec.size = (int)image.getSize();
+    rec.usedDate = time(NULL);
+
+    const int pos = findRecord(key);
+    if (pos >= 0)
+        records[pos] = rec;
+    else
+    {
+        keyIndex[key] = (int)records.size();
+        records.push_back(rec);
+    }
+    dirty = true;
+
+    logDebugMessage(4,"TextureCache: added %s (%d bytes)\n", key.c_str(), rec.size);
+    return true;
+}
+
+
+int TextureCache::findRecord(const std::string& key) const
+{
+    std::unordered_map<std::string, int>::const_iterator it = keyIndex.find(key);
+    if (it == keyIndex.end())
+        return -1;
+    return it->second;
+}
+
+
+void TextureCache::removeRecord(int index)
+{
+    keyIndex.erase(records[index].key);
+    const int last = (int)records.size() - 1;
+    if (index != last)
+    {
+        records[index] = records[last];
+        keyIndex[records[index].key] = index;
+    }
+    records.pop_back();
+}
+
+
+// after the records were sorted or trimmed
+void TextureCache::rebuildKeyIndex()
+{
+    keyIndex.clear();
+    for (unsigned int i = 0; i < records.size(); i++)
+        keyIndex[records[i].key] = i;
+}
+
+
+bool TextureCache::loadIndex()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    records.clear();
+    keyIndex.clear();
+    dirty = false;
+
+    maxSize = (long long)BZDB.evalInt("maxTextureCacheMB") * 1024 * 1024;
+    if (maxSize < 0)
+        maxSize = 0;
+
+    cacheDir = getCacheDirName() + "textures" + DirectorySeparator;
+    if (!makeDirs(cacheDir))
+    {
+        logDebugMessage(1,"TextureCache: cannot create %s\n", cacheDir.c_str());
+        cacheDir = "";
+        return false;
+    }
+
+    FILE* file = fopen((cacheDir + indexName).c_str(), "r");
+    if (file == NULL)
+        return false;
+
+    char buffer[1024];
+    while (fgets(buffer, 1024, file) != NULL)
+    {
+        std::vector<std::string> tokens = TextUtils::tokenize(buffer, " \r\n");
+        if (tokens.empty() || (tokens[0][0] == '#'))
+            continue;
+        if (tokens.size() != 3)
+        {
+            logDebugMessage(1,"TextureCache::loadIndex (bad line): %s", buffer);
+            continue;
+        }
+
+        CacheRecord rec;
+        rec.key = tokens[0];
+        rec.size = strtoul(tokens[1].c_str(), NULL, 10);
+        rec.usedDate = strtoul(tokens[2].c_str(), NULL, 10);
+        if (!fileExists(getFileName(rec.key)))
+            continue;
+        const int pos = findRecord(rec.key);
+        if (pos >= 0)
+            records[pos] = rec;
+        else
+        {
+            keyIndex[rec.key] = (int)records.size();
+            records.push_back(rec);
+        }
+    }
+
+    fclose(file);
+    return true;
+}
+
+
+bool TextureCache::saveIndex()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (cacheDir.empty())
+        return false;
+    if (!dirty)
+        return true;
+
+    std::sort(records.begin(), records.end(), compareUsedDate);
+    rebuildKeyIndex();
+
+    const std::string indexPath = cacheDir + indexName;
+    const std::string tmpIndexName = indexPath + ".tmp";
+
+    FILE* file = fopen(tmpIndexName.c_str(), "w");
+    if (file == NULL)
+        return false;
+
+    const time_t nowTime = time(NULL);
+    fprintf(file, "#\n");
+    fprintf(file, "# BZFlag Texture Cache Index - %s", ctime(&nowTime));
+    fprintf(file, "# <md5check>  <filesize>  <lastused>\n");
+    fprintf(file, "#\n\n");
+
+    for (unsigned int i = 0; i < records.size(); i++)
+    {
+        const CacheRecord& rec = records[i];
+        fprintf(file, "%s %d %llu\n", rec.key.c_str(), rec.size,
+                (long long unsigned)rec.usedDate);
+    }
+
+    fclose(file);
+
+#ifdef _WIN32
+    remove(indexPath.c_str());
+#endif
+
+    if (rename(tmpIndexName.c_str(), indexPath.c_str()) != 0)
+        return false;
+    dirty = false;
+    return true;
+}
+
+
+void TextureCache::limitCacheSize()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    maxSize = (long long)BZDB.evalInt("maxTextureCacheMB") * 1024 * 1024;
+    if (maxSize < 0)
+        maxSize = 0;
+
+    long long currentSize = 0;
+    for (unsigned int i = 0; i < records.size(); i++)
+        currentSize += records[i].size;
+
+    std::sort(records.begin(), records.end(), compareUsedDate);
+
+    while ((currentSize > maxSize) && (records.size() > 0))
+    {
+        TextureCache::CacheRecord& rec = records.back();
+        currentSize -= rec.size;
+        remove(getFileName(rec.key).c_str());
+        records.pop_back();
+        dirty = true;
+    }
+    rebuildKeyIndex();
+
+    return;
+}
+
+
+/* --- helpers --- */
+
+static void downsample(const unsigned char* src, int srcWidth, int srcHeight,
+                       unsigned char* dst, int dstWidth, int dstHeight,
+                       int channels)
+{
+    // 2x2 box filter, a dimension that is already 1 is filtered in the
+    // other direction only
+    const size_t srcStride = (size_t)srcWidth * channels;
+    for (int y = 0; y < dstHeight; y++)
+    {
+        const unsigned char* row0 = src + (size_t)std::min(2 * y, srcHeight - 1) * srcStride;
+        const unsigned char* row1 = src + (size_t)std::min(2 * y + 1, srcHeight - 1) * srcStride;
+        for (int x = 0; x < dstWidth; x++)
+        {
+            const int x0 = std::min(2 * x, srcWidth - 1) * channels;
+            const int x1 = std::min(2 * x + 1, srcWidth - 1) * channels;
+            for (int c = 0; c < channels; c++)
+            {
+                *dst++ = (unsigned char)((row0[x0 + c] + row0[x1 + c] +
+                                          row1[x0 + c] + row1[x1 + c] + 2) >> 2);
+            }
+        }
+    }
+}
+
+
+static bool makeDirs(const std::string& path)
+{
+#ifndef _WIN32
+    std::string::size_type i = 0;
+#else
+    std::string::size_type i = 2; // don't stat on a drive, it will fail
+#endif
+    while ((i = path.find(DirectorySeparator, i + 1)) != std::string::npos)
+    {
+        const std::string dir = path.substr(0, i);
+        if (fileExists(dir))
+            continue;
+#ifdef _WIN32
+        if (_mkdir(dir.c_str()) != 0)
+            return false;
+#else
+        if (mkdir(dir.c_str(), 0777) != 0)
+            return false;
+#endif
+    }
+    return true;
+}
+
+
+static bool fileExists(const std::string& name)
+{
+    struct stat buf;
+#ifndef _WIN32
+    return (stat(name.c_str(), &buf) == 0);
+#else
+    return (_stat(name.c_str(), (struct _stat *) &buf) == 0);
+#endif
+}
+
+
+static bool compareUsedDate(const TextureCache::CacheRecord& a,
+                            const TextureCache::CacheRecord& b)
+{
+    // oldest last
+    return (a.usedDate > b.usedDate);
+}
+
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
@@ -21,209 +21,181 @@
 
 #include "EnhancedPhongGL.h"
 
+#include "DrawModeManager.h"
+#include "RenderMaterialCache.h"
+
 using namespace Magnum;
 
 #define MAGNUMROWCOL(r, c) (r+c*3)
 #define INTROWCOL(r, c) (r+c*4)
 
-BZMaterialDrawMode::BZMaterialDrawMode() {
-    _shader = new EnhancedPhongGL{EnhancedPhongGL::Configuration{}
-        .setFlags(
-            EnhancedPhongGL::Flag::DiffuseTexture |
-            EnhancedPhongGL::Flag::AmbientTexture |
-            EnhancedPhongGL::Flag::AlphaMask |
-            EnhancedPhongGL::Flag::TextureTransformation)};
-    _shaderUntex = new EnhancedPhongGL{EnhancedPhongGL::Configuration{}};
+void QueuedDrawMode::beginPass(SceneGraph::Camera3D& camera, bool sorted) {
+    RENDERMATERIALS.validate();
+    _list.clear();
+    _camera = &camera;
+    _sorted = sorted;
+    _inPass = true;
 }
 
-void BZMaterialDrawMode::draw(const Matrix4& transformationMatrix, SceneGraph::Camera3D& camera, const MagnumBZMaterial* mat, GL::Mesh& mesh, Object3D* obj)  {
-    MagnumTextureManager &tm = MagnumTextureManager::instance();
-
-    auto toMagnumColor = [](const float *cp) {
-        return Color3{cp[0], cp[1], cp[2]};
-    };
+void QueuedDrawMode::endPass() {
+    _inPass = false;
+    if (_list.size() == 0)
+        return;
+    if (_sorted)
+        _list.sort();
+    preparePass(*_camera);
+    _list.submit(*this);
+    _list.clear();
+    DRAWMODEMGR.addPassStats(_list.getStats());
+}
 
+void QueuedDrawMode::draw(const Matrix4& transformationMatrix, SceneGraph::Camera3D& camera, const MagnumBZMaterial* mat, GL::Mesh& mesh, Object3D* obj) {
     // NULL material just skips render
-    if (mat) {
-        Math::Vector3<float> abstranslation = {0.0f, 0.0f, -10.0f};   // Default light position behind camera if sun does not exist
-        if (_lightObj)
-            abstranslation = camera.cameraMatrix().transformPoint(_lightObj->absoluteTransformationMatrix().translation());
-
-        Color3 dyncol;
-        if (mat->getDynamicColor() != -1) {
-            auto * dc = DYNCOLORMGR.getColor(mat->getDynamicColor());
-            if (dc) {
-                dyncol = toMagnumColor(dc->getColor());
-            }
-        }
+    if (!mat)
+        return;
+
+    if (!_inPass) {
+        beginPass(camera, false);
+        draw(transformationMatrix, camera, mat, mesh, obj);
+        endPass();
+        return;
+    }
 
-        if (mat->getNoCulling())
-            GL::Renderer::disable(GL::Renderer::Feature::FaceCulling);
-        else
-            GL::Renderer::enable(GL::Renderer::Feature::FaceCulling);
+    const RenderMaterial* rec = RENDERMATERIALS.get(mat);
+    _list.add(chooseShader(*rec), usesTextures() ? rec->texture : NULL, rec, mesh, transformationMatrix);
+}
 
-        TextureData t = tm.getTexture(mat->getTexture(0).c_str());
-        if (t.texture) {
-            float alphathresh = mat->getAlphaThreshold();
-            // The map "duck dodgers" set alphathresh=1 for many materials
-            // and the old client still rendered them. Max out alphathresh at
-            // 0.999, since some map makers might just max out the value
-            // to get transparency working.
-            if (alphathresh > 0.999f) alphathresh = 0.999f;
-
-            Matrix3 texmat;
-
-            if (mat->getTextureMatrix(0) != -1) {
-                const TextureMatrix *texmat_internal = TEXMATRIXMGR.getMatrix(mat->getTextureMatrix(0));
-                
-                
-                auto &tmd = texmat.data();
-                const float *tmid = texmat_internal->getMatrix();
-
-                // BZFlag TextureMatrix packs the data weirdly
-                tmd[MAGNUMROWCOL(0, 0)] = tmid[INTROWCOL(0, 0)];
-                tmd[MAGNUMROWCOL(0, 1)] = tmid[INTROWCOL(0, 1)];
-                tmd[MAGNUMROWCOL(1, 0)] = tmid[INTROWCOL(1, 0)];
-                tmd[MAGNUMROWCOL(1, 1)] = tmid[INTROWCOL(1, 1)];
-                tmd[MAGNUMROWCOL(0, 2)] = tmid[INTROWCOL(0, 3)];
-                tmd[MAGNUMROWCOL(1, 2)] = tmid[INTROWCOL(1, 3)];
-                
-            }
-            
-            (*_shader).bindDiffuseTexture(*t.texture)
-                .bindAmbientTexture(*t.texture)
-                .setDiffuseColor(Color4{toMagnumColor(mat->getDiffuse()), 0.0f})
-                .setAmbientColor(mat->getNoLighting() ? Color4{1.0f*toMagnumColor(mat->getDiffuse()) + toMagnumColor(mat->getEmission()) + dyncol, mat->getDiffuse()[3]} : Color4{0.2*toMagnumColor(mat->getAmbient()) + toMagnumColor(mat->getEmission()) + dyncol, mat->getDiffuse()[3]})
-                .setSpecularColor(Color4{toMagnumColor(mat->getSpecular()), 0.0f})
-                .setShininess(mat->getShininess())
-                .setAlphaMask(alphathresh)
-                .setNormalMatrix(transformationMatrix.normalMatrix())
-                .setTransformationMatrix(transformationMatrix)
-                .setProjectionMatrix(camera.projectionMatrix())
-                .setLightPositions({
-                    {abstranslation, 0.0f}
-                })
-                .setTextureMatrix(texmat)
-                .draw(mesh);
-        } else {
-            (*_shaderUntex)
-                .setDiffuseColor(Color4{toMagnumColor(mat->getDiffuse()), 0.0f})
-                .setAmbientColor(mat->getNoLighting() ? Color4{1.0f*toMagnumColor(mat->getDiffuse()) + toMagnumColor(mat->getEmission()) + dyncol, mat->getDiffuse()[3]} : Color4{0.2*toMagnumColor(mat->getAmbient()) + toMagnumColor(mat->getEmission()) + dyncol, mat->getDiffuse()[3]})
-                .setSpecularColor(Color4{toMagnumColor(mat->getSpecular()), 0.0f})
-                .setShininess(mat->getShininess())
-                .setNormalMatrix(transformationMatrix.normalMatrix())
-                .setTransformationMatrix(transformationMatrix)
-                .setProjectionMatrix(camera.projectionMatrix())
-                .setLightPositions({
-                    {abstranslation, 0.0f}
-                })
-                .draw(mesh);
-        }
-    }
+void QueuedDrawMode::setCulling(bool enable) {
+    if (enable)
+        GL::Renderer::enable(GL::Renderer::Feature::FaceCulling);
+    else
+        GL::Renderer::disable(GL::Renderer::Feature::FaceCulling);
+}
+
+BZMaterialDrawMode::BZMaterialDrawMode() :
+    BZMaterialDrawMode(
+        new EnhancedPhongGL{EnhancedPhongGL::Configuration{}
+            .setFlags(
+                EnhancedPhongGL::Flag::DiffuseTexture |
+                EnhancedPhongGL::Flag::AmbientTexture |
+                EnhancedPhongGL::Flag::AlphaMask |
+                EnhancedPhongGL::Flag::TextureTransformation)},
+        new EnhancedPhongGL{EnhancedPhongGL::Configuration{}}) {
 }
 
-BZMaterialShadowMappedDrawMode::BZMaterialShadowMappedDrawMode() {
-    _shader = new EnhancedPhongGL{EnhancedPhongGL::Configuration{}
-        .setFlags(
-            EnhancedPhongGL::Flag::DiffuseTexture |
-            EnhancedPhongGL::Flag::AmbientTexture |
-            EnhancedPhongGL::Flag::AlphaMask |
-            EnhancedPhongGL::Flag::TextureTransformation |
-            EnhancedPhongGL::Flag::ShadowMap)};
-    _shaderUntex = new EnhancedPhongGL{EnhancedPhongGL::Configuration{}
-        .setFlags(
-            EnhancedPhongGL::Flag::ShadowMap)};
+BZMaterialDrawMode::BZMaterialDrawMode(EnhancedPhongGL* shader, EnhancedPhongGL* shaderUntex) :
+    _shader(shader),
+    _shaderUntex(shaderUntex) {
+    _prepared[TexturedShader] = _prepared[UntexturedShader] = false;
 }
 
-void BZMaterialShadowMappedDrawMode::draw(const Matrix4& transformationMatrix, SceneGraph::Camera3D& camera, const MagnumBZMaterial* mat, GL::Mesh& mesh, Object3D* obj)  {
-    MagnumTextureManager &tm = MagnumTextureManager::instance();
+int BZMaterialDrawMode::chooseShader(const RenderMaterial& mat) {
+    return mat.texture ? TexturedShader : UntexturedShader;
+}
 
-    auto toMagnumColor = [](const float *cp) {
-        return Color3{cp[0], cp[1], cp[2]};
-    };
+void BZMaterialDrawMode::preparePass(SceneGraph::Camera3D& camera) {
+    _passCamera = &camera;
+    _prepared[TexturedShader] = _prepared[UntexturedShader] = false;
 
-    // NULL material just skips render
-    if (mat) {
-        Math::Vector3<float> abstranslation = {0.0f, 0.0f, -10.0f};   // Default light position behind camera if sun does not exist
-        if (_lightObj)
-            abstranslation = camera.cameraMatrix().transformPoint(_lightObj->absoluteTransformationMatrix().translation());
-
-        auto lightSpaceMat = _lightCamera->projectionMatrix() * _lightCamera->cameraMatrix() * camera.cameraMatrix().inverted();
-        Color3 dyncol;
-        if (mat->getDynamicColor() != -1) {
-            auto * dc = DYNCOLORMGR.getColor(mat->getDynamicColor());
-            if (dc) {
-                dyncol = toMagnumColor(dc->getColor());
-            }
-        }
+    // Default light position behind camera if sun does not exist
+    _lightPosition = {0.0f, 0.0f, -10.0f};
+    if (_lightObj)
+        _lightPosition = camera.cameraMatrix().transformPoint(_lightObj->absoluteTransformationMatrix().translation());
+}
 
-        if (mat->getNoCulling())
-            GL::Renderer::disable(GL::Renderer::Feature::FaceCulling);
-        else
-            GL::Renderer::enable(GL::Renderer::Feature::FaceCulling);
+void BZMaterialDrawMode::prepareShader(EnhancedPhongGL& shader) {
+    shader
+        .setProjectionMatrix(_passCamera->projectionMatrix())
+        .setLightPositions({
+            {_lightPosition, 0.0f}
+        });
+}
 
-        TextureData t = tm.getTexture(mat->getTexture(0).c_str());
-        if (t.texture) {
-            float alphathresh = mat->getAlphaThreshold();
-            // The map "duck dodgers" set alphathresh=1 for many materials
-            // and the old client still rendered them. Max out alphathresh at
-            // 0.999, since some map makers might just max out the value
-            // to get transparency working.
-            if (alphathresh > 0.999f) alphathresh = 0.999f;
-
-            Matrix3 texmat;
-
-            if (mat->getTextureMatrix(0) != -1) {
-                const TextureMatrix *texmat_internal = TEXMATRIXMGR.getMatrix(mat->getTextureMatrix(0));
-                
-                
-                auto &tmd = texmat.data();
-                const float *tmid = texmat_internal->getMatrix();
-
-                // BZFlag TextureMatrix packs the data weirdly
-                tmd[MAGNUMROWCOL(0, 0)] = tmid[INTROWCOL(0, 0)];
-                tmd[MAGNUMROWCOL(0, 1)] = tmid[INTROWCOL(0, 1)];
-                tmd[MAGNUMROWCOL(1, 0)] = tmid[INTROWCOL(1, 0)];
-                tmd[MAGNUMROWCOL(1, 1)] = tmid[INTROWCOL(1, 1)];
-                tmd[MAGNUMROWCOL(0, 2)] = tmid[INTROWCOL(0, 3)];
-                tmd[MAGNUMROWCOL(1, 2)] = tmid[INTROWCOL(1, 3)];
-                
-            }
-            
-            (*_shader).bindDiffuseTexture(*t.texture)
-                .bindAmbientTexture(*t.texture)
-                .setDiffuseColor(Color4{toMagnumColor(mat->getDiffuse()), 0.0f})
-                .setAmbientColor(mat->getNoLighting() ? Color4{1.0f*toMagnumColor(mat->getDiffuse()) + toMagnumColor(mat->getEmission()) + dyncol, mat->getDiffuse()[3]} : Color4{0.2*toMagnumColor(mat->getAmbient()) + toMagnumColor(mat->getEmission()) + dyncol, mat->getDiffuse()[3]})
-                .setSpecularColor(Color4{toMagnumColor(mat->getSpecular()), 0.0f})
-                .setShininess(mat->getShininess())
-                .setAlphaMask(alphathresh)
-                .setNormalMatrix(transformationMatrix.normalMatrix())
-                .setTransformationMatrix(transformationMatrix)
-                .setProjectionMatrix(camera.projectionMatrix())
-                .setLightPositions({
-                    {abstranslation, 0.0f}
-                })
-                .setTextureMatrix(texmat)
-                .setLightSpaceMatrix(lightSpaceMat)
-                .bindShadowMapTexture(*_shadowMapTex)
-                .draw(mesh);
-        } else {
-            (*_shaderUntex)
-                .setDiffuseColor(Color4{toMagnumColor(mat->getDiffuse()), 0.0f})
-                .setAmbientColor(mat->getNoLighting() ? Color4{1.0f*toMagnumColor(mat->getDiffuse()) + toMagnumColor(mat->getEmission()) + dyncol, mat->getDiffuse()[3]} : Color4{0.2*toMagnumColor(mat->getAmbient()) + toMagnumColor(mat->getEmission()) + dyncol, mat->getDiffuse()[3]})
-                .setSpecularColor(Color4{toMagnumColor(mat->getSpecular()), 0.0f})
-                .setShininess(mat->getShininess())
-                .setNormalMatrix(transformationMatrix.normalMatrix())
-                .setTransformationMatrix(transformationMatrix)
-                .setProjectionMatrix(camera.projectionMatrix())
-                .setLightPositions({
-                    {abstranslation, 0.0f}
-                })
-                .setLightSpaceMatrix(lightSpaceMat)
-                .bindShadowMapTexture(*_shadowMapTex)
-                .draw(mesh);
+void BZMaterialDrawMode::setShader(int shader) {
+    _current = shader == TexturedShader ? _shader : _shaderUntex;
+    if (!_prepared[shader]) {
+        prepareShader(*_current);
+        _prepared[shader] = true;
+    }
+}
+
+void BZMaterialDrawMode::bindTexture(GL::Texture2D* texture) {
+    (*_shader).bindDiffuseTexture(*texture)
+        .bindAmbientTexture(*texture);
+}
+
+void BZMaterialDrawMode::setMaterial(int shader, const RenderMaterial& mat) {
+    Color3 dyncol;
+    if (mat.dynamicColor != -1) {
+        auto * dc = DYNCOLORMGR.getColor(mat.dynamicColor);
+        if (dc) {
+            const float *cp = dc->getColor();
+            dyncol = Color3{cp[0], cp[1], cp[2]};
         }
     }
+
+    (*_current)
+        .setDiffuseColor(Color4{mat.diffuse, 0.0f})
+        .setAmbientColor(Color4{mat.ambient + dyncol, mat.alpha})
+        .setSpecularColor(Color4{mat.specular, 0.0f})
+        .setShininess(mat.shininess);
+
+    if (shader != TexturedShader)
+        return;
+
+    Matrix3 texmat;
+
+    if (mat.textureMatrix != -1) {
+        const TextureMatrix *texmat_internal = TEXMATRIXMGR.getMatrix(mat.textureMatrix);
+
+        auto &tmd = texmat.data();
+        const float *tmid = texmat_internal->getMatrix();
+
+        // BZFlag TextureMatrix packs the data weirdly
+        tmd[MAGNUMROWCOL(0, 0)] = tmid[INTROWCOL(0, 0)];
+        tmd[MAGNUMROWCOL(0, 1)] = tmid[INTROWCOL(0, 1)];
+        tmd[MAGNUMROWCOL(1, 0)] = tmid[INTROWCOL(1, 0)];
+        tmd[MAGNUMROWCOL(1, 1)] = tmid[INTROWCOL(1, 1)];
+        tmd[MAGNUMROWCOL(0, 2)] = tmid[INTROWCOL(0, 3)];
+        tmd[MAGNUMROWCOL(1, 2)] = tmid[INTROWCOL(1, 3)];
+    }
+
+    (*_current)
+        .setAlphaMask(mat.alphaThreshold)
+        .setTextureMatrix(texmat);
+}
+
+void BZMaterialDrawMode::drawCommand(const RenderCommand& command) {
+    (*_current)
+        .setNormalMatrix(command.transformation.normalMatrix())
+        .setTransformationMatrix(command.transformation)
+        .draw(*command.mesh);
+}
+
+BZMaterialShadowMappedDrawMode::BZMaterialShadowMappedDrawMode() :
+    BZMaterialDrawMode(
+        new EnhancedPhongGL{EnhancedPhongGL::Configuration{}
+            .setFlags(
+                EnhancedPhongGL::Flag::DiffuseTexture |
+                EnhancedPhongGL::Flag::AmbientTexture |
+                EnhancedPhongGL::Flag::AlphaMask |
+                EnhancedPhongGL::Flag::TextureTransformation |
+                EnhancedPhongGL::Flag::ShadowMap)},
+        new EnhancedPhongGL{EnhancedPhongGL::Configuration{}
+            .setFlags(
+                EnhancedPhongGL::Flag::ShadowMap)}) {
+}
+
+void BZMaterialShadowMappedDrawMode::preparePass(SceneGraph::Camera3D& camera) {
+    BZMaterialDrawMode::preparePass(camera);
+    _lightSpaceMat = _lightCamera->projectionMatrix() * _lightCamera->cameraMatrix() * camera.cameraMatrix().inverted();
+}
+
+void BZMaterialShadowMappedDrawMode::prepareShader(EnhancedPhongGL& shader) {
+    BZMaterialDrawMode::prepareShader(shader);
+    shader
+        .setLightSpaceMatrix(_lightSpaceMat)
+        .bindShadowMapTexture(*_shadowMapTex);
 }
 
 BasicTexturedShaderDrawMode::BasicTexturedShaderDrawMode() {
@@ -231,32 +203,19 @@ BasicTexturedShaderDrawMode::BasicTexturedShaderDrawMode() {
 }
 
 void BasicTexturedShaderDrawMode::draw(const Matrix4& transformationMatrix, SceneGraph::Camera3D& camera, const MagnumBZMaterial* mat, GL::Mesh& mesh, Object3D* obj)  {
-    MagnumTextureManager &tm = MagnumTextureManager::instance();
-
-    auto toMagnumColor = [](const float *cp) {
-        return Color3{cp[0], cp[1], cp[2]};
-    };
-
     // NULL material just skips render
     if (mat) {
+        RENDERMATERIALS.validate();
+        const RenderMaterial* rec = RENDERMATERIALS.get(mat);
 
-        Color3 dyncol;
-        if (mat->getDynamicColor() != -1) {
-            auto * dc = DYNCOLORMGR.getColor(mat->getDynamicColor());
-            if (dc) {
-                dyncol = toMagnumColor(dc->getColor());
-            }
-        }
-
-        if (mat->getNoCulling())
+        if (rec->noCulling)
             GL::Renderer::disable(GL::Renderer::Feature::FaceCulling);
         else
             GL::Renderer::enable(GL::Renderer::Feature::FaceCulling);
 
-        TextureData t = tm.getTexture(mat->getTexture(0).c_str());
-        if (t.texture) {
-            (*_shader).bindTexture(*t.texture)
-                .setColor(Color3{toMagnumColor(mat->getDiffuse())})
+        if (rec->texture) {
+            (*_shader).bindTexture(*rec->texture)
+                .setColor(rec->diffuse)
                 .draw(mesh);
         }
     }
@@ -266,19 +225,14 @@ DepthMapDrawMode::DepthMapDrawMode() {
     _shader = new DepthMapShader();
 }
 
-void DepthMapDrawMode::draw(const Matrix4& transformationMatrix, SceneGraph::Camera3D& camera, const MagnumBZMaterial* mat, GL::Mesh& mesh, Object3D* obj)  {
-    // NULL material just skips render
-    // Perhaps exclude transparent materials here to simplify shadow rendering...
-    if (mat) {
-
-        if (mat->getNoCulling())
-            GL::Renderer::disable(GL::Renderer::Feature::FaceCulling);
-        else
-            GL::Renderer::enable(GL::Renderer::Feature::FaceCulling);
+void DepthMapDrawMode::preparePass(SceneGraph::Camera3D& camera) {
+    (*_shader)
+        .setProjectionMatrix(camera.projectionMatrix());
+}
 
-        (*_shader)
-            .setTransformationMatrix(transformationMatrix)
-            .setProjectionMatrix(camera.projectionMatrix())
-            .draw(mesh);
-    }
+// Perhaps exclude transparent materials here to simplify shadow rendering...
+void DepthMapDrawMode::drawCommand(const RenderCommand& command) {
+    (*_shader)
+        .setTransformationMatrix(command.transformation)
+        .draw(*command.mesh);
 }
@@ -1,3 +1,8 @@
 #include "DrawModeManager.h"
 
-DrawModeManager DRAWMODEMGR;
\ No newline at end of file
+DrawModeManager DRAWMODEMGR;
+
+void DrawModeManager::beginFrame() {
+    _lastFrameStats = _frameStats;
+    _frameStats = RenderStats{};
+}
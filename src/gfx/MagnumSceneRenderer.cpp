@@ -36,6 +36,8 @@
 
 #include "TimeKeeper.h"
 
+#include "ZoneProfiler.h"
+
 using namespace Magnum;
 
 MagnumSceneRenderer::MagnumSceneRenderer() {}
@@ -224,6 +226,9 @@ void MagnumSceneRenderer::addPipelineTex(const std::string& name, TextureData da
 
 // Render scene from POV of camera using current drawmode and framebuffer
 void MagnumSceneRenderer::renderScene(SceneGraph::Camera3D* camera) {
+    PROFILE_ZONE("renderScene");
+    DRAWMODEMGR.beginFrame();
+
     GL::Renderer::enable(GL::Renderer::Feature::DepthTest);
     GL::Renderer::enable(GL::Renderer::Feature::FaceCulling);
     GL::Renderer::disable(GL::Renderer::Feature::ScissorTest);
@@ -239,13 +244,10 @@ void MagnumSceneRenderer::renderScene(SceneGraph::Camera3D* camera) {
         DRAWMODEMGR.setDrawMode(&_bzmatMode);
     }
     
-    if (auto* dg = DGRPMGR.getGroup("WorldDrawables"))
-        camera->draw(*dg);
+    drawGroup(camera, "WorldDrawables", true);
     GL::Renderer::enable(GL::Renderer::Feature::Blending);
-    if (auto* dg = DGRPMGR.getGroup("TankDrawables"))
-        camera->draw(*dg);
-    if (auto* dg = DGRPMGR.getGroup("WorldTransDrawables"))
-        camera->draw(*dg);
+    drawGroup(camera, "TankDrawables", false);
+    drawGroup(camera, "WorldTransDrawables", false);
    
 }
 
@@ -274,17 +276,26 @@ void MagnumSceneRenderer::renderSceneToHDR(SceneGraph::Camera3D* camera) {
     GL::Renderer::enable(GL::Renderer::Feature::FaceCulling);
     GL::Renderer::disable(GL::Renderer::Feature::ScissorTest);
     GL::Renderer::disable(GL::Renderer::Feature::Blending);
-    if (auto* dg = DGRPMGR.getGroup("WorldDrawables"))
-        camera->draw(*dg);
+    drawGroup(camera, "WorldDrawables", true);
     GL::Renderer::enable(GL::Renderer::Feature::Blending);
-    if (auto* dg = DGRPMGR.getGroup("TankDrawables"))
-        camera->draw(*dg);
-    if (auto* dg = DGRPMGR.getGroup("WorldTransDrawables"))
-        camera->draw(*dg);
+    drawGroup(camera, "TankDrawables", false);
+    drawGroup(camera, "WorldTransDrawables", false);
     GL::defaultFramebuffer.bind();
 }
 
+void MagnumSceneRenderer::drawGroup(SceneGraph::Camera3D* camera, const char* name, bool sorted) {
+    PROFILE_ZONE("drawGroup");
+    auto* dg = DGRPMGR.getGroup(name);
+    if (!dg)
+        return;
+    DrawMode* mode = DRAWMODEMGR.getDrawMode();
+    mode->beginPass(*camera, sorted);
+    camera->draw(*dg);
+    mode->endPass();
+}
+
 void MagnumSceneRenderer::renderLightDepthMap() {
+    PROFILE_ZONE("renderLightDepthMap");
     TextureData depthTexData = getPipelineTex("DepthMapTex");
     // Much of this should only be done when the sun moves.
     float worldDiag = 1.414f*BZDBCache::worldSize;
@@ -304,12 +315,10 @@ void MagnumSceneRenderer::renderLightDepthMap() {
 
     GL::Renderer::setFaceCullingMode(GL::Renderer::PolygonFacing::Front);
     // Now render to texture
-    if (auto* dg = DGRPMGR.getGroup("WorldDrawables"))
-        _lightCamera->draw(*dg);
-    if (auto* dg = DGRPMGR.getGroup("TankDrawables"))
-        _lightCamera->draw(*dg);
-    if (auto* dg = DGRPMGR.getGroup("WorldTransDrawables"))
-        _lightCamera->draw(*dg);
+    // Depth only, so order doesn't matter
+    drawGroup(_lightCamera, "WorldDrawables", true);
+    drawGroup(_lightCamera, "TankDrawables", true);
+    drawGroup(_lightCamera, "WorldTransDrawables", true);
     GL::Renderer::setFaceCullingMode(GL::Renderer::PolygonFacing::Back);
 
     GL::defaultFramebuffer.bind();
@@ -412,12 +421,20 @@ void MagnumSceneRenderer::drawSettings(const char *title, bool *p_open) {
     }
     ImGui::Separator();
     ImGui::Checkbox("Enable Clouds", &_enableClouds);
+    ImGui::Separator();
+    const RenderStats& stats = DRAWMODEMGR.getFrameStats();
+    ImGui::Text("Draws: %u", stats.commands);
+    ImGui::Text("Shader changes: %u", stats.shaderChanges);
+    ImGui::Text("Texture changes: %u", stats.textureChanges);
+    ImGui::Text("Culling changes: %u", stats.cullChanges);
+    ImGui::Text("Material changes: %u", stats.materialChanges);
     ImGui::End();
 }
 
 // Render the 16-bit depth buffer to a regular rgba texture for presentation
 // Not really necessary, but a good demo on how to do something like this.
 void MagnumSceneRenderer::renderClouds(SceneGraph::Camera3D* camera) {
+    PROFILE_ZONE("renderClouds");
     Object3D* world = SOMGR.getObj("World");
 
     auto correctionmat = world->transformationMatrix().inverted();
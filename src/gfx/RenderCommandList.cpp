@@ -0,0 +1,87 @@
+#include "RenderCommandList.h"
+
+#include <algorithm>
+
+using namespace Magnum;
+
+void RenderStats::add(const RenderStats& s) {
+    commands += s.commands;
+    shaderChanges += s.shaderChanges;
+    textureChanges += s.textureChanges;
+    cullChanges += s.cullChanges;
+    materialChanges += s.materialChanges;
+}
+
+// Most expensive switch in the highest bits:
+// 8 bits shader, 23 bits texture, 1 bit culling, 32 bits material
+uint64_t RenderCommandList::makeKey(int shader, unsigned int textureKey, bool culling, unsigned int materialKey) {
+    return ((uint64_t)(shader & 0xFF) << 56) |
+        ((uint64_t)(textureKey & 0x7FFFFF) << 33) |
+        ((uint64_t)(culling ? 0 : 1) << 32) |
+        (uint64_t)materialKey;
+}
+
+void RenderCommandList::clear() {
+    _commands.clear();
+}
+
+void RenderCommandList::add(int shader, GL::Texture2D* texture, const RenderMaterial* material, GL::Mesh& mesh, const Matrix4& transformation) {
+    RenderCommand c;
+    c.key = makeKey(shader, texture ? material->textureKey : 0, !material->noCulling, material->materialKey);
+    c.order = (unsigned int)_commands.size();
+    c.shader = shader;
+    c.texture = texture;
+    c.material = material;
+    c.mesh = &mesh;
+    c.transformation = transformation;
+    _commands.push_back(c);
+}
+
+void RenderCommandList::sort() {
+    std::sort(_commands.begin(), _commands.end(), [](const RenderCommand& a, const RenderCommand& b) {
+        if (a.key != b.key)
+            return a.key < b.key;
+        return a.order < b.order;
+    });
+}
+
+void RenderCommandList::submit(RenderCommandVisitor& visitor) {
+    _stats = RenderStats{};
+
+    int shader = -1;
+    int culling = -1;
+    GL::Texture2D* texture = NULL;
+    const RenderMaterial* material = NULL;
+
+    for (const RenderCommand& c: _commands) {
+        const RenderMaterial& mat = *c.material;
+        bool shaderChanged = false;
+
+        if (c.shader != shader) {
+            shader = c.shader;
+            shaderChanged = true;
+            visitor.setShader(shader);
+            _stats.shaderChanges++;
+        }
+        const int cull = mat.noCulling ? 0 : 1;
+        if (cull != culling) {
+            culling = cull;
+            visitor.setCulling(cull != 0);
+            _stats.cullChanges++;
+        }
+        // Untextured draws leave the bound texture alone
+        if (c.texture && c.texture != texture) {
+            texture = c.texture;
+            visitor.bindTexture(texture);
+            _stats.textureChanges++;
+        }
+        if (shaderChanged || c.material != material) {
+            material = c.material;
+            visitor.setMaterial(shader, mat);
+            _stats.materialChanges++;
+        }
+
+        visitor.drawCommand(c);
+        _stats.commands++;
+    }
+}
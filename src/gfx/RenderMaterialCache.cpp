@@ -0,0 +1,78 @@
+#include "RenderMaterialCache.h"
+
+#include "MagnumBZMaterial.h"
+#include "MagnumTextureManager.h"
+
+using namespace Magnum;
+
+RenderMaterialCache RENDERMATERIALS;
+
+void RenderMaterialCache::validate() {
+    const unsigned int matgen = MAGNUMMATERIALMGR.getGeneration();
+    const unsigned int texgen = MagnumTextureManager::instance().getTextureGeneration();
+    if (matgen != _materialGeneration || texgen != _textureGeneration) {
+        clear();
+        _materialGeneration = matgen;
+        _textureGeneration = texgen;
+    }
+}
+
+void RenderMaterialCache::clear() {
+    _lookup.clear();
+    _records.clear();
+    _textureKeys.clear();
+}
+
+const RenderMaterial* RenderMaterialCache::get(const MagnumBZMaterial* mat) {
+    auto it = _lookup.find(mat);
+    if (it != _lookup.end())
+        return it->second;
+
+    _records.emplace_back();
+    RenderMaterial& rec = _records.back();
+    resolve(mat, rec);
+    _lookup.insert(std::make_pair(mat, &rec));
+    return &rec;
+}
+
+void RenderMaterialCache::resolve(const MagnumBZMaterial* mat, RenderMaterial& rec) {
+    auto toMagnumColor = [](const float *cp) {
+        return Color3{cp[0], cp[1], cp[2]};
+    };
+
+    rec.material = mat;
+    rec.materialKey = (unsigned int)_records.size();
+    rec.texture = NULL;
+    rec.textureKey = 0;
+    if (mat->getTextureCount() > 0) {
+        TextureData t = MagnumTextureManager::instance().requestTexture(mat->getTexture(0).c_str());
+        rec.texture = t.texture;
+    }
+    if (rec.texture) {
+        auto it = _textureKeys.find(rec.texture);
+        if (it == _textureKeys.end())
+            it = _textureKeys.insert(std::make_pair(rec.texture, (unsigned int)_textureKeys.size() + 1)).first;
+        rec.textureKey = it->second;
+    }
+
+    rec.noCulling = mat->getNoCulling();
+    rec.noLighting = mat->getNoLighting();
+    rec.dynamicColor = mat->getDynamicColor();
+    rec.textureMatrix = mat->getTextureMatrix(0);
+
+    rec.diffuse = toMagnumColor(mat->getDiffuse());
+    rec.specular = toMagnumColor(mat->getSpecular());
+    if (rec.noLighting)
+        rec.ambient = rec.diffuse + toMagnumColor(mat->getEmission());
+    else
+        rec.ambient = 0.2f*toMagnumColor(mat->getAmbient()) + toMagnumColor(mat->getEmission());
+    rec.alpha = mat->getDiffuse()[3];
+    rec.shininess = mat->getShininess();
+
+    // The map "duck dodgers" set alphathresh=1 for many materials
+    // and the old client still rendered them. Max out alphathresh at
+    // 0.999, since some map makers might just max out the value
+    // to get transparency working.
+    rec.alphaThreshold = mat->getAlphaThreshold();
+    if (rec.alphaThreshold > 0.999f) rec.alphaThreshold = 0.999f;
+}
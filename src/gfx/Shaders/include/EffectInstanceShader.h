@@ -0,0 +1,52 @@
+#ifndef EFFECTINSTANCESHADER_H
+#define EFFECTINSTANCESHADER_H
+
+#include <Magnum/GL/AbstractShaderProgram.h>
+#include <Magnum/GL/Attribute.h>
+#include <Magnum/Math/Matrix4.h>
+#include <Magnum/GL/Texture.h>
+
+// Draws many copies of a unit ring or quad in one instanced call.
+// Each instance brings its own transformation, color and shape
+// parameters, laid out like EffectInstance in EffectParticles.h.
+// References shader programs in resources/EffectInstanceShader.vert and
+// EffectInstanceShader.frag
+class EffectInstanceShader : public Magnum::GL::AbstractShaderProgram {
+    public:
+    enum class Shape { Ring, Quad };
+
+    // per vertex: sin, cos, bottom or top edge, s for rings,
+    // the distance along both sides for quads
+    typedef Magnum::GL::Attribute<0, Magnum::Vector4> Vertex;
+
+    // per instance
+    typedef Magnum::GL::Attribute<1, Magnum::Matrix4> Transformation;
+    typedef Magnum::GL::Attribute<5, Magnum::Vector4> Color;
+    typedef Magnum::GL::Attribute<6, Magnum::Vector4> ShapeParameters;
+    typedef Magnum::GL::Attribute<7, Magnum::Vector4> TextureParameters;
+
+    explicit EffectInstanceShader(Shape shape);
+
+    EffectInstanceShader& setTransformationProjectionMatrix(const Magnum::Matrix4& matrix) {
+        setUniform(_transformationProjectionMatUniform, matrix);
+        return *this;
+    }
+
+    // fragments less opaque than this are discarded
+    EffectInstanceShader& setAlphaMask(Magnum::Float mask) {
+        setUniform(_alphaMaskUniform, mask);
+        return *this;
+    }
+
+    EffectInstanceShader& bindTexture(Magnum::GL::Texture2D& texture) {
+        texture.bind(TextureUnit);
+        return *this;
+    }
+
+    private:
+    enum: Magnum::Int { TextureUnit = 0 };
+    Magnum::Int _transformationProjectionMatUniform;
+    Magnum::Int _alphaMaskUniform;
+};
+
+#endif
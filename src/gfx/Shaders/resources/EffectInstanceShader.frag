@@ -0,0 +1,21 @@
+precision highp float;
+precision highp int;
+
+uniform lowp sampler2D textureData;
+
+uniform float alphaMask
+    #ifndef GL_ES
+    = 0.1
+    #endif
+    ;
+
+in vec2 interpolatedTextureCoordinates;
+in vec4 interpolatedColor;
+
+out vec4 fragmentColor;
+
+void main() {
+    fragmentColor = interpolatedColor*texture(textureData, interpolatedTextureCoordinates);
+    if(fragmentColor.a < alphaMask)
+        discard;
+}
@@ -0,0 +1,33 @@
+precision highp float;
+precision highp int;
+
+layout(location = 0) in vec4 vertex;
+
+layout(location = 1) in mat4 transformation;
+layout(location = 5) in vec4 color;
+layout(location = 6) in vec4 shape;
+layout(location = 7) in vec4 textureParameters;
+
+uniform mat4 transformationProjectionMatrix;
+
+out vec2 interpolatedTextureCoordinates;
+out vec4 interpolatedColor;
+
+void main() {
+    #ifdef RING_SHAPE
+    // the ring stands along x, its radius going from the bottom to the
+    // top edge, and it doesn't reach below the lowest z
+    float top = vertex.z;
+    float radius = mix(shape.x, shape.y, top);
+    vec3 position = vec3(top*shape.z, vertex.y*radius, max(vertex.x*radius, shape.w));
+    interpolatedTextureCoordinates = vec2(vertex.w, mix(textureParameters.x, textureParameters.y, top));
+    #else
+    // the sides of the quad are the first two columns of the transformation
+    vec3 position = vec3(vertex.xy, 0.0);
+    interpolatedTextureCoordinates = textureParameters.xy + vertex.x*shape.xy + vertex.y*shape.zw;
+    #endif
+
+    interpolatedColor = color;
+
+    gl_Position = transformationProjectionMatrix*transformation*vec4(position, 1.0);
+}
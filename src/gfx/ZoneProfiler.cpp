@@ -0,0 +1,120 @@
+#include "ZoneProfiler.h"
+
+#include <chrono>
+#include <fstream>
+#include <stdio.h>
+
+ZoneProfiler ZONEPROFILER;
+
+ZoneProfiler::ZoneProfiler() {
+    _frameHistoryMs.resize(HistoryFrames, 0.0f);
+}
+
+uint64_t ZoneProfiler::now() {
+    static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - epoch).count();
+}
+
+int ZoneProfiler::registerZone(const char* name) {
+    Zone z;
+    z.name = name;
+    z.lastMs = 0.0f;
+    z.lastCalls = 0;
+    z.historyMs.resize(HistoryFrames, 0.0f);
+    z.frameNs = 0;
+    z.frameCalls = 0;
+    _zones.push_back(z);
+    return (int)_zones.size() - 1;
+}
+
+void ZoneProfiler::endZone(int zone, uint64_t start, uint64_t end) {
+    Zone& z = _zones[zone];
+    z.frameNs += end - start;
+    z.frameCalls++;
+    if (_captureStarted)
+        record(zone, start, end);
+}
+
+void ZoneProfiler::record(int zone, uint64_t start, uint64_t end) {
+    if (_capture.size() >= MaxCaptureEvents) {
+        _captureDropped++;
+        return;
+    }
+    _capture.push_back({zone, _depth, start, end});
+}
+
+void ZoneProfiler::newFrame() {
+    const uint64_t t = now();
+    if (!_frameStarted) {
+        _frameStarted = true;
+        _frameStart = t;
+        return;
+    }
+
+    // roll this frame into the history
+    _lastFrameMs = (t - _frameStart) * 1.0e-6f;
+    _frameHistoryMs[_historyPos] = _lastFrameMs;
+    for (Zone& z: _zones) {
+        z.lastMs = z.frameNs * 1.0e-6f;
+        z.lastCalls = z.frameCalls;
+        z.historyMs[_historyPos] = z.lastMs;
+        z.frameNs = 0;
+        z.frameCalls = 0;
+    }
+    _historyPos = (_historyPos + 1) % HistoryFrames;
+
+    if (_captureFrames > 0) {
+        if (_captureStarted) {
+            record(-1, _frameStart, t);
+            if (--_captureFrames == 0)
+                _captureStarted = false;
+        } else {
+            _captureStarted = true;
+        }
+    }
+
+    _frameStart = t;
+}
+
+void ZoneProfiler::startCapture(int frames) {
+    _capture.clear();
+    _captureDropped = 0;
+    _captureFrames = frames;
+    _captureStarted = false;
+}
+
+static void writeJSONString(std::ostream& out, const std::string& s) {
+    out << '"';
+    for (char c: s) {
+        if (c == '"' || c == '\\')
+            out << '\\' << c;
+        else if ((unsigned char)c < 0x20)
+            out << ' ';
+        else
+            out << c;
+    }
+    out << '"';
+}
+
+// Complete ("X") events on one thread, timestamps in microseconds.
+// The viewer rebuilds the nesting from the times.
+bool ZoneProfiler::exportTrace(const std::string& path) const {
+    std::ofstream out(path.c_str());
+    if (!out)
+        return false;
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"main\"}}";
+    char buf[96];
+    for (const Event& e: _capture) {
+        out << ",\n{\"name\":";
+        writeJSONString(out, e.zone < 0 ? std::string("Frame") : _zones[e.zone].name);
+        snprintf(buf, sizeof(buf), ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":1}",
+            e.zone < 0 ? "frame" : "zone", e.start * 1.0e-3, (e.end - e.start) * 1.0e-3);
+        out << buf;
+    }
+    out << "\n]}\n";
+
+    return out.good();
+}
@@ -15,8 +15,18 @@
 
 #include "EnhancedPhongGL.h"
 
+#include "RenderCommandList.h"
+
 class DrawMode {
     public:
+    virtual ~DrawMode() {}
+
+    // The renderer brackets each drawable group with these. Modes may
+    // queue the draws in between and only draw at endPass(), sorted by
+    // state unless sorted is false (blended geometry).
+    virtual void beginPass(Magnum::SceneGraph::Camera3D& camera, bool sorted = true) {}
+    virtual void endPass() {}
+
     virtual void draw(
         const Magnum::Matrix4& transformationMatrix,
         Magnum::SceneGraph::Camera3D& camera,
@@ -25,44 +35,85 @@ class DrawMode {
         Object3D* obj) = 0;
 };
 
-class BZMaterialDrawMode : public DrawMode {
+// Queues draws into a RenderCommandList with resolved materials, then
+// submits them in state order at the end of the pass.
+// Draws outside of a pass are submitted right away.
+class QueuedDrawMode : public DrawMode, protected RenderCommandVisitor {
     public:
-    BZMaterialDrawMode();
+    void beginPass(Magnum::SceneGraph::Camera3D& camera, bool sorted = true) override;
+    void endPass() override;
     void draw(
         const Magnum::Matrix4& transformationMatrix,
         Magnum::SceneGraph::Camera3D& camera,
         const MagnumBZMaterial* mat,
         Magnum::GL::Mesh& mesh,
         Object3D* obj) override;
+
+    // State changes made by the last pass
+    const RenderStats& getStats() const { return _list.getStats(); }
+
+    protected:
+    // Per pass constants, called once before the pass is submitted
+    virtual void preparePass(Magnum::SceneGraph::Camera3D& camera) {}
+    virtual int chooseShader(const RenderMaterial& mat) { return 0; }
+    // Modes without textured shaders return false, so that their passes
+    // are only sorted by the state they actually change
+    virtual bool usesTextures() const { return true; }
+
+    void setCulling(bool enable) override;
+    void bindTexture(Magnum::GL::Texture2D* texture) override {}
+
+    private:
+    RenderCommandList _list;
+    Magnum::SceneGraph::Camera3D* _camera = NULL;
+    bool _inPass = false;
+    bool _sorted = true;
+};
+
+class BZMaterialDrawMode : public QueuedDrawMode {
+    public:
+    BZMaterialDrawMode();
     void setLightObj(Object3D* obj) { _lightObj = obj; }
     void setLightCamera(Magnum::SceneGraph::Camera3D* c) { _lightCamera = c; }
-    private:
+    protected:
+    enum { TexturedShader = 0, UntexturedShader = 1 };
+
+    BZMaterialDrawMode(EnhancedPhongGL* shader, EnhancedPhongGL* shaderUntex);
+
+    void preparePass(Magnum::SceneGraph::Camera3D& camera) override;
+    int chooseShader(const RenderMaterial& mat) override;
+    // Per pass uniforms, set the first time a shader is used in a pass
+    virtual void prepareShader(EnhancedPhongGL& shader);
+
+    void setShader(int shader) override;
+    void bindTexture(Magnum::GL::Texture2D* texture) override;
+    void setMaterial(int shader, const RenderMaterial& mat) override;
+    void drawCommand(const RenderCommand& command) override;
+
     EnhancedPhongGL *_shader;
     EnhancedPhongGL *_shaderUntex;
-    Object3D* _lightObj;
-    Magnum::SceneGraph::Camera3D* _lightCamera;
+    EnhancedPhongGL *_current = NULL;
+    bool _prepared[2];
+    Object3D* _lightObj = NULL;
+    Magnum::SceneGraph::Camera3D* _lightCamera = NULL;
+
+    // Per pass
+    Magnum::SceneGraph::Camera3D* _passCamera = NULL;
+    Magnum::Vector3 _lightPosition;
 };
 
-class BZMaterialShadowMappedDrawMode : public DrawMode {
+class BZMaterialShadowMappedDrawMode : public BZMaterialDrawMode {
     public:
     BZMaterialShadowMappedDrawMode();
-    void draw(
-        const Magnum::Matrix4& transformationMatrix,
-        Magnum::SceneGraph::Camera3D& camera,
-        const MagnumBZMaterial* mat,
-        Magnum::GL::Mesh& mesh,
-        Object3D* obj) override;
-    void setLightObj(Object3D* obj) { _lightObj = obj; }
-    void setLightCamera(Magnum::SceneGraph::Camera3D* c) { _lightCamera = c; }
     void setShadowMap(Magnum::GL::Texture2D* tex) {
         _shadowMapTex = tex;
     }
+    protected:
+    void preparePass(Magnum::SceneGraph::Camera3D& camera) override;
+    void prepareShader(EnhancedPhongGL& shader) override;
     private:
-    EnhancedPhongGL *_shader;
-    EnhancedPhongGL *_shaderUntex;
-    Object3D* _lightObj;
-    Magnum::GL::Texture2D *_shadowMapTex;
-    Magnum::SceneGraph::Camera3D* _lightCamera;
+    Magnum::GL::Texture2D *_shadowMapTex = NULL;
+    Magnum::Matrix4 _lightSpaceMat;
 };
 
 class BasicTexturedShaderDrawMode : public DrawMode {
@@ -78,15 +129,15 @@ class BasicTexturedShaderDrawMode : public DrawMode {
     BasicTexturedShader *_shader;
 };
 
-class DepthMapDrawMode : public DrawMode {
+class DepthMapDrawMode : public QueuedDrawMode {
     public:
     DepthMapDrawMode();
-    void draw(
-        const Magnum::Matrix4& transformationMatrix,
-        Magnum::SceneGraph::Camera3D& camera,
-        const MagnumBZMaterial* mat,
-        Magnum::GL::Mesh& mesh,
-        Object3D* obj) override;
+    protected:
+    void preparePass(Magnum::SceneGraph::Camera3D& camera) override;
+    void setShader(int shader) override {}
+    void setMaterial(int shader, const RenderMaterial& mat) override {}
+    void drawCommand(const RenderCommand& command) override;
+    bool usesTextures() const override { return false; }
     private:
     DepthMapShader *_shader;
 };
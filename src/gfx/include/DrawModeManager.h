@@ -13,8 +13,16 @@ class DrawModeManager {
     public:
     void setDrawMode(DrawMode* mode) { _mode = mode; }
     DrawMode* getDrawMode() { return _mode; }
+
+    // State changes of every pass drawn since beginFrame(), the renderer
+    // calls it at the start of each frame
+    void beginFrame();
+    void addPassStats(const RenderStats& stats) { _frameStats.add(stats); }
+    const RenderStats& getFrameStats() const { return _lastFrameStats; }
     private:
     DrawMode* _mode = NULL;
+    RenderStats _frameStats;
+    RenderStats _lastFrameStats;
 };
 
 extern DrawModeManager DRAWMODEMGR;
@@ -61,6 +61,10 @@ class MagnumSceneRenderer {
 
     Object3D *_lightObj = NULL;
 
+    // Draw a drawable group as one pass of the current DrawMode.
+    // Blended groups pass sorted = false to keep their order.
+    void drawGroup(Magnum::SceneGraph::Camera3D* camera, const char* name, bool sorted);
+
     // For depth map render projection matrix
     // Compute based on world extents
     float getSunNearPlane() const;
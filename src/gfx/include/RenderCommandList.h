@@ -0,0 +1,99 @@
+#ifndef RENDERCOMMANDLIST_H
+#define RENDERCOMMANDLIST_H
+
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <Magnum/GL/GL.h>
+#include <Magnum/Math/Color.h>
+#include <Magnum/Math/Matrix4.h>
+
+class MagnumBZMaterial;
+
+// Everything a draw mode needs from a MagnumBZMaterial, resolved once
+// when the material is first drawn instead of on every draw.
+// Dynamic colors and texture matrices animate, so only their ids are kept.
+struct RenderMaterial {
+    const MagnumBZMaterial* material;
+    Magnum::GL::Texture2D* texture;     // NULL draws untextured
+    unsigned int textureKey;            // small id per distinct texture, 0 for none
+    unsigned int materialKey;           // small id per material
+
+    bool noCulling;
+    bool noLighting;
+    int dynamicColor;                   // -1 for none
+    int textureMatrix;                  // -1 for none
+
+    Magnum::Color3 diffuse;
+    Magnum::Color3 ambient;             // lit ambient or unlit diffuse, plus emission
+    Magnum::Color3 specular;
+    float alpha;
+    float shininess;
+    float alphaThreshold;
+};
+
+struct RenderCommand {
+    uint64_t key;
+    unsigned int order;                 // submission order, breaks ties
+    int shader;
+    Magnum::GL::Texture2D* texture;     // NULL when the shader takes none
+    const RenderMaterial* material;
+    Magnum::GL::Mesh* mesh;
+    Magnum::Matrix4 transformation;
+};
+
+// State changes made while submitting a command list
+struct RenderStats {
+    unsigned int commands = 0;
+    unsigned int shaderChanges = 0;
+    unsigned int textureChanges = 0;
+    unsigned int cullChanges = 0;
+    unsigned int materialChanges = 0;
+
+    void add(const RenderStats& s);
+};
+
+// Receives the commands of a list in submission order, with redundant
+// state changes already filtered out. Draw modes implement this with GL
+// calls, anything else (tests, stats) can implement it without a context.
+class RenderCommandVisitor {
+    public:
+    virtual ~RenderCommandVisitor() {}
+    virtual void setShader(int shader) = 0;
+    virtual void setCulling(bool enable) = 0;
+    virtual void bindTexture(Magnum::GL::Texture2D* texture) = 0;
+    // also called after a shader change, since uniforms belong to the shader
+    virtual void setMaterial(int shader, const RenderMaterial& material) = 0;
+    virtual void drawCommand(const RenderCommand& command) = 0;
+};
+
+// The drawables of a pass, collected first so that they can be drawn
+// sorted by shader, then texture, then culling, then material.
+// Storage is reused from pass to pass.
+class RenderCommandList {
+    public:
+    // Drop the commands, the stats of the last submit() are kept
+    void clear();
+    void add(int shader, Magnum::GL::Texture2D* texture, const RenderMaterial* material, Magnum::GL::Mesh& mesh, const Magnum::Matrix4& transformation);
+
+    // Sort by state, skip this to keep submission order for blended geometry
+    void sort();
+
+    // Hand every command to the visitor, changing state only where it
+    // differs from the previous command. Nothing is assumed about the
+    // state before the first command.
+    void submit(RenderCommandVisitor& visitor);
+
+    size_t size() const { return _commands.size(); }
+    const std::vector<RenderCommand>& getCommands() const { return _commands; }
+    const RenderStats& getStats() const { return _stats; }
+
+    static uint64_t makeKey(int shader, unsigned int textureKey, bool culling, unsigned int materialKey);
+
+    private:
+    std::vector<RenderCommand> _commands;
+    RenderStats _stats;
+};
+
+#endif
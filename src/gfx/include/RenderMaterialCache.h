@@ -0,0 +1,32 @@
+#ifndef RENDERMATERIALCACHE_H
+#define RENDERMATERIALCACHE_H
+
+#include <deque>
+#include <map>
+#include <unordered_map>
+
+#include "RenderCommandList.h"
+
+// Resolves MagnumBZMaterials into RenderMaterials the first time they are
+// drawn. Everything is thrown away when the material or texture managers
+// report that pointers we hold may have been deleted.
+class RenderMaterialCache {
+    public:
+    // Call once per pass, before get()
+    void validate();
+    const RenderMaterial* get(const MagnumBZMaterial* mat);
+    void clear();
+    size_t size() const { return _records.size(); }
+    private:
+    void resolve(const MagnumBZMaterial* mat, RenderMaterial& rec);
+
+    std::unordered_map<const MagnumBZMaterial*, const RenderMaterial*> _lookup;
+    std::deque<RenderMaterial> _records;    // deque keeps pointers stable
+    std::map<Magnum::GL::Texture2D*, unsigned int> _textureKeys;
+    unsigned int _materialGeneration = 0;
+    unsigned int _textureGeneration = 0;
+};
+
+extern RenderMaterialCache RENDERMATERIALS;
+
+#endif
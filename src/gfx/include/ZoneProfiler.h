@@ -0,0 +1,120 @@
+#ifndef ZONEPROFILER_H
+#define ZONEPROFILER_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// A scoped-zone CPU profiler for the main thread.
+// Put PROFILE_ZONE("name") at the top of a block to time it. Every zone
+// keeps its per-frame total for the last HistoryFrames frames, which the
+// ProfilerPanel widget shows, and a capture records the individual zones
+// of a few frames for export as a Chrome trace (chrome://tracing, Perfetto).
+// Without BZ_ZONE_PROFILER the macro compiles to nothing.
+class ZoneProfiler {
+    public:
+    static const int HistoryFrames = 240;
+    static const size_t MaxCaptureEvents = 1 << 20;
+
+    struct Zone {
+        std::string name;
+        float lastMs;                   // total time in the last frame
+        unsigned int lastCalls;
+        std::vector<float> historyMs;   // ring, indexed like the frame history
+        // accumulating for the current frame
+        uint64_t frameNs;
+        unsigned int frameCalls;
+    };
+
+    class Scope {
+        public:
+        Scope(int zone);
+        ~Scope();
+        private:
+        int _zone;
+        uint64_t _start;
+    };
+
+    ZoneProfiler();
+
+    // Zones are registered once per call site and never removed
+    int registerZone(const char* name);
+
+    // Call once at the start of every frame
+    void newFrame();
+
+    void setEnabled(bool enabled) { _enabled = enabled; }
+    bool isEnabled() const { return _enabled; }
+
+    // Record every zone of the next 'frames' frames, replacing the last capture
+    void startCapture(int frames);
+    bool isCapturing() const { return _captureFrames > 0; }
+    size_t getCaptureEventCount() const { return _capture.size(); }
+    unsigned int getCaptureDropped() const { return _captureDropped; }
+    bool exportTrace(const std::string& path) const;
+
+    const std::vector<Zone>& getZones() const { return _zones; }
+    // index of the oldest history entry, the newest is just before it
+    int getHistoryPos() const { return _historyPos; }
+    const std::vector<float>& getFrameHistoryMs() const { return _frameHistoryMs; }
+    float getLastFrameMs() const { return _lastFrameMs; }
+
+    private:
+    struct Event {
+        int zone;                       // -1 for a whole frame
+        int depth;
+        uint64_t start;                 // ns since the profiler was created
+        uint64_t end;
+    };
+
+    static uint64_t now();
+    void endZone(int zone, uint64_t start, uint64_t end);
+    void record(int zone, uint64_t start, uint64_t end);
+
+    bool _enabled = true;
+    int _depth = 0;
+    std::vector<Zone> _zones;
+
+    bool _frameStarted = false;
+    uint64_t _frameStart = 0;
+    float _lastFrameMs = 0.0f;
+    std::vector<float> _frameHistoryMs;
+    int _historyPos = 0;
+
+    int _captureFrames = 0;
+    bool _captureStarted = false;   // captures begin on a frame boundary
+    unsigned int _captureDropped = 0;
+    std::vector<Event> _capture;
+};
+
+extern ZoneProfiler ZONEPROFILER;
+
+inline ZoneProfiler::Scope::Scope(int zone) {
+    if (!ZONEPROFILER._enabled) {
+        _zone = -1;
+        return;
+    }
+    _zone = zone;
+    ZONEPROFILER._depth++;
+    _start = ZoneProfiler::now();
+}
+
+inline ZoneProfiler::Scope::~Scope() {
+    if (_zone < 0)
+        return;
+    ZONEPROFILER._depth--;
+    ZONEPROFILER.endZone(_zone, _start, ZoneProfiler::now());
+}
+
+#define PROFILE_ZONE_CONCAT2(a, b) a##b
+#define PROFILE_ZONE_CONCAT(a, b) PROFILE_ZONE_CONCAT2(a, b)
+
+#ifdef BZ_ZONE_PROFILER
+#define PROFILE_ZONE(name) \
+    static const int PROFILE_ZONE_CONCAT(_profileZone, __LINE__) = ZONEPROFILER.registerZone(name); \
+    ZoneProfiler::Scope PROFILE_ZONE_CONCAT(_profileScope, __LINE__)(PROFILE_ZONE_CONCAT(_profileZone, __LINE__))
+#else
+#define PROFILE_ZONE(name)
+#endif
+
+#endif
@@ -99,6 +99,7 @@ DefaultDBItem defaultDBItems[] =
     { "showVelocities",       "0",            true,   StateDatabase::ReadWrite,   NULL },
     { "jumpTyping",       "1",            true,   StateDatabase::ReadWrite,   NULL },
     { "maxCacheMB",       "512",           true,   StateDatabase::ReadWrite,   NULL },
+    { "maxTextureCacheMB",    "256",           true,   StateDatabase::ReadWrite,   NULL },
     { "doDownloads",      "1",            true,   StateDatabase::ReadWrite,   NULL },
     { "updateDownloads",      "0",            true,   StateDatabase::ReadWrite,   NULL },
     { "roamSmoothTime",       "0.5",          true,   StateDatabase::ReadWrite,   NULL },
@@ -208,6 +209,8 @@ DefaultDBItem defaultDBItems[] =
 
     // URL timeouts
     { "httpTimeout",      "15",           true,   StateDatabase::ReadWrite,   NULL },
+    { "httpMaxTransfers", "8",            true,   StateDatabase::ReadWrite,   NULL },
+    { "httpMaxHostTransfers", "4",        true,   StateDatabase::ReadWrite,   NULL },
 
     // hud drawing
     { "hudGUIBorderOpacityFactor","0.75",         true,   StateDatabase::ReadWrite,   NULL },
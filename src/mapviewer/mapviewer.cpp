@@ -390,6 +390,7 @@ void MapViewer::handleLoadFromMapBrowser(const CachedResource& mapRsc) {
 void MapViewer::exitEvent(ExitEvent& event) {
     event.setAccepted();
     MagnumTextureManager::instance().clear();
+    TEXCACHE.saveIndex();
 }
 
 #ifdef TARGET_EMSCRIPTEN
@@ -582,6 +583,9 @@ void MapViewer::drawEvent() {
     else if(!ImGui::GetIO().WantTextInput && isTextInputActive())
         stopTextInput();
 
+    // Upload a few textures finished by the decode threads
+    MagnumTextureManager::instance().processDecodedTextures(4);
+
     sceneRenderer.renderScene(_camera);
 
     GL::Renderer::enable(GL::Renderer::Feature::Blending);
@@ -797,6 +801,8 @@ void MapViewer::init() {
 
     CACHEMGR.loadIndex();
     CACHEMGR.limitCacheSize();
+    TEXCACHE.loadIndex();
+    TEXCACHE.limitCacheSize();
 }
 
 void MapViewer::loadMap(std::string path, const std::string& data, bool reloadEditor)
@@ -20,6 +20,7 @@
 
 /* common implementation headers */
 #include "CacheManager.h"
+#include "PixelConvert.h"
 
 
 #ifdef WIN32
@@ -196,44 +197,13 @@ unsigned char*      MediaFile::readImage(
             else
             {
                 // expand image into 4 channels
-                int n = dx * dy;
-                const unsigned char* src = buffer;
-                unsigned char* dst = image;
+                const size_t n = (size_t)dx * dy;
                 if (dz == 1)
-                {
-                    // r=g=b=i, a=max
-                    for (; n > 0; --n)
-                    {
-                        dst[0] = dst[1] = dst[2] = src[0];
-                        dst[3] = 0xff;
-                        src += 1;
-                        dst += 4;
-                    }
-                }
+                    PixelConvert::grayToRGBA(buffer, image, n);
                 else if (dz == 2)
-                {
-                    // r=g=b=i
-                    for (; n > 0; --n)
-                    {
-                        dst[0] = dst[1] = dst[2] = src[0];
-                        dst[3] = src[1];
-                        src += 2;
-                        dst += 4;
-                    }
-                }
+                    PixelConvert::grayAlphaToRGBA(buffer, image, n);
                 else if (dz == 3)
-                {
-                    // a=max
-                    for (; n > 0; --n)
-                    {
-                        dst[0] = src[0];
-                        dst[1] = src[1];
-                        dst[2] = src[2];
-                        dst[3] = 0xff;
-                        src += 3;
-                        dst += 4;
-                    }
-                }
+                    PixelConvert::rgbToRGBA(buffer, image, n);
             }
         }
 
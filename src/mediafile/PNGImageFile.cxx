@@ -16,6 +16,7 @@
 #include <string.h>
 #include "Pack.h"
 #include "bzfio.h"
+#include "PixelConvert.h"
 #include <zconf.h>
 #include <zlib.h>
 
@@ -388,8 +389,8 @@ bool PNGImageFile::expand(unsigned char* destination)
 
     case 16:
     {
-        for (int i = 0; i < myWidth*channels; i++)
-            *(destination+i) = (*(pData + 2*i + 1));
+        // samples are big endian, keep the most significant byte
+        PixelConvert::narrow16To8(pData + 1, destination, myWidth*channels, true);
     }
     break;
 
@@ -13,6 +13,8 @@
 #include "SGIImageFile.h"
 #include <string>
 #include <iostream>
+#include <string.h>
+#include "PixelConvert.h"
 
 //
 // SGIImageFile
@@ -89,30 +91,30 @@ bool                    SGIImageFile::readVerbatim(void* buffer)
     const int dx = getWidth();
     const int dy = getHeight();
     const int dz = getNumChannels();
+    const size_t planeSize = (size_t)dx * dy;
 
-    // make row buffer
-    unsigned char* row = new unsigned char[dx];
-
-    // read each channel one after the other
-    for (int z = 0; z < dz; ++z)
+    // single channel images are stored exactly like we want them
+    if (dz == 1)
     {
-        unsigned char* dst = image + z;
-        for (int y = 0; isOkay() && y < dy; ++y)
-        {
-            // read raw data
-            readRaw(row, dx);
+        readRaw(image, (uint32_t)planeSize);
+        return isOkay();
+    }
 
-            // swizzle into place
-            for (int x = 0; x < dx; ++x)
-            {
-                *dst = row[x];
-                dst += dz;
-            }
-        }
+    // channels are stored one after the other, read them all at once
+    unsigned char* planes = new unsigned char[planeSize * dz];
+    readRaw(planes, (uint32_t)(planeSize * dz));
+
+    // swizzle into place
+    if (isOkay())
+    {
+        const unsigned char* channels[4];
+        for (int z = 0; z < dz; ++z)
+            channels[z] = planes + z * planeSize;
+        PixelConvert::interleavePlanes(channels, dz, image, planeSize);
     }
 
     // clean up
-    delete[] row;
+    delete[] planes;
 
     return isOkay();
 }
@@ -120,9 +122,10 @@ bool                    SGIImageFile::readVerbatim(void* buffer)
 bool                    SGIImageFile::readRLE(void* buffer)
 {
     unsigned char* image = reinterpret_cast<unsigned char*>(buffer);
-//  const int dx = getWidth();
+    const int dx = getWidth();
     const int dy = getHeight();
     const int dz = getNumChannels();
+    const size_t planeSize = (size_t)dx * dy;
 
     // read offset tables
     const int tableSize = dy * dz;
@@ -148,12 +151,19 @@ bool                    SGIImageFile::readRLE(void* buffer)
     uint32_t rowSize   = 4;
     unsigned char* row = new unsigned char[rowSize];
 
+    // decode each channel into its own plane, single channel images
+    // can go straight into the image
+    unsigned char* planes = (dz == 1) ? image : new unsigned char[planeSize * dz];
+
     // read each channel one after the other
-    for (int z = 0; z < dz; ++z)
+    bool corrupt = false;
+    for (int z = 0; !corrupt && z < dz; ++z)
     {
-        unsigned char* dst = image + z;
         for (int y = 0; isOkay() && y < dy; ++y)
         {
+            unsigned char* dst = planes + z * planeSize + (size_t)y * dx;
+            const unsigned char* const dstEnd = dst + dx;
+
             // get length of row
             const uint32_t length = lengthTable[y + z * dy];
 
@@ -172,55 +182,68 @@ bool                    SGIImageFile::readRLE(void* buffer)
                 break;
 
             // decode
-            unsigned char* src = row;
+            const unsigned char* src = row;
             while (1)
             {
                 // check for error in image
                 if (static_cast<uint32_t>(src - row) >= length)
                 {
-                    delete[] row;
-                    delete[] startTable;
-                    delete[] lengthTable;
-                    return false;
+                    corrupt = true;
+                    break;
                 }
 
                 // get next code
                 const unsigned char type = *src++;
-                int count = static_cast<int>(type & 0x7f);
+                const int count = static_cast<int>(type & 0x7f);
 
                 // zero code means end of row
                 if (count == 0)
                     break;
 
+                // runs must stay within the row and the input
+                const uint32_t needed = (type & 0x80) ? count : 1;
+                if (count > dstEnd - dst ||
+                        static_cast<uint32_t>(src - row) + needed > length)
+                {
+                    corrupt = true;
+                    break;
+                }
+
                 if (type & 0x80)
                 {
                     // copy count pixels
-                    while (count--)
-                    {
-                        *dst = *src++;
-                        dst += dz;
-                    }
+                    memcpy(dst, src, count);
+                    src += count;
                 }
                 else
                 {
                     // repeat pixel count times
-                    const unsigned char pixel = *src++;
-                    while (count--)
-                    {
-                        *dst = pixel;
-                        dst += dz;
-                    }
+                    memset(dst, *src++, count);
                 }
+                dst += count;
             }
+            if (corrupt)
+                break;
         }
     }
 
+    // swizzle into place
+    if (!corrupt && isOkay() && dz > 1)
+    {
+        const unsigned char* channels[4];
+        for (int z = 0; z < dz; ++z)
+            channels[z] = planes + z * planeSize;
+        PixelConvert::interleavePlanes(channels, dz, image, planeSize);
+    }
+
     // clean up
+    if (planes != image)
+        delete[] planes;
     delete[] row;
     delete[] startTable;
     delete[] lengthTable;
 
-    return isOkay();
+    return !corrupt && isOkay();
 }
 
 // Local Variables: ***
@@ -0,0 +1,210 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+// interface header
+#include "MeshFaceBVH.h"
+
+// system headers
+#include <algorithm>
+
+// common headers
+#include "MeshFace.h"
+
+
+// faces per leaf, the face test is cheap compared to a cache miss
+static const int maxLeafFaces = 4;
+
+// the box tests must never reject a face that MeshFace::intersect()
+// hits, so the node bounds are widened a little for rounding errors
+static const float boxMargin = 0.001f;
+
+// deep enough for any tree built by median splits
+static const int maxStackDepth = 64;
+
+
+MeshFaceBVH::MeshFaceBVH(MeshFace* const* meshFaces, int faceCount)
+{
+    std::vector<BuildFace> build(faceCount);
+    for (int i = 0; i < faceCount; i++)
+    {
+        const Extents& exts = meshFaces[i]->getExtents();
+        for (int a = 0; a < 3; a++)
+            build[i].center[a] = 0.5f * (exts.mins[a] + exts.maxs[a]);
+        build[i].face = meshFaces[i];
+    }
+
+    // a median split tree has less than 2 * n / maxLeafFaces nodes
+    nodes.reserve((2 * faceCount) / maxLeafFaces + 1);
+    faces.reserve(faceCount);
+    if (faceCount > 0)
+        buildNode(build, 0, faceCount);
+
+    return;
+}
+
+
+int MeshFaceBVH::buildNode(std::vector<BuildFace>& build, int begin, int end)
+{
+    const int index = (int)nodes.size();
+    nodes.push_back(Node());
+
+    // bounds of the faces, and of their centers to pick the split axis
+    float mins[3], maxs[3], cmins[3], cmaxs[3];
+    const Extents& first = build[begin].face->getExtents();
+    for (int a = 0; a < 3; a++)
+    {
+        mins[a] = first.mins[a];
+        maxs[a] = first.maxs[a];
+        cmins[a] = cmaxs[a] = build[begin].center[a];
+    }
+    for (int i = begin + 1; i < end; i++)
+    {
+        const Extents& exts = build[i].face->getExtents();
+        for (int a = 0; a < 3; a++)
+        {
+            mins[a] = std::min(mins[a], exts.mins[a]);
+            maxs[a] = std::max(maxs[a], exts.maxs[a]);
+            cmins[a] = std::min(cmins[a], build[i].center[a]);
+            cmaxs[a] = std::max(cmaxs[a], build[i].center[a]);
+        }
+    }
+    for (int a = 0; a < 3; a++)
+    {
+        nodes[index].mins[a] = mins[a] - boxMargin;
+        nodes[index].maxs[a] = maxs[a] + boxMargin;
+    }
+
+    const int count = end - begin;
+    if (count <= maxLeafFaces)
+    {
+        nodes[index].first = (int32_t)faces.size();
+        nodes[index].count = count;
+        for (int i = begin; i < end; i++)
+            faces.push_back(build[i].face);
+        return index;
+    }
+
+    // split at the median along the longest axis of the centers
+    int axis = 0;
+    for (int a = 1; a < 3; a++)
+    {
+        if ((cmaxs[a] - cmins[a]) > (cmaxs[axis] - cmins[axis]))
+            axis = a;
+    }
+    const int mid = begin + (count / 2);
+    std::nth_element(build.begin() + begin, build.begin() + mid,
+                     build.begin() + end,
+                     [axis](const BuildFace& x, const BuildFace& y)
+    {
+        return x.center[axis] < y.center[axis];
+    });
+
+    buildNode(build, begin, mid);
+    const int right = buildNode(build, mid, end);
+    nodes[index].first = right;
+    nodes[index].count = 0;
+
+    return index;
+}
+
+
+size_t MeshFaceBVH::getMemoryUsed() const
+{
+    return sizeof(MeshFaceBVH) +
+           (nodes.capacity() * sizeof(Node)) +
+           (faces.capacity() * sizeof(const MeshFace*));
+}
+
+
+void MeshFaceBVH::setupRay(const Ray& ray, RayBox& rb)
+{
+    const float* o = ray.getOrigin();
+    const float* d = ray.getDirection();
+    for (int a = 0; a < 3; a++)
+    {
+        rb.origin[a] = o[a];
+        rb.parallel[a] = (d[a] == 0.0f);
+        rb.invDir[a] = rb.parallel[a] ? 0.0f : (1.0f / d[a]);
+    }
+    return;
+}
+
+
+bool MeshFaceBVH::hitsBox(const RayBox& rb, const Node& node, float maxTime)
+{
+    float tmin = 0.0f;
+    float tmax = maxTime;
+    for (int a = 0; a < 3; a++)
+    {
+        if (rb.parallel[a])
+        {
+            if ((rb.origin[a] < node.mins[a]) || (rb.origin[a] > node.maxs[a]))
+                return false;
+            continue;
+        }
+        float t1 = (node.mins[a] - rb.origin[a]) * rb.invDir[a];
+        float t2 = (node.maxs[a] - rb.origin[a]) * rb.invDir[a];
+        if (t1 > t2)
+            std::swap(t1, t2);
+        tmin = std::max(tmin, t1);
+        tmax = std::min(tmax, t2);
+        if (tmin > tmax)
+            return false;
+    }
+    return true;
+}
+
+
+bool MeshFaceBVH::hitsFace(const Ray& ray, float maxTime) const
+{
+    if (nodes.empty())
+        return false;
+
+    RayBox rb;
+    setupRay(ray, rb);
+
+    int stack[maxStackDepth];
+    int depth = 0;
+    stack[depth++] = 0;
+    while (depth > 0)
+    {
+        const Node& node = nodes[stack[--depth]];
+        if (!hitsBox(rb, node, maxTime))
+            continue;
+
+        if (node.count > 0)
+        {
+            const MeshFace* const* leaf = &faces[node.first];
+            for (int i = 0; i < node.count; i++)
+            {
+                const float hitTime = leaf[i]->intersect(ray);
+                if ((hitTime > 0.0f) && (hitTime <= maxTime))
+                    return true;
+            }
+        }
+        else
+        {
+            stack[depth++] = node.first;
+            stack[depth++] = (int)(&node - &nodes[0]) + 1;
+        }
+    }
+
+    return false;
+}
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
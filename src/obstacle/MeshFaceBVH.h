@@ -0,0 +1,91 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/* MeshFaceBVH:
+ *  Bounding volume hierarchy over the faces of one MeshObstacle.
+ *  The nodes live in a single array in depth first order, the left
+ *  child of an inner node directly follows it.
+ */
+
+#ifndef BZF_MESH_FACE_BVH_H
+#define BZF_MESH_FACE_BVH_H
+
+#include "common.h"
+
+/* system interface headers */
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/* common interface headers */
+#include "Ray.h"
+
+class MeshFace;
+
+class MeshFaceBVH
+{
+public:
+    MeshFaceBVH(MeshFace* const* faces, int faceCount);
+
+    // true if the ray hits a face at 0 < t <= maxTime
+    bool hitsFace(const Ray& ray, float maxTime) const;
+
+    int getNodeCount() const;
+    size_t getMemoryUsed() const;
+
+private:
+    struct Node
+    {
+        float mins[3];
+        float maxs[3];
+        int32_t first;  // leaf: first entry in faces, inner: right child
+        int32_t count;  // leaf: face count, inner: 0
+    };
+
+    struct BuildFace
+    {
+        float center[3];
+        const MeshFace* face;
+    };
+
+    // ray data shared by the box tests of one query
+    struct RayBox
+    {
+        float origin[3];
+        float invDir[3];
+        bool parallel[3];
+    };
+
+    int buildNode(std::vector<BuildFace>& build, int begin, int end);
+    static void setupRay(const Ray& ray, RayBox& rb);
+    static bool hitsBox(const RayBox& rb, const Node& node, float maxTime);
+
+private:
+    std::vector<Node> nodes;
+    std::vector<const MeshFace*> faces; // in leaf order
+};
+
+inline int MeshFaceBVH::getNodeCount() const
+{
+    return (int)nodes.size();
+}
+
+
+#endif // BZF_MESH_FACE_BVH_H
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
@@ -28,13 +28,18 @@
 #include "MeshDrawInfo.h"
 #include "MeshTransform.h"
 #include "StateDatabase.h"
+#include "TimeKeeper.h"
 
 // local headers
+#include "MeshFaceBVH.h"
 #include "Triangulate.h"
 
 
 const char* MeshObstacle::typeName = "MeshObstacle";
 
+// below this many faces the linear face loop beats the tree
+static const int minBVHFaces = 16;
+
 
 MeshObstacle::MeshObstacle()
 {
@@ -54,6 +59,8 @@ MeshObstacle::MeshObstacle()
     shootThrough = false;
     inverted = false;
     drawInfo = NULL;
+    faceBVH = NULL;
+    source = NULL;
     return;
 }
 
@@ -68,15 +75,6 @@ static void cfvec3ListToArray(const std::vector<cfvec3>& list,
     return;
 }
 
-static void arrayToCafvec3List(const afvec3* array, int count,
-                               std::vector<cfvec3>& list)
-{
-    list.clear();
-    for (int i = 0; i < count; i++)
-        list.push_back(array[i]);
-    return;
-}
-
 
 MeshObstacle::MeshObstacle(const MeshTransform& transform,
                            const std::vector<char>& checkTypesL,
@@ -126,6 +124,8 @@ MeshObstacle::MeshObstacle(const MeshTransform& transform,
     ricochet = rico;
 
     drawInfo = NULL;
+    faceBVH = NULL;
+    source = NULL;
 
     return;
 }
@@ -293,15 +293,19 @@ void MeshObstacle::makeFacePointers(const std::vector<int>& _vertices,
 
 MeshObstacle::~MeshObstacle()
 {
-    delete[] checkTypes;
+    if (source == NULL)
+    {
+        delete[] checkTypes;
+        delete[] texcoords;
+    }
     delete[] checkPoints;
     delete[] vertices;
     delete[] normals;
-    delete[] texcoords;
     for (int i = 0; i < faceCount; i++)
         delete faces[i];
     delete[] faces;
     delete drawInfo;
+    delete faceBVH;
     return;
 }
 
@@ -326,21 +330,8 @@ Obstacle* MeshObstacle::copyWithTransform(const MeshTransform& xform) const
     }
     else
     {
-        int i;
-        for (i = 0; i < checkCount; i++)
-            ctlist.push_back(checkTypes[i]);
-        arrayToCafvec3List(checkPoints, checkCount, clist);
-        arrayToCafvec3List(vertices, vertexCount, vlist);
-        arrayToCafvec3List(normals, normalCount, nlist);
-        for (i = 0; i < texcoordCount; i++)
-            tlist.push_back(texcoords[i]);
-
-        copy = new MeshObstacle(xform, ctlist, clist,
-                                vlist, nlist, tlist, faceCount, noclusters,
-                                smoothBounce, driveThrough, shootThrough, ricochet);
-
-        for (i = 0; i < faceCount; i++)
-            copyFace(i, copy);
+        copy = new MeshObstacle();
+        copy->makeInstance(this, xform);
     }
 
     copy->finalize();
@@ -349,6 +340,92 @@ Obstacle* MeshObstacle::copyWithTransform(const MeshTransform& xform) const
 }
 
 
+void MeshObstacle::makeInstance(const MeshObstacle* src,
+                                const MeshTransform& xform)
+{
+    // the source is a mesh of a group definition, never a copy, as
+    // nested groups are made from their definitions with the combined
+    // transform.  the definitions live at least as long as the world
+    // obstacles made from them
+    source = src;
+
+    MeshTransform::Tool xformtool(xform);
+    inverted = xformtool.isInverted();
+
+    // these are not touched by the transform, reference them
+    checkCount = src->checkCount;
+    checkTypes = src->checkTypes;
+    texcoordCount = src->texcoordCount;
+    texcoords = src->texcoords;
+
+    // the rest is copied straight from the arrays
+    int i;
+    checkPoints = new afvec3[checkCount];
+    memcpy(checkPoints, src->checkPoints, checkCount * sizeof(afvec3));
+    for (i = 0; i < checkCount; i++)
+        xformtool.modifyVertex(checkPoints[i]);
+    vertexCount = src->vertexCount;
+    vertices = new afvec3[vertexCount];
+    memcpy(vertices, src->vertices, vertexCount * sizeof(afvec3));
+    for (i = 0; i < vertexCount; i++)
+        xformtool.modifyVertex(vertices[i]);
+    normalCount = src->normalCount;
+    normals = new afvec3[normalCount];
+    memcpy(normals, src->normals, normalCount * sizeof(afvec3));
+    for (i = 0; i < normalCount; i++)
+        xformtool.modifyNormal(normals[i]);
+
+    noclusters = src->noclusters;
+    smoothBounce = src->smoothBounce;
+    driveThrough = src->driveThrough;
+    shootThrough = src->shootThrough;
+    ricochet = src->ricochet;
+
+    // the source faces were validated when they were added, so the
+    // face pointers can be remapped without going through addFace()
+    faceSize = src->faceCount;
+    faceCount = 0;
+    faces = new MeshFace*[faceSize];
+    for (int f = 0; f < src->faceCount; f++)
+    {
+        const MeshFace* srcFace = src->faces[f];
+        const int count = srcFace->getVertexCount();
+        float** v = new float*[count];
+        float** n = srcFace->useNormals() ? new float*[count] : NULL;
+        float** t = srcFace->useTexcoords() ? new float*[count] : NULL;
+        for (i = 0; i < count; i++)
+        {
+            // invert the vertices if required
+            const int index = (inverted ? ((count - 1) - i) : i);
+            v[index] = (float*)vertices[(const afvec3*)srcFace->getVertex(i) - src->vertices];
+            if (n != NULL)
+                n[index] = (float*)normals[(const afvec3*)srcFace->getNormal(i) - src->normals];
+            if (t != NULL)
+                t[index] = (float*)srcFace->getTexcoord(i);
+        }
+
+        MeshFace* face = new MeshFace(this, count, v, n, t,
+                                      srcFace->getMaterial(),
+                                      srcFace->getPhysicsDriver(),
+                                      srcFace->noClusters(),
+                                      srcFace->isSmoothBounce(),
+                                      srcFace->isDriveThrough(),
+                                      srcFace->isShootThrough(),
+                                      srcFace->canRicochet());
+        // a degenerate transform can flatten a face
+        if (face->isValid())
+        {
+            faces[faceCount] = face;
+            faceCount++;
+        }
+        else
+            delete face;
+    }
+
+    return;
+}
+
+
 void MeshObstacle::copyFace(int f, MeshObstacle* mesh) const
 {
     MeshFace* face = faces[f];
@@ -409,6 +486,19 @@ void MeshObstacle::finalize()
     angle = 0.0f;
     ZFlip = false;
 
+    // build the face tree for the point and ray queries
+    delete faceBVH;
+    faceBVH = NULL;
+    if (faceCount >= minBVHFaces)
+    {
+        TimeKeeper startTime = TimeKeeper::getCurrent();
+        faceBVH = new MeshFaceBVH(faces, faceCount);
+        const float elapsed = (float)(TimeKeeper::getCurrent() - startTime);
+        logDebugMessage(4,"Mesh \"%s\": %i faces, BVH %i nodes, %i bytes, %.3f ms\n",
+                        name.c_str(), faceCount, faceBVH->getNodeCount(),
+                        (int)faceBVH->getMemoryUsed(), elapsed * 1000.0f);
+    }
+
     return;
 }
 
@@ -465,18 +555,32 @@ bool MeshObstacle::isValid() const
 
 bool MeshObstacle::containsPoint(const float point[3]) const
 {
-    // this should use the CollisionManager's rayTest function
-//  const ObsList* olist = COLLISIONMGR.rayTest (&ray, t);
+    // the face BVH replaces the octree for the check point rays
     return containsPointNoOctree(point);
 }
 
 
+bool MeshObstacle::hitsFace(const Ray& ray) const
+{
+    if (faceBVH != NULL)
+        return faceBVH->hitsFace(ray, 1.0f);
+
+    for (int f = 0; f < faceCount; f++)
+    {
+        const float hittime = faces[f]->intersect(ray);
+        if ((hittime > 0.0f) && (hittime <= 1.0f))
+            return true;
+    }
+    return false;
+}
+
+
 bool MeshObstacle::containsPointNoOctree(const float point[3]) const
 {
     if (checkCount <= 0)
         return false;
 
-    int c, f;
+    int c;
     float dir[3];
     bool hasOutsides = false;
 
@@ -486,17 +590,7 @@ bool MeshObstacle::containsPointNoOctree(const float point[3]) const
         {
             vec3sub (dir, checkPoints[c], point);
             Ray ray(point, dir);
-            bool hitFace = false;
-            for (f = 0; f < faceCount; f++)
-            {
-                const MeshFace* face = faces[f];
-                const float hittime = face->intersect(ray);
-                if ((hittime > 0.0f) && (hittime <= 1.0f))
-                {
-                    hitFace = true;
-                    break;
-                }
-            }
+            const bool hitFace = hitsFace(ray);
             if (!hitFace)
                 return true;
         }
@@ -505,17 +599,7 @@ bool MeshObstacle::containsPointNoOctree(const float point[3]) const
             hasOutsides = true;
             vec3sub (dir, point, checkPoints[c]);
             Ray ray(checkPoints[c], dir);
-            bool hitFace = false;
-            for (f = 0; f < faceCount; f++)
-            {
-                const MeshFace* face = faces[f];
-                const float hittime = face->intersect(ray);
-                if ((hittime > 0.0f) && (hittime <= 1.0f))
-                {
-                    hitFace = true;
-                    break;
-                }
-            }
+            const bool hitFace = hitsFace(ray);
             if (!hitFace)
                 return false;
         }
@@ -536,6 +620,12 @@ float MeshObstacle::intersect(const Ray& UNUSED(ray)) const
 }
 
 
+size_t MeshObstacle::getFaceBVHMemory() const
+{
+    return (faceBVH != NULL) ? faceBVH->getMemoryUsed() : 0;
+}
+
+
 void MeshObstacle::get3DNormal(const float* UNUSED(p), float* UNUSED(n)) const
 {
     return; // this should never be called if intersect() is always < 0.0f
@@ -32,6 +32,7 @@
 #include "PhysicsDriver.h"
 #include "MagnumBZMaterial.h"
 #include "MeshDrawInfo.h"
+#include "TimeKeeper.h"
 
 // obstacle headers
 #include "Obstacle.h"
@@ -616,7 +617,12 @@ void GroupDefinition::makeGroups(const MeshTransform& xform,
                 obs = list[i]; // no need to copy
             }
             else
+            {
+                // FIXME - every instance is a full copy, with its own
+                // faces. sharing them would need the collision tree and
+                // the face tests to work in the group definition's space
                 obs = list[i]->copyWithTransform(xform);
+            }
 
             // the tele names are setup with default names if
             // they are not named (even for those in the world
@@ -1073,6 +1079,8 @@ void GroupDefinitionMgr::makeWorld()
     MeshTransform noXform;
     ObstacleModifier noMods;
 
+    TimeKeeper startTime = TimeKeeper::getCurrent();
+
     world.makeGroups(noXform, noMods);
 
     world.deleteInvalidObstacles();
@@ -1083,6 +1091,31 @@ void GroupDefinitionMgr::makeWorld()
 
     tighten();
 
+    // print some statistics about the group instance mesh copies
+    const ObstacleList& meshes = getMeshes();
+    int copyCount = 0;
+    size_t copiedBytes = 0;
+    size_t sharedBytes = 0;
+    size_t bvhBytes = 0;
+    for (unsigned int i = 0; i < meshes.size(); i++)
+    {
+        const MeshObstacle* mesh = (const MeshObstacle*) meshes[i];
+        bvhBytes += mesh->getFaceBVHMemory();
+        if (!mesh->isCopy())
+            continue;
+        copyCount++;
+        copiedBytes += (mesh->getCheckCount() + mesh->getVertexCount() +
+                        mesh->getNormalCount()) * sizeof(afvec3);
+        sharedBytes += mesh->getCheckCount() * sizeof(char) +
+                       mesh->getTexcoordCount() * sizeof(afvec2);
+    }
+    logDebugMessage(2,"Mesh copies = %i (%i KB copied, %i KB shared)\n",
+                    copyCount, (int)(copiedBytes / 1024), (int)(sharedBytes / 1024));
+    logDebugMessage(2,"Mesh face BVHs = %i KB\n", (int)(bvhBytes / 1024));
+
+    float elapsed = (float)(TimeKeeper::getCurrent() - startTime);
+    logDebugMessage(2,"World obstacles made in %.3f seconds.\n", elapsed);
+
     return;
 }
 
@@ -0,0 +1,180 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/* Runs a synthetic storm of effects through the particle emitters
+ * without a window.  Every effect type is kept at about the same
+ * number of live effects, respawning them as fast as they expire, and
+ * the update step and the instance building are timed per type.
+ *
+ * usage: effectparticles_bench [live effects] [frames]
+ */
+
+// system headers
+#include <stdio.h>
+#include <stdlib.h>
+
+// common headers
+#include "common.h"
+#include "TimeKeeper.h"
+
+// client headers
+#include "EffectParticles.h"
+
+static const char* typeNames[ParticleEmitter::TypeCount] =
+{
+    "SpawnBlossom",
+    "SpawnCone",
+    "SpawnRings",
+    "ShotSmoke",
+    "ShotFlash",
+    "GMPuffCone",
+    "GMPuffSmoke",
+    "LandDirt",
+    "RicoRing",
+    "ShotTeleport"
+};
+
+struct Totals
+{
+    double live;
+    double updateTime;
+    double buildTime;
+    double instances;
+};
+
+// somewhere on a map sized area, heading off in some direction
+static void emitRandom(ParticleEmitter* emitter, float time)
+{
+    const float pos[3] = { (float)bzfrand() * 800.0f - 400.0f,
+                           (float)bzfrand() * 800.0f - 400.0f,
+                           (float)bzfrand() * 20.0f
+                         };
+    const float rot[3] = { 0.0f, (float)bzfrand() * 0.5f,
+                           (float)bzfrand() * 6.2831853f
+                         };
+    const float vel[3] = { (float)bzfrand() * 20.0f - 10.0f,
+                           (float)bzfrand() * 20.0f - 10.0f,
+                           0.0f
+                         };
+    const float rgb[3] = { 1.0f, 0.5f, 0.25f };
+    emitter->emit(time, pos, rot, vel, rgb);
+}
+
+int main(int argc, char** argv)
+{
+    int effects = 10000;
+    int frames = 600;
+    if (argc > 1)
+        effects = atoi(argv[1]);
+    if (argc > 2)
+        frames = atoi(argv[2]);
+    if (effects < ParticleEmitter::TypeCount)
+        effects = ParticleEmitter::TypeCount;
+    if (frames < 1)
+        frames = 1;
+
+    const int perType = effects / ParticleEmitter::TypeCount;
+    const float frameTime = 1.0f / 60.0f;
+
+    EffectView view;
+    for (int i = 0; i < 9; i++)
+        view.billboard[i] = (i % 4 == 0) ? 1.0f : 0.0f;
+    view.hasViewer = true;
+    view.viewerPos[0] = view.viewerPos[1] = 0.0f;
+    view.viewerPos[2] = 10.0f;
+
+    ParticleEmitter* emitters[ParticleEmitter::TypeCount];
+    float spawnDebt[ParticleEmitter::TypeCount];
+    Totals totals[ParticleEmitter::TypeCount];
+
+    // ages spread over the lifetime, so the storm starts out steady
+    for (int t = 0; t < ParticleEmitter::TypeCount; t++)
+    {
+        emitters[t] = ParticleEmitter::create((ParticleEmitter::Type)t);
+        spawnDebt[t] = 0.0f;
+        totals[t].live = totals[t].updateTime = 0.0;
+        totals[t].buildTime = totals[t].instances = 0.0;
+
+        const float life = emitters[t]->getLifetime();
+        for (int i = 0; i < perType; i++)
+            emitRandom(emitters[t], -life * i / perType);
+    }
+
+    EffectBatch batch;
+    float time = 0.0f;
+    for (int f = 0; f < frames; f++)
+    {
+        time += frameTime;
+        for (int t = 0; t < ParticleEmitter::TypeCount; t++)
+        {
+            ParticleEmitter* emitter = emitters[t];
+
+            // replace what expired, at the rate it expires
+            spawnDebt[t] += perType * frameTime / emitter->getLifetime();
+            while (spawnDebt[t] >= 1.0f)
+            {
+                emitRandom(emitter, time);
+                spawnDebt[t] -= 1.0f;
+            }
+
+            const TimeKeeper start = TimeKeeper::getCurrent();
+            totals[t].live += emitter->update(time);
+            const TimeKeeper updated = TimeKeeper::getCurrent();
+            batch.clear();
+            emitter->build(batch, view);
+            const TimeKeeper built = TimeKeeper::getCurrent();
+
+            totals[t].updateTime += updated - start;
+            totals[t].buildTime += built - updated;
+            totals[t].instances += batch.getInstanceCount();
+        }
+    }
+
+    printf("%d frames, %d effects per type\n\n", frames, perType);
+    printf("%-14s %8s %12s %12s %10s %10s %8s\n", "type", "live",
+           "update us", "build us", "instances", "KB", "dropped");
+
+    Totals all = { 0.0, 0.0, 0.0, 0.0 };
+    unsigned int dropped = 0;
+    for (int t = 0; t < ParticleEmitter::TypeCount; t++)
+    {
+        const Totals& total = totals[t];
+        printf("%-14s %8.0f %12.1f %12.1f %10.0f %10.1f %8u\n", typeNames[t],
+               total.live / frames, 1.0e6 * total.updateTime / frames,
+               1.0e6 * total.buildTime / frames, total.instances / frames,
+               total.instances * sizeof(EffectInstance) / 1024.0 / frames,
+               emitters[t]->getDropped());
+
+        all.live += total.live;
+        all.updateTime += total.updateTime;
+        all.buildTime += total.buildTime;
+        all.instances += total.instances;
+        dropped += emitters[t]->getDropped();
+        delete emitters[t];
+    }
+    printf("%-14s %8.0f %12.1f %12.1f %10.0f %10.1f %8u\n", "all",
+           all.live / frames, 1.0e6 * all.updateTime / frames,
+           1.0e6 * all.buildTime / frames, all.instances / frames,
+           all.instances * sizeof(EffectInstance) / 1024.0 / frames, dropped);
+    printf("\nper frame; KB is the instance data uploaded\n");
+
+    return 0;
+}
+
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
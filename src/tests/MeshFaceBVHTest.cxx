@@ -0,0 +1,257 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/* Checks the mesh face BVH against the linear face loop it replaced.
+ * Closed terrain meshes, plain and transformed, are asked whether
+ * random points are inside, and random rays, axis parallel ones
+ * included, whether they hit a face before a random time.  Exits with
+ * the number of failures.
+ */
+
+// system headers
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+// common headers
+#include "MeshObstacle.h"
+#include "MeshFace.h"
+#include "MeshTransform.h"
+#include "Ray.h"
+
+// obstacle headers
+#include "MeshFaceBVH.h"
+
+int debugLevel = 0;
+
+static int failures = 0;
+
+static void check(bool ok, const char* what, const char* mesh, int index)
+{
+    if (ok)
+        return;
+    if (failures < 20)
+        printf("FAIL: %s (%s, #%d)\n", what, mesh, index);
+    failures++;
+}
+
+static float frand(float low, float high)
+{
+    return low + (high - low) * ((float)rand() / (float)RAND_MAX);
+}
+
+static void addFace(MeshObstacle* mesh, int a, int b, int c, int d = -1)
+{
+    std::vector<int> vertices, none;
+    vertices.push_back(a);
+    vertices.push_back(b);
+    vertices.push_back(c);
+    if (d >= 0)
+        vertices.push_back(d);
+    mesh->addFace(vertices, none, none, NULL, -1,
+                  false, false, false, false, false, false);
+}
+
+// a box with a bumpy top, closed on all sides, with an inside check
+// point under the top
+static MeshObstacle* makeTerrain(int side)
+{
+    std::vector<cfvec3> vertices, none3;
+    std::vector<cfvec2> none2;
+    for (int layer = 0; layer < 2; layer++)
+    {
+        for (int y = 0; y < side; y++)
+        {
+            for (int x = 0; x < side; x++)
+            {
+                cfvec3 v;
+                v.data[0] = (float)x;
+                v.data[1] = (float)y;
+                v.data[2] = (layer == 0) ? frand(5.0f, 7.0f) : 0.0f;
+                vertices.push_back(v);
+            }
+        }
+    }
+
+    std::vector<char> checkTypes(1, MeshObstacle::CheckInside);
+    std::vector<cfvec3> checkPoints(1);
+    checkPoints[0].data[0] = side * 0.5f;
+    checkPoints[0].data[1] = side * 0.5f;
+    checkPoints[0].data[2] = 2.0f;
+
+    const int faceCount = 3 * (side - 1) * (side - 1) + 4 * (side - 1);
+    MeshTransform noXform;
+    MeshObstacle* mesh = new MeshObstacle(noXform, checkTypes, checkPoints,
+                                          vertices, none3, none2, faceCount,
+                                          false, false, false, false, false);
+
+    const int bottom = side * side;
+    for (int y = 0; y < side - 1; y++)
+    {
+        for (int x = 0; x < side - 1; x++)
+        {
+            const int a = y * side + x;
+            addFace(mesh, a, a + 1, a + side + 1);
+            addFace(mesh, a, a + side + 1, a + side);
+            addFace(mesh, bottom + a, bottom + a + side,
+                    bottom + a + side + 1, bottom + a + 1);
+        }
+    }
+    for (int i = 0; i < side - 1; i++)
+    {
+        int a = i;
+        addFace(mesh, a, bottom + a, bottom + a + 1, a + 1);
+        a = (side - 1) * side + i;
+        addFace(mesh, a, a + 1, bottom + a + 1, bottom + a);
+        a = i * side;
+        addFace(mesh, a, a + side, bottom + a + side, bottom + a);
+        a = i * side + side - 1;
+        addFace(mesh, a, bottom + a, bottom + a + side, a + side);
+    }
+    mesh->finalize();
+    return mesh;
+}
+
+static bool linearHitsFace(const MeshObstacle* mesh, const Ray& ray, float maxTime)
+{
+    for (int f = 0; f < mesh->getFaceCount(); f++)
+    {
+        const float t = mesh->getFace(f)->intersect(ray);
+        if ((t > 0.0f) && (t <= maxTime))
+            return true;
+    }
+    return false;
+}
+
+// MeshObstacle::containsPoint() the way it was before the tree
+static bool linearContainsPoint(const MeshObstacle* mesh, const float* point)
+{
+    const char* types = mesh->getCheckTypes();
+    const afvec3* checks = mesh->getCheckPoints();
+    bool hasOutsides = false;
+    for (int c = 0; c < mesh->getCheckCount(); c++)
+    {
+        float dir[3];
+        if (types[c] == MeshObstacle::CheckInside)
+        {
+            for (int a = 0; a < 3; a++)
+                dir[a] = checks[c][a] - point[a];
+            if (!linearHitsFace(mesh, Ray(point, dir), 1.0f))
+                return true;
+        }
+        else
+        {
+            hasOutsides = true;
+            for (int a = 0; a < 3; a++)
+                dir[a] = point[a] - checks[c][a];
+            if (!linearHitsFace(mesh, Ray(checks[c], dir), 1.0f))
+                return false;
+        }
+    }
+    return hasOutsides;
+}
+
+static void checkMesh(const char* name, const MeshObstacle* mesh)
+{
+    std::vector<MeshFace*> faces;
+    for (int f = 0; f < mesh->getFaceCount(); f++)
+        faces.push_back(mesh->getFace(f));
+    const MeshFaceBVH bvh(faces.data(), (int)faces.size());
+    check(mesh->getFaceBVHMemory() > 0, "mesh has a face BVH", name, 0);
+
+    const Extents& exts = mesh->getExtents();
+    float mins[3], maxs[3];
+    for (int a = 0; a < 3; a++)
+    {
+        const float margin = 0.25f * (exts.maxs[a] - exts.mins[a]) + 1.0f;
+        mins[a] = exts.mins[a] - margin;
+        maxs[a] = exts.maxs[a] + margin;
+    }
+
+    int inside = 0;
+    for (int i = 0; i < 20000; i++)
+    {
+        float point[3];
+        for (int a = 0; a < 3; a++)
+            point[a] = frand(mins[a], maxs[a]);
+        const bool expected = linearContainsPoint(mesh, point);
+        check(mesh->containsPoint(point) == expected, "containsPoint", name, i);
+        inside += expected ? 1 : 0;
+    }
+    // both answers should come up, or the points missed the mesh
+    check((inside > 100) && (inside < 19900), "points inside and outside", name, inside);
+
+    for (int i = 0; i < 20000; i++)
+    {
+        float origin[3], dir[3];
+        for (int a = 0; a < 3; a++)
+        {
+            origin[a] = frand(mins[a], maxs[a]);
+            dir[a] = frand(-1.0f, 1.0f);
+        }
+        // axis parallel rays take the special case in the box test
+        if ((i % 4) == 0)
+            dir[i % 3] = 0.0f;
+        if ((i % 8) == 0)
+            dir[(i + 1) % 3] = 0.0f;
+        const float maxTime = frand(0.0f, 2.0f * (maxs[0] - mins[0]));
+        const Ray ray(origin, dir);
+        check(bvh.hitsFace(ray, maxTime) == linearHitsFace(mesh, ray, maxTime),
+              "hitsFace", name, i);
+    }
+}
+
+int main()
+{
+    srand(1);
+
+    MeshObstacle* terrain = makeTerrain(40);
+    checkMesh("terrain", terrain);
+
+    // group instance copies build their own tree
+    MeshTransform xform;
+    const float shift[3] = { 100.0f, -50.0f, 3.0f };
+    const float scale[3] = { 1.5f, 0.5f, 2.0f };
+    const float axis[3] = { 0.3f, 0.2f, 1.0f };
+    xform.addScale(scale);
+    xform.addSpin(37.0f, axis);
+    xform.addShift(shift);
+    xform.finalize();
+    MeshObstacle* copy = (MeshObstacle*) terrain->copyWithTransform(xform);
+    checkMesh("transformed copy", copy);
+
+    MeshTransform mirror;
+    const float flip[3] = { -1.0f, 1.0f, 1.0f };
+    mirror.addScale(flip);
+    mirror.finalize();
+    MeshObstacle* mirrored = (MeshObstacle*) terrain->copyWithTransform(mirror);
+    checkMesh("mirrored copy", mirrored);
+
+    delete mirrored;
+    delete copy;
+    delete terrain;
+
+    if (failures)
+        printf("%d failures\n", failures);
+    else
+        printf("all passed\n");
+    return failures ? 1 : 0;
+}
+
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
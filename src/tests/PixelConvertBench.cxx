@@ -0,0 +1,148 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/* Times each PixelConvert kernel over a 1024x1024 image with every
+ * instruction set this machine supports, and prints the speedup over
+ * the scalar loops.
+ *
+ * usage: pixelconvert_bench [images per round]
+ */
+
+// system headers
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+// common headers
+#include "PixelConvert.h"
+#include "TimeKeeper.h"
+
+static const size_t imagePixels = 1024 * 1024;
+
+static std::vector<unsigned char> input;
+static std::vector<unsigned char> output;
+static std::vector<unsigned char> opaque;
+static volatile bool translucent;
+
+static void grayToRGBA()
+{
+    PixelConvert::grayToRGBA(input.data(), output.data(), imagePixels);
+}
+
+static void grayAlphaToRGBA()
+{
+    PixelConvert::grayAlphaToRGBA(input.data(), output.data(), imagePixels);
+}
+
+static void rgbToRGBA()
+{
+    PixelConvert::rgbToRGBA(input.data(), output.data(), imagePixels);
+}
+
+static void narrow16To8()
+{
+    PixelConvert::narrow16To8(input.data(), output.data(), imagePixels * 4, true);
+}
+
+static void interleavePlanes()
+{
+    const unsigned char* planes[4] =
+    {
+        &input[0], &input[imagePixels], &input[2 * imagePixels], &input[3 * imagePixels]
+    };
+    PixelConvert::interleavePlanes(planes, 4, output.data(), imagePixels);
+}
+
+static void hasTranslucentPixel()
+{
+    translucent = PixelConvert::hasTranslucentPixel(opaque.data(), imagePixels);
+}
+
+struct Kernel
+{
+    const char* name;
+    void (*run)();
+};
+
+static const Kernel kernels[] =
+{
+    { "grayToRGBA", grayToRGBA },
+    { "grayAlphaToRGBA", grayAlphaToRGBA },
+    { "rgbToRGBA", rgbToRGBA },
+    { "narrow16To8", narrow16To8 },
+    { "interleavePlanes", interleavePlanes },
+    { "hasTranslucentPixel", hasTranslucentPixel },
+};
+
+// best of a few rounds, in milliseconds per image
+static double timeKernel(const Kernel& kernel, int images)
+{
+    double best = 0.0;
+    for (int round = 0; round < 5; round++)
+    {
+        const TimeKeeper start = TimeKeeper::getCurrent();
+        for (int i = 0; i < images; i++)
+            kernel.run();
+        const double ms = 1000.0 * (TimeKeeper::getCurrent() - start) / images;
+        if ((round == 0) || (ms < best))
+            best = ms;
+    }
+    return best;
+}
+
+int main(int argc, char** argv)
+{
+    int images = 20;
+    if (argc > 1)
+        images = atoi(argv[1]);
+    if (images < 1)
+        images = 1;
+
+    // two bytes per sample for narrow16To8, and an opaque image for the
+    // alpha scan so that it reads all of it
+    input.resize(imagePixels * 8);
+    for (size_t i = 0; i < input.size(); i++)
+        input[i] = (unsigned char)(rand() & 0xff);
+    output.resize(imagePixels * 4);
+    opaque.assign(imagePixels * 4, 0xff);
+
+    const PixelConvert::InstructionSet best = PixelConvert::getInstructionSet();
+    const int kernelCount = (int)(sizeof(kernels) / sizeof(kernels[0]));
+    printf("%-20s %10s %10s %8s\n", "1 Mpixel image", "set", "ms", "speedup");
+    for (int k = 0; k < kernelCount; k++)
+    {
+        PixelConvert::setInstructionSet(PixelConvert::Scalar);
+        const double scalar = timeKernel(kernels[k], images);
+        printf("%-20s %10s %10.3f %8s\n", kernels[k].name, "scalar", scalar, "");
+
+        for (int s = PixelConvert::Scalar + 1; s <= PixelConvert::NEON; s++)
+        {
+            const PixelConvert::InstructionSet set = (PixelConvert::InstructionSet)s;
+            if (!PixelConvert::setInstructionSet(set))
+                continue;
+            const double ms = timeKernel(kernels[k], images);
+            printf("%-20s %10s %10.3f %7.2fx\n", "", PixelConvert::getInstructionSetName(set),
+                   ms, (ms > 0.0) ? scalar / ms : 0.0);
+        }
+    }
+    PixelConvert::setInstructionSet(best);
+    return 0;
+}
+
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
@@ -0,0 +1,194 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/* Runs every PixelConvert kernel this machine supports against the
+ * scalar version, for all lengths up to a few vector widths and with
+ * unaligned buffers, so the tails and the end of buffer guards are
+ * covered.  Exits with the number of failures.
+ */
+
+// system headers
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+// common headers
+#include "PixelConvert.h"
+
+static const size_t maxPixels = 300;
+static int failures = 0;
+
+static void check(bool ok, const char* what, PixelConvert::InstructionSet set, size_t pixels)
+{
+    if (ok)
+        return;
+    if (failures < 20)
+        printf("FAIL: %s (%s, %d pixels)\n", what, PixelConvert::getInstructionSetName(set), (int)pixels);
+    failures++;
+}
+
+static void fillRandom(std::vector<unsigned char>& buffer)
+{
+    for (size_t i = 0; i < buffer.size(); i++)
+        buffer[i] = (unsigned char)(rand() & 0xff);
+}
+
+// each input is copied to the end of an exactly sized buffer so that
+// reading past it shows up under a memory checker
+static const unsigned char* atEnd(std::vector<unsigned char>& buffer, const std::vector<unsigned char>& data)
+{
+    buffer.assign(data.size() + 1, 0);
+    if (!data.empty())
+        memcpy(&buffer[1], data.data(), data.size());
+    return &buffer[1];
+}
+
+typedef void (*Convert)(const unsigned char*, unsigned char*, size_t);
+
+static void checkConvert(const char* what, Convert convert, int inChannels,
+                         PixelConvert::InstructionSet set)
+{
+    std::vector<unsigned char> data, buffer, expected, actual;
+    for (size_t pixels = 0; pixels <= maxPixels; pixels++)
+    {
+        data.resize(pixels * inChannels);
+        fillRandom(data);
+        const unsigned char* src = atEnd(buffer, data);
+
+        expected.assign(pixels * 4 + 1, 0x5a);
+        actual.assign(pixels * 4 + 1, 0x5a);
+        PixelConvert::setInstructionSet(PixelConvert::Scalar);
+        convert(src, &expected[1], pixels);
+        PixelConvert::setInstructionSet(set);
+        convert(src, &actual[1], pixels);
+        check(expected == actual, what, set, pixels);
+    }
+}
+
+static void checkNarrow(PixelConvert::InstructionSet set)
+{
+    std::vector<unsigned char> data, buffer, expected, actual;
+    for (int bigEndian = 0; bigEndian < 2; bigEndian++)
+    {
+        for (size_t samples = 0; samples <= maxPixels; samples++)
+        {
+            data.resize(samples * 2);
+            fillRandom(data);
+            const unsigned char* src = atEnd(buffer, data);
+
+            expected.assign(samples + 1, 0x5a);
+            actual.assign(samples + 1, 0x5a);
+            PixelConvert::setInstructionSet(PixelConvert::Scalar);
+            PixelConvert::narrow16To8(src, &expected[1], samples, bigEndian != 0);
+            PixelConvert::setInstructionSet(set);
+            PixelConvert::narrow16To8(src, &actual[1], samples, bigEndian != 0);
+            check(expected == actual, bigEndian ? "narrow16To8 big endian" : "narrow16To8 little endian",
+                  set, samples);
+
+            // the scalar version is the reference, so pin down what it keeps
+            bool msb = true;
+            for (size_t i = 0; i < samples; i++)
+                msb = msb && (expected[i + 1] == data[2 * i + (bigEndian ? 0 : 1)]);
+            check(msb, "narrow16To8 keeps the most significant byte", PixelConvert::Scalar, samples);
+        }
+    }
+}
+
+static void checkInterleave(PixelConvert::InstructionSet set)
+{
+    std::vector<unsigned char> data[4], buffer[4], expected, actual;
+    for (int channels = 1; channels <= 4; channels++)
+    {
+        for (size_t pixels = 0; pixels <= maxPixels; pixels++)
+        {
+            const unsigned char* planes[4];
+            for (int z = 0; z < channels; z++)
+            {
+                data[z].resize(pixels);
+                fillRandom(data[z]);
+                planes[z] = atEnd(buffer[z], data[z]);
+            }
+
+            expected.assign(pixels * channels + 1, 0x5a);
+            actual.assign(pixels * channels + 1, 0x5a);
+            PixelConvert::setInstructionSet(PixelConvert::Scalar);
+            PixelConvert::interleavePlanes(planes, channels, &expected[1], pixels);
+            PixelConvert::setInstructionSet(set);
+            PixelConvert::interleavePlanes(planes, channels, &actual[1], pixels);
+            check(expected == actual, "interleavePlanes", set, pixels);
+        }
+    }
+}
+
+static void checkTranslucent(PixelConvert::InstructionSet set)
+{
+    std::vector<unsigned char> data, buffer;
+    for (size_t pixels = 0; pixels <= maxPixels; pixels++)
+    {
+        data.resize(pixels * 4);
+        fillRandom(data);
+        for (size_t i = 0; i < pixels; i++)
+            data[4 * i + 3] = 0xff;
+
+        PixelConvert::setInstructionSet(set);
+        check(!PixelConvert::hasTranslucentPixel(atEnd(buffer, data), pixels),
+              "hasTranslucentPixel on opaque pixels", set, pixels);
+
+        // one translucent pixel at every position
+        for (size_t i = 0; i < pixels; i++)
+        {
+            data[4 * i + 3] = (unsigned char)(rand() % 0xff);
+            if (!PixelConvert::hasTranslucentPixel(atEnd(buffer, data), pixels))
+                check(false, "hasTranslucentPixel on translucent pixel", set, pixels);
+            data[4 * i + 3] = 0xff;
+        }
+    }
+}
+
+int main()
+{
+    const PixelConvert::InstructionSet best = PixelConvert::getInstructionSet();
+    printf("best instruction set: %s\n", PixelConvert::getInstructionSetName(best));
+
+    srand(1);
+    for (int s = PixelConvert::Scalar; s <= PixelConvert::NEON; s++)
+    {
+        const PixelConvert::InstructionSet set = (PixelConvert::InstructionSet)s;
+        if (!PixelConvert::setInstructionSet(set))
+            continue;
+        printf("checking %s\n", PixelConvert::getInstructionSetName(set));
+
+        checkConvert("grayToRGBA", PixelConvert::grayToRGBA, 1, set);
+        checkConvert("grayAlphaToRGBA", PixelConvert::grayAlphaToRGBA, 2, set);
+        checkConvert("rgbToRGBA", PixelConvert::rgbToRGBA, 3, set);
+        checkNarrow(set);
+        checkInterleave(set);
+        checkTranslucent(set);
+    }
+    PixelConvert::setInstructionSet(best);
+
+    if (failures)
+        printf("%d failures\n", failures);
+    else
+        printf("all passed\n");
+    return failures ? 1 : 0;
+}
+
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
@@ -0,0 +1,336 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/* Sends a driving tank through PlayerDeltaEncoder and PlayerDeltaDecoder
+ * and checks that every update that decodes is the one that was sent,
+ * to the resolution of the deltas.  Runs without loss, with lost updates
+ * and acknowledgements, and with updates out of order, then feeds the
+ * decoder cut off and random messages.  Exits with the number of
+ * failures.
+ */
+
+// system headers
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <deque>
+#include <vector>
+
+// common headers
+#include "PlayerStateDelta.h"
+
+static int failures = 0;
+
+static void check(bool ok, const char* what, int index = 0)
+{
+    if (ok)
+        return;
+    if (failures < 20)
+        printf("FAIL: %s (#%d)\n", what, index);
+    failures++;
+}
+
+static float frand(float low, float high)
+{
+    return low + (high - low) * ((float)rand() / (float)RAND_MAX);
+}
+
+// moves the tank one update on, now and then it jumps, lands on a
+// driver or is teleported across the map
+static void nextState(PlayerState& state)
+{
+    state.order++;
+    state.status = PlayerState::Alive;
+    state.angVel = frand(-1.0f, 1.0f);
+    state.azimuth += state.angVel / 30.0f;
+    const float speed = frand(0.0f, 25.0f);
+    state.velocity[0] = speed * cosf(state.azimuth);
+    state.velocity[1] = speed * sinf(state.azimuth);
+    state.velocity[2] = 0.0f;
+    for (int a = 0; a < 3; a++)
+        state.pos[a] += state.velocity[a] / 30.0f;
+
+    const int event = rand() % 100;
+    if (event < 5)
+    {
+        state.status |= PlayerState::Falling | PlayerState::JumpJets |
+                        PlayerState::PlaySound;
+        state.velocity[2] = frand(-30.0f, 30.0f);
+        state.jumpJetsScale = frand(0.0f, 1.0f);
+        state.sounds = PlayerState::JumpSound;
+    }
+    else if (event < 10)
+    {
+        state.status |= PlayerState::OnDriver | PlayerState::UserInputs;
+        state.phydrv = rand() % 10;
+        state.userSpeed = frand(-10.0f, 25.0f);
+        state.userAngVel = frand(-1.0f, 1.0f);
+    }
+    else if (event < 11)
+    {
+        state.status |= PlayerState::Teleporting;
+        state.pos[0] = frand(-400.0f, 400.0f);
+        state.pos[1] = frand(-400.0f, 400.0f);
+        state.pos[2] = frand(0.0f, 50.0f);
+        state.azimuth = frand(-100.0f, 100.0f);
+    }
+}
+
+// what the receiver should end up with, the motion at the delta
+// resolution and the extras the way PlayerState sends them
+static void checkState(const PlayerState& sent, const PlayerState& got,
+                       const char* what, int index)
+{
+    PlayerStateDelta::Quantized expected, actual;
+    PlayerStateDelta::quantize(sent, expected);
+    PlayerStateDelta::quantize(got, actual);
+    bool ok = (memcmp(&expected, &actual, sizeof(expected)) == 0);
+
+    char extras[32];
+    PlayerState reference;
+    reference.status = sent.status;
+    sent.packExtras(extras);
+    reference.unpackExtras(extras);
+    ok = ok && (got.jumpJetsScale == reference.jumpJetsScale) &&
+         (got.phydrv == reference.phydrv) &&
+         (got.userSpeed == reference.userSpeed) &&
+         (got.userAngVel == reference.userAngVel) &&
+         (((sent.status & PlayerState::PlaySound) == 0) ||
+          (got.sounds == sent.sounds));
+
+    // the position within half a centimeter
+    for (int a = 0; a < 3; a++)
+        ok = ok && (fabsf(got.pos[a] - sent.pos[a]) <= 0.006f);
+
+    check(ok, what, index);
+}
+
+struct Update
+{
+    std::vector<char> data;
+    PlayerState state;
+    int due;
+};
+
+static Update makeUpdate(PlayerDeltaEncoder& encoder, const PlayerState& state)
+{
+    char buffer[256];
+    const char* end = (const char*)encoder.pack(buffer, state);
+    Update update;
+    update.data.assign((const char*)buffer, end);
+    update.state = state;
+    update.due = 0;
+    return update;
+}
+
+static const void* decode(PlayerDeltaDecoder& decoder, const Update& update,
+                          PlayerState& state)
+{
+    const char* data = update.data.data();
+    return decoder.unpack(data, data + update.data.size(), state);
+}
+
+static void checkRoundTrip()
+{
+    PlayerDeltaEncoder encoder;
+    PlayerDeltaDecoder decoder;
+    PlayerState state;
+    state.status = PlayerState::Alive;
+
+    size_t fullBytes = 0, deltaBytes = 0;
+    int fullCount = 0;
+    for (int i = 0; i < 20000; i++)
+    {
+        nextState(state);
+        const Update update = makeUpdate(encoder, state);
+        deltaBytes += update.data.size();
+        if (encoder.lastWasFull())
+            fullCount++;
+
+        // the same update without a base
+        PlayerDeltaEncoder fresh;
+        fullBytes += makeUpdate(fresh, state).data.size();
+
+        PlayerState got;
+        const void* end = decode(decoder, update, got);
+        check(end == update.data.data() + update.data.size(), "round trip decodes", i);
+        if (end != NULL)
+            checkState(state, got, "round trip", i);
+
+        uint8_t sequence;
+        check(decoder.getPendingAck(sequence), "ack after an update", i);
+        encoder.acknowledge(sequence);
+    }
+    // only the first one has no base, and the deltas pay off
+    check(fullCount == 1, "one full update", fullCount);
+    check(deltaBytes < fullBytes * 3 / 4, "deltas are smaller", (int)deltaBytes);
+}
+
+// in order but lossy, every update that arrives must decode
+static void checkLoss(int lossPercent, int ackLossPercent, int maxAckDelay)
+{
+    PlayerDeltaEncoder encoder;
+    PlayerDeltaDecoder decoder;
+    PlayerState state;
+    state.status = PlayerState::Alive;
+    std::deque<Update> acks;
+
+    int received = 0;
+    for (int i = 0; i < 20000; i++)
+    {
+        nextState(state);
+        const Update update = makeUpdate(encoder, state);
+
+        // now and then the link is down for a while
+        const bool outage = ((i % 1000) >= 950);
+        if (!outage && ((rand() % 100) >= lossPercent))
+        {
+            PlayerState got;
+            const void* end = decode(decoder, update, got);
+            check(end != NULL, "lossy update decodes", i);
+            if (end != NULL)
+                checkState(state, got, "lossy update", i);
+            received++;
+
+            uint8_t sequence;
+            if (decoder.getPendingAck(sequence) && ((rand() % 100) >= ackLossPercent))
+            {
+                Update ack;
+                ack.data.assign(1, (char)sequence);
+                ack.due = i + rand() % (maxAckDelay + 1);
+                acks.push_back(ack);
+            }
+        }
+        // a base that old is gone on both ends
+        if ((i % 1000) == 999)
+            check(encoder.lastWasFull(), "full update after an outage", i);
+
+        while (!acks.empty() && (acks.front().due <= i))
+        {
+            encoder.acknowledge((uint8_t)acks.front().data[0]);
+            acks.pop_front();
+        }
+    }
+    check(received > 19000 * (100 - lossPercent) / 200, "updates got through", received);
+}
+
+// updates overtake each other, the ones that decode must be right,
+// also when the slot of their base was taken by a newer update
+static void checkReordered(int maxDelay)
+{
+    PlayerDeltaEncoder encoder;
+    PlayerDeltaDecoder decoder;
+    PlayerState state;
+    state.status = PlayerState::Alive;
+    std::vector<Update> inFlight;
+
+    int decoded = 0;
+    for (int i = 0; i < 20000; i++)
+    {
+        nextState(state);
+        Update update = makeUpdate(encoder, state);
+        update.due = i + rand() % (maxDelay + 1);
+        inFlight.push_back(update);
+
+        for (size_t u = 0; u < inFlight.size(); )
+        {
+            if (inFlight[u].due > i)
+            {
+                u++;
+                continue;
+            }
+            PlayerState got;
+            if (decode(decoder, inFlight[u], got) != NULL)
+            {
+                checkState(inFlight[u].state, got, "reordered update", i);
+                decoded++;
+            }
+            inFlight.erase(inFlight.begin() + u);
+        }
+
+        uint8_t sequence;
+        if (decoder.getPendingAck(sequence))
+            encoder.acknowledge(sequence);
+    }
+    check(decoded > 5000, "reordered updates decode", decoded);
+}
+
+static void checkBroken()
+{
+    PlayerDeltaEncoder encoder;
+    PlayerDeltaDecoder decoder;
+    PlayerState state;
+    state.status = PlayerState::Alive;
+
+    for (int i = 0; i < 2000; i++)
+    {
+        nextState(state);
+        const Update update = makeUpdate(encoder, state);
+
+        // every cut off update is refused and leaves the decoder alone
+        for (size_t length = 0; length < update.data.size(); length++)
+        {
+            PlayerDeltaDecoder copy = decoder;
+            PlayerState got;
+            check(copy.unpack(update.data.data(), update.data.data() + length,
+                              got) == NULL, "cut off update", i);
+        }
+
+        PlayerState got;
+        check(decode(decoder, update, got) != NULL, "whole update", i);
+        uint8_t sequence;
+        if (decoder.getPendingAck(sequence))
+            encoder.acknowledge(sequence);
+    }
+
+    // random bytes must not read past the end
+    for (int i = 0; i < 100000; i++)
+    {
+        const size_t length = rand() % 64;
+        std::vector<char> garbage(length);
+        for (size_t b = 0; b < length; b++)
+            garbage[b] = (char)rand();
+        PlayerState got;
+        const char* end = (const char*)decoder.unpack(garbage.data(),
+                          garbage.data() + length, got);
+        check((end == NULL) || (end <= garbage.data() + length), "random bytes", i);
+    }
+}
+
+int main()
+{
+    srand(1);
+
+    checkRoundTrip();
+    checkLoss(10, 0, 0);
+    checkLoss(30, 30, 5);
+    checkLoss(60, 50, 20);
+    checkReordered(3);
+    checkReordered(40);
+    checkBroken();
+
+    if (failures)
+        printf("%d failures\n", failures);
+    else
+        printf("all passed\n");
+    return failures ? 1 : 0;
+}
+
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
@@ -0,0 +1,172 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/* Moves, removes and clears random ids in the bzfs PositionGrid and
+ * checks every query against a scan of all the ids: each id whose cell
+ * touches the box comes back once, and no other does.  Exits with the
+ * number of failures.
+ */
+
+// system headers
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+
+// bzfs headers
+#include "PositionGrid.h"
+
+static int failures = 0;
+
+static void check(bool ok, const char* what, int index = 0)
+{
+    if (ok)
+        return;
+    if (failures < 20)
+        printf("FAIL: %s (#%d)\n", what, index);
+    failures++;
+}
+
+static float frand(float low, float high)
+{
+    return low + (high - low) * ((float)rand() / (float)RAND_MAX);
+}
+
+struct Position
+{
+    bool active;
+    float x, y;
+};
+
+// what query() should hand back, from the positions alone
+static std::vector<int> expectedIds(const PositionGrid& grid,
+                                    const std::vector<Position>& positions,
+                                    const float mins[2], const float maxs[2])
+{
+    std::vector<int> ids;
+    if (!(mins[0] <= maxs[0]) || !(mins[1] <= maxs[1]))
+        return ids;
+    const bool all = grid.isExhaustive(mins, maxs);
+    const float size = grid.getCellSize();
+    for (size_t i = 0; i < positions.size(); i++)
+    {
+        const Position& p = positions[i];
+        if (!p.active)
+            continue;
+        const float col = floorf(p.x / size);
+        const float row = floorf(p.y / size);
+        if (all || ((col >= floorf(mins[0] / size)) && (col <= floorf(maxs[0] / size)) &&
+                    (row >= floorf(mins[1] / size)) && (row <= floorf(maxs[1] / size))))
+            ids.push_back((int)i);
+    }
+    return ids;
+}
+
+static void checkGrid(float cellSize, float mapSize, int maxId)
+{
+    PositionGrid grid(cellSize);
+    std::vector<Position> positions;
+    std::vector<int> ids;
+
+    for (int i = 0; i < 100000; i++)
+    {
+        const int id = rand() % maxId;
+        if (id >= (int)positions.size())
+        {
+            Position unused = { false, 0.0f, 0.0f };
+            positions.resize(id + 1, unused);
+        }
+
+        const int op = rand() % 100;
+        if (op < 10)
+        {
+            grid.remove(id);
+            positions[id].active = false;
+        }
+        else if (op == 10)
+        {
+            grid.clear();
+            for (size_t p = 0; p < positions.size(); p++)
+                positions[p].active = false;
+        }
+        else
+        {
+            Position& p = positions[id];
+            if (p.active && (op < 60))
+            {
+                // a tank driving on, mostly within its cell
+                p.x += frand(-3.0f, 3.0f);
+                p.y += frand(-3.0f, 3.0f);
+            }
+            else
+            {
+                p.x = frand(-mapSize, mapSize);
+                p.y = frand(-mapSize, mapSize);
+            }
+            p.active = true;
+            // broken positions take the id out of the grid
+            if (op == 99)
+            {
+                p.x = ((rand() & 1) != 0) ? 1.0e9f : NAN;
+                p.active = false;
+            }
+            grid.set(id, p.x, p.y);
+        }
+
+        if ((i % 20) != 0)
+            continue;
+        const float center[2] = { frand(-mapSize, mapSize), frand(-mapSize, mapSize) };
+        const float radius = ((rand() % 4) == 0) ? frand(0.0f, 4.0f * mapSize)
+                             : frand(0.0f, 100.0f);
+        float mins[2] = { center[0] - radius, center[1] - radius };
+        float maxs[2] = { center[0] + radius, center[1] + radius };
+        if ((rand() % 50) == 0)
+            std::swap(mins[0], maxs[0]);
+        grid.query(mins, maxs, ids);
+        std::sort(ids.begin(), ids.end());
+        check(ids == expectedIds(grid, positions, mins, maxs), "query", i);
+    }
+
+    // set() with a negative id is ignored
+    grid.set(-1, 0.0f, 0.0f);
+    const float mins[2] = { -1.0f, -1.0f };
+    const float maxs[2] = { 1.0f, 1.0f };
+    grid.query(mins, maxs, ids);
+    check(std::find(ids.begin(), ids.end(), -1) == ids.end(), "negative id");
+}
+
+int main()
+{
+    srand(1);
+
+    // the server's player grid, a flag grid on a large map, and small
+    // cells where the hash buckets are shared by many cells
+    checkGrid(32.0f, 400.0f, 256);
+    checkGrid(64.0f, 5000.0f, 1000);
+    checkGrid(1.0f, 300.0f, 300);
+
+    if (failures)
+        printf("%d failures\n", failures);
+    else
+        printf("all passed\n");
+    return failures ? 1 : 0;
+}
+
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
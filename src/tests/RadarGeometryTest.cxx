@@ -0,0 +1,283 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/* Fills RadarGeometry with random rotated boxes and checks that the
+ * built cells hold every triangle and outline edge exactly once, in
+ * bands of the right height, and that queryCells() returns every cell
+ * with a primitive inside the radar square, as a scan over all the
+ * cells finds them.  Exits with the number of failures.
+ */
+
+// system headers
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+
+// common headers
+#include "RadarGeometry.h"
+
+static int failures = 0;
+
+static void check(bool ok, const char* what, int index = 0)
+{
+    if (ok)
+        return;
+    if (failures < 20)
+        printf("FAIL: %s (#%d)\n", what, index);
+    failures++;
+}
+
+static float frand(float low, float high)
+{
+    return low + (high - low) * ((float)rand() / (float)RAND_MAX);
+}
+
+// layer, z, height, death, then the x,y pairs of a triangle or an edge
+typedef std::vector<float> Primitive;
+
+static const int layerVertices[RadarGeometry::LayerCount] = { 3, 3, 2 };
+
+static Primitive makePrimitive(int layer, float z, float height, bool death,
+                               const float* a, const float* b, const float* c)
+{
+    Primitive p;
+    p.push_back((float)layer);
+    p.push_back(z);
+    p.push_back(height);
+    p.push_back(death ? 1.0f : 0.0f);
+    p.insert(p.end(), a, a + 2);
+    p.insert(p.end(), b, b + 2);
+    if (c != NULL)
+        p.insert(p.end(), c, c + 2);
+    return p;
+}
+
+static bool overlaps(const Primitive& p, const float center[2], float halfSize)
+{
+    for (int a = 0; a < 2; a++)
+    {
+        float low = p[4 + a], high = p[4 + a];
+        for (size_t v = 4 + a; v < p.size(); v += 2)
+        {
+            low = std::min(low, p[v]);
+            high = std::max(high, p[v]);
+        }
+        if ((low > center[a] + halfSize) || (high < center[a] - halfSize))
+            return false;
+    }
+    return true;
+}
+
+// adds count random boxes and returns the primitives they should become
+static std::vector<Primitive> fill(RadarGeometry& geometry, int count,
+                                   float mapSize, float maxSize)
+{
+    std::vector<Primitive> added;
+    for (int i = 0; i < count; i++)
+    {
+        const float center[2] = { frand(-mapSize, mapSize), frand(-mapSize, mapSize) };
+        const float width = frand(1.0f, maxSize);
+        const float breadth = frand(1.0f, maxSize);
+        const float rotation = frand(0.0f, 6.28f);
+        const float c = cosf(rotation), s = sinf(rotation);
+        float xy[8];
+        const float corners[4][2] = { { -1, -1 }, { 1, -1 }, { 1, 1 }, { -1, 1 } };
+        for (int v = 0; v < 4; v++)
+        {
+            const float x = corners[v][0] * width, y = corners[v][1] * breadth;
+            xy[v * 2 + 0] = center[0] + c * x - s * y;
+            xy[v * 2 + 1] = center[1] + s * x + c * y;
+        }
+        // few heights, so the cells have bands to merge
+        const float z = 10.0f * (rand() % 4);
+        const float height = 5.0f * (1 + rand() % 3);
+        const bool death = ((rand() % 7) == 0);
+        const int layer = rand() % 2;
+
+        geometry.addPolygon((RadarGeometry::Layer)layer, xy, 4, z, height, death);
+        for (int v = 1; v < 3; v++)
+        {
+            added.push_back(makePrimitive(layer, z, height, death,
+                                          &xy[0], &xy[v * 2], &xy[v * 2 + 2]));
+        }
+
+        geometry.addOutline(xy, 4, z, height);
+        for (int v = 0; v < 4; v++)
+        {
+            added.push_back(makePrimitive(RadarGeometry::Outlines, z, height,
+                                          false, &xy[v * 2],
+                                          &xy[((v + 1) % 4) * 2], NULL));
+        }
+    }
+    return added;
+}
+
+// the primitives of every cell, read back through the bands
+static void readCells(const RadarGeometry& geometry,
+                      std::vector<std::vector<Primitive> >& cells, int trial)
+{
+    cells.assign(geometry.getCellCount(), std::vector<Primitive>());
+    for (int l = 0; l < RadarGeometry::LayerCount; l++)
+    {
+        const RadarGeometry::Layer layer = (RadarGeometry::Layer)l;
+        const float* vertices = geometry.getVertices(layer);
+        const int size = layerVertices[l];
+        int covered = 0;
+        for (int c = 0; c < geometry.getCellCount(); c++)
+        {
+            int count;
+            const RadarGeometry::Band* bands = geometry.getBands(c, layer, count);
+            for (int b = 0; b < count; b++)
+            {
+                const RadarGeometry::Band& band = bands[b];
+                check((band.count > 0) && ((band.count % size) == 0), "band size", trial);
+                // sorted and merged, no two bands alike
+                if (b > 0)
+                {
+                    const RadarGeometry::Band& last = bands[b - 1];
+                    const bool ordered = (last.z < band.z) ||
+                                         ((last.z == band.z) && ((last.height < band.height) ||
+                                                 ((last.height == band.height) && !last.death && band.death)));
+                    check(ordered, "band order", trial);
+                }
+                covered += band.count;
+                for (int v = band.first; v + size <= band.first + band.count; v += size)
+                {
+                    const float* p = &vertices[v * 2];
+                    cells[c].push_back(makePrimitive(l, band.z, band.height, band.death,
+                                                     p, p + 2, (size == 3) ? p + 4 : NULL));
+                }
+            }
+        }
+        check(covered == geometry.getVertexCount(layer), "bands cover the vertices", trial);
+    }
+}
+
+static void checkGeometry(int trial, int count, float mapSize, float maxSize,
+                          float cellSize)
+{
+    RadarGeometry geometry;
+    std::vector<Primitive> added = fill(geometry, count, mapSize, maxSize);
+    geometry.finish(cellSize);
+    check(geometry.isFinished(), "finished", trial);
+    check(geometry.getVertexCount(RadarGeometry::Outlines) == count * 8,
+          "outline vertex count", trial);
+    check(geometry.getVertexCount(RadarGeometry::Buildings) +
+          geometry.getVertexCount(RadarGeometry::Meshes) == count * 6,
+          "triangle vertex count", trial);
+    check(geometry.getCellCount() <= 64 * 64, "cell count", trial);
+
+    std::vector<std::vector<Primitive> > cells;
+    readCells(geometry, cells, trial);
+
+    // every primitive exactly once
+    std::vector<Primitive> built;
+    for (size_t c = 0; c < cells.size(); c++)
+        built.insert(built.end(), cells[c].begin(), cells[c].end());
+    std::sort(added.begin(), added.end());
+    std::sort(built.begin(), built.end());
+    check(added == built, "cells hold what was added", trial);
+
+    // the query against a scan of all the cells
+    std::vector<int> result;
+    for (int q = 0; q < 100; q++)
+    {
+        const float center[2] = { frand(-1.5f * mapSize, 1.5f * mapSize),
+                                  frand(-1.5f * mapSize, 1.5f * mapSize)
+                                };
+        const float halfSize = frand(1.0f, mapSize);
+        geometry.queryCells(center, halfSize, result);
+
+        std::vector<bool> found(cells.size(), false);
+        for (size_t i = 0; i < result.size(); i++)
+        {
+            const int c = result[i];
+            const bool valid = (c >= 0) && (c < (int)cells.size());
+            check(valid && !found[c] && !cells[c].empty(), "queried cell", trial);
+            if (valid)
+                found[c] = true;
+        }
+        for (size_t c = 0; c < cells.size(); c++)
+        {
+            if (found[c])
+                continue;
+            for (size_t p = 0; p < cells[c].size(); p++)
+                check(!overlaps(cells[c][p], center, halfSize), "cell missed by the query", trial);
+        }
+    }
+
+    // nothing out there
+    const float far[2] = { 10.0f * mapSize, 10.0f * mapSize };
+    geometry.queryCells(far, 1.0f, result);
+    check(result.empty(), "query off the map", trial);
+
+    geometry.clear();
+    check(!geometry.isFinished() && (geometry.getCellCount() == 0) &&
+          (geometry.getVertices(RadarGeometry::Buildings) == NULL), "cleared", trial);
+}
+
+static void checkEdgeCases()
+{
+    RadarGeometry geometry;
+    const float center[2] = { 0.0f, 0.0f };
+    std::vector<int> result(1, 0);
+    geometry.queryCells(center, 100.0f, result);
+    check(result.empty(), "query before finish");
+
+    // too few corners, and polygons on the outline layer, are ignored
+    const float xy[6] = { 0.0f, 0.0f, 10.0f, 0.0f, 0.0f, 10.0f };
+    geometry.addPolygon(RadarGeometry::Buildings, xy, 2, 0.0f, 1.0f);
+    geometry.addPolygon(RadarGeometry::Outlines, xy, 3, 0.0f, 1.0f);
+    geometry.addOutline(xy, 1, 0.0f, 1.0f);
+    geometry.finish(64.0f);
+    check(geometry.getVertexCount(RadarGeometry::Buildings) == 0, "short polygon");
+    check(geometry.getVertexCount(RadarGeometry::Outlines) == 0, "polygon as outline");
+    geometry.queryCells(center, 100.0f, result);
+    check(result.empty(), "query without geometry");
+
+    // nothing is added after finish()
+    geometry.addPolygon(RadarGeometry::Buildings, xy, 3, 0.0f, 1.0f);
+    check(geometry.getVertexCount(RadarGeometry::Buildings) == 0, "added after finish");
+}
+
+int main()
+{
+    srand(1);
+
+    checkEdgeCases();
+    for (int trial = 0; trial < 30; trial++)
+    {
+        const int count = 1 + rand() % 1500;
+        const float mapSize = (trial % 3 == 0) ? 4000.0f : 400.0f;
+        // long walls hang over into many cells
+        const float maxSize = (trial % 5 == 0) ? 300.0f : 30.0f;
+        const float cellSize = (trial % 4 == 0) ? 8.0f : 64.0f;
+        checkGeometry(trial, count, mapSize, maxSize, cellSize);
+    }
+
+    if (failures)
+        printf("%d failures\n", failures);
+    else
+        printf("all passed\n");
+    return failures ? 1 : 0;
+}
+
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
@@ -0,0 +1,279 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/* Runs random passes through RenderCommandList::sort() and submit()
+ * with a visitor that tracks the state it was given and counts the
+ * changes.  Every draw must see the state it asked for, the counts must
+ * match the list's stats and the changes between neighbouring commands,
+ * and sorting must group the commands by shader, texture, culling and
+ * material.  No GL context is needed, the textures and meshes are
+ * never created.  Exits with the number of failures.
+ */
+
+// system headers
+#include <stdio.h>
+#include <stdlib.h>
+#include <set>
+#include <vector>
+
+#include <Magnum/GL/Mesh.h>
+#include <Magnum/GL/Texture.h>
+
+// gfx headers
+#include "RenderCommandList.h"
+
+using namespace Magnum;
+
+static int failures = 0;
+
+static void check(bool ok, const char *what, int index = 0)
+{
+    if (ok)
+        return;
+    if (failures < 20)
+        printf("FAIL: %s (#%d)\n", what, index);
+    failures++;
+}
+
+// what a draw mode would have bound, and how often it changed
+class CountingVisitor : public RenderCommandVisitor
+{
+public:
+    CountingVisitor() : shader(-1), culling(-1), texture(NULL), material(NULL) {}
+
+    void setShader(int s) override
+    {
+        check(s != shader, "shader set again");
+        shader = s;
+        counts.shaderChanges++;
+    }
+
+    void setCulling(bool enable) override
+    {
+        check((enable ? 1 : 0) != culling, "culling set again");
+        culling = enable ? 1 : 0;
+        counts.cullChanges++;
+    }
+
+    void bindTexture(GL::Texture2D *t) override
+    {
+        check((t != NULL) && (t != texture), "texture bound again");
+        texture = t;
+        counts.textureChanges++;
+    }
+
+    void setMaterial(int s, const RenderMaterial &m) override
+    {
+        check(s == shader, "material for another shader");
+        material = &m;
+        counts.materialChanges++;
+    }
+
+    void drawCommand(const RenderCommand &c) override
+    {
+        check(c.shader == shader, "draw with the wrong shader");
+        check(c.material == material, "draw with the wrong material");
+        check(culling == (c.material->noCulling ? 0 : 1), "draw with the wrong culling");
+        check((c.texture == NULL) || (c.texture == texture), "draw with the wrong texture");
+        order.push_back(c.order);
+        counts.commands++;
+    }
+
+    int shader;
+    int culling;
+    GL::Texture2D *texture;
+    const RenderMaterial *material;
+    RenderStats counts;
+    std::vector<unsigned int> order;
+};
+
+// the changes a list needs in the order it is in, one command at a time
+static RenderStats expectedChanges(const std::vector<RenderCommand> &commands)
+{
+    RenderStats expected;
+    for (size_t i = 0; i < commands.size(); i++)
+    {
+        const RenderCommand &c = commands[i];
+        const RenderCommand *last = NULL;
+        if (i > 0)
+            last = &commands[i - 1];
+        const bool newShader = !last || (last->shader != c.shader);
+        expected.shaderChanges += newShader ? 1 : 0;
+        expected.cullChanges += (!last || (last->material->noCulling != c.material->noCulling)) ? 1 : 0;
+        expected.materialChanges += (newShader || (last->material != c.material)) ? 1 : 0;
+        expected.commands++;
+
+        // untextured draws keep whatever texture was bound before them
+        GL::Texture2D *bound = NULL;
+        for (size_t j = i; j-- > 0; )
+        {
+            if (commands[j].texture)
+            {
+                bound = commands[j].texture;
+                break;
+            }
+        }
+        expected.textureChanges += (c.texture && (c.texture != bound)) ? 1 : 0;
+    }
+    return expected;
+}
+
+static bool sameStats(const RenderStats &a, const RenderStats &b)
+{
+    return (a.commands == b.commands) && (a.shaderChanges == b.shaderChanges) &&
+           (a.textureChanges == b.textureChanges) && (a.cullChanges == b.cullChanges) &&
+           (a.materialChanges == b.materialChanges);
+}
+
+int main()
+{
+    srand(1);
+
+    const int textureCount = 8;
+    const int materialCount = 40;
+    std::vector<GL::Texture2D> textures;
+    for (int t = 0; t < textureCount; t++)
+        textures.emplace_back(NoCreate);
+    GL::Mesh mesh{NoCreate};
+
+    std::vector<RenderMaterial> materials(materialCount);
+    for (int m = 0; m < materialCount; m++)
+    {
+        RenderMaterial &r = materials[m];
+        const int t = rand() % (textureCount + 1);
+        r.material = NULL;
+        r.texture = (t < textureCount) ? &textures[t] : NULL;
+        r.textureKey = (t < textureCount) ? t + 1 : 0;
+        r.materialKey = m + 1;
+        r.noCulling = ((rand() % 3) == 0);
+        r.noLighting = false;
+        r.dynamicColor = -1;
+        r.textureMatrix = -1;
+        r.alpha = 1.0f;
+        r.shininess = 0.0f;
+        r.alphaThreshold = 0.0f;
+    }
+
+    RenderCommandList list;
+    RenderStats total;
+    for (int pass = 0; pass < 60; pass++)
+    {
+        // the list is reused from pass to pass, as the draw modes do
+        list.clear();
+        check(list.size() == 0, "cleared", pass);
+
+        const int count = rand() % 3000;
+        std::set<int> shaders;
+        std::set<uint64_t> keys;
+        for (int i = 0; i < count; i++)
+        {
+            const RenderMaterial *r = &materials[rand() % materialCount];
+            // textured materials are drawn textured or, in some modes, without
+            const bool textured = (r->texture != NULL) && ((pass % 4) != 1);
+            const int shader = textured ? (rand() % 2) : 2 + (rand() % 2);
+            list.add(shader, textured ? r->texture : NULL, r, mesh, Matrix4{});
+            shaders.insert(shader);
+            keys.insert(list.getCommands().back().key);
+        }
+
+        // blended passes keep their order
+        const bool sorted = ((pass % 3) != 0);
+        if (sorted)
+            list.sort();
+
+        CountingVisitor visitor;
+        list.submit(visitor);
+        const RenderStats &stats = list.getStats();
+        total.add(stats);
+
+        check((int)stats.commands == count, "commands drawn", pass);
+        check(sameStats(stats, visitor.counts), "stats match the visitor", pass);
+        check(sameStats(stats, expectedChanges(list.getCommands())), "stats match the list", pass);
+
+        const std::vector<RenderCommand> &commands = list.getCommands();
+        if (!sorted)
+        {
+            for (int i = 0; i < count; i++)
+                check(visitor.order[i] == (unsigned int)i, "submission order kept", pass);
+            continue;
+        }
+
+        // sorted by key, equal keys in the order they were added
+        for (int i = 1; i < count; i++)
+        {
+            const RenderCommand &a = commands[i - 1];
+            const RenderCommand &b = commands[i];
+            check((a.key < b.key) || ((a.key == b.key) && (a.order < b.order)), "sort order", pass);
+        }
+        // each shader once, and no state group split up
+        check(stats.shaderChanges == shaders.size(), "shader changes when sorted", pass);
+        check(stats.materialChanges <= keys.size(), "material changes when sorted", pass);
+        check(stats.textureChanges <= (unsigned int)(textureCount * shaders.size()),
+              "texture changes when sorted", pass);
+    }
+    check(total.commands > 0, "anything drawn");
+
+    // a hand made pass with known counts: two shaders, two textures,
+    // one material without culling
+    {
+        RenderMaterial &a = materials[0];
+        RenderMaterial &b = materials[1];
+        RenderMaterial &c = materials[2];
+        a.texture = &textures[0];
+        a.textureKey = 1;
+        a.noCulling = false;
+        b.texture = &textures[1];
+        b.textureKey = 2;
+        b.noCulling = false;
+        c.texture = NULL;
+        c.textureKey = 0;
+        c.noCulling = true;
+
+        list.clear();
+        list.add(0, b.texture, &b, mesh, Matrix4{});
+        list.add(1, NULL, &c, mesh, Matrix4{});
+        list.add(0, a.texture, &a, mesh, Matrix4{});
+        list.add(1, NULL, &c, mesh, Matrix4{});
+        list.add(0, b.texture, &b, mesh, Matrix4{});
+        list.add(0, a.texture, &a, mesh, Matrix4{});
+
+        CountingVisitor unsortedVisitor;
+        list.submit(unsortedVisitor);
+        const RenderStats unsorted = list.getStats();
+        check((unsorted.shaderChanges == 5) && (unsorted.textureChanges == 4) &&
+              (unsorted.cullChanges == 5) && (unsorted.materialChanges == 6),
+              "hand made pass unsorted");
+
+        list.sort();
+        CountingVisitor sortedVisitor;
+        list.submit(sortedVisitor);
+        const RenderStats &stats = list.getStats();
+        check((stats.commands == 6) && (stats.shaderChanges == 2) &&
+              (stats.textureChanges == 2) && (stats.cullChanges == 2) &&
+              (stats.materialChanges == 3), "hand made pass sorted");
+    }
+
+    if (failures)
+        printf("%d failures\n", failures);
+    else
+        printf("all passed\n");
+    return failures ? 1 : 0;
+}
+
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
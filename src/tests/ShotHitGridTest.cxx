@@ -0,0 +1,174 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/* Fills a ShotHitGrid with random shot bounds, short and long ones,
+ * unbounded, empty and broken ones, and checks every query against a
+ * test of each shot's bounds, ids and order included.  Exits with the
+ * number of failures.
+ */
+
+// system headers
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+
+// common headers
+#include "ShotHitGrid.h"
+
+static int failures = 0;
+
+static void check(bool ok, const char* what, int index = 0)
+{
+    if (ok)
+        return;
+    if (failures < 20)
+        printf("FAIL: %s (#%d)\n", what, index);
+    failures++;
+}
+
+static float frand(float low, float high)
+{
+    return low + (high - low) * ((float)rand() / (float)RAND_MAX);
+}
+
+struct Shot
+{
+    int id;
+    bool bounded;
+    float bbox[2][3];
+};
+
+// a box around a random point, mostly the size of a shot segment
+static void randomBox(float bbox[2][3], float mapSize)
+{
+    const int kind = rand() % 20;
+    float size[2];
+    if (kind < 14)
+    {
+        size[0] = frand(0.0f, 30.0f);
+        size[1] = frand(0.0f, 30.0f);
+    }
+    else if (kind < 18)
+    {
+        // a laser or a long segment across the map
+        size[0] = frand(0.0f, 2.0f * mapSize);
+        size[1] = frand(0.0f, 20.0f);
+        if (rand() & 1)
+            std::swap(size[0], size[1]);
+    }
+    else
+        size[0] = size[1] = 0.0f;
+    for (int a = 0; a < 3; a++)
+    {
+        bbox[0][a] = frand(-mapSize, mapSize);
+        bbox[1][a] = bbox[0][a] + ((a < 2) ? size[a] : frand(0.0f, 10.0f));
+    }
+}
+
+static bool overlaps(const Shot& shot, const float (*bbox)[3])
+{
+    if (!shot.bounded)
+        return true;
+    return (shot.bbox[0][0] <= bbox[1][0]) && (shot.bbox[1][0] >= bbox[0][0]) &&
+           (shot.bbox[0][1] <= bbox[1][1]) && (shot.bbox[1][1] >= bbox[0][1]);
+}
+
+static void checkFrame(ShotHitGrid& grid, int frame, float mapSize)
+{
+    grid.clear();
+    check(grid.size() == 0, "cleared", frame);
+
+    std::vector<Shot> shots;
+    const int count = rand() % 300;
+    for (int i = 0; i < count; i++)
+    {
+        Shot shot;
+        shot.id = rand() % 1000;
+        shot.bounded = ((rand() % 30) != 0);
+        randomBox(shot.bbox, mapSize);
+        const int odd = rand() % 100;
+        if (odd == 0)
+        {
+            // inverted, it can not hit anything and is dropped
+            std::swap(shot.bbox[0][0], shot.bbox[1][0]);
+            shot.bbox[0][0] += 1.0f;
+        }
+        else if (odd == 1)
+            shot.bbox[1][1] = shot.bbox[0][1] = 1.0e9f;
+        else if (odd == 2)
+            shot.bbox[0][0] = NAN;
+
+        grid.add(shot.id, shot.bounded ? shot.bbox : NULL);
+        if (!shot.bounded || ((shot.bbox[0][0] <= shot.bbox[1][0]) &&
+                              (shot.bbox[0][1] <= shot.bbox[1][1])) ||
+                isnan(shot.bbox[0][0]))
+            shots.push_back(shot);
+    }
+    check(grid.size() == (int)shots.size(), "shots added", frame);
+
+    std::vector<int> ids;
+    for (int q = 0; q < 200; q++)
+    {
+        float bbox[2][3];
+        randomBox(bbox, 1.2f * mapSize);
+        if ((q % 50) == 0)
+        {
+            bbox[0][0] = bbox[0][1] = -1.0e7f;
+            bbox[1][0] = bbox[1][1] = 1.0e7f;
+        }
+        grid.query(bbox, ids);
+
+        std::vector<int> expected;
+        for (size_t s = 0; s < shots.size(); s++)
+        {
+            if (overlaps(shots[s], bbox))
+                expected.push_back(shots[s].id);
+        }
+        check(ids == expected, "query", frame * 1000 + q);
+    }
+}
+
+int main()
+{
+    srand(1);
+
+    // one grid reused over the frames, as the client does
+    ShotHitGrid grid;
+    for (int frame = 0; frame < 300; frame++)
+        checkFrame(grid, frame, (frame % 3 == 0) ? 2000.0f : 200.0f);
+
+    // cells smaller than the shots, and larger than the map
+    ShotHitGrid fine(2.0f);
+    ShotHitGrid coarse(5000.0f);
+    for (int frame = 0; frame < 50; frame++)
+    {
+        checkFrame(fine, frame, 400.0f);
+        checkFrame(coarse, frame, 400.0f);
+    }
+
+    if (failures)
+        printf("%d failures\n", failures);
+    else
+        printf("all passed\n");
+    return failures ? 1 : 0;
+}
+
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
@@ -0,0 +1,194 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/* Runs the bzflag-next SimulationClock with frames of random length and
+ * checks that the tick never runs ahead of the frame nor falls a step
+ * behind it, that the alpha matches, and that a long hitch is dropped.
+ * Then checks the TankSnapshots interpolation.  Exits with the number
+ * of failures.
+ */
+
+// system headers
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// bzflag-next headers
+#include "SimulationClock.h"
+
+static int failures = 0;
+
+static void check(bool ok, const char* what, int index = 0)
+{
+    if (ok)
+        return;
+    if (failures < 20)
+        printf("FAIL: %s (#%d)\n", what, index);
+    failures++;
+}
+
+static bool near(double a, double b, double epsilon = 1.0e-4)
+{
+    return fabs(a - b) <= epsilon;
+}
+
+static void checkRate()
+{
+    SimulationClock clock;
+    check(near(clock.getStep(), 1.0 / 60.0), "default step");
+    clock.setRate(5.0f);
+    check(near(clock.getStep(), 0.1), "lowest rate");
+    clock.setRate(5000.0f);
+    check(near(clock.getStep(), 0.001), "highest rate");
+    clock.setRate(120.0f);
+    check(near(clock.getStep(), 1.0 / 120.0), "rate");
+}
+
+static void checkFrames(float rate)
+{
+    SimulationClock clock;
+    clock.setRate(rate);
+    const double step = clock.getStep();
+
+    TimeKeeper now = TimeKeeper::getNullTime();
+    now += 1000.0;
+    check(clock.advance(now) == 0, "first advance has no steps");
+
+    unsigned int steps = 0;
+    for (int frame = 0; frame < 20000; frame++)
+    {
+        // mostly frames shorter than the step, now and then long ones
+        double length = step * ((double)rand() / RAND_MAX) * 2.0;
+        if ((rand() % 100) == 0)
+            length = step * (rand() % 30);
+        now += length;
+
+        const int count = clock.advance(now);
+        check((count >= 0) && (count <= 8), "steps per frame", frame);
+        for (int i = 0; i < count; i++)
+            clock.beginStep();
+        steps += count;
+
+        if (steps == 0)
+            continue;
+        const double behind = now - TimeKeeper::getTick();
+        check((behind > -1.0e-9) && (behind < step + 1.0e-9),
+              "tick within a step of the frame", frame);
+        check(near(clock.getAlpha(), behind / step), "alpha", frame);
+    }
+    check(clock.getStepCount() == steps, "step count");
+
+    // a second long hitch runs the last steps and drops the rest
+    const unsigned int dropped = clock.getDroppedSteps();
+    const double behind = now - TimeKeeper::getTick();
+    now += 1.0;
+    const int count = clock.advance(now);
+    check(count == 8, "steps after a hitch");
+    const int expectedDrop = (int)floor((1.0 + behind) / step) - 8;
+    check((int)(clock.getDroppedSteps() - dropped) == expectedDrop,
+          "dropped steps after a hitch");
+    for (int i = 0; i < count; i++)
+        clock.beginStep();
+    check(near(now - TimeKeeper::getTick(), 0.0, 1.0e-9), "caught up after a hitch");
+    check(near(clock.getAlpha(), 0.0), "alpha after a hitch");
+
+    // going back in time runs nothing
+    TimeKeeper earlier = now;
+    earlier += -0.5;
+    check(clock.advance(earlier) == 0, "no steps back in time");
+    check(clock.getAlpha() == 0.0f, "alpha back in time");
+
+    // after a reset the clock starts over from the next frame
+    clock.reset();
+    check(clock.getStepCount() == 0, "step count after reset");
+    check(clock.getDroppedSteps() == 0, "dropped steps after reset");
+    now += 3600.0;
+    check(clock.advance(now) == 0, "no steps after reset");
+    now += step * 2.5;
+    check(clock.advance(now) == 2, "steps after reset");
+    check(clock.getDroppedSteps() == 0, "nothing dropped after reset");
+}
+
+static void checkSnapshots()
+{
+    TankSnapshots tanks;
+    float pos[3], angle;
+    check(!tanks.getTank(0, 0.5f, pos, angle), "no tanks yet");
+
+    tanks.beginStep(4);
+    const float start[3] = { 0.0f, 0.0f, 0.0f };
+    tanks.setTank(1, start, 3.0f);
+    tanks.setTank(3, start, 0.0f);
+    tanks.setTank(4, start, 0.0f);
+    tanks.setTank(-1, start, 0.0f);
+    check(!tanks.getTank(4, 0.5f, pos, angle), "tank past the end");
+    check(!tanks.getTank(-1, 0.5f, pos, angle), "negative tank");
+
+    // a tank that just appeared is not interpolated
+    check(tanks.getTank(1, 0.5f, pos, angle) && (pos[0] == 0.0f) &&
+          (angle == 3.0f), "new tank");
+
+    tanks.beginStep(4);
+    const float moved[3] = { 1.0f, 2.0f, -4.0f };
+    const float jumped[3] = { 20.0f, 0.0f, 0.0f };
+    tanks.setTank(1, moved, -3.0f);
+    tanks.setTank(2, moved, 1.0f);
+    tanks.setTank(3, jumped, 1.0f);
+
+    check(tanks.getTank(1, 0.25f, pos, angle) && near(pos[0], 0.25) &&
+          near(pos[1], 0.5) && near(pos[2], -1.0), "interpolated position");
+    // from 3 to -3 the short way is through pi
+    const double turn = 2.0 * M_PI - 6.0;
+    check(near(angle, 3.0 + turn * 0.25), "interpolated angle");
+    tanks.getTank(1, 1.0f, pos, angle);
+    check(near(pos[0], 1.0) && near(angle, 3.0 + turn), "alpha of one");
+
+    check(tanks.getTank(2, 0.5f, pos, angle) && (pos[0] == 1.0f) &&
+          (angle == 1.0f), "tank that just spawned");
+    check(tanks.getTank(3, 0.5f, pos, angle) && (pos[0] == 20.0f),
+          "teleported tank");
+
+    // a tank gone in the last step is not drawn
+    tanks.beginStep(4);
+    tanks.setTank(2, moved, 1.0f);
+    check(!tanks.getTank(1, 0.5f, pos, angle), "tank that left");
+    check(tanks.getTank(2, 0.5f, pos, angle) && (pos[0] == 1.0f), "tank that stayed");
+
+    tanks.clear();
+    check(!tanks.getTank(2, 0.5f, pos, angle), "tanks after clear");
+}
+
+int main()
+{
+    srand(1);
+
+    checkRate();
+    checkFrames(60.0f);
+    checkFrames(144.0f);
+    checkFrames(1000.0f);
+    checkSnapshots();
+
+    if (failures)
+        printf("%d failures\n", failures);
+    else
+        printf("all passed\n");
+    return failures ? 1 : 0;
+}
+
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
@@ -0,0 +1,138 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/* Reads numbers with StreamParse::readFloat() and with the input >> float
+ * the world parser used before, and checks that both fail on the same
+ * input and otherwise give the same float.  Covers the edge cases of the
+ * float range and random numbers in the usual world file formats.  Exits
+ * with the number of failures.
+ */
+
+// system headers
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <locale>
+#include <sstream>
+#include <string>
+
+// common headers
+#include "StreamParse.h"
+
+static int failures = 0;
+
+static void checkNumber(const std::string& text)
+{
+    std::istringstream expectedStream(text);
+    expectedStream.imbue(std::locale::classic());
+    float expected = 0.0f;
+    expectedStream >> expected;
+    const bool expectedOk = !expectedStream.fail();
+
+    MemoryStream actualStream(text);
+    float actual = 0.0f;
+    const bool actualOk = StreamParse::readFloat(actualStream, actual);
+
+    bool ok = (expectedOk == actualOk) && (actualOk == !actualStream.fail());
+    if (ok && expectedOk)
+        ok = (memcmp(&expected, &actual, sizeof(float)) == 0);
+    if (ok)
+        return;
+
+    if (failures < 20)
+    {
+        printf("FAIL: \"%s\": >> %s %.9g, readFloat %s %.9g\n", text.c_str(),
+               expectedOk ? "read" : "failed", expected,
+               actualOk ? "read" : "failed", actual);
+    }
+    failures++;
+}
+
+static void checkLine()
+{
+    // a whole line, the way a vertex is read
+    MemoryStream input(std::string("  1.5 -2e3 +.25 4 3.4e39 5\n"));
+    float values[4];
+    const bool read = StreamParse::readFloats(input, values, 4);
+    const bool ok = read && (values[0] == 1.5f) && (values[1] == -2000.0f) &&
+                    (values[2] == 0.25f) && (values[3] == 4.0f);
+    float tooLarge;
+    if (!ok || StreamParse::readFloat(input, tooLarge) || !input.fail())
+    {
+        printf("FAIL: reading a line of numbers\n");
+        failures++;
+    }
+}
+
+static const char* edgeCases[] =
+{
+    "0", "-0", "+0", "0.0", ".5", "5.", "-.5", "1e0", "1E+2", "1e-2",
+    "007", "1.000000000000000000000001", "123456789012345678901234567890",
+    "0.000000000000000000000000000000000000000000000000001",
+    "3.4028234e38", "3.4028235e38", "3.40282356e38", "3.4028236e38",
+    "-3.4028236e38", "3.4e39", "-3.4e39", "1e400", "1e99999", "-1e400",
+    "1.17549435e-38", "1e-40", "1.4e-45", "7e-46", "1e-50", "-1e-50",
+    "1e-400", "0e999", "16777217", "16777219", "0.1", "0.2", "0.3",
+    "", "-", "+", ".", "e5", "abc", "1e", "1e+", "--1", "+-1", "nan", "inf"
+};
+
+int main()
+{
+    for (size_t i = 0; i < sizeof(edgeCases) / sizeof(edgeCases[0]); i++)
+        checkNumber(edgeCases[i]);
+
+    // the formats world files are written in, over the whole range
+    srand(1);
+    char buffer[64];
+    for (int i = 0; i < 200000; i++)
+    {
+        const double mantissa = (double)rand() / RAND_MAX * 10.0;
+        const int exponent = (rand() % 90) - 45;
+        const double value = (rand() & 1 ? -1.0 : 1.0) * mantissa *
+                             pow(10.0, exponent);
+        switch (i % 4)
+        {
+        case 0:
+            snprintf(buffer, sizeof(buffer), "%.*g", 1 + (rand() % 10), value);
+            break;
+        case 1:
+            snprintf(buffer, sizeof(buffer), "%.*e", rand() % 12, value);
+            break;
+        case 2:
+            snprintf(buffer, sizeof(buffer), "%.*f", rand() % 8,
+                     fmod(value, 100000.0));
+            break;
+        default:
+            snprintf(buffer, sizeof(buffer), "%d", rand() - RAND_MAX / 2);
+            break;
+        }
+        checkNumber(buffer);
+    }
+
+    checkLine();
+
+    if (failures)
+        printf("%d failures\n", failures);
+    else
+        printf("all passed\n");
+    return failures ? 1 : 0;
+}
+
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
@@ -0,0 +1,163 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/* Decodes a set of PNG files the way the MagnumTextureManager decode
+ * threads do, with 1 to N threads, and prints the textures per second
+ * for each thread count.  No window or GL context is needed.  The files
+ * are read into memory first so only the decode is timed, and the
+ * texture cache stays disabled.
+ *
+ * usage: texture_decode_bench [-t threads] [-r rounds] file.png...
+ */
+
+// system headers
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <Corrade/PluginManager/Manager.h>
+#include <Magnum/Trade/AbstractImporter.h>
+
+// common headers
+#include "MagnumTextureManager.h"
+#include "TextureCache.h"
+#include "TimeKeeper.h"
+
+using namespace Magnum;
+
+struct SourceFile
+{
+    std::string name;
+    std::vector<char> data;
+};
+
+static std::vector<SourceFile> sources;
+
+// every thread takes the next file until all rounds are done
+static void decodeThread(Trade::AbstractImporter *decoder, std::atomic<size_t> *next,
+                         size_t jobs, std::atomic<int> *failures)
+{
+    size_t job;
+    while ((job = next->fetch_add(1)) < jobs)
+    {
+        const SourceFile &source = sources[job % sources.size()];
+        DecodedTexture decoded;
+        decoded.job.name = source.name;
+        decoded.job.filename = source.name;
+        decoded.job.packedData = {source.data.data(), source.data.size()};
+        if (!MagnumTextureManager::decodeTexture(decoder, decoded) || !decoded.isValid())
+            ++*failures;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    unsigned int maxThreads = std::thread::hardware_concurrency();
+    int rounds = 5;
+
+    int arg = 1;
+    for (; arg + 1 < argc; arg += 2)
+    {
+        if (strcmp(argv[arg], "-t") == 0)
+            maxThreads = (unsigned int)atoi(argv[arg + 1]);
+        else if (strcmp(argv[arg], "-r") == 0)
+            rounds = atoi(argv[arg + 1]);
+        else
+            break;
+    }
+    if (maxThreads < 1)
+        maxThreads = 1;
+    if (rounds < 1)
+        rounds = 1;
+
+    size_t totalBytes = 0;
+    for (; arg < argc; arg++)
+    {
+        SourceFile source;
+        source.name = argv[arg];
+        if (!TextureCache::readFile(source.name, source.data))
+        {
+            printf("could not read %s\n", argv[arg]);
+            return 1;
+        }
+        totalBytes += source.data.size();
+        sources.push_back(std::move(source));
+    }
+    if (sources.empty())
+    {
+        printf("usage: %s [-t threads] [-r rounds] file.png...\n", argv[0]);
+        return 1;
+    }
+
+    // one importer per thread, like the texture manager
+    PluginManager::Manager<Trade::AbstractImporter> manager;
+    std::vector<Containers::Pointer<Trade::AbstractImporter>> decoders;
+    for (unsigned int i = 0; i < maxThreads; i++)
+    {
+        decoders.push_back(manager.loadAndInstantiate("PngImporter"));
+        if (!decoders.back())
+        {
+            printf("could not load PngImporter\n");
+            return 1;
+        }
+    }
+
+    const size_t jobs = sources.size() * rounds;
+    printf("%d files, %.1f MB, %d rounds\n", (int)sources.size(),
+           totalBytes / (1024.0 * 1024.0), rounds);
+    printf("%8s %10s %12s %8s\n", "threads", "seconds", "textures/s", "speedup");
+
+    // powers of two, always ending with the requested count
+    std::vector<unsigned int> threadCounts;
+    for (unsigned int threads = 1; threads < maxThreads; threads *= 2)
+        threadCounts.push_back(threads);
+    threadCounts.push_back(maxThreads);
+
+    double oneThread = 0.0;
+    for (unsigned int threads: threadCounts)
+    {
+        std::atomic<size_t> next(0);
+        std::atomic<int> failures(0);
+        std::vector<std::thread> workers;
+
+        const TimeKeeper start = TimeKeeper::getCurrent();
+        for (unsigned int i = 0; i < threads; i++)
+            workers.emplace_back(decodeThread, decoders[i].get(), &next, jobs, &failures);
+        for (auto &t: workers)
+            t.join();
+        const double seconds = TimeKeeper::getCurrent() - start;
+
+        if (threads == 1)
+            oneThread = seconds;
+        printf("%8u %10.3f %12.1f %7.2fx\n", threads, seconds, jobs / seconds,
+               (seconds > 0.0) ? oneThread / seconds : 0.0);
+        if (failures > 0)
+        {
+            printf("%d decodes failed\n", (int)failures);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
@@ -0,0 +1,228 @@
+/* bzflag
+ * Copyright (c) 1993-2021 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/* Adds, moves, drops and expires random track marks in a TrackRing
+ * and checks it against a plain list of the marks: the ring order, the
+ * moving count, and the cell chains and bounds of every cell.  Exits
+ * with the number of failures.
+ */
+
+// system headers
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <deque>
+#include <vector>
+
+// common headers
+#include "TrackRing.h"
+
+static int failures = 0;
+
+static void check(bool ok, const char* what, int index = 0)
+{
+    if (ok)
+        return;
+    if (failures < 20)
+        printf("FAIL: %s (#%d)\n", what, index);
+    failures++;
+}
+
+static float frand(float low, float high)
+{
+    return low + (high - low) * ((float)rand() / (float)RAND_MAX);
+}
+
+struct Mark
+{
+    float id;       // stored in pos[0], unique
+    int cell;       // -1 once dropped
+    bool moving;
+    double birthTime;
+};
+
+// the ring against the marks it should hold, oldest first
+static void checkRing(TrackRing& ring, const std::deque<Mark>& marks, int index)
+{
+    check(ring.getCount() == (int)marks.size(), "count", index);
+    if (ring.getCount() != (int)marks.size())
+        return;
+
+    int moving = 0;
+    std::vector<std::vector<int> > members(ring.getCellCount());
+    for (size_t i = 0; i < marks.size(); i++)
+    {
+        const Mark& m = marks[i];
+        const TrackEntry& te = ring.get((int)i);
+        check(te.pos[0] == m.id, "ring order", index);
+        check(te.cell == m.cell, "mark cell", index);
+        if ((i > 0) && (te.birthTime < ring.get((int)i - 1).birthTime))
+            check(false, "birth time order", index);
+        if (m.cell < 0)
+            continue;
+        moving += m.moving ? 1 : 0;
+        members[m.cell].push_back(ring.getSlotOf((int)i));
+    }
+    check(ring.getMovingCount() == moving, "moving count", index);
+
+    for (int c = 0; c < ring.getCellCount(); c++)
+    {
+        std::vector<int> chained;
+        int prev = -1;
+        for (int slot = ring.getCellHead(c); slot >= 0; slot = ring.getSlot(slot).cellNext)
+        {
+            const TrackEntry& te = ring.getSlot(slot);
+            check(te.cell == c, "chained in another cell", index);
+            check(te.cellPrev == prev, "chain back link", index);
+            chained.push_back(slot);
+            prev = slot;
+            if (chained.size() > (size_t)ring.getCapacity())
+                break;
+        }
+        std::sort(chained.begin(), chained.end());
+        std::sort(members[c].begin(), members[c].end());
+        check(chained == members[c], "cell members", index);
+
+        float mins[3], maxs[3];
+        const bool bounded = ring.getCellBounds(c, mins, maxs);
+        check(bounded == !members[c].empty(), "cell bounds when empty", index);
+        if (!bounded)
+            continue;
+        for (size_t i = 0; i < chained.size(); i++)
+        {
+            const TrackEntry& te = ring.getSlot(chained[i]);
+            for (int a = 0; a < 3; a++)
+                check((te.pos[a] >= mins[a]) && (te.pos[a] <= maxs[a]), "cell bounds", index);
+        }
+    }
+}
+
+static void checkRandom(int capacity, int cellCount)
+{
+    TrackRing ring(capacity);
+    ring.setCellCount(cellCount);
+    check(ring.getCapacity() == capacity, "capacity");
+    check(ring.getCount() == 0, "empty");
+
+    std::deque<Mark> marks;
+    const float fadeTime = 20.0f;
+    double now = 0.0;
+    float nextId = 1.0f;
+
+    for (int i = 0; i < 20000; i++)
+    {
+        now += frand(0.0f, 0.05f);
+        const int op = rand() % 100;
+        if (op < 60)
+        {
+            TrackEntry te;
+            te.pos[0] = nextId;
+            te.pos[1] = frand(-400.0f, 400.0f);
+            te.pos[2] = frand(0.0f, 10.0f);
+            te.angle = frand(0.0f, 6.28f);
+            te.scale = 1.0f;
+            te.sides = 3;
+            te.phydrv = ((rand() % 4) == 0) ? rand() % 5 : -1;
+            te.birthTime = now;
+            const int cell = rand() % cellCount;
+
+            if ((int)marks.size() == capacity)
+                marks.pop_front();
+            Mark m = { nextId, cell, te.phydrv >= 0, now };
+            marks.push_back(m);
+            nextId += 1.0f;
+
+            const int slot = ring.add(te, cell);
+            check(slot == ring.getSlotOf(ring.getCount() - 1), "added slot", i);
+        }
+        else if ((op < 80) && !marks.empty())
+        {
+            // a mark on a moving physics driver changes cells
+            const int index = rand() % (int)marks.size();
+            TrackEntry& te = ring.get(index);
+            te.pos[1] = frand(-400.0f, 400.0f);
+            te.pos[2] = frand(0.0f, 10.0f);
+            const int cell = rand() % cellCount;
+            ring.move(te, cell);
+            if (marks[index].cell >= 0)
+                marks[index].cell = cell;
+        }
+        else if ((op < 90) && !marks.empty())
+        {
+            const int index = rand() % (int)marks.size();
+            ring.drop(ring.get(index));
+            marks[index].cell = -1;
+        }
+        else if (op < 99)
+        {
+            ring.expire(now, fadeTime);
+            while (!marks.empty() && ((now - marks.front().birthTime) > fadeTime))
+                marks.pop_front();
+            check(marks.empty() || ((now - ring.get(0).birthTime) <= fadeTime),
+                  "expired the faded marks", i);
+        }
+        else
+        {
+            if (rand() & 1)
+                ring.clear();
+            else
+                ring.setCellCount(cellCount);
+            marks.clear();
+        }
+
+        if ((i % 10) == 0)
+            checkRing(ring, marks, i);
+    }
+    checkRing(ring, marks, -1);
+
+    // everything fades eventually
+    ring.expire(now + fadeTime + 1.0, fadeTime);
+    marks.clear();
+    checkRing(ring, marks, -2);
+}
+
+int main()
+{
+    srand(1);
+
+    // the client's ring sizes, a ring that is always full, and a
+    // single cell holding every mark
+    checkRandom(2048, 64);
+    checkRandom(500, 16);
+    checkRandom(37, 9);
+    checkRandom(100, 1);
+
+    // a bad capacity still gives a usable ring
+    TrackRing tiny(0);
+    tiny.setCellCount(1);
+    check(tiny.getCapacity() == 1, "capacity clamped");
+    TrackEntry te = TrackEntry();
+    te.phydrv = -1;
+    tiny.add(te, 0);
+    tiny.add(te, 0);
+    check(tiny.getCount() == 1, "full tiny ring");
+
+    if (failures)
+        printf("%d failures\n", failures);
+    else
+        printf("all passed\n");
+    return failures ? 1 : 0;
+}
+
+
+// Local Variables: ***
+// mode: C++ ***
+// tab-width: 4 ***
+// c-basic-offset: 4 ***
+// indent-tabs-mode: nil ***
+// End: ***
+// ex: shiftwidth=4 tabstop=4
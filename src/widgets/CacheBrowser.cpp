@@ -33,6 +33,20 @@ void CacheBrowser::draw(const char *title, bool *p_open) {
             ImGui::Text("Used Date: %s", getTimeStr(e.usedDate).c_str());
             ImGui::Text("URL: %s", e.url.c_str());
             ImGui::Text("Key: %s", e.key.c_str());
+            const CacheManager::TransferInfo* t = CACHEMGR.getTransferInfo(e.url);
+            if (t) {
+                ImGui::Separator();
+                ImGui::Text("Fetched: %s, %u bytes, priority %d",
+                    !t->good ? "failed" : t->notModified ? "not modified" : "ok",
+                    t->bytes, t->priority);
+                if (t->httpVersion)
+                    ImGui::Text("Connection: HTTP/%.1f, %s", t->httpVersion / 10.0f,
+                        t->reused ? "reused" : "new");
+                ImGui::Text("Queued: %.1f ms", t->queued * 1000.0);
+                ImGui::Text("DNS %.1f / connect %.1f / TLS %.1f / first byte %.1f / total %.1f ms",
+                    t->nameLookup * 1000.0, t->connect * 1000.0, t->tlsConnect * 1000.0,
+                    t->firstByte * 1000.0, t->total * 1000.0);
+            }
             ImGui::TreePop();
         }
     }
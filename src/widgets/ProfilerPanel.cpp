@@ -0,0 +1,117 @@
+#include "ProfilerPanel.h"
+
+#include "ZoneProfiler.h"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+ProfilerPanel::ProfilerPanel() {
+    strncpy(_tracePath, "bzflag-trace.json", sizeof(_tracePath));
+}
+
+static void getHistoryStats(const std::vector<float>& history, float& avg, float& max) {
+    avg = max = 0.0f;
+    for (float v: history) {
+        avg += v;
+        max = std::max(max, v);
+    }
+    avg /= (float)history.size();
+}
+
+void ProfilerPanel::draw(const char *title, bool *p_open) {
+    ImGui::SetNextWindowSize(ImVec2(500, 400), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin(title, p_open)) {
+        ImGui::End();
+        return;
+    }
+
+#ifndef BZ_ZONE_PROFILER
+    ImGui::TextWrapped("Zones are compiled out, only frame times are shown. "
+        "Configure with ENABLE_ZONE_PROFILER to time the subsystems.");
+#endif
+
+    bool enabled = ZONEPROFILER.isEnabled();
+    if (ImGui::Checkbox("Record zones", &enabled))
+        ZONEPROFILER.setEnabled(enabled);
+
+    const int offset = ZONEPROFILER.getHistoryPos();
+    float avg, max;
+    getHistoryStats(ZONEPROFILER.getFrameHistoryMs(), avg, max);
+    ImGui::Text("Frame %.2f ms, average %.2f ms, worst %.2f ms over %d frames",
+        ZONEPROFILER.getLastFrameMs(), avg, max, ZoneProfiler::HistoryFrames);
+    ImGui::PlotLines("##frame", ZONEPROFILER.getFrameHistoryMs().data(), ZoneProfiler::HistoryFrames,
+        offset, "frame ms", 0.0f, std::max(max, 1.0f), ImVec2(-1.0f, 60.0f));
+
+    const std::vector<ZoneProfiler::Zone>& zones = ZONEPROFILER.getZones();
+    if (_selected >= 0 && _selected < (int)zones.size()) {
+        const ZoneProfiler::Zone& z = zones[_selected];
+        getHistoryStats(z.historyMs, avg, max);
+        ImGui::PlotLines("##zone", z.historyMs.data(), ZoneProfiler::HistoryFrames,
+            offset, z.name.c_str(), 0.0f, std::max(max, 0.1f), ImVec2(-1.0f, 60.0f));
+    }
+
+    ImGui::Separator();
+    ImGui::InputInt("Frames", &_captureFrames);
+    _captureFrames = std::max(1, std::min(_captureFrames, ZoneProfiler::HistoryFrames * 10));
+    ImGui::SameLine();
+    if (ZONEPROFILER.isCapturing()) {
+        ImGui::Text("Capturing...");
+    } else if (ImGui::Button("Capture")) {
+        ZONEPROFILER.startCapture(_captureFrames);
+        _status.clear();
+    }
+    ImGui::InputText("Trace File", _tracePath, sizeof(_tracePath));
+    ImGui::SameLine();
+    if (ImGui::Button("Export")) {
+        if (ZONEPROFILER.exportTrace(_tracePath))
+            _status = std::string("Wrote ") + _tracePath;
+        else
+            _status = std::string("Could not write ") + _tracePath;
+    }
+    ImGui::Text("%zu events captured, %u dropped", ZONEPROFILER.getCaptureEventCount(),
+        ZONEPROFILER.getCaptureDropped());
+    if (!_status.empty())
+        ImGui::TextWrapped("%s", _status.c_str());
+
+    ImGui::Separator();
+
+    // slowest zones first
+    std::vector<int> order;
+    std::vector<float> avgs(zones.size()), maxs(zones.size());
+    for (size_t i = 0; i < zones.size(); i++) {
+        getHistoryStats(zones[i].historyMs, avgs[i], maxs[i]);
+        order.push_back((int)i);
+    }
+    std::sort(order.begin(), order.end(), [&](int a, int b) { return avgs[a] > avgs[b]; });
+
+    if (ImGui::BeginTable("zones", 5, ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY)) {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Zone");
+        ImGui::TableSetupColumn("Last ms");
+        ImGui::TableSetupColumn("Avg ms");
+        ImGui::TableSetupColumn("Max ms");
+        ImGui::TableSetupColumn("Calls");
+        ImGui::TableHeadersRow();
+        for (int i: order) {
+            const ZoneProfiler::Zone& z = zones[i];
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            if (ImGui::Selectable(z.name.c_str(), _selected == i, ImGuiSelectableFlags_SpanAllColumns))
+                _selected = (_selected == i) ? -1 : i;
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", z.lastMs);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", avgs[i]);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", maxs[i]);
+            ImGui::TableNextColumn();
+            ImGui::Text("%u", z.lastCalls);
+        }
+        ImGui::EndTable();
+    }
+
+    ImGui::End();
+}
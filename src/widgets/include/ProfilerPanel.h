@@ -0,0 +1,18 @@
+#ifndef PROFILERPANEL_H
+#define PROFILERPANEL_H
+
+#include <string>
+
+// Rolling per-zone timings from ZONEPROFILER, and trace capture/export
+class ProfilerPanel {
+    public:
+    ProfilerPanel();
+    void draw(const char* title, bool* p_open);
+    private:
+    int _selected = -1;
+    int _captureFrames = 120;
+    char _tracePath[256];
+    std::string _status;
+};
+
+#endif